@@ -0,0 +1,263 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * ChaCha and XChaCha stream ciphers, including ChaCha20 (RFC7539), using the
+ * rotate instructions of Zbb or Zbkb.
+ *
+ * Without them every 32-bit rotate in the quarter round costs a shift, a
+ * shift and an or; with roriw the permutation is a third shorter. Harts
+ * lacking both extensions use the generic code.
+ */
+
+#include <crypto/algapi.h>
+#include <crypto/internal/chacha.h>
+#include <crypto/internal/skcipher.h>
+#include <linux/jump_label.h>
+#include <linux/kernel.h>
+#include <linux/module.h>
+#include <asm/bitmanip.h>
+#include <asm/hwcap.h>
+#include <asm/unaligned.h>
+
+static __ro_after_init DEFINE_STATIC_KEY_FALSE(have_zbb);
+
+#define QR(a, b, c, d)							\
+	do {								\
+		a += b; d = riscv_rol32(d ^ a, 16);			\
+		c += d; b = riscv_rol32(b ^ c, 12);			\
+		a += b; d = riscv_rol32(d ^ a, 8);			\
+		c += d; b = riscv_rol32(b ^ c, 7);			\
+	} while (0)
+
+static void chacha_permute_zbb(u32 *x, int nrounds)
+{
+	u32 x0 = x[0], x1 = x[1], x2 = x[2], x3 = x[3];
+	u32 x4 = x[4], x5 = x[5], x6 = x[6], x7 = x[7];
+	u32 x8 = x[8], x9 = x[9], x10 = x[10], x11 = x[11];
+	u32 x12 = x[12], x13 = x[13], x14 = x[14], x15 = x[15];
+	int i;
+
+	for (i = 0; i < nrounds; i += 2) {
+		QR(x0, x4, x8, x12);
+		QR(x1, x5, x9, x13);
+		QR(x2, x6, x10, x14);
+		QR(x3, x7, x11, x15);
+
+		QR(x0, x5, x10, x15);
+		QR(x1, x6, x11, x12);
+		QR(x2, x7, x8, x13);
+		QR(x3, x4, x9, x14);
+	}
+
+	x[0] = x0; x[1] = x1; x[2] = x2; x[3] = x3;
+	x[4] = x4; x[5] = x5; x[6] = x6; x[7] = x7;
+	x[8] = x8; x[9] = x9; x[10] = x10; x[11] = x11;
+	x[12] = x12; x[13] = x13; x[14] = x14; x[15] = x15;
+}
+
+static void chacha_block_xor_zbb(u32 *state, u8 *dst, const u8 *src,
+				 unsigned int bytes, int nrounds)
+{
+	u32 x[CHACHA_STATE_WORDS];
+	u8 stream[CHACHA_BLOCK_SIZE];
+	int i;
+
+	memcpy(x, state, sizeof(x));
+	chacha_permute_zbb(x, nrounds);
+
+	if (bytes == CHACHA_BLOCK_SIZE) {
+		for (i = 0; i < CHACHA_STATE_WORDS; i++)
+			put_unaligned_le32(get_unaligned_le32(src + 4 * i) ^
+					   (x[i] + state[i]), dst + 4 * i);
+	} else {
+		for (i = 0; i < CHACHA_STATE_WORDS; i++)
+			put_unaligned_le32(x[i] + state[i], stream + 4 * i);
+		crypto_xor_cpy(dst, src, stream, bytes);
+		memzero_explicit(stream, sizeof(stream));
+	}
+	memzero_explicit(x, sizeof(x));
+
+	state[12]++;
+}
+
+static void chacha_crypt_zbb(u32 *state, u8 *dst, const u8 *src,
+			     unsigned int bytes, int nrounds)
+{
+	while (bytes) {
+		unsigned int l = min_t(unsigned int, bytes, CHACHA_BLOCK_SIZE);
+
+		chacha_block_xor_zbb(state, dst, src, l, nrounds);
+		bytes -= l;
+		src += l;
+		dst += l;
+	}
+}
+
+void hchacha_block_arch(const u32 *state, u32 *stream, int nrounds)
+{
+	u32 x[CHACHA_STATE_WORDS];
+
+	if (!static_branch_likely(&have_zbb)) {
+		hchacha_block_generic(state, stream, nrounds);
+		return;
+	}
+
+	memcpy(x, state, sizeof(x));
+	chacha_permute_zbb(x, nrounds);
+
+	memcpy(&stream[0], &x[0], 16);
+	memcpy(&stream[4], &x[12], 16);
+	memzero_explicit(x, sizeof(x));
+}
+EXPORT_SYMBOL(hchacha_block_arch);
+
+void chacha_init_arch(u32 *state, const u32 *key, const u8 *iv)
+{
+	chacha_init_generic(state, key, iv);
+}
+EXPORT_SYMBOL(chacha_init_arch);
+
+void chacha_crypt_arch(u32 *state, u8 *dst, const u8 *src, unsigned int bytes,
+		       int nrounds)
+{
+	if (!static_branch_likely(&have_zbb))
+		return chacha_crypt_generic(state, dst, src, bytes, nrounds);
+
+	chacha_crypt_zbb(state, dst, src, bytes, nrounds);
+}
+EXPORT_SYMBOL(chacha_crypt_arch);
+
+static int chacha_riscv64_stream_xor(struct skcipher_request *req,
+				     const struct chacha_ctx *ctx,
+				     const u8 *iv)
+{
+	struct skcipher_walk walk;
+	u32 state[16];
+	int err;
+
+	err = skcipher_walk_virt(&walk, req, false);
+
+	chacha_init_generic(state, ctx->key, iv);
+
+	while (walk.nbytes > 0) {
+		unsigned int nbytes = walk.nbytes;
+
+		if (nbytes < walk.total)
+			nbytes = round_down(nbytes, walk.stride);
+
+		chacha_crypt_arch(state, walk.dst.virt.addr,
+				  walk.src.virt.addr, nbytes, ctx->nrounds);
+		err = skcipher_walk_done(&walk, walk.nbytes - nbytes);
+	}
+
+	return err;
+}
+
+static int chacha_riscv64(struct skcipher_request *req)
+{
+	struct crypto_skcipher *tfm = crypto_skcipher_reqtfm(req);
+	struct chacha_ctx *ctx = crypto_skcipher_ctx(tfm);
+
+	return chacha_riscv64_stream_xor(req, ctx, req->iv);
+}
+
+static int xchacha_riscv64(struct skcipher_request *req)
+{
+	struct crypto_skcipher *tfm = crypto_skcipher_reqtfm(req);
+	struct chacha_ctx *ctx = crypto_skcipher_ctx(tfm);
+	struct chacha_ctx subctx;
+	u32 state[16];
+	u8 real_iv[16];
+
+	chacha_init_generic(state, ctx->key, req->iv);
+	hchacha_block_arch(state, subctx.key, ctx->nrounds);
+	subctx.nrounds = ctx->nrounds;
+
+	memcpy(&real_iv[0], req->iv + 24, 8);
+	memcpy(&real_iv[8], req->iv + 16, 8);
+	return chacha_riscv64_stream_xor(req, &subctx, real_iv);
+}
+
+static struct skcipher_alg algs[] = {
+	{
+		.base.cra_name		= "chacha20",
+		.base.cra_driver_name	= "chacha20-riscv64",
+		.base.cra_priority	= 200,
+		.base.cra_blocksize	= 1,
+		.base.cra_ctxsize	= sizeof(struct chacha_ctx),
+		.base.cra_module	= THIS_MODULE,
+
+		.min_keysize		= CHACHA_KEY_SIZE,
+		.max_keysize		= CHACHA_KEY_SIZE,
+		.ivsize			= CHACHA_IV_SIZE,
+		.chunksize		= CHACHA_BLOCK_SIZE,
+		.setkey			= chacha20_setkey,
+		.encrypt		= chacha_riscv64,
+		.decrypt		= chacha_riscv64,
+	}, {
+		.base.cra_name		= "xchacha20",
+		.base.cra_driver_name	= "xchacha20-riscv64",
+		.base.cra_priority	= 200,
+		.base.cra_blocksize	= 1,
+		.base.cra_ctxsize	= sizeof(struct chacha_ctx),
+		.base.cra_module	= THIS_MODULE,
+
+		.min_keysize		= CHACHA_KEY_SIZE,
+		.max_keysize		= CHACHA_KEY_SIZE,
+		.ivsize			= XCHACHA_IV_SIZE,
+		.chunksize		= CHACHA_BLOCK_SIZE,
+		.setkey			= chacha20_setkey,
+		.encrypt		= xchacha_riscv64,
+		.decrypt		= xchacha_riscv64,
+	}, {
+		.base.cra_name		= "xchacha12",
+		.base.cra_driver_name	= "xchacha12-riscv64",
+		.base.cra_priority	= 200,
+		.base.cra_blocksize	= 1,
+		.base.cra_ctxsize	= sizeof(struct chacha_ctx),
+		.base.cra_module	= THIS_MODULE,
+
+		.min_keysize		= CHACHA_KEY_SIZE,
+		.max_keysize		= CHACHA_KEY_SIZE,
+		.ivsize			= XCHACHA_IV_SIZE,
+		.chunksize		= CHACHA_BLOCK_SIZE,
+		.setkey			= chacha12_setkey,
+		.encrypt		= xchacha_riscv64,
+		.decrypt		= xchacha_riscv64,
+	}
+};
+
+static bool __init chacha_riscv64_has_rotate(void)
+{
+	return riscv_isa_extension_available(NULL, zbb) ||
+	       riscv_isa_extension_available(NULL, zbkb);
+}
+
+static int __init chacha_riscv64_mod_init(void)
+{
+	if (!chacha_riscv64_has_rotate())
+		return 0;
+
+	static_branch_enable(&have_zbb);
+
+	return IS_REACHABLE(CONFIG_CRYPTO_SKCIPHER) ?
+		crypto_register_skciphers(algs, ARRAY_SIZE(algs)) : 0;
+}
+
+static void __exit chacha_riscv64_mod_fini(void)
+{
+	if (IS_REACHABLE(CONFIG_CRYPTO_SKCIPHER) &&
+	    static_branch_likely(&have_zbb))
+		crypto_unregister_skciphers(algs, ARRAY_SIZE(algs));
+}
+
+module_init(chacha_riscv64_mod_init);
+module_exit(chacha_riscv64_mod_fini);
+
+MODULE_DESCRIPTION("ChaCha and XChaCha stream ciphers (Zbb/Zbkb accelerated)");
+MODULE_LICENSE("GPL v2");
+MODULE_ALIAS_CRYPTO("chacha20");
+MODULE_ALIAS_CRYPTO("chacha20-riscv64");
+MODULE_ALIAS_CRYPTO("xchacha20");
+MODULE_ALIAS_CRYPTO("xchacha20-riscv64");
+MODULE_ALIAS_CRYPTO("xchacha12");
+MODULE_ALIAS_CRYPTO("xchacha12-riscv64");
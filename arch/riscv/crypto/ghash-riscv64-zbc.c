@@ -0,0 +1,175 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * GHASH using the carry-less multiply instructions of Zbc or Zbkc.
+ *
+ * Each block takes three clmul/clmulh pairs (Karatsuba) and a shift and xor
+ * reduction modulo x^128 + x^7 + x^2 + x + 1, done in the bit-reflected
+ * domain GCM defines, instead of the 4k table lookups of ghash-generic.
+ */
+
+#include <crypto/algapi.h>
+#include <crypto/b128ops.h>
+#include <crypto/ghash.h>
+#include <crypto/internal/hash.h>
+#include <linux/crypto.h>
+#include <linux/init.h>
+#include <linux/kernel.h>
+#include <linux/module.h>
+#include <asm/bitmanip.h>
+#include <asm/hwcap.h>
+#include <asm/unaligned.h>
+
+struct ghash_zbc_ctx {
+	u64 h1;		/* high and low halves of the hash key */
+	u64 h0;
+	u64 hx;		/* h1 ^ h0, for the Karatsuba middle product */
+};
+
+static void ghash_zbc_mul(be128 *x, const struct ghash_zbc_ctx *ctx)
+{
+	u64 a1 = be64_to_cpu(x->a), a0 = be64_to_cpu(x->b);
+	u64 lo_l, lo_h, hi_l, hi_h, mid_l, mid_h;
+	u64 x0, x1, x2, x3, d;
+
+	lo_l = riscv_clmul(a0, ctx->h0);
+	lo_h = riscv_clmulh(a0, ctx->h0);
+	hi_l = riscv_clmul(a1, ctx->h1);
+	hi_h = riscv_clmulh(a1, ctx->h1);
+	mid_l = riscv_clmul(a0 ^ a1, ctx->hx) ^ lo_l ^ hi_l;
+	mid_h = riscv_clmulh(a0 ^ a1, ctx->hx) ^ lo_h ^ hi_h;
+
+	x0 = lo_l;
+	x1 = lo_h ^ mid_l;
+	x2 = hi_l ^ mid_h;
+	x3 = hi_h;
+
+	/* the product of two reflected values is one bit short */
+	x3 = (x3 << 1) | (x2 >> 63);
+	x2 = (x2 << 1) | (x1 >> 63);
+	x1 = (x1 << 1) | (x0 >> 63);
+	x0 <<= 1;
+
+	/* fold the low 128 bits into the high ones */
+	d = x1 ^ (x0 << 63) ^ (x0 << 62) ^ (x0 << 57);
+	x3 ^= d ^ (d >> 1) ^ (d >> 2) ^ (d >> 7);
+	x2 ^= x0 ^ (x0 >> 1) ^ (d << 63) ^ (x0 >> 2) ^ (d << 62) ^
+	      (x0 >> 7) ^ (d << 57);
+
+	x->a = cpu_to_be64(x3);
+	x->b = cpu_to_be64(x2);
+}
+
+static int ghash_zbc_init(struct shash_desc *desc)
+{
+	struct ghash_desc_ctx *dctx = shash_desc_ctx(desc);
+
+	memset(dctx, 0, sizeof(*dctx));
+
+	return 0;
+}
+
+static int ghash_zbc_setkey(struct crypto_shash *tfm,
+			    const u8 *key, unsigned int keylen)
+{
+	struct ghash_zbc_ctx *ctx = crypto_shash_ctx(tfm);
+
+	if (keylen != GHASH_BLOCK_SIZE)
+		return -EINVAL;
+
+	ctx->h1 = get_unaligned_be64(key);
+	ctx->h0 = get_unaligned_be64(key + 8);
+	ctx->hx = ctx->h1 ^ ctx->h0;
+
+	return 0;
+}
+
+static int ghash_zbc_update(struct shash_desc *desc,
+			    const u8 *src, unsigned int srclen)
+{
+	struct ghash_desc_ctx *dctx = shash_desc_ctx(desc);
+	struct ghash_zbc_ctx *ctx = crypto_shash_ctx(desc->tfm);
+	u8 *dst = dctx->buffer;
+
+	if (dctx->bytes) {
+		int n = min(srclen, dctx->bytes);
+		u8 *pos = dst + (GHASH_BLOCK_SIZE - dctx->bytes);
+
+		dctx->bytes -= n;
+		srclen -= n;
+
+		while (n--)
+			*pos++ ^= *src++;
+
+		if (!dctx->bytes)
+			ghash_zbc_mul((be128 *)dst, ctx);
+	}
+
+	while (srclen >= GHASH_BLOCK_SIZE) {
+		crypto_xor(dst, src, GHASH_BLOCK_SIZE);
+		ghash_zbc_mul((be128 *)dst, ctx);
+		src += GHASH_BLOCK_SIZE;
+		srclen -= GHASH_BLOCK_SIZE;
+	}
+
+	if (srclen) {
+		dctx->bytes = GHASH_BLOCK_SIZE - srclen;
+		while (srclen--)
+			*dst++ ^= *src++;
+	}
+
+	return 0;
+}
+
+static int ghash_zbc_final(struct shash_desc *desc, u8 *dst)
+{
+	struct ghash_desc_ctx *dctx = shash_desc_ctx(desc);
+	struct ghash_zbc_ctx *ctx = crypto_shash_ctx(desc->tfm);
+
+	/* a partial block is zero padded, which leaves it as it is */
+	if (dctx->bytes)
+		ghash_zbc_mul((be128 *)dctx->buffer, ctx);
+	dctx->bytes = 0;
+
+	memcpy(dst, dctx->buffer, GHASH_BLOCK_SIZE);
+
+	return 0;
+}
+
+static struct shash_alg ghash_alg = {
+	.digestsize	= GHASH_DIGEST_SIZE,
+	.init		= ghash_zbc_init,
+	.update		= ghash_zbc_update,
+	.final		= ghash_zbc_final,
+	.setkey		= ghash_zbc_setkey,
+	.descsize	= sizeof(struct ghash_desc_ctx),
+	.base		= {
+		.cra_name		= "ghash",
+		.cra_driver_name	= "ghash-riscv64-zbc",
+		.cra_priority		= 200,
+		.cra_blocksize		= GHASH_BLOCK_SIZE,
+		.cra_ctxsize		= sizeof(struct ghash_zbc_ctx),
+		.cra_module		= THIS_MODULE,
+	},
+};
+
+static int __init ghash_zbc_mod_init(void)
+{
+	if (!riscv_isa_extension_available(NULL, zbc) &&
+	    !riscv_isa_extension_available(NULL, zbkc))
+		return -ENODEV;
+
+	return crypto_register_shash(&ghash_alg);
+}
+
+static void __exit ghash_zbc_mod_exit(void)
+{
+	crypto_unregister_shash(&ghash_alg);
+}
+
+module_init(ghash_zbc_mod_init);
+module_exit(ghash_zbc_mod_exit);
+
+MODULE_LICENSE("GPL");
+MODULE_DESCRIPTION("GHASH hash function, Zbc/Zbkc accelerated");
+MODULE_ALIAS_CRYPTO("ghash");
+MODULE_ALIAS_CRYPTO("ghash-riscv64-zbc");
@@ -0,0 +1,58 @@
+/* SPDX-License-Identifier: GPL-2.0-only */
+/*
+ * Bit manipulation instructions from the Zbb, Zbc and Zbk* extensions.
+ *
+ * They are encoded with .insn so that assemblers predating the extensions
+ * still build the kernel; callers check riscv_isa_extension_available()
+ * before using them.
+ */
+
+#ifndef _ASM_RISCV_BITMANIP_H
+#define _ASM_RISCV_BITMANIP_H
+
+#include <linux/compiler.h>
+#include <linux/types.h>
+
+/* Low half of the carry-less product of @a and @b (Zbc or Zbkc) */
+static __always_inline unsigned long riscv_clmul(unsigned long a,
+						 unsigned long b)
+{
+	unsigned long r;
+
+	asm (".insn r 0x33, 1, 5, %0, %1, %2" : "=r" (r) : "r" (a), "r" (b));
+	return r;
+}
+
+/* High half of the carry-less product of @a and @b (Zbc or Zbkc) */
+static __always_inline unsigned long riscv_clmulh(unsigned long a,
+						  unsigned long b)
+{
+	unsigned long r;
+
+	asm (".insn r 0x33, 3, 5, %0, %1, %2" : "=r" (r) : "r" (a), "r" (b));
+	return r;
+}
+
+/* Bits XLEN-1 to 2*XLEN-2 of the carry-less product (Zbc only) */
+static __always_inline unsigned long riscv_clmulr(unsigned long a,
+						  unsigned long b)
+{
+	unsigned long r;
+
+	asm (".insn r 0x33, 2, 5, %0, %1, %2" : "=r" (r) : "r" (a), "r" (b));
+	return r;
+}
+
+#ifdef CONFIG_64BIT
+/* Rotate the low 32 bits of @x left by the constant @n (Zbb or Zbkb) */
+#define riscv_rol32(x, n)						\
+({									\
+	u32 __r;							\
+									\
+	asm (".insn i 0x1b, 5, %0, %1, %2"				\
+	     : "=r" (__r) : "r" (x), "i" (0x600 | (32 - (n))));	\
+	__r;								\
+})
+#endif
+
+#endif /* _ASM_RISCV_BITMANIP_H */
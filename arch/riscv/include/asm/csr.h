@@ -102,6 +102,8 @@
 #define CSR_SCAUSE		0x142
 #define CSR_STVAL		0x143
 #define CSR_SIP			0x144
+#define CSR_STIMECMP		0x14D
+#define CSR_STIMECMPH		0x15D
 #define CSR_SATP		0x180
 
 #define CSR_MSTATUS		0x300
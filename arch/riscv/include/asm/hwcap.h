@@ -34,6 +34,16 @@ extern unsigned long elf_hwcap;
 #define RISCV_ISA_EXT_s		('s' - 'a')
 #define RISCV_ISA_EXT_u		('u' - 'a')
 
+/*
+ * Multi-letter extensions follow the single letter ones, from
+ * RISCV_ISA_EXT_BASE on.
+ */
+#define RISCV_ISA_EXT_BASE	26
+#define RISCV_ISA_EXT_zbc	(RISCV_ISA_EXT_BASE + 0)
+#define RISCV_ISA_EXT_zbb	(RISCV_ISA_EXT_BASE + 1)
+#define RISCV_ISA_EXT_zbkb	(RISCV_ISA_EXT_BASE + 2)
+#define RISCV_ISA_EXT_zbkc	(RISCV_ISA_EXT_BASE + 3)
+
 #define RISCV_ISA_EXT_MAX	64
 
 unsigned long riscv_isa_extension_base(const unsigned long *isa_bitmap);
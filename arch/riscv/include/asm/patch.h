@@ -7,6 +7,7 @@
 #define _ASM_RISCV_PATCH_H
 
 int patch_text_nosync(void *addr, const void *insns, size_t len);
+int patch_text_noflush(void *addr, const void *insns, size_t len);
 int patch_text(void *addr, u32 insn);
 
 #endif /* _ASM_RISCV_PATCH_H */
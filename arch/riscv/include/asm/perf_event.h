@@ -16,10 +16,12 @@
 #define RISCV_BASE_COUNTERS	2
 
 /*
- * The RISCV_MAX_COUNTERS parameter should be specified.
+ * The RISCV_MAX_COUNTERS parameter should be specified. The SBI PMU
+ * extension numbers hardware and firmware counters in one space of at
+ * most XLEN entries.
  */
 
-#define RISCV_MAX_COUNTERS	2
+#define RISCV_MAX_COUNTERS	64
 
 /*
  * These are the indexes of bits in counteren register *minus* 1,
@@ -7,6 +7,7 @@
 #ifndef _ASM_RISCV_SBI_H
 #define _ASM_RISCV_SBI_H
 
+#include <linux/bits.h>
 #include <linux/types.h>
 
 #ifdef CONFIG_RISCV_SBI
@@ -27,6 +28,7 @@ enum sbi_ext_id {
 	SBI_EXT_IPI = 0x735049,
 	SBI_EXT_RFENCE = 0x52464E43,
 	SBI_EXT_HSM = 0x48534D,
+	SBI_EXT_PMU = 0x504D55,
 };
 
 enum sbi_ext_base_fid {
@@ -61,6 +63,7 @@ enum sbi_ext_hsm_fid {
 	SBI_EXT_HSM_HART_START = 0,
 	SBI_EXT_HSM_HART_STOP,
 	SBI_EXT_HSM_HART_STATUS,
+	SBI_EXT_HSM_HART_SUSPEND,
 };
 
 enum sbi_hsm_hart_status {
@@ -70,6 +73,53 @@ enum sbi_hsm_hart_status {
 	SBI_HSM_HART_STATUS_STOP_PENDING,
 };
 
+/* SBI_EXT_HSM_HART_SUSPEND suspend_type, since SBI v0.3 */
+#define SBI_HSM_SUSP_BASE_MASK			0x7fffffff
+#define SBI_HSM_SUSP_NON_RET_BIT		0x80000000
+#define SBI_HSM_SUSP_PLAT_BASE			0x10000000
+
+#define SBI_HSM_SUSPEND_RET_DEFAULT		0x00000000
+#define SBI_HSM_SUSPEND_RET_PLATFORM		SBI_HSM_SUSP_PLAT_BASE
+#define SBI_HSM_SUSPEND_NON_RET_DEFAULT		SBI_HSM_SUSP_NON_RET_BIT
+#define SBI_HSM_SUSPEND_NON_RET_PLATFORM	(SBI_HSM_SUSP_NON_RET_BIT | \
+						 SBI_HSM_SUSP_PLAT_BASE)
+
+enum sbi_ext_pmu_fid {
+	SBI_EXT_PMU_NUM_COUNTERS = 0,
+	SBI_EXT_PMU_COUNTER_GET_INFO,
+	SBI_EXT_PMU_COUNTER_CFG_MATCH,
+	SBI_EXT_PMU_COUNTER_START,
+	SBI_EXT_PMU_COUNTER_STOP,
+	SBI_EXT_PMU_COUNTER_FW_READ,
+};
+
+/* SBI PMU event_idx: type in bits [19:16], code in bits [15:0] */
+#define SBI_PMU_EVENT_IDX_TYPE_SHIFT	16
+#define SBI_PMU_EVENT_TYPE_HW		0x0
+#define SBI_PMU_EVENT_TYPE_CACHE	0x1
+#define SBI_PMU_EVENT_TYPE_RAW		0x2
+#define SBI_PMU_EVENT_TYPE_FW		0xf
+
+#define SBI_PMU_HW_CPU_CYCLES		1
+#define SBI_PMU_HW_INSTRUCTIONS		2
+
+/* SBI_EXT_PMU_COUNTER_GET_INFO */
+#define SBI_PMU_CTR_INFO_CSR_MASK	0xfff
+#define SBI_PMU_CTR_INFO_WIDTH_SHIFT	12
+#define SBI_PMU_CTR_INFO_WIDTH_MASK	0x3f
+#define SBI_PMU_CTR_INFO_TYPE_FW	BIT(__riscv_xlen - 1)
+
+/* SBI_EXT_PMU_COUNTER_CFG_MATCH flags */
+#define SBI_PMU_CFG_FLAG_SKIP_MATCH	BIT(0)
+#define SBI_PMU_CFG_FLAG_CLEAR_VALUE	BIT(1)
+#define SBI_PMU_CFG_FLAG_AUTO_START	BIT(2)
+
+/* SBI_EXT_PMU_COUNTER_START flags */
+#define SBI_PMU_START_FLAG_SET_INIT_VALUE	BIT(0)
+
+/* SBI_EXT_PMU_COUNTER_STOP flags */
+#define SBI_PMU_STOP_FLAG_RESET		BIT(0)
+
 #define SBI_SPEC_VERSION_DEFAULT	0x1
 #define SBI_SPEC_VERSION_MAJOR_SHIFT	24
 #define SBI_SPEC_VERSION_MAJOR_MASK	0x7f
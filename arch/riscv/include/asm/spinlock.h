@@ -8,46 +8,70 @@
 #define _ASM_RISCV_SPINLOCK_H
 
 #include <linux/kernel.h>
+#include <linux/atomic.h>
 #include <asm/current.h>
 #include <asm/fence.h>
 
 /*
- * Simple spin lock operations.  These provide no fairness guarantees.
+ * Ticket spin lock operations.  Waiters are served in the order they
+ * arrived, and while waiting they only read the lock word, so the line
+ * is not bounced between harts by failed AMOs.
+ *
+ * Taking a ticket is a single amoadd.w, releasing is a halfword store to
+ * the owner field.  The owner field sits in the low half of the word on
+ * little-endian riscv.
  */
 
-/* FIXME: Replace this with a ticket lock, like MIPS. */
+#define TICKET_SHIFT	16
 
-#define arch_spin_is_locked(x)	(READ_ONCE((x)->lock) != 0)
+static inline void arch_spin_lock(arch_spinlock_t *lock)
+{
+	u32 val = atomic_fetch_add(1 << TICKET_SHIFT, lock);
+	u16 ticket = val >> TICKET_SHIFT;
+
+	if (ticket == (u16)val)
+		return;
+
+	atomic_cond_read_acquire(lock, ticket == (u16)VAL);
+}
+
+static inline int arch_spin_trylock(arch_spinlock_t *lock)
+{
+	u32 old = atomic_read(lock);
+
+	if ((old >> TICKET_SHIFT) != (old & 0xffff))
+		return 0;
+
+	return atomic_try_cmpxchg(lock, &old, old + (1 << TICKET_SHIFT));
+}
 
 static inline void arch_spin_unlock(arch_spinlock_t *lock)
 {
-	smp_store_release(&lock->lock, 0);
+	u16 *owner = (u16 *)lock;
+	u32 val = atomic_read(lock);
+
+	smp_store_release(owner, (u16)val + 1);
 }
 
-static inline int arch_spin_trylock(arch_spinlock_t *lock)
+static inline int arch_spin_value_unlocked(arch_spinlock_t lock)
 {
-	int tmp = 1, busy;
+	u32 val = lock.counter;
 
-	__asm__ __volatile__ (
-		"	amoswap.w %0, %2, %1\n"
-		RISCV_ACQUIRE_BARRIER
-		: "=r" (busy), "+A" (lock->lock)
-		: "r" (tmp)
-		: "memory");
+	return (val >> TICKET_SHIFT) == (val & 0xffff);
+}
 
-	return !busy;
+static inline int arch_spin_is_locked(arch_spinlock_t *lock)
+{
+	return !arch_spin_value_unlocked(READ_ONCE(*lock));
 }
 
-static inline void arch_spin_lock(arch_spinlock_t *lock)
+static inline int arch_spin_is_contended(arch_spinlock_t *lock)
 {
-	while (1) {
-		if (arch_spin_is_locked(lock))
-			continue;
+	u32 val = atomic_read(lock);
 
-		if (arch_spin_trylock(lock))
-			break;
-	}
+	return (s16)((val >> TICKET_SHIFT) - (val & 0xffff)) > 1;
 }
+#define arch_spin_is_contended	arch_spin_is_contended
 
 /***********************************************************/
 
@@ -10,11 +10,15 @@
 # error "please don't include this file directly"
 #endif
 
-typedef struct {
-	volatile unsigned int lock;
-} arch_spinlock_t;
+#include <linux/types.h>
+
+/*
+ * Ticket lock: the upper 16 bits hand out tickets, the lower 16 bits hold
+ * the ticket being served.
+ */
+typedef atomic_t arch_spinlock_t;
 
-#define __ARCH_SPIN_LOCK_UNLOCKED	{ 0 }
+#define __ARCH_SPIN_LOCK_UNLOCKED	ATOMIC_INIT(0)
 
 typedef struct {
 	volatile unsigned int lock;
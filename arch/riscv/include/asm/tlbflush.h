@@ -9,6 +9,13 @@
 
 #include <linux/mm_types.h>
 #include <asm/smp.h>
+#include <asm/sbi.h>
+
+/*
+ * Ranges spanning more pages than this are cheaper to drop with a single
+ * full sfence.vma than one fence per page.
+ */
+#define TLB_FLUSH_ALL_THRESHOLD	64
 
 #ifdef CONFIG_MMU
 static inline void local_flush_tlb_all(void)
@@ -21,9 +28,24 @@ static inline void local_flush_tlb_page(unsigned long addr)
 {
 	__asm__ __volatile__ ("sfence.vma %0" : : "r" (addr) : "memory");
 }
+
+/* Flush a range of pages from local TLB */
+static inline void local_flush_tlb_range(unsigned long start,
+					 unsigned long end)
+{
+	start &= PAGE_MASK;
+	if ((end - start) >> PAGE_SHIFT > TLB_FLUSH_ALL_THRESHOLD) {
+		local_flush_tlb_all();
+		return;
+	}
+
+	for (; start < end; start += PAGE_SIZE)
+		local_flush_tlb_page(start);
+}
 #else /* CONFIG_MMU */
 #define local_flush_tlb_all()			do { } while (0)
 #define local_flush_tlb_page(addr)		do { } while (0)
+#define local_flush_tlb_range(start, end)	do { } while (0)
 #endif /* CONFIG_MMU */
 
 #if defined(CONFIG_SMP) && defined(CONFIG_MMU)
@@ -40,7 +62,7 @@ void flush_tlb_range(struct vm_area_struct *vma, unsigned long start,
 static inline void flush_tlb_range(struct vm_area_struct *vma,
 		unsigned long start, unsigned long end)
 {
-	local_flush_tlb_all();
+	local_flush_tlb_range(start, end);
 }
 
 #define flush_tlb_mm(mm) flush_tlb_all()
@@ -50,7 +72,18 @@ static inline void flush_tlb_range(struct vm_area_struct *vma,
 static inline void flush_tlb_kernel_range(unsigned long start,
 	unsigned long end)
 {
-	flush_tlb_all();
+#if defined(CONFIG_SMP) && defined(CONFIG_MMU)
+	start &= PAGE_MASK;
+	if ((end - start) >> PAGE_SHIFT > TLB_FLUSH_ALL_THRESHOLD) {
+		flush_tlb_all();
+		return;
+	}
+
+	/* Kernel mappings are global, fence the range on every hart */
+	sbi_remote_sfence_vma(NULL, start, end - start);
+#else
+	local_flush_tlb_range(start, end);
+#endif
 }
 
 #endif /* _ASM_RISCV_TLBFLUSH_H */
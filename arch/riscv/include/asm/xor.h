@@ -0,0 +1,151 @@
+/* SPDX-License-Identifier: GPL-2.0-only */
+/*
+ * RAID-5 checksumming for in-order RISC-V cores such as the U54.
+ *
+ * The generic 32regs code xors every source word straight after loading
+ * it, so on a core that doesn't reorder each xor waits out the load-use
+ * latency. Here all the loads of a source line are issued ahead of the xors
+ * that consume the previous one, keeping the load pipe busy every cycle.
+ */
+
+#include <asm-generic/xor.h>
+
+#define XOR_LOAD8(r, p)							\
+	do {								\
+		r##0 = (p)[0]; r##1 = (p)[1];				\
+		r##2 = (p)[2]; r##3 = (p)[3];				\
+		r##4 = (p)[4]; r##5 = (p)[5];				\
+		r##6 = (p)[6]; r##7 = (p)[7];				\
+	} while (0)
+
+#define XOR_XOR8(d, s)							\
+	do {								\
+		d##0 ^= s##0; d##1 ^= s##1;				\
+		d##2 ^= s##2; d##3 ^= s##3;				\
+		d##4 ^= s##4; d##5 ^= s##5;				\
+		d##6 ^= s##6; d##7 ^= s##7;				\
+	} while (0)
+
+#define XOR_STORE8(p, r)						\
+	do {								\
+		(p)[0] = r##0; (p)[1] = r##1;				\
+		(p)[2] = r##2; (p)[3] = r##3;				\
+		(p)[4] = r##4; (p)[5] = r##5;				\
+		(p)[6] = r##6; (p)[7] = r##7;				\
+	} while (0)
+
+static void
+xor_riscv_2(unsigned long bytes, unsigned long *p1, unsigned long *p2)
+{
+	long lines = bytes / (sizeof(long)) / 8;
+
+	do {
+		unsigned long d0, d1, d2, d3, d4, d5, d6, d7;
+		unsigned long s0, s1, s2, s3, s4, s5, s6, s7;
+
+		XOR_LOAD8(d, p1);
+		XOR_LOAD8(s, p2);
+		XOR_XOR8(d, s);
+		XOR_STORE8(p1, d);
+		p1 += 8;
+		p2 += 8;
+	} while (--lines > 0);
+}
+
+static void
+xor_riscv_3(unsigned long bytes, unsigned long *p1, unsigned long *p2,
+	    unsigned long *p3)
+{
+	long lines = bytes / (sizeof(long)) / 8;
+
+	do {
+		unsigned long d0, d1, d2, d3, d4, d5, d6, d7;
+		unsigned long s0, s1, s2, s3, s4, s5, s6, s7;
+		unsigned long t0, t1, t2, t3, t4, t5, t6, t7;
+
+		XOR_LOAD8(d, p1);
+		XOR_LOAD8(s, p2);
+		XOR_LOAD8(t, p3);
+		XOR_XOR8(d, s);
+		XOR_XOR8(d, t);
+		XOR_STORE8(p1, d);
+		p1 += 8;
+		p2 += 8;
+		p3 += 8;
+	} while (--lines > 0);
+}
+
+static void
+xor_riscv_4(unsigned long bytes, unsigned long *p1, unsigned long *p2,
+	    unsigned long *p3, unsigned long *p4)
+{
+	long lines = bytes / (sizeof(long)) / 8;
+
+	do {
+		unsigned long d0, d1, d2, d3, d4, d5, d6, d7;
+		unsigned long s0, s1, s2, s3, s4, s5, s6, s7;
+		unsigned long t0, t1, t2, t3, t4, t5, t6, t7;
+
+		XOR_LOAD8(d, p1);
+		XOR_LOAD8(s, p2);
+		XOR_LOAD8(t, p3);
+		XOR_XOR8(d, s);
+		XOR_LOAD8(s, p4);
+		XOR_XOR8(d, t);
+		XOR_XOR8(d, s);
+		XOR_STORE8(p1, d);
+		p1 += 8;
+		p2 += 8;
+		p3 += 8;
+		p4 += 8;
+	} while (--lines > 0);
+}
+
+static void
+xor_riscv_5(unsigned long bytes, unsigned long *p1, unsigned long *p2,
+	    unsigned long *p3, unsigned long *p4, unsigned long *p5)
+{
+	long lines = bytes / (sizeof(long)) / 8;
+
+	do {
+		unsigned long d0, d1, d2, d3, d4, d5, d6, d7;
+		unsigned long s0, s1, s2, s3, s4, s5, s6, s7;
+		unsigned long t0, t1, t2, t3, t4, t5, t6, t7;
+
+		XOR_LOAD8(d, p1);
+		XOR_LOAD8(s, p2);
+		XOR_LOAD8(t, p3);
+		XOR_XOR8(d, s);
+		XOR_LOAD8(s, p4);
+		XOR_XOR8(d, t);
+		XOR_LOAD8(t, p5);
+		XOR_XOR8(d, s);
+		XOR_XOR8(d, t);
+		XOR_STORE8(p1, d);
+		p1 += 8;
+		p2 += 8;
+		p3 += 8;
+		p4 += 8;
+		p5 += 8;
+	} while (--lines > 0);
+}
+
+#undef XOR_LOAD8
+#undef XOR_XOR8
+#undef XOR_STORE8
+
+static struct xor_block_template xor_block_riscv = {
+	.name	= "riscv_int",
+	.do_2	= xor_riscv_2,
+	.do_3	= xor_riscv_3,
+	.do_4	= xor_riscv_4,
+	.do_5	= xor_riscv_5,
+};
+
+#undef XOR_TRY_TEMPLATES
+#define XOR_TRY_TEMPLATES				\
+	do {						\
+		xor_speed(&xor_block_8regs);		\
+		xor_speed(&xor_block_32regs);		\
+		xor_speed(&xor_block_riscv);		\
+	} while (0)
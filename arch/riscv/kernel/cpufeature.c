@@ -7,6 +7,7 @@
  */
 
 #include <linux/bitmap.h>
+#include <linux/ctype.h>
 #include <linux/of.h>
 #include <asm/processor.h>
 #include <asm/hwcap.h>
@@ -59,6 +60,35 @@ bool __riscv_isa_extension_available(const unsigned long *isa_bitmap, int bit)
 }
 EXPORT_SYMBOL_GPL(__riscv_isa_extension_available);
 
+static const struct {
+	const char *name;
+	int bit;
+} riscv_isa_ext[] = {
+	{ "zbb", RISCV_ISA_EXT_zbb },
+	{ "zbc", RISCV_ISA_EXT_zbc },
+	{ "zbkb", RISCV_ISA_EXT_zbkb },
+	{ "zbkc", RISCV_ISA_EXT_zbkc },
+};
+
+/*
+ * Parse the multi-letter extension at @ext, up to the next underscore, and
+ * return its length.
+ */
+static size_t riscv_parse_isa_ext(const char *ext, unsigned long *this_isa)
+{
+	size_t len = strcspn(ext, "_");
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(riscv_isa_ext); i++) {
+		if (strlen(riscv_isa_ext[i].name) == len &&
+		    !strncasecmp(ext, riscv_isa_ext[i].name, len))
+			this_isa[riscv_isa_ext[i].bit / BITS_PER_LONG] |=
+				BIT_MASK(riscv_isa_ext[i].bit);
+	}
+
+	return len;
+}
+
 void riscv_fill_hwcap(void)
 {
 	struct device_node *node;
@@ -79,8 +109,8 @@ void riscv_fill_hwcap(void)
 	bitmap_zero(riscv_isa, RISCV_ISA_EXT_MAX);
 
 	for_each_of_cpu_node(node) {
+		DECLARE_BITMAP(this_isa, RISCV_ISA_EXT_MAX) = { 0 };
 		unsigned long this_hwcap = 0;
-		unsigned long this_isa = 0;
 
 		if (riscv_of_processor_hartid(node) < 0)
 			continue;
@@ -100,13 +130,22 @@ void riscv_fill_hwcap(void)
 			i += 4;
 #endif
 		for (; i < isa_len; ++i) {
-			this_hwcap |= isa2hwcap[(unsigned char)(isa[i])];
 			/*
-			 * TODO: X, Y and Z extension parsing for Host ISA
-			 * bitmap will be added in-future.
+			 * Multi-letter extensions start after an underscore, or
+			 * with X or Z, and run to the next underscore.
 			 */
+			if (isa[i] == '_') {
+				continue;
+			} else if ((i && isa[i - 1] == '_') ||
+				   tolower(isa[i]) == 'x' ||
+				   tolower(isa[i]) == 'z') {
+				i += riscv_parse_isa_ext(&isa[i], this_isa) - 1;
+				continue;
+			}
+
+			this_hwcap |= isa2hwcap[(unsigned char)(isa[i])];
 			if ('a' <= isa[i] && isa[i] < 'x')
-				this_isa |= (1UL << (isa[i] - 'a'));
+				this_isa[0] |= (1UL << (isa[i] - 'a'));
 		}
 
 		/*
@@ -119,10 +158,11 @@ void riscv_fill_hwcap(void)
 		else
 			elf_hwcap = this_hwcap;
 
-		if (riscv_isa[0])
-			riscv_isa[0] &= this_isa;
+		if (bitmap_empty(riscv_isa, RISCV_ISA_EXT_MAX))
+			bitmap_copy(riscv_isa, this_isa, RISCV_ISA_EXT_MAX);
 		else
-			riscv_isa[0] = this_isa;
+			bitmap_and(riscv_isa, riscv_isa, this_isa,
+				   RISCV_ISA_EXT_MAX);
 	}
 
 	/* We don't support systems with F but without D, so mask those out
@@ -133,11 +173,16 @@ void riscv_fill_hwcap(void)
 	}
 
 	memset(print_str, 0, sizeof(print_str));
-	for (i = 0, j = 0; i < BITS_PER_LONG; i++)
+	for (i = 0, j = 0; i < RISCV_ISA_EXT_BASE; i++)
 		if (riscv_isa[0] & BIT_MASK(i))
 			print_str[j++] = (char)('a' + i);
 	pr_info("riscv: ISA extensions %s\n", print_str);
 
+	for (i = 0; i < ARRAY_SIZE(riscv_isa_ext); i++)
+		if (test_bit(riscv_isa_ext[i].bit, riscv_isa))
+			pr_info("riscv: ISA extension %s\n",
+				riscv_isa_ext[i].name);
+
 	memset(print_str, 0, sizeof(print_str));
 	for (i = 0, j = 0; i < BITS_PER_LONG; i++)
 		if (elf_hwcap & BIT_MASK(i))
@@ -12,20 +12,43 @@
 #include <asm/patch.h>
 
 #ifdef CONFIG_DYNAMIC_FTRACE
+/*
+ * What the trampolines in mcount-dyn.S call.  They load these instead of
+ * being patched, so retargeting them is a single store that can't be seen
+ * half done by a hart running a trampoline.
+ */
+unsigned long ftrace_call_dest = (unsigned long)ftrace_stub;
+#ifdef CONFIG_FUNCTION_GRAPH_TRACER
+unsigned long ftrace_graph_call_dest = (unsigned long)ftrace_stub;
+#endif
+
 int ftrace_arch_code_modify_prepare(void) __acquires(&text_mutex)
 {
 	mutex_lock(&text_mutex);
 	return 0;
 }
 
+/* Call sites are patched without flushing, see ftrace_patch_insn0(). */
 int ftrace_arch_code_modify_post_process(void) __releases(&text_mutex)
 {
+	flush_icache_all();
 	mutex_unlock(&text_mutex);
 	return 0;
 }
 
-static int ftrace_check_current_call(unsigned long hook_pos,
-				     unsigned int *expected)
+/*
+ * Every instruction of a call site is patched on its own, and only its
+ * first one once the site is set up, so there is no need to stop the
+ * other harts while doing so.
+ */
+void arch_ftrace_update_code(int command)
+{
+	command |= FTRACE_MAY_SLEEP;
+	ftrace_modify_all_code(command);
+}
+
+static int __maybe_unused ftrace_check_current_call(unsigned long hook_pos,
+						    unsigned int *expected)
 {
 	unsigned int replaced[2];
 	unsigned int nops[2] = {NOP4, NOP4};
@@ -56,36 +79,25 @@ static int ftrace_check_current_call(unsigned long hook_pos,
 	return 0;
 }
 
-static int __ftrace_modify_call(unsigned long hook_pos, unsigned long target,
-				bool enable)
-{
-	unsigned int call[2];
-	unsigned int nops[2] = {NOP4, NOP4};
-
-	make_call(hook_pos, target, call);
-
-	/* Replace the auipc-jalr pair at once. Return -EPERM on write error. */
-	if (patch_text_nosync
-	    ((void *)hook_pos, enable ? call : nops, MCOUNT_INSN_SIZE))
-		return -EPERM;
-
-	return 0;
-}
-
 /*
- * Put 5 instructions with 16 bytes at the front of function within
+ * Put 4 instructions with 16 bytes at the front of function within
  * patchable function entry nops' area.
  *
- * 0: REG_S  ra, -SZREG(sp)
+ * 0: REG_S  ra, -SZREG(sp)	or	j 16, while the site is disabled
  * 1: auipc  ra, 0x?
  * 2: jalr   -?(ra)
  * 3: REG_L  ra, -SZREG(sp)
  *
  * So the opcodes is:
- * 0: 0xfe113c23 (sd)/0xfe112e23 (sw)
+ * 0: 0xfe113c23 (sd)/0xfe112e23 (sw), or 0x0100006f (j)
  * 1: 0x???????? -> auipc
  * 2: 0x???????? -> jalr
  * 3: 0xff813083 (ld)/0xffc12083 (lw)
+ *
+ * Instructions 1-3 are written once, by ftrace_init_nop(), and always call
+ * FTRACE_REGS_ADDR; a disabled site jumps over them.  Enabling or disabling
+ * a site then rewrites just the aligned instruction 0, which other harts
+ * see either before or after the change but never torn.
  */
 #if __riscv_xlen == 64
 #define INSN0	0xfe113c23
@@ -94,50 +106,52 @@ static int __ftrace_modify_call(unsigned long hook_pos, unsigned long target,
 #define INSN0	0xfe112e23
 #define INSN3	0xffc12083
 #endif
+#define INSN0_SKIP	0x0100006f
 
 #define FUNC_ENTRY_SIZE	16
 #define FUNC_ENTRY_JMP	4
 
-int ftrace_make_call(struct dyn_ftrace *rec, unsigned long addr)
+static int ftrace_patch_insn0(struct dyn_ftrace *rec, unsigned int insn)
 {
-	unsigned int call[4] = {INSN0, 0, 0, INSN3};
-	unsigned long target = addr;
-	unsigned long caller = rec->ip + FUNC_ENTRY_JMP;
-
-	call[1] = to_auipc_insn((unsigned int)(target - caller));
-	call[2] = to_jalr_insn((unsigned int)(target - caller));
-
-	if (patch_text_nosync((void *)rec->ip, call, FUNC_ENTRY_SIZE))
+	if (patch_text_noflush((void *)rec->ip, &insn, sizeof(insn)))
 		return -EPERM;
 
 	return 0;
 }
 
-int ftrace_make_nop(struct module *mod, struct dyn_ftrace *rec,
-		    unsigned long addr)
+int ftrace_make_call(struct dyn_ftrace *rec, unsigned long addr)
 {
-	unsigned int nops[4] = {NOP4, NOP4, NOP4, NOP4};
-
-	if (patch_text_nosync((void *)rec->ip, nops, FUNC_ENTRY_SIZE))
-		return -EPERM;
+	/* there are no per-ops trampolines, see the comment above */
+	if (WARN_ON_ONCE(addr != FTRACE_ADDR && addr != FTRACE_REGS_ADDR))
+		return -EINVAL;
 
-	return 0;
+	return ftrace_patch_insn0(rec, INSN0);
 }
 
+int ftrace_make_nop(struct module *mod, struct dyn_ftrace *rec,
+		    unsigned long addr)
+{
+	return ftrace_patch_insn0(rec, INSN0_SKIP);
+}
 
 /*
  * This is called early on, and isn't wrapped by
  * ftrace_arch_code_modify_{prepare,post_process}() and therefor doesn't hold
- * text_mutex, which triggers a lockdep failure.  SMP isn't running so we could
- * just directly poke the text, but it's simpler to just take the lock
- * ourselves.
+ * text_mutex, which triggers a lockdep failure.  SMP isn't running, or the
+ * module isn't live yet, so we could just directly poke the text, but it's
+ * simpler to just take the lock ourselves.
  */
 int ftrace_init_nop(struct module *mod, struct dyn_ftrace *rec)
 {
-	int out;
+	unsigned int call[4] = {INSN0_SKIP, 0, 0, INSN3};
+	unsigned long caller = rec->ip + FUNC_ENTRY_JMP;
+	int out = 0;
+
+	make_call(caller, FTRACE_REGS_ADDR, (call + 1));
 
 	ftrace_arch_code_modify_prepare();
-	out = ftrace_make_nop(mod, rec, MCOUNT_ADDR);
+	if (patch_text_noflush((void *)rec->ip, call, FUNC_ENTRY_SIZE))
+		out = -EPERM;
 	ftrace_arch_code_modify_post_process();
 
 	return out;
@@ -145,14 +159,8 @@ int ftrace_init_nop(struct module *mod, struct dyn_ftrace *rec)
 
 int ftrace_update_ftrace_func(ftrace_func_t func)
 {
-	int ret = __ftrace_modify_call((unsigned long)&ftrace_call,
-				       (unsigned long)func, true);
-	if (!ret) {
-		ret = __ftrace_modify_call((unsigned long)&ftrace_regs_call,
-					   (unsigned long)func, true);
-	}
-
-	return ret;
+	WRITE_ONCE(ftrace_call_dest, (unsigned long)func);
+	return 0;
 }
 
 int __init ftrace_dyn_arch_init(void)
@@ -162,20 +170,18 @@ int __init ftrace_dyn_arch_init(void)
 #endif
 
 #ifdef CONFIG_DYNAMIC_FTRACE_WITH_REGS
+/*
+ * Switching between FTRACE_ADDR and FTRACE_REGS_ADDR needs no patching, as
+ * every site calls ftrace_regs_caller.  Just check the site is what we think.
+ */
 int ftrace_modify_call(struct dyn_ftrace *rec, unsigned long old_addr,
 		       unsigned long addr)
 {
 	unsigned int call[2];
 	unsigned long caller = rec->ip + FUNC_ENTRY_JMP;
-	int ret;
-
-	make_call(caller, old_addr, call);
-	ret = ftrace_check_current_call(caller, call);
-
-	if (ret)
-		return ret;
 
-	return __ftrace_modify_call(caller, addr, true);
+	make_call(caller, FTRACE_REGS_ADDR, call);
+	return ftrace_check_current_call(caller, call);
 }
 #endif
 
@@ -203,32 +209,16 @@ void prepare_ftrace_return(unsigned long *parent, unsigned long self_addr,
 }
 
 #ifdef CONFIG_DYNAMIC_FTRACE
-extern void ftrace_graph_call(void);
-extern void ftrace_graph_regs_call(void);
 int ftrace_enable_ftrace_graph_caller(void)
 {
-	int ret;
-
-	ret = __ftrace_modify_call((unsigned long)&ftrace_graph_call,
-				    (unsigned long)&prepare_ftrace_return, true);
-	if (ret)
-		return ret;
-
-	return __ftrace_modify_call((unsigned long)&ftrace_graph_regs_call,
-				    (unsigned long)&prepare_ftrace_return, true);
+	WRITE_ONCE(ftrace_graph_call_dest, (unsigned long)&prepare_ftrace_return);
+	return 0;
 }
 
 int ftrace_disable_ftrace_graph_caller(void)
 {
-	int ret;
-
-	ret = __ftrace_modify_call((unsigned long)&ftrace_graph_call,
-				    (unsigned long)&prepare_ftrace_return, false);
-	if (ret)
-		return ret;
-
-	return __ftrace_modify_call((unsigned long)&ftrace_graph_regs_call,
-				    (unsigned long)&prepare_ftrace_return, false);
+	WRITE_ONCE(ftrace_graph_call_dest, (unsigned long)&ftrace_stub);
+	return 0;
 }
 #endif /* CONFIG_DYNAMIC_FTRACE */
 #endif /* CONFIG_FUNCTION_GRAPH_TRACER */
@@ -9,6 +9,8 @@
 #include <linux/kernel.h>
 #include <linux/module.h>
 #include <linux/moduleloader.h>
+#include <linux/mm.h>
+#include <linux/sort.h>
 
 unsigned long module_emit_got_entry(struct module *mod, unsigned long val)
 {
@@ -60,30 +62,75 @@ static int is_rela_equal(const Elf_Rela *x, const Elf_Rela *y)
 	return x->r_info == y->r_info && x->r_addend == y->r_addend;
 }
 
-static bool duplicate_rela(const Elf_Rela *rela, int idx)
+static int cmp_rela(const void *a, const void *b)
 {
-	int i;
-	for (i = 0; i < idx; i++) {
-		if (is_rela_equal(&rela[i], &rela[idx]))
-			return true;
+	const Elf_Rela *x = a, *y = b;
+
+	if (x->r_info != y->r_info)
+		return x->r_info < y->r_info ? -1 : 1;
+	if (x->r_addend != y->r_addend)
+		return x->r_addend < y->r_addend ? -1 : 1;
+	return 0;
+}
+
+/*
+ * Copy the PLT and GOT relocations against executable sections to @out,
+ * or only count them when @out is NULL.
+ */
+static unsigned int collect_entries(Elf_Ehdr *ehdr, Elf_Shdr *sechdrs,
+				    Elf_Rela *out)
+{
+	unsigned int n = 0;
+	int i, j;
+
+	for (i = 0; i < ehdr->e_shnum; i++) {
+		Elf_Rela *relas = (void *)ehdr + sechdrs[i].sh_offset;
+		int num_rela = sechdrs[i].sh_size / sizeof(Elf_Rela);
+		Elf_Shdr *dst_sec = sechdrs + sechdrs[i].sh_info;
+
+		if (sechdrs[i].sh_type != SHT_RELA)
+			continue;
+
+		/* ignore relocations that operate on non-exec sections */
+		if (!(dst_sec->sh_flags & SHF_EXECINSTR))
+			continue;
+
+		for (j = 0; j < num_rela; j++) {
+			unsigned int type = ELF_RISCV_R_TYPE(relas[j].r_info);
+
+			if (type != R_RISCV_CALL_PLT &&
+			    type != R_RISCV_GOT_HI20)
+				continue;
+			if (out)
+				out[n] = relas[j];
+			n++;
+		}
 	}
-	return false;
+
+	return n;
 }
 
-static void count_max_entries(Elf_Rela *relas, int num,
+/*
+ * Sorted, duplicates are neighbours: this is O(n log n) where comparing
+ * every relocation against all those before it was O(n^2), which is what
+ * made loading large modules slow.
+ */
+static void count_max_entries(Elf_Rela *relas, unsigned int num,
 			      unsigned int *plts, unsigned int *gots)
 {
 	unsigned int type, i;
 
+	sort(relas, num, sizeof(*relas), cmp_rela, NULL);
+
 	for (i = 0; i < num; i++) {
+		if (i && is_rela_equal(&relas[i - 1], &relas[i]))
+			continue;
+
 		type = ELF_RISCV_R_TYPE(relas[i].r_info);
-		if (type == R_RISCV_CALL_PLT) {
-			if (!duplicate_rela(relas, i))
-				(*plts)++;
-		} else if (type == R_RISCV_GOT_HI20) {
-			if (!duplicate_rela(relas, i))
-				(*gots)++;
-		}
+		if (type == R_RISCV_CALL_PLT)
+			(*plts)++;
+		else
+			(*gots)++;
 	}
 }
 
@@ -92,6 +139,8 @@ int module_frob_arch_sections(Elf_Ehdr *ehdr, Elf_Shdr *sechdrs,
 {
 	unsigned int num_plts = 0;
 	unsigned int num_gots = 0;
+	unsigned int num;
+	Elf_Rela *relas;
 	int i;
 
 	/*
@@ -119,20 +168,18 @@ int module_frob_arch_sections(Elf_Ehdr *ehdr, Elf_Shdr *sechdrs,
 		return -ENOEXEC;
 	}
 
-	/* Calculate the maxinum number of entries */
-	for (i = 0; i < ehdr->e_shnum; i++) {
-		Elf_Rela *relas = (void *)ehdr + sechdrs[i].sh_offset;
-		int num_rela = sechdrs[i].sh_size / sizeof(Elf_Rela);
-		Elf_Shdr *dst_sec = sechdrs + sechdrs[i].sh_info;
-
-		if (sechdrs[i].sh_type != SHT_RELA)
-			continue;
-
-		/* ignore relocations that operate on non-exec sections */
-		if (!(dst_sec->sh_flags & SHF_EXECINSTR))
-			continue;
-
-		count_max_entries(relas, num_rela, &num_plts, &num_gots);
+	/*
+	 * Calculate the maxinum number of entries, on a copy: the order of
+	 * the relocations themselves matters to pairs like SET6/SUB6.
+	 */
+	num = collect_entries(ehdr, sechdrs, NULL);
+	if (num) {
+		relas = kvmalloc_array(num, sizeof(*relas), GFP_KERNEL);
+		if (!relas)
+			return -ENOMEM;
+		collect_entries(ehdr, sechdrs, relas);
+		count_max_entries(relas, num, &num_plts, &num_gots);
+		kvfree(relas);
 	}
 
 	mod->arch.plt.shdr->sh_type = SHT_NOBITS;
@@ -356,13 +356,23 @@ int apply_relocate_add(Elf_Shdr *sechdrs, const char *strtab,
 		v = sym->st_value + rel[i].r_addend;
 
 		if (type == R_RISCV_PCREL_LO12_I || type == R_RISCV_PCREL_LO12_S) {
-			unsigned int j;
-
-			for (j = 0; j < sechdrs[relsec].sh_size / sizeof(*rel); j++) {
-				unsigned long hi20_loc =
+			unsigned int n = sechdrs[relsec].sh_size / sizeof(*rel);
+			unsigned int j, k;
+
+			/*
+			 * The HI20 is almost always just a few entries back,
+			 * so look backwards from here, wrapping around, rather
+			 * than from the start of the section every time.
+			 */
+			for (k = 0; k < n; k++) {
+				unsigned long hi20_loc;
+				u32 hi20_type;
+
+				j = (i + n - 1 - k) % n;
+				hi20_loc =
 					sechdrs[sechdrs[relsec].sh_info].sh_addr
 					+ rel[j].r_offset;
-				u32 hi20_type = ELF_RISCV_R_TYPE(rel[j].r_info);
+				hi20_type = ELF_RISCV_R_TYPE(rel[j].r_info);
 
 				/* Find the corresponding HI20 relocation entry */
 				if (hi20_loc == sym->st_value
@@ -391,7 +401,7 @@ int apply_relocate_add(Elf_Shdr *sechdrs, const char *strtab,
 					break;
 				}
 			}
-			if (j == sechdrs[relsec].sh_size / sizeof(*rel)) {
+			if (k == n) {
 				pr_err(
 				  "%s: Can not find HI20 relocation information\n",
 				  me->name);
@@ -99,6 +99,17 @@ int patch_text_nosync(void *addr, const void *insns, size_t len)
 }
 NOKPROBE_SYMBOL(patch_text_nosync);
 
+/*
+ * Like patch_text_nosync(), but leave the instruction cache alone so that a
+ * batch of patches can be followed by a single flush_icache_all().  Only
+ * for changes where both the old and the new text are safe to execute.
+ */
+int patch_text_noflush(void *addr, const void *insns, size_t len)
+{
+	return patch_insn_write(addr, insns, len);
+}
+NOKPROBE_SYMBOL(patch_text_noflush);
+
 static int patch_text_cb(void *data)
 {
 	struct patch_insn *patch = data;
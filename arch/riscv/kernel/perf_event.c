@@ -31,6 +31,7 @@
 #include <linux/atomic.h>
 #include <linux/of.h>
 #include <asm/perf_event.h>
+#include <asm/sbi.h>
 
 static const struct riscv_pmu *riscv_pmu __read_mostly;
 static DEFINE_PER_CPU(struct cpu_hw_events, cpu_hw_events);
@@ -49,17 +50,55 @@ static const int riscv_hw_event_map[] = {
 	[PERF_COUNT_HW_BUS_CYCLES]		= RISCV_OP_UNSUPP,
 };
 
+/*
+ * SiFive U54 mhpmevent encoding: the event class sits in bits [7:0] and
+ * the events of that class to count are a mask in the bits above.
+ */
+#define U54_CLASS_COMMIT	0
+#define U54_CLASS_UARCH		1
+#define U54_CLASS_MEMORY	2
+#define U54_EVENT(class, mask)	(((mask) << 8) | (class))
+
+#define U54_LOADS		U54_EVENT(U54_CLASS_COMMIT, BIT(1) | BIT(11))
+#define U54_STORES		U54_EVENT(U54_CLASS_COMMIT, BIT(2) | BIT(12))
+#define U54_BRANCHES		U54_EVENT(U54_CLASS_COMMIT,		\
+					  BIT(6) | BIT(7) | BIT(8))
+#define U54_BRANCH_MISSES	U54_EVENT(U54_CLASS_UARCH, BIT(5) | BIT(6))
+#define U54_ICACHE_MISSES	U54_EVENT(U54_CLASS_MEMORY, BIT(0))
+#define U54_DCACHE_MISSES	U54_EVENT(U54_CLASS_MEMORY, BIT(1))
+#define U54_ITLB_MISSES		U54_EVENT(U54_CLASS_MEMORY, BIT(3))
+#define U54_DTLB_MISSES		U54_EVENT(U54_CLASS_MEMORY, BIT(4))
+
+/*
+ * Selectable events only exist behind the SBI PMU, the base PMU can
+ * count nothing but cycles and retired instructions.
+ */
+static const int riscv_u54_hw_event_map[] = {
+	[PERF_COUNT_HW_CPU_CYCLES]		= RISCV_PMU_CYCLE,
+	[PERF_COUNT_HW_INSTRUCTIONS]		= RISCV_PMU_INSTRET,
+	[PERF_COUNT_HW_CACHE_REFERENCES]	= U54_LOADS | U54_STORES,
+	[PERF_COUNT_HW_CACHE_MISSES]		= U54_DCACHE_MISSES,
+	[PERF_COUNT_HW_BRANCH_INSTRUCTIONS]	= U54_BRANCHES,
+	[PERF_COUNT_HW_BRANCH_MISSES]		= U54_BRANCH_MISSES,
+	[PERF_COUNT_HW_BUS_CYCLES]		= RISCV_OP_UNSUPP,
+};
+
+/*
+ * The U54 miss counters do not tell loads from stores, misses are
+ * reported as read misses only. The L2 sits outside the core and has
+ * no hpmcounter events.
+ */
 #define C(x) PERF_COUNT_HW_CACHE_##x
 static const int riscv_cache_event_map[PERF_COUNT_HW_CACHE_MAX]
 [PERF_COUNT_HW_CACHE_OP_MAX]
 [PERF_COUNT_HW_CACHE_RESULT_MAX] = {
 	[C(L1D)] = {
 		[C(OP_READ)] = {
-			[C(RESULT_ACCESS)] = RISCV_OP_UNSUPP,
-			[C(RESULT_MISS)] = RISCV_OP_UNSUPP,
+			[C(RESULT_ACCESS)] = U54_LOADS,
+			[C(RESULT_MISS)] = U54_DCACHE_MISSES,
 		},
 		[C(OP_WRITE)] = {
-			[C(RESULT_ACCESS)] = RISCV_OP_UNSUPP,
+			[C(RESULT_ACCESS)] = U54_STORES,
 			[C(RESULT_MISS)] = RISCV_OP_UNSUPP,
 		},
 		[C(OP_PREFETCH)] = {
@@ -70,7 +109,7 @@ static const int riscv_cache_event_map[PERF_COUNT_HW_CACHE_MAX]
 	[C(L1I)] = {
 		[C(OP_READ)] = {
 			[C(RESULT_ACCESS)] = RISCV_OP_UNSUPP,
-			[C(RESULT_MISS)] = RISCV_OP_UNSUPP,
+			[C(RESULT_MISS)] = U54_ICACHE_MISSES,
 		},
 		[C(OP_WRITE)] = {
 			[C(RESULT_ACCESS)] = RISCV_OP_UNSUPP,
@@ -98,7 +137,7 @@ static const int riscv_cache_event_map[PERF_COUNT_HW_CACHE_MAX]
 	[C(DTLB)] = {
 		[C(OP_READ)] = {
 			[C(RESULT_ACCESS)] =  RISCV_OP_UNSUPP,
-			[C(RESULT_MISS)] =  RISCV_OP_UNSUPP,
+			[C(RESULT_MISS)] =  U54_DTLB_MISSES,
 		},
 		[C(OP_WRITE)] = {
 			[C(RESULT_ACCESS)] = RISCV_OP_UNSUPP,
@@ -112,7 +151,7 @@ static const int riscv_cache_event_map[PERF_COUNT_HW_CACHE_MAX]
 	[C(ITLB)] = {
 		[C(OP_READ)] = {
 			[C(RESULT_ACCESS)] = RISCV_OP_UNSUPP,
-			[C(RESULT_MISS)] = RISCV_OP_UNSUPP,
+			[C(RESULT_MISS)] = U54_ITLB_MISSES,
 		},
 		[C(OP_WRITE)] = {
 			[C(RESULT_ACCESS)] = RISCV_OP_UNSUPP,
@@ -125,8 +164,8 @@ static const int riscv_cache_event_map[PERF_COUNT_HW_CACHE_MAX]
 	},
 	[C(BPU)] = {
 		[C(OP_READ)] = {
-			[C(RESULT_ACCESS)] = RISCV_OP_UNSUPP,
-			[C(RESULT_MISS)] = RISCV_OP_UNSUPP,
+			[C(RESULT_ACCESS)] = U54_BRANCHES,
+			[C(RESULT_MISS)] = U54_BRANCH_MISSES,
 		},
 		[C(OP_WRITE)] = {
 			[C(RESULT_ACCESS)] = RISCV_OP_UNSUPP,
@@ -150,7 +189,11 @@ static int riscv_map_hw_event(u64 config)
 static int riscv_map_cache_decode(u64 config, unsigned int *type,
 			   unsigned int *op, unsigned int *result)
 {
-	return -ENOENT;
+	*type = config & 0xff;
+	*op = (config >> 8) & 0xff;
+	*result = (config >> 16) & 0xff;
+
+	return 0;
 }
 
 static int riscv_map_cache_event(u64 config)
@@ -159,8 +202,11 @@ static int riscv_map_cache_event(u64 config)
 	int err = -ENOENT;
 		int code;
 
+	if (!riscv_pmu->cache_events)
+		return -ENOENT;
+
 	err = riscv_map_cache_decode(config, &type, &op, &result);
-	if (!riscv_pmu->cache_events || err)
+	if (err)
 		return err;
 
 	if (type >= PERF_COUNT_HW_CACHE_MAX ||
@@ -430,6 +476,289 @@ static int riscv_event_init(struct perf_event *event)
 	return 0;
 }
 
+#ifdef CONFIG_RISCV_SBI
+/*
+ * SBI PMU backend: the firmware owns mhpmevent, counters are picked and
+ * programmed through the SBI PMU extension and read back directly from
+ * the user counter CSRs it has delegated. The U54 has no counter overflow
+ * interrupt, so this PMU counts but cannot sample.
+ */
+
+static unsigned long riscv_sbi_ctr_info[RISCV_MAX_COUNTERS] __read_mostly;
+
+#define switchcase_csr_read(__csr_num, __val)		\
+	case __csr_num:					\
+		__val = csr_read(__csr_num);		\
+		break;
+#define switchcase_csr_read_2(__csr_num, __val)		\
+	switchcase_csr_read(__csr_num + 0, __val)	\
+	switchcase_csr_read(__csr_num + 1, __val)
+#define switchcase_csr_read_4(__csr_num, __val)		\
+	switchcase_csr_read_2(__csr_num + 0, __val)	\
+	switchcase_csr_read_2(__csr_num + 2, __val)
+#define switchcase_csr_read_8(__csr_num, __val)		\
+	switchcase_csr_read_4(__csr_num + 0, __val)	\
+	switchcase_csr_read_4(__csr_num + 4, __val)
+#define switchcase_csr_read_16(__csr_num, __val)	\
+	switchcase_csr_read_8(__csr_num + 0, __val)	\
+	switchcase_csr_read_8(__csr_num + 8, __val)
+#define switchcase_csr_read_32(__csr_num, __val)	\
+	switchcase_csr_read_16(__csr_num + 0, __val)	\
+	switchcase_csr_read_16(__csr_num + 16, __val)
+
+static unsigned long riscv_sbi_csr_read(int csr)
+{
+	unsigned long val = 0;
+
+	switch (csr) {
+	switchcase_csr_read_32(CSR_CYCLE, val)
+#ifndef CONFIG_64BIT
+	switchcase_csr_read_32(CSR_CYCLEH, val)
+#endif
+	default:
+		WARN_ON_ONCE(1);
+		break;
+	}
+
+	return val;
+}
+
+static u64 riscv_sbi_read_counter(int idx)
+{
+	unsigned long info = riscv_sbi_ctr_info[idx];
+	struct sbiret ret;
+	int csr;
+	u64 val;
+
+	if (info & SBI_PMU_CTR_INFO_TYPE_FW) {
+		ret = sbi_ecall(SBI_EXT_PMU, SBI_EXT_PMU_COUNTER_FW_READ,
+				idx, 0, 0, 0, 0, 0);
+		return ret.error ? 0 : ret.value;
+	}
+
+	csr = info & SBI_PMU_CTR_INFO_CSR_MASK;
+	val = riscv_sbi_csr_read(csr);
+#ifndef CONFIG_64BIT
+	val |= (u64)riscv_sbi_csr_read(csr + CSR_CYCLEH - CSR_CYCLE) << 32;
+#endif
+
+	return val;
+}
+
+static u64 riscv_sbi_counter_mask(int idx)
+{
+	unsigned long info = riscv_sbi_ctr_info[idx];
+	unsigned int width;
+
+	if (info & SBI_PMU_CTR_INFO_TYPE_FW)
+		return GENMASK_ULL(BITS_PER_LONG - 1, 0);
+
+	width = ((info >> SBI_PMU_CTR_INFO_WIDTH_SHIFT) &
+		 SBI_PMU_CTR_INFO_WIDTH_MASK) + 1;
+
+	return GENMASK_ULL(width - 1, 0);
+}
+
+static void riscv_sbi_pmu_read(struct perf_event *event)
+{
+	struct hw_perf_event *hwc = &event->hw;
+	u64 prev_raw_count, new_raw_count;
+	int idx = hwc->idx;
+
+	do {
+		prev_raw_count = local64_read(&hwc->prev_count);
+		new_raw_count = riscv_sbi_read_counter(idx);
+	} while (local64_cmpxchg(&hwc->prev_count, prev_raw_count,
+				 new_raw_count) != prev_raw_count);
+
+	local64_add((new_raw_count - prev_raw_count) &
+		    riscv_sbi_counter_mask(idx), &event->count);
+}
+
+static void riscv_sbi_pmu_stop(struct perf_event *event, int flags)
+{
+	struct hw_perf_event *hwc = &event->hw;
+
+	if (!(hwc->state & PERF_HES_STOPPED)) {
+		sbi_ecall(SBI_EXT_PMU, SBI_EXT_PMU_COUNTER_STOP,
+			  hwc->idx, 1, 0, 0, 0, 0);
+		hwc->state |= PERF_HES_STOPPED;
+	}
+
+	if ((flags & PERF_EF_UPDATE) && !(hwc->state & PERF_HES_UPTODATE)) {
+		riscv_sbi_pmu_read(event);
+		hwc->state |= PERF_HES_UPTODATE;
+	}
+}
+
+static void riscv_sbi_pmu_start(struct perf_event *event, int flags)
+{
+	struct hw_perf_event *hwc = &event->hw;
+
+	if (WARN_ON_ONCE(!(hwc->state & PERF_HES_STOPPED)))
+		return;
+
+	if (flags & PERF_EF_RELOAD)
+		WARN_ON_ONCE(!(hwc->state & PERF_HES_UPTODATE));
+
+	hwc->state = 0;
+
+	/* The counter keeps its value while stopped, count from there */
+	local64_set(&hwc->prev_count, riscv_sbi_read_counter(hwc->idx));
+	sbi_ecall(SBI_EXT_PMU, SBI_EXT_PMU_COUNTER_START,
+		  hwc->idx, 1, 0, 0, 0, 0);
+
+	perf_event_update_userpage(event);
+}
+
+static int riscv_sbi_pmu_add(struct perf_event *event, int flags)
+{
+	struct cpu_hw_events *cpuc = this_cpu_ptr(&cpu_hw_events);
+	struct hw_perf_event *hwc = &event->hw;
+	struct sbiret ret;
+
+	/* Let the firmware pick a counter able to count this event */
+	ret = sbi_ecall(SBI_EXT_PMU, SBI_EXT_PMU_COUNTER_CFG_MATCH, 0,
+			GENMASK(riscv_pmu->num_counters - 1, 0),
+			SBI_PMU_CFG_FLAG_CLEAR_VALUE, hwc->config_base,
+			hwc->config, 0);
+	if (ret.error)
+		return -ENOSPC;
+
+	if (WARN_ON_ONCE(ret.value >= riscv_pmu->num_counters)) {
+		sbi_ecall(SBI_EXT_PMU, SBI_EXT_PMU_COUNTER_STOP, ret.value, 1,
+			  SBI_PMU_STOP_FLAG_RESET, 0, 0, 0);
+		return -ENOSPC;
+	}
+
+	hwc->idx = ret.value;
+	cpuc->events[hwc->idx] = event;
+	cpuc->n_events++;
+
+	hwc->state = PERF_HES_UPTODATE | PERF_HES_STOPPED;
+
+	if (flags & PERF_EF_START)
+		riscv_sbi_pmu_start(event, PERF_EF_RELOAD);
+
+	perf_event_update_userpage(event);
+
+	return 0;
+}
+
+static void riscv_sbi_pmu_del(struct perf_event *event, int flags)
+{
+	struct cpu_hw_events *cpuc = this_cpu_ptr(&cpu_hw_events);
+	struct hw_perf_event *hwc = &event->hw;
+
+	riscv_sbi_pmu_stop(event, PERF_EF_UPDATE);
+
+	/* Hand the counter back to the firmware */
+	sbi_ecall(SBI_EXT_PMU, SBI_EXT_PMU_COUNTER_STOP, hwc->idx, 1,
+		  SBI_PMU_STOP_FLAG_RESET, 0, 0, 0);
+
+	cpuc->events[hwc->idx] = NULL;
+	cpuc->n_events--;
+	hwc->idx = -1;
+	perf_event_update_userpage(event);
+}
+
+static int riscv_sbi_event_init(struct perf_event *event)
+{
+	struct hw_perf_event *hwc = &event->hw;
+	int err;
+
+	/* Raw events are U54 mhpmevent values, handed over as they are */
+	if (event->attr.type == PERF_TYPE_RAW) {
+		hwc->config_base = SBI_PMU_EVENT_TYPE_RAW <<
+				   SBI_PMU_EVENT_IDX_TYPE_SHIFT;
+		hwc->config = event->attr.config;
+		hwc->idx = -1;
+		return 0;
+	}
+
+	err = riscv_event_init(event);
+	if (err)
+		return err;
+
+	switch (hwc->config) {
+	case RISCV_PMU_CYCLE:
+		hwc->config_base = SBI_PMU_HW_CPU_CYCLES;
+		hwc->config = 0;
+		break;
+	case RISCV_PMU_INSTRET:
+		hwc->config_base = SBI_PMU_HW_INSTRUCTIONS;
+		hwc->config = 0;
+		break;
+	default:
+		hwc->config_base = SBI_PMU_EVENT_TYPE_RAW <<
+				   SBI_PMU_EVENT_IDX_TYPE_SHIFT;
+		break;
+	}
+
+	return 0;
+}
+
+static struct pmu sbi_pmu = {
+	.name		= "riscv-sbi",
+	.capabilities	= PERF_PMU_CAP_NO_INTERRUPT,
+	.event_init	= riscv_sbi_event_init,
+	.add		= riscv_sbi_pmu_add,
+	.del		= riscv_sbi_pmu_del,
+	.start		= riscv_sbi_pmu_start,
+	.stop		= riscv_sbi_pmu_stop,
+	.read		= riscv_sbi_pmu_read,
+};
+
+static struct riscv_pmu riscv_sbi_pmu __read_mostly = {
+	.pmu = &sbi_pmu,
+	.max_events = ARRAY_SIZE(riscv_u54_hw_event_map),
+	.map_hw_event = riscv_map_hw_event,
+	.hw_events = riscv_u54_hw_event_map,
+	.map_cache_event = riscv_map_cache_event,
+	.cache_events = &riscv_cache_event_map,
+
+	/* Counter overflow does not raise an interrupt on the U54 */
+	.irq = -1,
+};
+
+static int __init riscv_sbi_pmu_init(void)
+{
+	struct sbiret ret;
+	int i, num;
+
+	if (sbi_probe_extension(SBI_EXT_PMU) <= 0)
+		return -ENODEV;
+
+	ret = sbi_ecall(SBI_EXT_PMU, SBI_EXT_PMU_NUM_COUNTERS,
+			0, 0, 0, 0, 0, 0);
+	if (ret.error || !ret.value)
+		return -ENODEV;
+
+	num = min_t(int, ret.value, RISCV_MAX_COUNTERS);
+	num = min_t(int, num, BITS_PER_LONG);
+
+	for (i = 0; i < num; i++) {
+		ret = sbi_ecall(SBI_EXT_PMU, SBI_EXT_PMU_COUNTER_GET_INFO,
+				i, 0, 0, 0, 0, 0);
+		if (ret.error)
+			return sbi_err_map_linux_errno(ret.error);
+		riscv_sbi_ctr_info[i] = ret.value;
+	}
+
+	riscv_sbi_pmu.num_counters = num;
+	riscv_pmu = &riscv_sbi_pmu;
+
+	pr_info("SBI PMU extension with %d counters\n", num);
+
+	return 0;
+}
+#else
+static inline int riscv_sbi_pmu_init(void)
+{
+	return -ENODEV;
+}
+#endif /* CONFIG_RISCV_SBI */
+
 /*
  * Initialization
  */
@@ -450,7 +779,7 @@ static const struct riscv_pmu riscv_base_pmu = {
 	.map_hw_event = riscv_map_hw_event,
 	.hw_events = riscv_hw_event_map,
 	.map_cache_event = riscv_map_cache_event,
-	.cache_events = &riscv_cache_event_map,
+	.cache_events = NULL,
 	.counter_width = 63,
 	.num_counters = RISCV_BASE_COUNTERS + 0,
 	.handle_irq = &riscv_base_pmu_handle_irq,
@@ -471,13 +800,14 @@ static int __init init_hw_perf_events(void)
 
 	riscv_pmu = &riscv_base_pmu;
 
-	if (node) {
+	/* Prefer the firmware PMU, it can count more than cycle and instret */
+	if (riscv_sbi_pmu_init() && node) {
 		of_id = of_match_node(riscv_pmu_of_ids, node);
 
 		if (of_id)
 			riscv_pmu = of_id->data;
-		of_node_put(node);
 	}
+	of_node_put(node);
 
 	perf_pmu_register(riscv_pmu->pmu, "cpu", PERF_TYPE_RAW);
 	return 0;
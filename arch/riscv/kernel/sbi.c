@@ -7,8 +7,11 @@
 
 #include <linux/init.h>
 #include <linux/pm.h>
+#include <asm/cacheflush.h>
+#include <asm/csr.h>
 #include <asm/sbi.h>
 #include <asm/smp.h>
+#include <asm/tlbflush.h>
 
 /* default SBI version is 0.1 */
 unsigned long sbi_spec_version = SBI_SPEC_VERSION_DEFAULT;
@@ -308,18 +311,48 @@ static int __sbi_rfence_v02_call(unsigned long fid, unsigned long hmask_val,
 	return result;
 }
 
+/*
+ * Run a fence asked of the calling hart itself without trapping to the
+ * firmware, which costs far more than the fence. Hypervisor fences are
+ * still left to the firmware.
+ *
+ * Return: true if the fence was done here.
+ */
+static bool __sbi_rfence_local(int fid, unsigned long start,
+			       unsigned long size)
+{
+	switch (fid) {
+	case SBI_EXT_RFENCE_REMOTE_FENCE_I:
+		local_flush_icache_all();
+		return true;
+	case SBI_EXT_RFENCE_REMOTE_SFENCE_VMA:
+	case SBI_EXT_RFENCE_REMOTE_SFENCE_VMA_ASID:
+		/* a size of -1 wraps around and flushes everything */
+		local_flush_tlb_range(start, start + size);
+		return true;
+	default:
+		return false;
+	}
+}
+
 static int __sbi_rfence_v02(int fid, const unsigned long *hart_mask,
 			    unsigned long start, unsigned long size,
 			    unsigned long arg4, unsigned long arg5)
 {
-	unsigned long hmask_val, hartid, hbase;
+	unsigned long hmask_val, hartid, hbase, self;
 	struct cpumask tmask;
-	int result;
+	int result = 0;
 
-	if (!hart_mask || !(*hart_mask)) {
+	if (!hart_mask || !(*hart_mask))
 		riscv_cpuid_to_hartid_mask(cpu_online_mask, &tmask);
-		hart_mask = cpumask_bits(&tmask);
-	}
+	else
+		bitmap_copy(cpumask_bits(&tmask), hart_mask, NR_CPUS);
+	hart_mask = cpumask_bits(&tmask);
+
+	self = cpuid_to_hartid_map(get_cpu());
+	if (self < NR_CPUS && test_bit(self, hart_mask) &&
+	    __sbi_rfence_local(fid, start, size))
+		__clear_bit(self, cpumask_bits(&tmask));
 
 	hmask_val = 0;
 	hbase = 0;
@@ -328,7 +361,7 @@ static int __sbi_rfence_v02(int fid, const unsigned long *hart_mask,
 			result = __sbi_rfence_v02_call(fid, hmask_val, hbase,
 						       start, size, arg4, arg5);
 			if (result)
-				return result;
+				goto out;
 			hmask_val = 0;
 			hbase = 0;
 		}
@@ -337,14 +370,13 @@ static int __sbi_rfence_v02(int fid, const unsigned long *hart_mask,
 		hmask_val |= 1UL << (hartid - hbase);
 	}
 
-	if (hmask_val) {
+	if (hmask_val)
 		result = __sbi_rfence_v02_call(fid, hmask_val, hbase,
 					       start, size, arg4, arg5);
-		if (result)
-			return result;
-	}
 
-	return 0;
+out:
+	put_cpu();
+	return result;
 }
 
 /**
@@ -547,13 +579,28 @@ static inline long sbi_get_firmware_version(void)
 	return __sbi_base_ecall(SBI_EXT_BASE_GET_IMP_VERSION);
 }
 
+/*
+ * An IPI to the calling hart only has to raise its own supervisor software
+ * interrupt, which needs no trap to the firmware. irq_work leans on such
+ * self IPIs.
+ */
 static void sbi_send_cpumask_ipi(const struct cpumask *target)
 {
-	struct cpumask hartid_mask;
+	struct cpumask hartid_mask, others;
+	int cpu = get_cpu();
 
-	riscv_cpuid_to_hartid_mask(target, &hartid_mask);
+	if (cpumask_test_cpu(cpu, target)) {
+		csr_set(CSR_IP, IE_SIE);
+		cpumask_andnot(&others, target, cpumask_of(cpu));
+		target = &others;
+	}
 
-	sbi_send_ipi(cpumask_bits(&hartid_mask));
+	/* an empty mask would mean every hart to the firmware */
+	if (!cpumask_empty(target)) {
+		riscv_cpuid_to_hartid_mask(target, &hartid_mask);
+		sbi_send_ipi(cpumask_bits(&hartid_mask));
+	}
+	put_cpu();
 }
 
 static struct riscv_ipi_ops sbi_ipi_ops = {
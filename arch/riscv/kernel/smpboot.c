@@ -23,6 +23,7 @@
 #include <linux/irq.h>
 #include <linux/of.h>
 #include <linux/sched/task_stack.h>
+#include <linux/sched/topology.h>
 #include <linux/sched/mm.h>
 #include <asm/cpu_ops.h>
 #include <asm/irq.h>
@@ -42,6 +43,44 @@ void __init smp_prepare_boot_cpu(void)
 	init_cpu_topology();
 }
 
+/*
+ * Harts behind the same last level cache, the L2 shared by the U54s on
+ * PolarFire, can swap tasks without these losing their working set. Tell
+ * them apart by the cache node that ends their next-level-cache chain.
+ */
+static void __init riscv_store_llc_id(unsigned int cpu)
+{
+	struct device_node *np, *next;
+
+	np = of_get_cpu_node(cpu, NULL);
+	if (!np)
+		return;
+
+	while ((next = of_find_next_cache_node(np))) {
+		cpu_topology[cpu].llc_id = next->phandle;
+		of_node_put(np);
+		np = next;
+	}
+	of_node_put(np);
+}
+
+#ifndef CONFIG_SCHED_MC
+/*
+ * Without SCHED_MC no level of the default topology is flagged as sharing
+ * a cache, so wakeups never look for an idle hart behind the same L2.
+ */
+static int riscv_llc_flags(void)
+{
+	return SD_SHARE_PKG_RESOURCES;
+}
+
+static struct sched_domain_topology_level riscv_topology[] = {
+	{ cpu_coregroup_mask, riscv_llc_flags, SD_INIT_NAME(MC) },
+	{ cpu_cpu_mask, SD_INIT_NAME(DIE) },
+	{ NULL, },
+};
+#endif
+
 void __init smp_prepare_cpus(unsigned int max_cpus)
 {
 	int cpuid;
@@ -52,6 +91,12 @@ void __init smp_prepare_cpus(unsigned int max_cpus)
 	numa_store_cpu_info(curr_cpuid);
 	numa_add_cpu(curr_cpuid);
 
+	for_each_possible_cpu(cpuid)
+		riscv_store_llc_id(cpuid);
+#ifndef CONFIG_SCHED_MC
+	set_sched_topology(riscv_topology);
+#endif
+
 	/* This covers non-smp usecase mandated by "nosmp" option */
 	if (max_cpus == 0)
 		return;
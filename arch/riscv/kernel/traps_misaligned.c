@@ -7,6 +7,10 @@
 #include <linux/mm.h>
 #include <linux/module.h>
 #include <linux/irq.h>
+#include <linux/perf_event.h>
+#include <linux/prctl.h>
+#include <linux/sched.h>
+#include <linux/uaccess.h>
 
 #include <asm/processor.h>
 #include <asm/ptrace.h>
@@ -231,19 +235,86 @@ static inline ulong get_insn(ulong mepc)
 	return val;
 }
 
-union reg_data {
-	u8 data_bytes[8];
-	ulong data_ulong;
-	u64 data_u64;
-};
+/*
+ * Misaligned accesses are counted as PERF_COUNT_SW_ALIGNMENT_FAULTS, so they
+ * can be counted per task or sampled by IP. A task that asked for
+ * PR_UNALIGN_SIGBUS gets the signal instead of the emulation.
+ */
+static bool misaligned_fixup_allowed(struct pt_regs *regs, unsigned long addr)
+{
+	perf_sw_event(PERF_COUNT_SW_ALIGNMENT_FAULTS, 1, regs, addr);
+
+	return !(user_mode(regs) &&
+		 (current->thread.align_ctl & PR_UNALIGN_SIGBUS));
+}
+
+/*
+ * Load len <= sizeof(ulong) bytes from a misaligned address using at most
+ * two aligned word loads. The second word is only touched when the access
+ * really crosses into it, so we never fault on a page the access itself
+ * does not cover.
+ */
+static unsigned long load_misaligned(unsigned long addr, int len)
+{
+	unsigned long off = addr & (sizeof(ulong) - 1);
+	const ulong *p = (const ulong *)(addr - off);
+	unsigned long val = load_ulong(p) >> (8 * off);
+
+	if (off + len > sizeof(ulong))
+		val |= load_ulong(p + 1) << (8 * (sizeof(ulong) - off));
+
+	if (len < sizeof(ulong))
+		val &= (1UL << (8 * len)) - 1;
+
+	return val;
+}
+
+/*
+ * Stores are split into the largest naturally aligned pieces instead of a
+ * read-modify-write of whole words, which would race with other harts
+ * writing the neighbouring bytes.
+ */
+static void store_misaligned(unsigned long addr, int len, u64 val)
+{
+	int n;
+
+	for (; len > 0; addr += n, len -= n, val >>= 8 * n) {
+		if ((addr & 1) || len < 2) {
+			store_u8((u8 *)addr, val);
+			n = 1;
+		} else if ((addr & 2) || len < 4) {
+			store_u16((u16 *)addr, val);
+			n = 2;
+		} else {
+			store_u32((u32 *)addr, val);
+			n = 4;
+		}
+	}
+}
+
+int set_unalign_ctl(struct task_struct *tsk, unsigned int val)
+{
+	if (val & ~(PR_UNALIGN_NOPRINT | PR_UNALIGN_SIGBUS))
+		return -EINVAL;
+
+	tsk->thread.align_ctl = val;
+	return 0;
+}
+
+int get_unalign_ctl(struct task_struct *tsk, unsigned long addr)
+{
+	return put_user(tsk->thread.align_ctl, (unsigned int __user *)addr);
+}
 
 int handle_misaligned_load(struct pt_regs *regs)
 {
-	union reg_data val;
 	unsigned long epc = regs->epc;
 	unsigned long insn = get_insn(epc);
 	unsigned long addr = csr_read(mtval);
-	int i, fp = 0, shift = 0, len = 0;
+	int fp = 0, shift = 0, len = 0;
+
+	if (!misaligned_fixup_allowed(regs, addr))
+		return -1;
 
 	regs->epc = 0;
 
@@ -307,13 +378,12 @@ int handle_misaligned_load(struct pt_regs *regs)
 		return -1;
 	}
 
-	val.data_u64 = 0;
-	for (i = 0; i < len; i++)
-		val.data_bytes[i] = load_u8((void *)(addr + i));
-
-	if (fp)
+	if (fp) {
+		regs->epc = epc;
 		return -1;
-	SET_RD(insn, regs, val.data_ulong << shift >> shift);
+	}
+
+	SET_RD(insn, regs, load_misaligned(addr, len) << shift >> shift);
 
 	regs->epc = epc + INSN_LEN(insn);
 
@@ -322,15 +392,18 @@ int handle_misaligned_load(struct pt_regs *regs)
 
 int handle_misaligned_store(struct pt_regs *regs)
 {
-	union reg_data val;
 	unsigned long epc = regs->epc;
 	unsigned long insn = get_insn(epc);
 	unsigned long addr = csr_read(mtval);
-	int i, len = 0;
+	unsigned long val;
+	int len = 0;
+
+	if (!misaligned_fixup_allowed(regs, addr))
+		return -1;
 
 	regs->epc = 0;
 
-	val.data_ulong = GET_RS2(insn, regs);
+	val = GET_RS2(insn, regs);
 
 	if ((insn & INSN_MASK_SW) == INSN_MATCH_SW) {
 		len = 4;
@@ -343,26 +416,25 @@ int handle_misaligned_store(struct pt_regs *regs)
 #if defined(CONFIG_64BIT)
 	} else if ((insn & INSN_MASK_C_SD) == INSN_MATCH_C_SD) {
 		len = 8;
-		val.data_ulong = GET_RS2S(insn, regs);
+		val = GET_RS2S(insn, regs);
 	} else if ((insn & INSN_MASK_C_SDSP) == INSN_MATCH_C_SDSP &&
 		   ((insn >> SH_RD) & 0x1f)) {
 		len = 8;
-		val.data_ulong = GET_RS2C(insn, regs);
+		val = GET_RS2C(insn, regs);
 #endif
 	} else if ((insn & INSN_MASK_C_SW) == INSN_MATCH_C_SW) {
 		len = 4;
-		val.data_ulong = GET_RS2S(insn, regs);
+		val = GET_RS2S(insn, regs);
 	} else if ((insn & INSN_MASK_C_SWSP) == INSN_MATCH_C_SWSP &&
 		   ((insn >> SH_RD) & 0x1f)) {
 		len = 4;
-		val.data_ulong = GET_RS2C(insn, regs);
+		val = GET_RS2C(insn, regs);
 	} else {
 		regs->epc = epc;
 		return -1;
 	}
 
-	for (i = 0; i < len; i++)
-		store_u8((void *)(addr + i), val.data_bytes[i]);
+	store_misaligned(addr, len, val);
 
 	regs->epc = epc + INSN_LEN(insn);
 
@@ -0,0 +1,106 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * CRC32 and CRC32C using the Zbc carry-less multiply instructions.
+ *
+ * Each XLEN bits of input are folded into the CRC with a Barrett reduction:
+ * two carry-less multiplies, by the quotient of x^(XLEN+32) / P and by P
+ * itself, replace the eight table lookups of the slice-by-8 code. Harts
+ * without Zbc keep using the generic lib/crc32.c implementation.
+ */
+
+#include <linux/crc32.h>
+#include <linux/crc32poly.h>
+#include <linux/init.h>
+#include <linux/jump_label.h>
+#include <linux/kernel.h>
+#include <asm/bitmanip.h>
+#include <asm/byteorder.h>
+#include <asm/hwcap.h>
+
+/* Quotients of x^96 / P in bit-reflected form, the x^64 term implied */
+#define CRC32_POLY_QT_LE	0x5a72d812fb808b20ULL
+#define CRC32C_POLY_QT_LE	0xa434f61c6f5389f8ULL
+
+#define STEP		sizeof(unsigned long)
+#define OFFSET_MASK	(STEP - 1)
+
+static DEFINE_STATIC_KEY_FALSE(crc32_zbc);
+
+/* Reduce the 64 bit value @s, already xor'ed with the CRC, to 32 bits */
+static inline u32 crc32_le_zbc(unsigned long s, u32 poly, unsigned long qt)
+{
+	unsigned long crc;
+
+	/* there is no clmulrh, so shift the clmul result into place */
+	crc = (riscv_clmul(s, qt) << 1) ^ s;
+
+	return riscv_clmulr(crc, (unsigned long)poly << 32) >> 32;
+}
+
+/* Fold fewer than STEP bytes, as if they were the top of a full word */
+static inline u32 crc32_le_unaligned(u32 crc, unsigned char const *p,
+				     size_t len, u32 poly, unsigned long qt)
+{
+	size_t bits = len * 8;
+	unsigned long s = 0;
+	u32 crc_low = 0;
+	size_t i;
+
+	for (i = 0; i < len; i++)
+		s = ((unsigned long)*p++ << (BITS_PER_LONG - 8)) | (s >> 8);
+
+	s ^= (unsigned long)crc << (BITS_PER_LONG - bits);
+	if (len < sizeof(u32))
+		crc_low = crc >> bits;
+
+	return crc32_le_zbc(s, poly, qt) ^ crc_low;
+}
+
+static inline u32 crc32_le_clmul(u32 crc, unsigned char const *p, size_t len,
+				 u32 poly, unsigned long qt)
+{
+	const unsigned long *p_ul;
+	size_t offset, head_len;
+
+	offset = (unsigned long)p & OFFSET_MASK;
+	if (offset && len) {
+		head_len = min(STEP - offset, len);
+		crc = crc32_le_unaligned(crc, p, head_len, poly, qt);
+		p += head_len;
+		len -= head_len;
+	}
+
+	for (p_ul = (const unsigned long *)p; len >= STEP; len -= STEP)
+		crc = crc32_le_zbc(crc ^ le64_to_cpu(*p_ul++), poly, qt);
+
+	if (len)
+		crc = crc32_le_unaligned(crc, (unsigned char const *)p_ul, len,
+					 poly, qt);
+
+	return crc;
+}
+
+u32 __pure crc32_le(u32 crc, unsigned char const *p, size_t len)
+{
+	if (!static_branch_likely(&crc32_zbc))
+		return crc32_le_base(crc, p, len);
+
+	return crc32_le_clmul(crc, p, len, CRC32_POLY_LE, CRC32_POLY_QT_LE);
+}
+
+u32 __pure __crc32c_le(u32 crc, unsigned char const *p, size_t len)
+{
+	if (!static_branch_likely(&crc32_zbc))
+		return __crc32c_le_base(crc, p, len);
+
+	return crc32_le_clmul(crc, p, len, CRC32C_POLY_LE, CRC32C_POLY_QT_LE);
+}
+
+static int __init crc32_zbc_init(void)
+{
+	if (riscv_isa_extension_available(NULL, zbc))
+		static_branch_enable(&crc32_zbc);
+
+	return 0;
+}
+early_initcall(crc32_zbc_init);
@@ -0,0 +1,81 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * Word-at-a-time string routines.
+ *
+ * Both routines only ever load naturally aligned words, so a load never
+ * crosses into a page the string itself does not touch, and the core never
+ * takes a misaligned access trap.
+ */
+
+#include <linux/compiler.h>
+#include <linux/export.h>
+#include <linux/string.h>
+#include <asm/word-at-a-time.h>
+
+#define WORD_MASK	(sizeof(unsigned long) - 1)
+
+size_t strlen(const char *s)
+{
+	const struct word_at_a_time constants = WORD_AT_A_TIME_CONSTANTS;
+	unsigned long align = (unsigned long)s & WORD_MASK;
+	const char *p = s - align;
+	unsigned long val, data;
+
+	/* Force the bytes in front of the string to be non-zero */
+	val = read_word_at_a_time(p) | ((1UL << (8 * align)) - 1);
+
+	while (!has_zero(val, &data, &constants)) {
+		p += sizeof(unsigned long);
+		val = read_word_at_a_time(p);
+	}
+
+	data = prep_zero_mask(val, data, &constants);
+	data = create_zero_mask(data);
+
+	return p - s + find_zero(data);
+}
+EXPORT_SYMBOL(strlen);
+
+int strcmp(const char *cs, const char *ct)
+{
+	const struct word_at_a_time constants = WORD_AT_A_TIME_CONSTANTS;
+	unsigned char c1, c2;
+
+	/*
+	 * Compare whole words only when both strings can be aligned at the
+	 * same time. The word that differs or holds the terminator is then
+	 * resolved by the byte loop below.
+	 */
+	if (!(((unsigned long)cs ^ (unsigned long)ct) & WORD_MASK)) {
+		unsigned long a, b, data;
+
+		while ((unsigned long)cs & WORD_MASK) {
+			c1 = *cs++;
+			c2 = *ct++;
+			if (c1 != c2)
+				return c1 < c2 ? -1 : 1;
+			if (!c1)
+				return 0;
+		}
+
+		for (;;) {
+			a = read_word_at_a_time(cs);
+			b = read_word_at_a_time(ct);
+			if (a != b || has_zero(a, &data, &constants))
+				break;
+			cs += sizeof(unsigned long);
+			ct += sizeof(unsigned long);
+		}
+	}
+
+	while (1) {
+		c1 = *cs++;
+		c2 = *ct++;
+		if (c1 != c2)
+			return c1 < c2 ? -1 : 1;
+		if (!c1)
+			break;
+	}
+	return 0;
+}
+EXPORT_SYMBOL(strcmp);
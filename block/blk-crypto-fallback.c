@@ -14,11 +14,13 @@
 #include <linux/blk-crypto.h>
 #include <linux/blkdev.h>
 #include <linux/crypto.h>
+#include <linux/debugfs.h>
 #include <linux/keyslot-manager.h>
 #include <linux/mempool.h>
 #include <linux/module.h>
 #include <linux/random.h>
 
+#include "blk.h"
 #include "blk-crypto-internal.h"
 
 static unsigned int num_prealloc_bounce_pg = 32;
@@ -36,6 +38,11 @@ module_param(num_prealloc_fallback_crypt_ctxs, uint, 0);
 MODULE_PARM_DESC(num_prealloc_crypt_fallback_ctxs,
 		 "Number of preallocated bio fallback crypto contexts for blk-crypto to use during crypto API fallback");
 
+static unsigned int max_inflight_units = 16;
+module_param(max_inflight_units, uint, 0);
+MODULE_PARM_DESC(max_inflight_units,
+		 "Number of data units per bio kept in flight when the crypto API fallback uses an asynchronous cipher");
+
 struct bio_fallback_crypt_ctx {
 	struct bio_crypt_ctx crypt_ctx;
 	/*
@@ -72,9 +79,21 @@ static mempool_t *bio_fallback_crypt_ctx_pool;
 static DEFINE_MUTEX(tfms_init_lock);
 static bool tfms_inited[BLK_ENCRYPTION_MODE_MAX];
 
+/*
+ * Per-keyslot usage counters, indexed by READ (decryption) and WRITE
+ * (encryption), and reported through debugfs.  nsecs is the time spent in the
+ * crypto API, including waiting for asynchronous ciphers.
+ */
+struct blk_crypto_fallback_stats {
+	atomic64_t units[2];
+	atomic64_t bytes[2];
+	atomic64_t nsecs[2];
+};
+
 static struct blk_crypto_keyslot {
 	enum blk_crypto_mode_num crypto_mode;
 	struct crypto_skcipher *tfms[BLK_ENCRYPTION_MODE_MAX];
+	struct blk_crypto_fallback_stats stats;
 } *blk_crypto_keyslots;
 
 static struct blk_keyslot_manager blk_crypto_ksm;
@@ -186,29 +205,6 @@ static struct bio *blk_crypto_clone_bio(struct bio *bio_src)
 	return bio;
 }
 
-static bool blk_crypto_alloc_cipher_req(struct blk_ksm_keyslot *slot,
-					struct skcipher_request **ciph_req_ret,
-					struct crypto_wait *wait)
-{
-	struct skcipher_request *ciph_req;
-	const struct blk_crypto_keyslot *slotp;
-	int keyslot_idx = blk_ksm_get_slot_idx(slot);
-
-	slotp = &blk_crypto_keyslots[keyslot_idx];
-	ciph_req = skcipher_request_alloc(slotp->tfms[slotp->crypto_mode],
-					  GFP_NOIO);
-	if (!ciph_req)
-		return false;
-
-	skcipher_request_set_callback(ciph_req,
-				      CRYPTO_TFM_REQ_MAY_BACKLOG |
-				      CRYPTO_TFM_REQ_MAY_SLEEP,
-				      crypto_req_done, wait);
-	*ciph_req_ret = ciph_req;
-
-	return true;
-}
-
 static bool blk_crypto_split_bio_if_needed(struct bio **bio_ptr)
 {
 	struct bio *bio = *bio_ptr;
@@ -253,6 +249,145 @@ static void blk_crypto_dun_to_iv(const u64 dun[BLK_CRYPTO_DUN_ARRAY_SIZE],
 		iv->dun[i] = cpu_to_le64(dun[i]);
 }
 
+/*
+ * A data unit being en/decrypted.  Synchronous ciphers only ever use one of
+ * these per bio; asynchronous ones (e.g. hardware crypto engines) get up to
+ * max_inflight_units of them, so that the engine is kept busy instead of
+ * waiting for each data unit in turn.
+ */
+struct blk_crypto_fallback_unit {
+	struct skcipher_request *req;
+	struct crypto_wait wait;
+	struct scatterlist src, dst;
+	union blk_crypto_iv iv;
+	int err;
+};
+
+struct blk_crypto_fallback_batch {
+	struct blk_crypto_keyslot *slotp;
+	unsigned int nr_units;
+	unsigned int next;
+	struct blk_crypto_fallback_unit units[];
+};
+
+static void blk_crypto_fallback_free_batch(struct blk_crypto_fallback_batch *batch)
+{
+	unsigned int i;
+
+	for (i = 0; i < batch->nr_units; i++)
+		skcipher_request_free(batch->units[i].req);
+	kfree(batch);
+}
+
+static struct blk_crypto_fallback_batch *
+blk_crypto_fallback_alloc_batch(struct blk_ksm_keyslot *slot)
+{
+	struct blk_crypto_keyslot *slotp =
+		&blk_crypto_keyslots[blk_ksm_get_slot_idx(slot)];
+	struct crypto_skcipher *tfm = slotp->tfms[slotp->crypto_mode];
+	struct blk_crypto_fallback_batch *batch;
+	unsigned int nr_units = 1;
+	unsigned int i;
+
+	if (crypto_skcipher_alg(tfm)->base.cra_flags & CRYPTO_ALG_ASYNC)
+		nr_units = max(1U, max_inflight_units);
+
+	batch = kzalloc(struct_size(batch, units, nr_units), GFP_NOIO);
+	if (!batch)
+		return NULL;
+	batch->slotp = slotp;
+	batch->nr_units = nr_units;
+
+	for (i = 0; i < nr_units; i++) {
+		struct blk_crypto_fallback_unit *unit = &batch->units[i];
+
+		unit->req = skcipher_request_alloc(tfm, GFP_NOIO);
+		if (!unit->req) {
+			blk_crypto_fallback_free_batch(batch);
+			return NULL;
+		}
+		crypto_init_wait(&unit->wait);
+		sg_init_table(&unit->src, 1);
+		sg_init_table(&unit->dst, 1);
+		skcipher_request_set_callback(unit->req,
+					      CRYPTO_TFM_REQ_MAY_BACKLOG |
+					      CRYPTO_TFM_REQ_MAY_SLEEP,
+					      crypto_req_done, &unit->wait);
+	}
+
+	return batch;
+}
+
+/* Wait for all data units in flight, returning the first error if any. */
+static int blk_crypto_fallback_wait_batch(struct blk_crypto_fallback_batch *batch)
+{
+	unsigned int i;
+	int ret = 0;
+
+	for (i = 0; i < batch->nr_units; i++) {
+		struct blk_crypto_fallback_unit *unit = &batch->units[i];
+		int err = crypto_wait_req(unit->err, &unit->wait);
+
+		unit->err = 0;
+		if (err && !ret)
+			ret = err;
+	}
+
+	return ret;
+}
+
+/*
+ * Start en/decrypting one data unit from @src_page to @dst_page, reusing the
+ * oldest unit of the batch once it has completed.
+ */
+static int blk_crypto_fallback_queue_unit(struct blk_crypto_fallback_batch *batch,
+					  struct page *src_page,
+					  struct page *dst_page,
+					  unsigned int offset,
+					  unsigned int data_unit_size,
+					  const u64 dun[BLK_CRYPTO_DUN_ARRAY_SIZE],
+					  bool encrypt)
+{
+	struct blk_crypto_fallback_unit *unit = &batch->units[batch->next];
+	int err;
+
+	err = crypto_wait_req(unit->err, &unit->wait);
+	unit->err = 0;
+	if (err)
+		return err;
+
+	if (++batch->next == batch->nr_units)
+		batch->next = 0;
+
+	blk_crypto_dun_to_iv(dun, &unit->iv);
+	sg_set_page(&unit->src, src_page, data_unit_size, offset);
+	sg_set_page(&unit->dst, dst_page, data_unit_size, offset);
+	skcipher_request_set_crypt(unit->req, &unit->src, &unit->dst,
+				   data_unit_size, unit->iv.bytes);
+
+	if (encrypt)
+		err = crypto_skcipher_encrypt(unit->req);
+	else
+		err = crypto_skcipher_decrypt(unit->req);
+	if (err == -EINPROGRESS || err == -EBUSY) {
+		unit->err = err;
+		err = 0;
+	}
+
+	return err;
+}
+
+static void blk_crypto_fallback_account(struct blk_crypto_keyslot *slotp,
+					int rw, unsigned int units,
+					unsigned int data_unit_size, u64 start)
+{
+	struct blk_crypto_fallback_stats *stats = &slotp->stats;
+
+	atomic64_add(units, &stats->units[rw]);
+	atomic64_add((u64)units * data_unit_size, &stats->bytes[rw]);
+	atomic64_add(ktime_get_ns() - start, &stats->nsecs[rw]);
+}
+
 /*
  * The crypto API fallback's encryption routine.
  * Allocate a bounce bio for encryption, encrypt the input bio using crypto API,
@@ -266,14 +401,12 @@ static bool blk_crypto_fallback_encrypt_bio(struct bio **bio_ptr)
 	struct bio_crypt_ctx *bc;
 	struct blk_ksm_keyslot *slot;
 	int data_unit_size;
-	struct skcipher_request *ciph_req = NULL;
-	DECLARE_CRYPTO_WAIT(wait);
+	struct blk_crypto_fallback_batch *batch;
 	u64 curr_dun[BLK_CRYPTO_DUN_ARRAY_SIZE];
-	struct scatterlist src, dst;
-	union blk_crypto_iv iv;
-	unsigned int i, j;
+	unsigned int i, j, nr_units = 0;
 	bool ret = false;
 	blk_status_t blk_st;
+	u64 start;
 
 	/* Split the bio if it's too big for single page bvec */
 	if (!blk_crypto_split_bio_if_needed(bio_ptr))
@@ -300,18 +433,15 @@ static bool blk_crypto_fallback_encrypt_bio(struct bio **bio_ptr)
 		goto out_put_enc_bio;
 	}
 
-	/* and then allocate an skcipher_request for it */
-	if (!blk_crypto_alloc_cipher_req(slot, &ciph_req, &wait)) {
+	/* and then allocate the skcipher_requests for it */
+	batch = blk_crypto_fallback_alloc_batch(slot);
+	if (!batch) {
 		src_bio->bi_status = BLK_STS_RESOURCE;
 		goto out_release_keyslot;
 	}
 
 	memcpy(curr_dun, bc->bc_dun, sizeof(curr_dun));
-	sg_init_table(&src, 1);
-	sg_init_table(&dst, 1);
-
-	skcipher_request_set_crypt(ciph_req, &src, &dst, data_unit_size,
-				   iv.bytes);
+	start = ktime_get_ns();
 
 	/* Encrypt each page in the bounce bio */
 	for (i = 0; i < enc_bio->bi_vcnt; i++) {
@@ -327,40 +457,44 @@ static bool blk_crypto_fallback_encrypt_bio(struct bio **bio_ptr)
 			goto out_free_bounce_pages;
 		}
 
-		sg_set_page(&src, plaintext_page, data_unit_size,
-			    enc_bvec->bv_offset);
-		sg_set_page(&dst, ciphertext_page, data_unit_size,
-			    enc_bvec->bv_offset);
-
 		/* Encrypt each data unit in this page */
 		for (j = 0; j < enc_bvec->bv_len; j += data_unit_size) {
-			blk_crypto_dun_to_iv(curr_dun, &iv);
-			if (crypto_wait_req(crypto_skcipher_encrypt(ciph_req),
-					    &wait)) {
+			if (blk_crypto_fallback_queue_unit(batch,
+					plaintext_page, ciphertext_page,
+					enc_bvec->bv_offset + j,
+					data_unit_size, curr_dun, true)) {
 				i++;
 				src_bio->bi_status = BLK_STS_IOERR;
 				goto out_free_bounce_pages;
 			}
 			bio_crypt_dun_increment(curr_dun, 1);
-			src.offset += data_unit_size;
-			dst.offset += data_unit_size;
+			nr_units++;
 		}
 	}
 
+	if (blk_crypto_fallback_wait_batch(batch)) {
+		src_bio->bi_status = BLK_STS_IOERR;
+		goto out_free_bounce_pages;
+	}
+	blk_crypto_fallback_account(batch->slotp, WRITE, nr_units,
+				    data_unit_size, start);
+
 	enc_bio->bi_private = src_bio;
 	enc_bio->bi_end_io = blk_crypto_fallback_encrypt_endio;
 	*bio_ptr = enc_bio;
 	ret = true;
 
 	enc_bio = NULL;
-	goto out_free_ciph_req;
+	goto out_free_batch;
 
 out_free_bounce_pages:
+	/* Don't free pages that an asynchronous cipher may still write to */
+	blk_crypto_fallback_wait_batch(batch);
 	while (i > 0)
 		mempool_free(enc_bio->bi_io_vec[--i].bv_page,
 			     blk_crypto_bounce_page_pool);
-out_free_ciph_req:
-	skcipher_request_free(ciph_req);
+out_free_batch:
+	blk_crypto_fallback_free_batch(batch);
 out_release_keyslot:
 	blk_ksm_put_slot(slot);
 out_put_enc_bio:
@@ -381,16 +515,14 @@ static void blk_crypto_fallback_decrypt_bio(struct work_struct *work)
 	struct bio *bio = f_ctx->bio;
 	struct bio_crypt_ctx *bc = &f_ctx->crypt_ctx;
 	struct blk_ksm_keyslot *slot;
-	struct skcipher_request *ciph_req = NULL;
-	DECLARE_CRYPTO_WAIT(wait);
+	struct blk_crypto_fallback_batch *batch;
 	u64 curr_dun[BLK_CRYPTO_DUN_ARRAY_SIZE];
-	union blk_crypto_iv iv;
-	struct scatterlist sg;
 	struct bio_vec bv;
 	struct bvec_iter iter;
 	const int data_unit_size = bc->bc_key->crypto_cfg.data_unit_size;
-	unsigned int i;
+	unsigned int i, nr_units = 0;
 	blk_status_t blk_st;
+	u64 start;
 
 	/*
 	 * Use the crypto API fallback keyslot manager to get a crypto_skcipher
@@ -402,38 +534,41 @@ static void blk_crypto_fallback_decrypt_bio(struct work_struct *work)
 		goto out_no_keyslot;
 	}
 
-	/* and then allocate an skcipher_request for it */
-	if (!blk_crypto_alloc_cipher_req(slot, &ciph_req, &wait)) {
+	/* and then allocate the skcipher_requests for it */
+	batch = blk_crypto_fallback_alloc_batch(slot);
+	if (!batch) {
 		bio->bi_status = BLK_STS_RESOURCE;
-		goto out;
+		goto out_release_keyslot;
 	}
 
 	memcpy(curr_dun, bc->bc_dun, sizeof(curr_dun));
-	sg_init_table(&sg, 1);
-	skcipher_request_set_crypt(ciph_req, &sg, &sg, data_unit_size,
-				   iv.bytes);
+	start = ktime_get_ns();
 
 	/* Decrypt each segment in the bio */
 	__bio_for_each_segment(bv, bio, iter, f_ctx->crypt_iter) {
 		struct page *page = bv.bv_page;
 
-		sg_set_page(&sg, page, data_unit_size, bv.bv_offset);
-
 		/* Decrypt each data unit in the segment */
 		for (i = 0; i < bv.bv_len; i += data_unit_size) {
-			blk_crypto_dun_to_iv(curr_dun, &iv);
-			if (crypto_wait_req(crypto_skcipher_decrypt(ciph_req),
-					    &wait)) {
+			if (blk_crypto_fallback_queue_unit(batch, page, page,
+					bv.bv_offset + i, data_unit_size,
+					curr_dun, false)) {
 				bio->bi_status = BLK_STS_IOERR;
 				goto out;
 			}
 			bio_crypt_dun_increment(curr_dun, 1);
-			sg.offset += data_unit_size;
+			nr_units++;
 		}
 	}
 
 out:
-	skcipher_request_free(ciph_req);
+	if (blk_crypto_fallback_wait_batch(batch))
+		bio->bi_status = BLK_STS_IOERR;
+	else if (!bio->bi_status)
+		blk_crypto_fallback_account(batch->slotp, READ, nr_units,
+					    data_unit_size, start);
+	blk_crypto_fallback_free_batch(batch);
+out_release_keyslot:
 	blk_ksm_put_slot(slot);
 out_no_keyslot:
 	mempool_free(f_ctx, bio_fallback_crypt_ctx_pool);
@@ -529,6 +664,37 @@ int blk_crypto_fallback_evict_key(const struct blk_crypto_key *key)
 	return blk_ksm_evict_key(&blk_crypto_ksm, key);
 }
 
+/*
+ * One line per keyslot that has been used, with the number of data units,
+ * bytes and microseconds spent on encryption and decryption.
+ */
+static int blk_crypto_fallback_stats_show(struct seq_file *m, void *v)
+{
+	unsigned int i;
+
+	for (i = 0; i < blk_crypto_num_keyslots; i++) {
+		const struct blk_crypto_fallback_stats *stats =
+			&blk_crypto_keyslots[i].stats;
+		u64 enc_units = atomic64_read(&stats->units[WRITE]);
+		u64 dec_units = atomic64_read(&stats->units[READ]);
+
+		if (!enc_units && !dec_units)
+			continue;
+
+		seq_printf(m, "%u: mode=%d enc_units=%llu enc_bytes=%llu enc_usecs=%llu dec_units=%llu dec_bytes=%llu dec_usecs=%llu\n",
+			   i, blk_crypto_keyslots[i].crypto_mode,
+			   enc_units, atomic64_read(&stats->bytes[WRITE]),
+			   div_u64(atomic64_read(&stats->nsecs[WRITE]),
+				   NSEC_PER_USEC),
+			   dec_units, atomic64_read(&stats->bytes[READ]),
+			   div_u64(atomic64_read(&stats->nsecs[READ]),
+				   NSEC_PER_USEC));
+	}
+
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(blk_crypto_fallback_stats);
+
 static bool blk_crypto_fallback_inited;
 static int blk_crypto_fallback_init(void)
 {
@@ -584,6 +750,9 @@ static int blk_crypto_fallback_init(void)
 	if (!bio_fallback_crypt_ctx_pool)
 		goto fail_free_crypt_ctx_cache;
 
+	debugfs_create_file("crypto_fallback_keyslots", 0400, blk_debugfs_root,
+			    NULL, &blk_crypto_fallback_stats_fops);
+
 	blk_crypto_fallback_inited = true;
 
 	return 0;
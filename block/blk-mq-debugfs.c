@@ -32,10 +32,12 @@ static int queue_poll_stat_show(void *data, struct seq_file *m)
 	for (bucket = 0; bucket < (BLK_MQ_POLL_STATS_BKTS / 2); bucket++) {
 		seq_printf(m, "read  (%d Bytes): ", 1 << (9 + bucket));
 		print_stat(m, &q->poll_stat[2 * bucket]);
+		seq_printf(m, ", sleep=%u", q->poll_pct_nsec[2 * bucket]);
 		seq_puts(m, "\n");
 
 		seq_printf(m, "write (%d Bytes): ",  1 << (9 + bucket));
 		print_stat(m, &q->poll_stat[2 * bucket + 1]);
+		seq_printf(m, ", sleep=%u", q->poll_pct_nsec[2 * bucket + 1]);
 		seq_puts(m, "\n");
 	}
 	return 0;
@@ -535,6 +537,8 @@ static int hctx_io_poll_show(void *data, struct seq_file *m)
 	seq_printf(m, "considered=%lu\n", hctx->poll_considered);
 	seq_printf(m, "invoked=%lu\n", hctx->poll_invoked);
 	seq_printf(m, "success=%lu\n", hctx->poll_success);
+	seq_printf(m, "slept=%lu\n", hctx->poll_slept);
+	seq_printf(m, "overslept=%lu\n", hctx->poll_overslept);
 	return 0;
 }
 
@@ -544,9 +548,35 @@ static ssize_t hctx_io_poll_write(void *data, const char __user *buf,
 	struct blk_mq_hw_ctx *hctx = data;
 
 	hctx->poll_considered = hctx->poll_invoked = hctx->poll_success = 0;
+	hctx->poll_slept = hctx->poll_overslept = 0;
 	return count;
 }
 
+static void print_poll_hist(struct seq_file *m, const unsigned int *hist)
+{
+	int slot;
+
+	for (slot = 0; slot < BLK_MQ_POLL_HIST_SLOTS; slot++)
+		seq_printf(m, "%s%u", slot ? " " : "", hist[slot]);
+}
+
+static int hctx_poll_hist_show(void *data, struct seq_file *m)
+{
+	struct blk_mq_hw_ctx *hctx = data;
+	int bucket;
+
+	for (bucket = 0; bucket < (BLK_MQ_POLL_STATS_BKTS / 2); bucket++) {
+		seq_printf(m, "read  (%d Bytes): ", 1 << (9 + bucket));
+		print_poll_hist(m, hctx->poll_hist[2 * bucket]);
+		seq_puts(m, "\n");
+
+		seq_printf(m, "write (%d Bytes): ",  1 << (9 + bucket));
+		print_poll_hist(m, hctx->poll_hist[2 * bucket + 1]);
+		seq_puts(m, "\n");
+	}
+	return 0;
+}
+
 static int hctx_dispatched_show(void *data, struct seq_file *m)
 {
 	struct blk_mq_hw_ctx *hctx = data;
@@ -789,6 +819,7 @@ static const struct blk_mq_debugfs_attr blk_mq_debugfs_hctx_attrs[] = {
 	{"sched_tags", 0400, hctx_sched_tags_show},
 	{"sched_tags_bitmap", 0400, hctx_sched_tags_bitmap_show},
 	{"io_poll", 0600, hctx_io_poll_show, hctx_io_poll_write},
+	{"poll_hist", 0400, hctx_poll_hist_show},
 	{"dispatched", 0600, hctx_dispatched_show, hctx_dispatched_write},
 	{"queued", 0600, hctx_queued_show, hctx_queued_write},
 	{"run", 0600, hctx_run_show, hctx_run_write},
@@ -178,6 +178,37 @@ unsigned int blk_mq_get_tag(struct blk_mq_alloc_data *data)
 	return tag + tag_offset;
 }
 
+/*
+ * Grab up to @nr_tags driver tags from one bitmap word at once, for the
+ * per-plug request cache.  Only plain allocations, without a scheduler,
+ * depth limit, reserved pool or shared-tag fairness, are batched.
+ */
+unsigned long blk_mq_get_tags(struct blk_mq_alloc_data *data, int nr_tags,
+			      unsigned int *offset)
+{
+	struct blk_mq_tags *tags = blk_mq_tags_from_data(data);
+	unsigned long mask;
+	unsigned int i;
+
+	if (data->q->elevator || data->shallow_depth ||
+	    (data->flags & BLK_MQ_REQ_RESERVED) ||
+	    (data->hctx->flags & BLK_MQ_F_TAG_QUEUE_SHARED))
+		return 0;
+
+	mask = __sbitmap_queue_get_batch(tags->bitmap_tags, nr_tags, offset);
+	if (!mask)
+		return 0;
+	*offset += tags->nr_reserved_tags;
+
+	/* As above, an inactive hctx makes the caller retry elsewhere */
+	if (unlikely(test_bit(BLK_MQ_S_INACTIVE, &data->hctx->state))) {
+		for_each_set_bit(i, &mask, BITS_PER_LONG)
+			blk_mq_put_tag(tags, data->ctx, *offset + i);
+		return 0;
+	}
+	return mask;
+}
+
 void blk_mq_put_tag(struct blk_mq_tags *tags, struct blk_mq_ctx *ctx,
 		    unsigned int tag)
 {
@@ -192,6 +223,13 @@ void blk_mq_put_tag(struct blk_mq_tags *tags, struct blk_mq_ctx *ctx,
 	}
 }
 
+/* Free non-reserved driver tags in bulk, see blk_mq_end_request_batch() */
+void blk_mq_put_tags(struct blk_mq_tags *tags, int *tag_array, int nr_tags)
+{
+	sbitmap_queue_clear_batch(tags->bitmap_tags, tags->nr_reserved_tags,
+				  tag_array, nr_tags);
+}
+
 struct bt_iter_data {
 	struct blk_mq_hw_ctx *hctx;
 	busy_iter_fn *fn;
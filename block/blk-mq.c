@@ -45,6 +45,7 @@ static DEFINE_PER_CPU(struct llist_head, blk_cpu_done);
 
 static void blk_mq_poll_stats_start(struct request_queue *q);
 static void blk_mq_poll_stats_fn(struct blk_stat_callback *cb);
+static void blk_mq_poll_hist_add(struct request *rq, u64 now);
 
 static int blk_mq_poll_stats_bkt(const struct request *rq)
 {
@@ -278,9 +279,10 @@ static struct request *blk_mq_rq_ctx_init(struct blk_mq_alloc_data *data,
 		unsigned int tag, u64 alloc_time_ns)
 {
 	struct blk_mq_tags *tags = blk_mq_tags_from_data(data);
+	struct elevator_queue *e = data->q->elevator;
 	struct request *rq = tags->static_rqs[tag];
 
-	if (data->q->elevator) {
+	if (e) {
 		rq->tag = BLK_MQ_NO_TAG;
 		rq->internal_tag = tag;
 	} else {
@@ -299,8 +301,6 @@ static struct request *blk_mq_rq_ctx_init(struct blk_mq_alloc_data *data,
 	if (blk_queue_io_stat(data->q))
 		rq->rq_flags |= RQF_IO_STAT;
 	INIT_LIST_HEAD(&rq->queuelist);
-	INIT_HLIST_NODE(&rq->hash);
-	RB_CLEAR_NODE(&rq->rb_node);
 	rq->rq_disk = NULL;
 	rq->part = NULL;
 #ifdef CONFIG_BLK_RQ_ALLOC_TIME
@@ -328,11 +328,13 @@ static struct request *blk_mq_rq_ctx_init(struct blk_mq_alloc_data *data,
 	data->ctx->rq_dispatched[op_is_sync(data->cmd_flags)]++;
 	refcount_set(&rq->ref, 1);
 
-	if (!op_is_flush(data->cmd_flags)) {
-		struct elevator_queue *e = data->q->elevator;
-
+	/* Only the elevator looks at the merge hash and rb node */
+	if (e) {
+		INIT_HLIST_NODE(&rq->hash);
+		RB_CLEAR_NODE(&rq->rb_node);
 		rq->elv.icq = NULL;
-		if (e && e->type->ops.prepare_request) {
+		if (!op_is_flush(data->cmd_flags) &&
+		    e->type->ops.prepare_request) {
 			if (e->type->icq_cache)
 				blk_mq_sched_assign_ioc(rq);
 
@@ -345,6 +347,36 @@ static struct request *blk_mq_rq_ctx_init(struct blk_mq_alloc_data *data,
 	return rq;
 }
 
+/*
+ * Allocate up to data->nr_tags requests with one tag bitmap operation.  The
+ * first one is returned, the rest are parked on data->cached_rq, each holding
+ * its own queue usage reference like the caller's.
+ */
+static struct request *__blk_mq_alloc_requests_batch(
+		struct blk_mq_alloc_data *data, u64 alloc_time_ns)
+{
+	unsigned long tag_mask;
+	unsigned int tag_offset, i;
+	struct request *rq;
+	int nr = 0;
+
+	tag_mask = blk_mq_get_tags(data, data->nr_tags, &tag_offset);
+	if (unlikely(!tag_mask))
+		return NULL;
+
+	for_each_set_bit(i, &tag_mask, BITS_PER_LONG) {
+		rq = blk_mq_rq_ctx_init(data, tag_offset + i, alloc_time_ns);
+		list_add_tail(&rq->queuelist, data->cached_rq);
+		nr++;
+	}
+	if (nr > 1)
+		percpu_ref_get_many(&data->q->q_usage_counter, nr - 1);
+
+	rq = list_first_entry(data->cached_rq, struct request, queuelist);
+	list_del_init(&rq->queuelist);
+	return rq;
+}
+
 static struct request *__blk_mq_alloc_request(struct blk_mq_alloc_data *data)
 {
 	struct request_queue *q = data->q;
@@ -377,6 +409,15 @@ static struct request *__blk_mq_alloc_request(struct blk_mq_alloc_data *data)
 	if (!e)
 		blk_mq_tag_busy(data->hctx);
 
+	if (data->nr_tags > 1) {
+		struct request *rq;
+
+		rq = __blk_mq_alloc_requests_batch(data, alloc_time_ns);
+		if (rq)
+			return rq;
+		data->nr_tags = 1;
+	}
+
 	/*
 	 * Waiting allocations only fail because of an inactive hctx.  In that
 	 * case just retry the hctx assignment and tag allocation as CPU hotplug
@@ -544,6 +585,7 @@ inline void __blk_mq_end_request(struct request *rq, blk_status_t error)
 	if (rq->rq_flags & RQF_STATS) {
 		blk_mq_poll_stats_start(rq->q);
 		blk_stat_add(rq, now);
+		blk_mq_poll_hist_add(rq, now);
 	}
 
 	blk_mq_sched_completed_request(rq, now);
@@ -567,6 +609,89 @@ void blk_mq_end_request(struct request *rq, blk_status_t error)
 }
 EXPORT_SYMBOL(blk_mq_end_request);
 
+#define TAG_COMP_BATCH		32
+
+static inline void blk_mq_flush_tag_batch(struct blk_mq_hw_ctx *hctx,
+					  int *tag_array, int nr_tags)
+{
+	struct request_queue *q = hctx->queue;
+
+	blk_mq_put_tags(hctx->tags, tag_array, nr_tags);
+	percpu_ref_put_many(&q->q_usage_counter, nr_tags);
+	blk_mq_sched_restart(hctx);
+}
+
+/**
+ * blk_mq_end_request_batch - end a batch of successfully completed requests
+ * @iob: batch built up with blk_mq_add_to_batch()
+ *
+ * Equivalent to calling blk_mq_end_request(rq, BLK_STS_OK) on every request
+ * on @iob, except that the completion timestamp is sampled once and driver
+ * tags and queue references are returned in bulk per hardware queue.
+ */
+void blk_mq_end_request_batch(struct io_comp_batch *iob)
+{
+	int tags[TAG_COMP_BATCH], nr_tags = 0;
+	struct blk_mq_hw_ctx *cur_hctx = NULL;
+	struct request *rq, *next;
+	u64 now = 0;
+
+	list_for_each_entry(rq, &iob->req_list, queuelist) {
+		if (blk_mq_need_time_stamp(rq)) {
+			now = ktime_get_ns();
+			break;
+		}
+	}
+
+	list_for_each_entry_safe(rq, next, &iob->req_list, queuelist) {
+		struct blk_mq_hw_ctx *hctx = rq->mq_hctx;
+
+		list_del_init(&rq->queuelist);
+
+		if (blk_update_request(rq, BLK_STS_OK, blk_rq_bytes(rq)))
+			BUG();
+
+		if (rq->rq_flags & RQF_STATS) {
+			blk_mq_poll_stats_start(rq->q);
+			blk_stat_add(rq, now);
+			blk_mq_poll_hist_add(rq, now);
+		}
+		blk_account_io_done(rq, now);
+
+		rq->mq_ctx->rq_completed[rq_is_sync(rq)]++;
+		if (rq->rq_flags & RQF_MQ_INFLIGHT)
+			__blk_mq_dec_active_requests(hctx);
+		if (unlikely(laptop_mode && !blk_rq_is_passthrough(rq)))
+			laptop_io_completion(rq->q->backing_dev_info);
+		rq_qos_done(rq->q, rq);
+
+		WRITE_ONCE(rq->state, MQ_RQ_IDLE);
+		if (!refcount_dec_and_test(&rq->ref))
+			continue;
+
+		if (rq->tag == BLK_MQ_NO_TAG ||
+		    blk_mq_tag_is_reserved(hctx->tags, rq->tag)) {
+			__blk_mq_free_request(rq);
+			continue;
+		}
+
+		blk_crypto_free_request(rq);
+		blk_pm_mark_last_busy(rq);
+		rq->mq_hctx = NULL;
+
+		if (nr_tags == TAG_COMP_BATCH || (cur_hctx && cur_hctx != hctx)) {
+			blk_mq_flush_tag_batch(cur_hctx, tags, nr_tags);
+			nr_tags = 0;
+		}
+		cur_hctx = hctx;
+		tags[nr_tags++] = rq->tag;
+	}
+
+	if (nr_tags)
+		blk_mq_flush_tag_batch(cur_hctx, tags, nr_tags);
+}
+EXPORT_SYMBOL_GPL(blk_mq_end_request_batch);
+
 static void blk_complete_reqs(struct llist_head *list)
 {
 	struct llist_node *entry = llist_reverse_order(llist_del_all(list));
@@ -2139,6 +2264,53 @@ static void blk_add_rq_to_plug(struct blk_plug *plug, struct request *rq)
 	}
 }
 
+void blk_mq_free_plug_rqs(struct blk_plug *plug)
+{
+	struct request *rq, *next;
+
+	list_for_each_entry_safe(rq, next, &plug->cached_rq, queuelist) {
+		list_del_init(&rq->queuelist);
+		blk_mq_free_request(rq);
+	}
+}
+
+/*
+ * Take a request preallocated on @plug, if it was set up for the same queue,
+ * hardware queue type and flush semantics as @bio.
+ */
+static struct request *blk_mq_get_cached_request(struct request_queue *q,
+		struct blk_plug *plug, struct bio *bio)
+{
+	struct request *rq;
+
+	if (!plug || list_empty(&plug->cached_rq))
+		return NULL;
+
+	rq = list_first_entry(&plug->cached_rq, struct request, queuelist);
+	if (rq->q != q ||
+	    blk_mq_map_queue(q, bio->bi_opf, rq->mq_ctx) != rq->mq_hctx ||
+	    op_is_flush(rq->cmd_flags) != op_is_flush(bio->bi_opf))
+		return NULL;
+
+	list_del_init(&rq->queuelist);
+	rq->cmd_flags = bio->bi_opf;
+	if (blk_mq_need_time_stamp(rq))
+		rq->start_time_ns = ktime_get_ns();
+	/* The cached request brought its own queue reference */
+	blk_queue_exit(q);
+	return rq;
+}
+
+/*
+ * A bio submitted without an I/O priority gets the one of the submitting
+ * task, so that a scheduler sorting by priority sees buffered I/O as well.
+ */
+static void blk_mq_bio_set_ioprio(struct bio *bio)
+{
+	if (IOPRIO_PRIO_CLASS(bio_prio(bio)) == IOPRIO_CLASS_NONE)
+		bio_set_prio(bio, get_current_ioprio());
+}
+
 /**
  * blk_mq_submit_bio - Create and send a request to block device.
  * @bio: Bio pointer.
@@ -2172,6 +2344,7 @@ blk_qc_t blk_mq_submit_bio(struct bio *bio)
 
 	blk_queue_bounce(q, &bio);
 	__blk_queue_split(&bio, &nr_segs);
+	blk_mq_bio_set_ioprio(bio);
 
 	if (!bio_integrity_prep(bio))
 		goto queue_exit;
@@ -2187,7 +2360,20 @@ blk_qc_t blk_mq_submit_bio(struct bio *bio)
 
 	hipri = bio->bi_opf & REQ_HIPRI;
 
+	plug = blk_mq_plug(q, bio);
+	rq = blk_mq_get_cached_request(q, plug, bio);
+	if (rq) {
+		data.ctx = rq->mq_ctx;
+		data.hctx = rq->mq_hctx;
+		goto got_rq;
+	}
+
 	data.cmd_flags = bio->bi_opf;
+	if (plug && plug->nr_ios > 1 && !q->elevator) {
+		data.nr_tags = plug->nr_ios;
+		data.cached_rq = &plug->cached_rq;
+		plug->nr_ios = 1;
+	}
 	rq = __blk_mq_alloc_request(&data);
 	if (unlikely(!rq)) {
 		rq_qos_cleanup(q, bio);
@@ -2196,6 +2382,7 @@ blk_qc_t blk_mq_submit_bio(struct bio *bio)
 		goto queue_exit;
 	}
 
+got_rq:
 	trace_block_getrq(bio);
 
 	rq_qos_track(q, rq, bio);
@@ -2212,7 +2399,6 @@ blk_qc_t blk_mq_submit_bio(struct bio *bio)
 		return BLK_QC_T_NONE;
 	}
 
-	plug = blk_mq_plug(q, bio);
 	if (unlikely(is_flush_fua)) {
 		/* Bypass scheduler for flush requests */
 		blk_insert_flush(rq);
@@ -3777,11 +3963,79 @@ static void blk_mq_poll_stats_fn(struct blk_stat_callback *cb)
 	int bucket;
 
 	for (bucket = 0; bucket < BLK_MQ_POLL_STATS_BKTS; bucket++) {
-		if (cb->stat[bucket].nr_samples)
+		if (cb->stat[bucket].nr_samples) {
 			q->poll_stat[bucket] = cb->stat[bucket];
+			set_bit(bucket, &q->poll_pct_stale);
+		}
 	}
 }
 
+/*
+ * Percentile of the completion latency that hybrid polling sleeps for.  Only
+ * this share of polled requests should complete before the poller wakes up;
+ * the rest are reaped by spinning for a short while afterwards.
+ */
+#define BLK_MQ_POLL_PCT		10
+
+static void blk_mq_poll_hist_add(struct request *rq, u64 now)
+{
+	struct blk_mq_hw_ctx *hctx = rq->mq_hctx;
+	int bucket, slot;
+	u64 lat;
+
+	if (!(rq->cmd_flags & REQ_HIPRI) ||
+	    !test_bit(QUEUE_FLAG_POLL_STATS, &rq->q->queue_flags))
+		return;
+
+	bucket = blk_mq_poll_stats_bkt(rq);
+	if (bucket < 0)
+		return;
+
+	lat = now > rq->io_start_time_ns ? now - rq->io_start_time_ns : 0;
+	slot = min_t(int, fls64(lat >> 10), BLK_MQ_POLL_HIST_SLOTS - 1);
+	hctx->poll_hist[bucket][slot]++;
+}
+
+/*
+ * Fold the per-hctx histograms for @bucket into a BLK_MQ_POLL_PCT percentile
+ * estimate, interpolating linearly inside the log2 slot it falls into.  The
+ * counters are halved on the way so that older windows fade out.  Called from
+ * the poll path, where holding a request keeps the hctx array stable.
+ */
+static unsigned int blk_mq_poll_hist_pct(struct request_queue *q, int bucket)
+{
+	unsigned int hist[BLK_MQ_POLL_HIST_SLOTS] = { };
+	unsigned long total = 0, seen = 0, target;
+	struct blk_mq_hw_ctx *hctx;
+	u64 lo, hi;
+	int i, slot;
+
+	queue_for_each_hw_ctx(q, hctx, i) {
+		for (slot = 0; slot < BLK_MQ_POLL_HIST_SLOTS; slot++) {
+			hist[slot] += hctx->poll_hist[bucket][slot];
+			hctx->poll_hist[bucket][slot] /= 2;
+		}
+	}
+
+	for (slot = 0; slot < BLK_MQ_POLL_HIST_SLOTS; slot++)
+		total += hist[slot];
+	if (!total)
+		return 0;
+
+	target = DIV_ROUND_UP(total * BLK_MQ_POLL_PCT, 100);
+	for (slot = 0; slot < BLK_MQ_POLL_HIST_SLOTS - 1; slot++) {
+		if (seen + hist[slot] >= target)
+			break;
+		seen += hist[slot];
+	}
+	if (!hist[slot])
+		return 0;
+
+	lo = slot ? 1024ULL << (slot - 1) : 0;
+	hi = 1024ULL << slot;
+	return lo + div_u64((hi - lo) * (target - seen), hist[slot]);
+}
+
 static unsigned long blk_mq_poll_nsecs(struct request_queue *q,
 				       struct request *rq)
 {
@@ -3796,25 +4050,32 @@ static unsigned long blk_mq_poll_nsecs(struct request_queue *q,
 		return 0;
 
 	/*
-	 * As an optimistic guess, use half of the mean service time
-	 * for this type of request. We can (and should) make this smarter.
-	 * For instance, if the completion latencies are tight, we can
-	 * get closer than just half the mean. This is especially
-	 * important on devices where the completion latencies are longer
-	 * than ~10 usec. We do use the stats for the relevant IO size
-	 * if available which does lead to better estimates.
+	 * Sleep for a low percentile of the polled completion latency for
+	 * this type and size of request, refreshed whenever the stats window
+	 * rolls over. Tight latency distributions get a sleep close to the
+	 * typical completion time, wide ones a conservative one, where the
+	 * old half of the mean would oversleep or spin for most of the I/O.
+	 * Until polled samples exist, fall back to half of the mean service
+	 * time.
 	 */
 	bucket = blk_mq_poll_stats_bkt(rq);
 	if (bucket < 0)
 		return ret;
 
-	if (q->poll_stat[bucket].nr_samples)
+	if (test_bit(bucket, &q->poll_pct_stale) &&
+	    test_and_clear_bit(bucket, &q->poll_pct_stale))
+		q->poll_pct_nsec[bucket] = blk_mq_poll_hist_pct(q, bucket);
+
+	if (q->poll_pct_nsec[bucket])
+		ret = q->poll_pct_nsec[bucket];
+	else if (q->poll_stat[bucket].nr_samples)
 		ret = (q->poll_stat[bucket].mean + 1) / 2;
 
 	return ret;
 }
 
 static bool blk_mq_poll_hybrid_sleep(struct request_queue *q,
+				     struct blk_mq_hw_ctx *hctx,
 				     struct request *rq)
 {
 	struct hrtimer_sleeper hs;
@@ -3828,7 +4089,7 @@ static bool blk_mq_poll_hybrid_sleep(struct request_queue *q,
 	/*
 	 * If we get here, hybrid polling is enabled. Hence poll_nsec can be:
 	 *
-	 *  0:	use half of prev avg
+	 *  0:	use a percentile of recent completion latencies
 	 * >0:	use this specific value
 	 */
 	if (q->poll_nsec > 0)
@@ -3840,11 +4101,8 @@ static bool blk_mq_poll_hybrid_sleep(struct request_queue *q,
 		return false;
 
 	rq->rq_flags |= RQF_MQ_POLL_SLEPT;
+	hctx->poll_slept++;
 
-	/*
-	 * This will be replaced with the stats tracking code, using
-	 * 'avg_completion_time / 2' as the pre-sleep target.
-	 */
 	kt = nsecs;
 
 	mode = HRTIMER_MODE_REL;
@@ -3864,6 +4122,9 @@ static bool blk_mq_poll_hybrid_sleep(struct request_queue *q,
 
 	__set_current_state(TASK_RUNNING);
 	destroy_hrtimer_on_stack(&hs.timer);
+
+	if (blk_mq_rq_state(rq) != MQ_RQ_IN_FLIGHT)
+		hctx->poll_overslept++;
 	return true;
 }
 
@@ -3889,7 +4150,7 @@ static bool blk_mq_poll_hybrid(struct request_queue *q,
 			return false;
 	}
 
-	return blk_mq_poll_hybrid_sleep(q, rq);
+	return blk_mq_poll_hybrid_sleep(q, hctx, rq);
 }
 
 /**
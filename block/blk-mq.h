@@ -155,6 +155,10 @@ struct blk_mq_alloc_data {
 	unsigned int shallow_depth;
 	unsigned int cmd_flags;
 
+	/* allocate nr_tags requests, parking the extra ones on cached_rq */
+	unsigned int nr_tags;
+	struct list_head *cached_rq;
+
 	/* input & output parameter */
 	struct blk_mq_ctx *ctx;
 	struct blk_mq_hw_ctx *hctx;
@@ -23,14 +23,20 @@ void blk_rq_stat_init(struct blk_rq_stat *stat)
 	stat->min = -1ULL;
 	stat->max = stat->nr_samples = stat->mean = 0;
 	stat->batch = 0;
+	memset(stat->hist, 0, sizeof(stat->hist));
 }
 
 /* src is a per-cpu stat, mean isn't initialized */
 void blk_rq_stat_sum(struct blk_rq_stat *dst, struct blk_rq_stat *src)
 {
+	int slot;
+
 	if (!src->nr_samples)
 		return;
 
+	for (slot = 0; slot < BLK_RQ_STAT_HIST_SLOTS; slot++)
+		dst->hist[slot] += src->hist[slot];
+
 	dst->min = min(dst->min, src->min);
 	dst->max = max(dst->max, src->max);
 
@@ -46,6 +52,47 @@ void blk_rq_stat_add(struct blk_rq_stat *stat, u64 value)
 	stat->max = max(stat->max, value);
 	stat->batch += value;
 	stat->nr_samples++;
+	stat->hist[min_t(int, fls64(value >> 10), BLK_RQ_STAT_HIST_SLOTS - 1)]++;
+}
+
+/**
+ * blk_rq_stat_percentile() - Estimate a percentile of the sampled latencies
+ * @stat:	the statistics, as summed by blk_rq_stat_sum()
+ * @pct:	the percentile, from 1 to 100
+ *
+ * The estimate is interpolated linearly inside the log2 slot the percentile
+ * falls into, the open ended last slot being bounded by the worst sample.
+ *
+ * Return: the estimate in nanoseconds, or 0 without samples.
+ */
+u64 blk_rq_stat_percentile(const struct blk_rq_stat *stat, unsigned int pct)
+{
+	unsigned long total = 0, seen = 0, target;
+	u64 lo, hi;
+	int slot;
+
+	for (slot = 0; slot < BLK_RQ_STAT_HIST_SLOTS; slot++)
+		total += stat->hist[slot];
+	if (!total)
+		return 0;
+
+	target = DIV_ROUND_UP(total * pct, 100);
+	for (slot = 0; slot < BLK_RQ_STAT_HIST_SLOTS - 1; slot++) {
+		if (seen + stat->hist[slot] >= target)
+			break;
+		seen += stat->hist[slot];
+	}
+	if (!stat->hist[slot])
+		return 0;
+
+	lo = slot ? 1024ULL << (slot - 1) : 0;
+	if (slot < BLK_RQ_STAT_HIST_SLOTS - 1)
+		hi = 1024ULL << slot;
+	else
+		hi = max(stat->max, lo);
+
+	return min(stat->max,
+		   lo + div_u64((hi - lo) * (target - seen), stat->hist[slot]));
 }
 
 void blk_stat_add(struct request *rq, u64 now)
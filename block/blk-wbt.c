@@ -15,6 +15,9 @@
  *   scaling step of 0 if reads show up or the heavy writers finish. Unlike
  *   positive scaling steps where we shrink the monitoring window, a negative
  *   scaling step retains the default step==0 window size.
+ * - In learned mode (queue/wbt_learn), the target is a multiple of the read
+ *   latency the device shows on its own, and it is the 90th percentile of
+ *   the reads in a window rather than the minimum that has to meet it.
  *
  * Copyright (C) 2016 Jens Axboe
  *
@@ -73,6 +76,16 @@ enum {
 	 * information to scale up or down, scale up.
 	 */
 	RWB_UNKNOWN_BUMP	= 5,
+
+	/*
+	 * Learned mode: read samples a window needs to move the baseline,
+	 * the read percentile held under the target, the target as a
+	 * multiple of the baseline, and how slowly the baseline rises.
+	 */
+	RWB_LEARN_MIN_SAMPLES	= 4,
+	RWB_LEARN_PCT		= 90,
+	RWB_LEARN_MULT		= 4,
+	RWB_LEARN_RISE_SHIFT	= 4,
 };
 
 static inline bool rwb_enabled(struct rq_wb *rwb)
@@ -230,8 +243,71 @@ enum {
 	LAT_UNKNOWN,
 	LAT_UNKNOWN_WRITES,
 	LAT_EXCEEDED,
+	LAT_HOLD,
 };
 
+/*
+ * The latency target: wbt_lat_usec, or in learned mode a multiple of the
+ * read latency the device shows on its own, once one has been seen. It
+ * stays well inside the window so that a window can still tell.
+ */
+static u64 rwb_target_nsec(struct rq_wb *rwb)
+{
+	if (!rwb->learn || !rwb->learned_lat_nsec)
+		return rwb->min_lat_nsec;
+
+	return min(rwb->learned_lat_nsec * RWB_LEARN_MULT, rwb->win_nsec / 4);
+}
+
+/*
+ * The learned baseline follows the median read latency. It falls quickly,
+ * but only rises on windows without writeback competing with the reads,
+ * so that throttled writes cannot ratchet their own target up.
+ */
+static void wbt_learn_baseline(struct rq_wb *rwb, struct blk_rq_stat *stat)
+{
+	u64 p50;
+
+	if (stat[READ].nr_samples < RWB_LEARN_MIN_SAMPLES)
+		return;
+
+	p50 = blk_rq_stat_percentile(&stat[READ], 50);
+	if (!rwb->learned_lat_nsec)
+		rwb->learned_lat_nsec = p50;
+	else if (p50 < rwb->learned_lat_nsec)
+		rwb->learned_lat_nsec = (rwb->learned_lat_nsec + p50) / 2;
+	else if (stat[WRITE].nr_samples < RWB_MIN_WRITE_SAMPLES)
+		rwb->learned_lat_nsec += (p50 - rwb->learned_lat_nsec) >>
+					 RWB_LEARN_RISE_SHIFT;
+}
+
+/*
+ * Learned mode judges a window on the read tail rather than its best
+ * read, and only lets the depth back up once the tail is well under the
+ * target, so that a device with a bimodal latency does not flap.
+ */
+static int latency_exceeded_learned(struct rq_wb *rwb,
+				    struct blk_rq_stat *stat)
+{
+	struct backing_dev_info *bdi = rwb->rqos.q->backing_dev_info;
+	u64 target = rwb_target_nsec(rwb);
+	u64 tail;
+
+	tail = blk_rq_stat_percentile(&stat[READ], RWB_LEARN_PCT);
+	trace_wbt_learn(bdi, tail, rwb->learned_lat_nsec, target);
+
+	if (tail > target) {
+		trace_wbt_lat(bdi, tail);
+		trace_wbt_stat(bdi, stat);
+		return LAT_EXCEEDED;
+	}
+
+	if (rwb->rq_depth.scale_step > 0 && tail > target / 2)
+		return LAT_HOLD;
+
+	return LAT_OK;
+}
+
 static int latency_exceeded(struct rq_wb *rwb, struct blk_rq_stat *stat)
 {
 	struct backing_dev_info *bdi = rwb->rqos.q->backing_dev_info;
@@ -249,11 +325,14 @@ static int latency_exceeded(struct rq_wb *rwb, struct blk_rq_stat *stat)
 	 */
 	thislat = rwb_sync_issue_lat(rwb);
 	if (thislat > rwb->cur_win_nsec ||
-	    (thislat > rwb->min_lat_nsec && !stat[READ].nr_samples)) {
+	    (thislat > rwb_target_nsec(rwb) && !stat[READ].nr_samples)) {
 		trace_wbt_lat(bdi, thislat);
 		return LAT_EXCEEDED;
 	}
 
+	if (rwb->learn)
+		wbt_learn_baseline(rwb, stat);
+
 	/*
 	 * No read/write mix, if stat isn't valid
 	 */
@@ -270,6 +349,9 @@ static int latency_exceeded(struct rq_wb *rwb, struct blk_rq_stat *stat)
 		return LAT_UNKNOWN;
 	}
 
+	if (rwb->learn)
+		return latency_exceeded_learned(rwb, stat);
+
 	/*
 	 * If the 'min' latency exceeds our target, step down.
 	 */
@@ -365,7 +447,7 @@ static void wb_timer_fn(struct blk_stat_callback *cb)
 	/*
 	 * If we exceeded the latency target, step down. If we did not,
 	 * step one level up. If we don't know enough to say either exceeded
-	 * or ok, then don't do anything.
+	 * or ok, or are close to the target, then don't do anything.
 	 */
 	switch (status) {
 	case LAT_EXCEEDED:
@@ -395,6 +477,9 @@ static void wb_timer_fn(struct blk_stat_callback *cb)
 		else if (rqd->scale_step < 0)
 			scale_down(rwb, false);
 		break;
+	case LAT_HOLD:
+		rwb_trace_step(rwb, tracepoint_string("hold"));
+		break;
 	default:
 		break;
 	}
@@ -437,6 +522,28 @@ void wbt_set_min_lat(struct request_queue *q, u64 val)
 	wbt_update_limits(RQWB(rqos));
 }
 
+bool wbt_get_learn(struct request_queue *q)
+{
+	struct rq_qos *rqos = wbt_rq_qos(q);
+	if (!rqos)
+		return false;
+	return RQWB(rqos)->learn;
+}
+
+/*
+ * Switch the learned latency target on or off. The baseline is learned
+ * again from scratch either way, the device may have changed meanwhile.
+ */
+void wbt_set_learn(struct request_queue *q, bool learn)
+{
+	struct rq_qos *rqos = wbt_rq_qos(q);
+	if (!rqos)
+		return;
+	RQWB(rqos)->learn = learn;
+	RQWB(rqos)->learned_lat_nsec = 0;
+	wbt_update_limits(RQWB(rqos));
+}
+
 
 static bool close_io(struct rq_wb *rwb)
 {
@@ -760,6 +867,24 @@ static int wbt_min_lat_nsec_show(void *data, struct seq_file *m)
 	return 0;
 }
 
+static int wbt_learned_lat_nsec_show(void *data, struct seq_file *m)
+{
+	struct rq_qos *rqos = data;
+	struct rq_wb *rwb = RQWB(rqos);
+
+	seq_printf(m, "%llu\n", rwb->learned_lat_nsec);
+	return 0;
+}
+
+static int wbt_target_nsec_show(void *data, struct seq_file *m)
+{
+	struct rq_qos *rqos = data;
+	struct rq_wb *rwb = RQWB(rqos);
+
+	seq_printf(m, "%llu\n", rwb_target_nsec(rwb));
+	return 0;
+}
+
 static int wbt_unknown_cnt_show(void *data, struct seq_file *m)
 {
 	struct rq_qos *rqos = data;
@@ -793,6 +918,8 @@ static const struct blk_mq_debugfs_attr wbt_debugfs_attrs[] = {
 	{"id", 0400, wbt_id_show},
 	{"inflight", 0400, wbt_inflight_show},
 	{"min_lat_nsec", 0400, wbt_min_lat_nsec_show},
+	{"learned_lat_nsec", 0400, wbt_learned_lat_nsec_show},
+	{"target_nsec", 0400, wbt_target_nsec_show},
 	{"unknown_cnt", 0400, wbt_unknown_cnt_show},
 	{"wb_normal", 0400, wbt_normal_show},
 	{"wb_background", 0400, wbt_background_show},
@@ -65,6 +65,8 @@ struct rq_wb {
 	unsigned long last_issue;		/* last non-throttled issue */
 	unsigned long last_comp;		/* last non-throttled comp */
 	unsigned long min_lat_nsec;
+	bool learn;				/* learned latency target */
+	u64 learned_lat_nsec;			/* baseline read latency */
 	struct rq_qos rqos;
 	struct rq_wait rq_wait[WBT_NUM_RWQ];
 	struct rq_depth rq_depth;
@@ -94,6 +96,8 @@ void wbt_enable_default(struct request_queue *);
 
 u64 wbt_get_min_lat(struct request_queue *q);
 void wbt_set_min_lat(struct request_queue *q, u64 val);
+bool wbt_get_learn(struct request_queue *q);
+void wbt_set_learn(struct request_queue *q, bool learn);
 
 void wbt_set_write_cache(struct request_queue *, bool);
 
@@ -124,6 +128,13 @@ static inline u64 wbt_get_min_lat(struct request_queue *q)
 static inline void wbt_set_min_lat(struct request_queue *q, u64 val)
 {
 }
+static inline bool wbt_get_learn(struct request_queue *q)
+{
+	return false;
+}
+static inline void wbt_set_learn(struct request_queue *q, bool learn)
+{
+}
 static inline u64 wbt_default_latency_nsec(struct request_queue *q)
 {
 	return 0;
@@ -23,22 +23,21 @@ static struct kset           *pcrypt_kset;
 
 struct pcrypt_instance_ctx {
 	struct crypto_aead_spawn spawn;
-	struct padata_shell *psenc;
-	struct padata_shell *psdec;
 	atomic_t tfm_count;
 };
 
+/*
+ * Every tfm, i.e. every IPsec SA, gets shells of its own, so that requests
+ * of one SA are only ever reordered against each other and SAs do not
+ * contend on a shared reorder lock.
+ */
 struct pcrypt_aead_ctx {
 	struct crypto_aead *child;
+	struct padata_shell *psenc;
+	struct padata_shell *psdec;
 	unsigned int cb_cpu;
 };
 
-static inline struct pcrypt_instance_ctx *pcrypt_tfm_ictx(
-	struct crypto_aead *tfm)
-{
-	return aead_instance_ctx(aead_alg_instance(tfm));
-}
-
 static int pcrypt_aead_setkey(struct crypto_aead *parent,
 			      const u8 *key, unsigned int keylen)
 {
@@ -96,9 +95,6 @@ static int pcrypt_aead_encrypt(struct aead_request *req)
 	struct crypto_aead *aead = crypto_aead_reqtfm(req);
 	struct pcrypt_aead_ctx *ctx = crypto_aead_ctx(aead);
 	u32 flags = aead_request_flags(req);
-	struct pcrypt_instance_ctx *ictx;
-
-	ictx = pcrypt_tfm_ictx(aead);
 
 	memset(padata, 0, sizeof(struct padata_priv));
 
@@ -112,7 +108,7 @@ static int pcrypt_aead_encrypt(struct aead_request *req)
 			       req->cryptlen, req->iv);
 	aead_request_set_ad(creq, req->assoclen);
 
-	err = padata_do_parallel(ictx->psenc, padata, &ctx->cb_cpu);
+	err = padata_do_parallel(ctx->psenc, padata, &ctx->cb_cpu);
 	if (!err)
 		return -EINPROGRESS;
 
@@ -141,9 +137,6 @@ static int pcrypt_aead_decrypt(struct aead_request *req)
 	struct crypto_aead *aead = crypto_aead_reqtfm(req);
 	struct pcrypt_aead_ctx *ctx = crypto_aead_ctx(aead);
 	u32 flags = aead_request_flags(req);
-	struct pcrypt_instance_ctx *ictx;
-
-	ictx = pcrypt_tfm_ictx(aead);
 
 	memset(padata, 0, sizeof(struct padata_priv));
 
@@ -157,7 +150,7 @@ static int pcrypt_aead_decrypt(struct aead_request *req)
 			       req->cryptlen, req->iv);
 	aead_request_set_ad(creq, req->assoclen);
 
-	err = padata_do_parallel(ictx->psdec, padata, &ctx->cb_cpu);
+	err = padata_do_parallel(ctx->psdec, padata, &ctx->cb_cpu);
 	if (!err)
 		return -EINPROGRESS;
 
@@ -166,7 +159,7 @@ static int pcrypt_aead_decrypt(struct aead_request *req)
 
 static int pcrypt_aead_init_tfm(struct crypto_aead *tfm)
 {
-	int cpu, cpu_index;
+	int cpu, cpu_index, err;
 	struct aead_instance *inst = aead_alg_instance(tfm);
 	struct pcrypt_instance_ctx *ictx = aead_instance_ctx(inst);
 	struct pcrypt_aead_ctx *ctx = crypto_aead_ctx(tfm);
@@ -179,10 +172,20 @@ static int pcrypt_aead_init_tfm(struct crypto_aead *tfm)
 	for (cpu = 0; cpu < cpu_index; cpu++)
 		ctx->cb_cpu = cpumask_next(ctx->cb_cpu, cpu_online_mask);
 
+	ctx->psenc = padata_alloc_shell(pencrypt);
+	if (!ctx->psenc)
+		return -ENOMEM;
+
+	err = -ENOMEM;
+	ctx->psdec = padata_alloc_shell(pdecrypt);
+	if (!ctx->psdec)
+		goto err_free_psenc;
+
 	cipher = crypto_spawn_aead(&ictx->spawn);
 
+	err = PTR_ERR(cipher);
 	if (IS_ERR(cipher))
-		return PTR_ERR(cipher);
+		goto err_free_psdec;
 
 	ctx->child = cipher;
 	crypto_aead_set_reqsize(tfm, sizeof(struct pcrypt_request) +
@@ -190,6 +193,12 @@ static int pcrypt_aead_init_tfm(struct crypto_aead *tfm)
 				     crypto_aead_reqsize(cipher));
 
 	return 0;
+
+err_free_psdec:
+	padata_free_shell(ctx->psdec);
+err_free_psenc:
+	padata_free_shell(ctx->psenc);
+	return err;
 }
 
 static void pcrypt_aead_exit_tfm(struct crypto_aead *tfm)
@@ -197,6 +206,8 @@ static void pcrypt_aead_exit_tfm(struct crypto_aead *tfm)
 	struct pcrypt_aead_ctx *ctx = crypto_aead_ctx(tfm);
 
 	crypto_free_aead(ctx->child);
+	padata_free_shell(ctx->psdec);
+	padata_free_shell(ctx->psenc);
 }
 
 static void pcrypt_free(struct aead_instance *inst)
@@ -204,8 +215,6 @@ static void pcrypt_free(struct aead_instance *inst)
 	struct pcrypt_instance_ctx *ctx = aead_instance_ctx(inst);
 
 	crypto_drop_aead(&ctx->spawn);
-	padata_free_shell(ctx->psdec);
-	padata_free_shell(ctx->psenc);
 	kfree(inst);
 }
 
@@ -238,16 +247,7 @@ static int pcrypt_create_aead(struct crypto_template *tmpl, struct rtattr **tb,
 	if (!inst)
 		return -ENOMEM;
 
-	err = -ENOMEM;
-
 	ctx = aead_instance_ctx(inst);
-	ctx->psenc = padata_alloc_shell(pencrypt);
-	if (!ctx->psenc)
-		goto err_free_inst;
-
-	ctx->psdec = padata_alloc_shell(pdecrypt);
-	if (!ctx->psdec)
-		goto err_free_inst;
 
 	err = crypto_grab_aead(&ctx->spawn, aead_crypto_instance(inst),
 			       crypto_attr_alg_name(tb[1]), 0, mask);
@@ -32,6 +32,9 @@
 #include "base.h"
 #include "power/power.h"
 
+#define CREATE_TRACE_POINTS
+#include <trace/events/dev_probe.h>
+
 /*
  * Deferred Probe infrastructure.
  *
@@ -672,8 +675,12 @@ static int really_probe_debug(struct device *dev, struct device_driver *drv)
 	calltime = ktime_get();
 	ret = really_probe(dev, drv);
 	rettime = ktime_get();
-	pr_debug("probe of %s returned %d after %lld usecs\n",
-		 dev_name(dev), ret, ktime_us_delta(rettime, calltime));
+	if (initcall_debug)
+		pr_debug("probe of %s returned %d after %lld usecs\n",
+			 dev_name(dev), ret, ktime_us_delta(rettime, calltime));
+	trace_dev_probe(dev, drv, ret, current_is_async(),
+			ktime_to_ns(calltime),
+			ktime_to_ns(ktime_sub(rettime, calltime)));
 	return ret;
 }
 
@@ -739,7 +746,7 @@ static int driver_probe_device(struct device_driver *drv, struct device *dev)
 		pm_runtime_get_sync(dev->parent);
 
 	pm_runtime_barrier(dev);
-	if (initcall_debug)
+	if (initcall_debug || trace_dev_probe_enabled())
 		ret = really_probe_debug(dev, drv);
 	else
 		ret = really_probe(dev, drv);
@@ -10,8 +10,12 @@
 
 #include <linux/module.h>
 #include <linux/hw_random.h>
+#include <linux/kfifo.h>
 #include <linux/of_platform.h>
 #include <linux/platform_device.h>
+#include <linux/spinlock.h>
+#include <linux/wait.h>
+#include <linux/workqueue.h>
 #include <soc/microchip/mpfs.h>
 
 #define RNG_RESP_BYTES 32U
@@ -21,28 +25,31 @@
 #define CMD_DATA NULL
 #define MBOX_OFFSET 0U
 #define RESP_OFFSET 0U
-#define check_excess_response(nw, mw) (nw > mw ? sizeof(u32) * (nw - mw) : 0U)
+
+/*
+ * Reads are served from a pool that a work item keeps topped up with
+ * back-to-back system controller requests, refilled once it drops below the
+ * low watermark.
+ */
+#define RNG_POOL_BYTES 1024U
+#define RNG_POOL_LOW_WATERMARK (RNG_POOL_BYTES / 2U)
+#define RNG_WAIT_TIMEOUT_MS 1000U
 
 static struct mpfs_rng_priv {
 	struct mpfs_sys_controller *sys_controller;
+	struct device *dev;
 	struct hwrng ops;
+	struct work_struct refill_work;
+	wait_queue_head_t pool_wait;
+	spinlock_t pool_lock;
+	DECLARE_KFIFO(pool, u8, RNG_POOL_BYTES);
 };
 
-static int mpfs_rng_read(struct hwrng *rng, void *buf, size_t max, bool wait)
+static int mpfs_rng_request(struct mpfs_rng_priv *rng_priv, u32 *response_msg)
 {
-	struct mpfs_rng_priv *rng_priv = (struct mpfs_rng_priv *)rng->priv;
-
-	u32 max_words = max / sizeof(u32);
-	u32 num_words_rx = 0;
-	u32 num_requests;
-	u32 response_msg[RESP_SIZE];
-	u16 i;
-	u16 copy_size_bytes;
-	int ret;
-
 	struct mpfs_mss_response response = {
 		.resp_status = 0U,
-		.resp_msg = (u32 *)response_msg,
+		.resp_msg = response_msg,
 		.resp_size = RNG_RESP_BYTES
 	};
 	struct mpfs_mss_msg msg = { .cmd_opcode = CMD_OPCODE,
@@ -52,23 +59,80 @@ static int mpfs_rng_read(struct hwrng *rng, void *buf, size_t max, bool wait)
 				    .mbox_offset = MBOX_OFFSET,
 				    .resp_offset = RESP_OFFSET };
 
+	return mpfs_blocking_transaction(rng_priv->sys_controller, &msg);
+}
+
+static void mpfs_rng_refill(struct work_struct *work)
+{
+	struct mpfs_rng_priv *rng_priv = container_of(work, struct mpfs_rng_priv,
+						      refill_work);
+	u32 response_msg[RESP_SIZE];
+	int ret;
+
+	/* the work item is the only producer, so no lock is needed to peek */
+	while (kfifo_avail(&rng_priv->pool) >= RNG_RESP_BYTES) {
+		ret = mpfs_rng_request(rng_priv, response_msg);
+		if (ret) {
+			dev_warn_ratelimited(rng_priv->dev, "rng request failed: %d\n", ret);
+			break;
+		}
+
+		kfifo_in_spinlocked(&rng_priv->pool, (u8 *)response_msg,
+				    RNG_RESP_BYTES, &rng_priv->pool_lock);
+		wake_up_interruptible(&rng_priv->pool_wait);
+	}
+
+	memzero_explicit(response_msg, sizeof(response_msg));
+}
+
+static int mpfs_rng_read(struct hwrng *rng, void *buf, size_t max, bool wait)
+{
+	struct mpfs_rng_priv *rng_priv = (struct mpfs_rng_priv *)rng->priv;
+	unsigned int copied;
+	long ret;
+
 	if (!max)
 		return 0;
 
-	num_requests = 1 + (max_words - 1) / RESP_SIZE;
+	if (kfifo_is_empty(&rng_priv->pool)) {
+		schedule_work(&rng_priv->refill_work);
 
-	for (i = 0; i < num_requests; i++) {
-		ret = mpfs_blocking_transaction(rng_priv->sys_controller, &msg);
-		if (ret)
+		if (!wait)
+			return 0;
+
+		ret = wait_event_interruptible_timeout(rng_priv->pool_wait,
+						       !kfifo_is_empty(&rng_priv->pool),
+						       msecs_to_jiffies(RNG_WAIT_TIMEOUT_MS));
+		if (ret < 0)
 			return ret;
+		if (!ret)
+			return -ETIMEDOUT;
+	}
 
-		num_words_rx += RESP_SIZE;
-		copy_size_bytes = RNG_RESP_BYTES - check_excess_response(num_words_rx, max_words);
+	copied = kfifo_out_spinlocked(&rng_priv->pool, buf, max,
+				      &rng_priv->pool_lock);
 
-		memcpy((u32 *)buf + i * RESP_SIZE, response_msg, copy_size_bytes);
-	}
+	if (kfifo_len(&rng_priv->pool) < RNG_POOL_LOW_WATERMARK)
+		schedule_work(&rng_priv->refill_work);
 
-	return num_words_rx * sizeof(u32);
+	return copied;
+}
+
+static int mpfs_rng_init(struct hwrng *rng)
+{
+	struct mpfs_rng_priv *rng_priv = (struct mpfs_rng_priv *)rng->priv;
+
+	schedule_work(&rng_priv->refill_work);
+
+	return 0;
+}
+
+static void mpfs_rng_cleanup(struct hwrng *rng)
+{
+	struct mpfs_rng_priv *rng_priv = (struct mpfs_rng_priv *)rng->priv;
+
+	cancel_work_sync(&rng_priv->refill_work);
+	kfifo_reset(&rng_priv->pool);
 }
 
 static int mpfs_rng_number_probe(struct platform_device *pdev)
@@ -94,7 +158,15 @@ static int mpfs_rng_number_probe(struct platform_device *pdev)
 	if (!rng_priv->sys_controller)
 		return -EPROBE_DEFER;
 
+	rng_priv->dev = dev;
+	INIT_WORK(&rng_priv->refill_work, mpfs_rng_refill);
+	init_waitqueue_head(&rng_priv->pool_wait);
+	spin_lock_init(&rng_priv->pool_lock);
+	INIT_KFIFO(rng_priv->pool);
+
 	rng_priv->ops.priv = (unsigned long)rng_priv;
+	rng_priv->ops.init = mpfs_rng_init;
+	rng_priv->ops.cleanup = mpfs_rng_cleanup;
 	rng_priv->ops.read = mpfs_rng_read;
 	rng_priv->ops.name = pdev->name;
 
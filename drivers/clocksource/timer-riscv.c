@@ -5,7 +5,9 @@
  *
  * All RISC-V systems have a timer attached to every hart.  These timers can
  * either be read from the "time" and "timeh" CSRs, and can use the SBI to
- * setup events, or directly accessed using MMIO registers.
+ * setup events, or directly accessed using MMIO registers.  Harts with the
+ * Sstc extension program their events straight into stimecmp without
+ * trapping to the firmware.
  */
 #include <linux/clocksource.h>
 #include <linux/clockchips.h>
@@ -13,19 +15,37 @@
 #include <linux/delay.h>
 #include <linux/irq.h>
 #include <linux/irqdomain.h>
+#include <linux/jump_label.h>
 #include <linux/sched_clock.h>
 #include <linux/io-64-nonatomic-lo-hi.h>
 #include <linux/interrupt.h>
 #include <linux/of_irq.h>
+#include <linux/string.h>
 #include <asm/smp.h>
 #include <asm/sbi.h>
 #include <asm/timex.h>
 
+static DEFINE_STATIC_KEY_FALSE(riscv_sstc_available);
+
 static int riscv_clock_next_event(unsigned long delta,
 		struct clock_event_device *ce)
 {
+	u64 next_tval = get_cycles64() + delta;
+
 	csr_set(CSR_IE, IE_TIE);
-	sbi_set_timer(get_cycles64() + delta);
+	if (static_branch_likely(&riscv_sstc_available)) {
+#if defined(CONFIG_32BIT)
+		/* Park the low half so the split update can't fire early */
+		csr_write(CSR_STIMECMP, ULONG_MAX);
+		csr_write(CSR_STIMECMPH, next_tval >> 32);
+		csr_write(CSR_STIMECMP, next_tval & 0xFFFFFFFF);
+#else
+		csr_write(CSR_STIMECMP, next_tval);
+#endif
+	} else {
+		sbi_set_timer(next_tval);
+	}
+
 	return 0;
 }
 
@@ -90,6 +110,30 @@ static irqreturn_t riscv_timer_interrupt(int irq, void *dev_id)
 	return IRQ_HANDLED;
 }
 
+/* Sstc is only usable if every hart the kernel may run on implements it */
+static bool __init riscv_timer_sstc_probe(void)
+{
+	struct device_node *np;
+	const char *isa, *ext;
+
+	for_each_of_cpu_node(np) {
+		if (riscv_of_processor_hartid(np) < 0)
+			continue;
+		if (of_property_read_string(np, "riscv,isa", &isa))
+			goto no_sstc;
+
+		ext = strstr(isa, "_sstc");
+		if (!ext || (ext[5] != '\0' && ext[5] != '_'))
+			goto no_sstc;
+	}
+
+	return true;
+
+no_sstc:
+	of_node_put(np);
+	return false;
+}
+
 static int __init riscv_timer_init_dt(struct device_node *n)
 {
 	int cpuid, hartid, error;
@@ -142,6 +186,11 @@ static int __init riscv_timer_init_dt(struct device_node *n)
 
 	sched_clock_register(riscv_sched_clock, 64, riscv_timebase);
 
+	if (riscv_timer_sstc_probe()) {
+		static_branch_enable(&riscv_sstc_available);
+		pr_info("Timer interrupt in S-mode is available via sstc extension\n");
+	}
+
 	error = request_percpu_irq(riscv_clock_event_irq,
 				    riscv_timer_interrupt,
 				    "riscv-timer", &riscv_clock_event);
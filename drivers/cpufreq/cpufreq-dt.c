@@ -13,6 +13,7 @@
 #include <linux/cpufreq.h>
 #include <linux/cpumask.h>
 #include <linux/err.h>
+#include <linux/ktime.h>
 #include <linux/list.h>
 #include <linux/module.h>
 #include <linux/of.h>
@@ -32,12 +33,25 @@ struct private_data {
 	struct opp_table *opp_table;
 	struct cpufreq_frequency_table *freq_table;
 	bool have_static_opps;
+
+	/* Slowest switch seen so far, against clock-latency-ns from the OPPs */
+	u64 max_transition_ns;
 };
 
 static LIST_HEAD(priv_list);
 
+static ssize_t show_transition_latency_max(struct cpufreq_policy *policy,
+					   char *buf)
+{
+	struct private_data *priv = policy->driver_data;
+
+	return sprintf(buf, "%llu\n", READ_ONCE(priv->max_transition_ns));
+}
+cpufreq_freq_attr_ro(transition_latency_max);
+
 static struct freq_attr *cpufreq_dt_attr[] = {
 	&cpufreq_freq_attr_scaling_available_freqs,
+	&transition_latency_max,
 	NULL,   /* Extra space for boost-attr if required */
 	NULL,
 };
@@ -58,8 +72,32 @@ static int set_target(struct cpufreq_policy *policy, unsigned int index)
 {
 	struct private_data *priv = policy->driver_data;
 	unsigned long freq = policy->freq_table[index].frequency;
+	ktime_t start = ktime_get();
+	u64 delta;
+	int ret;
 
-	return dev_pm_opp_set_rate(priv->cpu_dev, freq * 1000);
+	ret = dev_pm_opp_set_rate(priv->cpu_dev, freq * 1000);
+	if (ret)
+		return ret;
+
+	/*
+	 * Governors pace their requests by the declared transition latency,
+	 * so a DT that understates it makes them ask faster than the clock and
+	 * regulator can follow.  Keep the worst case measured for userspace
+	 * and say so once when the declaration is off.
+	 */
+	delta = ktime_to_ns(ktime_sub(ktime_get(), start));
+	if (delta > priv->max_transition_ns) {
+		WRITE_ONCE(priv->max_transition_ns, delta);
+		if (policy->cpuinfo.transition_latency != CPUFREQ_ETERNAL &&
+		    delta > policy->cpuinfo.transition_latency)
+			dev_warn_once(priv->cpu_dev,
+				      "switch to %lu kHz took %llu ns, clock-latency-ns is %u\n",
+				      freq, delta,
+				      policy->cpuinfo.transition_latency);
+	}
+
+	return 0;
 }
 
 /*
@@ -140,7 +178,7 @@ static int cpufreq_init(struct cpufreq_policy *policy)
 		ret = cpufreq_enable_boost_support();
 		if (ret)
 			goto out_clk_put;
-		cpufreq_dt_attr[1] = &cpufreq_freq_attr_scaling_boost_freqs;
+		cpufreq_dt_attr[2] = &cpufreq_freq_attr_scaling_boost_freqs;
 	}
 
 	dev_pm_opp_of_register_em(cpu_dev, policy->cpus);
@@ -0,0 +1,234 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * RISC-V SBI CPU idle driver.
+ *
+ * State 0 is WFI. Deeper states come from the idle-state nodes named in
+ * each cpu node's cpu-idle-states, compatible "riscv,idle-state", whose
+ * riscv,sbi-suspend-param is the suspend_type handed to the SBI HSM
+ * hart suspend call. Only retentive suspend types are supported: a
+ * non-retentive state returns through the resume address with the hart
+ * context lost, and there is no arch code here to save and restore it.
+ */
+
+#define pr_fmt(fmt) "cpuidle-riscv-sbi: " fmt
+
+#include <linux/cpu_cooling.h>
+#include <linux/cpuidle.h>
+#include <linux/cpumask.h>
+#include <linux/kernel.h>
+#include <linux/module.h>
+#include <linux/of.h>
+#include <linux/of_device.h>
+#include <linux/percpu.h>
+#include <linux/slab.h>
+
+#include <asm/processor.h>
+#include <asm/sbi.h>
+
+#include "dt_idle_states.h"
+
+static DEFINE_PER_CPU_READ_MOSTLY(u32 *, sbi_cpuidle_states);
+
+static int sbi_suspend(u32 state)
+{
+	struct sbiret ret;
+
+	ret = sbi_ecall(SBI_EXT_HSM, SBI_EXT_HSM_HART_SUSPEND,
+			state, 0, 0, 0, 0, 0);
+
+	return ret.error ? sbi_err_map_linux_errno(ret.error) : 0;
+}
+
+static int sbi_enter_idle_state(struct cpuidle_device *dev,
+				struct cpuidle_driver *drv, int idx)
+{
+	u32 *states = __this_cpu_read(sbi_cpuidle_states);
+
+	if (!idx) {
+		wait_for_interrupt();
+		return idx;
+	}
+
+	return sbi_suspend(states[idx]) ? -1 : idx;
+}
+
+static struct cpuidle_driver sbi_idle_driver __initdata = {
+	.name = "riscv_sbi_idle",
+	.owner = THIS_MODULE,
+	.states[0] = {
+		.enter                  = sbi_enter_idle_state,
+		.exit_latency           = 1,
+		.target_residency       = 1,
+		.power_usage		= UINT_MAX,
+		.name                   = "WFI",
+		.desc                   = "RISC-V WFI",
+	}
+};
+
+static const struct of_device_id sbi_idle_state_match[] __initconst = {
+	{ .compatible = "riscv,idle-state",
+	  .data = sbi_enter_idle_state },
+	{ },
+};
+
+static bool __init sbi_suspend_state_is_valid(u32 state)
+{
+	if (state > SBI_HSM_SUSPEND_RET_DEFAULT &&
+	    state < SBI_HSM_SUSPEND_RET_PLATFORM)
+		return false;
+	if (state > SBI_HSM_SUSPEND_NON_RET_DEFAULT &&
+	    state < SBI_HSM_SUSPEND_NON_RET_PLATFORM)
+		return false;
+	return true;
+}
+
+static int __init sbi_dt_parse_state_node(struct device_node *np, u32 *state)
+{
+	int err;
+
+	err = of_property_read_u32(np, "riscv,sbi-suspend-param", state);
+	if (err) {
+		pr_warn("%pOF missing riscv,sbi-suspend-param property\n", np);
+		return err;
+	}
+
+	if (!sbi_suspend_state_is_valid(*state)) {
+		pr_warn("%pOF invalid riscv,sbi-suspend-param %#x\n",
+			np, *state);
+		return -EINVAL;
+	}
+
+	if (*state & SBI_HSM_SUSP_NON_RET_BIT) {
+		pr_warn("%pOF non-retentive suspend %#x not supported\n",
+			np, *state);
+		return -EOPNOTSUPP;
+	}
+
+	return 0;
+}
+
+static int __init sbi_cpu_init_idle(int cpu, unsigned int state_count)
+{
+	struct device_node *cpu_node, *state_node;
+	u32 *states;
+	int i, ret = 0;
+
+	cpu_node = of_cpu_device_node_get(cpu);
+	if (!cpu_node)
+		return -ENODEV;
+
+	state_count++; /* Add WFI state too */
+	states = kcalloc(state_count, sizeof(*states), GFP_KERNEL);
+	if (!states) {
+		ret = -ENOMEM;
+		goto out_node_put;
+	}
+
+	for (i = 1; i < state_count; i++) {
+		state_node = of_get_cpu_state_node(cpu_node, i - 1);
+		if (!state_node)
+			break;
+
+		ret = sbi_dt_parse_state_node(state_node, &states[i]);
+		of_node_put(state_node);
+		if (ret)
+			goto out_kfree;
+
+		pr_debug("cpu%d state %d suspend-param %#x\n",
+			 cpu, i, states[i]);
+	}
+
+	if (i != state_count) {
+		ret = -ENODEV;
+		goto out_kfree;
+	}
+
+	per_cpu(sbi_cpuidle_states, cpu) = states;
+	goto out_node_put;
+
+out_kfree:
+	kfree(states);
+out_node_put:
+	of_node_put(cpu_node);
+	return ret;
+}
+
+static int __init sbi_idle_init_cpu(int cpu)
+{
+	struct cpuidle_driver *drv;
+	int ret;
+
+	drv = kmemdup(&sbi_idle_driver, sizeof(*drv), GFP_KERNEL);
+	if (!drv)
+		return -ENOMEM;
+
+	drv->cpumask = (struct cpumask *)cpumask_of(cpu);
+
+	/*
+	 * Initialize idle states data, starting at index 1. If there are
+	 * no DT idle states (ret == 0) WFI from the arch idle loop is all
+	 * there is, so leave this hart to it.
+	 */
+	ret = dt_init_idle_driver(drv, sbi_idle_state_match, 1);
+	if (ret <= 0) {
+		ret = ret ? : -ENODEV;
+		goto out_kfree_drv;
+	}
+
+	ret = sbi_cpu_init_idle(cpu, ret);
+	if (ret) {
+		pr_err("cpu%d failed to parse idle states\n", cpu);
+		goto out_kfree_drv;
+	}
+
+	ret = cpuidle_register(drv, NULL);
+	if (ret)
+		goto out_kfree_states;
+
+	cpuidle_cooling_register(drv);
+
+	return 0;
+
+out_kfree_states:
+	kfree(per_cpu(sbi_cpuidle_states, cpu));
+	per_cpu(sbi_cpuidle_states, cpu) = NULL;
+out_kfree_drv:
+	kfree(drv);
+	return ret;
+}
+
+static int __init sbi_idle_init(void)
+{
+	int cpu, ret;
+	struct cpuidle_driver *drv;
+	struct cpuidle_device *dev;
+
+	/* Hart suspend was added to HSM in SBI v0.3 */
+	if (sbi_spec_is_0_1() ||
+	    (!sbi_major_version() && sbi_minor_version() < 3) ||
+	    sbi_probe_extension(SBI_EXT_HSM) <= 0) {
+		pr_info("no SBI HSM suspend, using WFI only\n");
+		return 0;
+	}
+
+	for_each_possible_cpu(cpu) {
+		ret = sbi_idle_init_cpu(cpu);
+		if (ret)
+			goto out_fail;
+	}
+
+	return 0;
+
+out_fail:
+	while (--cpu >= 0) {
+		dev = per_cpu(cpuidle_devices, cpu);
+		drv = cpuidle_get_cpu_driver(dev);
+		cpuidle_unregister(drv);
+		kfree(drv);
+		kfree(per_cpu(sbi_cpuidle_states, cpu));
+		per_cpu(sbi_cpuidle_states, cpu) = NULL;
+	}
+
+	return ret;
+}
+device_initcall(sbi_idle_init);
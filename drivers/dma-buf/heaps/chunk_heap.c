@@ -0,0 +1,583 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * DMABUF chunk heap exporter
+ *
+ * Buffers are made of physically contiguous 2 MiB chunks from the buddy
+ * allocator, with order-0 pages for any tail, so that devices behind no
+ * IOMMU can walk a multi-GB buffer in a few thousand segments instead of
+ * needing one contiguous CMA region. Freed chunks go back to a pool that
+ * can be filled at boot, before memory fragments.
+ */
+
+#include <linux/dma-buf.h>
+#include <linux/dma-mapping.h>
+#include <linux/dma-heap.h>
+#include <linux/err.h>
+#include <linux/highmem.h>
+#include <linux/list.h>
+#include <linux/mm.h>
+#include <linux/module.h>
+#include <linux/scatterlist.h>
+#include <linux/shrinker.h>
+#include <linux/slab.h>
+#include <linux/spinlock.h>
+#include <linux/vmalloc.h>
+
+#define CHUNK_SIZE	SZ_2M
+#define CHUNK_ORDER	get_order(CHUNK_SIZE)
+#define CHUNK_PAGES	(CHUNK_SIZE >> PAGE_SHIFT)
+
+#define CHUNK_GFP	(GFP_HIGHUSER | __GFP_ZERO | __GFP_COMP | \
+			 __GFP_NORETRY | __GFP_NOWARN)
+#define TAIL_GFP	(GFP_HIGHUSER | __GFP_ZERO | __GFP_COMP)
+
+static unsigned int reserve_mb;
+module_param(reserve_mb, uint, 0444);
+MODULE_PARM_DESC(reserve_mb, "MiB of chunks allocated into the pool at boot and never shrunk");
+
+static unsigned int pool_max_mb = 256;
+module_param(pool_max_mb, uint, 0644);
+MODULE_PARM_DESC(pool_max_mb, "MiB of freed chunks kept in the pool, on top of reserve_mb");
+
+static struct dma_heap *chunk_heap;
+
+/* Free chunks, linked through page->lru */
+static struct {
+	spinlock_t lock;
+	struct list_head chunks;
+	unsigned long count;
+	unsigned long reserve;
+} pool = {
+	.lock = __SPIN_LOCK_UNLOCKED(pool.lock),
+	.chunks = LIST_HEAD_INIT(pool.chunks),
+};
+
+struct chunk_heap_buffer {
+	struct dma_heap *heap;
+	struct list_head attachments;
+	struct mutex lock;
+	unsigned long len;
+	struct sg_table sg_table;
+	int vmap_cnt;
+	void *vaddr;
+};
+
+struct dma_heap_attachment {
+	struct device *dev;
+	struct sg_table *table;
+	struct list_head list;
+	bool mapped;
+};
+
+static unsigned long chunk_pool_limit(void)
+{
+	return pool.reserve + ((unsigned long)pool_max_mb << 20) / CHUNK_SIZE;
+}
+
+static struct page *chunk_pool_get(void)
+{
+	struct page *page;
+
+	spin_lock(&pool.lock);
+	page = list_first_entry_or_null(&pool.chunks, struct page, lru);
+	if (page) {
+		list_del(&page->lru);
+		pool.count--;
+	}
+	spin_unlock(&pool.lock);
+
+	return page;
+}
+
+static void chunk_pool_put(struct page *page)
+{
+	spin_lock(&pool.lock);
+	if (pool.count < chunk_pool_limit()) {
+		list_add(&page->lru, &pool.chunks);
+		pool.count++;
+		page = NULL;
+	}
+	spin_unlock(&pool.lock);
+
+	if (page)
+		__free_pages(page, CHUNK_ORDER);
+}
+
+static struct page *chunk_alloc(void)
+{
+	struct page *page;
+	unsigned int i;
+
+	page = chunk_pool_get();
+	if (!page)
+		return alloc_pages(CHUNK_GFP, CHUNK_ORDER);
+
+	/* Pooled chunks carry the previous owner's data */
+	for (i = 0; i < CHUNK_PAGES; i++)
+		clear_highpage(page + i);
+
+	return page;
+}
+
+static void chunk_heap_free_page(struct page *page)
+{
+	if (compound_order(page) == CHUNK_ORDER)
+		chunk_pool_put(page);
+	else
+		__free_pages(page, compound_order(page));
+}
+
+static unsigned long chunk_pool_count(struct shrinker *shrinker,
+				      struct shrink_control *sc)
+{
+	unsigned long count = READ_ONCE(pool.count);
+	unsigned long reserve = READ_ONCE(pool.reserve);
+
+	return count > reserve ? (count - reserve) * CHUNK_PAGES : 0;
+}
+
+/* Only chunks above the boot reserve are handed back to the system */
+static unsigned long chunk_pool_scan(struct shrinker *shrinker,
+				     struct shrink_control *sc)
+{
+	unsigned long freed = 0;
+	struct page *page;
+
+	while (freed < sc->nr_to_scan) {
+		spin_lock(&pool.lock);
+		page = NULL;
+		if (pool.count > pool.reserve) {
+			page = list_first_entry(&pool.chunks, struct page, lru);
+			list_del(&page->lru);
+			pool.count--;
+		}
+		spin_unlock(&pool.lock);
+		if (!page)
+			break;
+
+		__free_pages(page, CHUNK_ORDER);
+		freed += CHUNK_PAGES;
+	}
+
+	return freed ? freed : SHRINK_STOP;
+}
+
+static struct shrinker chunk_pool_shrinker = {
+	.count_objects = chunk_pool_count,
+	.scan_objects = chunk_pool_scan,
+	.seeks = DEFAULT_SEEKS,
+	.batch = CHUNK_PAGES,
+};
+
+static struct sg_table *dup_sg_table(struct sg_table *table)
+{
+	struct sg_table *new_table;
+	int ret, i;
+	struct scatterlist *sg, *new_sg;
+
+	new_table = kzalloc(sizeof(*new_table), GFP_KERNEL);
+	if (!new_table)
+		return ERR_PTR(-ENOMEM);
+
+	ret = sg_alloc_table(new_table, table->orig_nents, GFP_KERNEL);
+	if (ret) {
+		kfree(new_table);
+		return ERR_PTR(-ENOMEM);
+	}
+
+	new_sg = new_table->sgl;
+	for_each_sgtable_sg(table, sg, i) {
+		sg_set_page(new_sg, sg_page(sg), sg->length, sg->offset);
+		new_sg = sg_next(new_sg);
+	}
+
+	return new_table;
+}
+
+static int chunk_heap_attach(struct dma_buf *dmabuf,
+			     struct dma_buf_attachment *attachment)
+{
+	struct chunk_heap_buffer *buffer = dmabuf->priv;
+	struct dma_heap_attachment *a;
+	struct sg_table *table;
+
+	a = kzalloc(sizeof(*a), GFP_KERNEL);
+	if (!a)
+		return -ENOMEM;
+
+	table = dup_sg_table(&buffer->sg_table);
+	if (IS_ERR(table)) {
+		kfree(a);
+		return -ENOMEM;
+	}
+
+	a->table = table;
+	a->dev = attachment->dev;
+	INIT_LIST_HEAD(&a->list);
+	a->mapped = false;
+
+	attachment->priv = a;
+
+	mutex_lock(&buffer->lock);
+	list_add(&a->list, &buffer->attachments);
+	mutex_unlock(&buffer->lock);
+
+	return 0;
+}
+
+static void chunk_heap_detach(struct dma_buf *dmabuf,
+			      struct dma_buf_attachment *attachment)
+{
+	struct chunk_heap_buffer *buffer = dmabuf->priv;
+	struct dma_heap_attachment *a = attachment->priv;
+
+	mutex_lock(&buffer->lock);
+	list_del(&a->list);
+	mutex_unlock(&buffer->lock);
+
+	sg_free_table(a->table);
+	kfree(a->table);
+	kfree(a);
+}
+
+static struct sg_table *chunk_heap_map_dma_buf(struct dma_buf_attachment *attachment,
+					       enum dma_data_direction direction)
+{
+	struct dma_heap_attachment *a = attachment->priv;
+	struct sg_table *table = a->table;
+	int ret;
+
+	ret = dma_map_sgtable(attachment->dev, table, direction, 0);
+	if (ret)
+		return ERR_PTR(ret);
+
+	a->mapped = true;
+	return table;
+}
+
+static void chunk_heap_unmap_dma_buf(struct dma_buf_attachment *attachment,
+				     struct sg_table *table,
+				     enum dma_data_direction direction)
+{
+	struct dma_heap_attachment *a = attachment->priv;
+
+	a->mapped = false;
+	dma_unmap_sgtable(attachment->dev, table, direction, 0);
+}
+
+static int chunk_heap_dma_buf_begin_cpu_access(struct dma_buf *dmabuf,
+					       enum dma_data_direction direction)
+{
+	struct chunk_heap_buffer *buffer = dmabuf->priv;
+	struct dma_heap_attachment *a;
+
+	mutex_lock(&buffer->lock);
+
+	if (buffer->vmap_cnt)
+		invalidate_kernel_vmap_range(buffer->vaddr, buffer->len);
+
+	list_for_each_entry(a, &buffer->attachments, list) {
+		if (!a->mapped)
+			continue;
+		dma_sync_sgtable_for_cpu(a->dev, a->table, direction);
+	}
+	mutex_unlock(&buffer->lock);
+
+	return 0;
+}
+
+static int chunk_heap_dma_buf_end_cpu_access(struct dma_buf *dmabuf,
+					     enum dma_data_direction direction)
+{
+	struct chunk_heap_buffer *buffer = dmabuf->priv;
+	struct dma_heap_attachment *a;
+
+	mutex_lock(&buffer->lock);
+
+	if (buffer->vmap_cnt)
+		flush_kernel_vmap_range(buffer->vaddr, buffer->len);
+
+	list_for_each_entry(a, &buffer->attachments, list) {
+		if (!a->mapped)
+			continue;
+		dma_sync_sgtable_for_device(a->dev, a->table, direction);
+	}
+	mutex_unlock(&buffer->lock);
+
+	return 0;
+}
+
+/* Each entry is physically contiguous, so map it with one remap call */
+static int chunk_heap_mmap(struct dma_buf *dmabuf, struct vm_area_struct *vma)
+{
+	struct chunk_heap_buffer *buffer = dmabuf->priv;
+	unsigned long skip = vma->vm_pgoff << PAGE_SHIFT;
+	unsigned long addr = vma->vm_start;
+	struct scatterlist *sg;
+	int i, ret;
+
+	for_each_sgtable_sg(&buffer->sg_table, sg, i) {
+		struct page *page = sg_page(sg);
+		unsigned long len = sg->length;
+
+		if (skip >= len) {
+			skip -= len;
+			continue;
+		}
+		page += skip >> PAGE_SHIFT;
+		len -= skip;
+		skip = 0;
+
+		len = min(len, vma->vm_end - addr);
+		ret = remap_pfn_range(vma, addr, page_to_pfn(page), len,
+				      vma->vm_page_prot);
+		if (ret)
+			return ret;
+		addr += len;
+		if (addr >= vma->vm_end)
+			return 0;
+	}
+	return 0;
+}
+
+static void *chunk_heap_do_vmap(struct chunk_heap_buffer *buffer)
+{
+	struct sg_table *table = &buffer->sg_table;
+	int npages = PAGE_ALIGN(buffer->len) / PAGE_SIZE;
+	struct page **pages = vmalloc(sizeof(struct page *) * npages);
+	struct page **tmp = pages;
+	struct sg_page_iter piter;
+	void *vaddr;
+
+	if (!pages)
+		return ERR_PTR(-ENOMEM);
+
+	for_each_sgtable_page(table, &piter, 0) {
+		WARN_ON(tmp - pages >= npages);
+		*tmp++ = sg_page_iter_page(&piter);
+	}
+
+	vaddr = vmap(pages, npages, VM_MAP, PAGE_KERNEL);
+	vfree(pages);
+
+	if (!vaddr)
+		return ERR_PTR(-ENOMEM);
+
+	return vaddr;
+}
+
+static int chunk_heap_vmap(struct dma_buf *dmabuf, struct dma_buf_map *map)
+{
+	struct chunk_heap_buffer *buffer = dmabuf->priv;
+	void *vaddr;
+	int ret = 0;
+
+	mutex_lock(&buffer->lock);
+	if (buffer->vmap_cnt) {
+		buffer->vmap_cnt++;
+		dma_buf_map_set_vaddr(map, buffer->vaddr);
+		goto out;
+	}
+
+	vaddr = chunk_heap_do_vmap(buffer);
+	if (IS_ERR(vaddr)) {
+		ret = PTR_ERR(vaddr);
+		goto out;
+	}
+
+	buffer->vaddr = vaddr;
+	buffer->vmap_cnt++;
+	dma_buf_map_set_vaddr(map, buffer->vaddr);
+out:
+	mutex_unlock(&buffer->lock);
+
+	return ret;
+}
+
+static void chunk_heap_vunmap(struct dma_buf *dmabuf, struct dma_buf_map *map)
+{
+	struct chunk_heap_buffer *buffer = dmabuf->priv;
+
+	mutex_lock(&buffer->lock);
+	if (!--buffer->vmap_cnt) {
+		vunmap(buffer->vaddr);
+		buffer->vaddr = NULL;
+	}
+	mutex_unlock(&buffer->lock);
+	dma_buf_map_clear(map);
+}
+
+static void chunk_heap_dma_buf_release(struct dma_buf *dmabuf)
+{
+	struct chunk_heap_buffer *buffer = dmabuf->priv;
+	struct sg_table *table;
+	struct scatterlist *sg;
+	int i;
+
+	table = &buffer->sg_table;
+	for_each_sgtable_sg(table, sg, i)
+		chunk_heap_free_page(sg_page(sg));
+	sg_free_table(table);
+	kfree(buffer);
+}
+
+static const struct dma_buf_ops chunk_heap_buf_ops = {
+	.attach = chunk_heap_attach,
+	.detach = chunk_heap_detach,
+	.map_dma_buf = chunk_heap_map_dma_buf,
+	.unmap_dma_buf = chunk_heap_unmap_dma_buf,
+	.begin_cpu_access = chunk_heap_dma_buf_begin_cpu_access,
+	.end_cpu_access = chunk_heap_dma_buf_end_cpu_access,
+	.mmap = chunk_heap_mmap,
+	.vmap = chunk_heap_vmap,
+	.vunmap = chunk_heap_vunmap,
+	.release = chunk_heap_dma_buf_release,
+};
+
+static struct dma_buf *chunk_heap_allocate(struct dma_heap *heap,
+					   unsigned long len,
+					   unsigned long fd_flags,
+					   unsigned long heap_flags)
+{
+	struct chunk_heap_buffer *buffer;
+	DEFINE_DMA_BUF_EXPORT_INFO(exp_info);
+	unsigned long size_remaining;
+	unsigned int i = 0;
+	struct dma_buf *dmabuf;
+	struct sg_table *table;
+	struct scatterlist *sg;
+	struct list_head pages;
+	struct page *page, *tmp_page;
+	int ret = -ENOMEM;
+
+	len = PAGE_ALIGN(len);
+	if (len / PAGE_SIZE > totalram_pages())
+		return ERR_PTR(-ENOMEM);
+	size_remaining = len;
+
+	buffer = kzalloc(sizeof(*buffer), GFP_KERNEL);
+	if (!buffer)
+		return ERR_PTR(-ENOMEM);
+
+	INIT_LIST_HEAD(&buffer->attachments);
+	mutex_init(&buffer->lock);
+	buffer->heap = heap;
+	buffer->len = len;
+
+	INIT_LIST_HEAD(&pages);
+	while (size_remaining > 0) {
+		/*
+		 * Avoid trying to allocate memory if the process
+		 * has been killed by SIGKILL
+		 */
+		if (fatal_signal_pending(current)) {
+			ret = -EINTR;
+			goto free_buffer;
+		}
+
+		if (size_remaining >= CHUNK_SIZE) {
+			page = chunk_alloc();
+			if (!page)
+				goto free_buffer;
+			size_remaining -= CHUNK_SIZE;
+		} else {
+			page = alloc_page(TAIL_GFP);
+			if (!page)
+				goto free_buffer;
+			size_remaining -= PAGE_SIZE;
+		}
+
+		list_add_tail(&page->lru, &pages);
+		i++;
+	}
+
+	table = &buffer->sg_table;
+	if (sg_alloc_table(table, i, GFP_KERNEL))
+		goto free_buffer;
+
+	sg = table->sgl;
+	list_for_each_entry_safe(page, tmp_page, &pages, lru) {
+		sg_set_page(sg, page, page_size(page), 0);
+		sg = sg_next(sg);
+		list_del(&page->lru);
+	}
+
+	/* create the dmabuf */
+	exp_info.exp_name = "chunk";
+	exp_info.ops = &chunk_heap_buf_ops;
+	exp_info.size = buffer->len;
+	exp_info.flags = fd_flags;
+	exp_info.priv = buffer;
+	dmabuf = dma_buf_export(&exp_info);
+	if (IS_ERR(dmabuf)) {
+		ret = PTR_ERR(dmabuf);
+		goto free_pages;
+	}
+	return dmabuf;
+
+free_pages:
+	for_each_sgtable_sg(table, sg, i)
+		chunk_heap_free_page(sg_page(sg));
+	sg_free_table(table);
+free_buffer:
+	list_for_each_entry_safe(page, tmp_page, &pages, lru) {
+		list_del(&page->lru);
+		chunk_heap_free_page(page);
+	}
+	kfree(buffer);
+
+	return ERR_PTR(ret);
+}
+
+static const struct dma_heap_ops chunk_heap_ops = {
+	.allocate = chunk_heap_allocate,
+};
+
+static void chunk_pool_fill(void)
+{
+	unsigned long nr = ((unsigned long)reserve_mb << 20) / CHUNK_SIZE;
+	struct page *page;
+
+	while (pool.count < nr) {
+		page = alloc_pages(CHUNK_GFP & ~__GFP_NORETRY, CHUNK_ORDER);
+		if (!page)
+			break;
+		spin_lock(&pool.lock);
+		list_add(&page->lru, &pool.chunks);
+		pool.count++;
+		spin_unlock(&pool.lock);
+	}
+	pool.reserve = pool.count;
+
+	if (pool.count < nr)
+		pr_warn("chunk_heap: reserved %lu of %lu chunks\n",
+			pool.count, nr);
+}
+
+static int chunk_heap_create(void)
+{
+	struct dma_heap_export_info exp_info;
+	int ret;
+
+	BUILD_BUG_ON(CHUNK_ORDER >= MAX_ORDER);
+
+	chunk_pool_fill();
+
+	ret = register_shrinker(&chunk_pool_shrinker);
+	if (ret)
+		return ret;
+
+	exp_info.name = "chunk";
+	exp_info.ops = &chunk_heap_ops;
+	exp_info.priv = NULL;
+
+	chunk_heap = dma_heap_add(&exp_info);
+	if (IS_ERR(chunk_heap)) {
+		unregister_shrinker(&chunk_pool_shrinker);
+		return PTR_ERR(chunk_heap);
+	}
+
+	return 0;
+}
+module_init(chunk_heap_create);
+MODULE_LICENSE("GPL v2");
@@ -112,6 +112,18 @@ MODULE_LICENSE("Dual BSD/GPL");
 #define USE_DEV_PROPERTY    0
 #endif
 
+#if     (LINUX_VERSION_CODE >= KERNEL_VERSION(5, 11, 0))
+#define USE_DMA_BUF_EXPORT  1
+#else
+#define USE_DMA_BUF_EXPORT  0
+#endif
+
+#if     ((USE_VMA_FAULT == 1) && defined(CONFIG_TRANSPARENT_HUGEPAGE))
+#define USE_VMA_HUGE_FAULT  1
+#else
+#define USE_VMA_HUGE_FAULT  0
+#endif
+
 #if     (UDMABUF_DEBUG == 1)
 #define UDMABUF_DEBUG_CHECK(this,debug) (this->debug)
 #else
@@ -122,6 +134,17 @@ MODULE_LICENSE("Dual BSD/GPL");
 #include <linux/of_reserved_mem.h>
 #endif
 
+#if     (USE_DMA_BUF_EXPORT == 1)
+#include <linux/dma-buf.h>
+#endif
+
+#if     (USE_VMA_HUGE_FAULT == 1)
+#include <linux/huge_mm.h>
+#include <linux/pfn_t.h>
+#endif
+
+#include <linux/u-dma-buf.h>
+
 #ifndef U64_MAX
 #define U64_MAX ((u64)~0ULL)
 #endif
@@ -185,9 +208,15 @@ struct udmabuf_device_data {
 #if (USE_OF_RESERVED_MEM == 1)
     bool                 of_reserved_mem;
 #endif
+#if (USE_VMA_FAULT == 1)
+    bool                 prepopulate;
+#endif
 #if ((UDMABUF_DEBUG == 1) && (USE_VMA_FAULT == 1))
     bool                 debug_vma;
 #endif
+#if (USE_DMA_BUF_EXPORT == 1)
+    atomic_t             export_count;
+#endif
 };
 
 /**
@@ -221,6 +250,7 @@ struct udmabuf_device_data {
  * * /sys/class/udmabuf/<device-name>/sync_for_cpu
  * * /sys/class/udmabuf/<device-name>/sync_for_device
  * * /sys/class/udmabuf/<device-name>/dma_coherent
+ * * /sys/class/udmabuf/<device-name>/prepopulate
  * * 
  */
 
@@ -272,6 +302,45 @@ static int udmabuf_sync_command_argments(
     return 0;
 } 
 
+/**
+ * udmabuf_sync_range() - sync a range given by offset, size and sync_direction value.
+ * @this:       Pointer to the udmabuf device data structure.
+ * @for_cpu:    dma_sync_single_for_cpu() if true, else dma_sync_single_for_device().
+ * @offset:     Offset of the range from the start of the buffer.
+ * @size:       Size of the range.
+ * @direction:  0 bidirectional, 1 to device, 2 from device, as sync_direction.
+ * Return:      Success(=0) or error status(<0).
+ *
+ * Used by the sync ioctls, which take the range as arguments instead of going
+ * through the sync_offset/sync_size/sync_direction sysfs attributes.
+ */
+static int udmabuf_sync_range(
+    struct udmabuf_device_data *this     ,
+    bool                        for_cpu  ,
+    u64                         offset   ,
+    u64                         size     ,
+    int                         direction
+) {
+    enum dma_data_direction dma_direction;
+
+    if ((offset > this->size) || (size > this->size - offset))
+        return -EINVAL;
+    switch(direction) {
+        case 0 : dma_direction = DMA_BIDIRECTIONAL; break;
+        case 1 : dma_direction = DMA_TO_DEVICE    ; break;
+        case 2 : dma_direction = DMA_FROM_DEVICE  ; break;
+        default: return -EINVAL;
+    }
+    if (for_cpu) {
+        dma_sync_single_for_cpu(this->dma_dev, this->phys_addr + offset, size, dma_direction);
+        this->sync_owner = 0;
+    } else {
+        dma_sync_single_for_device(this->dma_dev, this->phys_addr + offset, size, dma_direction);
+        this->sync_owner = 1;
+    }
+    return 0;
+}
+
 /**
  * udmabuf_sync_for_cpu() - call dma_sync_single_for_cpu() when (sync_for_cpu != 0)
  * @this:       Pointer to the udmabuf device data structure.
@@ -369,6 +438,10 @@ DEF_ATTR_SET( sync_for_device            , 0, U64_MAX,  NO_ACTION, udmabuf_sync_
 #if defined(IS_DMA_COHERENT)
 DEF_ATTR_SHOW(dma_coherent   , "%d\n"    , IS_DMA_COHERENT(this->dma_dev)                 );
 #endif
+#if (USE_VMA_FAULT == 1)
+DEF_ATTR_SHOW(prepopulate    , "%d\n"    , this->prepopulate                              );
+DEF_ATTR_SET( prepopulate                , 0, 1,        NO_ACTION, NO_ACTION              );
+#endif
 #if ((UDMABUF_DEBUG == 1) && (USE_VMA_FAULT == 1))
 DEF_ATTR_SHOW(debug_vma      , "%d\n"    , this->debug_vma                                );
 DEF_ATTR_SET( debug_vma                  , 0, 1,        NO_ACTION, NO_ACTION              );
@@ -388,6 +461,9 @@ static struct device_attribute udmabuf_device_attrs[] = {
 #if defined(IS_DMA_COHERENT)
   __ATTR(dma_coherent   , 0444, udmabuf_show_dma_coherent    , NULL                       ),
 #endif
+#if (USE_VMA_FAULT == 1)
+  __ATTR(prepopulate    , 0664, udmabuf_show_prepopulate     , udmabuf_set_prepopulate    ),
+#endif
 #if ((UDMABUF_DEBUG == 1) && (USE_VMA_FAULT == 1))
   __ATTR(debug_vma      , 0664, udmabuf_show_debug_vma       , udmabuf_set_debug_vma      ),
 #endif
@@ -436,6 +512,7 @@ static inline void udmabuf_sys_class_set_attributes(void)
  * * udmabuf_device_vma_open()  - udmabuf device vm area open operation.
  * * udmabuf_device_vma_close() - udmabuf device vm area close operation.
  * * udmabuf_device_vma_fault() - udmabuf device vm area fault operation.
+ * * udmabuf_device_vma_huge_fault() - udmabuf device vm area huge page fault operation.
  * * udmabuf_device_vm_ops      - udmabuf device vm operation table.
  */
 
@@ -543,13 +620,57 @@ static VM_FAULT_RETURN_TYPE udmabuf_device_vma_fault(struct vm_area_struct* vma,
 }
 #endif
 
+#if (USE_VMA_HUGE_FAULT == 1)
+/**
+ * udmabuf_device_vma_huge_fault() - udmabuf device vm area huge page fault operation.
+ * @vfm:        Pointer to the vm fault structure.
+ * @pe_size:    Size of the page table entry to fault in.
+ * Return:      VM_FAULT_RETURN_TYPE (Success(=0) or error status(!=0)).
+ *
+ * Maps a whole PMD at once where both the virtual and the physical address
+ * are PMD aligned and the PMD lies inside the buffer, which cuts the TLB
+ * misses on large frame buffers. Anything else falls back to
+ * udmabuf_device_vma_fault() one page at a time.
+ */
+static VM_FAULT_RETURN_TYPE udmabuf_device_vma_huge_fault(struct vm_fault* vmf, enum page_entry_size pe_size)
+{
+    struct vm_area_struct*      vma       = vmf->vma;
+    struct udmabuf_device_data* this      = vma->vm_private_data;
+    unsigned long               virt_addr = vmf->address & PMD_MASK;
+    unsigned long               offset;
+    phys_addr_t                 phys_addr;
+
+    if (pe_size != PE_SIZE_PMD)
+        return VM_FAULT_FALLBACK;
+
+    if ((virt_addr < vma->vm_start) || (virt_addr + PMD_SIZE > vma->vm_end))
+        return VM_FAULT_FALLBACK;
+
+    offset    = (vma->vm_pgoff << PAGE_SHIFT) + (virt_addr - vma->vm_start);
+    phys_addr = this->phys_addr + offset;
+
+    if (!IS_ALIGNED(phys_addr, PMD_SIZE) || (offset + PMD_SIZE > this->alloc_size))
+        return VM_FAULT_FALLBACK;
+
+    if (UDMABUF_DEBUG_CHECK(this, debug_vma))
+        dev_info(this->dma_dev,
+                 "vma_huge_fault(virt_addr=0x%lx, phys_addr=%pa)\n", virt_addr, &phys_addr
+        );
+
+    return vmf_insert_pfn_pmd(vmf, phys_to_pfn_t(phys_addr, PFN_DEV), vmf->flags & FAULT_FLAG_WRITE);
+}
+#endif
+
 /**
  * udmabuf device vm operation table.
  */
 static const struct vm_operations_struct udmabuf_device_vm_ops = {
-    .open    = udmabuf_device_vma_open ,
-    .close   = udmabuf_device_vma_close,
-    .fault   = udmabuf_device_vma_fault,
+    .open       = udmabuf_device_vma_open ,
+    .close      = udmabuf_device_vma_close,
+    .fault      = udmabuf_device_vma_fault,
+#if (USE_VMA_HUGE_FAULT == 1)
+    .huge_fault = udmabuf_device_vma_huge_fault,
+#endif
 };
 
 #endif /* #if (USE_VMA_FAULT == 1) */
@@ -565,6 +686,7 @@ static const struct vm_operations_struct udmabuf_device_vm_ops = {
  * * udmabuf_device_file_read()    - udmabuf device file read operation.
  * * udmabuf_device_file_write()   - udmabuf device file write operation.
  * * udmabuf_device_file_llseek()  - udmabuf device file llseek operation.
+ * * udmabuf_device_file_ioctl()   - udmabuf device file ioctl operation.
  * * udmabuf_device_file_ops       - udmabuf device file operation table.
  */
 
@@ -621,19 +743,18 @@ static int udmabuf_device_file_release(struct inode *inode, struct file *file)
 #endif
 
 /**
- * udmabuf_device_file_mmap() - udmabuf device file memory map operation.
- * @file:       Pointer to the file structure.
+ * udmabuf_device_mmap() - map the udmabuf into a vm area.
+ * @this:       Pointer to the udmabuf device data structure.
  * @vma:        Pointer to the vm area structure.
+ * @sync:       true if the file was opened with O_SYNC.
  * Return:      Success(=0) or error status(<0).
  */
-static int udmabuf_device_file_mmap(struct file *file, struct vm_area_struct* vma)
+static int udmabuf_device_mmap(struct udmabuf_device_data* this, struct vm_area_struct* vma, bool sync)
 {
-    struct udmabuf_device_data* this = file->private_data;
-
     if (vma->vm_pgoff + vma_pages(vma) > (this->alloc_size >> PAGE_SHIFT))
         return -EINVAL;
 
-    if ((file->f_flags & O_SYNC) | (this->sync_mode & SYNC_ALWAYS)) {
+    if (sync | (this->sync_mode & SYNC_ALWAYS)) {
         switch (this->sync_mode & SYNC_MODE_MASK) {
             case SYNC_MODE_NONCACHED :
                 vma->vm_flags    |= VM_IO;
@@ -658,6 +779,22 @@ static int udmabuf_device_file_mmap(struct file *file, struct vm_area_struct* vm
         unsigned long page_frame_num = (this->phys_addr >> PAGE_SHIFT) + vma->vm_pgoff;
         if (pfn_valid(page_frame_num)) {
             vma->vm_flags |= VM_PFNMAP;
+            if (this->prepopulate) {
+                /*
+                 * Map the whole range now, with the page protection chosen
+                 * above, so that first touches of the buffer don't fault.
+                 */
+                int retval = remap_pfn_range(vma, vma->vm_start, page_frame_num,
+                                             vma->vm_end - vma->vm_start,
+                                             vma->vm_page_prot);
+                if (retval)
+                    return retval;
+            }
+#if (USE_VMA_HUGE_FAULT == 1)
+            else {
+                vma->vm_flags |= VM_HUGEPAGE;
+            }
+#endif
             vma->vm_ops    = &udmabuf_device_vm_ops;
             udmabuf_device_vma_open(vma);
             return 0;
@@ -668,6 +805,19 @@ static int udmabuf_device_file_mmap(struct file *file, struct vm_area_struct* vm
     return dma_mmap_coherent(this->dma_dev, vma, this->virt_addr, this->phys_addr, this->alloc_size);
 }
 
+/**
+ * udmabuf_device_file_mmap() - udmabuf device file memory map operation.
+ * @file:       Pointer to the file structure.
+ * @vma:        Pointer to the vm area structure.
+ * Return:      Success(=0) or error status(<0).
+ */
+static int udmabuf_device_file_mmap(struct file *file, struct vm_area_struct* vma)
+{
+    struct udmabuf_device_data* this = file->private_data;
+
+    return udmabuf_device_mmap(this, vma, (file->f_flags & O_SYNC) != 0);
+}
+
 /**
  * udmabuf_device_file_read() - udmabuf device file read operation.
  * @file:       Pointer to the file structure.
@@ -793,6 +943,232 @@ static loff_t udmabuf_device_file_llseek(struct file* file, loff_t offset, int w
     return new_pos;
 }
 
+#if (USE_DMA_BUF_EXPORT == 1)
+/**
+ * DOC: Udmabuf DMA-BUF Exporter Operations
+ *
+ * This section defines the dma-buf exported by U_DMA_BUF_IOCTL_EXPORT, so that
+ * other drivers can import the udmabuf without a copy.
+ *
+ * * udmabuf_dma_buf_map()          - dma-buf map_dma_buf operation.
+ * * udmabuf_dma_buf_unmap()        - dma-buf unmap_dma_buf operation.
+ * * udmabuf_dma_buf_release()      - dma-buf release operation.
+ * * udmabuf_dma_buf_begin_cpu_access() - dma-buf begin_cpu_access operation.
+ * * udmabuf_dma_buf_end_cpu_access()   - dma-buf end_cpu_access operation.
+ * * udmabuf_dma_buf_mmap()         - dma-buf mmap operation.
+ * * udmabuf_dma_buf_vmap()         - dma-buf vmap operation.
+ * * udmabuf_dma_buf_ops            - dma-buf operation table.
+ * * udmabuf_device_export()        - export the udmabuf as a dma-buf.
+ */
+
+/**
+ * udmabuf_dma_buf_map() - dma-buf map_dma_buf operation.
+ * @attach:     Pointer to the dma-buf attachment.
+ * @direction:  DMA direction of the mapping.
+ * Return:      Pointer to the sg table mapped for the importer or error pointer.
+ */
+static struct sg_table* udmabuf_dma_buf_map(struct dma_buf_attachment* attach, enum dma_data_direction direction)
+{
+    struct udmabuf_device_data* this = attach->dmabuf->priv;
+    struct sg_table*            sgt;
+    int                         retval;
+
+    sgt = kzalloc(sizeof(*sgt), GFP_KERNEL);
+    if (!sgt)
+        return ERR_PTR(-ENOMEM);
+
+    retval = dma_get_sgtable(this->dma_dev, sgt, this->virt_addr, this->phys_addr, this->alloc_size);
+    if (retval < 0)
+        goto failed;
+
+    retval = dma_map_sgtable(attach->dev, sgt, direction, 0);
+    if (retval < 0) {
+        sg_free_table(sgt);
+        goto failed;
+    }
+    return sgt;
+
+ failed:
+    kfree(sgt);
+    return ERR_PTR(retval);
+}
+
+/**
+ * udmabuf_dma_buf_unmap() - dma-buf unmap_dma_buf operation.
+ * @attach:     Pointer to the dma-buf attachment.
+ * @sgt:        Pointer to the sg table returned by udmabuf_dma_buf_map().
+ * @direction:  DMA direction of the mapping.
+ */
+static void udmabuf_dma_buf_unmap(struct dma_buf_attachment* attach, struct sg_table* sgt, enum dma_data_direction direction)
+{
+    dma_unmap_sgtable(attach->dev, sgt, direction, 0);
+    sg_free_table(sgt);
+    kfree(sgt);
+}
+
+/**
+ * udmabuf_dma_buf_release() - dma-buf release operation.
+ * @dmabuf:     Pointer to the dma-buf.
+ */
+static void udmabuf_dma_buf_release(struct dma_buf* dmabuf)
+{
+    struct udmabuf_device_data* this = dmabuf->priv;
+
+    atomic_dec(&this->export_count);
+}
+
+/**
+ * udmabuf_dma_buf_begin_cpu_access() - dma-buf begin_cpu_access operation.
+ * @dmabuf:     Pointer to the dma-buf.
+ * @direction:  DMA direction of the access.
+ * Return:      Success(=0).
+ */
+static int udmabuf_dma_buf_begin_cpu_access(struct dma_buf* dmabuf, enum dma_data_direction direction)
+{
+    struct udmabuf_device_data* this = dmabuf->priv;
+
+    dma_sync_single_for_cpu(this->dma_dev, this->phys_addr, this->alloc_size, direction);
+    return 0;
+}
+
+/**
+ * udmabuf_dma_buf_end_cpu_access() - dma-buf end_cpu_access operation.
+ * @dmabuf:     Pointer to the dma-buf.
+ * @direction:  DMA direction of the access.
+ * Return:      Success(=0).
+ */
+static int udmabuf_dma_buf_end_cpu_access(struct dma_buf* dmabuf, enum dma_data_direction direction)
+{
+    struct udmabuf_device_data* this = dmabuf->priv;
+
+    dma_sync_single_for_device(this->dma_dev, this->phys_addr, this->alloc_size, direction);
+    return 0;
+}
+
+/**
+ * udmabuf_dma_buf_mmap() - dma-buf mmap operation.
+ * @dmabuf:     Pointer to the dma-buf.
+ * @vma:        Pointer to the vm area structure.
+ * Return:      Success(=0) or error status(<0).
+ */
+static int udmabuf_dma_buf_mmap(struct dma_buf* dmabuf, struct vm_area_struct* vma)
+{
+    return udmabuf_device_mmap(dmabuf->priv, vma, false);
+}
+
+/**
+ * udmabuf_dma_buf_vmap() - dma-buf vmap operation.
+ * @dmabuf:     Pointer to the dma-buf.
+ * @map:        Pointer to the returned mapping.
+ * Return:      Success(=0).
+ */
+static int udmabuf_dma_buf_vmap(struct dma_buf* dmabuf, struct dma_buf_map* map)
+{
+    struct udmabuf_device_data* this = dmabuf->priv;
+
+    dma_buf_map_set_vaddr(map, this->virt_addr);
+    return 0;
+}
+
+/**
+ * udmabuf dma-buf operation table.
+ */
+static const struct dma_buf_ops udmabuf_dma_buf_ops = {
+    .map_dma_buf      = udmabuf_dma_buf_map,
+    .unmap_dma_buf    = udmabuf_dma_buf_unmap,
+    .release          = udmabuf_dma_buf_release,
+    .begin_cpu_access = udmabuf_dma_buf_begin_cpu_access,
+    .end_cpu_access   = udmabuf_dma_buf_end_cpu_access,
+    .mmap             = udmabuf_dma_buf_mmap,
+    .vmap             = udmabuf_dma_buf_vmap,
+};
+
+/**
+ * udmabuf_device_export() - export the udmabuf as a dma-buf.
+ * @this:       Pointer to the udmabuf device data structure.
+ * @fd_flags:   O_CLOEXEC and access mode of the new file descriptor.
+ * Return:      dma-buf file descriptor(>=0) or error status(<0).
+ *
+ * The udmabuf can not be removed while an exported dma-buf is still alive.
+ */
+static int udmabuf_device_export(struct udmabuf_device_data* this, u32 fd_flags)
+{
+    DEFINE_DMA_BUF_EXPORT_INFO(exp_info);
+    struct dma_buf* dmabuf;
+    int             fd;
+
+    if (fd_flags & ~(O_CLOEXEC | O_ACCMODE))
+        return -EINVAL;
+    if (this->virt_addr == NULL)
+        return -ENODEV;
+
+    exp_info.exp_name = dev_name(this->sys_dev);
+    exp_info.ops      = &udmabuf_dma_buf_ops;
+    exp_info.size     = this->alloc_size;
+    exp_info.flags    = fd_flags;
+    exp_info.priv     = this;
+
+    atomic_inc(&this->export_count);
+    dmabuf = dma_buf_export(&exp_info);
+    if (IS_ERR(dmabuf)) {
+        atomic_dec(&this->export_count);
+        return PTR_ERR(dmabuf);
+    }
+
+    fd = dma_buf_fd(dmabuf, fd_flags);
+    if (fd < 0)
+        dma_buf_put(dmabuf);
+    return fd;
+}
+#endif /* #if (USE_DMA_BUF_EXPORT == 1) */
+
+/**
+ * udmabuf_device_file_ioctl() - udmabuf device file ioctl operation.
+ * @file:       Pointer to the file structure.
+ * @cmd:        ioctl command.
+ * @arg:        Pointer to the user argument.
+ * Return:      Success(>=0) or error status(<0).
+ */
+static long udmabuf_device_file_ioctl(struct file* file, unsigned int cmd, unsigned long arg)
+{
+    struct udmabuf_device_data* this = file->private_data;
+    void __user*                argp = (void __user*)arg;
+    long                        result;
+
+    switch (cmd) {
+        case U_DMA_BUF_IOCTL_SYNC_FOR_CPU :
+        case U_DMA_BUF_IOCTL_SYNC_FOR_DEVICE : {
+            struct u_dma_buf_sync_args args;
+            if (copy_from_user(&args, argp, sizeof(args)))
+                return -EFAULT;
+            if (args.reserved)
+                return -EINVAL;
+            if (mutex_lock_interruptible(&this->sem))
+                return -ERESTARTSYS;
+            result = udmabuf_sync_range(this, (cmd == U_DMA_BUF_IOCTL_SYNC_FOR_CPU),
+                                        args.offset, args.size, args.direction);
+            mutex_unlock(&this->sem);
+            return result;
+        }
+#if (USE_DMA_BUF_EXPORT == 1)
+        case U_DMA_BUF_IOCTL_EXPORT : {
+            struct u_dma_buf_export_args args;
+            if (copy_from_user(&args, argp, sizeof(args)))
+                return -EFAULT;
+            result = udmabuf_device_export(this, args.fd_flags);
+            if (result < 0)
+                return result;
+            args.fd = result;
+            if (copy_to_user(argp, &args, sizeof(args)))
+                return -EFAULT;
+            return 0;
+        }
+#endif
+        default:
+            return -ENOTTY;
+    }
+}
+
 /**
  * udmabuf device file operation table.
  */
@@ -804,6 +1180,11 @@ static const struct file_operations udmabuf_device_file_ops = {
     .read    = udmabuf_device_file_read,
     .write   = udmabuf_device_file_write,
     .llseek  = udmabuf_device_file_llseek,
+    .unlocked_ioctl = udmabuf_device_file_ioctl,
+    .compat_ioctl   = compat_ptr_ioctl,
+#if (USE_VMA_HUGE_FAULT == 1)
+    .get_unmapped_area = thp_get_unmapped_area,
+#endif
 };
 
 /**
@@ -961,10 +1342,20 @@ static struct udmabuf_device_data* udmabuf_device_create(const char* name, struc
         this->of_reserved_mem = 0;
     }
 #endif
+#if (USE_VMA_FAULT == 1)
+    {
+        this->prepopulate     = 0;
+    }
+#endif
 #if ((UDMABUF_DEBUG == 1) && (USE_VMA_FAULT == 1))
     {
         this->debug_vma       = 0;
     }
+#endif
+#if (USE_DMA_BUF_EXPORT == 1)
+    {
+        atomic_set(&this->export_count, 0);
+    }
 #endif
     mutex_init(&this->sem);
 
@@ -1037,6 +1428,13 @@ static int udmabuf_device_destroy(struct udmabuf_device_data* this)
     if (!this)
         return -ENODEV;
 
+#if (USE_DMA_BUF_EXPORT == 1)
+    if (atomic_read(&this->export_count) > 0) {
+        dev_warn(this->sys_dev, "still exported as dma-buf, not destroyed\n");
+        return -EBUSY;
+    }
+#endif
+
     if (this->virt_addr != NULL) {
         dma_free_coherent(this->dma_dev, this->alloc_size, this->virt_addr, this->phys_addr);
         this->virt_addr = NULL;
@@ -1447,6 +1845,8 @@ static int udmabuf_device_remove(struct device *dev, struct udmabuf_device_data
         bool of_reserved_mem = devdata->of_reserved_mem;
 #endif
         retval = udmabuf_device_destroy(devdata);
+        if (retval != 0)
+            return retval;
         dev_set_drvdata(dev, NULL);
 #if (USE_OF_RESERVED_MEM == 1)
         if (of_reserved_mem) {
@@ -1641,6 +2041,14 @@ static int udmabuf_device_probe(struct device *dev)
     if (of_property_read_bool(dev->of_node, "sync-always")) {
         device_data->sync_mode |= SYNC_ALWAYS;
     }
+#if (USE_VMA_FAULT == 1)
+    /*
+     * prepopulate property
+     */
+    if (of_property_read_bool(dev->of_node, "prepopulate")) {
+        device_data->prepopulate = 1;
+    }
+#endif
     /*
      * sync-direction property
      */
@@ -0,0 +1,608 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/*
+ * SiFive FU540 / PolarFire SoC Platform DMA driver
+ *
+ * The controller has four independent channels, each with a done and an
+ * error interrupt. Channels listed in "dma-channel-mask" are driven here;
+ * the rest are left alone so the PDMA UIO driver can hand them to user
+ * space.
+ */
+#include <linux/module.h>
+#include <linux/device.h>
+#include <linux/kernel.h>
+#include <linux/platform_device.h>
+#include <linux/mod_devicetable.h>
+#include <linux/dma-mapping.h>
+#include <linux/of.h>
+#include <linux/of_dma.h>
+#include <linux/slab.h>
+#include <linux/io-64-nonatomic-lo-hi.h>
+
+#include "sf-pdma.h"
+
+#define PDMA_SLAVE_BUSWIDTHS	(BIT(DMA_SLAVE_BUSWIDTH_1_BYTE) | \
+				 BIT(DMA_SLAVE_BUSWIDTH_2_BYTES) | \
+				 BIT(DMA_SLAVE_BUSWIDTH_4_BYTES) | \
+				 BIT(DMA_SLAVE_BUSWIDTH_8_BYTES))
+
+static inline struct sf_pdma_chan *to_sf_pdma_chan(struct dma_chan *dchan)
+{
+	return container_of(dchan, struct sf_pdma_chan, vchan.chan);
+}
+
+static inline struct sf_pdma_desc *to_sf_pdma_desc(struct virt_dma_desc *vd)
+{
+	return container_of(vd, struct sf_pdma_desc, vdesc);
+}
+
+static struct sf_pdma_desc *sf_pdma_alloc_desc(unsigned int nsegs)
+{
+	struct sf_pdma_desc *desc;
+
+	desc = kzalloc(struct_size(desc, segs, nsegs), GFP_NOWAIT);
+	if (!desc)
+		return NULL;
+
+	desc->nsegs = nsegs;
+
+	return desc;
+}
+
+static void sf_pdma_free_desc(struct virt_dma_desc *vdesc)
+{
+	kfree(to_sf_pdma_desc(vdesc));
+}
+
+/* Caller holds vchan.lock */
+static void sf_pdma_xfer_seg(struct sf_pdma_chan *chan)
+{
+	struct sf_pdma_desc *desc = chan->desc;
+	struct sf_pdma_seg *seg = &desc->segs[desc->cur_seg];
+	struct pdma_regs *regs = &chan->regs;
+
+	writel(desc->xfer_type, regs->xfer_type);
+	writeq(seg->xfer_size, regs->xfer_size);
+	writeq(seg->dst_addr, regs->dst_addr);
+	writeq(seg->src_addr, regs->src_addr);
+
+	writel(PDMA_CLAIM_MASK | PDMA_RUN_MASK | PDMA_ENABLE_DONE_INT_MASK |
+	       PDMA_ENABLE_ERR_INT_MASK, regs->ctrl);
+}
+
+/* Caller holds vchan.lock */
+static void sf_pdma_start_next(struct sf_pdma_chan *chan)
+{
+	struct virt_dma_desc *vdesc = vchan_next_desc(&chan->vchan);
+
+	if (!vdesc) {
+		chan->desc = NULL;
+		return;
+	}
+
+	list_del(&vdesc->node);
+	chan->desc = to_sf_pdma_desc(vdesc);
+	chan->desc->cur_seg = 0;
+	chan->retries = 0;
+
+	sf_pdma_xfer_seg(chan);
+}
+
+/* Bytes left in the in-flight descriptor. Caller holds vchan.lock */
+static u64 sf_pdma_inflight_residue(struct sf_pdma_chan *chan)
+{
+	struct sf_pdma_desc *desc = chan->desc;
+	u64 residue;
+	unsigned int i;
+
+	residue = readq(chan->regs.residue);
+	for (i = desc->cur_seg + 1; i < desc->nsegs; i++)
+		residue += desc->segs[i].xfer_size;
+
+	return residue;
+}
+
+static struct dma_async_tx_descriptor *
+sf_pdma_prep_dma_memcpy(struct dma_chan *dchan, dma_addr_t dest,
+			dma_addr_t src, size_t len, unsigned long flags)
+{
+	struct sf_pdma_chan *chan = to_sf_pdma_chan(dchan);
+	struct sf_pdma_desc *desc;
+
+	if (!len)
+		return NULL;
+
+	desc = sf_pdma_alloc_desc(1);
+	if (!desc)
+		return NULL;
+
+	desc->xfer_type = PDMA_FULL_SPEED;
+	desc->total = len;
+	desc->segs[0].src_addr = src;
+	desc->segs[0].dst_addr = dest;
+	desc->segs[0].xfer_size = len;
+
+	return vchan_tx_prep(&chan->vchan, &desc->vdesc, flags);
+}
+
+/*
+ * Entries that are contiguous in bus address space, as dma-heap chunks
+ * often are without an IOMMU, go out as a single hardware transfer.
+ */
+static unsigned int sf_pdma_count_segs(struct scatterlist *sgl,
+				       unsigned int sg_len)
+{
+	struct scatterlist *sg;
+	dma_addr_t next = 0;
+	unsigned int i, nsegs = 0;
+
+	for_each_sg(sgl, sg, sg_len, i) {
+		if (!nsegs || sg_dma_address(sg) != next)
+			nsegs++;
+		next = sg_dma_address(sg) + sg_dma_len(sg);
+	}
+
+	return nsegs;
+}
+
+/*
+ * The PDMA has no peripheral request lines and always increments both
+ * addresses, so a slave transfer targets a memory-mapped window (fabric
+ * RAM, a FIFO aperture) and advances through it segment by segment.
+ */
+static struct dma_async_tx_descriptor *
+sf_pdma_prep_slave_sg(struct dma_chan *dchan, struct scatterlist *sgl,
+		      unsigned int sg_len, enum dma_transfer_direction dir,
+		      unsigned long flags, void *context)
+{
+	struct sf_pdma_chan *chan = to_sf_pdma_chan(dchan);
+	struct dma_slave_config *cfg = &chan->cfg;
+	enum dma_slave_buswidth width;
+	struct sf_pdma_desc *desc;
+	struct sf_pdma_seg *seg = NULL;
+	struct scatterlist *sg;
+	dma_addr_t dev_addr, addr, next = 0;
+	unsigned int i, n = 0;
+	u32 size, len;
+
+	if (!sg_len)
+		return NULL;
+
+	if (dir == DMA_DEV_TO_MEM) {
+		dev_addr = cfg->src_addr;
+		width = cfg->src_addr_width;
+	} else if (dir == DMA_MEM_TO_DEV) {
+		dev_addr = cfg->dst_addr;
+		width = cfg->dst_addr_width;
+	} else {
+		return NULL;
+	}
+
+	if (!dev_addr) {
+		dev_err(chan->pdma->dma_dev.dev,
+			"ch(%u) slave address not configured\n", chan->id);
+		return NULL;
+	}
+
+	desc = sf_pdma_alloc_desc(sf_pdma_count_segs(sgl, sg_len));
+	if (!desc)
+		return NULL;
+
+	/* Limit bus transactions to the width the peripheral accepts */
+	if (width == DMA_SLAVE_BUSWIDTH_UNDEFINED) {
+		desc->xfer_type = PDMA_FULL_SPEED;
+	} else {
+		size = ilog2(width);
+		desc->xfer_type = (size << PDMA_RSIZE_SHIFT) |
+				  (size << PDMA_WSIZE_SHIFT);
+	}
+
+	for_each_sg(sgl, sg, sg_len, i) {
+		addr = sg_dma_address(sg);
+		len = sg_dma_len(sg);
+
+		if (seg && addr == next) {
+			seg->xfer_size += len;
+		} else {
+			seg = &desc->segs[n++];
+			if (dir == DMA_DEV_TO_MEM) {
+				seg->src_addr = dev_addr;
+				seg->dst_addr = addr;
+			} else {
+				seg->src_addr = addr;
+				seg->dst_addr = dev_addr;
+			}
+			seg->xfer_size = len;
+		}
+
+		next = addr + len;
+		dev_addr += len;
+		desc->total += len;
+	}
+
+	return vchan_tx_prep(&chan->vchan, &desc->vdesc, flags);
+}
+
+static int sf_pdma_slave_config(struct dma_chan *dchan,
+				struct dma_slave_config *cfg)
+{
+	struct sf_pdma_chan *chan = to_sf_pdma_chan(dchan);
+
+	memcpy(&chan->cfg, cfg, sizeof(*cfg));
+
+	return 0;
+}
+
+static int sf_pdma_alloc_chan_resources(struct dma_chan *dchan)
+{
+	struct sf_pdma_chan *chan = to_sf_pdma_chan(dchan);
+
+	dma_cookie_init(dchan);
+	writel(PDMA_CLAIM_MASK, chan->regs.ctrl);
+
+	return 0;
+}
+
+static void sf_pdma_disclaim_chan(struct sf_pdma_chan *chan)
+{
+	writel(PDMA_CLEAR_CTRL, chan->regs.ctrl);
+}
+
+static void sf_pdma_free_chan_resources(struct dma_chan *dchan)
+{
+	struct sf_pdma_chan *chan = to_sf_pdma_chan(dchan);
+	unsigned long flags;
+	LIST_HEAD(head);
+
+	spin_lock_irqsave(&chan->vchan.lock, flags);
+	sf_pdma_disclaim_chan(chan);
+	if (chan->desc) {
+		sf_pdma_free_desc(&chan->desc->vdesc);
+		chan->desc = NULL;
+	}
+	vchan_get_all_descriptors(&chan->vchan, &head);
+	spin_unlock_irqrestore(&chan->vchan.lock, flags);
+
+	vchan_dma_desc_free_list(&chan->vchan, &head);
+}
+
+static enum dma_status sf_pdma_tx_status(struct dma_chan *dchan,
+					 dma_cookie_t cookie,
+					 struct dma_tx_state *txstate)
+{
+	struct sf_pdma_chan *chan = to_sf_pdma_chan(dchan);
+	struct virt_dma_desc *vdesc;
+	enum dma_status status;
+	unsigned long flags;
+	u64 residue = 0;
+
+	status = dma_cookie_status(dchan, cookie, txstate);
+	if (status == DMA_COMPLETE || !txstate)
+		return status;
+
+	spin_lock_irqsave(&chan->vchan.lock, flags);
+	if (chan->desc && chan->desc->vdesc.tx.cookie == cookie) {
+		residue = sf_pdma_inflight_residue(chan);
+	} else {
+		vdesc = vchan_find_desc(&chan->vchan, cookie);
+		if (vdesc)
+			residue = to_sf_pdma_desc(vdesc)->total;
+	}
+	spin_unlock_irqrestore(&chan->vchan.lock, flags);
+
+	dma_set_residue(txstate, residue);
+
+	return status;
+}
+
+static int sf_pdma_terminate_all(struct dma_chan *dchan)
+{
+	struct sf_pdma_chan *chan = to_sf_pdma_chan(dchan);
+	unsigned long flags;
+	LIST_HEAD(head);
+
+	spin_lock_irqsave(&chan->vchan.lock, flags);
+	/* Dropping RUN while keeping CLAIM aborts the current transfer */
+	writel(PDMA_CLAIM_MASK, chan->regs.ctrl);
+	if (chan->desc) {
+		vchan_terminate_vdesc(&chan->desc->vdesc);
+		chan->desc = NULL;
+	}
+	vchan_get_all_descriptors(&chan->vchan, &head);
+	spin_unlock_irqrestore(&chan->vchan.lock, flags);
+
+	vchan_dma_desc_free_list(&chan->vchan, &head);
+
+	return 0;
+}
+
+static void sf_pdma_synchronize(struct dma_chan *dchan)
+{
+	vchan_synchronize(to_virt_chan(dchan));
+}
+
+static void sf_pdma_issue_pending(struct dma_chan *dchan)
+{
+	struct sf_pdma_chan *chan = to_sf_pdma_chan(dchan);
+	unsigned long flags;
+
+	spin_lock_irqsave(&chan->vchan.lock, flags);
+	if (vchan_issue_pending(&chan->vchan) && !chan->desc)
+		sf_pdma_start_next(chan);
+	spin_unlock_irqrestore(&chan->vchan.lock, flags);
+}
+
+static irqreturn_t sf_pdma_done_isr(int irq, void *dev_id)
+{
+	struct sf_pdma_chan *chan = dev_id;
+	struct pdma_regs *regs = &chan->regs;
+	struct sf_pdma_desc *desc;
+	u32 ctrl;
+
+	spin_lock(&chan->vchan.lock);
+
+	ctrl = readl(regs->ctrl);
+	if (!(ctrl & PDMA_DONE_STATUS_MASK)) {
+		spin_unlock(&chan->vchan.lock);
+		return IRQ_NONE;
+	}
+	writel(ctrl & ~PDMA_DONE_STATUS_MASK, regs->ctrl);
+
+	desc = chan->desc;
+	if (desc) {
+		/* Chain the next segment straight from the interrupt */
+		if (++desc->cur_seg < desc->nsegs) {
+			chan->retries = 0;
+			sf_pdma_xfer_seg(chan);
+		} else {
+			vchan_cookie_complete(&desc->vdesc);
+			sf_pdma_start_next(chan);
+		}
+	}
+
+	spin_unlock(&chan->vchan.lock);
+
+	return IRQ_HANDLED;
+}
+
+static irqreturn_t sf_pdma_err_isr(int irq, void *dev_id)
+{
+	struct sf_pdma_chan *chan = dev_id;
+	struct pdma_regs *regs = &chan->regs;
+	struct sf_pdma_desc *desc;
+	u32 ctrl;
+
+	spin_lock(&chan->vchan.lock);
+
+	ctrl = readl(regs->ctrl);
+	if (!(ctrl & PDMA_ERR_STATUS_MASK)) {
+		spin_unlock(&chan->vchan.lock);
+		return IRQ_NONE;
+	}
+	writel(ctrl & ~PDMA_ERR_STATUS_MASK, regs->ctrl);
+
+	desc = chan->desc;
+	if (desc) {
+		if (chan->retries < PDMA_MAX_RETRIES) {
+			chan->retries++;
+			sf_pdma_xfer_seg(chan);
+		} else {
+			dev_err_ratelimited(chan->pdma->dma_dev.dev,
+					    "ch(%u) transfer failed\n",
+					    chan->id);
+			desc->vdesc.tx_result.result = DMA_TRANS_ABORTED;
+			desc->vdesc.tx_result.residue =
+				sf_pdma_inflight_residue(chan);
+			vchan_cookie_complete(&desc->vdesc);
+			sf_pdma_start_next(chan);
+		}
+	}
+
+	spin_unlock(&chan->vchan.lock);
+
+	return IRQ_HANDLED;
+}
+
+static int sf_pdma_chan_init(struct platform_device *pdev,
+			     struct sf_pdma *pdma, unsigned int i)
+{
+	struct sf_pdma_chan *chan = &pdma->chans[i];
+	int irq, ret;
+
+	chan->pdma = pdma;
+	chan->id = i;
+
+	chan->regs.ctrl = PDMA_REG_BASE(i) + PDMA_CTRL;
+	chan->regs.xfer_type = PDMA_REG_BASE(i) + PDMA_XFER_TYPE;
+	chan->regs.xfer_size = PDMA_REG_BASE(i) + PDMA_XFER_SIZE;
+	chan->regs.dst_addr = PDMA_REG_BASE(i) + PDMA_DST_ADDR;
+	chan->regs.src_addr = PDMA_REG_BASE(i) + PDMA_SRC_ADDR;
+	chan->regs.act_type = PDMA_REG_BASE(i) + PDMA_ACT_TYPE;
+	chan->regs.residue = PDMA_REG_BASE(i) + PDMA_REMAINING_BYTE;
+	chan->regs.cur_dst_addr = PDMA_REG_BASE(i) + PDMA_CUR_DST_ADDR;
+	chan->regs.cur_src_addr = PDMA_REG_BASE(i) + PDMA_CUR_SRC_ADDR;
+
+	irq = platform_get_irq(pdev, i * 2);
+	if (irq < 0)
+		return irq;
+	chan->txirq = irq;
+
+	ret = devm_request_irq(&pdev->dev, irq, sf_pdma_done_isr, 0,
+			       dev_name(&pdev->dev), chan);
+	if (ret) {
+		dev_err(&pdev->dev, "ch(%u) Can't request done irq.\n", i);
+		return ret;
+	}
+
+	irq = platform_get_irq(pdev, (i * 2) + 1);
+	if (irq < 0)
+		return irq;
+	chan->errirq = irq;
+
+	ret = devm_request_irq(&pdev->dev, irq, sf_pdma_err_isr, 0,
+			       dev_name(&pdev->dev), chan);
+	if (ret) {
+		dev_err(&pdev->dev, "ch(%u) Can't request err irq.\n", i);
+		return ret;
+	}
+
+	chan->vchan.desc_free = sf_pdma_free_desc;
+	vchan_init(&chan->vchan, &pdma->dma_dev);
+
+	return 0;
+}
+
+static struct dma_chan *sf_pdma_of_xlate(struct of_phandle_args *dma_spec,
+					 struct of_dma *ofdma)
+{
+	struct sf_pdma *pdma = ofdma->of_dma_data;
+	unsigned int i;
+
+	if (dma_spec->args_count != 1)
+		return NULL;
+
+	i = dma_spec->args[0];
+	if (i >= PDMA_NR_CH || !(pdma->chan_mask & BIT(i)))
+		return NULL;
+
+	return dma_get_slave_channel(&pdma->chans[i].vchan.chan);
+}
+
+static int sf_pdma_probe(struct platform_device *pdev)
+{
+	struct device *dev = &pdev->dev;
+	struct sf_pdma *pdma;
+	struct resource *res;
+	unsigned long mask;
+	unsigned int i;
+	int ret;
+
+	pdma = devm_kzalloc(dev, sizeof(*pdma), GFP_KERNEL);
+	if (!pdma)
+		return -ENOMEM;
+
+	/*
+	 * The register block may also be described by the UIO node, so map
+	 * it without claiming the region.
+	 */
+	res = platform_get_resource(pdev, IORESOURCE_MEM, 0);
+	if (!res)
+		return -EINVAL;
+
+	pdma->membase = devm_ioremap(dev, res->start, resource_size(res));
+	if (!pdma->membase)
+		return -ENOMEM;
+
+	pdma->chan_mask = GENMASK(PDMA_NR_CH - 1, 0);
+	of_property_read_u32(dev->of_node, "dma-channel-mask", &pdma->chan_mask);
+	pdma->chan_mask &= GENMASK(PDMA_NR_CH - 1, 0);
+	if (!pdma->chan_mask) {
+		dev_info(dev, "No channels assigned\n");
+		return -ENODEV;
+	}
+
+	INIT_LIST_HEAD(&pdma->dma_dev.channels);
+
+	mask = pdma->chan_mask;
+	for_each_set_bit(i, &mask, PDMA_NR_CH) {
+		ret = sf_pdma_chan_init(pdev, pdma, i);
+		if (ret)
+			return ret;
+	}
+
+	dma_cap_set(DMA_MEMCPY, pdma->dma_dev.cap_mask);
+	dma_cap_set(DMA_SLAVE, pdma->dma_dev.cap_mask);
+
+	pdma->dma_dev.dev = dev;
+	pdma->dma_dev.copy_align = 2;
+	pdma->dma_dev.src_addr_widths = PDMA_SLAVE_BUSWIDTHS;
+	pdma->dma_dev.dst_addr_widths = PDMA_SLAVE_BUSWIDTHS;
+	pdma->dma_dev.directions = BIT(DMA_DEV_TO_MEM) | BIT(DMA_MEM_TO_DEV) |
+				   BIT(DMA_MEM_TO_MEM);
+	pdma->dma_dev.residue_granularity = DMA_RESIDUE_GRANULARITY_BURST;
+
+	pdma->dma_dev.device_alloc_chan_resources =
+		sf_pdma_alloc_chan_resources;
+	pdma->dma_dev.device_free_chan_resources = sf_pdma_free_chan_resources;
+	pdma->dma_dev.device_prep_dma_memcpy = sf_pdma_prep_dma_memcpy;
+	pdma->dma_dev.device_prep_slave_sg = sf_pdma_prep_slave_sg;
+	pdma->dma_dev.device_config = sf_pdma_slave_config;
+	pdma->dma_dev.device_tx_status = sf_pdma_tx_status;
+	pdma->dma_dev.device_terminate_all = sf_pdma_terminate_all;
+	pdma->dma_dev.device_synchronize = sf_pdma_synchronize;
+	pdma->dma_dev.device_issue_pending = sf_pdma_issue_pending;
+
+	platform_set_drvdata(pdev, pdma);
+
+	ret = dma_set_mask_and_coherent(dev, DMA_BIT_MASK(64));
+	if (ret)
+		dev_warn(dev, "Failed to set DMA mask. Fall back to default.\n");
+
+	ret = dma_async_device_register(&pdma->dma_dev);
+	if (ret) {
+		dev_err(dev, "Can't register SiFive Platform DMA. (%d)\n", ret);
+		return ret;
+	}
+
+	ret = of_dma_controller_register(dev->of_node, sf_pdma_of_xlate, pdma);
+	if (ret)
+		dev_warn(dev, "Can't register DT DMA translation. (%d)\n", ret);
+
+	dev_info(dev, "Registered channel mask 0x%x\n", pdma->chan_mask);
+
+	return 0;
+}
+
+static int sf_pdma_remove(struct platform_device *pdev)
+{
+	struct sf_pdma *pdma = platform_get_drvdata(pdev);
+	unsigned long mask = pdma->chan_mask;
+	unsigned int i;
+
+	of_dma_controller_free(pdev->dev.of_node);
+	dma_async_device_unregister(&pdma->dma_dev);
+
+	for_each_set_bit(i, &mask, PDMA_NR_CH) {
+		struct sf_pdma_chan *chan = &pdma->chans[i];
+
+		devm_free_irq(&pdev->dev, chan->txirq, chan);
+		devm_free_irq(&pdev->dev, chan->errirq, chan);
+		sf_pdma_disclaim_chan(chan);
+		list_del(&chan->vchan.chan.device_node);
+		tasklet_kill(&chan->vchan.task);
+	}
+
+	return 0;
+}
+
+static const struct of_device_id sf_pdma_dt_ids[] = {
+	{ .compatible = "sifive,fu540-c000-pdma" },
+	{ .compatible = "microchip,mpfs-pdma" },
+	{},
+};
+MODULE_DEVICE_TABLE(of, sf_pdma_dt_ids);
+
+static struct platform_driver sf_pdma_driver = {
+	.probe		= sf_pdma_probe,
+	.remove		= sf_pdma_remove,
+	.driver		= {
+		.name	= "sf-pdma",
+		.of_match_table = of_match_ptr(sf_pdma_dt_ids),
+	},
+};
+
+static int __init sf_pdma_init(void)
+{
+	return platform_driver_register(&sf_pdma_driver);
+}
+
+static void __exit sf_pdma_exit(void)
+{
+	platform_driver_unregister(&sf_pdma_driver);
+}
+
+/* do early init */
+subsys_initcall(sf_pdma_init);
+module_exit(sf_pdma_exit);
+
+MODULE_LICENSE("GPL v2");
+MODULE_DESCRIPTION("SiFive Platform DMA driver");
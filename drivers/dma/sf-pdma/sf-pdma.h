@@ -0,0 +1,103 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+/*
+ * SiFive FU540 / PolarFire SoC Platform DMA driver
+ *
+ * Each PDMA channel executes one transfer at a time; the "next" registers
+ * are copied into the "exec" registers when the channel is run. Queued
+ * descriptors and multi-segment descriptors are chained in software from
+ * the done interrupt.
+ */
+#ifndef _SF_PDMA_H
+#define _SF_PDMA_H
+
+#include <linux/dmaengine.h>
+#include <linux/dma-direction.h>
+
+#include "../dmaengine.h"
+#include "../virt-dma.h"
+
+#define PDMA_NR_CH					4
+
+#define PDMA_CHAN_OFFSET				0x1000
+
+/* Register Offset */
+#define PDMA_CTRL					0x000
+#define PDMA_XFER_TYPE					0x004
+#define PDMA_XFER_SIZE					0x008
+#define PDMA_DST_ADDR					0x010
+#define PDMA_SRC_ADDR					0x018
+#define PDMA_ACT_TYPE					0x104 /* Read-only */
+#define PDMA_REMAINING_BYTE				0x108 /* Read-only */
+#define PDMA_CUR_DST_ADDR				0x110 /* Read-only*/
+#define PDMA_CUR_SRC_ADDR				0x118 /* Read-only*/
+
+/* CTRL */
+#define PDMA_CLEAR_CTRL					0x0
+#define PDMA_CLAIM_MASK					GENMASK(0, 0)
+#define PDMA_RUN_MASK					GENMASK(1, 1)
+#define PDMA_ENABLE_DONE_INT_MASK			GENMASK(14, 14)
+#define PDMA_ENABLE_ERR_INT_MASK			GENMASK(15, 15)
+#define PDMA_DONE_STATUS_MASK				GENMASK(30, 30)
+#define PDMA_ERR_STATUS_MASK				GENMASK(31, 31)
+
+/* Transfer Type */
+#define PDMA_WSIZE_SHIFT				24
+#define PDMA_RSIZE_SHIFT				28
+#define PDMA_FULL_SPEED					0xFF000000
+
+/* Error retry */
+#define PDMA_MAX_RETRIES				1
+
+#define PDMA_REG_BASE(ch)	(pdma->membase + (PDMA_CHAN_OFFSET * (ch)))
+
+struct pdma_regs {
+	/* read-write regs */
+	void __iomem *ctrl;		/* 4 bytes */
+
+	void __iomem *xfer_type;	/* 4 bytes */
+	void __iomem *xfer_size;	/* 8 bytes */
+	void __iomem *dst_addr;		/* 8 bytes */
+	void __iomem *src_addr;		/* 8 bytes */
+
+	/* read-only */
+	void __iomem *act_type;		/* 4 bytes */
+	void __iomem *residue;		/* 8 bytes */
+	void __iomem *cur_dst_addr;	/* 8 bytes */
+	void __iomem *cur_src_addr;	/* 8 bytes */
+};
+
+struct sf_pdma_seg {
+	dma_addr_t			src_addr;
+	dma_addr_t			dst_addr;
+	u64				xfer_size;
+};
+
+struct sf_pdma_desc {
+	struct virt_dma_desc		vdesc;
+	u32				xfer_type;
+	u64				total;
+	unsigned int			nsegs;
+	unsigned int			cur_seg;
+	struct sf_pdma_seg		segs[];
+};
+
+struct sf_pdma_chan {
+	struct virt_dma_chan		vchan;
+	struct sf_pdma			*pdma;
+	struct sf_pdma_desc		*desc;		/* in flight, vchan.lock */
+	struct dma_slave_config		cfg;
+	struct pdma_regs		regs;
+	unsigned int			id;
+	int				retries;
+	int				txirq;
+	int				errirq;
+};
+
+struct sf_pdma {
+	struct dma_device		dma_dev;
+	void __iomem			*membase;
+	u32				chan_mask;
+	struct sf_pdma_chan		chans[PDMA_NR_CH];
+};
+
+#endif /* _SF_PDMA_H */
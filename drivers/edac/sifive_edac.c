@@ -23,19 +23,23 @@ struct sifive_edac_priv {
  * EDAC error callback
  *
  * @event: non-zero if unrecoverable.
+ * @ptr: the struct sifive_l2_err_info, blocks are the directory and data
+ *	 arrays so that their counts show up separately in sysfs.
  */
 static
 int ecc_err_event(struct notifier_block *this, unsigned long event, void *ptr)
 {
-	const char *msg = (char *)ptr;
+	const struct sifive_l2_err_info *info = ptr;
 	struct sifive_edac_priv *p;
 
 	p = container_of(this, struct sifive_edac_priv, notifier);
 
 	if (event == SIFIVE_L2_ERR_TYPE_UE)
-		edac_device_handle_ue(p->dci, 0, 0, msg);
+		edac_device_handle_ue_count(p->dci, info->count, 0,
+					    info->block, info->msg);
 	else if (event == SIFIVE_L2_ERR_TYPE_CE)
-		edac_device_handle_ce(p->dci, 0, 0, msg);
+		edac_device_handle_ce_count(p->dci, info->count, 0,
+					    info->block, info->msg);
 
 	return NOTIFY_OK;
 }
@@ -51,8 +55,8 @@ static int ecc_register(struct platform_device *pdev)
 	p->notifier.notifier_call = ecc_err_event;
 	platform_set_drvdata(pdev, p);
 
-	p->dci = edac_device_alloc_ctl_info(0, "sifive_ecc", 1, "sifive_ecc",
-					    1, 1, NULL, 0,
+	p->dci = edac_device_alloc_ctl_info(0, "sifive_ecc", 1, "array",
+					    2, 0, NULL, 0,
 					    edac_device_alloc_index());
 	if (!p->dci)
 		return -ENOMEM;
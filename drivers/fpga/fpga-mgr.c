@@ -16,7 +16,12 @@
 #include <linux/mutex.h>
 #include <linux/slab.h>
 #include <linux/scatterlist.h>
+#include <linux/sizes.h>
 #include <linux/highmem.h>
+#include <linux/vmalloc.h>
+
+/* Piece of an image read at a time by fpga_mgr_firmware_stream() */
+#define FPGA_MGR_FW_CHUNK_SIZE	SZ_1M
 
 static DEFINE_IDA(fpga_mgr_ida);
 static struct class *fpga_mgr_class;
@@ -306,6 +311,73 @@ static int fpga_mgr_buf_load(struct fpga_manager *mgr,
 	return rc;
 }
 
+/*
+ * Read the image a chunk at a time with request_partial_firmware_into_buf(),
+ * writing each one out before reading the next, so that programming starts
+ * right away and memory use does not grow with the image. Drivers with a
+ * write op already take the image in pieces from fpga_mgr_buf_load_sg(), and
+ * see the same calls here. An image that fits in one chunk is loaded as a
+ * whole through fpga_mgr_buf_load().
+ */
+static int fpga_mgr_firmware_stream(struct fpga_manager *mgr,
+				    struct fpga_image_info *info,
+				    const char *image_name)
+{
+	struct device *dev = &mgr->dev;
+	const struct firmware *fw;
+	size_t offset = 0, size;
+	void *buf;
+	int ret;
+
+	buf = vmalloc(FPGA_MGR_FW_CHUNK_SIZE);
+	if (!buf)
+		return -ENOMEM;
+
+	do {
+		ret = request_partial_firmware_into_buf(&fw, image_name, dev,
+							buf,
+							FPGA_MGR_FW_CHUNK_SIZE,
+							offset);
+		if (ret) {
+			mgr->state = FPGA_MGR_STATE_FIRMWARE_REQ_ERR;
+			dev_err(dev, "Error requesting firmware %s at %zu\n",
+				image_name, offset);
+			goto out;
+		}
+		size = fw->size;
+		release_firmware(fw);
+
+		if (!offset) {
+			if (size < FPGA_MGR_FW_CHUNK_SIZE) {
+				ret = fpga_mgr_buf_load(mgr, info, buf, size);
+				goto out;
+			}
+
+			ret = fpga_mgr_write_init_buf(mgr, info, buf, size);
+			if (ret)
+				goto out;
+			mgr->state = FPGA_MGR_STATE_WRITE;
+		}
+
+		if (size) {
+			ret = mgr->mops->write(mgr, buf, size);
+			if (ret) {
+				dev_err(&mgr->dev, "Error while writing image data to FPGA\n");
+				mgr->state = FPGA_MGR_STATE_WRITE_ERR;
+				goto out;
+			}
+		}
+
+		offset += size;
+	} while (size == FPGA_MGR_FW_CHUNK_SIZE);
+
+	ret = fpga_mgr_write_complete(mgr, info);
+out:
+	vfree(buf);
+
+	return ret;
+}
+
 /**
  * fpga_mgr_firmware_load - request firmware and load to fpga
  * @mgr:	fpga manager
@@ -313,6 +385,7 @@ static int fpga_mgr_buf_load(struct fpga_manager *mgr,
  * @image_name:	name of image file on the firmware search path
  *
  * Request an FPGA image using the firmware class, then write out to the FPGA.
+ * Drivers with a write op get the image streamed, a chunk at a time.
  * Update the state before each step to provide info on what step failed if
  * there is a failure.  This code assumes the caller got the mgr pointer
  * from of_fpga_mgr_get() or fpga_mgr_get() and checked that it is not an error
@@ -332,6 +405,9 @@ static int fpga_mgr_firmware_load(struct fpga_manager *mgr,
 
 	mgr->state = FPGA_MGR_STATE_FIRMWARE_REQ;
 
+	if (mgr->mops->write)
+		return fpga_mgr_firmware_stream(mgr, info, image_name);
+
 	ret = request_firmware(&fw, image_name, dev);
 	if (ret) {
 		mgr->state = FPGA_MGR_STATE_FIRMWARE_REQ_ERR;
@@ -0,0 +1,346 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * FPGA Manager Driver for the Microchip PolarFire SoC fabric
+ *
+ * The fabric is programmed by the system controller from an image in the
+ * SPI flash it shares with the MSS. This driver streams the bitstream into
+ * the upgrade slot of that flash as it is read from the firmware loader,
+ * erasing just ahead of the write pointer, points the upgrade directory
+ * entry at it and has the system controller authenticate the result. The
+ * system controller then programs the new image into the fabric on the
+ * next reset.
+ */
+
+#include <linux/fpga/fpga-mgr.h>
+#include <linux/module.h>
+#include <linux/mtd/mtd.h>
+#include <linux/of.h>
+#include <linux/platform_device.h>
+#include <linux/scatterlist.h>
+#include <linux/sizes.h>
+#include <linux/slab.h>
+#include <asm/unaligned.h>
+#include <soc/microchip/mpfs.h>
+
+#define MPFS_FPGA_AUTHENTICATE_OPCODE	0x22u
+#define MPFS_FPGA_AUTHENTICATE_RESP_SIZE	1u
+
+/*
+ * SPI flash layout:
+ * 0x0000000  1 KiB directory, one 32-bit image address per slot
+ * 0x0000400  1 MiB reserved for bitstream information
+ * 0x0100400  golden image slot
+ * ...        upgrade image slot, erase block aligned
+ */
+#define MPFS_FPGA_DIRECTORY_BASE	0u
+#define MPFS_FPGA_DIRECTORY_SIZE	SZ_1K
+#define MPFS_FPGA_DIRECTORY_WIDTH	4u
+#define MPFS_FPGA_UPGRADE_INDEX		1u
+#define MPFS_FPGA_BLANK_INDEX		2u
+#define MPFS_FPGA_BITSTREAM_BASE	(MPFS_FPGA_DIRECTORY_SIZE + SZ_1M)
+#define MPFS_FPGA_SLOT_SIZE		(20 * SZ_1M)
+
+struct mpfs_fpga_priv {
+	struct device *dev;
+	struct mpfs_sys_controller *sys_controller;
+	const char *mtd_name;
+	struct mtd_info *mtd;
+	/* offsets into the flash while an image is being written */
+	loff_t image_base;
+	loff_t write_pos;
+	loff_t erased_to;
+	bool staged;
+};
+
+static enum fpga_mgr_states mpfs_fpga_ops_state(struct fpga_manager *mgr)
+{
+	struct mpfs_fpga_priv *priv = mgr->priv;
+
+	return priv->staged ? FPGA_MGR_STATE_OPERATING : FPGA_MGR_STATE_UNKNOWN;
+}
+
+static int mpfs_fpga_ops_write_init(struct fpga_manager *mgr,
+				    struct fpga_image_info *info,
+				    const char *buf, size_t count)
+{
+	struct mpfs_fpga_priv *priv = mgr->priv;
+	struct mtd_info *mtd;
+
+	if (info->flags & FPGA_MGR_PARTIAL_RECONFIG) {
+		dev_err(priv->dev, "Partial reconfiguration is not supported\n");
+		return -EOPNOTSUPP;
+	}
+
+	mtd = get_mtd_device_nm(priv->mtd_name);
+	if (IS_ERR(mtd)) {
+		dev_err(priv->dev, "Flash \"%s\" not found\n", priv->mtd_name);
+		return PTR_ERR(mtd);
+	}
+
+	priv->image_base = ALIGN(MPFS_FPGA_BITSTREAM_BASE + MPFS_FPGA_SLOT_SIZE,
+				 mtd->erasesize);
+	if (priv->image_base + MPFS_FPGA_SLOT_SIZE > mtd->size) {
+		dev_err(priv->dev, "Flash too small for an upgrade image\n");
+		put_mtd_device(mtd);
+		return -ENOSPC;
+	}
+
+	priv->mtd = mtd;
+	priv->write_pos = priv->image_base;
+	priv->erased_to = priv->image_base;
+	priv->staged = false;
+
+	return 0;
+}
+
+static int mpfs_fpga_erase_to(struct mpfs_fpga_priv *priv, loff_t end)
+{
+	struct erase_info erase = {
+		.addr = priv->erased_to,
+		.len = roundup(end - priv->erased_to, priv->mtd->erasesize),
+	};
+	int ret;
+
+	if (end <= priv->erased_to)
+		return 0;
+
+	ret = mtd_erase(priv->mtd, &erase);
+	if (ret)
+		return ret;
+
+	priv->erased_to = erase.addr + erase.len;
+
+	return 0;
+}
+
+static int mpfs_fpga_write_chunk(struct mpfs_fpga_priv *priv,
+				 const char *buf, size_t count)
+{
+	size_t retlen;
+	int ret;
+
+	if (priv->write_pos + count > priv->image_base + MPFS_FPGA_SLOT_SIZE)
+		return -EFBIG;
+
+	ret = mpfs_fpga_erase_to(priv, priv->write_pos + count);
+	if (ret)
+		return ret;
+
+	ret = mtd_write(priv->mtd, priv->write_pos, count, &retlen, buf);
+	if (!ret && retlen != count)
+		ret = -EIO;
+	if (ret)
+		return ret;
+
+	priv->write_pos += count;
+
+	return 0;
+}
+
+/*
+ * Called for each chunk as the FPGA manager core streams an image from the
+ * firmware loader, so the bitstream goes to flash while it is being read.
+ */
+static int mpfs_fpga_ops_write(struct fpga_manager *mgr, const char *buf,
+			       size_t count)
+{
+	struct mpfs_fpga_priv *priv = mgr->priv;
+	int ret;
+
+	ret = mpfs_fpga_write_chunk(priv, buf, count);
+	if (ret)
+		dev_err(priv->dev, "Writing image to flash failed: %d\n", ret);
+
+	return ret;
+}
+
+/*
+ * The image is never copied: each chunk of the scatterlist is written to
+ * the flash straight from the pages the FPGA manager core handed over.
+ */
+static int mpfs_fpga_ops_write_sg(struct fpga_manager *mgr,
+				  struct sg_table *sgt)
+{
+	struct mpfs_fpga_priv *priv = mgr->priv;
+	struct sg_mapping_iter miter;
+	int ret = 0;
+
+	sg_miter_start(&miter, sgt->sgl, sgt->nents, SG_MITER_FROM_SG);
+
+	while (sg_miter_next(&miter)) {
+		ret = mpfs_fpga_write_chunk(priv, miter.addr, miter.length);
+		if (ret)
+			break;
+	}
+
+	sg_miter_stop(&miter);
+
+	if (ret)
+		dev_err(priv->dev, "Writing image to flash failed: %d\n", ret);
+
+	return ret;
+}
+
+/*
+ * Point the upgrade directory entry at the new image and clear the entry
+ * after it, so that a stale image there cannot be selected.
+ */
+static int mpfs_fpga_update_directory(struct mpfs_fpga_priv *priv)
+{
+	struct mtd_info *mtd = priv->mtd;
+	struct erase_info erase = {
+		.addr = MPFS_FPGA_DIRECTORY_BASE,
+		.len = mtd->erasesize,
+	};
+	size_t retlen;
+	u8 *buffer;
+	int ret;
+
+	buffer = kmalloc(mtd->erasesize, GFP_KERNEL);
+	if (!buffer)
+		return -ENOMEM;
+
+	/* The first erase block also holds the golden entry and image info */
+	ret = mtd_read(mtd, MPFS_FPGA_DIRECTORY_BASE, mtd->erasesize, &retlen,
+		       buffer);
+	if (ret || retlen != mtd->erasesize)
+		goto out;
+
+	put_unaligned_le32(priv->image_base, buffer +
+			   MPFS_FPGA_UPGRADE_INDEX * MPFS_FPGA_DIRECTORY_WIDTH);
+	put_unaligned_le32(0, buffer +
+			   MPFS_FPGA_BLANK_INDEX * MPFS_FPGA_DIRECTORY_WIDTH);
+
+	ret = mtd_erase(mtd, &erase);
+	if (ret)
+		goto out;
+
+	ret = mtd_write(mtd, MPFS_FPGA_DIRECTORY_BASE, mtd->erasesize, &retlen,
+			buffer);
+	if (!ret && retlen != mtd->erasesize)
+		ret = -EIO;
+out:
+	kfree(buffer);
+
+	return ret;
+}
+
+static int mpfs_fpga_authenticate(struct mpfs_fpga_priv *priv)
+{
+	u32 response_msg[1] = { 0 };
+	struct mpfs_mss_response response = {
+		.resp_status = 0U,
+		.resp_msg = response_msg,
+		.resp_size = MPFS_FPGA_AUTHENTICATE_RESP_SIZE,
+	};
+	struct mpfs_mss_msg msg = {
+		.cmd_opcode = MPFS_FPGA_AUTHENTICATE_OPCODE,
+		.cmd_data_size = 0U,
+		.response = &response,
+		.cmd_data = NULL,
+		.mbox_offset = 0U,
+		.resp_offset = 0U,
+	};
+	int ret;
+
+	ret = mpfs_blocking_transaction(priv->sys_controller, &msg);
+	if (ret)
+		return ret;
+
+	if (response.resp_status || (response_msg[0] & 0xff)) {
+		dev_err(priv->dev, "Upgrade image authentication failed: %u\n",
+			response_msg[0] & 0xff);
+		return -EBADMSG;
+	}
+
+	return 0;
+}
+
+static int mpfs_fpga_ops_write_complete(struct fpga_manager *mgr,
+					struct fpga_image_info *info)
+{
+	struct mpfs_fpga_priv *priv = mgr->priv;
+	int ret;
+
+	ret = mpfs_fpga_update_directory(priv);
+	if (ret) {
+		dev_err(priv->dev, "Updating flash directory failed: %d\n", ret);
+		goto out;
+	}
+
+	ret = mpfs_fpga_authenticate(priv);
+	if (ret)
+		goto out;
+
+	priv->staged = true;
+	dev_info(priv->dev,
+		 "Upgrade image of %lld bytes staged, active after the next reset\n",
+		 priv->write_pos - priv->image_base);
+out:
+	put_mtd_device(priv->mtd);
+	priv->mtd = NULL;
+
+	return ret;
+}
+
+static const struct fpga_manager_ops mpfs_fpga_ops = {
+	.state = mpfs_fpga_ops_state,
+	.write_init = mpfs_fpga_ops_write_init,
+	.write = mpfs_fpga_ops_write,
+	.write_sg = mpfs_fpga_ops_write_sg,
+	.write_complete = mpfs_fpga_ops_write_complete,
+};
+
+static int mpfs_fpga_probe(struct platform_device *pdev)
+{
+	struct device_node *sys_controller_np;
+	struct device *dev = &pdev->dev;
+	struct mpfs_fpga_priv *priv;
+	struct fpga_manager *mgr;
+
+	priv = devm_kzalloc(dev, sizeof(*priv), GFP_KERNEL);
+	if (!priv)
+		return -ENOMEM;
+
+	priv->dev = dev;
+
+	sys_controller_np = of_parse_phandle(dev->of_node, "syscontroller", 0);
+	if (!sys_controller_np) {
+		dev_err(dev, "Failed to find mpfs system controller node\n");
+		return -ENODEV;
+	}
+
+	priv->sys_controller = mpfs_sys_controller_get(sys_controller_np);
+	of_node_put(sys_controller_np);
+	if (!priv->sys_controller)
+		return -EPROBE_DEFER;
+
+	priv->mtd_name = "fpga";
+	of_property_read_string(dev->of_node, "microchip,mtd-name",
+				&priv->mtd_name);
+
+	mgr = devm_fpga_mgr_create(dev, "Microchip PolarFire SoC FPGA Manager",
+				   &mpfs_fpga_ops, priv);
+	if (!mgr)
+		return -ENOMEM;
+
+	return devm_fpga_mgr_register(dev, mgr);
+}
+
+static const struct of_device_id mpfs_fpga_of_match[] = {
+	{ .compatible = "microchip,mpfs-fpga-mgr", },
+	{},
+};
+MODULE_DEVICE_TABLE(of, mpfs_fpga_of_match);
+
+static struct platform_driver mpfs_fpga_driver = {
+	.probe = mpfs_fpga_probe,
+	.driver = {
+		.name = "mpfs-fpga-mgr",
+		.of_match_table = mpfs_fpga_of_match,
+	},
+};
+module_platform_driver(mpfs_fpga_driver);
+
+MODULE_DESCRIPTION("Microchip PolarFire SoC FPGA Manager");
+MODULE_LICENSE("GPL v2");
@@ -53,6 +53,8 @@ struct microsemi_mss_gpio_chip {
 	MSS_GPIO_REG_TYPE __iomem *gpio_irq_base;
 	MSS_GPIO_REG_TYPE __iomem *gpio_in_base;
 	MSS_GPIO_REG_TYPE __iomem *gpio_out_base;
+	MSS_GPIO_REG_TYPE out_shadow;	/* last value written to out reg */
+	atomic_t irq_pending;		/* acked, not yet demuxed (threaded) */
 	unsigned int irq_parent[MSS_NUM_GPIO];
 };
 
@@ -76,6 +78,23 @@ static void microsemi_mss_gpio_assign_bit(MSS_GPIO_REG_TYPE *base_addr,
 	MSS_GPIO_IOWRITE(output, base_addr);
 }
 
+/*
+ * microsemi_mss_gpio_update_out() - update output register from shadow copy
+ * @mss_gpio: GPIO chip context, lock held
+ * @mask: output bits to change
+ * @bits: new values for the bits in @mask
+ *
+ * The output register is only written by this driver, so a shadow copy
+ * avoids the read back and every update is a single store.
+ */
+static void microsemi_mss_gpio_update_out(struct microsemi_mss_gpio_chip *mss_gpio,
+					  MSS_GPIO_REG_TYPE mask,
+					  MSS_GPIO_REG_TYPE bits)
+{
+	mss_gpio->out_shadow = (mss_gpio->out_shadow & ~mask) | (bits & mask);
+	MSS_GPIO_IOWRITE(mss_gpio->out_shadow, mss_gpio->gpio_out_base);
+}
+
 /*
  * microsemi_mss_gpio_direction_input() - set direction of GPIO port to input
  * @gc: GPIO chip pointer
@@ -140,8 +159,8 @@ static int microsemi_mss_gpio_direction_output(struct gpio_chip *gc,
 		MSS_GPIO_INDEX_TO_CFG(mss_gpio->gpio_cfg_base, gpio_index));
 
 	// write value to output once enabled
-	microsemi_mss_gpio_assign_bit(mss_gpio->gpio_out_base, gpio_index,
-		value);
+	microsemi_mss_gpio_update_out(mss_gpio, BIT(gpio_index),
+		value ? BIT(gpio_index) : 0);
 
 	raw_spin_unlock_irqrestore(&mss_gpio->lock, flags);
 
@@ -222,8 +241,48 @@ static void microsemi_mss_gpio_set_value(struct gpio_chip *gc,
 
 	raw_spin_lock_irqsave(&mss_gpio->lock, flags);
 
-	microsemi_mss_gpio_assign_bit(mss_gpio->gpio_out_base, gpio_index,
-		value);
+	microsemi_mss_gpio_update_out(mss_gpio, BIT(gpio_index),
+		value ? BIT(gpio_index) : 0);
+
+	raw_spin_unlock_irqrestore(&mss_gpio->lock, flags);
+}
+
+/*
+ * microsemi_mss_gpio_get_multiple() - get the values of several GPIO ports
+ * @gc: GPIO chip pointer
+ * @mask: ports to read
+ * @bits: returned port values
+ *
+ * All ports are sampled with one read of the input register.
+ */
+static int microsemi_mss_gpio_get_multiple(struct gpio_chip *gc,
+					   unsigned long *mask,
+					   unsigned long *bits)
+{
+	struct microsemi_mss_gpio_chip *mss_gpio = gpiochip_get_data(gc);
+
+	*bits &= ~*mask;
+	*bits |= MSS_GPIO_IOREAD(mss_gpio->gpio_in_base) & *mask;
+
+	return 0;
+}
+
+/*
+ * microsemi_mss_gpio_set_multiple() - set the values of several GPIO ports
+ * @gc: GPIO chip pointer
+ * @mask: ports to change
+ * @bits: new port values
+ */
+static void microsemi_mss_gpio_set_multiple(struct gpio_chip *gc,
+					    unsigned long *mask,
+					    unsigned long *bits)
+{
+	struct microsemi_mss_gpio_chip *mss_gpio = gpiochip_get_data(gc);
+	unsigned long flags;
+
+	raw_spin_lock_irqsave(&mss_gpio->lock, flags);
+
+	microsemi_mss_gpio_update_out(mss_gpio, *mask, *bits);
 
 	raw_spin_unlock_irqrestore(&mss_gpio->lock, flags);
 }
@@ -343,6 +402,26 @@ static struct irq_chip microsemi_mss_gpio_irqchip = {
 	.flags = IRQCHIP_MASK_ON_SUSPEND,
 };
 
+/*
+ * microsemi_mss_gpio_irq_ack_all() - latch and acknowledge pending IRQs
+ * @mss_gpio: GPIO chip context
+ *
+ * The status register is write-one-to-clear, so every pending line is
+ * acknowledged with a single store of the word that was read.
+ *
+ * Returns the pending lines
+ */
+static unsigned long microsemi_mss_gpio_irq_ack_all(struct microsemi_mss_gpio_chip *mss_gpio)
+{
+	MSS_GPIO_REG_TYPE status;
+
+	status = MSS_GPIO_IOREAD(mss_gpio->gpio_irq_base) & MSS_GPIO_IRQ_MASK;
+	if (status)
+		MSS_GPIO_IOWRITE(status, mss_gpio->gpio_irq_base);
+
+	return status;
+}
+
 /*
  * microsemi_mss_gpio_irq_handler() - generic edge/level IRQ handler for GPIO
  * interrupts
@@ -353,17 +432,15 @@ static void microsemi_mss_gpio_irq_handler(struct irq_desc *desc)
 	struct microsemi_mss_gpio_chip *mss_gpio =
 	    gpiochip_get_data(irq_desc_get_handler_data(desc));
 	struct irq_chip *irqchip = irq_desc_get_chip(desc);
-	MSS_GPIO_REG_TYPE status;
+	unsigned long status;
 	int offset;
 
 	chained_irq_enter(irqchip, desc);
 
-	status = MSS_GPIO_IOREAD(mss_gpio->gpio_irq_base) & MSS_GPIO_IRQ_MASK;
-	for_each_set_bit(offset, (const unsigned long *)&status,
-		mss_gpio->gc.ngpio) { 
+	status = microsemi_mss_gpio_irq_ack_all(mss_gpio);
+	for_each_set_bit(offset, &status, mss_gpio->gc.ngpio)
 		generic_handle_irq(irq_find_mapping(mss_gpio->gc.irq.domain,
 			offset));
-	}
 
 	chained_irq_exit(irqchip, desc);
 }
@@ -371,16 +448,52 @@ static void microsemi_mss_gpio_irq_handler(struct irq_desc *desc)
 static irqreturn_t microsemi_gpio_irq_handler(int irq, void *mss_gpio_data)
 {
 	struct microsemi_mss_gpio_chip *mss_gpio = mss_gpio_data;
-	MSS_GPIO_REG_TYPE status;
+	unsigned long status;
 	int offset;
-	status = MSS_GPIO_IOREAD(mss_gpio->gpio_irq_base) & MSS_GPIO_IRQ_MASK;
-	//MSS_GPIO_IOWRITE(0xFFFFFFFF, mss_gpio->gpio_irq_base);
-	for_each_set_bit(offset, (const unsigned long *)&status,
-		mss_gpio->gc.ngpio) { 
-		microsemi_mss_gpio_assign_bit(mss_gpio->gpio_irq_base, offset, 1);
+
+	status = microsemi_mss_gpio_irq_ack_all(mss_gpio);
+	if (!status)
+		return IRQ_NONE;
+
+	for_each_set_bit(offset, &status, mss_gpio->gc.ngpio)
 		generic_handle_irq(irq_find_mapping(mss_gpio->gc.irq.domain,
 			offset));
+
+	return IRQ_HANDLED;
+}
+
+/*
+ * Threaded mode: the hard handler only acknowledges and accumulates the
+ * pending lines, and one thread wake-up then runs the nested handlers of
+ * every line in the burst, including the gpio character device's edge
+ * event producers.
+ */
+static irqreturn_t microsemi_gpio_irq_quick_handler(int irq, void *mss_gpio_data)
+{
+	struct microsemi_mss_gpio_chip *mss_gpio = mss_gpio_data;
+	unsigned long status;
+
+	status = microsemi_mss_gpio_irq_ack_all(mss_gpio);
+	if (!status)
+		return IRQ_NONE;
+
+	atomic_or(status, &mss_gpio->irq_pending);
+
+	return IRQ_WAKE_THREAD;
+}
+
+static irqreturn_t microsemi_gpio_irq_thread(int irq, void *mss_gpio_data)
+{
+	struct microsemi_mss_gpio_chip *mss_gpio = mss_gpio_data;
+	unsigned long status;
+	int offset;
+
+	while ((status = (u32)atomic_xchg(&mss_gpio->irq_pending, 0))) {
+		for_each_set_bit(offset, &status, mss_gpio->gc.ngpio)
+			handle_nested_irq(irq_find_mapping(mss_gpio->gc.irq.domain,
+				offset));
 	}
+
 	return IRQ_HANDLED;
 }
 
@@ -438,12 +551,15 @@ static int microsemi_mss_gpio_probe(struct platform_device *pdev)
 	}
 
 	raw_spin_lock_init(&mss_gpio->lock);
+	mss_gpio->out_shadow = MSS_GPIO_IOREAD(mss_gpio->gpio_out_base);
 
 	mss_gpio->gc.direction_input = microsemi_mss_gpio_direction_input;
 	mss_gpio->gc.direction_output = microsemi_mss_gpio_direction_output;
 	mss_gpio->gc.get_direction = microsemi_mss_gpio_get_direction;
 	mss_gpio->gc.get = microsemi_mss_gpio_get_value;
 	mss_gpio->gc.set = microsemi_mss_gpio_set_value;
+	mss_gpio->gc.get_multiple = microsemi_mss_gpio_get_multiple;
+	mss_gpio->gc.set_multiple = microsemi_mss_gpio_set_multiple;
 	mss_gpio->gc.base = 0;
 	mss_gpio->gc.ngpio = ngpio;
 	mss_gpio->gc.label = dev_name(dev);
@@ -456,6 +572,7 @@ static int microsemi_mss_gpio_probe(struct platform_device *pdev)
 	irq_c->handler = handle_simple_irq;
 	irq_c->default_type = IRQ_TYPE_NONE;
 	irq_c->num_parents = 0;
+	irq_c->threaded = of_property_read_bool(node, "microsemi,threaded-irq");
 
 	irq = platform_get_irq(pdev, 0);
 
@@ -474,9 +591,16 @@ static int microsemi_mss_gpio_probe(struct platform_device *pdev)
 	if (ret)
 		return ret;
 
-	ret = devm_request_irq(mss_gpio->gc.parent, irq,
-			       microsemi_gpio_irq_handler,
-			       IRQF_SHARED, pdev->name, mss_gpio);
+	if (irq_c->threaded)
+		ret = devm_request_threaded_irq(mss_gpio->gc.parent, irq,
+						microsemi_gpio_irq_quick_handler,
+						microsemi_gpio_irq_thread,
+						IRQF_SHARED | IRQF_ONESHOT,
+						pdev->name, mss_gpio);
+	else
+		ret = devm_request_irq(mss_gpio->gc.parent, irq,
+				       microsemi_gpio_irq_handler,
+				       IRQF_SHARED, pdev->name, mss_gpio);
 	if (ret) {
 		dev_info(dev, "Microsemi MSS GPIO devm_request_irq failed \n");
 	}
@@ -99,6 +99,10 @@
  * @i2c_clk: clock reference for i2c input clock
  * @bus_clk_rate: current i2c bus clock rate
  * @buf: ptr to msg buffer for easier use.
+ * @msg_queue: next message of the transfer to start
+ * @total_num: number of messages in the transfer
+ * @current_num: number of messages started so far
+ * @restart_needed: end the current message with a repeated start
  * @isr_status: cached copy of local ISR status.
  * @lock: spinlock for IRQ synchronization.
  */
@@ -114,6 +118,10 @@ struct mpfs_i2c_dev {
 	u8 *buf;
 	u8 addr;
 	u32 msg_read;
+	struct i2c_msg *msg_queue;
+	u16 total_num;
+	u16 current_num;
+	bool restart_needed;
 	u32 isr_status;
 	spinlock_t lock;	/* IRQ synchronization */
 };
@@ -224,7 +232,8 @@ static void mpfs_i2c_empty_rx(struct mpfs_i2c_dev *idev)
 		idev->msg_len--;
 	}
 
-	if (idev->msg_len == 0) {
+	/* NACK the final byte so the slave releases the bus */
+	if (idev->msg_len <= 1) {
 		ctrl = readl(idev->base + MPFS_I2C_CTRL);
 		ctrl &= ~(1 << CTRL_AA);
 		writel(ctrl, idev->base + MPFS_I2C_CTRL);
@@ -239,9 +248,44 @@ static int mpfs_i2c_fill_tx(struct mpfs_i2c_dev *idev)
 	return 0;
 }
 
+/*
+ * Start the next message of the transfer from the current bus state, or
+ * complete the transfer once all messages are done or one has failed.
+ * Called with the lock held.
+ */
+static void mpfs_i2c_next_msg(struct mpfs_i2c_dev *idev)
+{
+	struct i2c_msg *msg;
+	u8 ctrl;
+
+	if (idev->msg_err || idev->current_num >= idev->total_num) {
+		idev->buf = NULL;
+		complete(&idev->msg_complete);
+		return;
+	}
+
+	msg = idev->msg_queue++;
+
+	/* A following read is chained with a repeated start, not a STOP */
+	if (idev->current_num < idev->total_num - 1)
+		idev->restart_needed = idev->msg_queue->flags & I2C_M_RD;
+	else
+		idev->restart_needed = false;
+
+	idev->addr = i2c_8bit_addr_from_msg(msg);
+	idev->msg_len = msg->len;
+	idev->buf = msg->buf;
+	idev->msg_read = (msg->flags & I2C_M_RD);
+	idev->current_num++;
+
+	ctrl = readl(idev->base + MPFS_I2C_CTRL);
+	ctrl |= (1 << CTRL_STA);
+	writel(ctrl, idev->base + MPFS_I2C_CTRL);
+}
+
 static irqreturn_t mpfs_i2c_handle_isr(int irq, void *_dev)
 {
-	bool read, finish = false;
+	bool last_byte = false, finished = false;
 	struct mpfs_i2c_dev *idev = _dev;
 	u32 status = idev->isr_status;
 	u8 ctrl;
@@ -251,8 +295,6 @@ static irqreturn_t mpfs_i2c_handle_isr(int irq, void *_dev)
 		return IRQ_HANDLED;
 	}
 
-	read = idev->msg_read ? 1 : 0;
-
 	switch (status) {
 	case STATUS_M_START_SENT:
 	case STATUS_M_REPEATED_START_SENT:
@@ -260,135 +302,181 @@ static irqreturn_t mpfs_i2c_handle_isr(int irq, void *_dev)
 		ctrl &= ~(1 << CTRL_STA);
 		writel(idev->addr, idev->base + MPFS_I2C_DATA);
 		writel(ctrl, idev->base + MPFS_I2C_CTRL);
-		if (idev->msg_len <= 0)
-			finish = true;
 		break;
 	case STATUS_M_ARB_LOST:
 		/* handle Lost Arbitration */
 		idev->msg_err = -EAGAIN;
-		finish = true;
+		finished = true;
 		break;
-	case  STATUS_M_SLAW_ACK:
-		if (idev->msg_len > 0) {
+	case STATUS_M_SLAW_ACK:
+	case STATUS_M_TX_DATA_ACK:
+		if (idev->msg_len > 0)
 			mpfs_i2c_fill_tx(idev);
-		} else {
-			/* On the last byte to be transmitted, send STOP */
-			mpfs_i2c_stop(idev);
-			finish = true;
-		}
+		else if (idev->restart_needed)
+			finished = true;
+		else
+			last_byte = true;
 		break;
 	case STATUS_M_TX_DATA_NACK:
-	case STATUS_M_RX_DATA_NACKED:
 	case STATUS_M_SLAR_NACK:
 	case STATUS_M_SLAW_NACK:
 		idev->msg_err = -ENXIO;
-		mpfs_i2c_stop(idev);
-		finish = true;
-		break;
-	case STATUS_M_TX_DATA_ACK:
-		if (idev->msg_len > 0) {
-			mpfs_i2c_fill_tx(idev);
-		} else {
-			/* On the last byte to be transmitted, send STOP */
-			mpfs_i2c_stop(idev);
-			finish = true;
-		}
+		last_byte = true;
 		break;
 	case STATUS_M_SLAR_ACK:
 		ctrl = readl(idev->base + MPFS_I2C_CTRL);
-		ctrl |= (1 << CTRL_AA);
+		if (idev->msg_len == 1)
+			ctrl &= ~(1 << CTRL_AA);
+		else
+			ctrl |= (1 << CTRL_AA);
 		writel(ctrl, idev->base + MPFS_I2C_CTRL);
-		if (idev->msg_len == 0) {
-			/* On the last byte to be transmitted, send STOP */
-			mpfs_i2c_stop(idev);
-			finish = true;
-		}
+		if (idev->msg_len == 0)
+			last_byte = true;
 		break;
 	case STATUS_M_RX_DATA_ACKED:
 		mpfs_i2c_empty_rx(idev);
-		if (idev->msg_len == 0) {
-			/* On the last byte to be transmitted, send STOP */
-			mpfs_i2c_stop(idev);
-			finish = true;
-		}
+		break;
+	case STATUS_M_RX_DATA_NACKED:
+		mpfs_i2c_empty_rx(idev);
+		if (idev->msg_len == 0)
+			last_byte = true;
 		break;
 	default:
 		break;
 	}
 
-	if (finish) {
-		ctrl = readl(idev->base + MPFS_I2C_CTRL);
-		ctrl &= ~(1 << CTRL_AA);
-		writel(ctrl, idev->base + MPFS_I2C_CTRL);
-		complete(&idev->msg_complete);
-	}
+	/* On the last byte to be transmitted, send STOP */
+	if (last_byte)
+		mpfs_i2c_stop(idev);
+
+	if (last_byte || finished)
+		mpfs_i2c_next_msg(idev);
 
 	return IRQ_HANDLED;
 }
 
-static irqreturn_t mpfs_i2c_isr(int irq, void *_dev)
+static irqreturn_t mpfs_i2c_service(struct mpfs_i2c_dev *idev)
 {
-	struct mpfs_i2c_dev *idev = _dev;
 	irqreturn_t ret = IRQ_NONE;
-	int si_bit = 0;
+	unsigned long flags;
+	u8 ctrl;
+
+	spin_lock_irqsave(&idev->lock, flags);
 
-	si_bit = readl(idev->base + MPFS_I2C_CTRL);
-	if (si_bit & (1 << CTRL_SI)) {
+	ctrl = readl(idev->base + MPFS_I2C_CTRL);
+	if (ctrl & (1 << CTRL_SI)) {
 		idev->isr_status = readl(idev->base + MPFS_I2C_STATUS);
-		ret = mpfs_i2c_handle_isr(irq, idev);
+		ret = mpfs_i2c_handle_isr(0, idev);
+
+		// Clear the si flag
+		mpfs_i2c_int_clear(idev);
 	}
 
-	// Clear the si flag
-	mpfs_i2c_int_clear(idev);
+	spin_unlock_irqrestore(&idev->lock, flags);
 
 	return ret;
 }
 
-static int mpfs_i2c_xfer_msg(struct mpfs_i2c_dev *idev, struct i2c_msg *msg)
+static irqreturn_t mpfs_i2c_isr(int irq, void *_dev)
 {
-	u8 ctrl;
-	unsigned long time_left;
+	return mpfs_i2c_service(_dev);
+}
 
-	if (msg->len == 0)
-		return -EINVAL;
+static void mpfs_i2c_start_xfer(struct mpfs_i2c_dev *idev,
+				struct i2c_msg *msgs, int num)
+{
+	unsigned long flags;
 
-	idev->addr = i2c_8bit_addr_from_msg(msg);
-	idev->msg_len = msg->len;
-	idev->buf = msg->buf;
-	idev->msg_err = 0;
-	idev->msg_read = (msg->flags & I2C_M_RD);
+	spin_lock_irqsave(&idev->lock, flags);
 
+	idev->msg_queue = msgs;
+	idev->total_num = num;
+	idev->current_num = 0;
+	idev->msg_err = 0;
 	reinit_completion(&idev->msg_complete);
 
 	mpfs_i2c_core_enable(idev);
+	mpfs_i2c_next_msg(idev);
 
-	ctrl = readl(idev->base + MPFS_I2C_CTRL);
+	spin_unlock_irqrestore(&idev->lock, flags);
+}
 
-	ctrl |= (1 << CTRL_STA);
+static int mpfs_i2c_end_xfer(struct mpfs_i2c_dev *idev, bool timed_out,
+			     int num)
+{
+	unsigned long flags;
 
-	writel(ctrl, idev->base + MPFS_I2C_CTRL);
+	if (!timed_out)
+		return idev->msg_err ? idev->msg_err : num;
+
+	/* Stop the state machine from walking a stale message array */
+	spin_lock_irqsave(&idev->lock, flags);
+	idev->buf = NULL;
+	idev->total_num = 0;
+	mpfs_i2c_reset(idev);
+	spin_unlock_irqrestore(&idev->lock, flags);
+
+	return -ETIMEDOUT;
+}
+
+static int mpfs_i2c_check_msgs(struct i2c_msg *msgs, int num)
+{
+	int i;
+
+	for (i = 0; i < num; i++)
+		if (msgs[i].len == 0)
+			return -EINVAL;
+
+	return 0;
+}
+
+/*
+ * The whole message array is walked from interrupt context, with repeated
+ * starts between messages, so a transfer costs a single wake-up.
+ */
+static int mpfs_i2c_xfer(struct i2c_adapter *adap, struct i2c_msg *msgs, int num)
+{
+	struct mpfs_i2c_dev *idev = i2c_get_adapdata(adap);
+	unsigned long time_left;
+	int ret;
+
+	ret = mpfs_i2c_check_msgs(msgs, num);
+	if (ret)
+		return ret;
+
+	mpfs_i2c_start_xfer(idev, msgs, num);
 
 	time_left = wait_for_completion_timeout(&idev->msg_complete,
 						MICROCHIP_I2C_TIMEOUT);
 
-	if (time_left == 0)
-		return -ETIMEDOUT;
+	return mpfs_i2c_end_xfer(idev, !time_left, num);
+}
+
+static bool mpfs_i2c_poll(struct mpfs_i2c_dev *idev)
+{
+	mpfs_i2c_service(idev);
 
-	return idev->msg_err;
+	return completion_done(&idev->msg_complete);
 }
 
-static int mpfs_i2c_xfer(struct i2c_adapter *adap, struct i2c_msg *msgs, int num)
+static int mpfs_i2c_xfer_atomic(struct i2c_adapter *adap,
+				struct i2c_msg *msgs, int num)
 {
 	struct mpfs_i2c_dev *idev = i2c_get_adapdata(adap);
-	int i, ret;
+	bool done;
+	int ret;
 
-	for (i = 0; i < num; i++) {
-		ret = mpfs_i2c_xfer_msg(idev, msgs++);
-		if (ret)
-			return ret;
-	}
+	ret = mpfs_i2c_check_msgs(msgs, num);
+	if (ret)
+		return ret;
+
+	mpfs_i2c_start_xfer(idev, msgs, num);
+
+	ret = read_poll_timeout_atomic(mpfs_i2c_poll, done, done, 1,
+				       jiffies_to_usecs(MICROCHIP_I2C_TIMEOUT),
+				       false, idev);
 
-	return num;
+	return mpfs_i2c_end_xfer(idev, ret, num);
 }
 
 static u32 mpfs_i2c_func(struct i2c_adapter *adap)
@@ -398,6 +486,7 @@ static u32 mpfs_i2c_func(struct i2c_adapter *adap)
 
 static const struct i2c_algorithm mpfs_i2c_algo = {
 	.master_xfer = mpfs_i2c_xfer,
+	.master_xfer_atomic = mpfs_i2c_xfer_atomic,
 	.functionality = mpfs_i2c_func,
 };
 
@@ -0,0 +1,102 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * RISC-V ACLINT supervisor software interrupt device (SSWI).
+ *
+ * The classic CLINT MSIP registers only raise machine-mode software
+ * interrupts, so an S-mode kernel has to ask the SBI firmware to deliver
+ * every IPI. When the firmware hands an SSWI device to the kernel, a store
+ * to the per-hart SETSSIP register raises the supervisor software
+ * interrupt on the target hart directly, without trapping to M-mode.
+ */
+
+#define pr_fmt(fmt) "aclint-sswi: " fmt
+#include <linux/io.h>
+#include <linux/irqchip.h>
+#include <linux/of.h>
+#include <linux/of_address.h>
+#include <linux/of_irq.h>
+#include <linux/smp.h>
+#include <asm/smp.h>
+
+/* One 32-bit SETSSIP register per hart context */
+#define SSWI_SETSSIP_STRIDE	4
+
+static void __iomem *sswi_setssip[NR_CPUS] __read_mostly;
+
+static void sswi_send_ipi(const struct cpumask *target)
+{
+	unsigned int cpu;
+
+	for_each_cpu(cpu, target)
+		writel(1, sswi_setssip[cpu]);
+}
+
+/*
+ * SETSSIP reads back as zero, there is nothing to clear in the device:
+ * riscv_clear_ipi() drops the pending bit from sip itself.
+ */
+static struct riscv_ipi_ops sswi_ipi_ops = {
+	.ipi_inject = sswi_send_ipi,
+};
+
+static int __init aclint_sswi_init(struct device_node *node,
+				   struct device_node *parent)
+{
+	unsigned int nr_cpus = 0;
+	void __iomem *base;
+	int i, nr_contexts;
+
+	nr_contexts = of_irq_count(node);
+	if (WARN_ON(!nr_contexts))
+		return -EINVAL;
+
+	base = of_iomap(node, 0);
+	if (WARN_ON(!base))
+		return -EIO;
+
+	for (i = 0; i < nr_contexts; i++) {
+		struct of_phandle_args irq;
+		int cpu, hartid;
+
+		if (of_irq_parse_one(node, i, &irq)) {
+			pr_err("failed to parse parent for context %d.\n", i);
+			continue;
+		}
+
+		if (irq.args[0] != RV_IRQ_SOFT)
+			continue;
+
+		hartid = riscv_of_parent_hartid(irq.np);
+		if (hartid < 0) {
+			pr_warn("failed to parse hart ID for context %d.\n", i);
+			continue;
+		}
+
+		cpu = riscv_hartid_to_cpuid(hartid);
+		if (cpu < 0) {
+			pr_warn("Invalid cpuid for context %d\n", i);
+			continue;
+		}
+
+		sswi_setssip[cpu] = base + i * SSWI_SETSSIP_STRIDE;
+		nr_cpus++;
+	}
+
+	/* Every possible CPU must be reachable, otherwise keep SBI IPIs */
+	for_each_possible_cpu(i) {
+		if (!sswi_setssip[i]) {
+			pr_warn("%pOFP: hart for cpu %d not wired, using SBI IPIs\n",
+				node, i);
+			iounmap(base);
+			return -ENODEV;
+		}
+	}
+
+	riscv_set_ipi_ops(&sswi_ipi_ops);
+
+	pr_info("%pOFP: direct IPIs for %u CPUs\n", node, nr_cpus);
+
+	return 0;
+}
+
+IRQCHIP_DECLARE(riscv_aclint_sswi, "riscv,aclint-sswi", aclint_sswi_init);
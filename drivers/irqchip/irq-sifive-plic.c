@@ -60,10 +60,15 @@
 #define	PLIC_DISABLE_THRESHOLD		0x7
 #define	PLIC_ENABLE_THRESHOLD		0
 
+/* Sources without an "riscv,irq-priority" entry all share this priority */
+#define	PLIC_DEFAULT_PRIORITY		1
+
 struct plic_priv {
 	struct cpumask lmask;
 	struct irq_domain *irqdomain;
 	void __iomem *regs;
+	/* priority written to each source while it is unmasked */
+	u8 *prio;
 };
 
 struct plic_handler {
@@ -76,10 +81,13 @@ struct plic_handler {
 	raw_spinlock_t		enable_lock;
 	void __iomem		*enable_base;
 	struct plic_priv	*priv;
+	/* sources routed to this context, protected by plic_route_lock */
+	unsigned int		nr_routed;
 };
 static int plic_parent_irq;
 static bool plic_cpuhp_setup_done;
 static DEFINE_PER_CPU(struct plic_handler, plic_handlers);
+static DEFINE_RAW_SPINLOCK(plic_route_lock);
 
 static inline void plic_toggle(struct plic_handler *handler,
 				int hwirq, int enable)
@@ -101,7 +109,8 @@ static inline void plic_irq_toggle(const struct cpumask *mask,
 	int cpu;
 	struct plic_priv *priv = irq_data_get_irq_chip_data(d);
 
-	writel(enable, priv->regs + PRIORITY_BASE + d->hwirq * PRIORITY_PER_ID);
+	writel(enable ? priv->prio[d->hwirq] : 0,
+	       priv->regs + PRIORITY_BASE + d->hwirq * PRIORITY_PER_ID);
 	for_each_cpu(cpu, mask) {
 		struct plic_handler *handler = per_cpu_ptr(&plic_handlers, cpu);
 
@@ -118,8 +127,11 @@ static void plic_irq_unmask(struct irq_data *d)
 	struct plic_priv *priv = irq_data_get_irq_chip_data(d);
 
 	cpumask_and(&amask, &priv->lmask, cpu_online_mask);
-	cpu = cpumask_any_and(irq_data_get_affinity_mask(d),
-					   &amask);
+	cpu = cpumask_first_and(irq_data_get_effective_affinity_mask(d),
+				&amask);
+	if (cpu >= nr_cpu_ids)
+		cpu = cpumask_any_and(irq_data_get_affinity_mask(d),
+				      &amask);
 	if (WARN_ON_ONCE(cpu >= nr_cpu_ids))
 		return;
 	plic_irq_toggle(cpumask_of(cpu), d, 1);
@@ -133,6 +145,47 @@ static void plic_irq_mask(struct irq_data *d)
 }
 
 #ifdef CONFIG_SMP
+/*
+ * Route the source to the context in @mask with the fewest sources routed
+ * to it already, so that a device set does not pile up on the first hart
+ * of the default affinity mask. The current target is kept when it is no
+ * busier than the best candidate.
+ */
+static unsigned int plic_pick_cpu(struct irq_data *d,
+				  const struct cpumask *mask)
+{
+	const struct cpumask *eff = irq_data_get_effective_affinity_mask(d);
+	unsigned int cpu, old, best = nr_cpu_ids;
+	unsigned int best_routed = UINT_MAX;
+
+	/* Don't count the source against the context it is leaving */
+	old = cpumask_weight(eff) == 1 ? cpumask_first(eff) : nr_cpu_ids;
+	if (old < nr_cpu_ids)
+		per_cpu_ptr(&plic_handlers, old)->nr_routed--;
+
+	if (old < nr_cpu_ids && cpumask_test_cpu(old, mask)) {
+		best = old;
+		best_routed = per_cpu_ptr(&plic_handlers, old)->nr_routed;
+	}
+
+	for_each_cpu(cpu, mask) {
+		unsigned int routed = per_cpu_ptr(&plic_handlers, cpu)->nr_routed;
+
+		if (routed < best_routed) {
+			best_routed = routed;
+			best = cpu;
+		}
+	}
+
+	/* Nothing suitable, the source stays where it was */
+	if (best >= nr_cpu_ids && old < nr_cpu_ids)
+		per_cpu_ptr(&plic_handlers, old)->nr_routed++;
+	else if (best < nr_cpu_ids)
+		per_cpu_ptr(&plic_handlers, best)->nr_routed++;
+
+	return best;
+}
+
 static int plic_set_affinity(struct irq_data *d,
 			     const struct cpumask *mask_val, bool force)
 {
@@ -142,10 +195,16 @@ static int plic_set_affinity(struct irq_data *d,
 
 	cpumask_and(&amask, &priv->lmask, mask_val);
 
-	if (force)
+	raw_spin_lock(&plic_route_lock);
+	if (force) {
 		cpu = cpumask_first(&amask);
-	else
-		cpu = cpumask_any_and(&amask, cpu_online_mask);
+		if (cpu < nr_cpu_ids)
+			cpu = plic_pick_cpu(d, cpumask_of(cpu));
+	} else {
+		cpumask_and(&amask, &amask, cpu_online_mask);
+		cpu = plic_pick_cpu(d, &amask);
+	}
+	raw_spin_unlock(&plic_route_lock);
 
 	if (cpu >= nr_cpu_ids)
 		return -EINVAL;
@@ -226,14 +285,16 @@ static void plic_handle_irq(struct irq_desc *desc)
 	struct plic_handler *handler = this_cpu_ptr(&plic_handlers);
 	struct irq_chip *chip = irq_desc_get_chip(desc);
 	void __iomem *claim = handler->hart_base + CONTEXT_CLAIM;
+	struct irq_domain *domain = handler->priv->irqdomain;
 	irq_hw_number_t hwirq;
 
 	WARN_ON_ONCE(!handler->present);
 
 	chained_irq_enter(chip, desc);
 
+	/* Drain every pending source, highest priority first, in one entry */
 	while ((hwirq = readl(claim))) {
-		int irq = irq_find_mapping(handler->priv->irqdomain, hwirq);
+		int irq = irq_find_mapping(domain, hwirq);
 
 		if (unlikely(irq <= 0))
 			pr_warn_ratelimited("can't find mapping for hwirq %lu\n",
@@ -273,6 +334,40 @@ static int plic_starting_cpu(unsigned int cpu)
 	return 0;
 }
 
+/*
+ * Optional "riscv,irq-priority" holds <hwirq priority> pairs. When several
+ * sources are pending the context claims the highest priority one first,
+ * the rest keep PLIC_DEFAULT_PRIORITY.
+ */
+static void __init plic_init_priorities(struct device_node *node,
+					struct plic_priv *priv, u32 nr_irqs)
+{
+	void __iomem *reg = priv->regs + PRIORITY_BASE + PRIORITY_PER_ID;
+	u32 hwirq, prio, max_prio;
+	int i, n;
+
+	/* Priority registers are WARL, the highest level reads back */
+	writel(~0U, reg);
+	max_prio = min_t(u32, readl(reg), U8_MAX);
+	writel(0, reg);
+
+	memset(priv->prio, PLIC_DEFAULT_PRIORITY, nr_irqs + 1);
+
+	n = of_property_count_u32_elems(node, "riscv,irq-priority");
+	for (i = 0; i + 1 < n; i += 2) {
+		of_property_read_u32_index(node, "riscv,irq-priority", i,
+					   &hwirq);
+		of_property_read_u32_index(node, "riscv,irq-priority", i + 1,
+					   &prio);
+		if (!hwirq || hwirq > nr_irqs || !prio || prio > max_prio) {
+			pr_warn("%pOFP: ignoring priority %u for hwirq %u\n",
+				node, prio, hwirq);
+			continue;
+		}
+		priv->prio[hwirq] = prio;
+	}
+}
+
 static int __init plic_init(struct device_node *node,
 		struct device_node *parent)
 {
@@ -301,10 +396,14 @@ static int __init plic_init(struct device_node *node,
 		goto out_iounmap;
 
 	error = -ENOMEM;
+	priv->prio = kcalloc(nr_irqs + 1, sizeof(*priv->prio), GFP_KERNEL);
+	if (!priv->prio)
+		goto out_iounmap;
+
 	priv->irqdomain = irq_domain_add_linear(node, nr_irqs + 1,
 			&plic_irqdomain_ops, priv);
 	if (WARN_ON(!priv->irqdomain))
-		goto out_iounmap;
+		goto out_free_prio;
 
 	for (i = 0; i < nr_contexts; i++) {
 		struct of_phandle_args parent;
@@ -369,6 +468,8 @@ static int __init plic_init(struct device_node *node,
 		nr_handlers++;
 	}
 
+	plic_init_priorities(node, priv, nr_irqs);
+
 	/*
 	 * We can have multiple PLIC instances so setup cpuhp state only
 	 * when context handler for current/boot CPU is present.
@@ -385,6 +486,8 @@ static int __init plic_init(struct device_node *node,
 		" %d contexts.\n", node, nr_irqs, nr_handlers, nr_contexts);
 	return 0;
 
+out_free_prio:
+	kfree(priv->prio);
 out_iounmap:
 	iounmap(priv->regs);
 out_free_priv:
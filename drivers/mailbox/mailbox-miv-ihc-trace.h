@@ -0,0 +1,76 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+/*
+ * Mi-V IHC tracepoints
+ *
+ * Both events carry the remote context, so that a histogram trigger can pair
+ * a message with its ACK. Round trip latency per remote context:
+ *
+ *   echo 'ihc_latency u32 context; u64 lat' >> synthetic_events
+ *   echo 'hist:keys=context:ts0=common_timestamp.usecs' >> \
+ *	events/miv_ihc/ihc_send/trigger
+ *   echo 'hist:keys=context:lat=common_timestamp.usecs-$ts0:onmatch(miv_ihc.ihc_send).trace(ihc_latency,context,$lat) if irq_type == 1' >> \
+ *	events/miv_ihc/ihc_rx/trigger
+ *   echo 'hist:keys=context,lat.log2' >> events/synthetic/ihc_latency/trigger
+ */
+#undef TRACE_SYSTEM
+#define TRACE_SYSTEM miv_ihc
+
+#if !defined(_MIV_IHC_TRACE_H_) || defined(TRACE_HEADER_MULTI_READ)
+#define _MIV_IHC_TRACE_H_
+
+#include <linux/tracepoint.h>
+
+TRACE_EVENT(ihc_send,
+
+	TP_PROTO(u32 context, u32 msg, u32 count, int ret),
+
+	TP_ARGS(context, msg, count, ret),
+
+	TP_STRUCT__entry(
+		__field(u32, context)
+		__field(u32, msg)
+		__field(u32, count)
+		__field(int, ret)
+	),
+
+	TP_fast_assign(
+		__entry->context = context;
+		__entry->msg = msg;
+		__entry->count = count;
+		__entry->ret = ret;
+	),
+
+	TP_printk("context=%u msg=0x%08x count=%u ret=%d",
+		  __entry->context, __entry->msg, __entry->count, __entry->ret)
+);
+
+TRACE_EVENT(ihc_rx,
+
+	TP_PROTO(u32 context, u8 irq_type, u32 msg),
+
+	TP_ARGS(context, irq_type, msg),
+
+	TP_STRUCT__entry(
+		__field(u32, context)
+		__field(u8, irq_type)
+		__field(u32, msg)
+	),
+
+	TP_fast_assign(
+		__entry->context = context;
+		__entry->irq_type = irq_type;
+		__entry->msg = msg;
+	),
+
+	TP_printk("context=%u %s msg=0x%08x", __entry->context,
+		  __print_symbolic(__entry->irq_type, { 0, "MP" }, { 1, "ACK" }),
+		  __entry->msg)
+);
+
+#endif /* _MIV_IHC_TRACE_H_ */
+
+#undef TRACE_INCLUDE_PATH
+#define TRACE_INCLUDE_PATH .
+#undef TRACE_INCLUDE_FILE
+#define TRACE_INCLUDE_FILE mailbox-miv-ihc-trace
+#include <trace/define_trace.h>
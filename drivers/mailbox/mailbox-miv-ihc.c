@@ -14,12 +14,18 @@
 #include <linux/module.h>
 #include <linux/kernel.h>
 #include <linux/interrupt.h>
+#include <linux/spinlock.h>
+#include <linux/ktime.h>
 #include <linux/platform_device.h>
 #include <linux/mailbox_controller.h>
 #include <asm/sbi.h>
 #include <linux/dma-mapping.h>
 #include <linux/dmapool.h>
 #include <linux/mailbox/miv_ihc_message.h>
+#include <soc/microchip/mpfs-msg-pmu.h>
+
+#define CREATE_TRACE_POINTS
+#include "mailbox-miv-ihc-trace.h"
 
 #define SBI_EXT_VENDOR_START			0x09000000
 #define MICROCHIP_TECHNOLOGY_MVENDOR_ID		0x029
@@ -30,13 +36,45 @@ enum {
 	SBI_EXT_IHC_INIT = 0x0,
 	SBI_EXT_IHC_TX = 0x1,
 	SBI_EXT_IHC_RX = 0x2,
+	SBI_EXT_IHC_TX_BATCH = 0x3,
+	SBI_EXT_IHC_RX_BATCH = 0x4,
 };
 
+/*
+ * Batched mode is opt-in through the "miv-ihc,batch-size" property, since it
+ * needs the SBI firmware to implement the *_BATCH calls. A batch size of 1
+ * keeps the original one-message-per-ecall behaviour.
+ */
+#define IHC_DEFAULT_BATCH_SIZE		1
+#define IHC_MAX_BATCH_SIZE		32
+
+/* Upper bounds of the optional "miv-ihc,poll-us" receive polling mode */
+#define IHC_MAX_POLL_US			1000
+#define IHC_POLL_BUDGET			64
+
 enum {
 	IHC_MP_IRQ = 0x0,
 	IHC_ACK_IRQ = 0x1,
 };
 
+/* perf events of the mpfs_ihc_<remote context> PMU */
+enum {
+	IHC_PMU_TX_MSGS,
+	IHC_PMU_RX_MSGS,
+	IHC_PMU_SBI_ECALLS,
+	IHC_PMU_ACKS,
+	IHC_PMU_ACK_WAIT_NS,
+	IHC_PMU_NUM_EVENTS,
+};
+
+static const char * const ihc_pmu_events[IHC_PMU_NUM_EVENTS] = {
+	[IHC_PMU_TX_MSGS]	= "tx_msgs",
+	[IHC_PMU_RX_MSGS]	= "rx_msgs",
+	[IHC_PMU_SBI_ECALLS]	= "sbi_ecalls",
+	[IHC_PMU_ACKS]		= "acks",
+	[IHC_PMU_ACK_WAIT_NS]	= "ack_wait_ns",
+};
+
 struct ihc_sbi_msg {
 	u8 irq_type;
 	struct miv_ihc_msg ihc_msg;
@@ -52,6 +90,17 @@ struct miv_ihc {
 	void			*write_buf;
 	void			*read_buf;
 	u32			remote_context_id;
+	u32			batch_size;
+	u32			poll_us;
+	/* batched tx state, protected by tx_lock */
+	spinlock_t		tx_lock;
+	struct tasklet_struct	txdone_tasklet;
+	u32			tx_count;
+	bool			tx_inflight;
+	bool			tx_held;
+	/* when the message or batch awaiting an ACK went out */
+	ktime_t			tx_stamp;
+	struct mpfs_msg_pmu	*pmu;
 };
 
 int ihc_sbi_send(u32 command, u32 remote_context_id, dma_addr_t address)
@@ -67,6 +116,20 @@ int ihc_sbi_send(u32 command, u32 remote_context_id, dma_addr_t address)
 		return ret.value;
 }
 
+static int ihc_sbi_send_batch(u32 command, u32 remote_context_id,
+			      dma_addr_t address, u32 count)
+{
+	struct sbiret ret;
+
+	ret = sbi_ecall(SBI_EXT_MICROCHIP_TECHNOLOGY, command, remote_context_id,
+			address, count, 0, 0, 0);
+
+	if (ret.error)
+		return sbi_err_map_linux_errno(ret.error);
+	else
+		return ret.value;
+}
+
 int ihc_sbi_init(u32 remote_context_id)
 {
 	struct sbiret ret;
@@ -88,44 +151,242 @@ static struct miv_ihc *mbox_chan_to_ihc(struct mbox_chan *chan)
 	return (struct miv_ihc *)chan->con_priv;
 }
 
-static irqreturn_t ihc_isr(int irq, void *data)
+/*
+ * Hand every message staged in write_buf to the remote context with a single
+ * ecall. Called with tx_lock held, and only when no batch is awaiting an ACK.
+ */
+static int ihc_flush_batch(struct miv_ihc *ihc)
 {
+	struct miv_ihc_msg *ring = ihc->write_buf;
 	int ret;
+
+	ret = ihc_sbi_send_batch(SBI_EXT_IHC_TX_BATCH, ihc->remote_context_id,
+				 ihc->write_dma, ihc->tx_count);
+	trace_ihc_send(ihc->remote_context_id, ring[0].msg[0], ihc->tx_count,
+		       ret);
+	mpfs_msg_pmu_add(ihc->pmu, IHC_PMU_SBI_ECALLS, 1);
+	if (ret < 0)
+		return ret;
+
+	mpfs_msg_pmu_add(ihc->pmu, IHC_PMU_TX_MSGS, ihc->tx_count);
+	ihc->tx_stamp = ktime_get();
+	ihc->tx_count = 0;
+	ihc->tx_inflight = true;
+
+	return 0;
+}
+
+static void ihc_txdone_tasklet(struct tasklet_struct *t)
+{
+	struct miv_ihc *ihc = from_tasklet(ihc, t, txdone_tasklet);
+
+	mbox_chan_txdone(&ihc->channel, 0);
+}
+
+static void ihc_tx_ack(struct miv_ihc *ihc)
+{
+	unsigned long flags;
+
+	mpfs_msg_pmu_add(ihc->pmu, IHC_PMU_ACKS, 1);
+	mpfs_msg_pmu_add(ihc->pmu, IHC_PMU_ACK_WAIT_NS,
+			 ktime_to_ns(ktime_sub(ktime_get(), ihc->tx_stamp)));
+
+	if (ihc->batch_size == 1) {
+		mbox_chan_txdone(&ihc->channel, 0);
+		return;
+	}
+
+	spin_lock_irqsave(&ihc->tx_lock, flags);
+
+	ihc->tx_inflight = false;
+
+	/* Anything queued while the previous batch was in flight goes now */
+	if (ihc->tx_count && ihc_flush_batch(ihc) < 0)
+		dev_warn_ratelimited(ihc->dev, "failed to flush tx batch\n");
+
+	if (ihc->tx_held && ihc->tx_count < ihc->batch_size) {
+		ihc->tx_held = false;
+		tasklet_schedule(&ihc->txdone_tasklet);
+	}
+
+	spin_unlock_irqrestore(&ihc->tx_lock, flags);
+}
+
+static bool ihc_handle_rx_msg(struct miv_ihc *ihc, struct ihc_sbi_msg *msg)
+{
+	if (msg->irq_type != IHC_MP_IRQ && msg->irq_type != IHC_ACK_IRQ)
+		return false;
+
+	trace_ihc_rx(ihc->remote_context_id, msg->irq_type,
+		     msg->ihc_msg.msg[0]);
+
+	if (msg->irq_type == IHC_MP_IRQ) {
+		mpfs_msg_pmu_add(ihc->pmu, IHC_PMU_RX_MSGS, 1);
+		mbox_chan_received_data(&ihc->channel, &msg->ihc_msg);
+	} else
+		ihc_tx_ack(ihc);
+
+	return true;
+}
+
+/* Returns the number of messages handled, or a negative error code */
+static int ihc_rx_batch(struct miv_ihc *ihc)
+{
+	struct ihc_sbi_msg *ring = ihc->read_buf;
 	struct ihc_sbi_msg sbi_rx_msg;
-	struct mbox_chan *chan = (struct mbox_chan *)data;
-	struct miv_ihc *ihc = mbox_chan_to_ihc(chan);
+	int i, ret, count = 0;
+
+	/* Init recv buffer to detect and skip unused slots */
+	memset(ihc->read_buf, 0xFF, ihc->batch_size * sizeof(*ring));
+
+	ret = ihc_sbi_send_batch(SBI_EXT_IHC_RX_BATCH, ihc->remote_context_id,
+				 ihc->read_dma, ihc->batch_size);
+	mpfs_msg_pmu_add(ihc->pmu, IHC_PMU_SBI_ECALLS, 1);
+	if (unlikely(ret < 0))
+		return ret;
+
+	for (i = 0; i < min_t(u32, ret, ihc->batch_size); i++) {
+		memcpy(&sbi_rx_msg, &ring[i], sizeof(struct ihc_sbi_msg));
+		count += ihc_handle_rx_msg(ihc, &sbi_rx_msg);
+	}
+
+	return count;
+}
+
+static int ihc_rx(struct miv_ihc *ihc)
+{
+	int ret;
+	struct ihc_sbi_msg sbi_rx_msg;
+
+	if (ihc->batch_size > 1)
+		return ihc_rx_batch(ihc);
 
 	/* Init recv buffer to detect and skip non-IHC IRQs */
 	memset(ihc->read_buf, 0xFF, sizeof(struct ihc_sbi_msg));
 
 	ret = ihc_sbi_send(SBI_EXT_IHC_RX, ihc->remote_context_id,
 			   ihc->read_dma);
+	mpfs_msg_pmu_add(ihc->pmu, IHC_PMU_SBI_ECALLS, 1);
+	if (unlikely(ret < 0))
+		return ret;
 
-	if (unlikely(ret < 0)) {
+	memcpy(&sbi_rx_msg, ihc->read_buf, sizeof(struct ihc_sbi_msg));
+
+	return ihc_handle_rx_msg(ihc, &sbi_rx_msg);
+}
+
+static irqreturn_t ihc_isr(int irq, void *data)
+{
+	struct mbox_chan *chan = (struct mbox_chan *)data;
+	struct miv_ihc *ihc = mbox_chan_to_ihc(chan);
+
+	if (unlikely(ihc_rx(ihc) < 0)) {
 		dev_warn_ratelimited(ihc->dev, "incorrect remote context ID\n");
 		return IRQ_NONE;
 	}
 
-	memcpy(&sbi_rx_msg, ihc->read_buf, sizeof(struct ihc_sbi_msg));
+	return IRQ_HANDLED;
+}
 
-	if (sbi_rx_msg.irq_type == IHC_MP_IRQ)
-		mbox_chan_received_data(&ihc->channel, &sbi_rx_msg.ihc_msg);
-	else if (sbi_rx_msg.irq_type == IHC_ACK_IRQ)
-		mbox_chan_txdone(&ihc->channel, 0);
+/*
+ * Low-latency receive: the interrupt is handled in a thread, which keeps
+ * polling the remote context for up to poll_us after the last message seen
+ * before letting the line be unmasked again, handling at most
+ * IHC_POLL_BUDGET messages per interrupt. Pinning the IRQ to a dedicated hart
+ * through its affinity also pins the polling thread. Client callbacks run in
+ * task context in this mode, so they may dispatch directly.
+ */
+static irqreturn_t ihc_isr_thread(int irq, void *data)
+{
+	struct mbox_chan *chan = (struct mbox_chan *)data;
+	struct miv_ihc *ihc = mbox_chan_to_ihc(chan);
+	unsigned int handled;
+	ktime_t timeout;
+	int ret;
+
+	ret = ihc_rx(ihc);
+	if (unlikely(ret < 0)) {
+		dev_warn_ratelimited(ihc->dev, "incorrect remote context ID\n");
+		return IRQ_NONE;
+	}
+
+	handled = ret;
+	timeout = ktime_add_us(ktime_get(), ihc->poll_us);
+	while (handled < IHC_POLL_BUDGET && ktime_before(ktime_get(), timeout)) {
+		ret = ihc_rx(ihc);
+		if (ret < 0)
+			break;
+
+		if (ret) {
+			handled += ret;
+			timeout = ktime_add_us(ktime_get(), ihc->poll_us);
+		} else {
+			cpu_relax();
+		}
+	}
 
 	return IRQ_HANDLED;
 }
 
+/*
+ * In batched mode the message is only staged in write_buf. The first message
+ * is flushed straight away; the ones that arrive while it awaits the remote
+ * ACK are sent together from ihc_tx_ack(). Tx done is reported to the
+ * framework as soon as a slot was taken so that the next message gets queued,
+ * except when the ring is full, in which case it is held until the next ACK.
+ */
+static int ihc_queue_data(struct miv_ihc *ihc, void *data)
+{
+	struct miv_ihc_msg *ring = ihc->write_buf;
+	unsigned long flags;
+	int ret = 0;
+
+	spin_lock_irqsave(&ihc->tx_lock, flags);
+
+	if (ihc->tx_count >= ihc->batch_size) {
+		ret = -EBUSY;
+		goto out;
+	}
+
+	memcpy(&ring[ihc->tx_count++], data, sizeof(struct miv_ihc_msg));
+
+	if (!ihc->tx_inflight) {
+		ret = ihc_flush_batch(ihc);
+		if (ret < 0) {
+			ihc->tx_count--;
+			goto out;
+		}
+	}
+
+	if (ihc->tx_count < ihc->batch_size)
+		tasklet_schedule(&ihc->txdone_tasklet);
+	else
+		ihc->tx_held = true;
+out:
+	spin_unlock_irqrestore(&ihc->tx_lock, flags);
+
+	return ret;
+}
+
 static int ihc_send_data(struct mbox_chan *chan, void *data)
 {
 	int ret;
 	struct miv_ihc *ihc = mbox_chan_to_ihc(chan);
 	struct ihc_msg *message = data;
 
+	if (ihc->batch_size > 1)
+		return ihc_queue_data(ihc, data);
+
 	memcpy(ihc->write_buf, message, sizeof(struct miv_ihc_msg));
 
+	ihc->tx_stamp = ktime_get();
 	ret = ihc_sbi_send(SBI_EXT_IHC_TX, ihc->remote_context_id,
 			   ihc->write_dma);
+	trace_ihc_send(ihc->remote_context_id,
+		       ((struct miv_ihc_msg *)data)->msg[0], 1, ret);
+	mpfs_msg_pmu_add(ihc->pmu, IHC_PMU_SBI_ECALLS, 1);
+	if (ret >= 0)
+		mpfs_msg_pmu_add(ihc->pmu, IHC_PMU_TX_MSGS, 1);
 
 	return ret;
 }
@@ -135,8 +396,13 @@ static int ihc_startup(struct mbox_chan *chan)
 	int ret;
 	struct miv_ihc *ihc = mbox_chan_to_ihc(chan);
 
-	ret = devm_request_irq(ihc->dev, ihc->irq, ihc_isr, 0,
-				"miv-ihc-irq", &ihc->channel);
+	if (ihc->poll_us)
+		ret = devm_request_threaded_irq(ihc->dev, ihc->irq, NULL,
+						ihc_isr_thread, IRQF_ONESHOT,
+						"miv-ihc-irq", &ihc->channel);
+	else
+		ret = devm_request_irq(ihc->dev, ihc->irq, ihc_isr, 0,
+				       "miv-ihc-irq", &ihc->channel);
 
 	if (ret)
 		dev_err(ihc->dev, "failed to register interrupt:%d\n", ret);
@@ -149,6 +415,7 @@ static void ihc_shutdown(struct mbox_chan *chan)
 	struct miv_ihc *ihc = mbox_chan_to_ihc(chan);
 
 	devm_free_irq(ihc->dev, ihc->irq, chan);
+	tasklet_kill(&ihc->txdone_tasklet);
 }
 static const struct mbox_chan_ops miv_ihc_ops = {
 	.startup = ihc_startup,
@@ -162,6 +429,7 @@ static int ihc_probe(struct platform_device *pdev)
 	struct device *dev = &pdev->dev;
 	struct device_node *np = dev->of_node;
 	struct dma_pool *pool;
+	const char *pmu_name;
 	int ret;
 
 	ret = sbi_probe_extension(SBI_EXT_MICROCHIP_TECHNOLOGY);
@@ -186,6 +454,17 @@ static int ihc_probe(struct platform_device *pdev)
 		goto fail;
 	}
 
+	if (of_property_read_u32(np, "miv-ihc,batch-size", &ihc->batch_size))
+		ihc->batch_size = IHC_DEFAULT_BATCH_SIZE;
+	ihc->batch_size = clamp_t(u32, ihc->batch_size, 1, IHC_MAX_BATCH_SIZE);
+
+	if (of_property_read_u32(np, "miv-ihc,poll-us", &ihc->poll_us))
+		ihc->poll_us = 0;
+	ihc->poll_us = min_t(u32, ihc->poll_us, IHC_MAX_POLL_US);
+
+	spin_lock_init(&ihc->tx_lock);
+	tasklet_setup(&ihc->txdone_tasklet, ihc_txdone_tasklet);
+
 	ihc->channel.con_priv = ihc;
 	ihc->dev = dev;
 
@@ -208,7 +487,8 @@ static int ihc_probe(struct platform_device *pdev)
 		goto fail;
 	}
 
-	pool = dma_pool_create("ihc", dev, sizeof(struct ihc_sbi_msg), 0, 0);
+	pool = dma_pool_create("ihc", dev,
+			       ihc->batch_size * sizeof(struct ihc_sbi_msg), 0, 0);
 	if (!pool) {
 		ret = -ENOMEM;
 		goto fail;
@@ -226,13 +506,24 @@ static int ihc_probe(struct platform_device *pdev)
 		goto fail_dealloc_write;
 	}
 
+	/* the counters are optional, the channel works without them */
+	pmu_name = devm_kasprintf(dev, GFP_KERNEL, "mpfs_ihc_%u",
+				  ihc->remote_context_id);
+	if (pmu_name)
+		ihc->pmu = devm_mpfs_msg_pmu_register(dev, pmu_name,
+						      ihc_pmu_events,
+						      IHC_PMU_NUM_EVENTS);
+	if (IS_ERR_OR_NULL(ihc->pmu))
+		dev_dbg(dev, "no perf counters\n");
+
 	ret = devm_mbox_controller_register(ihc->dev, &ihc->controller);
 	if (ret) {
 		dev_err(&pdev->dev, "Mi-V inter-hart communication (IHC) registered failed\n");
 		goto fail;
 	}
 
-	dev_info(&pdev->dev, "Mi-V inter-hart communication (IHC) registered\n");
+	dev_info(&pdev->dev, "Mi-V inter-hart communication (IHC) registered (batch size %u)\n",
+		 ihc->batch_size);
 
 	return 0;
 
@@ -0,0 +1,75 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+/*
+ * MPFS system controller mailbox tracepoints
+ *
+ * sysctrl_resp already carries the time the request spent queued and in
+ * service, so a latency histogram per service needs no synthetic event:
+ *
+ *   echo 'hist:keys=opcode,latency.log2' >> \
+ *	events/mpfs_mbox/sysctrl_resp/trigger
+ */
+#undef TRACE_SYSTEM
+#define TRACE_SYSTEM mpfs_mbox
+
+#if !defined(_MPFS_MBOX_TRACE_H_) || defined(TRACE_HEADER_MULTI_READ)
+#define _MPFS_MBOX_TRACE_H_
+
+#include <linux/tracepoint.h>
+
+TRACE_EVENT(sysctrl_req,
+
+	TP_PROTO(unsigned int chan, u8 opcode, u16 data_size,
+		 unsigned int depth),
+
+	TP_ARGS(chan, opcode, data_size, depth),
+
+	TP_STRUCT__entry(
+		__field(unsigned int, chan)
+		__field(u8, opcode)
+		__field(u16, data_size)
+		__field(unsigned int, depth)
+	),
+
+	TP_fast_assign(
+		__entry->chan = chan;
+		__entry->opcode = opcode;
+		__entry->data_size = data_size;
+		__entry->depth = depth;
+	),
+
+	TP_printk("chan=%u opcode=0x%02x size=%u depth=%u", __entry->chan,
+		  __entry->opcode, __entry->data_size, __entry->depth)
+);
+
+TRACE_EVENT(sysctrl_resp,
+
+	TP_PROTO(unsigned int chan, u8 opcode, u32 status, u64 latency),
+
+	TP_ARGS(chan, opcode, status, latency),
+
+	TP_STRUCT__entry(
+		__field(unsigned int, chan)
+		__field(u8, opcode)
+		__field(u32, status)
+		__field(u64, latency)
+	),
+
+	TP_fast_assign(
+		__entry->chan = chan;
+		__entry->opcode = opcode;
+		__entry->status = status;
+		__entry->latency = latency;
+	),
+
+	TP_printk("chan=%u opcode=0x%02x status=0x%x latency=%lluns",
+		  __entry->chan, __entry->opcode, __entry->status,
+		  __entry->latency)
+);
+
+#endif /* _MPFS_MBOX_TRACE_H_ */
+
+#undef TRACE_INCLUDE_PATH
+#define TRACE_INCLUDE_PATH .
+#undef TRACE_INCLUDE_FILE
+#define TRACE_INCLUDE_FILE mailbox-mpfs-trace
+#include <trace/define_trace.h>
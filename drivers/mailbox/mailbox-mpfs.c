@@ -13,10 +13,20 @@
 #include <linux/init.h>
 #include <linux/module.h>
 #include <linux/kernel.h>
+#include <linux/debugfs.h>
 #include <linux/interrupt.h>
+#include <linux/iopoll.h>
+#include <linux/ktime.h>
+#include <linux/math64.h>
 #include <linux/platform_device.h>
 #include <linux/mailbox_controller.h>
+#include <linux/seq_file.h>
+#include <linux/spinlock.h>
 #include <soc/microchip/mpfs.h>
+#include <soc/microchip/mpfs-msg-pmu.h>
+
+#define CREATE_TRACE_POINTS
+#include "mailbox-mpfs-trace.h"
 
 #define SERVICES_CR_OFFSET		0x50u
 #define SERVICES_SR_OFFSET		0x54u
@@ -58,15 +68,62 @@
 #define SCB_STATUS_POS (16)
 #define SCB_STATUS_MASK GENMASK(SCB_STATUS_POS + SCB_MASK_WIDTH, SCB_STATUS_POS)
 
+/*
+ * Every channel is a separate client of the one system controller. Requests
+ * from all channels are queued here and issued back to back, the next one as
+ * soon as the previous response has been drained from the mailbox. As the
+ * framework keeps at most one request in flight per channel, the queue never
+ * holds more than MPFS_MBOX_NUM_CHANS entries.
+ */
+#define MPFS_MBOX_NUM_CHANS		4
+#define MPFS_MBOX_BUSY_TIMEOUT_US	100
+
+struct mpfs_mbox_req {
+	struct mbox_chan *chan;
+	struct mpfs_mss_msg *msg;
+	ktime_t queued;
+};
+
+struct mpfs_mbox_stats {
+	u64 requests;
+	u64 completed;
+	u64 busy;
+	u64 latency_total_ns;
+	u64 latency_max_ns;
+	unsigned int depth_max;
+};
+
+/* perf events of the mpfs_sysctrl PMU, counted along with the stats */
+enum {
+	MPFS_MBOX_PMU_REQUESTS,
+	MPFS_MBOX_PMU_COMPLETED,
+	MPFS_MBOX_PMU_BUSY,
+	MPFS_MBOX_PMU_LATENCY_NS,
+	MPFS_MBOX_PMU_NUM_EVENTS,
+};
+
+static const char * const mpfs_mbox_pmu_events[MPFS_MBOX_PMU_NUM_EVENTS] = {
+	[MPFS_MBOX_PMU_REQUESTS]	= "requests",
+	[MPFS_MBOX_PMU_COMPLETED]	= "completed",
+	[MPFS_MBOX_PMU_BUSY]		= "busy",
+	[MPFS_MBOX_PMU_LATENCY_NS]	= "latency_ns",
+};
+
 struct mpfs_mbox {
 	struct mbox_controller controller;
 	struct device *dev;
 	int irq;
 	void __iomem *mbox_base;
 	void __iomem *int_reg;
-	struct mbox_chan chans[1];
-	struct mpfs_mss_response *response;
-	u16 resp_offset;
+	struct mbox_chan chans[MPFS_MBOX_NUM_CHANS];
+	/* request queue and stats, protected by queue_lock */
+	spinlock_t queue_lock;
+	struct mpfs_mbox_req queue[MPFS_MBOX_NUM_CHANS];
+	unsigned int queue_head;
+	unsigned int queue_len;
+	struct mpfs_mbox_stats stats;
+	struct dentry *debugfs;
+	struct mpfs_msg_pmu *pmu;
 };
 
 static bool mpfs_mbox_busy(struct mpfs_mbox *mbox)
@@ -78,20 +135,18 @@ static bool mpfs_mbox_busy(struct mpfs_mbox *mbox)
 	return status & SCB_STATUS_BUSY_MASK;
 }
 
-static int mpfs_mbox_send_data(struct mbox_chan *chan, void *data)
+static struct mpfs_mbox_req *mpfs_mbox_queue_entry(struct mpfs_mbox *mbox,
+						   unsigned int i)
+{
+	return &mbox->queue[(mbox->queue_head + i) % MPFS_MBOX_NUM_CHANS];
+}
+
+static void mpfs_mbox_issue(struct mpfs_mbox *mbox, struct mpfs_mss_msg *msg)
 {
-	struct mpfs_mbox *mbox = (struct mpfs_mbox *)chan->con_priv;
-	struct mpfs_mss_msg *msg = data;
 	u32 tx_trigger;
 	u16 opt_sel;
 	u32 val = 0u;
 
-	mbox->response = msg->response;
-	mbox->resp_offset = msg->resp_offset;
-
-	if (mpfs_mbox_busy(mbox))
-		return -EBUSY;
-
 	if (msg->cmd_data_size) {
 		u32 index;
 		u8 extra_bits = msg->cmd_data_size & 3;
@@ -122,14 +177,49 @@ static int mpfs_mbox_send_data(struct mbox_chan *chan, void *data)
 	tx_trigger = (opt_sel << SCB_CTRL_POS) & SCB_CTRL_MASK;
 	tx_trigger |= SCB_CTRL_REQ_MASK | SCB_STATUS_NOTIFY_MASK;
 	writel_relaxed(tx_trigger, mbox->mbox_base + SERVICES_CR_OFFSET);
-
-	return 0;
 }
 
-static void mpfs_mbox_rx_data(struct mbox_chan *chan)
+static int mpfs_mbox_send_data(struct mbox_chan *chan, void *data)
 {
 	struct mpfs_mbox *mbox = (struct mpfs_mbox *)chan->con_priv;
-	struct mpfs_mss_response *response = mbox->response;
+	struct mpfs_mss_msg *msg = data;
+	struct mpfs_mbox_req *req;
+	unsigned long flags;
+	int ret = 0;
+
+	spin_lock_irqsave(&mbox->queue_lock, flags);
+
+	if (mbox->queue_len == MPFS_MBOX_NUM_CHANS ||
+	    (!mbox->queue_len && mpfs_mbox_busy(mbox))) {
+		mbox->stats.busy++;
+		mpfs_msg_pmu_add(mbox->pmu, MPFS_MBOX_PMU_BUSY, 1);
+		ret = -EBUSY;
+		goto out;
+	}
+
+	req = mpfs_mbox_queue_entry(mbox, mbox->queue_len++);
+	req->chan = chan;
+	req->msg = msg;
+	req->queued = ktime_get();
+
+	mbox->stats.requests++;
+	mpfs_msg_pmu_add(mbox->pmu, MPFS_MBOX_PMU_REQUESTS, 1);
+	mbox->stats.depth_max = max(mbox->stats.depth_max, mbox->queue_len);
+	trace_sysctrl_req(chan - mbox->chans, msg->cmd_opcode,
+			  msg->cmd_data_size, mbox->queue_len);
+
+	/* the head of the queue is the request owning the hardware */
+	if (mbox->queue_len == 1)
+		mpfs_mbox_issue(mbox, msg);
+out:
+	spin_unlock_irqrestore(&mbox->queue_lock, flags);
+
+	return ret;
+}
+
+static void mpfs_mbox_rx_data(struct mpfs_mbox *mbox, struct mpfs_mss_msg *msg)
+{
+	struct mpfs_mss_response *response = msg->response;
 	u16 num_words = ALIGN((response->resp_size), (4)) / 4U;
 	u32 i;
 
@@ -142,46 +232,141 @@ static void mpfs_mbox_rx_data(struct mbox_chan *chan)
 		for (i = 0; i < num_words; i++) {
 			response->resp_msg[i] =
 				readl_relaxed(mbox->mbox_base + MAILBOX_REG_OFFSET
-					      + mbox->resp_offset + i * 0x4);
+					      + msg->resp_offset + i * 0x4);
 		}
 	}
+}
+
+static void mpfs_mbox_account(struct mpfs_mbox *mbox, struct mpfs_mbox_req *req)
+{
+	u64 latency = ktime_to_ns(ktime_sub(ktime_get(), req->queued));
+
+	trace_sysctrl_resp(req->chan - mbox->chans, req->msg->cmd_opcode,
+			   req->msg->response->resp_status, latency);
 
-	mbox_chan_received_data(chan, response);
+	mbox->stats.completed++;
+	mpfs_msg_pmu_add(mbox->pmu, MPFS_MBOX_PMU_COMPLETED, 1);
+	mpfs_msg_pmu_add(mbox->pmu, MPFS_MBOX_PMU_LATENCY_NS, latency);
+	mbox->stats.latency_total_ns += latency;
+	mbox->stats.latency_max_ns = max(mbox->stats.latency_max_ns, latency);
 }
 
 static irqreturn_t mpfs_mbox_inbox_isr(int irq, void *data)
 {
-	struct mbox_chan *chan = data;
-	struct mpfs_mbox *mbox = (struct mpfs_mbox *)chan->con_priv;
+	struct mpfs_mbox *mbox = data;
+	struct mpfs_mbox_req done, failed[MPFS_MBOX_NUM_CHANS];
+	unsigned int i, num_failed = 0;
+	u32 status;
 
 	writel_relaxed(0, mbox->int_reg);
 
-	mpfs_mbox_rx_data(chan);
+	spin_lock(&mbox->queue_lock);
+
+	if (!mbox->queue_len) {
+		spin_unlock(&mbox->queue_lock);
+		return IRQ_HANDLED;
+	}
+
+	done = *mpfs_mbox_queue_entry(mbox, 0);
+	mbox->queue_head = (mbox->queue_head + 1) % MPFS_MBOX_NUM_CHANS;
+	mbox->queue_len--;
+
+	/* drain the response before the next request reuses the mailbox */
+	mpfs_mbox_rx_data(mbox, done.msg);
+	mpfs_mbox_account(mbox, &done);
+
+	while (mbox->queue_len) {
+		struct mpfs_mbox_req *next = mpfs_mbox_queue_entry(mbox, 0);
+
+		if (!readl_relaxed_poll_timeout_atomic(mbox->mbox_base + SERVICES_SR_OFFSET,
+						       status,
+						       !(status & SCB_STATUS_BUSY_MASK),
+						       1, MPFS_MBOX_BUSY_TIMEOUT_US)) {
+			mpfs_mbox_issue(mbox, next->msg);
+			break;
+		}
+
+		mbox->stats.busy++;
+		mpfs_msg_pmu_add(mbox->pmu, MPFS_MBOX_PMU_BUSY, 1);
+		failed[num_failed++] = *next;
+		mbox->queue_head = (mbox->queue_head + 1) % MPFS_MBOX_NUM_CHANS;
+		mbox->queue_len--;
+	}
+
+	spin_unlock(&mbox->queue_lock);
+
+	mbox_chan_received_data(done.chan, done.msg->response);
+	mbox_chan_txdone(done.chan, 0);
+
+	for (i = 0; i < num_failed; i++)
+		mbox_chan_txdone(failed[i].chan, -EBUSY);
 
-	mbox_chan_txdone(chan, 0);
 	return IRQ_HANDLED;
 }
 
 static int mpfs_mbox_startup(struct mbox_chan *chan)
 {
 	struct mpfs_mbox *mbox = (struct mpfs_mbox *)chan->con_priv;
-	int ret = 0;
 
 	if (!mbox)
 		return -EINVAL;
 
-	ret = devm_request_irq(mbox->dev, mbox->irq, mpfs_mbox_inbox_isr, 0, "mpfs-mailbox", chan);
-	if (ret)
-		dev_err(mbox->dev, "failed to register mailbox interrupt:%d\n", ret);
-
-	return ret;
+	return 0;
 }
 
 static void mpfs_mbox_shutdown(struct mbox_chan *chan)
 {
 	struct mpfs_mbox *mbox = (struct mpfs_mbox *)chan->con_priv;
+	unsigned long flags;
+	unsigned int i, kept = 1;
+
+	spin_lock_irqsave(&mbox->queue_lock, flags);
 
-	devm_free_irq(mbox->dev, mbox->irq, chan);
+	/*
+	 * Drop requests of this channel that have not been issued yet, the
+	 * one at the head already owns the hardware and completes normally.
+	 */
+	for (i = 1; i < mbox->queue_len; i++) {
+		struct mpfs_mbox_req *req = mpfs_mbox_queue_entry(mbox, i);
+
+		if (req->chan != chan)
+			*mpfs_mbox_queue_entry(mbox, kept++) = *req;
+	}
+	if (mbox->queue_len)
+		mbox->queue_len = kept;
+
+	spin_unlock_irqrestore(&mbox->queue_lock, flags);
+}
+
+static int mpfs_mbox_stats_show(struct seq_file *s, void *unused)
+{
+	struct mpfs_mbox *mbox = s->private;
+	struct mpfs_mbox_stats stats;
+	unsigned int depth;
+
+	spin_lock_irq(&mbox->queue_lock);
+	stats = mbox->stats;
+	depth = mbox->queue_len;
+	spin_unlock_irq(&mbox->queue_lock);
+
+	seq_printf(s, "requests:\t%llu\n", stats.requests);
+	seq_printf(s, "completed:\t%llu\n", stats.completed);
+	seq_printf(s, "busy:\t\t%llu\n", stats.busy);
+	seq_printf(s, "depth:\t\t%u\n", depth);
+	seq_printf(s, "depth_max:\t%u\n", stats.depth_max);
+	seq_printf(s, "latency_avg_ns:\t%llu\n",
+		   stats.completed ? div64_u64(stats.latency_total_ns, stats.completed) : 0);
+	seq_printf(s, "latency_max_ns:\t%llu\n", stats.latency_max_ns);
+
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(mpfs_mbox_stats);
+
+static void mpfs_mbox_debugfs_remove(void *data)
+{
+	struct mpfs_mbox *mbox = data;
+
+	debugfs_remove_recursive(mbox->debugfs);
 }
 
 static const struct mbox_chan_ops mpfs_mbox_ops = {
@@ -194,7 +379,7 @@ static int mpfs_mbox_probe(struct platform_device *pdev)
 {
 	struct mpfs_mbox *mbox;
 	struct resource *regs;
-	int ret;
+	int i, ret;
 
 	mbox = devm_kzalloc(&pdev->dev, sizeof(*mbox), GFP_KERNEL);
 	if (!mbox)
@@ -213,14 +398,36 @@ static int mpfs_mbox_probe(struct platform_device *pdev)
 		return mbox->irq;
 
 	mbox->dev = &pdev->dev;
+	spin_lock_init(&mbox->queue_lock);
 
-	mbox->chans[0].con_priv = mbox;
+	for (i = 0; i < MPFS_MBOX_NUM_CHANS; i++)
+		mbox->chans[i].con_priv = mbox;
 	mbox->controller.dev = mbox->dev;
-	mbox->controller.num_chans = 1;
+	mbox->controller.num_chans = MPFS_MBOX_NUM_CHANS;
 	mbox->controller.chans = mbox->chans;
 	mbox->controller.ops = &mpfs_mbox_ops;
 	mbox->controller.txdone_irq = true;
 
+	ret = devm_request_irq(&pdev->dev, mbox->irq, mpfs_mbox_inbox_isr, 0,
+			       "mpfs-mailbox", mbox);
+	if (ret) {
+		dev_err(&pdev->dev, "failed to register mailbox interrupt:%d\n", ret);
+		return ret;
+	}
+
+	mbox->debugfs = debugfs_create_dir(dev_name(&pdev->dev), NULL);
+	debugfs_create_file("stats", 0444, mbox->debugfs, mbox,
+			    &mpfs_mbox_stats_fops);
+	ret = devm_add_action_or_reset(&pdev->dev, mpfs_mbox_debugfs_remove, mbox);
+	if (ret)
+		return ret;
+
+	mbox->pmu = devm_mpfs_msg_pmu_register(&pdev->dev, "mpfs_sysctrl",
+					       mpfs_mbox_pmu_events,
+					       MPFS_MBOX_PMU_NUM_EVENTS);
+	if (IS_ERR(mbox->pmu))
+		dev_dbg(&pdev->dev, "no perf counters\n");
+
 	ret = devm_mbox_controller_register(&pdev->dev, &mbox->controller);
 	if (ret) {
 		dev_err(&pdev->dev, "Registering MPFS mailbox controller failed\n");
@@ -246,6 +453,7 @@ static struct platform_driver mpfs_mbox_driver = {
 	.driver = {
 		.name = "mpfs-mailbox",
 		.of_match_table = mpfs_mbox_of_match,
+		.probe_type = PROBE_PREFER_ASYNCHRONOUS,
 	},
 	.probe = mpfs_mbox_probe,
 };
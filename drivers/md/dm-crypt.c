@@ -69,6 +69,7 @@ struct dm_crypt_io {
 	struct bio *base_bio;
 	u8 *integrity_metadata;
 	bool integrity_metadata_from_pool;
+	bool inline_crypt;	/* small enough to skip the workqueues */
 	struct work_struct work;
 	struct tasklet_struct tasklet;
 
@@ -131,7 +132,7 @@ struct iv_elephant_private {
 enum flags { DM_CRYPT_SUSPENDED, DM_CRYPT_KEY_VALID,
 	     DM_CRYPT_SAME_CPU, DM_CRYPT_NO_OFFLOAD,
 	     DM_CRYPT_NO_READ_WORKQUEUE, DM_CRYPT_NO_WRITE_WORKQUEUE,
-	     DM_CRYPT_WRITE_INLINE };
+	     DM_CRYPT_WRITE_INLINE, DM_CRYPT_INLINE };
 
 enum cipher_flags {
 	CRYPT_MODE_INTEGRITY_AEAD,	/* Use authenticated mode for cipher */
@@ -148,6 +149,10 @@ struct crypt_config {
 
 	struct percpu_counter n_allocated_pages;
 
+	/* bios converted in the context they came from, or queued, per dir */
+	struct percpu_counter n_inline_ios[2];
+	struct percpu_counter n_queued_ios[2];
+
 	struct workqueue_struct *io_queue;
 	struct workqueue_struct *crypt_queue;
 
@@ -196,6 +201,7 @@ struct crypt_config {
 	unsigned int per_bio_data_size;
 
 	unsigned long flags;
+	unsigned int inline_max_bytes;	/* 0: every bio goes to the workqueues */
 	unsigned int key_size;
 	unsigned int key_parts;      /* independent parts in key buffer */
 	unsigned int key_extra_size; /* additional keys length */
@@ -1122,6 +1128,16 @@ static bool crypt_integrity_hmac(struct crypt_config *cc)
 	return crypt_integrity_aead(cc) && cc->key_mac_size;
 }
 
+static bool crypt_cipher_async(struct crypt_config *cc)
+{
+	if (crypt_integrity_aead(cc))
+		return crypto_aead_alg(any_tfm_aead(cc))->base.cra_flags &
+		       CRYPTO_ALG_ASYNC;
+
+	return crypto_skcipher_alg(any_tfm(cc))->base.cra_flags &
+	       CRYPTO_ALG_ASYNC;
+}
+
 /* Get sg containing data */
 static struct scatterlist *crypt_get_sg_data(struct crypt_config *cc,
 					     struct scatterlist *sg)
@@ -1723,6 +1739,7 @@ static void crypt_io_init(struct dm_crypt_io *io, struct crypt_config *cc,
 	io->ctx.r.req = NULL;
 	io->integrity_metadata = NULL;
 	io->integrity_metadata_from_pool = false;
+	io->inline_crypt = false;
 	atomic_set(&io->io_pending, 0);
 }
 
@@ -1962,7 +1979,8 @@ static void kcryptd_crypt_write_io_submit(struct dm_crypt_io *io, int async)
 	clone->bi_iter.bi_sector = cc->start + io->sector;
 
 	if ((likely(!async) && test_bit(DM_CRYPT_NO_OFFLOAD, &cc->flags)) ||
-	    test_bit(DM_CRYPT_NO_WRITE_WORKQUEUE, &cc->flags)) {
+	    test_bit(DM_CRYPT_NO_WRITE_WORKQUEUE, &cc->flags) ||
+	    io->inline_crypt) {
 		submit_bio_noacct(clone);
 		return;
 	}
@@ -2066,7 +2084,8 @@ static void kcryptd_crypt_write_convert(struct dm_crypt_io *io)
 
 	crypt_inc_pending(io);
 	r = crypt_convert(cc, ctx,
-			  test_bit(DM_CRYPT_NO_WRITE_WORKQUEUE, &cc->flags), true);
+			  test_bit(DM_CRYPT_NO_WRITE_WORKQUEUE, &cc->flags) ||
+			  io->inline_crypt, true);
 	/*
 	 * Crypto API backlogged the request, because its queue was full
 	 * and we're in softirq context, so continue from a workqueue
@@ -2131,7 +2150,8 @@ static void kcryptd_crypt_read_convert(struct dm_crypt_io *io)
 			   io->sector);
 
 	r = crypt_convert(cc, &io->ctx,
-			  test_bit(DM_CRYPT_NO_READ_WORKQUEUE, &cc->flags), true);
+			  test_bit(DM_CRYPT_NO_READ_WORKQUEUE, &cc->flags) ||
+			  io->inline_crypt, true);
 	/*
 	 * Crypto API backlogged the request, because its queue was full
 	 * and we're in softirq context, so continue from a workqueue
@@ -2219,9 +2239,13 @@ static void kcryptd_crypt_tasklet(unsigned long work)
 static void kcryptd_queue_crypt(struct dm_crypt_io *io)
 {
 	struct crypt_config *cc = io->cc;
+	int rw = bio_data_dir(io->base_bio);
+
+	if ((rw == READ && test_bit(DM_CRYPT_NO_READ_WORKQUEUE, &cc->flags)) ||
+	    (rw == WRITE && test_bit(DM_CRYPT_NO_WRITE_WORKQUEUE, &cc->flags)) ||
+	    io->inline_crypt) {
+		percpu_counter_inc(&cc->n_inline_ios[rw]);
 
-	if ((bio_data_dir(io->base_bio) == READ && test_bit(DM_CRYPT_NO_READ_WORKQUEUE, &cc->flags)) ||
-	    (bio_data_dir(io->base_bio) == WRITE && test_bit(DM_CRYPT_NO_WRITE_WORKQUEUE, &cc->flags))) {
 		/*
 		 * in_irq(): Crypto API's skcipher_walk_first() refuses to work in hard IRQ context.
 		 * irqs_disabled(): the kernel may run some IO completion from the idle thread, but
@@ -2237,6 +2261,7 @@ static void kcryptd_queue_crypt(struct dm_crypt_io *io)
 		return;
 	}
 
+	percpu_counter_inc(&cc->n_queued_ios[rw]);
 	INIT_WORK(&io->work, kcryptd_crypt);
 	queue_work(cc->crypt_queue, &io->work);
 }
@@ -2683,6 +2708,7 @@ static void crypt_page_free(void *page, void *pool_data)
 static void crypt_dtr(struct dm_target *ti)
 {
 	struct crypt_config *cc = ti->private;
+	int i;
 
 	ti->private = NULL;
 
@@ -2707,6 +2733,10 @@ static void crypt_dtr(struct dm_target *ti)
 
 	WARN_ON(percpu_counter_sum(&cc->n_allocated_pages) != 0);
 	percpu_counter_destroy(&cc->n_allocated_pages);
+	for (i = 0; i < 2; i++) {
+		percpu_counter_destroy(&cc->n_inline_ios[i]);
+		percpu_counter_destroy(&cc->n_queued_ios[i]);
+	}
 
 	if (cc->iv_gen_ops && cc->iv_gen_ops->dtr)
 		cc->iv_gen_ops->dtr(cc);
@@ -3059,7 +3089,7 @@ static int crypt_ctr_optional(struct dm_target *ti, unsigned int argc, char **ar
 	struct crypt_config *cc = ti->private;
 	struct dm_arg_set as;
 	static const struct dm_arg _args[] = {
-		{0, 8, "Invalid number of feature args"},
+		{0, 9, "Invalid number of feature args"},
 	};
 	unsigned int opt_params, val;
 	const char *opt_string, *sval;
@@ -3093,7 +3123,13 @@ static int crypt_ctr_optional(struct dm_target *ti, unsigned int argc, char **ar
 			set_bit(DM_CRYPT_NO_READ_WORKQUEUE, &cc->flags);
 		else if (!strcasecmp(opt_string, "no_write_workqueue"))
 			set_bit(DM_CRYPT_NO_WRITE_WORKQUEUE, &cc->flags);
-		else if (sscanf(opt_string, "integrity:%u:", &val) == 1) {
+		else if (sscanf(opt_string, "inline_max_bytes:%u%c",
+				&cc->inline_max_bytes, &dummy) == 1) {
+			if (!cc->inline_max_bytes) {
+				ti->error = "Invalid feature value for inline_max_bytes";
+				return -EINVAL;
+			}
+		} else if (sscanf(opt_string, "integrity:%u:", &val) == 1) {
 			if (val == 0 || val > MAX_TAG_SIZE) {
 				ti->error = "Invalid integrity arguments";
 				return -EINVAL;
@@ -3162,6 +3198,7 @@ static int crypt_ctr(struct dm_target *ti, unsigned int argc, char **argv)
 	int ret;
 	size_t iv_size_padding, additional_req_size;
 	char dummy;
+	int i;
 
 	if (argc < 5) {
 		ti->error = "Not enough arguments";
@@ -3194,6 +3231,15 @@ static int crypt_ctr(struct dm_target *ti, unsigned int argc, char **argv)
 	if (ret < 0)
 		goto bad;
 
+	for (i = 0; i < 2; i++) {
+		ret = percpu_counter_init(&cc->n_inline_ios[i], 0, GFP_KERNEL);
+		if (ret < 0)
+			goto bad;
+		ret = percpu_counter_init(&cc->n_queued_ios[i], 0, GFP_KERNEL);
+		if (ret < 0)
+			goto bad;
+	}
+
 	/* Optional parameters need to be read before cipher constructor */
 	if (argc > 5) {
 		ret = crypt_ctr_optional(ti, argc - 5, &argv[5]);
@@ -3205,6 +3251,18 @@ static int crypt_ctr(struct dm_target *ti, unsigned int argc, char **argv)
 	if (ret < 0)
 		goto bad;
 
+	/*
+	 * An asynchronous cipher completes from its own context anyway, so
+	 * converting inline would only add waiting to the submitter.
+	 */
+	if (cc->inline_max_bytes) {
+		if (crypt_cipher_async(cc))
+			DMWARN("%s is asynchronous, inline_max_bytes ignored",
+			       cc->cipher_string);
+		else
+			set_bit(DM_CRYPT_INLINE, &cc->flags);
+	}
+
 	if (crypt_integrity_aead(cc)) {
 		cc->dmreq_start = sizeof(struct aead_request);
 		cc->dmreq_start += crypto_aead_reqsize(any_tfm_aead(cc));
@@ -3408,6 +3466,10 @@ static int crypt_map(struct dm_target *ti, struct bio *bio)
 	else
 		io->ctx.r.req = (struct skcipher_request *)(io + 1);
 
+	if (test_bit(DM_CRYPT_INLINE, &cc->flags) &&
+	    bio->bi_iter.bi_size <= cc->inline_max_bytes)
+		io->inline_crypt = true;
+
 	if (bio_data_dir(io->base_bio) == READ) {
 		if (kcryptd_io_read(io, GFP_NOWAIT))
 			kcryptd_queue_read(io);
@@ -3426,7 +3488,12 @@ static void crypt_status(struct dm_target *ti, status_type_t type,
 
 	switch (type) {
 	case STATUSTYPE_INFO:
-		result[0] = '\0';
+		/* <inline reads> <queued reads> <inline writes> <queued writes> */
+		DMEMIT("%lld %lld %lld %lld",
+		       percpu_counter_sum(&cc->n_inline_ios[READ]),
+		       percpu_counter_sum(&cc->n_queued_ios[READ]),
+		       percpu_counter_sum(&cc->n_inline_ios[WRITE]),
+		       percpu_counter_sum(&cc->n_queued_ios[WRITE]));
 		break;
 
 	case STATUSTYPE_TABLE:
@@ -3449,6 +3516,7 @@ static void crypt_status(struct dm_target *ti, status_type_t type,
 		num_feature_args += test_bit(DM_CRYPT_NO_OFFLOAD, &cc->flags);
 		num_feature_args += test_bit(DM_CRYPT_NO_READ_WORKQUEUE, &cc->flags);
 		num_feature_args += test_bit(DM_CRYPT_NO_WRITE_WORKQUEUE, &cc->flags);
+		num_feature_args += !!cc->inline_max_bytes;
 		num_feature_args += cc->sector_size != (1 << SECTOR_SHIFT);
 		num_feature_args += test_bit(CRYPT_IV_LARGE_SECTORS, &cc->cipher_flags);
 		if (cc->on_disk_tag_size)
@@ -3465,6 +3533,8 @@ static void crypt_status(struct dm_target *ti, status_type_t type,
 				DMEMIT(" no_read_workqueue");
 			if (test_bit(DM_CRYPT_NO_WRITE_WORKQUEUE, &cc->flags))
 				DMEMIT(" no_write_workqueue");
+			if (cc->inline_max_bytes)
+				DMEMIT(" inline_max_bytes:%u", cc->inline_max_bytes);
 			if (cc->on_disk_tag_size)
 				DMEMIT(" integrity:%u:%s", cc->on_disk_tag_size, cc->cipher_auth);
 			if (cc->sector_size != (1 << SECTOR_SHIFT))
@@ -3577,7 +3647,7 @@ static void crypt_io_hints(struct dm_target *ti, struct queue_limits *limits)
 
 static struct target_type crypt_target = {
 	.name   = "crypt",
-	.version = {1, 23, 0},
+	.version = {1, 24, 0},
 	.module = THIS_MODULE,
 	.ctr    = crypt_ctr,
 	.dtr    = crypt_dtr,
@@ -25,6 +25,8 @@
 #define DM_VERITY_ENV_VAR_NAME		"DM_VERITY_ERR_BLOCK_NR"
 
 #define DM_VERITY_DEFAULT_PREFETCH_SIZE	262144
+#define DM_VERITY_DEFAULT_FANOUT_BLOCKS	32
+#define DM_VERITY_MAX_FANOUT		8
 
 #define DM_VERITY_MAX_CORRUPTED_ERRS	100
 
@@ -41,6 +43,11 @@ static unsigned dm_verity_prefetch_cluster = DM_VERITY_DEFAULT_PREFETCH_SIZE;
 
 module_param_named(prefetch_cluster, dm_verity_prefetch_cluster, uint, S_IRUGO | S_IWUSR);
 
+/* Least number of data blocks worth verifying on another CPU, 0 never */
+static unsigned dm_verity_fanout_blocks = DM_VERITY_DEFAULT_FANOUT_BLOCKS;
+
+module_param_named(fanout_blocks, dm_verity_fanout_blocks, uint, S_IRUGO | S_IWUSR);
+
 struct dm_verity_prefetch_work {
 	struct work_struct work;
 	struct dm_verity *v;
@@ -74,6 +81,17 @@ static void dm_bufio_alloc_callback(struct dm_buffer *buf)
 	aux->hash_verified = 0;
 }
 
+/*
+ * The bio an io or a share of it verifies.
+ */
+static struct bio *verity_io_bio(struct dm_verity *v, struct dm_verity_io *io)
+{
+	if (io->parent)
+		io = io->parent;
+
+	return dm_bio_from_per_bio_data(io, v->ti->per_io_data_size);
+}
+
 /*
  * Translate input sector number to the sector number on the target device.
  */
@@ -372,7 +390,7 @@ static int verity_for_io_block(struct dm_verity *v, struct dm_verity_io *io,
 			       struct bvec_iter *iter, struct crypto_wait *wait)
 {
 	unsigned int todo = 1 << v->data_dev_block_bits;
-	struct bio *bio = dm_bio_from_per_bio_data(io, v->ti->per_io_data_size);
+	struct bio *bio = verity_io_bio(v, io);
 	struct scatterlist sg;
 	struct ahash_request *req = verity_io_hash_req(v, io);
 
@@ -419,7 +437,7 @@ int verity_for_bv_block(struct dm_verity *v, struct dm_verity_io *io,
 				       size_t len))
 {
 	unsigned todo = 1 << v->data_dev_block_bits;
-	struct bio *bio = dm_bio_from_per_bio_data(io, v->ti->per_io_data_size);
+	struct bio *bio = verity_io_bio(v, io);
 
 	do {
 		int r;
@@ -460,7 +478,7 @@ static inline void verity_bv_skip_block(struct dm_verity *v,
 					struct dm_verity_io *io,
 					struct bvec_iter *iter)
 {
-	struct bio *bio = dm_bio_from_per_bio_data(io, v->ti->per_io_data_size);
+	struct bio *bio = verity_io_bio(v, io);
 
 	bio_advance_iter(bio, iter, 1 << v->data_dev_block_bits);
 }
@@ -562,10 +580,96 @@ static void verity_finish_io(struct dm_verity_io *io, blk_status_t status)
 	bio_endio(bio);
 }
 
+/*
+ * Account for one finished share of an io split by verity_fan_out().
+ */
+static void verity_put_share(struct dm_verity_io *io, int r)
+{
+	if (unlikely(r < 0))
+		cmpxchg(&io->error, 0, r);
+
+	if (atomic_dec_and_test(&io->pending))
+		verity_finish_io(io, errno_to_blk_status(READ_ONCE(io->error)));
+}
+
+static void verity_share_work(struct work_struct *w)
+{
+	struct dm_verity_io *share = container_of(w, struct dm_verity_io, work);
+	struct dm_verity_io *io = share->parent;
+	int r;
+
+	r = verity_verify_io(share);
+	kfree(share);
+	verity_put_share(io, r);
+}
+
+/*
+ * Hashing is what bounds cold reads, so split a large io in shares of at
+ * least dm_verity_fanout_blocks that the unbound workqueue runs on other
+ * CPUs. The first share stays with the io itself. FEC keeps its state in
+ * the io of the bio, so corrected ios are never split.
+ *
+ * Return: true if the io was split and its first share is left to verify.
+ */
+static bool verity_fan_out(struct dm_verity_io *io)
+{
+	struct dm_verity_io *shares[DM_VERITY_MAX_FANOUT];
+	unsigned fanout_blocks = READ_ONCE(dm_verity_fanout_blocks);
+	struct dm_verity *v = io->v;
+	struct bio *bio = verity_io_bio(v, io);
+	unsigned n, i, size, block;
+
+	if (!fanout_blocks || verity_fec_is_enabled(v))
+		return false;
+
+	n = min3(io->n_blocks / fanout_blocks, num_online_cpus(),
+		 (unsigned)DM_VERITY_MAX_FANOUT);
+	if (n < 2)
+		return false;
+
+	size = DIV_ROUND_UP(io->n_blocks, n);
+	n = DIV_ROUND_UP(io->n_blocks, size);
+
+	for (i = 1; i < n; i++) {
+		shares[i] = kmalloc(v->ti->per_io_data_size, GFP_NOIO |
+				    __GFP_NORETRY | __GFP_NOMEMALLOC | __GFP_NOWARN);
+		if (!shares[i]) {
+			while (--i)
+				kfree(shares[i]);
+			return false;
+		}
+	}
+
+	atomic_set(&io->pending, n);
+	io->error = 0;
+
+	for (i = 1; i < n; i++) {
+		block = i * size;
+
+		shares[i]->v = v;
+		shares[i]->parent = io;
+		shares[i]->block = io->block + block;
+		shares[i]->n_blocks = min(size, io->n_blocks - block);
+		shares[i]->iter = io->iter;
+		bio_advance_iter(bio, &shares[i]->iter,
+				 block << v->data_dev_block_bits);
+		INIT_WORK(&shares[i]->work, verity_share_work);
+		queue_work(v->verify_wq, &shares[i]->work);
+	}
+	io->n_blocks = size;
+
+	return true;
+}
+
 static void verity_work(struct work_struct *w)
 {
 	struct dm_verity_io *io = container_of(w, struct dm_verity_io, work);
 
+	if (verity_fan_out(io)) {
+		verity_put_share(io, verity_verify_io(io));
+		return;
+	}
+
 	verity_finish_io(io, errno_to_blk_status(verity_verify_io(io)));
 }
 
@@ -683,6 +787,7 @@ static int verity_map(struct dm_target *ti, struct bio *bio)
 
 	io = dm_per_bio_data(bio, ti->per_io_data_size);
 	io->v = v;
+	io->parent = NULL;
 	io->orig_bi_end_io = bio->bi_end_io;
 	io->block = bio->bi_iter.bi_sector >> (v->data_dev_block_bits - SECTOR_SHIFT);
 	io->n_blocks = bio->bi_iter.bi_size >> v->data_dev_block_bits;
@@ -81,6 +81,15 @@ struct dm_verity_io {
 
 	struct work_struct work;
 
+	/*
+	 * A large io is verified in shares on several CPUs: each share but
+	 * the first has an io of its own, pointing to the io of the bio.
+	 * That one counts the shares still running and keeps the first error.
+	 */
+	struct dm_verity_io *parent;
+	atomic_t pending;
+	int error;
+
 	/*
 	 * Three variably-size fields follow this struct:
 	 *
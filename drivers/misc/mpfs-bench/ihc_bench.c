@@ -0,0 +1,165 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * Mi-V IHC benchmark
+ *
+ * Binds to a "microchip,miv-ihc-bench" node whose mboxes property names an
+ * IHC channel to a remote context that echoes every message back. Measures
+ * the round trip of single messages, then the rate of back to back ones.
+ */
+
+#include <linux/atomic.h>
+#include <linux/completion.h>
+#include <linux/mailbox_client.h>
+#include <linux/module.h>
+#include <linux/of.h>
+#include <linux/platform_device.h>
+#include <linux/mailbox/miv_ihc_message.h>
+#include "mpfs-bench.h"
+
+#define IHC_BENCH_TIMEOUT_MS	1000
+
+static unsigned int iterations = 1000;
+module_param(iterations, uint, 0444);
+MODULE_PARM_DESC(iterations, "Messages sent by each benchmark case");
+
+struct ihc_bench {
+	struct mbox_client client;
+	struct mbox_chan *chan;
+	struct completion echo;
+	atomic_t pending;
+};
+
+static void ihc_bench_rx(struct mbox_client *client, void *msg)
+{
+	struct ihc_bench *bench = container_of(client, struct ihc_bench,
+					       client);
+
+	if (atomic_dec_and_test(&bench->pending))
+		complete(&bench->echo);
+}
+
+static int ihc_bench_send(struct ihc_bench *bench, u32 seq)
+{
+	struct miv_ihc_msg msg = { 0 };
+	int ret;
+
+	msg.msg[0] = seq;
+	ret = mbox_send_message(bench->chan, &msg);
+
+	return ret < 0 ? ret : 0;
+}
+
+static int ihc_bench_rtt(struct ihc_bench *bench)
+{
+	struct mpfs_bench_stat stat;
+	unsigned int i;
+	ktime_t start;
+	int ret;
+
+	mpfs_bench_stat_init(&stat);
+
+	for (i = 0; i < iterations; i++) {
+		reinit_completion(&bench->echo);
+		atomic_set(&bench->pending, 1);
+
+		start = ktime_get();
+		ret = ihc_bench_send(bench, i);
+		if (ret)
+			return ret;
+
+		if (!wait_for_completion_timeout(&bench->echo,
+				msecs_to_jiffies(IHC_BENCH_TIMEOUT_MS)))
+			return -ETIMEDOUT;
+
+		mpfs_bench_stat_add(&stat, ktime_to_ns(ktime_sub(ktime_get(),
+								 start)));
+	}
+
+	mpfs_bench_report_stat("ihc", "rtt", &stat, "size=%zu",
+			       sizeof(struct miv_ihc_msg));
+
+	return 0;
+}
+
+static int ihc_bench_rate(struct ihc_bench *bench)
+{
+	unsigned int i;
+	ktime_t start;
+	u64 ns;
+	int ret;
+
+	reinit_completion(&bench->echo);
+	atomic_set(&bench->pending, iterations);
+
+	start = ktime_get();
+	for (i = 0; i < iterations; i++) {
+		ret = ihc_bench_send(bench, i);
+		if (ret)
+			return ret;
+	}
+
+	if (!wait_for_completion_timeout(&bench->echo,
+			msecs_to_jiffies(IHC_BENCH_TIMEOUT_MS)))
+		return -ETIMEDOUT;
+
+	ns = ktime_to_ns(ktime_sub(ktime_get(), start));
+
+	mpfs_bench_report("ihc", "rate", "size=%zu n=%u ns=%llu msgs_per_s=%llu",
+			  sizeof(struct miv_ihc_msg), iterations, ns,
+			  mpfs_bench_rate(iterations, ns));
+
+	return 0;
+}
+
+static int ihc_bench_probe(struct platform_device *pdev)
+{
+	struct device *dev = &pdev->dev;
+	struct ihc_bench *bench;
+	int ret;
+
+	if (!iterations)
+		return -EINVAL;
+
+	bench = devm_kzalloc(dev, sizeof(*bench), GFP_KERNEL);
+	if (!bench)
+		return -ENOMEM;
+
+	init_completion(&bench->echo);
+	bench->client.dev = dev;
+	bench->client.rx_callback = ihc_bench_rx;
+	bench->client.tx_block = true;
+	bench->client.tx_tout = IHC_BENCH_TIMEOUT_MS;
+
+	bench->chan = mbox_request_channel(&bench->client, 0);
+	if (IS_ERR(bench->chan))
+		return dev_err_probe(dev, PTR_ERR(bench->chan),
+				     "Failed to request mbox channel\n");
+
+	ret = ihc_bench_rtt(bench);
+	if (!ret)
+		ret = ihc_bench_rate(bench);
+	if (ret)
+		dev_err(dev, "benchmark failed: %d\n", ret);
+
+	mbox_free_channel(bench->chan);
+
+	return ret;
+}
+
+static const struct of_device_id ihc_bench_of_match[] = {
+	{ .compatible = "microchip,miv-ihc-bench", },
+	{},
+};
+MODULE_DEVICE_TABLE(of, ihc_bench_of_match);
+
+static struct platform_driver ihc_bench_driver = {
+	.driver = {
+		.name = "miv-ihc-bench",
+		.of_match_table = ihc_bench_of_match,
+	},
+	.probe = ihc_bench_probe,
+};
+module_platform_driver(ihc_bench_driver);
+
+MODULE_LICENSE("GPL v2");
+MODULE_DESCRIPTION("Mi-V IHC round trip and rate benchmark");
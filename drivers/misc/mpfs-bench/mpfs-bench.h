@@ -0,0 +1,68 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+/*
+ * PolarFire SoC driver benchmarks: shared statistics and result reporting
+ *
+ * Every result is one line of space separated key=value pairs, starting with
+ * the benchmark and case names, e.g.:
+ *
+ *   mpfs_bench: bench=ihc case=rtt size=8 n=1000 min_ns=... avg_ns=...
+ *
+ * so that "dmesg | grep mpfs_bench:" can be parsed and compared across
+ * releases.
+ */
+#ifndef __MPFS_BENCH_H__
+#define __MPFS_BENCH_H__
+
+#include <linux/kernel.h>
+#include <linux/ktime.h>
+#include <linux/math64.h>
+#include <linux/printk.h>
+
+struct mpfs_bench_stat {
+	u64 n;
+	u64 total_ns;
+	u64 min_ns;
+	u64 max_ns;
+};
+
+static inline void mpfs_bench_stat_init(struct mpfs_bench_stat *stat)
+{
+	stat->n = 0;
+	stat->total_ns = 0;
+	stat->min_ns = U64_MAX;
+	stat->max_ns = 0;
+}
+
+static inline void mpfs_bench_stat_add(struct mpfs_bench_stat *stat,
+				       u64 ns)
+{
+	stat->n++;
+	stat->total_ns += ns;
+	stat->min_ns = min(stat->min_ns, ns);
+	stat->max_ns = max(stat->max_ns, ns);
+}
+
+static inline u64 mpfs_bench_avg_ns(const struct mpfs_bench_stat *stat)
+{
+	return stat->n ? div64_u64(stat->total_ns, stat->n) : 0;
+}
+
+/* @count things done in @ns, per second */
+static inline u64 mpfs_bench_rate(u64 count, u64 ns)
+{
+	return ns ? mul_u64_u64_div_u64(count, NSEC_PER_SEC, ns) : 0;
+}
+
+#define mpfs_bench_report(bench, test, fmt, ...)			\
+	pr_info("mpfs_bench: bench=%s case=%s " fmt "\n", bench, test,	\
+		##__VA_ARGS__)
+
+/* Latency line for @stat, after the case specific fields in @fmt */
+#define mpfs_bench_report_stat(bench, test, stat, fmt, ...)		\
+	mpfs_bench_report(bench, test,					\
+			  fmt " n=%llu min_ns=%llu avg_ns=%llu max_ns=%llu",\
+			  ##__VA_ARGS__, (stat)->n,			\
+			  (stat)->n ? (stat)->min_ns : 0,		\
+			  mpfs_bench_avg_ns(stat), (stat)->max_ns)
+
+#endif /* __MPFS_BENCH_H__ */
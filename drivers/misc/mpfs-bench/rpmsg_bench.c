@@ -0,0 +1,128 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * rpmsg benchmark
+ *
+ * Binds to the "rpmsg-bench" channel announced by a remote that echoes every
+ * message back, and measures the message rate for payload sizes doubling
+ * from 16 bytes up to the MTU of the endpoint.
+ */
+
+#include <linux/atomic.h>
+#include <linux/completion.h>
+#include <linux/log2.h>
+#include <linux/module.h>
+#include <linux/rpmsg.h>
+#include <linux/slab.h>
+#include "mpfs-bench.h"
+
+#define RPMSG_BENCH_MIN_SIZE	16
+#define RPMSG_BENCH_TIMEOUT_MS	5000
+
+static unsigned int iterations = 1000;
+module_param(iterations, uint, 0444);
+MODULE_PARM_DESC(iterations, "Messages sent for each payload size");
+
+struct rpmsg_bench {
+	struct completion echo;
+	atomic_t pending;
+};
+
+static int rpmsg_bench_cb(struct rpmsg_device *rpdev, void *data, int len,
+			  void *priv, u32 src)
+{
+	struct rpmsg_bench *bench = dev_get_drvdata(&rpdev->dev);
+
+	if (atomic_dec_and_test(&bench->pending))
+		complete(&bench->echo);
+
+	return 0;
+}
+
+static int rpmsg_bench_size(struct rpmsg_device *rpdev, void *buf,
+			    size_t size)
+{
+	struct rpmsg_bench *bench = dev_get_drvdata(&rpdev->dev);
+	unsigned int i;
+	ktime_t start;
+	u64 ns;
+	int ret;
+
+	reinit_completion(&bench->echo);
+	atomic_set(&bench->pending, iterations);
+
+	start = ktime_get();
+	for (i = 0; i < iterations; i++) {
+		ret = rpmsg_send(rpdev->ept, buf, size);
+		if (ret)
+			return ret;
+	}
+
+	if (!wait_for_completion_timeout(&bench->echo,
+			msecs_to_jiffies(RPMSG_BENCH_TIMEOUT_MS)))
+		return -ETIMEDOUT;
+
+	ns = ktime_to_ns(ktime_sub(ktime_get(), start));
+
+	mpfs_bench_report("rpmsg", "rate",
+			  "size=%zu n=%u ns=%llu msgs_per_s=%llu bytes_per_s=%llu",
+			  size, iterations, ns, mpfs_bench_rate(iterations, ns),
+			  mpfs_bench_rate((u64)iterations * size, ns));
+
+	return 0;
+}
+
+static int rpmsg_bench_probe(struct rpmsg_device *rpdev)
+{
+	struct rpmsg_bench *bench;
+	ssize_t mtu;
+	size_t size;
+	void *buf;
+	int ret = 0;
+
+	if (!iterations)
+		return -EINVAL;
+
+	mtu = rpmsg_get_mtu(rpdev->ept);
+	if (mtu < RPMSG_BENCH_MIN_SIZE)
+		return mtu < 0 ? mtu : -EINVAL;
+
+	bench = devm_kzalloc(&rpdev->dev, sizeof(*bench), GFP_KERNEL);
+	buf = devm_kzalloc(&rpdev->dev, mtu, GFP_KERNEL);
+	if (!bench || !buf)
+		return -ENOMEM;
+
+	init_completion(&bench->echo);
+	dev_set_drvdata(&rpdev->dev, bench);
+
+	for (size = RPMSG_BENCH_MIN_SIZE; size <= mtu; size *= 2) {
+		ret = rpmsg_bench_size(rpdev, buf, size);
+		if (ret)
+			break;
+	}
+
+	/* the MTU itself, when not a power of two */
+	if (!ret && !is_power_of_2(mtu))
+		ret = rpmsg_bench_size(rpdev, buf, mtu);
+
+	if (ret)
+		dev_err(&rpdev->dev, "benchmark failed: %d\n", ret);
+
+	return ret;
+}
+
+static struct rpmsg_device_id rpmsg_bench_id_table[] = {
+	{ .name	= "rpmsg-bench" },
+	{ },
+};
+MODULE_DEVICE_TABLE(rpmsg, rpmsg_bench_id_table);
+
+static struct rpmsg_driver rpmsg_bench_driver = {
+	.drv.name	= KBUILD_MODNAME,
+	.id_table	= rpmsg_bench_id_table,
+	.probe		= rpmsg_bench_probe,
+	.callback	= rpmsg_bench_cb,
+};
+module_rpmsg_driver(rpmsg_bench_driver);
+
+MODULE_LICENSE("GPL v2");
+MODULE_DESCRIPTION("rpmsg message rate benchmark");
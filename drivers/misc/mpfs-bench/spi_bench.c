@@ -0,0 +1,103 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * SPI and QSPI controller throughput benchmark
+ *
+ * Binds to a "microchip,mpfs-spi-bench" device, which must be a loopback or
+ * a device ignoring what it is sent: the transfers write and read a pattern
+ * with no command structure. Measures full duplex throughput for transfer
+ * sizes doubling from 16 bytes up to max_size.
+ */
+
+#include <linux/module.h>
+#include <linux/of.h>
+#include <linux/sizes.h>
+#include <linux/slab.h>
+#include <linux/spi/spi.h>
+#include "mpfs-bench.h"
+
+#define SPI_BENCH_MIN_SIZE	16
+
+static unsigned int iterations = 100;
+module_param(iterations, uint, 0444);
+MODULE_PARM_DESC(iterations, "Transfers issued for each size");
+
+static unsigned int max_size = SZ_64K;
+module_param(max_size, uint, 0444);
+MODULE_PARM_DESC(max_size, "Largest transfer size");
+
+static int spi_bench_size(struct spi_device *spi, void *tx, void *rx,
+			  size_t size)
+{
+	struct spi_transfer xfer = {
+		.tx_buf = tx,
+		.rx_buf = rx,
+		.len = size,
+	};
+	unsigned int i;
+	ktime_t start;
+	u64 ns;
+	int ret;
+
+	start = ktime_get();
+	for (i = 0; i < iterations; i++) {
+		ret = spi_sync_transfer(spi, &xfer, 1);
+		if (ret)
+			return ret;
+	}
+	ns = ktime_to_ns(ktime_sub(ktime_get(), start));
+
+	mpfs_bench_report("spi", "duplex",
+			  "controller=%s speed_hz=%u size=%zu n=%u ns=%llu bytes_per_s=%llu",
+			  dev_name(&spi->controller->dev), spi->max_speed_hz,
+			  size, iterations, ns,
+			  mpfs_bench_rate((u64)iterations * size, ns));
+
+	return 0;
+}
+
+static int spi_bench_probe(struct spi_device *spi)
+{
+	size_t size, limit;
+	void *tx, *rx;
+	int ret = 0;
+
+	if (!iterations || max_size < SPI_BENCH_MIN_SIZE)
+		return -EINVAL;
+
+	limit = min_t(size_t, max_size, spi_max_transfer_size(spi));
+
+	tx = devm_kmalloc(&spi->dev, limit, GFP_KERNEL | GFP_DMA);
+	rx = devm_kmalloc(&spi->dev, limit, GFP_KERNEL | GFP_DMA);
+	if (!tx || !rx)
+		return -ENOMEM;
+
+	memset(tx, 0xa5, limit);
+
+	for (size = SPI_BENCH_MIN_SIZE; size <= limit; size *= 2) {
+		ret = spi_bench_size(spi, tx, rx, size);
+		if (ret) {
+			dev_err(&spi->dev, "benchmark failed: %d\n", ret);
+			break;
+		}
+	}
+
+	return ret;
+}
+
+static const struct of_device_id spi_bench_of_match[] = {
+	{ .compatible = "microchip,mpfs-spi-bench", },
+	{},
+};
+MODULE_DEVICE_TABLE(of, spi_bench_of_match);
+
+static struct spi_driver spi_bench_driver = {
+	.driver = {
+		.name = "mpfs-spi-bench",
+		.of_match_table = spi_bench_of_match,
+	},
+	.probe = spi_bench_probe,
+};
+module_spi_driver(spi_bench_driver);
+
+MODULE_LICENSE("GPL v2");
+MODULE_DESCRIPTION("SPI and QSPI controller throughput benchmark");
@@ -0,0 +1,109 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * MPFS system controller benchmark
+ *
+ * Binds to a "microchip,mpfs-sysctrl-bench" node whose syscontroller
+ * property names the system controller, and measures the latency of the
+ * random number service used by mpfs-rng, which has no side effects.
+ */
+
+#include <linux/module.h>
+#include <linux/of.h>
+#include <linux/platform_device.h>
+#include <linux/string.h>
+#include <soc/microchip/mpfs.h>
+#include "mpfs-bench.h"
+
+/* the mpfs-rng request */
+#define SYSCTRL_BENCH_RNG_OPCODE	0x21
+#define SYSCTRL_BENCH_RNG_RESP_BYTES	32U
+
+static unsigned int iterations = 1000;
+module_param(iterations, uint, 0444);
+MODULE_PARM_DESC(iterations, "System controller requests issued");
+
+static int sysctrl_bench_run(struct mpfs_sys_controller *sys_controller)
+{
+	u32 resp_msg[SYSCTRL_BENCH_RNG_RESP_BYTES / 4];
+	struct mpfs_mss_response response = {
+		.resp_msg = resp_msg,
+		.resp_size = SYSCTRL_BENCH_RNG_RESP_BYTES,
+	};
+	struct mpfs_mss_msg msg = {
+		.cmd_opcode = SYSCTRL_BENCH_RNG_OPCODE,
+		.response = &response,
+	};
+	struct mpfs_bench_stat stat;
+	unsigned int i;
+	ktime_t start;
+	int ret = 0;
+
+	mpfs_bench_stat_init(&stat);
+
+	for (i = 0; i < iterations; i++) {
+		start = ktime_get();
+		ret = mpfs_blocking_transaction(sys_controller, &msg);
+		if (ret)
+			break;
+
+		mpfs_bench_stat_add(&stat, ktime_to_ns(ktime_sub(ktime_get(),
+								 start)));
+	}
+
+	/* the responses are real random numbers, do not leave them around */
+	memzero_explicit(resp_msg, sizeof(resp_msg));
+
+	if (ret)
+		return ret;
+
+	mpfs_bench_report_stat("sysctrl", "rng", &stat, "opcode=0x%02x size=%u",
+			       SYSCTRL_BENCH_RNG_OPCODE,
+			       SYSCTRL_BENCH_RNG_RESP_BYTES);
+
+	return 0;
+}
+
+static int sysctrl_bench_probe(struct platform_device *pdev)
+{
+	struct mpfs_sys_controller *sys_controller;
+	struct device_node *np;
+	int ret;
+
+	if (!iterations)
+		return -EINVAL;
+
+	np = of_parse_phandle(pdev->dev.of_node, "syscontroller", 0);
+	if (!np) {
+		dev_err(&pdev->dev, "Failed to find mpfs system controller node\n");
+		return -ENODEV;
+	}
+
+	sys_controller = mpfs_sys_controller_get(np);
+	of_node_put(np);
+	if (!sys_controller)
+		return -EPROBE_DEFER;
+
+	ret = sysctrl_bench_run(sys_controller);
+	if (ret)
+		dev_err(&pdev->dev, "benchmark failed: %d\n", ret);
+
+	return ret;
+}
+
+static const struct of_device_id sysctrl_bench_of_match[] = {
+	{ .compatible = "microchip,mpfs-sysctrl-bench", },
+	{},
+};
+MODULE_DEVICE_TABLE(of, sysctrl_bench_of_match);
+
+static struct platform_driver sysctrl_bench_driver = {
+	.driver = {
+		.name = "mpfs-sysctrl-bench",
+		.of_match_table = sysctrl_bench_of_match,
+	},
+	.probe = sysctrl_bench_probe,
+};
+module_platform_driver(sysctrl_bench_driver);
+
+MODULE_LICENSE("GPL v2");
+MODULE_DESCRIPTION("MPFS system controller latency benchmark");
@@ -12,8 +12,10 @@
 #include <linux/mmc/mmc.h>
 #include <linux/of.h>
 #include <linux/of_device.h>
+#include <linux/suspend.h>
 
 #include "sdhci-pltfm.h"
+#include "cqhci.h"
 
 /* HRS - Host Register Set (specific to Cadence) */
 #define SDHCI_CDNS_HRS04		0x10		/* PHY access port */
@@ -38,6 +40,9 @@
 /* SRS - Slot Register Set (SDHCI-compatible) */
 #define SDHCI_CDNS_SRS_BASE		0x200
 
+/* CQRS - Command Queuing Register Set (CQHCI-compatible) */
+#define SDHCI_CDNS_CQRS_BASE		0x400
+
 /* PHY */
 #define SDHCI_CDNS_PHY_DLY_SD_HS	0x00
 #define SDHCI_CDNS_PHY_DLY_SD_DEFAULT	0x01
@@ -67,6 +72,10 @@ struct sdhci_cdns_phy_param {
 struct sdhci_cdns_priv {
 	void __iomem *hrs_addr;
 	bool enhanced_strobe;
+	bool has_cqe;
+	/* last good tuning point, -1 if none */
+	int tune_val;
+	unsigned char tune_timing;
 	unsigned int nr_phy_params;
 	struct sdhci_cdns_phy_param phy_params[];
 };
@@ -122,11 +131,46 @@ static int sdhci_cdns_write_phy_reg(struct sdhci_cdns_priv *priv,
 	return ret;
 }
 
-static unsigned int sdhci_cdns_phy_param_count(struct device_node *np)
+static int sdhci_cdns_read_phy_reg(struct sdhci_cdns_priv *priv,
+				   u8 addr, u8 *data)
+{
+	void __iomem *reg = priv->hrs_addr + SDHCI_CDNS_HRS04;
+	u32 tmp;
+	int ret;
+
+	ret = readl_poll_timeout(reg, tmp, !(tmp & SDHCI_CDNS_HRS04_ACK),
+				 0, 10);
+	if (ret)
+		return ret;
+
+	tmp = FIELD_PREP(SDHCI_CDNS_HRS04_ADDR, addr);
+	writel(tmp, reg);
+
+	tmp |= SDHCI_CDNS_HRS04_RD;
+	writel(tmp, reg);
+
+	ret = readl_poll_timeout(reg, tmp, tmp & SDHCI_CDNS_HRS04_ACK, 0, 10);
+	if (ret)
+		return ret;
+
+	*data = FIELD_GET(SDHCI_CDNS_HRS04_RDATA, tmp);
+
+	tmp &= ~SDHCI_CDNS_HRS04_RD;
+	writel(tmp, reg);
+
+	return readl_poll_timeout(reg, tmp, !(tmp & SDHCI_CDNS_HRS04_ACK),
+				  0, 10);
+}
+
+static unsigned int sdhci_cdns_phy_param_count(struct device_node *np,
+					       bool keep_boot_phy)
 {
 	unsigned int count = 0;
 	int i;
 
+	if (keep_boot_phy)
+		return ARRAY_SIZE(sdhci_cdns_phy_cfgs);
+
 	for (i = 0; i < ARRAY_SIZE(sdhci_cdns_phy_cfgs); i++)
 		if (of_property_read_bool(np, sdhci_cdns_phy_cfgs[i].property))
 			count++;
@@ -134,8 +178,13 @@ static unsigned int sdhci_cdns_phy_param_count(struct device_node *np)
 	return count;
 }
 
-static void sdhci_cdns_phy_param_parse(struct device_node *np,
-				       struct sdhci_cdns_priv *priv)
+/*
+ * With keep_boot_phy, every delay that is not given in DT is read back from
+ * the PHY as the boot firmware trained it, so that it survives suspend.
+ */
+static int sdhci_cdns_phy_param_parse(struct device_node *np,
+				      struct sdhci_cdns_priv *priv,
+				      bool keep_boot_phy)
 {
 	struct sdhci_cdns_phy_param *p = priv->phy_params;
 	u32 val;
@@ -144,13 +193,21 @@ static void sdhci_cdns_phy_param_parse(struct device_node *np,
 	for (i = 0; i < ARRAY_SIZE(sdhci_cdns_phy_cfgs); i++) {
 		ret = of_property_read_u32(np, sdhci_cdns_phy_cfgs[i].property,
 					   &val);
-		if (ret)
+		if (ret && !keep_boot_phy)
 			continue;
 
 		p->addr = sdhci_cdns_phy_cfgs[i].addr;
-		p->data = val;
+		if (ret) {
+			ret = sdhci_cdns_read_phy_reg(priv, p->addr, &p->data);
+			if (ret)
+				return ret;
+		} else {
+			p->data = val;
+		}
 		p++;
 	}
+
+	return 0;
 }
 
 static int sdhci_cdns_phy_init(struct sdhci_cdns_priv *priv)
@@ -241,10 +298,11 @@ static int sdhci_cdns_set_tune_val(struct sdhci_host *host, unsigned int val)
  */
 static int sdhci_cdns_execute_tuning(struct sdhci_host *host, u32 opcode)
 {
+	struct sdhci_cdns_priv *priv = sdhci_cdns_priv(host);
 	int cur_streak = 0;
 	int max_streak = 0;
 	int end_of_streak = 0;
-	int i;
+	int i, ret;
 
 	/*
 	 * Do not execute tuning for UHS_SDR50 or UHS_DDR50.
@@ -254,6 +312,17 @@ static int sdhci_cdns_execute_tuning(struct sdhci_host *host, u32 opcode)
 	    host->timing != MMC_TIMING_UHS_SDR104)
 		return 0;
 
+	/*
+	 * A full sweep sends 40 tuning blocks. On resume and re-tune, the
+	 * previous point usually still works, so try it first.
+	 */
+	if (priv->tune_val >= 0 && priv->tune_timing == host->timing &&
+	    !sdhci_cdns_set_tune_val(host, priv->tune_val) &&
+	    !mmc_send_tuning(host->mmc, opcode, NULL))
+		return 0;
+
+	priv->tune_val = -1;
+
 	for (i = 0; i < SDHCI_CDNS_MAX_TUNING_LOOP; i++) {
 		if (sdhci_cdns_set_tune_val(host, i) ||
 		    mmc_send_tuning(host->mmc, opcode, NULL)) { /* bad */
@@ -272,7 +341,14 @@ static int sdhci_cdns_execute_tuning(struct sdhci_host *host, u32 opcode)
 		return -EIO;
 	}
 
-	return sdhci_cdns_set_tune_val(host, end_of_streak - max_streak / 2);
+	i = end_of_streak - max_streak / 2;
+	ret = sdhci_cdns_set_tune_val(host, i);
+	if (!ret) {
+		priv->tune_val = i;
+		priv->tune_timing = host->timing;
+	}
+
+	return ret;
 }
 
 static void sdhci_cdns_set_uhs_signaling(struct sdhci_host *host,
@@ -309,6 +385,19 @@ static void sdhci_cdns_set_uhs_signaling(struct sdhci_host *host,
 		sdhci_set_uhs_signaling(host, timing);
 }
 
+static u32 sdhci_cdns_cqhci_irq(struct sdhci_host *host, u32 intmask)
+{
+	int cmd_error = 0;
+	int data_error = 0;
+
+	if (!sdhci_cqe_irq(host, intmask, &cmd_error, &data_error))
+		return intmask;
+
+	cqhci_irq(host->mmc, intmask, cmd_error, data_error);
+
+	return 0;
+}
+
 static const struct sdhci_ops sdhci_cdns_ops = {
 	.set_clock = sdhci_set_clock,
 	.get_timeout_clock = sdhci_cdns_get_timeout_clock,
@@ -316,6 +405,7 @@ static const struct sdhci_ops sdhci_cdns_ops = {
 	.reset = sdhci_reset,
 	.platform_execute_tuning = sdhci_cdns_execute_tuning,
 	.set_uhs_signaling = sdhci_cdns_set_uhs_signaling,
+	.irq = sdhci_cdns_cqhci_irq,
 };
 
 static const struct sdhci_pltfm_data sdhci_cdns_uniphier_pltfm_data = {
@@ -327,6 +417,66 @@ static const struct sdhci_pltfm_data sdhci_cdns_pltfm_data = {
 	.ops = &sdhci_cdns_ops,
 };
 
+static void sdhci_cdns_dumpregs(struct mmc_host *mmc)
+{
+	sdhci_dumpregs(mmc_priv(mmc));
+}
+
+static const struct cqhci_host_ops sdhci_cdns_cqhci_ops = {
+	.enable		= sdhci_cqe_enable,
+	.disable	= sdhci_cqe_disable,
+	.dumpregs	= sdhci_cdns_dumpregs,
+};
+
+static int sdhci_cdns_add_host(struct sdhci_host *host,
+			       struct sdhci_cdns_priv *priv)
+{
+	struct cqhci_host *cq_host;
+	bool dma64;
+	int ret;
+
+	if (!priv->has_cqe)
+		return sdhci_add_host(host);
+
+	host->mmc->caps2 |= MMC_CAP2_CQE | MMC_CAP2_CQE_DCMD;
+	/*
+	 * Let cqhci_crypto_init() probe the CQE crypto capability; it drops
+	 * MMC_CAP2_CRYPTO again if the controller has no crypto engine.
+	 */
+	host->mmc->caps2 |= MMC_CAP2_CRYPTO;
+	ret = sdhci_setup_host(host);
+	if (ret)
+		return ret;
+
+	cq_host = devm_kzalloc(mmc_dev(host->mmc), sizeof(*cq_host),
+			       GFP_KERNEL);
+	if (!cq_host) {
+		ret = -ENOMEM;
+		goto cleanup;
+	}
+
+	cq_host->mmio = priv->hrs_addr + SDHCI_CDNS_CQRS_BASE;
+	cq_host->ops = &sdhci_cdns_cqhci_ops;
+
+	dma64 = host->flags & SDHCI_USE_64_BIT_DMA;
+	if (dma64)
+		cq_host->caps |= CQHCI_TASK_DESC_SZ_128;
+
+	ret = cqhci_init(cq_host, host->mmc, dma64);
+	if (ret)
+		goto cleanup;
+
+	ret = __sdhci_add_host(host);
+	if (ret)
+		goto cleanup;
+
+	return 0;
+
+cleanup:
+	sdhci_cleanup_host(host);
+	return ret;
+}
+
 static void sdhci_cdns_hs400_enhanced_strobe(struct mmc_host *mmc,
 					     struct mmc_ios *ios)
 {
@@ -355,6 +505,7 @@ static int sdhci_cdns_probe(struct platform_device *pdev)
 	struct sdhci_cdns_priv *priv;
 	struct clk *clk;
 	unsigned int nr_phy_params;
+	bool keep_boot_phy;
 	int ret;
 	struct device *dev = &pdev->dev;
 	static const u16 version = SDHCI_SPEC_400 << SDHCI_SPEC_VER_SHIFT;
@@ -371,7 +522,10 @@ static int sdhci_cdns_probe(struct platform_device *pdev)
 	if (!data)
 		data = &sdhci_cdns_pltfm_data;
 
-	nr_phy_params = sdhci_cdns_phy_param_count(dev->of_node);
+	keep_boot_phy = of_device_is_compatible(dev->of_node,
+						"microchip,mpfs-sd4hc");
+	nr_phy_params = sdhci_cdns_phy_param_count(dev->of_node,
+						   keep_boot_phy);
 	host = sdhci_pltfm_init(pdev, data,
 				struct_size(priv, phy_params, nr_phy_params));
 	if (IS_ERR(host)) {
@@ -386,6 +540,8 @@ static int sdhci_cdns_probe(struct platform_device *pdev)
 	priv->nr_phy_params = nr_phy_params;
 	priv->hrs_addr = host->ioaddr;
 	priv->enhanced_strobe = false;
+	priv->tune_val = -1;
+	priv->has_cqe = of_property_read_bool(dev->of_node, "supports-cqe");
 	host->ioaddr += SDHCI_CDNS_SRS_BASE;
 	host->mmc_host_ops.hs400_enhanced_strobe =
 				sdhci_cdns_hs400_enhanced_strobe;
@@ -398,16 +554,21 @@ static int sdhci_cdns_probe(struct platform_device *pdev)
 	if (ret)
 		goto free;
 
-	sdhci_cdns_phy_param_parse(dev->of_node, priv);
+	ret = sdhci_cdns_phy_param_parse(dev->of_node, priv, keep_boot_phy);
+	if (ret)
+		goto free;
 
 	ret = sdhci_cdns_phy_init(priv);
 	if (ret)
 		goto free;
 
-	ret = sdhci_add_host(host);
+	ret = sdhci_cdns_add_host(host, priv);
 	if (ret)
 		goto free;
 
+	/* nothing else waits on the card, let it resume in parallel */
+	device_enable_async_suspend(dev);
+
 	return 0;
 free:
 	sdhci_pltfm_free(pdev);
@@ -418,6 +579,20 @@ static int sdhci_cdns_probe(struct platform_device *pdev)
 }
 
 #ifdef CONFIG_PM_SLEEP
+static int sdhci_cdns_suspend(struct device *dev)
+{
+	struct sdhci_host *host = dev_get_drvdata(dev);
+	int ret;
+
+	if (host->mmc->caps2 & MMC_CAP2_CQE) {
+		ret = cqhci_suspend(host->mmc);
+		if (ret)
+			return ret;
+	}
+
+	return sdhci_pltfm_suspend(dev);
+}
+
 static int sdhci_cdns_resume(struct device *dev)
 {
 	struct sdhci_host *host = dev_get_drvdata(dev);
@@ -429,14 +604,23 @@ static int sdhci_cdns_resume(struct device *dev)
 	if (ret)
 		return ret;
 
-	ret = sdhci_cdns_phy_init(priv);
-	if (ret)
-		goto disable_clk;
+	/*
+	 * The PHY only loses its delays if the platform removed power, so
+	 * keep them otherwise. Re-tuning then starts from the cached point.
+	 */
+	if (pm_resume_via_firmware()) {
+		ret = sdhci_cdns_phy_init(priv);
+		if (ret)
+			goto disable_clk;
+	}
 
 	ret = sdhci_resume_host(host);
 	if (ret)
 		goto disable_clk;
 
+	if (host->mmc->caps2 & MMC_CAP2_CQE)
+		return cqhci_resume(host->mmc);
+
 	return 0;
 
 disable_clk:
@@ -447,7 +631,7 @@ static int sdhci_cdns_resume(struct device *dev)
 #endif
 
 static const struct dev_pm_ops sdhci_cdns_pm_ops = {
-	SET_SYSTEM_SLEEP_PM_OPS(sdhci_pltfm_suspend, sdhci_cdns_resume)
+	SET_SYSTEM_SLEEP_PM_OPS(sdhci_cdns_suspend, sdhci_cdns_resume)
 };
 
 static const struct of_device_id sdhci_cdns_match[] = {
@@ -455,6 +639,7 @@ static const struct of_device_id sdhci_cdns_match[] = {
 		.compatible = "socionext,uniphier-sd4hc",
 		.data = &sdhci_cdns_uniphier_pltfm_data,
 	},
+	{ .compatible = "microchip,mpfs-sd4hc" },
 	{ .compatible = "cdns,sd4hc" },
 	{ /* sentinel */ }
 };
@@ -8,6 +8,7 @@
 #include <linux/mtd/mtd.h>
 #include <linux/bitops.h>
 #include <linux/slab.h>
+#include <linux/workqueue.h>
 
 static struct mtdpstore_context {
 	int index;
@@ -22,6 +23,9 @@ static struct mtdpstore_context {
 	 * status before panic to ensure panic_write not failed.
 	 */
 	unsigned long *badmap;		/* bad block bit map */
+	/* security erase deferred by mtdpstore_write(), see there */
+	struct work_struct erase_work;
+	loff_t erase_off;
 } oops_cxt;
 
 static int mtdpstore_block_isbad(struct mtdpstore_context *cxt, loff_t off)
@@ -234,23 +238,33 @@ static ssize_t mtdpstore_erase(size_t size, loff_t off)
  * pstore/blk will try one by one until gets an empty zone. So, it is not
  * needed to ensure the next zone is empty, but at least one.
  */
-static int mtdpstore_security(struct mtdpstore_context *cxt, loff_t off)
+static bool mtdpstore_has_empty_zone(struct mtdpstore_context *cxt,
+				     loff_t off)
 {
-	int ret = 0, i;
-	struct mtd_info *mtd = cxt->mtd;
 	u32 zonenum = (u32)div_u64(off, cxt->info.kmsg_size);
 	u32 zonecnt = (u32)div_u64(cxt->mtd->size, cxt->info.kmsg_size);
-	u32 blkcnt = (u32)div_u64(cxt->mtd->size, cxt->mtd->erasesize);
-	u32 erasesize = cxt->mtd->erasesize;
+	int i;
 
 	for (i = 0; i < zonecnt; i++) {
 		u32 num = (zonenum + i) % zonecnt;
 
-		/* found empty zone */
 		if (!test_bit(num, cxt->usedmap))
-			return 0;
+			return true;
 	}
 
+	return false;
+}
+
+static int mtdpstore_security(struct mtdpstore_context *cxt, loff_t off)
+{
+	int ret = 0;
+	struct mtd_info *mtd = cxt->mtd;
+	u32 blkcnt = (u32)div_u64(cxt->mtd->size, cxt->mtd->erasesize);
+	u32 erasesize = cxt->mtd->erasesize;
+
+	if (mtdpstore_has_empty_zone(cxt, off))
+		return 0;
+
 	/* If there is no any empty zone, we have no way but to do erase */
 	while (blkcnt--) {
 		div64_u64_rem(off + erasesize, cxt->mtd->size, (u64 *)&off);
@@ -271,6 +285,14 @@ static int mtdpstore_security(struct mtdpstore_context *cxt, loff_t off)
 	return ret;
 }
 
+static void mtdpstore_security_work(struct work_struct *work)
+{
+	struct mtdpstore_context *cxt =
+		container_of(work, struct mtdpstore_context, erase_work);
+
+	mtdpstore_security(cxt, READ_ONCE(cxt->erase_off));
+}
+
 static ssize_t mtdpstore_write(const char *buf, size_t size, loff_t off)
 {
 	struct mtdpstore_context *cxt = &oops_cxt;
@@ -294,7 +316,16 @@ static ssize_t mtdpstore_write(const char *buf, size_t size, loff_t off)
 	}
 	mtdpstore_mark_used(cxt, off);
 
-	mtdpstore_security(cxt, off);
+	/*
+	 * A NOR block erase takes long enough to hold up an oops dump of
+	 * several records past the watchdog. The zone just written is
+	 * done with, so free one for the next record from process context
+	 * instead. Only a record arriving before then finds no zone.
+	 */
+	if (!mtdpstore_has_empty_zone(cxt, off)) {
+		WRITE_ONCE(cxt->erase_off, off);
+		schedule_work(&cxt->erase_work);
+	}
 	return retlen;
 }
 
@@ -524,9 +555,10 @@ static void mtdpstore_notify_remove(struct mtd_info *mtd)
 	if (mtd->index != cxt->index || cxt->index < 0)
 		return;
 
+	unregister_pstore_device(&cxt->dev);
+	cancel_work_sync(&cxt->erase_work);
 	mtdpstore_flush_removed(cxt);
 
-	unregister_pstore_device(&cxt->dev);
 	kfree(cxt->badmap);
 	kfree(cxt->usedmap);
 	kfree(cxt->rmmap);
@@ -558,6 +590,8 @@ static int __init mtdpstore_init(void)
 		return -EINVAL;
 	}
 
+	INIT_WORK(&cxt->erase_work, mtdpstore_security_work);
+
 	/* Setup the MTD device to use */
 	ret = kstrtoint((char *)info->device, 0, &cxt->index);
 	if (ret)
@@ -1267,20 +1267,21 @@ static bool spi_nor_has_uniform_erase(const struct spi_nor *nor)
 
 static void spi_nor_set_4byte_opcodes(struct spi_nor *nor)
 {
+	struct spi_nor_erase_map *map = &nor->params->erase_map;
+	struct spi_nor_erase_type *erase;
+	int i;
+
 	nor->read_opcode = spi_nor_convert_3to4_read(nor->read_opcode);
 	nor->program_opcode = spi_nor_convert_3to4_program(nor->program_opcode);
 	nor->erase_opcode = spi_nor_convert_3to4_erase(nor->erase_opcode);
 
-	if (!spi_nor_has_uniform_erase(nor)) {
-		struct spi_nor_erase_map *map = &nor->params->erase_map;
-		struct spi_nor_erase_type *erase;
-		int i;
-
-		for (i = 0; i < SNOR_ERASE_TYPE_MAX; i++) {
-			erase = &map->erase_type[i];
-			erase->opcode =
-				spi_nor_convert_3to4_erase(erase->opcode);
-		}
+	/*
+	 * Uniform flashes use the erase types too, when erasing large ranges
+	 * with erase blocks bigger than the selected sector size.
+	 */
+	for (i = 0; i < SNOR_ERASE_TYPE_MAX; i++) {
+		erase = &map->erase_type[i];
+		erase->opcode = spi_nor_convert_3to4_erase(erase->opcode);
 	}
 }
 
@@ -1636,6 +1637,31 @@ static int spi_nor_erase_multi_sectors(struct spi_nor *nor, u64 addr, u32 len)
 	return ret;
 }
 
+/**
+ * spi_nor_has_larger_uniform_erase() - check for uniform erase types bigger
+ *					than the selected sector size
+ * @nor:	pointer to a 'struct spi_nor'
+ *
+ * spi_nor_select_uniform_erase() narrows the map down to the sector size
+ * exposed as mtd->erasesize, but the uniform region still records every erase
+ * type that works across the whole flash.
+ *
+ * Return: true if a bigger erase type is available, false otherwise.
+ */
+static bool spi_nor_has_larger_uniform_erase(const struct spi_nor *nor)
+{
+	const struct spi_nor_erase_map *map = &nor->params->erase_map;
+	u8 erase_mask = map->uniform_region.offset & SNOR_ERASE_TYPE_MASK;
+	int i;
+
+	for (i = 0; i < SNOR_ERASE_TYPE_MAX; i++)
+		if ((erase_mask & BIT(i)) &&
+		    map->erase_type[i].size > nor->mtd.erasesize)
+			return true;
+
+	return false;
+}
+
 /*
  * Erase an address range on the nor chip.  The address range may extend
  * one or more erase sectors. Return an error if there is a problem erasing.
@@ -1688,10 +1714,20 @@ static int spi_nor_erase(struct mtd_info *mtd, struct erase_info *instr)
 		if (ret)
 			goto erase_err;
 
-	/* REVISIT in some cases we could speed up erasing large regions
-	 * by using SPINOR_OP_SE instead of SPINOR_OP_BE_4K.  We may have set up
-	 * to use "small sector erase", but that's not always optimal.
+	/*
+	 * We may have set up to use "small sector erase", but that's not
+	 * optimal for large regions: erase the aligned parts of the range
+	 * with the biggest uniform erase blocks instead, e.g. SPINOR_OP_SE
+	 * instead of SPINOR_OP_BE_4K.
 	 */
+	} else if (spi_nor_has_uniform_erase(nor) && len > mtd->erasesize &&
+		   spi_nor_has_larger_uniform_erase(nor)) {
+		u8 erase_opcode = nor->erase_opcode;
+
+		ret = spi_nor_erase_multi_sectors(nor, addr, len);
+		nor->erase_opcode = erase_opcode;
+		if (ret)
+			goto erase_err;
 
 	/* "sector"-at-a-time erase */
 	} else if (spi_nor_has_uniform_erase(nor)) {
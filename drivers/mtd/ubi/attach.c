@@ -74,8 +74,13 @@
 #include <linux/crc32.h>
 #include <linux/math64.h>
 #include <linux/random.h>
+#include <linux/workqueue.h>
+#include <linux/ktime.h>
 #include "ubi.h"
 
+#define CREATE_TRACE_POINTS
+#include <trace/events/ubi.h>
+
 static int self_check_ai(struct ubi_device *ubi, struct ubi_attach_info *ai);
 
 #define AV_FIND		BIT(0)
@@ -926,12 +931,55 @@ static bool vol_ignored(int vol_id)
 #endif
 }
 
+/**
+ * struct ubi_scan_slot - headers of one PEB read ahead of scan_peb().
+ * @work: reads the headers on the scan workqueue
+ * @ubi: UBI device description object
+ * @pnum: the physical eraseblock number
+ * @bad: result of ubi_io_is_bad()
+ * @ec_err: result of ubi_io_read_ec_hdr()
+ * @vid_err: result of ubi_io_read_vid_hdr(), if it was needed
+ * @ech: EC header buffer
+ * @vidb: VID header buffer
+ */
+struct ubi_scan_slot {
+	struct work_struct work;
+	struct ubi_device *ubi;
+	int pnum;
+	int bad;
+	int ec_err;
+	int vid_err;
+	struct ubi_ec_hdr *ech;
+	struct ubi_vid_io_buf *vidb;
+};
+
+/* Does the I/O half of scan_peb(), stopping where scan_peb() would */
+static void scan_slot_read(struct work_struct *work)
+{
+	struct ubi_scan_slot *slot = container_of(work, struct ubi_scan_slot,
+						  work);
+	struct ubi_device *ubi = slot->ubi;
+
+	slot->ec_err = slot->vid_err = 0;
+	slot->bad = ubi_io_is_bad(ubi, slot->pnum);
+	if (slot->bad)
+		return;
+
+	slot->ec_err = ubi_io_read_ec_hdr(ubi, slot->pnum, slot->ech, 0);
+	if (slot->ec_err < 0 || slot->ec_err == UBI_IO_FF ||
+	    slot->ec_err == UBI_IO_FF_BITFLIPS)
+		return;
+
+	slot->vid_err = ubi_io_read_vid_hdr(ubi, slot->pnum, slot->vidb, 0);
+}
+
 /**
  * scan_peb - scan and process UBI headers of a PEB.
  * @ubi: UBI device description object
  * @ai: attaching information
  * @pnum: the physical eraseblock number
  * @fast: true if we're scanning for a Fastmap
+ * @slot: headers of @pnum already read by scan_parallel(), or %NULL
  *
  * This function reads UBI headers of PEB @pnum, checks them, and adds
  * information about this PEB to the corresponding list or RB-tree in the
@@ -939,10 +987,10 @@ static bool vol_ignored(int vol_id)
  * successfully handled and a negative error code in case of failure.
  */
 static int scan_peb(struct ubi_device *ubi, struct ubi_attach_info *ai,
-		    int pnum, bool fast)
+		    int pnum, bool fast, const struct ubi_scan_slot *slot)
 {
-	struct ubi_ec_hdr *ech = ai->ech;
-	struct ubi_vid_io_buf *vidb = ai->vidb;
+	struct ubi_ec_hdr *ech = slot ? slot->ech : ai->ech;
+	struct ubi_vid_io_buf *vidb = slot ? slot->vidb : ai->vidb;
 	struct ubi_vid_hdr *vidh = ubi_get_vid_hdr(vidb);
 	long long ec;
 	int err, bitflips = 0, vol_id = -1, ec_err = 0;
@@ -950,7 +998,7 @@ static int scan_peb(struct ubi_device *ubi, struct ubi_attach_info *ai,
 	dbg_bld("scan PEB %d", pnum);
 
 	/* Skip bad physical eraseblocks */
-	err = ubi_io_is_bad(ubi, pnum);
+	err = slot ? slot->bad : ubi_io_is_bad(ubi, pnum);
 	if (err < 0)
 		return err;
 	else if (err) {
@@ -958,7 +1006,7 @@ static int scan_peb(struct ubi_device *ubi, struct ubi_attach_info *ai,
 		return 0;
 	}
 
-	err = ubi_io_read_ec_hdr(ubi, pnum, ech, 0);
+	err = slot ? slot->ec_err : ubi_io_read_ec_hdr(ubi, pnum, ech, 0);
 	if (err < 0)
 		return err;
 	switch (err) {
@@ -1041,7 +1089,7 @@ static int scan_peb(struct ubi_device *ubi, struct ubi_attach_info *ai,
 
 	/* OK, we've done with the EC header, let's look at the VID header */
 
-	err = ubi_io_read_vid_hdr(ubi, pnum, vidb, 0);
+	err = slot ? slot->vid_err : ubi_io_read_vid_hdr(ubi, pnum, vidb, 0);
 	if (err < 0)
 		return err;
 	switch (err) {
@@ -1361,6 +1409,86 @@ static void destroy_ai(struct ubi_attach_info *ai)
 	kfree(ai);
 }
 
+/* Number of header reads each scan thread keeps in flight */
+#define UBI_SCAN_SLOTS_PER_THREAD 4
+
+/**
+ * scan_parallel - scan PEBs with header reads spread over several threads.
+ * @ubi: UBI device description object
+ * @ai: attach info object
+ * @start: start scanning at this PEB
+ *
+ * The EC and VID headers of upcoming PEBs are read by %ubi_scan_threads
+ * workers while this thread processes the ones already read, strictly in PEB
+ * order, so the outcome is the same as for the sequential scan. This only
+ * pays off when the MTD driver can overlap reads, e.g. across NAND dies, or
+ * spends CPU time on software ECC. Returns zero in case of success and a
+ * negative error code in case of failure.
+ */
+static int scan_parallel(struct ubi_device *ubi, struct ubi_attach_info *ai,
+			 int start)
+{
+	int nr_slots = ubi_scan_threads * UBI_SCAN_SLOTS_PER_THREAD;
+	struct workqueue_struct *wq;
+	struct ubi_scan_slot *slots, *slot;
+	int i, pnum, next, err = -ENOMEM;
+
+	slots = kcalloc(nr_slots, sizeof(*slots), GFP_KERNEL);
+	if (!slots)
+		return err;
+
+	for (i = 0; i < nr_slots; i++) {
+		slots[i].ubi = ubi;
+		INIT_WORK(&slots[i].work, scan_slot_read);
+		slots[i].ech = kzalloc(ubi->ec_hdr_alsize, GFP_KERNEL);
+		slots[i].vidb = ubi_alloc_vid_buf(ubi, GFP_KERNEL);
+		if (!slots[i].ech || !slots[i].vidb)
+			goto out_free;
+	}
+
+	wq = alloc_workqueue("ubi%d_scan", WQ_UNBOUND, ubi_scan_threads,
+			     ubi->ubi_num);
+	if (!wq)
+		goto out_free;
+
+	for (next = start; next < ubi->peb_count && next - start < nr_slots;
+	     next++) {
+		slot = &slots[next - start];
+		slot->pnum = next;
+		queue_work(wq, &slot->work);
+	}
+
+	err = 0;
+	for (pnum = start; pnum < ubi->peb_count; pnum++) {
+		slot = &slots[(pnum - start) % nr_slots];
+
+		cond_resched();
+		flush_work(&slot->work);
+
+		dbg_gen("process PEB %d", pnum);
+		err = scan_peb(ubi, ai, pnum, false, slot);
+		if (err < 0)
+			break;
+
+		/* The slot is free again, start reading the next PEB into it */
+		if (next < ubi->peb_count) {
+			slot->pnum = next++;
+			queue_work(wq, &slot->work);
+		}
+	}
+
+	/* Waits for reads still in flight after an error */
+	destroy_workqueue(wq);
+
+out_free:
+	for (i = 0; i < nr_slots; i++) {
+		ubi_free_vid_buf(slots[i].vidb);
+		kfree(slots[i].ech);
+	}
+	kfree(slots);
+	return err;
+}
+
 /**
  * scan_all - scan entire MTD device.
  * @ubi: UBI device description object
@@ -1378,6 +1506,7 @@ static int scan_all(struct ubi_device *ubi, struct ubi_attach_info *ai,
 	struct rb_node *rb1, *rb2;
 	struct ubi_ainf_volume *av;
 	struct ubi_ainf_peb *aeb;
+	ktime_t t0 = ktime_get();
 
 	err = -ENOMEM;
 
@@ -1389,14 +1518,23 @@ static int scan_all(struct ubi_device *ubi, struct ubi_attach_info *ai,
 	if (!ai->vidb)
 		goto out_ech;
 
-	for (pnum = start; pnum < ubi->peb_count; pnum++) {
-		cond_resched();
+	if (ubi_scan_threads > 1) {
+		err = scan_parallel(ubi, ai, start);
+	} else {
+		for (pnum = start; pnum < ubi->peb_count; pnum++) {
+			cond_resched();
 
-		dbg_gen("process PEB %d", pnum);
-		err = scan_peb(ubi, ai, pnum, false);
-		if (err < 0)
-			goto out_vidh;
+			dbg_gen("process PEB %d", pnum);
+			err = scan_peb(ubi, ai, pnum, false, NULL);
+			if (err < 0)
+				break;
+		}
 	}
+	trace_ubi_attach_scan(ubi->ubi_num, start, ubi->peb_count, false,
+			      min(err, 0),
+			      ktime_to_ns(ktime_sub(ktime_get(), t0)));
+	if (err < 0)
+		goto out_vidh;
 
 	ubi_msg(ubi, "scanning is finished");
 
@@ -1488,6 +1626,7 @@ static int scan_fast(struct ubi_device *ubi, struct ubi_attach_info **ai)
 {
 	int err, pnum;
 	struct ubi_attach_info *scan_ai;
+	ktime_t t0;
 
 	err = -ENOMEM;
 
@@ -1503,22 +1642,31 @@ static int scan_fast(struct ubi_device *ubi, struct ubi_attach_info **ai)
 	if (!scan_ai->vidb)
 		goto out_ech;
 
+	t0 = ktime_get();
 	for (pnum = 0; pnum < UBI_FM_MAX_START; pnum++) {
 		cond_resched();
 
 		dbg_gen("process PEB %d", pnum);
-		err = scan_peb(ubi, scan_ai, pnum, true);
+		err = scan_peb(ubi, scan_ai, pnum, true, NULL);
 		if (err < 0)
-			goto out_vidh;
+			break;
 	}
+	trace_ubi_attach_scan(ubi->ubi_num, 0, UBI_FM_MAX_START, true,
+			      min(err, 0),
+			      ktime_to_ns(ktime_sub(ktime_get(), t0)));
+	if (err < 0)
+		goto out_vidh;
 
 	ubi_free_vid_buf(scan_ai->vidb);
 	kfree(scan_ai->ech);
 
+	t0 = ktime_get();
 	if (scan_ai->force_full_scan)
 		err = UBI_NO_FASTMAP;
 	else
 		err = ubi_scan_fastmap(ubi, *ai, scan_ai);
+	trace_ubi_attach_step(ubi->ubi_num, "fastmap", err,
+			      ktime_to_ns(ktime_sub(ktime_get(), t0)));
 
 	if (err) {
 		/*
@@ -1556,6 +1704,7 @@ int ubi_attach(struct ubi_device *ubi, int force_scan)
 {
 	int err;
 	struct ubi_attach_info *ai;
+	ktime_t start = ktime_get(), t0;
 
 	ai = alloc_ai();
 	if (!ai)
@@ -1598,15 +1747,24 @@ int ubi_attach(struct ubi_device *ubi, int force_scan)
 	ubi->mean_ec = ai->mean_ec;
 	dbg_gen("max. sequence number:       %llu", ai->max_sqnum);
 
+	t0 = ktime_get();
 	err = ubi_read_volume_table(ubi, ai);
+	trace_ubi_attach_step(ubi->ubi_num, "vtbl", err,
+			      ktime_to_ns(ktime_sub(ktime_get(), t0)));
 	if (err)
 		goto out_ai;
 
+	t0 = ktime_get();
 	err = ubi_wl_init(ubi, ai);
+	trace_ubi_attach_step(ubi->ubi_num, "wl", err,
+			      ktime_to_ns(ktime_sub(ktime_get(), t0)));
 	if (err)
 		goto out_vtbl;
 
+	t0 = ktime_get();
 	err = ubi_eba_init(ubi, ai);
+	trace_ubi_attach_step(ubi->ubi_num, "eba", err,
+			      ktime_to_ns(ktime_sub(ktime_get(), t0)));
 	if (err)
 		goto out_wl;
 
@@ -1635,6 +1793,9 @@ int ubi_attach(struct ubi_device *ubi, int force_scan)
 #endif
 
 	destroy_ai(ai);
+	trace_ubi_attach_done(ubi->ubi_num, !!ubi->fm, ubi->peb_count,
+			      ubi->bad_peb_count, ubi->corr_peb_count, 0,
+			      ktime_to_ns(ktime_sub(ktime_get(), start)));
 	return 0;
 
 out_wl:
@@ -1644,6 +1805,9 @@ int ubi_attach(struct ubi_device *ubi, int force_scan)
 	vfree(ubi->vtbl);
 out_ai:
 	destroy_ai(ai);
+	trace_ubi_attach_done(ubi->ubi_num, false, ubi->peb_count,
+			      ubi->bad_peb_count, ubi->corr_peb_count, err,
+			      ktime_to_ns(ktime_sub(ktime_get(), start)));
 	return err;
 }
 
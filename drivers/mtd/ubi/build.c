@@ -72,6 +72,20 @@ static bool fm_autoconvert;
 static bool fm_debug;
 #endif
 
+/* Number of threads reading PEB headers during a full attach scan */
+int ubi_scan_threads = 1;
+
+/*
+ * Free PEB watermarks. Below @ubi_wl_free_high, pending erasures go ahead of
+ * wear-leveling so that the reserve of erased PEBs refills first. Below
+ * @ubi_wl_free_low, the background thread also ignores @ubi_erase_budget.
+ */
+int ubi_wl_free_low = 4;
+int ubi_wl_free_high = 16;
+
+/* Works per second the background thread may do, 0 for no limit */
+unsigned int ubi_erase_budget;
+
 /* Slab cache for wear-leveling entries */
 struct kmem_cache *ubi_wl_entry_slab;
 
@@ -141,6 +155,8 @@ static struct device_attribute dev_mtd_num =
 	__ATTR(mtd_num, S_IRUGO, dev_attribute_show, NULL);
 static struct device_attribute dev_ro_mode =
 	__ATTR(ro_mode, S_IRUGO, dev_attribute_show, NULL);
+static struct device_attribute dev_sync_erase_count =
+	__ATTR(sync_erase_count, S_IRUGO, dev_attribute_show, NULL);
 
 /**
  * ubi_volume_notify - send a volume change notification.
@@ -379,6 +395,8 @@ static ssize_t dev_attribute_show(struct device *dev,
 		ret = sprintf(buf, "%d\n", ubi->mtd->index);
 	else if (attr == &dev_ro_mode)
 		ret = sprintf(buf, "%d\n", ubi->ro_mode);
+	else if (attr == &dev_sync_erase_count)
+		ret = sprintf(buf, "%lu\n", ubi->sync_erase_count);
 	else
 		ret = -EINVAL;
 
@@ -399,6 +417,7 @@ static struct attribute *ubi_dev_attrs[] = {
 	&dev_bgt_enabled.attr,
 	&dev_mtd_num.attr,
 	&dev_ro_mode.attr,
+	&dev_sync_erase_count.attr,
 	NULL
 };
 ATTRIBUTE_GROUPS(ubi_dev);
@@ -1469,6 +1488,14 @@ MODULE_PARM_DESC(fm_autoconvert, "Set this parameter to enable fastmap automatic
 module_param(fm_debug, bool, 0);
 MODULE_PARM_DESC(fm_debug, "Set this parameter to enable fastmap debugging by default. Warning, this will make fastmap slow!");
 #endif
+module_param_named(scan_threads, ubi_scan_threads, int, 0644);
+MODULE_PARM_DESC(scan_threads, "Number of threads reading PEB headers when attaching by scanning (default: 1, sequential). Only helps MTD drivers that can overlap reads.");
+module_param_named(free_low, ubi_wl_free_low, int, 0644);
+MODULE_PARM_DESC(free_low, "Free PEBs below which background erasures ignore erase_budget (default: 4).");
+module_param_named(free_high, ubi_wl_free_high, int, 0644);
+MODULE_PARM_DESC(free_high, "Free PEBs below which pending erasures go ahead of wear-leveling (default: 16).");
+module_param_named(erase_budget, ubi_erase_budget, uint, 0644);
+MODULE_PARM_DESC(erase_budget, "Background works, one PEB erasure each, allowed per second while free PEBs are above free_low (default: 0, unlimited).");
 MODULE_VERSION(__stringify(UBI_VERSION));
 MODULE_DESCRIPTION("UBI - Unsorted Block Images");
 MODULE_AUTHOR("Artem Bityutskiy");
@@ -185,6 +185,10 @@ static int produce_free_peb(struct ubi_device *ubi)
 	int err;
 
 	while (!ubi->free.rb_node && ubi->works_count) {
+		spin_lock(&ubi->wl_lock);
+		ubi->sync_erase_count += 1;
+		spin_unlock(&ubi->wl_lock);
+
 		dbg_wl("do one work synchronously");
 		err = do_work(ubi);
 
@@ -506,7 +506,7 @@ struct ubi_debug_info {
  * @wl_lock: protects the @used, @free, @pq, @pq_head, @lookuptbl, @move_from,
  *	     @move_to, @move_to_put @erase_pending, @wl_scheduled, @works,
  *	     @erroneous, @erroneous_peb_count, @fm_work_scheduled, @fm_pool,
- *	     and @fm_wl_pool fields
+ *	     @fm_wl_pool and @sync_erase_count fields
  * @move_mutex: serializes eraseblock moves
  * @work_sem: used to wait for all the scheduled works to finish and prevent
  * new works from being submitted
@@ -521,6 +521,10 @@ struct ubi_debug_info {
  * @bgt_thread: background thread description object
  * @thread_enabled: if the background thread is enabled
  * @bgt_name: background thread name
+ * @erase_budget_stamp: start of the second @erase_budget_used counts works in
+ * @erase_budget_used: works the background thread did in that second
+ * @sync_erase_count: works done by users of the device because there was no
+ *                    free PEB left
  *
  * @flash_size: underlying MTD device size (in bytes)
  * @peb_count: count of physical eraseblocks on the MTD device
@@ -627,6 +631,9 @@ struct ubi_device {
 	struct task_struct *bgt_thread;
 	int thread_enabled;
 	char bgt_name[sizeof(UBI_BGT_NAME_PATTERN)+2];
+	unsigned long erase_budget_stamp;
+	unsigned int erase_budget_used;
+	unsigned long sync_erase_count;
 
 	/* I/O sub-system's stuff */
 	long long flash_size;
@@ -815,6 +822,10 @@ struct ubi_work {
 #include "debug.h"
 
 extern struct kmem_cache *ubi_wl_entry_slab;
+extern int ubi_scan_threads;
+extern int ubi_wl_free_low;
+extern int ubi_wl_free_high;
+extern unsigned int ubi_erase_budget;
 extern const struct file_operations ubi_ctrl_cdev_operations;
 extern const struct file_operations ubi_cdev_operations;
 extern const struct file_operations ubi_vol_cdev_operations;
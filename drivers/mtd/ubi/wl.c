@@ -178,6 +178,30 @@ static void wl_entry_destroy(struct ubi_device *ubi, struct ubi_wl_entry *e)
 	kmem_cache_free(ubi_wl_entry_slab, e);
 }
 
+static int erase_worker(struct ubi_device *ubi, struct ubi_work *wl_wrk,
+			int shutdown);
+
+/**
+ * next_work - pick the pending work to do next.
+ * @ubi: UBI device description object
+ *
+ * Works are done in order, except that erasures overtake the others while
+ * free PEBs are short: each of them makes a free PEB at the cost of one
+ * erase, while wear-leveling first has to copy a whole PEB. Has to be called
+ * with @ubi->wl_lock held and @ubi->works not empty.
+ */
+static struct ubi_work *next_work(struct ubi_device *ubi)
+{
+	struct ubi_work *wrk;
+
+	if (ubi->free_count < ubi_wl_free_high)
+		list_for_each_entry(wrk, &ubi->works, list)
+			if (wrk->func == erase_worker)
+				return wrk;
+
+	return list_first_entry(&ubi->works, struct ubi_work, list);
+}
+
 /**
  * do_work - do one pending work.
  * @ubi: UBI device description object
@@ -206,7 +230,7 @@ static int do_work(struct ubi_device *ubi)
 		return 0;
 	}
 
-	wrk = list_entry(ubi->works.next, struct ubi_work, list);
+	wrk = next_work(ubi);
 	list_del(&wrk->list);
 	ubi->works_count -= 1;
 	ubi_assert(ubi->works_count >= 0);
@@ -565,9 +589,6 @@ static void schedule_ubi_work(struct ubi_device *ubi, struct ubi_work *wrk)
 	up_read(&ubi->work_sem);
 }
 
-static int erase_worker(struct ubi_device *ubi, struct ubi_work *wl_wrk,
-			int shutdown);
-
 /**
  * schedule_erase - schedule an erase work.
  * @ubi: UBI device description object
@@ -1611,6 +1632,37 @@ static void tree_destroy(struct ubi_device *ubi, struct rb_root *root)
 	}
 }
 
+/**
+ * erase_budget_delay - check the background thread against its budget.
+ * @ubi: UBI device description object
+ *
+ * Each work erases one PEB, so @ubi_erase_budget works are allowed per second
+ * and the thread then waits for the next second, leaving the flash to the
+ * users. The budget does not apply once free PEBs are below the low
+ * watermark. Has to be called with @ubi->wl_lock held.
+ *
+ * Returns the number of jiffies to wait, or zero if the work can go ahead.
+ */
+static long erase_budget_delay(struct ubi_device *ubi)
+{
+	unsigned int budget = READ_ONCE(ubi_erase_budget);
+	unsigned long now = jiffies;
+
+	if (!budget || ubi->free_count < ubi_wl_free_low)
+		return 0;
+
+	if (time_after_eq(now, ubi->erase_budget_stamp + HZ)) {
+		ubi->erase_budget_stamp = now;
+		ubi->erase_budget_used = 0;
+	}
+	if (ubi->erase_budget_used < budget) {
+		ubi->erase_budget_used += 1;
+		return 0;
+	}
+
+	return ubi->erase_budget_stamp + HZ - now;
+}
+
 /**
  * ubi_thread - UBI background thread.
  * @u: the UBI device description object pointer
@@ -1625,6 +1677,7 @@ int ubi_thread(void *u)
 
 	set_freezable();
 	for (;;) {
+		long delay;
 		int err;
 
 		if (kthread_should_stop())
@@ -1654,7 +1707,14 @@ int ubi_thread(void *u)
 			schedule();
 			continue;
 		}
+
+		/* New works wake the thread up early, and it checks again */
+		delay = erase_budget_delay(ubi);
 		spin_unlock(&ubi->wl_lock);
+		if (delay) {
+			schedule_timeout_interruptible(delay);
+			continue;
+		}
 
 		err = do_work(ubi);
 		if (err) {
@@ -1761,6 +1821,7 @@ int ubi_wl_init(struct ubi_device *ubi, struct ubi_attach_info *ai)
 	init_rwsem(&ubi->work_sem);
 	ubi->max_ec = ai->max_ec;
 	INIT_LIST_HEAD(&ubi->works);
+	ubi->erase_budget_stamp = jiffies;
 
 	sprintf(ubi->bgt_name, UBI_BGT_NAME_PATTERN, ubi->ubi_num);
 
@@ -2064,6 +2125,7 @@ static int produce_free_peb(struct ubi_device *ubi)
 	int err;
 
 	while (!ubi->free.rb_node && ubi->works_count) {
+		ubi->sync_erase_count += 1;
 		spin_unlock(&ubi->wl_lock);
 
 		dbg_wl("do one work synchronously");
@@ -0,0 +1,823 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * Microchip PolarFire SoC MSS CAN controller driver
+ *
+ * The controller has 32 transmit and 32 receive message buffers, each
+ * receive buffer with its own acceptance filter. Transmit buffers are used
+ * as a ring under the round-robin arbiter, which keeps frames in order.
+ * Receive is done from NAPI, so a burst of frames costs one interrupt.
+ */
+
+#include <linux/bitfield.h>
+#include <linux/clk.h>
+#include <linux/interrupt.h>
+#include <linux/io.h>
+#include <linux/kernel.h>
+#include <linux/module.h>
+#include <linux/netdevice.h>
+#include <linux/of.h>
+#include <linux/platform_device.h>
+#include <linux/can/dev.h>
+#include <linux/can/error.h>
+#include <linux/can/led.h>
+
+#define MPFS_CAN_INT_STATUS		0x000
+#define MPFS_CAN_INT_ENABLE		0x004
+#define MPFS_CAN_RX_BUF_STATUS		0x008
+#define MPFS_CAN_TX_BUF_STATUS		0x00c
+#define MPFS_CAN_ERROR_STATUS		0x010
+#define MPFS_CAN_COMMAND		0x014
+#define MPFS_CAN_CONFIG			0x018
+
+#define MPFS_CAN_TX_MSG(n)		(0x020 + (n) * 0x10)
+#define MPFS_CAN_RX_MSG(n)		(0x220 + (n) * 0x20)
+#define MPFS_CAN_MSG_CTRL		0x00
+#define MPFS_CAN_MSG_ID			0x04
+#define MPFS_CAN_MSG_DATA_HIGH		0x08
+#define MPFS_CAN_MSG_DATA_LOW		0x0c
+#define MPFS_CAN_RX_AMR			0x10
+#define MPFS_CAN_RX_ACR			0x14
+#define MPFS_CAN_RX_AMR_DATA		0x18
+#define MPFS_CAN_RX_ACR_DATA		0x1c
+
+/* INT_STATUS / INT_ENABLE */
+#define MPFS_CAN_INT_GLOBAL		BIT(0)
+#define MPFS_CAN_INT_ARB_LOSS		BIT(2)
+#define MPFS_CAN_INT_OVR_LOAD		BIT(3)
+#define MPFS_CAN_INT_BIT_ERR		BIT(4)
+#define MPFS_CAN_INT_STUFF_ERR		BIT(5)
+#define MPFS_CAN_INT_ACK_ERR		BIT(6)
+#define MPFS_CAN_INT_FORM_ERR		BIT(7)
+#define MPFS_CAN_INT_CRC_ERR		BIT(8)
+#define MPFS_CAN_INT_BUS_OFF		BIT(9)
+#define MPFS_CAN_INT_RX_MSG_LOSS	BIT(10)
+#define MPFS_CAN_INT_TX_MSG		BIT(11)
+#define MPFS_CAN_INT_RX_MSG		BIT(12)
+#define MPFS_CAN_INT_ALL		GENMASK(15, 1)
+
+#define MPFS_CAN_INT_BUS_ERR		(MPFS_CAN_INT_BIT_ERR | \
+					 MPFS_CAN_INT_STUFF_ERR | \
+					 MPFS_CAN_INT_ACK_ERR | \
+					 MPFS_CAN_INT_FORM_ERR | \
+					 MPFS_CAN_INT_CRC_ERR)
+#define MPFS_CAN_INT_NAPI		(MPFS_CAN_INT_RX_MSG | \
+					 MPFS_CAN_INT_TX_MSG)
+
+/* ERROR_STATUS */
+#define MPFS_CAN_ERR_TX_CNT		GENMASK(7, 0)
+#define MPFS_CAN_ERR_RX_CNT		GENMASK(15, 8)
+#define MPFS_CAN_ERR_STATE		GENMASK(17, 16)
+#define MPFS_CAN_ERR_TX_GTE96		BIT(18)
+#define MPFS_CAN_ERR_RX_GTE96		BIT(19)
+
+#define MPFS_CAN_STATE_ACTIVE		0
+#define MPFS_CAN_STATE_PASSIVE		1
+
+/* COMMAND */
+#define MPFS_CAN_CMD_RUN		BIT(0)
+#define MPFS_CAN_CMD_LISTEN_ONLY	BIT(1)
+#define MPFS_CAN_CMD_LOOPBACK		BIT(2)
+
+/* CONFIG */
+#define MPFS_CAN_CFG_SAMPLING_MODE	BIT(1)
+#define MPFS_CAN_CFG_SJW		GENMASK(3, 2)
+#define MPFS_CAN_CFG_TSEG2		GENMASK(7, 5)
+#define MPFS_CAN_CFG_TSEG1		GENMASK(11, 8)
+#define MPFS_CAN_CFG_BITRATE		GENMASK(30, 16)
+
+/* TX message CTRL, WPN bits unlock writes to the fields below them */
+#define MPFS_CAN_TX_REQ			BIT(0)
+#define MPFS_CAN_TX_ABORT		BIT(1)
+#define MPFS_CAN_TX_INT_EN		BIT(2)
+#define MPFS_CAN_TX_WPNL		BIT(3)
+
+/* RX message CTRL */
+#define MPFS_CAN_RX_MSGAV		BIT(0)
+#define MPFS_CAN_RX_BUF_EN		BIT(3)
+#define MPFS_CAN_RX_INT_EN		BIT(5)
+#define MPFS_CAN_RX_WPNL		BIT(7)
+
+/* Shared TX/RX message CTRL fields */
+#define MPFS_CAN_MSG_DLC		GENMASK(19, 16)
+#define MPFS_CAN_MSG_IDE		BIT(20)
+#define MPFS_CAN_MSG_RTR		BIT(21)
+#define MPFS_CAN_MSG_WPNH		BIT(23)
+
+/* ID, ACR and AMR share one layout */
+#define MPFS_CAN_ID_EFF_SHIFT		3
+#define MPFS_CAN_ID_SFF_SHIFT		21
+#define MPFS_CAN_ID_IDE			BIT(2)
+#define MPFS_CAN_ID_RTR			BIT(1)
+
+#define MPFS_CAN_TX_NUM			32
+#define MPFS_CAN_RX_NUM			32
+/* Lower RX buffers are only released as a group, see mpfs_can_poll_rx() */
+#define MPFS_CAN_RX_LOW_LAST		23
+#define MPFS_CAN_RX_LOW_MASK		GENMASK(MPFS_CAN_RX_LOW_LAST, 0)
+
+struct mpfs_can_priv {
+	struct can_priv can;	/* must be the first member */
+	struct napi_struct napi;
+	void __iomem *base;
+	struct clk *clk;
+
+	spinlock_t tx_lock;	/* protects tx_head/tx_tail */
+	unsigned int tx_head;
+	unsigned int tx_tail;
+	unsigned int rx_next;
+
+	canid_t filter_id;
+	canid_t filter_mask;
+};
+
+static const struct can_bittiming_const mpfs_can_bittiming_const = {
+	.name = KBUILD_MODNAME,
+	.tseg1_min = 2,
+	.tseg1_max = 16,
+	.tseg2_min = 1,
+	.tseg2_max = 8,
+	.sjw_max = 4,
+	.brp_min = 1,
+	.brp_max = 32768,
+	.brp_inc = 1,
+};
+
+static inline u32 mpfs_can_read(const struct mpfs_can_priv *priv, u32 reg)
+{
+	return readl(priv->base + reg);
+}
+
+static inline void mpfs_can_write(const struct mpfs_can_priv *priv, u32 reg,
+				  u32 val)
+{
+	writel(val, priv->base + reg);
+}
+
+static u32 mpfs_can_id_to_reg(canid_t can_id)
+{
+	if (can_id & CAN_EFF_FLAG)
+		return ((can_id & CAN_EFF_MASK) << MPFS_CAN_ID_EFF_SHIFT) |
+			MPFS_CAN_ID_IDE;
+
+	return (can_id & CAN_SFF_MASK) << MPFS_CAN_ID_SFF_SHIFT;
+}
+
+/*
+ * Program the same acceptance filter into every RX buffer. The SocketCAN
+ * style mask (1 = must match) is inverted into the AMR (1 = don't care).
+ * IDE and RTR only take part in the match if the mask asks for them.
+ */
+static void mpfs_can_set_filters(const struct mpfs_can_priv *priv)
+{
+	canid_t eff = priv->filter_id & CAN_EFF_FLAG;
+	u32 acr = mpfs_can_id_to_reg(priv->filter_id);
+	u32 amr = mpfs_can_id_to_reg(priv->filter_mask | eff);
+	unsigned int i;
+
+	/* The mask is laid out like the ID it applies to */
+	amr &= ~MPFS_CAN_ID_IDE;
+	if (priv->filter_mask & CAN_EFF_FLAG)
+		amr |= MPFS_CAN_ID_IDE;
+	if (priv->filter_mask & CAN_RTR_FLAG)
+		amr |= MPFS_CAN_ID_RTR;
+	if (priv->filter_id & CAN_RTR_FLAG)
+		acr |= MPFS_CAN_ID_RTR;
+
+	for (i = 0; i < MPFS_CAN_RX_NUM; i++) {
+		mpfs_can_write(priv, MPFS_CAN_RX_MSG(i) + MPFS_CAN_RX_ACR, acr);
+		mpfs_can_write(priv, MPFS_CAN_RX_MSG(i) + MPFS_CAN_RX_AMR, ~amr);
+		mpfs_can_write(priv, MPFS_CAN_RX_MSG(i) + MPFS_CAN_RX_ACR_DATA, 0);
+		mpfs_can_write(priv, MPFS_CAN_RX_MSG(i) + MPFS_CAN_RX_AMR_DATA,
+			       ~0U);
+	}
+}
+
+/* Enabling a buffer and acking MSGAV hands it back to the controller */
+static void mpfs_can_activate_rx(const struct mpfs_can_priv *priv,
+				 unsigned long mask)
+{
+	unsigned int i;
+
+	for_each_set_bit(i, &mask, MPFS_CAN_RX_NUM)
+		mpfs_can_write(priv, MPFS_CAN_RX_MSG(i) + MPFS_CAN_MSG_CTRL,
+			       MPFS_CAN_RX_WPNL | MPFS_CAN_RX_BUF_EN |
+			       MPFS_CAN_RX_INT_EN | MPFS_CAN_RX_MSGAV);
+}
+
+static int mpfs_can_set_bittiming(struct net_device *dev)
+{
+	const struct mpfs_can_priv *priv = netdev_priv(dev);
+	const struct can_bittiming *bt = &priv->can.bittiming;
+	u32 cfg;
+
+	cfg = FIELD_PREP(MPFS_CAN_CFG_BITRATE, bt->brp - 1) |
+	      FIELD_PREP(MPFS_CAN_CFG_TSEG1, bt->prop_seg + bt->phase_seg1 - 1) |
+	      FIELD_PREP(MPFS_CAN_CFG_TSEG2, bt->phase_seg2 - 1) |
+	      FIELD_PREP(MPFS_CAN_CFG_SJW, bt->sjw - 1);
+	if (priv->can.ctrlmode & CAN_CTRLMODE_3_SAMPLES)
+		cfg |= MPFS_CAN_CFG_SAMPLING_MODE;
+
+	netdev_dbg(dev, "writing CONFIG 0x%08x\n", cfg);
+	mpfs_can_write(priv, MPFS_CAN_CONFIG, cfg);
+
+	return 0;
+}
+
+static int mpfs_can_get_berr_counter(const struct net_device *dev,
+				     struct can_berr_counter *bec)
+{
+	const struct mpfs_can_priv *priv = netdev_priv(dev);
+	u32 reg = mpfs_can_read(priv, MPFS_CAN_ERROR_STATUS);
+
+	bec->txerr = FIELD_GET(MPFS_CAN_ERR_TX_CNT, reg);
+	bec->rxerr = FIELD_GET(MPFS_CAN_ERR_RX_CNT, reg);
+
+	return 0;
+}
+
+static void mpfs_can_chip_stop(struct net_device *dev, enum can_state state)
+{
+	struct mpfs_can_priv *priv = netdev_priv(dev);
+	unsigned int i;
+
+	mpfs_can_write(priv, MPFS_CAN_INT_ENABLE, 0);
+	mpfs_can_write(priv, MPFS_CAN_COMMAND, 0);
+
+	for (i = 0; i < MPFS_CAN_TX_NUM; i++)
+		mpfs_can_write(priv, MPFS_CAN_TX_MSG(i) + MPFS_CAN_MSG_CTRL,
+			       MPFS_CAN_TX_ABORT);
+
+	priv->can.state = state;
+}
+
+static void mpfs_can_chip_start(struct net_device *dev)
+{
+	struct mpfs_can_priv *priv = netdev_priv(dev);
+	u32 cmd = MPFS_CAN_CMD_RUN;
+
+	mpfs_can_chip_stop(dev, CAN_STATE_STOPPED);
+
+	mpfs_can_set_bittiming(dev);
+	mpfs_can_set_filters(priv);
+	mpfs_can_activate_rx(priv, GENMASK(MPFS_CAN_RX_NUM - 1, 0));
+
+	spin_lock_bh(&priv->tx_lock);
+	priv->tx_head = 0;
+	priv->tx_tail = 0;
+	spin_unlock_bh(&priv->tx_lock);
+	priv->rx_next = 0;
+
+	mpfs_can_write(priv, MPFS_CAN_INT_STATUS, MPFS_CAN_INT_ALL);
+	mpfs_can_write(priv, MPFS_CAN_INT_ENABLE, MPFS_CAN_INT_GLOBAL |
+		       MPFS_CAN_INT_NAPI | MPFS_CAN_INT_RX_MSG_LOSS |
+		       MPFS_CAN_INT_BUS_OFF | MPFS_CAN_INT_ARB_LOSS |
+		       MPFS_CAN_INT_BUS_ERR);
+
+	if (priv->can.ctrlmode & CAN_CTRLMODE_LISTENONLY)
+		cmd |= MPFS_CAN_CMD_LISTEN_ONLY;
+	if (priv->can.ctrlmode & CAN_CTRLMODE_LOOPBACK)
+		cmd |= MPFS_CAN_CMD_LOOPBACK;
+	mpfs_can_write(priv, MPFS_CAN_COMMAND, cmd);
+
+	priv->can.state = CAN_STATE_ERROR_ACTIVE;
+}
+
+static netdev_tx_t mpfs_can_start_xmit(struct sk_buff *skb,
+				       struct net_device *dev)
+{
+	struct mpfs_can_priv *priv = netdev_priv(dev);
+	struct can_frame *cf = (struct can_frame *)skb->data;
+	unsigned int idx;
+	u32 ctrl, data[2] = { 0 };
+
+	if (can_dropped_invalid_skb(dev, skb))
+		return NETDEV_TX_OK;
+
+	spin_lock(&priv->tx_lock);
+
+	if (unlikely(priv->tx_head - priv->tx_tail >= MPFS_CAN_TX_NUM)) {
+		netif_stop_queue(dev);
+		spin_unlock(&priv->tx_lock);
+		netdev_err(dev, "BUG! TX buffer full when queue awake!\n");
+		return NETDEV_TX_BUSY;
+	}
+
+	idx = priv->tx_head % MPFS_CAN_TX_NUM;
+
+	ctrl = MPFS_CAN_MSG_WPNH | FIELD_PREP(MPFS_CAN_MSG_DLC, cf->len) |
+	       MPFS_CAN_TX_WPNL | MPFS_CAN_TX_INT_EN | MPFS_CAN_TX_REQ;
+	if (cf->can_id & CAN_EFF_FLAG)
+		ctrl |= MPFS_CAN_MSG_IDE;
+	if (cf->can_id & CAN_RTR_FLAG)
+		ctrl |= MPFS_CAN_MSG_RTR;
+	else
+		memcpy(data, cf->data, cf->len);
+
+	mpfs_can_write(priv, MPFS_CAN_TX_MSG(idx) + MPFS_CAN_MSG_ID,
+		       mpfs_can_id_to_reg(cf->can_id));
+	mpfs_can_write(priv, MPFS_CAN_TX_MSG(idx) + MPFS_CAN_MSG_DATA_HIGH,
+		       data[0]);
+	mpfs_can_write(priv, MPFS_CAN_TX_MSG(idx) + MPFS_CAN_MSG_DATA_LOW,
+		       data[1]);
+
+	can_put_echo_skb(skb, dev, idx, 0);
+
+	/* This triggers transmission */
+	mpfs_can_write(priv, MPFS_CAN_TX_MSG(idx) + MPFS_CAN_MSG_CTRL, ctrl);
+
+	if (++priv->tx_head - priv->tx_tail >= MPFS_CAN_TX_NUM)
+		netif_stop_queue(dev);
+
+	spin_unlock(&priv->tx_lock);
+
+	return NETDEV_TX_OK;
+}
+
+static int mpfs_can_poll_tx(struct net_device *dev)
+{
+	struct mpfs_can_priv *priv = netdev_priv(dev);
+	struct net_device_stats *stats = &dev->stats;
+	u32 pending = mpfs_can_read(priv, MPFS_CAN_TX_BUF_STATUS);
+	unsigned int idx;
+	int done = 0;
+
+	spin_lock(&priv->tx_lock);
+
+	while (priv->tx_head != priv->tx_tail) {
+		idx = priv->tx_tail % MPFS_CAN_TX_NUM;
+		if (pending & BIT(idx))
+			break;
+
+		stats->tx_bytes += can_get_echo_skb(dev, idx, NULL);
+		stats->tx_packets++;
+		can_led_event(dev, CAN_LED_EVENT_TX);
+		priv->tx_tail++;
+		done++;
+	}
+
+	if (done && netif_queue_stopped(dev))
+		netif_wake_queue(dev);
+
+	spin_unlock(&priv->tx_lock);
+
+	return done;
+}
+
+static void mpfs_can_read_msg(struct net_device *dev, unsigned int idx)
+{
+	const struct mpfs_can_priv *priv = netdev_priv(dev);
+	struct net_device_stats *stats = &dev->stats;
+	struct can_frame *cf;
+	struct sk_buff *skb;
+	u32 ctrl, id, data[2];
+
+	skb = alloc_can_skb(dev, &cf);
+	if (unlikely(!skb)) {
+		stats->rx_dropped++;
+		return;
+	}
+
+	ctrl = mpfs_can_read(priv, MPFS_CAN_RX_MSG(idx) + MPFS_CAN_MSG_CTRL);
+	id = mpfs_can_read(priv, MPFS_CAN_RX_MSG(idx) + MPFS_CAN_MSG_ID);
+
+	if (ctrl & MPFS_CAN_MSG_IDE)
+		cf->can_id = ((id >> MPFS_CAN_ID_EFF_SHIFT) & CAN_EFF_MASK) |
+			     CAN_EFF_FLAG;
+	else
+		cf->can_id = (id >> MPFS_CAN_ID_SFF_SHIFT) & CAN_SFF_MASK;
+
+	cf->len = can_cc_dlc2len(FIELD_GET(MPFS_CAN_MSG_DLC, ctrl));
+
+	if (ctrl & MPFS_CAN_MSG_RTR) {
+		cf->can_id |= CAN_RTR_FLAG;
+	} else {
+		data[0] = mpfs_can_read(priv, MPFS_CAN_RX_MSG(idx) +
+					MPFS_CAN_MSG_DATA_HIGH);
+		data[1] = mpfs_can_read(priv, MPFS_CAN_RX_MSG(idx) +
+					MPFS_CAN_MSG_DATA_LOW);
+		memcpy(cf->data, data, cf->len);
+	}
+
+	stats->rx_packets++;
+	stats->rx_bytes += cf->len;
+	netif_receive_skb(skb);
+
+	can_led_event(dev, CAN_LED_EVENT_RX);
+}
+
+/*
+ * Like the AT91 CAN, the controller stores a frame into the lowest free
+ * buffer, so reading in buffer order alone would reorder frames. The lower
+ * buffers are read but only handed back once the whole low group has been
+ * drained; the upper ones act as overflow and are released one by one.
+ */
+static int mpfs_can_poll_rx(struct net_device *dev, int quota)
+{
+	struct mpfs_can_priv *priv = netdev_priv(dev);
+	unsigned long pending;
+	unsigned int idx;
+	int received = 0;
+
+again:
+	pending = mpfs_can_read(priv, MPFS_CAN_RX_BUF_STATUS);
+	for (idx = find_next_bit(&pending, MPFS_CAN_RX_NUM, priv->rx_next);
+	     idx < MPFS_CAN_RX_NUM && quota > 0;
+	     pending = mpfs_can_read(priv, MPFS_CAN_RX_BUF_STATUS),
+	     idx = find_next_bit(&pending, MPFS_CAN_RX_NUM, ++priv->rx_next)) {
+		priv->rx_next = idx;
+		mpfs_can_read_msg(dev, idx);
+
+		if (idx == MPFS_CAN_RX_LOW_LAST)
+			mpfs_can_activate_rx(priv, MPFS_CAN_RX_LOW_MASK);
+		else if (idx > MPFS_CAN_RX_LOW_LAST)
+			mpfs_can_activate_rx(priv, BIT(idx));
+
+		received++;
+		quota--;
+	}
+
+	/* upper group completed, look again in lower */
+	if (priv->rx_next > MPFS_CAN_RX_LOW_LAST && idx >= MPFS_CAN_RX_NUM) {
+		priv->rx_next = 0;
+		if (quota > 0)
+			goto again;
+	}
+
+	return received;
+}
+
+static int mpfs_can_poll(struct napi_struct *napi, int quota)
+{
+	struct net_device *dev = napi->dev;
+	struct mpfs_can_priv *priv = netdev_priv(dev);
+	int work_done;
+
+	mpfs_can_poll_tx(dev);
+	work_done = mpfs_can_poll_rx(dev, quota);
+
+	if (work_done < quota && napi_complete_done(napi, work_done))
+		mpfs_can_write(priv, MPFS_CAN_INT_ENABLE,
+			       mpfs_can_read(priv, MPFS_CAN_INT_ENABLE) |
+			       MPFS_CAN_INT_NAPI);
+
+	return work_done;
+}
+
+static void mpfs_can_irq_err(struct net_device *dev, u32 status)
+{
+	struct mpfs_can_priv *priv = netdev_priv(dev);
+	struct net_device_stats *stats = &dev->stats;
+	enum can_state state, rx_state, tx_state;
+	struct can_frame *cf;
+	struct sk_buff *skb;
+	u32 err;
+
+	skb = alloc_can_err_skb(dev, &cf);
+
+	if (status & MPFS_CAN_INT_RX_MSG_LOSS) {
+		stats->rx_over_errors++;
+		stats->rx_errors++;
+		if (skb) {
+			cf->can_id |= CAN_ERR_CRTL;
+			cf->data[1] = CAN_ERR_CRTL_RX_OVERFLOW;
+		}
+	}
+
+	if (status & MPFS_CAN_INT_ARB_LOSS) {
+		priv->can.can_stats.arbitration_lost++;
+		if (skb)
+			cf->can_id |= CAN_ERR_LOSTARB;
+	}
+
+	if (status & MPFS_CAN_INT_BUS_ERR) {
+		priv->can.can_stats.bus_error++;
+		stats->rx_errors++;
+		if (skb) {
+			cf->can_id |= CAN_ERR_PROT | CAN_ERR_BUSERROR;
+			if (status & MPFS_CAN_INT_BIT_ERR)
+				cf->data[2] |= CAN_ERR_PROT_BIT;
+			if (status & MPFS_CAN_INT_STUFF_ERR)
+				cf->data[2] |= CAN_ERR_PROT_STUFF;
+			if (status & MPFS_CAN_INT_FORM_ERR)
+				cf->data[2] |= CAN_ERR_PROT_FORM;
+			if (status & MPFS_CAN_INT_CRC_ERR)
+				cf->data[3] = CAN_ERR_PROT_LOC_CRC_SEQ;
+			if (status & MPFS_CAN_INT_ACK_ERR) {
+				cf->can_id |= CAN_ERR_ACK;
+				cf->data[3] = CAN_ERR_PROT_LOC_ACK;
+			}
+		}
+	}
+
+	err = mpfs_can_read(priv, MPFS_CAN_ERROR_STATUS);
+	if (status & MPFS_CAN_INT_BUS_OFF)
+		state = CAN_STATE_BUS_OFF;
+	else if (FIELD_GET(MPFS_CAN_ERR_STATE, err) == MPFS_CAN_STATE_PASSIVE)
+		state = CAN_STATE_ERROR_PASSIVE;
+	else if (err & (MPFS_CAN_ERR_TX_GTE96 | MPFS_CAN_ERR_RX_GTE96))
+		state = CAN_STATE_ERROR_WARNING;
+	else
+		state = CAN_STATE_ERROR_ACTIVE;
+
+	if (state != priv->can.state) {
+		tx_state = FIELD_GET(MPFS_CAN_ERR_TX_CNT, err) >=
+			   FIELD_GET(MPFS_CAN_ERR_RX_CNT, err) ? state : 0;
+		rx_state = FIELD_GET(MPFS_CAN_ERR_TX_CNT, err) <=
+			   FIELD_GET(MPFS_CAN_ERR_RX_CNT, err) ? state : 0;
+		can_change_state(dev, skb ? cf : NULL, tx_state, rx_state);
+
+		if (state == CAN_STATE_BUS_OFF) {
+			mpfs_can_chip_stop(dev, CAN_STATE_BUS_OFF);
+			can_bus_off(dev);
+		}
+	}
+
+	if (!skb)
+		return;
+
+	if (cf->can_id == CAN_ERR_FLAG) {
+		kfree_skb(skb);
+		return;
+	}
+
+	stats->rx_packets++;
+	stats->rx_bytes += cf->len;
+	netif_rx(skb);
+}
+
+static irqreturn_t mpfs_can_irq(int irq, void *dev_id)
+{
+	struct net_device *dev = dev_id;
+	struct mpfs_can_priv *priv = netdev_priv(dev);
+	u32 status, enable;
+
+	enable = mpfs_can_read(priv, MPFS_CAN_INT_ENABLE);
+	status = mpfs_can_read(priv, MPFS_CAN_INT_STATUS) & enable;
+	if (!status)
+		return IRQ_NONE;
+
+	mpfs_can_write(priv, MPFS_CAN_INT_STATUS, status);
+
+	if (status & MPFS_CAN_INT_NAPI) {
+		mpfs_can_write(priv, MPFS_CAN_INT_ENABLE,
+			       enable & ~MPFS_CAN_INT_NAPI);
+		napi_schedule(&priv->napi);
+	}
+
+	if (status & ~MPFS_CAN_INT_NAPI)
+		mpfs_can_irq_err(dev, status);
+
+	return IRQ_HANDLED;
+}
+
+static int mpfs_can_open(struct net_device *dev)
+{
+	struct mpfs_can_priv *priv = netdev_priv(dev);
+	int err;
+
+	err = clk_prepare_enable(priv->clk);
+	if (err)
+		return err;
+
+	err = open_candev(dev);
+	if (err)
+		goto out_clk;
+
+	err = request_irq(dev->irq, mpfs_can_irq, IRQF_SHARED, dev->name, dev);
+	if (err)
+		goto out_close;
+
+	mpfs_can_chip_start(dev);
+	can_led_event(dev, CAN_LED_EVENT_OPEN);
+	napi_enable(&priv->napi);
+	netif_start_queue(dev);
+
+	return 0;
+
+out_close:
+	close_candev(dev);
+out_clk:
+	clk_disable_unprepare(priv->clk);
+
+	return err;
+}
+
+static int mpfs_can_close(struct net_device *dev)
+{
+	struct mpfs_can_priv *priv = netdev_priv(dev);
+
+	netif_stop_queue(dev);
+	napi_disable(&priv->napi);
+	mpfs_can_chip_stop(dev, CAN_STATE_STOPPED);
+
+	free_irq(dev->irq, dev);
+	can_flush_echo_skb(dev);
+	clk_disable_unprepare(priv->clk);
+
+	close_candev(dev);
+	can_led_event(dev, CAN_LED_EVENT_STOP);
+
+	return 0;
+}
+
+static int mpfs_can_set_mode(struct net_device *dev, enum can_mode mode)
+{
+	switch (mode) {
+	case CAN_MODE_START:
+		mpfs_can_chip_start(dev);
+		netif_wake_queue(dev);
+		break;
+
+	default:
+		return -EOPNOTSUPP;
+	}
+
+	return 0;
+}
+
+static const struct net_device_ops mpfs_can_netdev_ops = {
+	.ndo_open	= mpfs_can_open,
+	.ndo_stop	= mpfs_can_close,
+	.ndo_start_xmit	= mpfs_can_start_xmit,
+	.ndo_change_mtu	= can_change_mtu,
+};
+
+/*
+ * The acceptance filter is shared by all RX buffers. It takes a CAN ID and
+ * a mask with the usual SocketCAN flags and applies on the next start.
+ */
+static ssize_t mpfs_can_filter_store(struct net_device *ndev,
+				     canid_t *field, const char *buf,
+				     size_t count)
+{
+	u32 val;
+	ssize_t ret;
+	int err;
+
+	rtnl_lock();
+
+	if (ndev->flags & IFF_UP) {
+		ret = -EBUSY;
+		goto out;
+	}
+
+	err = kstrtou32(buf, 0, &val);
+	if (err) {
+		ret = err;
+		goto out;
+	}
+
+	*field = val;
+	ret = count;
+
+ out:
+	rtnl_unlock();
+	return ret;
+}
+
+static ssize_t filter_id_show(struct device *dev,
+			      struct device_attribute *attr, char *buf)
+{
+	struct mpfs_can_priv *priv = netdev_priv(to_net_dev(dev));
+
+	return sprintf(buf, "0x%08x\n", priv->filter_id);
+}
+
+static ssize_t filter_id_store(struct device *dev,
+			       struct device_attribute *attr,
+			       const char *buf, size_t count)
+{
+	struct net_device *ndev = to_net_dev(dev);
+	struct mpfs_can_priv *priv = netdev_priv(ndev);
+
+	return mpfs_can_filter_store(ndev, &priv->filter_id, buf, count);
+}
+
+static ssize_t filter_mask_show(struct device *dev,
+				struct device_attribute *attr, char *buf)
+{
+	struct mpfs_can_priv *priv = netdev_priv(to_net_dev(dev));
+
+	return sprintf(buf, "0x%08x\n", priv->filter_mask);
+}
+
+static ssize_t filter_mask_store(struct device *dev,
+				 struct device_attribute *attr,
+				 const char *buf, size_t count)
+{
+	struct net_device *ndev = to_net_dev(dev);
+	struct mpfs_can_priv *priv = netdev_priv(ndev);
+
+	return mpfs_can_filter_store(ndev, &priv->filter_mask, buf, count);
+}
+
+static DEVICE_ATTR_RW(filter_id);
+static DEVICE_ATTR_RW(filter_mask);
+
+static struct attribute *mpfs_can_sysfs_attrs[] = {
+	&dev_attr_filter_id.attr,
+	&dev_attr_filter_mask.attr,
+	NULL,
+};
+
+static const struct attribute_group mpfs_can_sysfs_attr_group = {
+	.attrs = mpfs_can_sysfs_attrs,
+};
+
+static int mpfs_can_probe(struct platform_device *pdev)
+{
+	struct mpfs_can_priv *priv;
+	struct net_device *dev;
+	void __iomem *base;
+	struct clk *clk;
+	int err, irq;
+
+	base = devm_platform_ioremap_resource(pdev, 0);
+	if (IS_ERR(base))
+		return PTR_ERR(base);
+
+	irq = platform_get_irq(pdev, 0);
+	if (irq < 0)
+		return irq;
+
+	clk = devm_clk_get(&pdev->dev, NULL);
+	if (IS_ERR(clk))
+		return dev_err_probe(&pdev->dev, PTR_ERR(clk),
+				     "failed to get clock\n");
+
+	dev = alloc_candev(sizeof(*priv), MPFS_CAN_TX_NUM);
+	if (!dev)
+		return -ENOMEM;
+
+	dev->netdev_ops = &mpfs_can_netdev_ops;
+	dev->irq = irq;
+	dev->flags |= IFF_ECHO;
+	dev->sysfs_groups[0] = &mpfs_can_sysfs_attr_group;
+
+	priv = netdev_priv(dev);
+	priv->can.clock.freq = clk_get_rate(clk);
+	priv->can.bittiming_const = &mpfs_can_bittiming_const;
+	priv->can.do_set_mode = mpfs_can_set_mode;
+	priv->can.do_get_berr_counter = mpfs_can_get_berr_counter;
+	priv->can.ctrlmode_supported = CAN_CTRLMODE_3_SAMPLES |
+		CAN_CTRLMODE_LISTENONLY | CAN_CTRLMODE_LOOPBACK;
+	priv->base = base;
+	priv->clk = clk;
+	spin_lock_init(&priv->tx_lock);
+
+	netif_napi_add(dev, &priv->napi, mpfs_can_poll, MPFS_CAN_RX_NUM);
+
+	platform_set_drvdata(pdev, dev);
+	SET_NETDEV_DEV(dev, &pdev->dev);
+
+	err = register_candev(dev);
+	if (err) {
+		dev_err(&pdev->dev, "registering netdev failed\n");
+		goto exit_free;
+	}
+
+	devm_can_led_init(dev);
+
+	dev_info(&pdev->dev, "device registered (irq=%d, clock=%u)\n",
+		 dev->irq, priv->can.clock.freq);
+
+	return 0;
+
+exit_free:
+	netif_napi_del(&priv->napi);
+	free_candev(dev);
+
+	return err;
+}
+
+static int mpfs_can_remove(struct platform_device *pdev)
+{
+	struct net_device *dev = platform_get_drvdata(pdev);
+	struct mpfs_can_priv *priv = netdev_priv(dev);
+
+	unregister_candev(dev);
+	netif_napi_del(&priv->napi);
+	free_candev(dev);
+
+	return 0;
+}
+
+static const struct of_device_id mpfs_can_of_match[] = {
+	{ .compatible = "microchip,mpfs-can" },
+	{ /* sentinel */ }
+};
+MODULE_DEVICE_TABLE(of, mpfs_can_of_match);
+
+static struct platform_driver mpfs_can_driver = {
+	.probe = mpfs_can_probe,
+	.remove = mpfs_can_remove,
+	.driver = {
+		.name = KBUILD_MODNAME,
+		.of_match_table = mpfs_can_of_match,
+	},
+};
+
+module_platform_driver(mpfs_can_driver);
+
+MODULE_LICENSE("GPL v2");
+MODULE_DESCRIPTION("Microchip PolarFire SoC MSS CAN netdevice driver");
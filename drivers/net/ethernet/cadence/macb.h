@@ -8,10 +8,12 @@
 #define _MACB_H
 
 #include <linux/clk.h>
+#include <linux/dim.h>
 #include <linux/phylink.h>
 #include <linux/ptp_clock_kernel.h>
 #include <linux/net_tstamp.h>
 #include <linux/interrupt.h>
+#include <net/xdp.h>
 
 #if defined(CONFIG_ARCH_DMA_ADDR_T_64BIT) || defined(CONFIG_MACB_USE_HWSTAMP)
 #define MACB_EXT_DESC
@@ -83,6 +85,7 @@
 #define GEM_DMACFG		0x0010 /* DMA Configuration */
 #define GEM_JML			0x0048 /* Jumbo Max Length */
 #define GEM_HS_MAC_CONFIG	0x0050 /* GEM high speed config */
+#define GEM_INTMOD		0x005c /* Interrupt Moderation */
 #define GEM_HRB			0x0080 /* Hash Bottom */
 #define GEM_HRT			0x0084 /* Hash Top */
 #define GEM_SA1B		0x0088 /* Specific1 Bottom */
@@ -93,6 +96,7 @@
 #define GEM_SA3T		0x009C /* Specific3 Top */
 #define GEM_SA4B		0x00A0 /* Specific4 Bottom */
 #define GEM_SA4T		0x00A4 /* Specific4 Top */
+#define MACB_NUM_SPECIFIC_ADDR	4      /* SA1 holds the station address */
 #define GEM_WOL			0x00b8 /* Wake on LAN */
 #define GEM_EFTSH		0x00e8 /* PTP Event Frame Transmitted Seconds Register 47:32 */
 #define GEM_EFRSH		0x00ec /* PTP Event Frame Received Seconds Register 47:32 */
@@ -169,6 +173,10 @@
 #define GEM_DCFG8		0x029C /* Design Config 8 */
 #define GEM_DCFG10		0x02A4 /* Design Config 10 */
 #define GEM_DCFG12		0x02AC /* Design Config 12 */
+#define GEM_ENST_START_TIME(q)	(0x0800 + ((q) << 2)) /* ENST Queue Start Time */
+#define GEM_ENST_ON_TIME(q)	(0x0820 + ((q) << 2)) /* ENST Queue On Time */
+#define GEM_ENST_OFF_TIME(q)	(0x0840 + ((q) << 2)) /* ENST Queue Off Time */
+#define GEM_ENST_CONTROL	0x0880 /* ENST Control */
 #define GEM_USX_CONTROL		0x0A80 /* High speed PCS control register */
 #define GEM_USX_STATUS		0x0A88 /* High speed PCS status register */
 
@@ -196,6 +204,12 @@
 /* Which screening type 2 EtherType register will be used (0 - 7) */
 #define SCRT2_ETHT		0
 
+/* Largest flow spreading table, limited by the 4-bit SCRT2 queue field */
+#define MACB_RSS_MAX		16
+
+/* Most flows steered by accelerated RFS at a time */
+#define MACB_ARFS_MAX		8
+
 #define GEM_ISR(hw_q)		(0x0400 + ((hw_q) << 2))
 #define GEM_TBQP(hw_q)		(0x0440 + ((hw_q) << 2))
 #define GEM_TBQPH(hw_q)		(0x04C8)
@@ -329,6 +343,12 @@
 #define GEM_ADDR64_OFFSET	30 /* Address bus width - 64b or 32b */
 #define GEM_ADDR64_SIZE		1
 
+/* Bitfields in INTMOD, in units of 800ns */
+#define GEM_RX_INTMOD_OFFSET	0 /* RX interrupt moderation */
+#define GEM_RX_INTMOD_SIZE	8
+#define GEM_TX_INTMOD_OFFSET	16 /* TX interrupt moderation */
+#define GEM_TX_INTMOD_SIZE	8
+#define GEM_INTMOD_NS		800
 
 /* Bitfields in NSR */
 #define MACB_NSR_LINK_OFFSET	0 /* pcs_link_state */
@@ -565,6 +585,21 @@
 #define GEM_TN_OFFSET				0 /* TSU timer value (ns) */
 #define GEM_TN_SIZE					30
 
+/* Bitfields in ENST_START_TIME */
+#define GEM_ENST_START_NSEC_OFFSET		0
+#define GEM_ENST_START_NSEC_SIZE		30
+#define GEM_ENST_START_SEC_OFFSET		30 /* TSU seconds[1:0] */
+#define GEM_ENST_START_SEC_SIZE			2
+
+/* Bitfields in ENST_ON_TIME and ENST_OFF_TIME, in units of 8 ns */
+#define GEM_ENST_TIME_OFFSET			0
+#define GEM_ENST_TIME_SIZE			17
+#define GEM_ENST_TIME_UNIT_NS			8
+
+/* Bitfields in ENST_CONTROL, one bit per queue */
+#define GEM_ENST_ENABLE_OFFSET			0
+#define GEM_ENST_DISABLE_OFFSET			16
+
 /* Bitfields in TXBDCTRL */
 #define GEM_TXTSMODE_OFFSET			4 /* TX Descriptor Timestamp Insertion mode */
 #define GEM_TXTSMODE_SIZE			2
@@ -699,6 +734,7 @@
 #define MACB_CAPS_GEM_HAS_PTP			0x00000040
 #define MACB_CAPS_BD_RD_PREFETCH		0x00000080
 #define MACB_CAPS_NEEDS_RSTONUBR		0x00000100
+#define MACB_CAPS_QBV				0x00000200
 #define MACB_CAPS_CLK_HW_CHG			0x04000000
 #define MACB_CAPS_MACB_IS_EMAC			0x08000000
 #define MACB_CAPS_FIFO_MODE			0x10000000
@@ -902,16 +938,22 @@ struct gem_tx_ts {
 /* struct macb_tx_skb - data about an skb which is being transmitted
  * @skb: skb currently being transmitted, only set for the last buffer
  *       of the frame
- * @mapping: DMA address of the skb's fragment buffer
+ * @xdpf: XDP frame currently being transmitted, used instead of @skb
+ * @mapping: DMA address of the skb's fragment buffer, zero for XDP_TX
+ *           frames whose page is still mapped by the RX page_pool
  * @size: size of the DMA mapped buffer
  * @mapped_as_page: true when buffer was mapped with skb_frag_dma_map(),
  *                  false when buffer was mapped with dma_map_single()
+ * @xsk: AF_XDP zero-copy buffer, owned and mapped by the queue's xsk_pool
  */
 struct macb_tx_skb {
 	struct sk_buff		*skb;
+	struct xdp_frame	*xdpf;
 	dma_addr_t		mapping;
 	size_t			size;
 	bool			mapped_as_page;
+	bool			xsk;
+	bool			bounced;	/* sent from the queue's tx_bounce */
 };
 
 /* Hardware-collected statistics. Used when updating the network
@@ -1105,6 +1147,13 @@ struct queue_stats {
 	unsigned long tx_packets;
 	unsigned long tx_bytes;
 	unsigned long tx_dropped;
+	/* XDP verdicts; TX and redirect are frames that bypassed the stack */
+	unsigned long rx_xdp_pass;
+	unsigned long rx_xdp_tx;
+	unsigned long rx_xdp_redirect;
+	unsigned long rx_xdp_drop;
+	unsigned long rx_refill_failed;
+	unsigned long napi_budget_exhausted;
 };
 
 static const struct gem_statistic queue_statistics[] = {
@@ -1114,6 +1163,12 @@ static const struct gem_statistic queue_statistics[] = {
 		QUEUE_STAT_TITLE("tx_packets"),
 		QUEUE_STAT_TITLE("tx_bytes"),
 		QUEUE_STAT_TITLE("tx_dropped"),
+		QUEUE_STAT_TITLE("rx_xdp_pass"),
+		QUEUE_STAT_TITLE("rx_xdp_tx"),
+		QUEUE_STAT_TITLE("rx_xdp_redirect"),
+		QUEUE_STAT_TITLE("rx_xdp_drop"),
+		QUEUE_STAT_TITLE("rx_refill_failed"),
+		QUEUE_STAT_TITLE("napi_budget_exhausted"),
 };
 
 #define QUEUE_STATS_LEN ARRAY_SIZE(queue_statistics)
@@ -1121,6 +1176,17 @@ static const struct gem_statistic queue_statistics[] = {
 struct macb;
 struct macb_queue;
 
+/* An IPv4 TCP/UDP flow steered to @rxq for accelerated RFS */
+struct macb_arfs_filter {
+	__be32			saddr;
+	__be32			daddr;
+	__be16			sport;
+	__be16			dport;
+	u32			flow_id;
+	u16			rxq;
+	bool			used;
+};
+
 struct macb_or_gem_ops {
 	int	(*mog_alloc_rx_buffers)(struct macb *bp);
 	void	(*mog_free_rx_buffers)(struct macb *bp);
@@ -1146,6 +1212,7 @@ struct macb_ptp_info {
 struct macb_pm_data {
 	u32 scrt2;
 	u32 usrio;
+	bool fast;	/* link and PHY are kept across this suspend */
 };
 
 struct macb_usrio_config {
@@ -1186,10 +1253,14 @@ struct macb_queue {
 	unsigned int		RBQP;
 	unsigned int		RBQPH;
 
+	/* Lock protecting tx_head and tx_tail */
+	spinlock_t		tx_ptr_lock;
 	unsigned int		tx_head, tx_tail;
 	struct macb_dma_desc	*tx_ring;
 	struct macb_tx_skb	*tx_skb;
 	dma_addr_t		tx_ring_dma;
+	void			*tx_bounce;
+	dma_addr_t		tx_bounce_dma;
 	struct work_struct	tx_error_task;
 
 	dma_addr_t		rx_ring_dma;
@@ -1197,7 +1268,13 @@ struct macb_queue {
 	unsigned int		rx_tail;
 	unsigned int		rx_prepared_head;
 	struct macb_dma_desc	*rx_ring;
-	struct sk_buff		**rx_skbuff;
+	struct page		**rx_page;
+	/* Frame being assembled from several RX buffers */
+	struct sk_buff		*rx_skb;
+	struct page_pool	*page_pool;
+	struct xdp_rxq_info	xdp_rxq;
+	struct xsk_buff_pool	*xsk_pool;
+	struct xdp_buff		**rx_xsk;
 	void			*rx_buffers;
 	struct napi_struct	napi;
 	struct queue_stats stats;
@@ -1228,6 +1305,12 @@ struct macb {
 	void	(*macb_reg_writel)(struct macb *bp, int offset, u32 value);
 
 	size_t			rx_buffer_size;
+	unsigned int		rx_headroom;
+	unsigned int		rx_page_order;
+	unsigned int		rx_frag_stride;	/* 0: one buffer per page */
+	bool			rx_frags;
+	bool			rx_hdr_split;	/* full-page buffers */
+	struct bpf_prog		*xdp_prog;
 
 	unsigned int		rx_ring_size;
 	unsigned int		tx_ring_size;
@@ -1235,6 +1318,11 @@ struct macb {
 	unsigned int		num_queues;
 	unsigned int		queue_mask;
 	struct macb_queue	queues[MACB_MAX_QUEUES];
+	/* Hardware queues left to user space, not in queue_mask */
+	unsigned int		uio_queue_mask;
+#ifdef CONFIG_MACB_UIO
+	struct macb_uio_queue	*uio[MACB_MAX_QUEUES];
+#endif
 
 	spinlock_t		lock;
 	struct platform_device	*pdev;
@@ -1287,6 +1375,18 @@ struct macb {
 	struct ethtool_rx_fs_list rx_fs_list;
 	spinlock_t rx_fs_lock;
 	unsigned int max_tuples;
+	/* Flow spreading over the queues, on the type 2 screeners after the
+	 * max_tuples available to ntuple rules
+	 */
+	unsigned int rss_base;
+	unsigned int rss_size;
+	u8 rss_indir[MACB_RSS_MAX];
+#ifdef CONFIG_RFS_ACCEL
+	/* Accelerated RFS, on the screeners between ntuple and spreading */
+	unsigned int arfs_base;
+	unsigned int arfs_size;
+	struct macb_arfs_filter arfs[MACB_ARFS_MAX];
+#endif
 
 	struct tasklet_struct	hresp_err_tasklet;
 
@@ -1297,6 +1397,13 @@ struct macb {
 
 	struct macb_pm_data pm_data;
 	const struct macb_usrio_config *usrio;
+
+	/* Interrupt moderation, shared by all queues */
+	u32			rx_coalesce_usecs;
+	u32			tx_coalesce_usecs;
+	bool			rx_dim_enabled;
+	struct dim		rx_dim;
+	u16			rx_dim_events;
 };
 
 #ifdef CONFIG_MACB_USE_HWSTAMP
@@ -1344,6 +1451,41 @@ static inline int gem_ptp_do_txstamp(struct macb_queue *queue, struct sk_buff *s
 static inline void gem_ptp_do_rxstamp(struct macb *bp, struct sk_buff *skb, struct macb_dma_desc *desc) { }
 #endif
 
+#ifdef CONFIG_MACB_UIO
+unsigned int macb_uio_queue_mask(struct platform_device *pdev,
+				 unsigned int queue_mask);
+int macb_uio_probe(struct macb *bp);
+void macb_uio_remove(struct macb *bp);
+#else
+static inline unsigned int macb_uio_queue_mask(struct platform_device *pdev,
+					       unsigned int queue_mask)
+{
+	return 0;
+}
+
+static inline int macb_uio_probe(struct macb *bp) { return 0; }
+static inline void macb_uio_remove(struct macb *bp) { }
+#endif
+
+/* Queue interrupts are listed in hardware queue order, exported ones too */
+static inline int macb_queue_irq_index(struct macb *bp, unsigned int hw_q)
+{
+	return hweight32((bp->queue_mask | bp->uio_queue_mask) &
+			 (BIT(hw_q) - 1));
+}
+
+/* Hardware queue behind net_device queue @q, for the screeners */
+static inline unsigned int macb_hw_queue(struct macb *bp, unsigned int q)
+{
+	unsigned int hw_q;
+
+	for (hw_q = 0; hw_q < MACB_MAX_QUEUES - 1; hw_q++)
+		if ((bp->queue_mask & BIT(hw_q)) && !q--)
+			break;
+
+	return hw_q;
+}
+
 static inline bool macb_is_gem(struct macb *bp)
 {
 	return !!(bp->caps & MACB_CAPS_MACB_IS_GEM);
@@ -14,6 +14,7 @@
 #include <linux/kernel.h>
 #include <linux/types.h>
 #include <linux/circ_buf.h>
+#include <linux/cpu_rmap.h>
 #include <linux/slab.h>
 #include <linux/init.h>
 #include <linux/io.h>
@@ -35,8 +36,19 @@
 #include <linux/tcp.h>
 #include <linux/iopoll.h>
 #include <linux/pm_runtime.h>
+#include <linux/suspend.h>
+#include <linux/bpf.h>
+#include <linux/bpf_trace.h>
+#include <linux/filter.h>
+#include <net/page_pool.h>
+#include <net/pkt_sched.h>
+#include <net/xdp_sock_drv.h>
+#include <asm/unaligned.h>
 #include "macb.h"
 
+#define CREATE_TRACE_POINTS
+#include "macb_trace.h"
+
 /* This structure is only used for MACB on SiFive FU540 devices */
 struct sifive_fu540_macb_mgmt {
 	void __iomem *reg;
@@ -79,8 +91,17 @@ struct sifive_fu540_macb_mgmt {
 #define GEM_MAX_TX_LEN		(unsigned int)(0x3FC0)
 
 #define GEM_MTU_MIN_SIZE	ETH_MIN_MTU
+
+/* 8 bit interrupt moderation counters of 800ns */
+#define GEM_INTMOD_MAX_USECS	204
 #define MACB_NETIF_LSO		NETIF_F_TSO
 
+/* Frames up to this size, FCS included, are copied into a per-queue area
+ * allocated with the TX ring instead of being DMA mapped one by one
+ */
+#define MACB_TX_BOUNCE_SIZE	256
+#define MACB_RX_HDR_SIZE	256
+
 #define MACB_WOL_HAS_MAGIC_PACKET	(0x1 << 0)
 #define MACB_WOL_ENABLED		(0x1 << 1)
 
@@ -980,6 +1001,26 @@ static void macb_tx_unmap(struct macb *bp, struct macb_tx_skb *tx_skb)
 		dev_kfree_skb_any(tx_skb->skb);
 		tx_skb->skb = NULL;
 	}
+
+	tx_skb->bounced = false;
+}
+
+/* XDP frames are handed back to their page_pool, so unlike skbs this
+ * must not be done from hard IRQ context or with interrupts disabled
+ * outside of softirq.
+ */
+static void macb_tx_return_xdp(struct macb_tx_skb *tx_skb)
+{
+	if (tx_skb->xdpf) {
+		xdp_return_frame(tx_skb->xdpf);
+		tx_skb->xdpf = NULL;
+	}
+}
+
+/* Only the last buffer of a frame records what has to be released */
+static bool macb_tx_skb_is_last(struct macb_tx_skb *tx_skb)
+{
+	return tx_skb->skb || tx_skb->xdpf || tx_skb->xsk || tx_skb->bounced;
 }
 
 static void macb_set_addr(struct macb *bp, struct macb_dma_desc *desc, dma_addr_t addr)
@@ -1015,6 +1056,18 @@ static dma_addr_t macb_get_addr(struct macb *bp, struct macb_dma_desc *desc)
 	return addr;
 }
 
+/* NCR is shared with the interrupt handler, so the doorbell is rung under
+ * bp->lock even though the TX ring itself is guarded by tx_ptr_lock.
+ */
+static void macb_tx_kick(struct macb *bp)
+{
+	unsigned long flags;
+
+	spin_lock_irqsave(&bp->lock, flags);
+	macb_writel(bp, NCR, macb_readl(bp, NCR) | MACB_BIT(TSTART));
+	spin_unlock_irqrestore(&bp->lock, flags);
+}
+
 static void macb_tx_error_task(struct work_struct *work)
 {
 	struct macb_queue	*queue = container_of(work, struct macb_queue,
@@ -1022,21 +1075,21 @@ static void macb_tx_error_task(struct work_struct *work)
 	struct macb		*bp = queue->bp;
 	struct macb_tx_skb	*tx_skb;
 	struct macb_dma_desc	*desc;
-	struct sk_buff		*skb;
-	unsigned int		tail;
+	unsigned int		tail, head;
+	unsigned int		xsk_frames = 0;
 	unsigned long		flags;
 
 	netdev_vdbg(bp->dev, "macb_tx_error_task: q = %u, t = %u, h = %u\n",
 		    (unsigned int)(queue - bp->queues),
 		    queue->tx_tail, queue->tx_head);
 
-	/* Prevent the queue IRQ handlers from running: each of them may call
-	 * macb_tx_interrupt(), which in turn may call netif_wake_subqueue().
-	 * As explained below, we have to halt the transmission before updating
-	 * TBQP registers so we call netif_tx_stop_all_queues() to notify the
-	 * network engine about the macb/gem being halted.
+	/* The queue TX lock keeps the queue NAPI out of macb_tx_complete(),
+	 * which in turn may call netif_wake_subqueue(). As explained below,
+	 * we have to halt the transmission before updating TBQP registers so
+	 * we call netif_tx_stop_all_queues() to notify the network engine
+	 * about the macb/gem being halted.
 	 */
-	spin_lock_irqsave(&bp->lock, flags);
+	spin_lock_bh(&queue->tx_ptr_lock);
 
 	/* Make sure nobody is trying to queue up new packets */
 	netif_tx_stop_all_queues(bp->dev);
@@ -1045,41 +1098,44 @@ static void macb_tx_error_task(struct work_struct *work)
 	 * (in case we have just queued new packets)
 	 * macb/gem must be halted to write TBQP register
 	 */
+	spin_lock_irqsave(&bp->lock, flags);
 	if (macb_halt_tx(bp))
 		/* Just complain for now, reinitializing TX path can be good */
 		netdev_err(bp->dev, "BUG: halt tx timed out\n");
+	spin_unlock_irqrestore(&bp->lock, flags);
 
 	/* Treat frames in TX queue including the ones that caused the error.
 	 * Free transmit buffers in upper layer.
 	 */
-	for (tail = queue->tx_tail; tail != queue->tx_head; tail++) {
+	head = queue->tx_head;
+	for (tail = queue->tx_tail; tail != head; tail++) {
 		u32	ctrl;
 
 		desc = macb_tx_desc(queue, tail);
 		ctrl = desc->ctrl;
 		tx_skb = macb_tx_skb(queue, tail);
-		skb = tx_skb->skb;
 
 		if (ctrl & MACB_BIT(TX_USED)) {
-			/* skb is set for the last buffer of the frame */
-			while (!skb) {
+			while (!macb_tx_skb_is_last(tx_skb)) {
 				macb_tx_unmap(bp, tx_skb);
 				tail++;
 				tx_skb = macb_tx_skb(queue, tail);
-				skb = tx_skb->skb;
 			}
 
 			/* ctrl still refers to the first buffer descriptor
 			 * since it's the only one written back by the hardware
 			 */
 			if (!(ctrl & MACB_BIT(TX_BUF_EXHAUSTED))) {
-				netdev_vdbg(bp->dev, "txerr skb %u (data %p) TX complete\n",
-					    macb_tx_ring_wrap(bp, tail),
-					    skb->data);
+				unsigned int len = tx_skb->skb ?
+						   tx_skb->skb->len :
+						   tx_skb->size;
+
+				netdev_vdbg(bp->dev, "txerr frame %u TX complete\n",
+					    macb_tx_ring_wrap(bp, tail));
 				bp->dev->stats.tx_packets++;
 				queue->stats.tx_packets++;
-				bp->dev->stats.tx_bytes += skb->len;
-				queue->stats.tx_bytes += skb->len;
+				bp->dev->stats.tx_bytes += len;
+				queue->stats.tx_bytes += len;
 			}
 		} else {
 			/* "Buffers exhausted mid-frame" errors may only happen
@@ -1093,9 +1149,17 @@ static void macb_tx_error_task(struct work_struct *work)
 			desc->ctrl = ctrl | MACB_BIT(TX_USED);
 		}
 
+		if (tx_skb->xsk) {
+			tx_skb->xsk = false;
+			xsk_frames++;
+		}
 		macb_tx_unmap(bp, tx_skb);
+		macb_tx_return_xdp(tx_skb);
 	}
 
+	if (xsk_frames)
+		xsk_tx_completed(queue->xsk_pool, xsk_frames);
+
 	/* Set end of TX queue */
 	desc = macb_tx_desc(queue, 0);
 	macb_set_addr(bp, desc, 0);
@@ -1120,15 +1184,18 @@ static void macb_tx_error_task(struct work_struct *work)
 
 	/* Now we are ready to start transmission again */
 	netif_tx_start_all_queues(bp->dev);
-	macb_writel(bp, NCR, macb_readl(bp, NCR) | MACB_BIT(TSTART));
+	macb_tx_kick(bp);
 
-	spin_unlock_irqrestore(&bp->lock, flags);
+	spin_unlock_bh(&queue->tx_ptr_lock);
 }
 
-static void macb_tx_interrupt(struct macb_queue *queue)
+/* Reap completed TX buffers, called from the queue NAPI with tx_ptr_lock held */
+static void macb_tx_complete(struct macb_queue *queue)
 {
 	unsigned int tail;
 	unsigned int head;
+	unsigned int xsk_frames = 0;
+	unsigned int frames = 0;
 	u32 status;
 	struct macb *bp = queue->bp;
 	u16 queue_index = queue - bp->queues;
@@ -1136,10 +1203,7 @@ static void macb_tx_interrupt(struct macb_queue *queue)
 	status = macb_readl(bp, TSR);
 	macb_writel(bp, TSR, status);
 
-	if (bp->caps & MACB_CAPS_ISR_CLEAR_ON_WRITE)
-		queue_writel(queue, ISR, MACB_BIT(TCOMP));
-
-	netdev_vdbg(bp->dev, "macb_tx_interrupt status = 0x%03lx\n",
+	netdev_vdbg(bp->dev, "macb_tx_complete status = 0x%03lx\n",
 		    (unsigned long)status);
 
 	head = queue->tx_head;
@@ -1147,6 +1211,7 @@ static void macb_tx_interrupt(struct macb_queue *queue)
 		struct macb_tx_skb	*tx_skb;
 		struct sk_buff		*skb;
 		struct macb_dma_desc	*desc;
+		bool			last;
 		u32			ctrl;
 
 		desc = macb_tx_desc(queue, tail);
@@ -1166,6 +1231,7 @@ static void macb_tx_interrupt(struct macb_queue *queue)
 		for (;; tail++) {
 			tx_skb = macb_tx_skb(queue, tail);
 			skb = tx_skb->skb;
+			last = macb_tx_skb_is_last(tx_skb);
 
 			/* First, update TX stats if needed */
 			if (skb) {
@@ -1184,20 +1250,38 @@ static void macb_tx_interrupt(struct macb_queue *queue)
 				queue->stats.tx_packets++;
 				bp->dev->stats.tx_bytes += skb->len;
 				queue->stats.tx_bytes += skb->len;
+			} else if (last) {
+				bp->dev->stats.tx_packets++;
+				queue->stats.tx_packets++;
+				bp->dev->stats.tx_bytes += tx_skb->size;
+				queue->stats.tx_bytes += tx_skb->size;
+			}
+
+			if (tx_skb->xsk) {
+				tx_skb->xsk = false;
+				xsk_frames++;
 			}
 
 			/* Now we can safely release resources */
 			macb_tx_unmap(bp, tx_skb);
+			macb_tx_return_xdp(tx_skb);
 
-			/* skb is set only for the last buffer of the frame.
-			 * WARNING: at this point skb has been freed by
-			 * macb_tx_unmap().
+			/* skb, xdpf or xsk is set only for the last buffer of
+			 * the frame. WARNING: at this point skb and xdpf have
+			 * been freed.
 			 */
-			if (skb)
+			if (last)
 				break;
 		}
+		frames++;
 	}
 
+	trace_macb_tx_complete(bp->dev, queue_index, frames,
+			       CIRC_CNT(head, tail, bp->tx_ring_size));
+
+	if (xsk_frames)
+		xsk_tx_completed(queue->xsk_pool, xsk_frames);
+
 	queue->tx_tail = tail;
 	if (__netif_subqueue_stopped(bp->dev, queue_index) &&
 	    CIRC_CNT(queue->tx_head, queue->tx_tail,
@@ -1205,14 +1289,92 @@ static void macb_tx_interrupt(struct macb_queue *queue)
 		netif_wake_subqueue(bp->dev, queue_index);
 }
 
+static bool macb_tx_complete_pending(struct macb_queue *queue)
+{
+	if (queue->tx_head == queue->tx_tail)
+		return false;
+
+	/* Make hw descriptor updates visible to CPU */
+	rmb();
+
+	return !!(macb_tx_desc(queue, queue->tx_tail)->ctrl &
+		  MACB_BIT(TX_USED));
+}
+
+/* Same as gem_rx_refill() for a queue bound to an AF_XDP socket: a slot
+ * is only prepared once the fill ring has provided a buffer for it.
+ */
+static void gem_rx_refill_zc(struct macb_queue *queue)
+{
+	struct xsk_buff_pool *pool = queue->xsk_pool;
+	struct macb *bp = queue->bp;
+	struct macb_dma_desc *desc;
+	struct xdp_buff *xdp;
+	unsigned int entry;
+	dma_addr_t paddr;
+
+	while (CIRC_SPACE(queue->rx_prepared_head, queue->rx_tail,
+			bp->rx_ring_size) > 0) {
+		entry = macb_rx_ring_wrap(bp, queue->rx_prepared_head);
+
+		/* Make hw descriptor updates visible to CPU */
+		rmb();
+
+		desc = macb_rx_desc(queue, entry);
+
+		if (!queue->rx_xsk[entry]) {
+			xdp = xsk_buff_alloc(pool);
+			if (!xdp) {
+				queue->stats.rx_refill_failed++;
+				break;
+			}
+
+			queue->rx_xsk[entry] = xdp;
+
+			paddr = xsk_buff_xdp_get_dma(xdp);
+			if (entry == bp->rx_ring_size - 1)
+				paddr |= MACB_BIT(RX_WRAP);
+			desc->ctrl = 0;
+			/* Setting addr clears RX_USED and allows reception,
+			 * make sure ctrl is cleared first to avoid a race.
+			 */
+			dma_wmb();
+			macb_set_addr(bp, desc, paddr);
+		} else {
+			desc->ctrl = 0;
+			dma_wmb();
+			desc->addr &= ~MACB_BIT(RX_USED);
+		}
+
+		queue->rx_prepared_head++;
+	}
+
+	/* Make descriptor updates visible to hardware */
+	wmb();
+
+	if (xsk_uses_need_wakeup(pool)) {
+		if (CIRC_SPACE(queue->rx_prepared_head, queue->rx_tail,
+			       bp->rx_ring_size) > 0)
+			xsk_set_rx_need_wakeup(pool);
+		else
+			xsk_clear_rx_need_wakeup(pool);
+	}
+}
+
 static void gem_rx_refill(struct macb_queue *queue)
 {
+	unsigned int		offset;
 	unsigned int		entry;
-	struct sk_buff		*skb;
+	struct page		*page;
 	dma_addr_t		paddr;
 	struct macb *bp = queue->bp;
 	struct macb_dma_desc *desc;
 
+	if (queue->xsk_pool) {
+		gem_rx_refill_zc(queue);
+		return;
+	}
+
 	while (CIRC_SPACE(queue->rx_prepared_head, queue->rx_tail,
 			bp->rx_ring_size) > 0) {
 		entry = macb_rx_ring_wrap(bp, queue->rx_prepared_head);
@@ -1223,26 +1385,32 @@ static void gem_rx_refill(struct macb_queue *queue)
 		queue->rx_prepared_head++;
 		desc = macb_rx_desc(queue, entry);
 
-		if (!queue->rx_skbuff[entry]) {
-			/* allocate sk_buff for this free entry in ring */
-			skb = netdev_alloc_skb(bp->dev, bp->rx_buffer_size);
-			if (unlikely(!skb)) {
+		if (!queue->rx_page[entry]) {
+			/* allocate a page for this free entry in ring, the
+			 * page_pool hands it out already mapped and synced
+			 */
+			offset = 0;
+			if (bp->rx_frag_stride)
+				page = page_pool_dev_alloc_frag(queue->page_pool,
+								&offset,
+								bp->rx_frag_stride);
+			else
+				page = page_pool_dev_alloc_pages(queue->page_pool);
+			if (unlikely(!page)) {
 				netdev_err(bp->dev,
-					   "Unable to allocate sk_buff\n");
-				break;
-			}
-
-			/* now fill corresponding descriptor entry */
-			paddr = dma_map_single(&bp->pdev->dev, skb->data,
-					       bp->rx_buffer_size,
-					       DMA_FROM_DEVICE);
-			if (dma_mapping_error(&bp->pdev->dev, paddr)) {
-				dev_kfree_skb(skb);
+					   "Unable to allocate RX page\n");
+				queue->stats.rx_refill_failed++;
 				break;
 			}
 
-			queue->rx_skbuff[entry] = skb;
+			queue->rx_page[entry] = page;
 
+			/* now fill corresponding descriptor entry, hardware
+			 * adds the RBOF offset to properly align the
+			 * Ethernet header
+			 */
+			paddr = page_pool_get_dma_addr(page) + offset +
+				bp->rx_headroom;
 			if (entry == bp->rx_ring_size - 1)
 				paddr |= MACB_BIT(RX_WRAP);
 			desc->ctrl = 0;
@@ -1251,9 +1419,6 @@ static void gem_rx_refill(struct macb_queue *queue)
 			 */
 			dma_wmb();
 			macb_set_addr(bp, desc, paddr);
-
-			/* properly align Ethernet header */
-			skb_reserve(skb, NET_IP_ALIGN);
 		} else {
 			desc->ctrl = 0;
 			dma_wmb();
@@ -1289,20 +1454,171 @@ static void discard_partial_frame(struct macb_queue *queue, unsigned int begin,
 	 */
 }
 
-static int gem_rx(struct macb_queue *queue, struct napi_struct *napi,
-		  int budget)
+static int macb_xdp_submit_frame(struct macb *bp, struct macb_queue *queue,
+				 struct xdp_frame *xdpf, bool dma_map);
+static bool macb_xsk_xmit(struct macb_queue *queue, unsigned int budget);
+
+/* Send an XDP_TX frame back out of the queue it arrived on */
+static int macb_xdp_xmit_back(struct macb_queue *queue, struct xdp_buff *xdp)
 {
 	struct macb *bp = queue->bp;
-	unsigned int		len;
-	unsigned int		entry;
-	struct sk_buff		*skb;
-	struct macb_dma_desc	*desc;
-	int			count = 0;
+	struct xdp_frame *xdpf;
+	int ret;
+
+	xdpf = xdp_convert_buff_to_frame(xdp);
+	if (unlikely(!xdpf))
+		return -EOVERFLOW;
+
+	spin_lock(&queue->tx_ptr_lock);
+	ret = macb_xdp_submit_frame(bp, queue, xdpf, false);
+	spin_unlock(&queue->tx_ptr_lock);
+
+	return ret;
+}
+
+static u32 gem_run_xdp(struct macb_queue *queue, struct bpf_prog *prog,
+		       struct xdp_buff *xdp, struct page *page)
+{
+	struct macb *bp = queue->bp;
+	u32 act;
+
+	act = bpf_prog_run_xdp(prog, xdp);
+	switch (act) {
+	case XDP_PASS:
+		queue->stats.rx_xdp_pass++;
+		return act;
+	case XDP_TX:
+		if (macb_xdp_xmit_back(queue, xdp))
+			goto drop;
+		queue->stats.rx_xdp_tx++;
+		return act;
+	case XDP_REDIRECT:
+		if (xdp_do_redirect(bp->dev, xdp, prog))
+			goto drop;
+		queue->stats.rx_xdp_redirect++;
+		return act;
+	default:
+		bpf_warn_invalid_xdp_action(act);
+		fallthrough;
+	case XDP_ABORTED:
+		trace_xdp_exception(bp->dev, prog, act);
+		fallthrough;
+	case XDP_DROP:
+		break;
+	}
+
+drop:
+	page_pool_recycle_direct(queue->page_pool, page);
+	bp->dev->stats.rx_dropped++;
+	queue->stats.rx_dropped++;
+	queue->stats.rx_xdp_drop++;
+
+	return XDP_DROP;
+}
+
+static void gem_rx_deliver(struct macb_queue *queue, struct napi_struct *napi,
+			   struct sk_buff *skb, struct macb_dma_desc *desc,
+			   u32 ctrl)
+{
+	struct macb *bp = queue->bp;
+
+	skb->protocol = eth_type_trans(skb, bp->dev);
+	skb_checksum_none_assert(skb);
+	if (bp->dev->features & NETIF_F_RXCSUM &&
+	    !(bp->dev->flags & IFF_PROMISC) &&
+	    GEM_BFEXT(RX_CSUM, ctrl) & GEM_RX_CSUM_CHECKED_MASK)
+		skb->ip_summed = CHECKSUM_UNNECESSARY;
+
+	gem_ptp_do_rxstamp(bp, skb, desc);
+
+#if defined(DEBUG) && defined(VERBOSE_DEBUG)
+	netdev_vdbg(bp->dev, "received skb of length %u, csum: %08x\n",
+		    skb->len, skb->csum);
+	print_hex_dump(KERN_DEBUG, " mac: ", DUMP_PREFIX_ADDRESS, 16, 1,
+		       skb_mac_header(skb), 16, true);
+	print_hex_dump(KERN_DEBUG, "data: ", DUMP_PREFIX_ADDRESS, 16, 1,
+		       skb->data, 32, true);
+#endif
+
+	napi_gro_receive(napi, skb);
+}
+
+static u32 gem_run_xdp_zc(struct macb_queue *queue, struct bpf_prog *prog,
+			  struct xdp_buff *xdp)
+{
+	struct macb *bp = queue->bp;
+	struct xdp_frame *xdpf;
+	int err;
+	u32 act;
+
+	act = bpf_prog_run_xdp(prog, xdp);
+	switch (act) {
+	case XDP_REDIRECT:
+		if (xdp_do_redirect(bp->dev, xdp, prog))
+			break;
+		queue->stats.rx_xdp_redirect++;
+		return act;
+	case XDP_PASS:
+		queue->stats.rx_xdp_pass++;
+		return act;
+	case XDP_TX:
+		/* UMEM buffers cannot be held by the TX ring, the frame
+		 * is copied into a page of its own and then mapped
+		 */
+		xdpf = xdp_convert_buff_to_frame(xdp);
+		if (unlikely(!xdpf))
+			break;
+
+		spin_lock(&queue->tx_ptr_lock);
+		err = macb_xdp_submit_frame(bp, queue, xdpf, true);
+		spin_unlock(&queue->tx_ptr_lock);
+		if (err) {
+			xdp_return_frame_rx_napi(xdpf);
+			bp->dev->stats.rx_dropped++;
+			queue->stats.rx_dropped++;
+			queue->stats.rx_xdp_drop++;
+			return XDP_DROP;
+		}
+		queue->stats.rx_xdp_tx++;
+		return act;
+	default:
+		bpf_warn_invalid_xdp_action(act);
+		fallthrough;
+	case XDP_ABORTED:
+		trace_xdp_exception(bp->dev, prog, act);
+		fallthrough;
+	case XDP_DROP:
+		break;
+	}
+
+	xsk_buff_free(xdp);
+	bp->dev->stats.rx_dropped++;
+	queue->stats.rx_dropped++;
+	queue->stats.rx_xdp_drop++;
+
+	return XDP_DROP;
+}
+
+/* Receive path of a queue bound to an AF_XDP socket */
+static int gem_rx_zc(struct macb_queue *queue, struct napi_struct *napi,
+		     int budget)
+{
+	struct macb *bp = queue->bp;
+	bool xdp_redirect = false;
+	bool xdp_tx = false;
+	struct macb_dma_desc *desc;
+	struct bpf_prog *prog;
+	struct sk_buff *skb;
+	struct xdp_buff *xdp;
+	unsigned int entry;
+	unsigned int len;
+	int count = 0;
+	u32 act;
+
+	prog = READ_ONCE(bp->xdp_prog);
 
 	while (count < budget) {
 		u32 ctrl;
-		dma_addr_t addr;
-		bool rxused;
 
 		entry = macb_rx_ring_wrap(bp, queue->rx_tail);
 		desc = macb_rx_desc(queue, entry);
@@ -1310,10 +1626,7 @@ static int gem_rx(struct macb_queue *queue, struct napi_struct *napi,
 		/* Make hw descriptor updates visible to CPU */
 		rmb();
 
-		rxused = (desc->addr & MACB_BIT(RX_USED)) ? true : false;
-		addr = macb_get_addr(bp, desc);
-
-		if (!rxused)
+		if (!(desc->addr & MACB_BIT(RX_USED)))
 			break;
 
 		/* Ensure ctrl is at least as up-to-date as rxused */
@@ -1331,112 +1644,487 @@ static int gem_rx(struct macb_queue *queue, struct napi_struct *napi,
 			queue->stats.rx_dropped++;
 			break;
 		}
-		skb = queue->rx_skbuff[entry];
-		if (unlikely(!skb)) {
+		xdp = queue->rx_xsk[entry];
+		if (unlikely(!xdp)) {
 			netdev_err(bp->dev,
 				   "inconsistent Rx descriptor chain\n");
 			bp->dev->stats.rx_dropped++;
 			queue->stats.rx_dropped++;
 			break;
 		}
-		/* now everything is ready for receiving packet */
-		queue->rx_skbuff[entry] = NULL;
+		queue->rx_xsk[entry] = NULL;
 		len = ctrl & bp->rx_frm_len_mask;
 
-		netdev_vdbg(bp->dev, "gem_rx %u (len %u)\n", entry, len);
-
-		skb_put(skb, len);
-		dma_unmap_single(&bp->pdev->dev, addr,
-				 bp->rx_buffer_size, DMA_FROM_DEVICE);
-
-		skb->protocol = eth_type_trans(skb, bp->dev);
-		skb_checksum_none_assert(skb);
-		if (bp->dev->features & NETIF_F_RXCSUM &&
-		    !(bp->dev->flags & IFF_PROMISC) &&
-		    GEM_BFEXT(RX_CSUM, ctrl) & GEM_RX_CSUM_CHECKED_MASK)
-			skb->ip_summed = CHECKSUM_UNNECESSARY;
+		/* the hardware stored the frame RBOF bytes into the buffer */
+		xdp->data += NET_IP_ALIGN;
+		xdp->data_end = xdp->data + len;
+		xdp_set_data_meta_invalid(xdp);
+		xsk_buff_dma_sync_for_cpu(xdp, queue->xsk_pool);
 
 		bp->dev->stats.rx_packets++;
 		queue->stats.rx_packets++;
-		bp->dev->stats.rx_bytes += skb->len;
-		queue->stats.rx_bytes += skb->len;
+		bp->dev->stats.rx_bytes += len;
+		queue->stats.rx_bytes += len;
 
-		gem_ptp_do_rxstamp(bp, skb, desc);
+		act = prog ? gem_run_xdp_zc(queue, prog, xdp) : XDP_PASS;
+		if (act == XDP_REDIRECT) {
+			xdp_redirect = true;
+			continue;
+		} else if (act == XDP_TX) {
+			xdp_tx = true;
+			continue;
+		} else if (act != XDP_PASS) {
+			continue;
+		}
 
-#if defined(DEBUG) && defined(VERBOSE_DEBUG)
-		netdev_vdbg(bp->dev, "received skb of length %u, csum: %08x\n",
-			    skb->len, skb->csum);
-		print_hex_dump(KERN_DEBUG, " mac: ", DUMP_PREFIX_ADDRESS, 16, 1,
-			       skb_mac_header(skb), 16, true);
-		print_hex_dump(KERN_DEBUG, "data: ", DUMP_PREFIX_ADDRESS, 16, 1,
-			       skb->data, 32, true);
-#endif
+		/* frames for the stack are copied out of the UMEM */
+		skb = napi_alloc_skb(napi, len);
+		if (unlikely(!skb)) {
+			xsk_buff_free(xdp);
+			bp->dev->stats.rx_dropped++;
+			queue->stats.rx_dropped++;
+			continue;
+		}
+		skb_put_data(skb, xdp->data, len);
+		xsk_buff_free(xdp);
 
-		napi_gro_receive(napi, skb);
+		gem_rx_deliver(queue, napi, skb, desc, ctrl);
 	}
 
-	gem_rx_refill(queue);
+	if (xdp_redirect)
+		xdp_do_flush();
+
+	if (xdp_tx)
+		macb_tx_kick(bp);
+
+	gem_rx_refill_zc(queue);
 
 	return count;
 }
 
-static int macb_rx_frame(struct macb_queue *queue, struct napi_struct *napi,
-			 unsigned int first_frag, unsigned int last_frag)
-{
-	unsigned int len;
-	unsigned int frag;
-	unsigned int offset;
-	struct sk_buff *skb;
-	struct macb_dma_desc *desc;
-	struct macb *bp = queue->bp;
+/* skb heads for the frames of one NAPI poll, taken from the percpu
+ * cache MACB_RX_SKB_BULK at a time instead of once per frame
+ */
+#define MACB_RX_SKB_BULK	16
 
-	desc = macb_rx_desc(queue, last_frag);
-	len = desc->ctrl & bp->rx_frm_len_mask;
+struct gem_rx_skbs {
+	void	*skbs[MACB_RX_SKB_BULK];
+	u32	count;
+};
 
-	netdev_vdbg(bp->dev, "macb_rx_frame frags %u - %u (len %u)\n",
-		macb_rx_ring_wrap(bp, first_frag),
-		macb_rx_ring_wrap(bp, last_frag), len);
+static struct sk_buff *gem_rx_build_skb(struct gem_rx_skbs *heads,
+					void *data, unsigned int truesize,
+					int remaining)
+{
+	if (!heads->count) {
+		heads->count = napi_skb_cache_get_bulk(heads->skbs,
+						       min(remaining,
+							   MACB_RX_SKB_BULK));
+		if (unlikely(!heads->count))
+			return NULL;
+	}
 
-	/* The ethernet header starts NET_IP_ALIGN bytes into the
-	 * first buffer. Since the header is 14 bytes, this makes the
-	 * payload word-aligned.
-	 *
-	 * Instead of calling skb_reserve(NET_IP_ALIGN), we just copy
-	 * the two padding bytes into the skb so that we avoid hitting
-	 * the slowpath in memcpy(), and pull them off afterwards.
-	 */
-	skb = netdev_alloc_skb(bp->dev, len + NET_IP_ALIGN);
-	if (!skb) {
-		bp->dev->stats.rx_dropped++;
-		for (frag = first_frag; ; frag++) {
-			desc = macb_rx_desc(queue, frag);
-			desc->addr &= ~MACB_BIT(RX_USED);
-			if (frag == last_frag)
-				break;
-		}
+	return build_skb_around(heads->skbs[--heads->count], data, truesize);
+}
 
-		/* Make descriptor updates visible to hardware */
-		wmb();
+static void gem_rx_put_skbs(struct gem_rx_skbs *heads)
+{
+	napi_skb_cache_put_bulk(heads->skbs, heads->count);
+	heads->count = 0;
+}
 
-		return 1;
+/* Hand an RX buffer over to an skb.  A whole page simply leaves the
+ * pool, whereas a shared page stays mapped for the other buffers carved
+ * out of it: the skb takes its own reference and only this buffer's
+ * fragment is given back, so the page is recycled once both are gone.
+ */
+static void gem_rx_page_to_skb(struct macb_queue *queue, struct page *page)
+{
+	if (queue->bp->rx_frag_stride) {
+		get_page(page);
+		page_pool_recycle_direct(queue->page_pool, page);
+	} else {
+		page_pool_release_page(queue->page_pool, page);
 	}
+}
 
-	offset = 0;
-	len += NET_IP_ALIGN;
-	skb_checksum_none_assert(skb);
-	skb_put(skb, len);
+/* Full-page buffers leave no room for build_skb(): copy the headers into
+ * a small linear skb and attach the rest of the buffer as a page frag.
+ * Every following buffer of the frame then sits page aligned in the frag
+ * array, which is what TCP receive zerocopy needs to map it.
+ */
+static struct sk_buff *gem_rx_copy_head(struct macb_queue *queue,
+					struct napi_struct *napi,
+					struct page *page, unsigned int len)
+{
+	void *va = page_address(page) + NET_IP_ALIGN;
+	struct sk_buff *skb;
+	unsigned int hlen;
 
-	for (frag = first_frag; ; frag++) {
-		unsigned int frag_len = bp->rx_buffer_size;
+	skb = napi_alloc_skb(napi, MACB_RX_HDR_SIZE);
+	if (unlikely(!skb))
+		return NULL;
 
-		if (offset + frag_len > len) {
-			if (unlikely(frag != last_frag)) {
-				dev_kfree_skb_any(skb);
-				return -1;
-			}
-			frag_len = len - offset;
-		}
-		skb_copy_to_linear_data_offset(skb, offset,
+	hlen = len;
+	if (hlen > MACB_RX_HDR_SIZE)
+		hlen = eth_get_headlen(queue->bp->dev, va, MACB_RX_HDR_SIZE);
+	skb_put_data(skb, va, hlen);
+
+	if (len > hlen) {
+		page_pool_release_page(queue->page_pool, page);
+		skb_add_rx_frag(skb, 0, page, NET_IP_ALIGN + hlen, len - hlen,
+				PAGE_SIZE);
+	} else {
+		page_pool_recycle_direct(queue->page_pool, page);
+	}
+
+	return skb;
+}
+
+/* Without XDP every buffer is a page, or a fragment of a shared page, of
+ * its own and a frame may span several of them: the first one becomes the
+ * skb head, the following ones are attached as page frags. A frame can
+ * cross NAPI polls, it is kept in queue->rx_skb until its last buffer
+ * shows up.
+ */
+static int gem_rx_frags(struct macb_queue *queue, struct napi_struct *napi,
+			int budget)
+{
+	struct macb *bp = queue->bp;
+	struct sk_buff *skb = queue->rx_skb;
+	struct gem_rx_skbs heads = { .count = 0 };
+	struct macb_dma_desc *desc;
+	unsigned int truesize;
+	unsigned int frag_len;
+	unsigned int offset;
+	unsigned int entry;
+	unsigned int len;
+	struct page *page;
+	int count = 0;
+
+	truesize = bp->rx_frag_stride ?: PAGE_SIZE << bp->rx_page_order;
+
+	while (count < budget) {
+		u32 ctrl;
+		dma_addr_t addr;
+
+		entry = macb_rx_ring_wrap(bp, queue->rx_tail);
+		desc = macb_rx_desc(queue, entry);
+
+		/* Make hw descriptor updates visible to CPU */
+		rmb();
+
+		if (!(desc->addr & MACB_BIT(RX_USED)))
+			break;
+
+		/* Ensure ctrl is at least as up-to-date as rxused */
+		dma_rmb();
+
+		ctrl = desc->ctrl;
+		addr = macb_get_addr(bp, desc);
+
+		queue->rx_tail++;
+		count++;
+
+		page = queue->rx_page[entry];
+		if (unlikely(!page)) {
+			netdev_err(bp->dev,
+				   "inconsistent Rx descriptor chain\n");
+			bp->dev->stats.rx_dropped++;
+			queue->stats.rx_dropped++;
+			break;
+		}
+		queue->rx_page[entry] = NULL;
+		len = ctrl & bp->rx_frm_len_mask;
+		offset = addr - page_pool_get_dma_addr(page) - bp->rx_headroom;
+
+		if (ctrl & MACB_BIT(RX_SOF)) {
+			/* A frame whose last buffer never came is lost */
+			if (unlikely(skb)) {
+				dev_kfree_skb_any(skb);
+				skb = NULL;
+				bp->dev->stats.rx_dropped++;
+				queue->stats.rx_dropped++;
+			}
+
+			/* The Ethernet header starts NET_IP_ALIGN bytes into
+			 * the first buffer only
+			 */
+			frag_len = (ctrl & MACB_BIT(RX_EOF)) ? len :
+				   bp->rx_buffer_size - NET_IP_ALIGN;
+			if (unlikely(frag_len >
+				     bp->rx_buffer_size - NET_IP_ALIGN)) {
+				page_pool_recycle_direct(queue->page_pool,
+							 page);
+				bp->dev->stats.rx_dropped++;
+				queue->stats.rx_dropped++;
+				continue;
+			}
+
+			dma_sync_single_for_cpu(&bp->pdev->dev, addr,
+						frag_len + NET_IP_ALIGN,
+						DMA_FROM_DEVICE);
+
+			if (bp->rx_hdr_split) {
+				skb = gem_rx_copy_head(queue, napi, page,
+						       frag_len);
+			} else {
+				skb = gem_rx_build_skb(&heads,
+						       page_address(page) + offset,
+						       truesize, budget - count + 1);
+				if (likely(skb)) {
+					gem_rx_page_to_skb(queue, page);
+					skb_reserve(skb, bp->rx_headroom +
+						    NET_IP_ALIGN);
+					skb_put(skb, frag_len);
+				}
+			}
+			if (unlikely(!skb)) {
+				page_pool_recycle_direct(queue->page_pool,
+							 page);
+				bp->dev->stats.rx_dropped++;
+				queue->stats.rx_dropped++;
+				continue;
+			}
+		} else if (unlikely(!skb)) {
+			/* The head of this frame was dropped already */
+			page_pool_recycle_direct(queue->page_pool, page);
+			continue;
+		} else {
+			frag_len = (ctrl & MACB_BIT(RX_EOF)) ?
+				   len - skb->len : bp->rx_buffer_size;
+
+			if (unlikely(frag_len > bp->rx_buffer_size ||
+				     skb_shinfo(skb)->nr_frags >=
+				     MAX_SKB_FRAGS)) {
+				page_pool_recycle_direct(queue->page_pool,
+							 page);
+				dev_kfree_skb_any(skb);
+				skb = NULL;
+				bp->dev->stats.rx_dropped++;
+				queue->stats.rx_dropped++;
+				continue;
+			}
+
+			dma_sync_single_for_cpu(&bp->pdev->dev, addr,
+						frag_len, DMA_FROM_DEVICE);
+
+			gem_rx_page_to_skb(queue, page);
+			skb_add_rx_frag(skb, skb_shinfo(skb)->nr_frags, page,
+					offset + bp->rx_headroom, frag_len,
+					truesize);
+		}
+
+		if (!(ctrl & MACB_BIT(RX_EOF)))
+			continue;
+
+		netdev_vdbg(bp->dev, "gem_rx %u (len %u)\n", entry, len);
+
+		bp->dev->stats.rx_packets++;
+		queue->stats.rx_packets++;
+		bp->dev->stats.rx_bytes += len;
+		queue->stats.rx_bytes += len;
+
+		gem_rx_deliver(queue, napi, skb, desc, ctrl);
+		skb = NULL;
+	}
+
+	queue->rx_skb = skb;
+
+	gem_rx_put_skbs(&heads);
+	gem_rx_refill(queue);
+
+	return count;
+}
+
+static int gem_rx(struct macb_queue *queue, struct napi_struct *napi,
+		  int budget)
+{
+	struct macb *bp = queue->bp;
+	unsigned int		len;
+	unsigned int		entry;
+	struct page		*page;
+	struct sk_buff		*skb;
+	struct macb_dma_desc	*desc;
+	struct bpf_prog		*prog;
+	struct xdp_buff		xdp;
+	struct gem_rx_skbs	heads = { .count = 0 };
+	bool			xdp_tx = false;
+	bool			xdp_redirect = false;
+	int			count = 0;
+
+	if (queue->xsk_pool)
+		return gem_rx_zc(queue, napi, budget);
+
+	if (bp->rx_frags)
+		return gem_rx_frags(queue, napi, budget);
+
+	prog = READ_ONCE(bp->xdp_prog);
+	xdp_init_buff(&xdp, PAGE_SIZE << bp->rx_page_order, &queue->xdp_rxq);
+
+	while (count < budget) {
+		u32 ctrl;
+		dma_addr_t addr;
+		bool rxused;
+		void *va;
+
+		entry = macb_rx_ring_wrap(bp, queue->rx_tail);
+		desc = macb_rx_desc(queue, entry);
+
+		/* Make hw descriptor updates visible to CPU */
+		rmb();
+
+		rxused = (desc->addr & MACB_BIT(RX_USED)) ? true : false;
+		addr = macb_get_addr(bp, desc);
+
+		if (!rxused)
+			break;
+
+		/* Ensure ctrl is at least as up-to-date as rxused */
+		dma_rmb();
+
+		ctrl = desc->ctrl;
+
+		queue->rx_tail++;
+		count++;
+
+		if (!(ctrl & MACB_BIT(RX_SOF) && ctrl & MACB_BIT(RX_EOF))) {
+			netdev_err(bp->dev,
+				   "not whole frame pointed by descriptor\n");
+			bp->dev->stats.rx_dropped++;
+			queue->stats.rx_dropped++;
+			break;
+		}
+		page = queue->rx_page[entry];
+		if (unlikely(!page)) {
+			netdev_err(bp->dev,
+				   "inconsistent Rx descriptor chain\n");
+			bp->dev->stats.rx_dropped++;
+			queue->stats.rx_dropped++;
+			break;
+		}
+		/* now everything is ready for receiving packet */
+		queue->rx_page[entry] = NULL;
+		len = ctrl & bp->rx_frm_len_mask;
+
+		netdev_vdbg(bp->dev, "gem_rx %u (len %u)\n", entry, len);
+
+		dma_sync_single_for_cpu(&bp->pdev->dev, addr,
+					len + NET_IP_ALIGN,
+					page_pool_get_dma_dir(queue->page_pool));
+
+		bp->dev->stats.rx_packets++;
+		queue->stats.rx_packets++;
+		bp->dev->stats.rx_bytes += len;
+		queue->stats.rx_bytes += len;
+
+		va = page_address(page);
+		xdp_prepare_buff(&xdp, va, bp->rx_headroom + NET_IP_ALIGN,
+				 len, false);
+
+		if (prog) {
+			switch (gem_run_xdp(queue, prog, &xdp, page)) {
+			case XDP_PASS:
+				break;
+			case XDP_TX:
+				xdp_tx = true;
+				continue;
+			case XDP_REDIRECT:
+				xdp_redirect = true;
+				continue;
+			default:
+				continue;
+			}
+		}
+
+		skb = gem_rx_build_skb(&heads, va, PAGE_SIZE << bp->rx_page_order,
+				       budget - count + 1);
+		if (unlikely(!skb)) {
+			page_pool_recycle_direct(queue->page_pool, page);
+			bp->dev->stats.rx_dropped++;
+			queue->stats.rx_dropped++;
+			continue;
+		}
+
+		/* the page now belongs to the skb */
+		page_pool_release_page(queue->page_pool, page);
+
+		skb_reserve(skb, xdp.data - xdp.data_hard_start);
+		skb_put(skb, xdp.data_end - xdp.data);
+
+		gem_rx_deliver(queue, napi, skb, desc, ctrl);
+	}
+
+	gem_rx_put_skbs(&heads);
+
+	if (xdp_redirect)
+		xdp_do_flush();
+
+	if (xdp_tx)
+		macb_tx_kick(bp);
+
+	gem_rx_refill(queue);
+
+	return count;
+}
+
+static int macb_rx_frame(struct macb_queue *queue, struct napi_struct *napi,
+			 unsigned int first_frag, unsigned int last_frag)
+{
+	unsigned int len;
+	unsigned int frag;
+	unsigned int offset;
+	struct sk_buff *skb;
+	struct macb_dma_desc *desc;
+	struct macb *bp = queue->bp;
+
+	desc = macb_rx_desc(queue, last_frag);
+	len = desc->ctrl & bp->rx_frm_len_mask;
+
+	netdev_vdbg(bp->dev, "macb_rx_frame frags %u - %u (len %u)\n",
+		macb_rx_ring_wrap(bp, first_frag),
+		macb_rx_ring_wrap(bp, last_frag), len);
+
+	/* The ethernet header starts NET_IP_ALIGN bytes into the
+	 * first buffer. Since the header is 14 bytes, this makes the
+	 * payload word-aligned.
+	 *
+	 * Instead of calling skb_reserve(NET_IP_ALIGN), we just copy
+	 * the two padding bytes into the skb so that we avoid hitting
+	 * the slowpath in memcpy(), and pull them off afterwards.
+	 */
+	skb = netdev_alloc_skb(bp->dev, len + NET_IP_ALIGN);
+	if (!skb) {
+		bp->dev->stats.rx_dropped++;
+		for (frag = first_frag; ; frag++) {
+			desc = macb_rx_desc(queue, frag);
+			desc->addr &= ~MACB_BIT(RX_USED);
+			if (frag == last_frag)
+				break;
+		}
+
+		/* Make descriptor updates visible to hardware */
+		wmb();
+
+		return 1;
+	}
+
+	offset = 0;
+	len += NET_IP_ALIGN;
+	skb_checksum_none_assert(skb);
+	skb_put(skb, len);
+
+	for (frag = first_frag; ; frag++) {
+		unsigned int frag_len = bp->rx_buffer_size;
+
+		if (offset + frag_len > len) {
+			if (unlikely(frag != last_frag)) {
+				dev_kfree_skb_any(skb);
+				return -1;
+			}
+			frag_len = len - offset;
+		}
+		skb_copy_to_linear_data_offset(skb, offset,
 					       macb_rx_buffer(queue, frag),
 					       frag_len);
 		offset += bp->rx_buffer_size;
@@ -1563,9 +2251,19 @@ static int macb_poll(struct napi_struct *napi, int budget)
 {
 	struct macb_queue *queue = container_of(napi, struct macb_queue, napi);
 	struct macb *bp = queue->bp;
+	bool xsk_done = true;
 	int work_done;
 	u32 status;
 
+	/* TX completions are reaped here rather than in the interrupt
+	 * handler so that XDP frames go back to their page_pool from softirq
+	 */
+	spin_lock(&queue->tx_ptr_lock);
+	macb_tx_complete(queue);
+	if (queue->xsk_pool)
+		xsk_done = macb_xsk_xmit(queue, budget);
+	spin_unlock(&queue->tx_ptr_lock);
+
 	status = macb_readl(bp, RSR);
 	macb_writel(bp, RSR, status);
 
@@ -1573,17 +2271,38 @@ static int macb_poll(struct napi_struct *napi, int budget)
 		    (unsigned long)status, budget);
 
 	work_done = bp->macbgem_ops.mog_rx(queue, napi, budget);
+
+	trace_macb_rx_poll(bp->dev, queue - bp->queues, budget, work_done);
+	if (work_done >= budget)
+		queue->stats.napi_budget_exhausted++;
+
+	/* Keep polling while the AF_XDP socket has frames to send */
+	if (!xsk_done)
+		work_done = budget;
+
 	if (work_done < budget) {
+		/* The moderation register is shared, DIM follows queue 0 */
+		if (bp->rx_dim_enabled && queue == bp->queues) {
+			struct dim_sample dim_sample = {};
+
+			dim_update_sample(bp->rx_dim_events++,
+					  queue->stats.rx_packets,
+					  queue->stats.rx_bytes, &dim_sample);
+			net_dim(&bp->rx_dim, dim_sample);
+		}
+
 		napi_complete_done(napi, work_done);
 
-		/* Packets received while interrupts were disabled */
+		/* Packets received or sent while interrupts were disabled */
 		status = macb_readl(bp, RSR);
-		if (status) {
+		if (status || macb_tx_complete_pending(queue)) {
 			if (bp->caps & MACB_CAPS_ISR_CLEAR_ON_WRITE)
-				queue_writel(queue, ISR, MACB_BIT(RCOMP));
+				queue_writel(queue, ISR, MACB_BIT(RCOMP) |
+							 MACB_BIT(TCOMP));
 			napi_reschedule(napi);
 		} else {
-			queue_writel(queue, IER, bp->rx_intr_mask);
+			queue_writel(queue, IER, bp->rx_intr_mask |
+						 MACB_BIT(TCOMP));
 		}
 	}
 
@@ -1731,19 +2450,24 @@ static irqreturn_t macb_interrupt(int irq, void *dev_id)
 			    (unsigned int)(queue - bp->queues),
 			    (unsigned long)status);
 
-		if (status & bp->rx_intr_mask) {
+		if (status & (bp->rx_intr_mask | MACB_BIT(TCOMP))) {
 			/* There's no point taking any more interrupts
 			 * until we have processed the buffers. The
 			 * scheduling call may fail if the poll routine
 			 * is already scheduled, so disable interrupts
-			 * now.
+			 * now. TX completions are handled by the same
+			 * poll routine.
 			 */
-			queue_writel(queue, IDR, bp->rx_intr_mask);
+			queue_writel(queue, IDR, bp->rx_intr_mask |
+						 MACB_BIT(TCOMP));
 			if (bp->caps & MACB_CAPS_ISR_CLEAR_ON_WRITE)
-				queue_writel(queue, ISR, MACB_BIT(RCOMP));
+				queue_writel(queue, ISR, MACB_BIT(RCOMP) |
+							 MACB_BIT(TCOMP));
 
 			if (napi_schedule_prep(&queue->napi)) {
-				netdev_vdbg(bp->dev, "scheduling RX softirq\n");
+				netdev_vdbg(bp->dev, "scheduling NAPI softirq\n");
+				trace_macb_napi_schedule(dev, queue - bp->queues,
+							 status);
 				__napi_schedule(&queue->napi);
 			}
 		}
@@ -1758,9 +2482,6 @@ static irqreturn_t macb_interrupt(int irq, void *dev_id)
 			break;
 		}
 
-		if (status & MACB_BIT(TCOMP))
-			macb_tx_interrupt(queue);
-
 		if (status & MACB_BIT(TXUBR))
 			macb_tx_restart(queue);
 
@@ -1872,9 +2593,12 @@ static unsigned int macb_tx_map(struct macb *bp,
 
 		/* Save info to properly release resources */
 		tx_skb->skb = NULL;
+		tx_skb->xdpf = NULL;
+		tx_skb->xsk = false;
 		tx_skb->mapping = mapping;
 		tx_skb->size = size;
 		tx_skb->mapped_as_page = false;
+		tx_skb->bounced = false;
 
 		len -= size;
 		offset += size;
@@ -1902,9 +2626,12 @@ static unsigned int macb_tx_map(struct macb *bp,
 
 			/* Save info to properly release resources */
 			tx_skb->skb = NULL;
+			tx_skb->xdpf = NULL;
+			tx_skb->xsk = false;
 			tx_skb->mapping = mapping;
 			tx_skb->size = size;
 			tx_skb->mapped_as_page = true;
+			tx_skb->bounced = false;
 
 			len -= size;
 			offset += size;
@@ -2113,17 +2840,76 @@ static int macb_pad_and_fcs(struct sk_buff **skb, struct net_device *ndev)
 	return 0;
 }
 
+static void macb_tx_post_single(struct macb_queue *queue, dma_addr_t mapping,
+				u32 len, u32 flags);
+
+static bool macb_tx_can_bounce(struct macb_queue *queue, struct sk_buff *skb)
+{
+	return queue->tx_bounce && !skb_is_gso(skb) &&
+	       skb->len + ETH_FCS_LEN <= MACB_TX_BOUNCE_SIZE &&
+	       !(skb_shinfo(skb)->tx_flags & SKBTX_HW_TSTAMP);
+}
+
+/* Copy a small frame into the bounce slot of the entry at tx_head, called
+ * with tx_ptr_lock held. Clearing the checksum field, padding and adding
+ * the FCS happen on the copy, so the skb is never written to, moved or
+ * reallocated, and can be released as soon as it is queued.
+ */
+static void macb_tx_bounce(struct macb *bp, struct macb_queue *queue,
+			   struct sk_buff *skb)
+{
+	unsigned int entry = macb_tx_ring_wrap(bp, queue->tx_head);
+	struct macb_tx_skb *tx_skb = &queue->tx_skb[entry];
+	u8 *buf = queue->tx_bounce + entry * MACB_TX_BOUNCE_SIZE;
+	unsigned int len = skb->len;
+	u32 flags = 0;
+	u32 fcs;
+
+	skb_copy_bits(skb, 0, buf, len);
+
+	if (skb->ip_summed == CHECKSUM_PARTIAL) {
+		/* see macb_clear_csum() */
+		*(__sum16 *)(buf + skb_checksum_start_offset(skb) +
+			     skb->csum_offset) = 0;
+	} else if (bp->dev->features & NETIF_F_HW_CSUM) {
+		if (len < ETH_ZLEN) {
+			memset(buf + len, 0, ETH_ZLEN - len);
+			len = ETH_ZLEN;
+		}
+		fcs = ~crc32_le(~0, buf, len);
+		put_unaligned_le32(fcs, buf + len);
+		len += ETH_FCS_LEN;
+		flags = MACB_BIT(TX_NOCRC);
+	}
+
+	tx_skb->skb = NULL;
+	tx_skb->xdpf = NULL;
+	tx_skb->xsk = false;
+	tx_skb->mapping = 0;
+	tx_skb->size = skb->len;
+	tx_skb->mapped_as_page = false;
+	tx_skb->bounced = true;
+
+	macb_tx_post_single(queue, queue->tx_bounce_dma +
+			    entry * MACB_TX_BOUNCE_SIZE, len, flags);
+}
+
 static netdev_tx_t macb_start_xmit(struct sk_buff *skb, struct net_device *dev)
 {
 	u16 queue_index = skb_get_queue_mapping(skb);
 	struct macb *bp = netdev_priv(dev);
 	struct macb_queue *queue = &bp->queues[queue_index];
-	unsigned long flags;
 	unsigned int desc_cnt, nr_frags, frag_size, f;
-	unsigned int hdrlen;
-	bool is_lso;
+	unsigned int hdrlen = 0;
+	bool is_lso, bounce;
 	netdev_tx_t ret = NETDEV_TX_OK;
 
+	bounce = macb_tx_can_bounce(queue, skb);
+	if (bounce) {
+		desc_cnt = 1;
+		goto lock;
+	}
+
 	if (macb_clear_csum(skb)) {
 		dev_kfree_skb_any(skb);
 		return ret;
@@ -2175,20 +2961,23 @@ static netdev_tx_t macb_start_xmit(struct sk_buff *skb, struct net_device *dev)
 		desc_cnt += DIV_ROUND_UP(frag_size, bp->max_tx_length);
 	}
 
-	spin_lock_irqsave(&bp->lock, flags);
+lock:
+	spin_lock_bh(&queue->tx_ptr_lock);
 
 	/* This is a hard error, log it. */
 	if (CIRC_SPACE(queue->tx_head, queue->tx_tail,
 		       bp->tx_ring_size) < desc_cnt) {
 		netif_stop_subqueue(dev, queue_index);
-		spin_unlock_irqrestore(&bp->lock, flags);
+		spin_unlock_bh(&queue->tx_ptr_lock);
 		netdev_dbg(bp->dev, "tx_head = %u, tx_tail = %u\n",
 			   queue->tx_head, queue->tx_tail);
 		return NETDEV_TX_BUSY;
 	}
 
 	/* Map socket buffer for DMA transfer */
-	if (!macb_tx_map(bp, queue, skb, hdrlen)) {
+	if (bounce) {
+		macb_tx_bounce(bp, queue, skb);
+	} else if (!macb_tx_map(bp, queue, skb, hdrlen)) {
 		dev_kfree_skb_any(skb);
 		goto unlock;
 	}
@@ -2197,23 +2986,268 @@ static netdev_tx_t macb_start_xmit(struct sk_buff *skb, struct net_device *dev)
 	wmb();
 	skb_tx_timestamp(skb);
 
-	macb_writel(bp, NCR, macb_readl(bp, NCR) | MACB_BIT(TSTART));
-
 	if (CIRC_SPACE(queue->tx_head, queue->tx_tail, bp->tx_ring_size) < 1)
 		netif_stop_subqueue(dev, queue_index);
 
-unlock:
-	spin_unlock_irqrestore(&bp->lock, flags);
+	/* Ring the doorbell once per burst: the stack tells us when more
+	 * frames are about to follow, unless the queue has just filled up.
+	 */
+	if (!netdev_xmit_more() ||
+	    __netif_subqueue_stopped(dev, queue_index))
+		macb_tx_kick(bp);
+
+	/* The hardware reads the copy, the skb is done with */
+	if (bounce)
+		dev_consume_skb_any(skb);
+
+unlock:
+	spin_unlock_bh(&queue->tx_ptr_lock);
 
 	return ret;
 }
 
+/* Room for one more single-buffer frame, called with tx_ptr_lock held.
+ * A stopped subqueue also covers the TX error recovery.
+ */
+static bool macb_tx_single_avail(struct macb_queue *queue)
+{
+	struct macb *bp = queue->bp;
+
+	return !__netif_subqueue_stopped(bp->dev, queue - bp->queues) &&
+	       CIRC_SPACE(queue->tx_head, queue->tx_tail,
+			  bp->tx_ring_size) >= 1;
+}
+
+/* Hand a single-buffer frame to the hardware, the caller has already
+ * filled in the macb_tx_skb at tx_head.
+ */
+static void macb_tx_post_single(struct macb_queue *queue, dma_addr_t mapping,
+				u32 len, u32 flags)
+{
+	struct macb *bp = queue->bp;
+	struct macb_dma_desc *desc;
+	unsigned int entry;
+	u32 ctrl;
+
+	entry = macb_tx_ring_wrap(bp, queue->tx_head);
+
+	/* Set 'TX_USED' bit in the next descriptor to set the end of
+	 * TX queue before handing this one to the hardware
+	 */
+	desc = macb_tx_desc(queue, queue->tx_head + 1);
+	desc->ctrl = MACB_BIT(TX_USED);
+
+	ctrl = len | MACB_BIT(TX_LAST) | flags;
+	if (unlikely(entry == (bp->tx_ring_size - 1)))
+		ctrl |= MACB_BIT(TX_WRAP);
+
+	desc = macb_tx_desc(queue, entry);
+	macb_set_addr(bp, desc, mapping);
+	/* desc->addr must be visible to hardware before clearing
+	 * 'TX_USED' bit in desc->ctrl.
+	 */
+	wmb();
+	desc->ctrl = ctrl;
+
+	queue->tx_head++;
+}
+
+/* Queue a single-buffer XDP frame, called with tx_ptr_lock held. Frames
+ * bounced back by XDP_TX still sit in a page mapped by the RX page_pool,
+ * redirected ones have to be mapped here.
+ */
+static int macb_xdp_submit_frame(struct macb *bp, struct macb_queue *queue,
+				 struct xdp_frame *xdpf, bool dma_map)
+{
+	struct macb_tx_skb *tx_skb;
+	dma_addr_t mapping;
+
+	if (unlikely(xdpf->len > bp->max_tx_length))
+		return -EINVAL;
+
+	if (!macb_tx_single_avail(queue))
+		return -EBUSY;
+
+	tx_skb = macb_tx_skb(queue, queue->tx_head);
+
+	if (dma_map) {
+		mapping = dma_map_single(&bp->pdev->dev, xdpf->data,
+					 xdpf->len, DMA_TO_DEVICE);
+		if (dma_mapping_error(&bp->pdev->dev, mapping))
+			return -ENOMEM;
+		tx_skb->mapping = mapping;
+	} else {
+		struct page *page = virt_to_page(xdpf->data);
+
+		mapping = page_pool_get_dma_addr(page) +
+			  (xdpf->data - page_address(page));
+		dma_sync_single_for_device(&bp->pdev->dev, mapping,
+					   xdpf->len, DMA_BIDIRECTIONAL);
+		tx_skb->mapping = 0;
+	}
+
+	tx_skb->skb = NULL;
+	tx_skb->xdpf = xdpf;
+	tx_skb->size = xdpf->len;
+	tx_skb->mapped_as_page = false;
+	tx_skb->bounced = false;
+
+	macb_tx_post_single(queue, mapping, xdpf->len, 0);
+
+	return 0;
+}
+
+/* Move AF_XDP TX descriptors onto the hardware ring, called with
+ * tx_ptr_lock held. Returns true when the socket's TX ring has been drained.
+ */
+static bool macb_xsk_xmit(struct macb_queue *queue, unsigned int budget)
+{
+	struct xsk_buff_pool *pool = queue->xsk_pool;
+	struct macb *bp = queue->bp;
+	struct macb_tx_skb *tx_skb;
+	struct xdp_desc xdp_desc;
+	unsigned int sent = 0;
+	bool done = true;
+	dma_addr_t dma;
+
+	while (sent < budget) {
+		if (!macb_tx_single_avail(queue)) {
+			done = false;
+			break;
+		}
+
+		if (!xsk_tx_peek_desc(pool, &xdp_desc))
+			break;
+
+		dma = xsk_buff_raw_get_dma(pool, xdp_desc.addr);
+		xsk_buff_raw_dma_sync_for_device(pool, dma, xdp_desc.len);
+
+		tx_skb = macb_tx_skb(queue, queue->tx_head);
+		tx_skb->skb = NULL;
+		tx_skb->xdpf = NULL;
+		tx_skb->xsk = true;
+		tx_skb->mapping = 0;
+		tx_skb->size = xdp_desc.len;
+		tx_skb->mapped_as_page = false;
+		tx_skb->bounced = false;
+
+		macb_tx_post_single(queue, dma, xdp_desc.len, 0);
+		sent++;
+	}
+
+	if (sent == budget)
+		done = false;
+
+	if (sent) {
+		xsk_tx_release(pool);
+		/* Make newly initialized descriptors visible to hardware */
+		wmb();
+		macb_tx_kick(bp);
+	}
+
+	if (xsk_uses_need_wakeup(pool))
+		xsk_set_tx_need_wakeup(pool);
+
+	return done;
+}
+
+static int macb_xdp_xmit(struct net_device *dev, int num_frame,
+			 struct xdp_frame **frames, u32 flags)
+{
+	struct macb *bp = netdev_priv(dev);
+	struct macb_queue *queue;
+	int i, sent;
+
+	if (unlikely(flags & ~XDP_XMIT_FLAGS_MASK))
+		return -EINVAL;
+
+	if (unlikely(!netif_running(dev)))
+		return -ENETDOWN;
+
+	queue = &bp->queues[smp_processor_id() % bp->num_queues];
+
+	spin_lock(&queue->tx_ptr_lock);
+
+	for (sent = 0; sent < num_frame; sent++)
+		if (macb_xdp_submit_frame(bp, queue, frames[sent], true))
+			break;
+
+	if (sent && (flags & XDP_XMIT_FLUSH)) {
+		/* Make newly initialized descriptors visible to hardware */
+		wmb();
+		macb_tx_kick(bp);
+	}
+
+	spin_unlock(&queue->tx_ptr_lock);
+
+	/* Frames that did not fit are ours to free */
+	for (i = sent; i < num_frame; i++) {
+		xdp_return_frame_rx_napi(frames[i]);
+		dev->stats.tx_dropped++;
+	}
+
+	return sent;
+}
+
+/* Whole frame plus headroom and skb_shared_info, see build_skb() */
+static unsigned int gem_rx_truesize(unsigned int headroom, size_t size)
+{
+	return SKB_DATA_ALIGN(headroom + size) +
+	       SKB_DATA_ALIGN(sizeof(struct skb_shared_info));
+}
+
+static size_t gem_rx_buffer_size(unsigned int mtu)
+{
+	return roundup(mtu + ETH_HLEN + ETH_FCS_LEN + NET_IP_ALIGN,
+		       RX_BUFFER_MULTIPLE);
+}
+
+/* Frames too long to share a page are spread over full-page buffers,
+ * see gem_rx_copy_head()
+ */
+static size_t gem_rx_frag_size(void)
+{
+	return rounddown(min_t(size_t, PAGE_SIZE,
+			       GENMASK(GEM_RXBS_SIZE - 1, 0) *
+			       RX_BUFFER_MULTIPLE),
+			 RX_BUFFER_MULTIPLE);
+}
+
+/* Whether at least two buffers of @size fit in an order-0 page */
+static bool gem_rx_shares_page(size_t size)
+{
+	return gem_rx_truesize(NET_SKB_PAD,
+			       roundup(size, RX_BUFFER_MULTIPLE)) <=
+	       PAGE_SIZE / 2;
+}
+
+/* XDP buffers must not span more than one page */
+static bool gem_xdp_mtu_fits(unsigned int mtu)
+{
+	return gem_rx_truesize(XDP_PACKET_HEADROOM,
+			       gem_rx_buffer_size(mtu)) <= PAGE_SIZE;
+}
+
 static void macb_init_rx_buffer_size(struct macb *bp, size_t size)
 {
+	struct macb_queue *queue;
+	unsigned int q;
+
 	if (!macb_is_gem(bp)) {
 		bp->rx_buffer_size = MACB_RX_BUFFER_SIZE;
 	} else {
+		/* XDP and AF_XDP want the whole frame in a single buffer,
+		 * otherwise frames are assembled from order-0 pages
+		 */
+		bp->rx_frags = !bp->xdp_prog;
+		for (q = 0, queue = bp->queues; q < bp->num_queues; ++q, ++queue)
+			if (queue->xsk_pool)
+				bp->rx_frags = false;
+
 		bp->rx_buffer_size = size;
+		bp->rx_hdr_split = bp->rx_frags && !gem_rx_shares_page(size);
+		if (bp->rx_hdr_split)
+			bp->rx_buffer_size = gem_rx_frag_size();
 
 		if (bp->rx_buffer_size % RX_BUFFER_MULTIPLE) {
 			netdev_dbg(bp->dev,
@@ -2222,6 +3256,28 @@ static void macb_init_rx_buffer_size(struct macb *bp, size_t size)
 			bp->rx_buffer_size =
 				roundup(bp->rx_buffer_size, RX_BUFFER_MULTIPLE);
 		}
+
+		/* Each buffer lives in its own page_pool page(s), with
+		 * room in front for XDP and behind for build_skb()
+		 */
+		bp->rx_headroom = bp->xdp_prog ? XDP_PACKET_HEADROOM :
+						 NET_SKB_PAD;
+		bp->rx_page_order =
+			get_order(gem_rx_truesize(bp->rx_headroom,
+						  bp->rx_buffer_size));
+
+		/* Full-page buffers have their headers copied out instead */
+		if (bp->rx_hdr_split) {
+			bp->rx_headroom = 0;
+			bp->rx_page_order = 0;
+		}
+
+		/* Small buffers are carved out of shared page_pool pages */
+		bp->rx_frag_stride = 0;
+		if (bp->rx_frags && gem_rx_shares_page(bp->rx_buffer_size))
+			bp->rx_frag_stride =
+				gem_rx_truesize(bp->rx_headroom,
+						bp->rx_buffer_size);
 	}
 
 	netdev_dbg(bp->dev, "mtu [%u] rx_buffer_size [%zu]\n",
@@ -2230,34 +3286,48 @@ static void macb_init_rx_buffer_size(struct macb *bp, size_t size)
 
 static void gem_free_rx_buffers(struct macb *bp)
 {
-	struct sk_buff		*skb;
-	struct macb_dma_desc	*desc;
 	struct macb_queue *queue;
-	dma_addr_t		addr;
+	struct page *page;
 	unsigned int q;
 	int i;
 
 	for (q = 0, queue = bp->queues; q < bp->num_queues; ++q, ++queue) {
-		if (!queue->rx_skbuff)
-			continue;
+		if (queue->rx_skb) {
+			dev_kfree_skb_any(queue->rx_skb);
+			queue->rx_skb = NULL;
+		}
 
-		for (i = 0; i < bp->rx_ring_size; i++) {
-			skb = queue->rx_skbuff[i];
+		if (queue->rx_xsk) {
+			for (i = 0; i < bp->rx_ring_size; i++)
+				if (queue->rx_xsk[i])
+					xsk_buff_free(queue->rx_xsk[i]);
 
-			if (!skb)
-				continue;
+			kfree(queue->rx_xsk);
+			queue->rx_xsk = NULL;
+		}
 
-			desc = macb_rx_desc(queue, i);
-			addr = macb_get_addr(bp, desc);
+		if (queue->rx_page) {
+			for (i = 0; i < bp->rx_ring_size; i++) {
+				page = queue->rx_page[i];
 
-			dma_unmap_single(&bp->pdev->dev, addr, bp->rx_buffer_size,
-					DMA_FROM_DEVICE);
-			dev_kfree_skb_any(skb);
-			skb = NULL;
+				if (!page)
+					continue;
+
+				page_pool_put_full_page(queue->page_pool,
+							page, false);
+			}
+
+			kfree(queue->rx_page);
+			queue->rx_page = NULL;
 		}
 
-		kfree(queue->rx_skbuff);
-		queue->rx_skbuff = NULL;
+		if (xdp_rxq_info_is_reg(&queue->xdp_rxq))
+			xdp_rxq_info_unreg(&queue->xdp_rxq);
+
+		if (queue->page_pool) {
+			page_pool_destroy(queue->page_pool);
+			queue->page_pool = NULL;
+		}
 	}
 }
 
@@ -2284,6 +3354,12 @@ static void macb_free_consistent(struct macb *bp)
 	for (q = 0, queue = bp->queues; q < bp->num_queues; ++q, ++queue) {
 		kfree(queue->tx_skb);
 		queue->tx_skb = NULL;
+		if (queue->tx_bounce) {
+			dma_free_coherent(&bp->pdev->dev,
+					  bp->tx_ring_size * MACB_TX_BOUNCE_SIZE,
+					  queue->tx_bounce, queue->tx_bounce_dma);
+			queue->tx_bounce = NULL;
+		}
 		if (queue->tx_ring) {
 			size = TX_RING_BYTES(bp) + bp->tx_bd_rd_prefetch;
 			dma_free_coherent(&bp->pdev->dev, size,
@@ -2299,21 +3375,101 @@ static void macb_free_consistent(struct macb *bp)
 	}
 }
 
+static int gem_create_page_pool(struct macb *bp, struct macb_queue *queue,
+				unsigned int q)
+{
+	struct page_pool_params pp_params = {
+		.order = bp->rx_page_order,
+		.flags = PP_FLAG_DMA_MAP | PP_FLAG_DMA_SYNC_DEV,
+		.pool_size = bp->rx_ring_size,
+		.nid = NUMA_NO_NODE,
+		.dev = &bp->pdev->dev,
+		.dma_dir = bp->xdp_prog ? DMA_BIDIRECTIONAL : DMA_FROM_DEVICE,
+		.offset = bp->rx_headroom,
+		.max_len = bp->rx_buffer_size,
+	};
+	int err;
+
+	/* A recycled shared page may have been written anywhere */
+	if (bp->rx_frag_stride) {
+		pp_params.flags |= PP_FLAG_PAGE_FRAG;
+		pp_params.offset = 0;
+		pp_params.max_len = PAGE_SIZE;
+	}
+
+	queue->page_pool = page_pool_create(&pp_params);
+	if (IS_ERR(queue->page_pool)) {
+		err = PTR_ERR(queue->page_pool);
+		queue->page_pool = NULL;
+		return err;
+	}
+
+	err = xdp_rxq_info_reg(&queue->xdp_rxq, bp->dev, q, 0);
+	if (err)
+		return err;
+
+	return xdp_rxq_info_reg_mem_model(&queue->xdp_rxq, MEM_TYPE_PAGE_POOL,
+					  queue->page_pool);
+}
+
+/* A queue bound to an AF_XDP socket receives straight into its UMEM */
+static int gem_init_xsk_rxq(struct macb *bp, struct macb_queue *queue,
+			    unsigned int q)
+{
+	struct xsk_buff_pool *pool = queue->xsk_pool;
+	int err;
+
+	if (xsk_pool_get_rx_frame_size(pool) < bp->rx_buffer_size) {
+		netdev_err(bp->dev, "AF_XDP frames too small for queue %u\n",
+			   q);
+		return -EINVAL;
+	}
+
+	queue->rx_xsk = kcalloc(bp->rx_ring_size, sizeof(*queue->rx_xsk),
+				GFP_KERNEL);
+	if (!queue->rx_xsk)
+		return -ENOMEM;
+
+	err = xdp_rxq_info_reg(&queue->xdp_rxq, bp->dev, q, 0);
+	if (err)
+		return err;
+
+	err = xdp_rxq_info_reg_mem_model(&queue->xdp_rxq,
+					 MEM_TYPE_XSK_BUFF_POOL, NULL);
+	if (err)
+		return err;
+
+	xsk_pool_set_rxq_info(pool, &queue->xdp_rxq);
+
+	return 0;
+}
+
 static int gem_alloc_rx_buffers(struct macb *bp)
 {
 	struct macb_queue *queue;
 	unsigned int q;
-	int size;
+	int err;
 
 	for (q = 0, queue = bp->queues; q < bp->num_queues; ++q, ++queue) {
-		size = bp->rx_ring_size * sizeof(struct sk_buff *);
-		queue->rx_skbuff = kzalloc(size, GFP_KERNEL);
-		if (!queue->rx_skbuff)
+		if (queue->xsk_pool) {
+			err = gem_init_xsk_rxq(bp, queue, q);
+			if (err)
+				return err;
+			continue;
+		}
+
+		queue->rx_page = kcalloc(bp->rx_ring_size,
+					 sizeof(*queue->rx_page), GFP_KERNEL);
+		if (!queue->rx_page)
 			return -ENOMEM;
 		else
 			netdev_dbg(bp->dev,
-				   "Allocated %d RX struct sk_buff entries at %p\n",
-				   bp->rx_ring_size, queue->rx_skbuff);
+				   "Allocated %d RX page entries at %p\n",
+				   bp->rx_ring_size, queue->rx_page);
+
+		err = gem_create_page_pool(bp, queue, q);
+		if (err)
+			return err;
 	}
 	return 0;
 }
@@ -2354,10 +3510,16 @@ static int macb_alloc_consistent(struct macb *bp)
 			   queue->tx_ring);
 
 		size = bp->tx_ring_size * sizeof(struct macb_tx_skb);
-		queue->tx_skb = kmalloc(size, GFP_KERNEL);
+		queue->tx_skb = kzalloc(size, GFP_KERNEL);
 		if (!queue->tx_skb)
 			goto out_err;
 
+		/* Without it, small frames just take the mapped path */
+		size = bp->tx_ring_size * MACB_TX_BOUNCE_SIZE;
+		queue->tx_bounce = dma_alloc_coherent(&bp->pdev->dev, size,
+						      &queue->tx_bounce_dma,
+						      GFP_KERNEL);
+
 		size = RX_RING_BYTES(bp) + bp->rx_bd_rd_prefetch;
 		queue->rx_ring = dma_alloc_coherent(&bp->pdev->dev, size,
 						 &queue->rx_ring_dma, GFP_KERNEL);
@@ -2563,6 +3725,44 @@ static void macb_configure_dma(struct macb *bp)
 	}
 }
 
+static u32 gem_usecs_to_intmod(u32 usecs)
+{
+	return min_t(u32, DIV_ROUND_UP(usecs * NSEC_PER_USEC, GEM_INTMOD_NS),
+		     GENMASK(GEM_RX_INTMOD_SIZE - 1, 0));
+}
+
+/* RX moderation currently in effect: DIM's profile when it is enabled */
+static u32 gem_rx_coalesce_usecs(struct macb *bp)
+{
+	struct dim_cq_moder moder;
+
+	if (!bp->rx_dim_enabled)
+		return bp->rx_coalesce_usecs;
+
+	moder = net_dim_get_rx_moderation(bp->rx_dim.mode,
+					  bp->rx_dim.profile_ix);
+	return moder.usec;
+}
+
+static void gem_set_intmod(struct macb *bp, u32 rx_usecs)
+{
+	gem_writel(bp, INTMOD,
+		   GEM_BF(RX_INTMOD, gem_usecs_to_intmod(rx_usecs)) |
+		   GEM_BF(TX_INTMOD,
+			  gem_usecs_to_intmod(bp->tx_coalesce_usecs)));
+}
+
+static void gem_rx_dim_work(struct work_struct *work)
+{
+	struct dim *dim = container_of(work, struct dim, work);
+	struct macb *bp = container_of(dim, struct macb, rx_dim);
+	struct dim_cq_moder moder =
+			net_dim_get_rx_moderation(dim->mode, dim->profile_ix);
+
+	gem_set_intmod(bp, moder.usec);
+	dim->state = DIM_START_MEASURE;
+}
+
 static void macb_init_hw(struct macb *bp)
 {
 	u32 config;
@@ -2592,6 +3792,9 @@ static void macb_init_hw(struct macb *bp)
 		bp->rx_frm_len_mask = MACB_RX_JFRMLEN_MASK;
 
 	macb_configure_dma(bp);
+
+	if (macb_is_gem(bp))
+		gem_set_intmod(bp, gem_rx_coalesce_usecs(bp));
 }
 
 /* The hash address register is 64 bits long and takes up two
@@ -2670,6 +3873,47 @@ static void macb_sethashtable(struct net_device *dev)
 	macb_or_gem_writel(bp, HRT, mc_filter[1]);
 }
 
+/* Program specific address register set @idx (1-3), or clear it */
+static void macb_set_specific_addr(struct macb *bp, int idx, const u8 *addr)
+{
+	u32 bottom = 0;
+	u16 top = 0;
+
+	if (addr) {
+		bottom = cpu_to_le32(*((u32 *)addr));
+		top = cpu_to_le16(*((u16 *)(addr + 4)));
+	}
+
+	/* the set is matched again once the top half is written */
+	macb_or_gem_writel(bp, SA1B + idx * 8, bottom);
+	macb_or_gem_writel(bp, SA1T + idx * 8, top);
+}
+
+/*
+ * Put the multicast list in the spare specific address registers when it
+ * fits. Those match exactly, where the hash also takes in every other
+ * group sharing a bucket. Returns false, with the registers cleared, when
+ * the list is too long.
+ */
+static bool macb_set_specific_mc(struct net_device *dev)
+{
+	struct macb *bp = netdev_priv(dev);
+	struct netdev_hw_addr *ha;
+	bool fits;
+	int i = 1;
+
+	fits = !(dev->flags & IFF_ALLMULTI) && !netdev_mc_empty(dev) &&
+	       netdev_mc_count(dev) < MACB_NUM_SPECIFIC_ADDR;
+	if (fits) {
+		netdev_for_each_mc_addr(ha, dev)
+			macb_set_specific_addr(bp, i++, ha->addr);
+	}
+	for (; i < MACB_NUM_SPECIFIC_ADDR; i++)
+		macb_set_specific_addr(bp, i, NULL);
+
+	return fits;
+}
+
 /* Enable/Disable promiscuous and multicast modes. */
 static void macb_set_rx_mode(struct net_device *dev)
 {
@@ -2699,6 +3943,11 @@ static void macb_set_rx_mode(struct net_device *dev)
 		macb_or_gem_writel(bp, HRB, -1);
 		macb_or_gem_writel(bp, HRT, -1);
 		cfg |= MACB_BIT(NCFGR_MTI);
+	} else if (macb_set_specific_mc(dev)) {
+		/* Exact match on the specific address registers */
+		macb_or_gem_writel(bp, HRB, 0);
+		macb_or_gem_writel(bp, HRT, 0);
+		cfg &= ~MACB_BIT(NCFGR_MTI);
 	} else if (!netdev_mc_empty(dev)) {
 		/* Enable specific multicasts */
 		macb_sethashtable(dev);
@@ -2766,15 +4015,22 @@ static int macb_open(struct net_device *dev)
 static int macb_close(struct net_device *dev)
 {
 	struct macb *bp = netdev_priv(dev);
+	struct macb_tx_skb *tx_skb;
 	struct macb_queue *queue;
+	unsigned int q, tail, xsk_frames;
 	unsigned long flags;
-	unsigned int q;
 
 	netif_tx_stop_all_queues(dev);
 
+	/* The TX error task restarts the queue behind the stack's back */
+	for (q = 0, queue = bp->queues; q < bp->num_queues; ++q, ++queue)
+		cancel_work_sync(&queue->tx_error_task);
+
 	for (q = 0, queue = bp->queues; q < bp->num_queues; ++q, ++queue)
 		napi_disable(&queue->napi);
 
+	cancel_work_sync(&bp->rx_dim.work);
+
 	phylink_stop(bp->phylink);
 	phylink_disconnect_phy(bp->phylink);
 
@@ -2783,6 +4039,24 @@ static int macb_close(struct net_device *dev)
 	netif_carrier_off(dev);
 	spin_unlock_irqrestore(&bp->lock, flags);
 
+	/* Release frames still queued for TX, in particular XDP ones which
+	 * would otherwise keep their page_pool alive forever
+	 */
+	for (q = 0, queue = bp->queues; q < bp->num_queues; ++q, ++queue) {
+		xsk_frames = 0;
+		for (tail = queue->tx_tail; tail != queue->tx_head; tail++) {
+			tx_skb = macb_tx_skb(queue, tail);
+			if (tx_skb->xsk) {
+				tx_skb->xsk = false;
+				xsk_frames++;
+			}
+			macb_tx_unmap(bp, tx_skb);
+			macb_tx_return_xdp(tx_skb);
+		}
+		if (xsk_frames)
+			xsk_tx_completed(queue->xsk_pool, xsk_frames);
+	}
+
 	macb_free_consistent(bp);
 
 	if (bp->ptp_info)
@@ -2795,14 +4069,145 @@ static int macb_close(struct net_device *dev)
 
 static int macb_change_mtu(struct net_device *dev, int new_mtu)
 {
-	if (netif_running(dev))
+	struct macb *bp = netdev_priv(dev);
+
+	/* RX buffers assembled into frames do not depend on the MTU */
+	if (netif_running(dev) && !bp->rx_frags)
 		return -EBUSY;
 
+	if (bp->xdp_prog && !gem_xdp_mtu_fits(new_mtu)) {
+		netdev_err(dev, "MTU %d too large for XDP\n", new_mtu);
+		return -EINVAL;
+	}
+
 	dev->mtu = new_mtu;
 
 	return 0;
 }
 
+static int macb_xdp_setup(struct net_device *dev, struct bpf_prog *prog,
+			  struct netlink_ext_ack *extack)
+{
+	struct macb *bp = netdev_priv(dev);
+	bool running = netif_running(dev);
+	struct bpf_prog *old_prog;
+	bool need_reset;
+
+	if (prog && !macb_is_gem(bp)) {
+		NL_SET_ERR_MSG_MOD(extack, "XDP is only supported on GEM");
+		return -EOPNOTSUPP;
+	}
+
+	if (prog && !gem_xdp_mtu_fits(dev->mtu)) {
+		NL_SET_ERR_MSG_MOD(extack, "MTU too large for XDP");
+		return -EOPNOTSUPP;
+	}
+
+	/* Attaching or detaching changes the RX buffer layout and the DMA
+	 * direction of the page_pool, swapping programs does not
+	 */
+	need_reset = !!bp->xdp_prog != !!prog;
+	if (running && need_reset)
+		macb_close(dev);
+
+	old_prog = xchg(&bp->xdp_prog, prog);
+	if (old_prog)
+		bpf_prog_put(old_prog);
+
+	if (running && need_reset)
+		return macb_open(dev);
+
+	return 0;
+}
+
+static int macb_xsk_pool_setup(struct net_device *dev,
+			       struct xsk_buff_pool *pool, u16 qid)
+{
+	struct macb *bp = netdev_priv(dev);
+	bool running = netif_running(dev);
+	struct xsk_buff_pool *old_pool;
+	struct macb_queue *queue;
+	int err;
+
+	if (!macb_is_gem(bp))
+		return -EOPNOTSUPP;
+
+	if (qid >= bp->num_queues)
+		return -EINVAL;
+
+	queue = &bp->queues[qid];
+	old_pool = queue->xsk_pool;
+
+	if (pool) {
+		if (old_pool)
+			return -EBUSY;
+
+		/* One frame per descriptor, at an address the DMA can use */
+		if (pool->unaligned ||
+		    !IS_ALIGNED(xsk_pool_get_headroom(pool), 8) ||
+		    xsk_pool_get_rx_frame_size(pool) <
+		    gem_rx_buffer_size(dev->mtu))
+			return -EINVAL;
+
+		err = xsk_pool_dma_map(pool, &bp->pdev->dev, 0);
+		if (err)
+			return err;
+	} else if (!old_pool) {
+		return -EINVAL;
+	}
+
+	/* The RX ring of the queue is rebuilt from the new buffer source */
+	if (running)
+		macb_close(dev);
+
+	queue->xsk_pool = pool;
+	if (old_pool)
+		xsk_pool_dma_unmap(old_pool, 0);
+
+	if (running)
+		return macb_open(dev);
+
+	return 0;
+}
+
+static int macb_xdp(struct net_device *dev, struct netdev_bpf *xdp)
+{
+	switch (xdp->command) {
+	case XDP_SETUP_PROG:
+		return macb_xdp_setup(dev, xdp->prog, xdp->extack);
+	case XDP_SETUP_XSK_POOL:
+		return macb_xsk_pool_setup(dev, xdp->xsk.pool,
+					   xdp->xsk.queue_id);
+	default:
+		return -EINVAL;
+	}
+}
+
+static int macb_xsk_wakeup(struct net_device *dev, u32 qid, u32 flags)
+{
+	struct macb *bp = netdev_priv(dev);
+	struct macb_queue *queue;
+
+	if (!netif_running(dev))
+		return -ENETDOWN;
+
+	if (qid >= bp->num_queues)
+		return -EINVAL;
+
+	queue = &bp->queues[qid];
+	if (!queue->xsk_pool)
+		return -ENXIO;
+
+	/* RX and TX of the socket are both serviced by the queue NAPI */
+	if (!napi_if_scheduled_mark_missed(&queue->napi)) {
+		local_bh_disable();
+		napi_schedule(&queue->napi);
+		local_bh_enable();
+	}
+
+	return 0;
+}
+
 static void gem_update_stats(struct macb *bp)
 {
 	struct macb_queue *queue;
@@ -2873,15 +4278,203 @@ static struct net_device_stats *gem_get_stats(struct macb *bp)
 	return nstat;
 }
 
+#ifdef CONFIG_PAGE_POOL_STATS
+static void gem_get_page_pool_stats(struct macb *bp, u64 *data)
+{
+	struct page_pool_stats stats = {};
+	struct macb_queue *queue;
+	unsigned int q;
+
+	for (q = 0, queue = bp->queues; q < bp->num_queues; ++q, ++queue) {
+		if (queue->page_pool)
+			page_pool_get_stats(queue->page_pool, &stats);
+	}
+
+	page_pool_ethtool_stats_get(data, &stats);
+}
+#else
+static void gem_get_page_pool_stats(struct macb *bp, u64 *data)
+{
+}
+#endif
+
 static void gem_get_ethtool_stats(struct net_device *dev,
 				  struct ethtool_stats *stats, u64 *data)
 {
+	unsigned int len;
 	struct macb *bp;
 
 	bp = netdev_priv(dev);
 	gem_update_stats(bp);
-	memcpy(data, &bp->ethtool_stats, sizeof(u64)
-			* (GEM_STATS_LEN + QUEUE_STATS_LEN * MACB_MAX_QUEUES));
+	len = GEM_STATS_LEN + QUEUE_STATS_LEN * bp->num_queues;
+	memcpy(data, &bp->ethtool_stats, sizeof(u64) * len);
+	gem_get_page_pool_stats(bp, data + len);
+}
+
+/*
+ * ethtool -t: frames are looped back inside the MAC and timed from being
+ * queued to being received, so the round trip covers both DMA rings, the
+ * interrupt and the NAPI poll.
+ */
+#define MACB_TEST_FRAMES	16
+#define MACB_TEST_MAGIC		0x4d414342	/* "MACB" */
+#define MACB_TEST_TIMEOUT	msecs_to_jiffies(100)
+
+enum {
+	MACB_TEST_LOOPBACK,
+	MACB_TEST_RTT_AVG,
+	MACB_TEST_RTT_MAX,
+	MACB_TEST_LEN,
+};
+
+static const char macb_test_strings[][ETH_GSTRING_LEN] = {
+	[MACB_TEST_LOOPBACK]	= "MAC loopback       (offline)",
+	[MACB_TEST_RTT_AVG]	= "Loopback avg ns    (offline)",
+	[MACB_TEST_RTT_MAX]	= "Loopback max ns    (offline)",
+};
+
+struct macb_test_hdr {
+	__be32 magic;
+	__be32 seq;
+};
+
+struct macb_test_priv {
+	struct packet_type pt;
+	struct completion done;
+	u32 seq;
+	ktime_t rx_time;
+};
+
+static int macb_test_rcv(struct sk_buff *skb, struct net_device *dev,
+			 struct packet_type *pt, struct net_device *orig_dev)
+{
+	struct macb_test_priv *tpriv = pt->af_packet_priv;
+	struct macb_test_hdr *hdr;
+
+	if (!pskb_may_pull(skb, sizeof(*hdr)))
+		goto out;
+
+	hdr = (struct macb_test_hdr *)skb->data;
+	if (hdr->magic != htonl(MACB_TEST_MAGIC) ||
+	    ntohl(hdr->seq) != READ_ONCE(tpriv->seq))
+		goto out;
+
+	tpriv->rx_time = ktime_get();
+	complete(&tpriv->done);
+out:
+	kfree_skb(skb);
+	return 0;
+}
+
+static struct sk_buff *macb_test_skb(struct net_device *dev, u32 seq)
+{
+	struct macb_test_hdr *hdr;
+	struct sk_buff *skb;
+	struct ethhdr *eth;
+
+	skb = netdev_alloc_skb(dev, ETH_ZLEN);
+	if (!skb)
+		return NULL;
+
+	eth = skb_put(skb, ETH_HLEN);
+	ether_addr_copy(eth->h_dest, dev->dev_addr);
+	ether_addr_copy(eth->h_source, dev->dev_addr);
+	eth->h_proto = htons(ETH_P_LOOPBACK);
+
+	hdr = skb_put_zero(skb, ETH_ZLEN - ETH_HLEN);
+	hdr->magic = htonl(MACB_TEST_MAGIC);
+	hdr->seq = htonl(seq);
+
+	skb->protocol = htons(ETH_P_LOOPBACK);
+	skb->dev = dev;
+
+	return skb;
+}
+
+static int macb_test_loopback(struct macb *bp, u64 *buf)
+{
+	struct net_device *dev = bp->dev;
+	struct macb_test_priv *tpriv;
+	u64 rtt, total = 0, rtt_max = 0;
+	struct sk_buff *skb;
+	ktime_t start;
+	int i, ret = 0;
+	u32 ctrl;
+
+	tpriv = kzalloc(sizeof(*tpriv), GFP_KERNEL);
+	if (!tpriv)
+		return -ENOMEM;
+
+	init_completion(&tpriv->done);
+	tpriv->pt.type = htons(ETH_P_LOOPBACK);
+	tpriv->pt.func = macb_test_rcv;
+	tpriv->pt.dev = dev;
+	tpriv->pt.af_packet_priv = tpriv;
+	dev_add_pack(&tpriv->pt);
+
+	ctrl = macb_readl(bp, NCR);
+	macb_writel(bp, NCR, ctrl | MACB_BIT(LLB));
+
+	for (i = 0; i < MACB_TEST_FRAMES; i++) {
+		WRITE_ONCE(tpriv->seq, i);
+		reinit_completion(&tpriv->done);
+
+		skb = macb_test_skb(dev, i);
+		if (!skb) {
+			ret = -ENOMEM;
+			break;
+		}
+
+		start = ktime_get();
+		if (dev_queue_xmit(skb) != NET_XMIT_SUCCESS) {
+			ret = -EIO;
+			break;
+		}
+		if (!wait_for_completion_timeout(&tpriv->done,
+						 MACB_TEST_TIMEOUT)) {
+			ret = -ETIMEDOUT;
+			break;
+		}
+
+		rtt = ktime_to_ns(ktime_sub(tpriv->rx_time, start));
+		total += rtt;
+		rtt_max = max(rtt_max, rtt);
+	}
+
+	macb_writel(bp, NCR, ctrl);
+	dev_remove_pack(&tpriv->pt);
+	kfree(tpriv);
+
+	if (!ret) {
+		buf[MACB_TEST_RTT_AVG] = div_u64(total, MACB_TEST_FRAMES);
+		buf[MACB_TEST_RTT_MAX] = rtt_max;
+	}
+
+	return ret;
+}
+
+static void gem_self_test(struct net_device *dev, struct ethtool_test *etest,
+			  u64 *buf)
+{
+	struct macb *bp = netdev_priv(dev);
+	int ret;
+
+	memset(buf, 0, sizeof(u64) * MACB_TEST_LEN);
+
+	/* Looping back takes the port off the wire */
+	if (!(etest->flags & ETH_TEST_FL_OFFLINE))
+		return;
+
+	if (!netif_running(dev) || !netif_carrier_ok(dev))
+		ret = -ENETDOWN;
+	else
+		ret = macb_test_loopback(bp, buf);
+
+	if (ret) {
+		netdev_err(dev, "loopback self-test failed: %d\n", ret);
+		buf[MACB_TEST_LOOPBACK] = 1;
+		etest->flags |= ETH_TEST_FL_FAILED;
+	}
 }
 
 static int gem_get_sset_count(struct net_device *dev, int sset)
@@ -2890,7 +4483,10 @@ static int gem_get_sset_count(struct net_device *dev, int sset)
 
 	switch (sset) {
 	case ETH_SS_STATS:
-		return GEM_STATS_LEN + bp->num_queues * QUEUE_STATS_LEN;
+		return GEM_STATS_LEN + bp->num_queues * QUEUE_STATS_LEN +
+		       page_pool_ethtool_stats_get_count();
+	case ETH_SS_TEST:
+		return MACB_TEST_LEN;
 	default:
 		return -EOPNOTSUPP;
 	}
@@ -2917,6 +4513,10 @@ static void gem_get_ethtool_strings(struct net_device *dev, u32 sset, u8 *p)
 				memcpy(p, stat_string, ETH_GSTRING_LEN);
 			}
 		}
+		page_pool_ethtool_stats_get_strings(p);
+		break;
+	case ETH_SS_TEST:
+		memcpy(p, macb_test_strings, sizeof(macb_test_strings));
 		break;
 	}
 }
@@ -3074,6 +4674,45 @@ static void macb_get_ringparam(struct net_device *netdev,
 	ring->tx_pending = bp->tx_ring_size;
 }
 
+static int gem_get_coalesce(struct net_device *netdev,
+			    struct ethtool_coalesce *ec)
+{
+	struct macb *bp = netdev_priv(netdev);
+
+	ec->rx_coalesce_usecs = bp->rx_coalesce_usecs;
+	ec->tx_coalesce_usecs = bp->tx_coalesce_usecs;
+	ec->use_adaptive_rx_coalesce = bp->rx_dim_enabled;
+
+	return 0;
+}
+
+static int gem_set_coalesce(struct net_device *netdev,
+			    struct ethtool_coalesce *ec)
+{
+	struct macb *bp = netdev_priv(netdev);
+
+	if (ec->rx_coalesce_usecs > GEM_INTMOD_MAX_USECS ||
+	    ec->tx_coalesce_usecs > GEM_INTMOD_MAX_USECS)
+		return -EINVAL;
+
+	bp->rx_coalesce_usecs = ec->rx_coalesce_usecs;
+	bp->tx_coalesce_usecs = ec->tx_coalesce_usecs;
+
+	if (ec->use_adaptive_rx_coalesce != bp->rx_dim_enabled) {
+		bp->rx_dim_enabled = ec->use_adaptive_rx_coalesce;
+		if (!bp->rx_dim_enabled)
+			cancel_work_sync(&bp->rx_dim.work);
+	}
+
+	/* Registers are only accessible while the interface is up,
+	 * macb_init_hw() applies the settings otherwise.
+	 */
+	if (netif_running(netdev))
+		gem_set_intmod(bp, gem_rx_coalesce_usecs(bp));
+
+	return 0;
+}
+
 static int macb_set_ringparam(struct net_device *netdev,
 			      struct ethtool_ringparam *ring)
 {
@@ -3305,7 +4944,7 @@ static void gem_prog_cmp_regs(struct macb *bp, struct ethtool_rx_flow_spec *fs)
 	}
 
 	t2_scr = 0;
-	t2_scr = GEM_BFINS(QUEUE, (fs->ring_cookie) & 0xFF, t2_scr);
+	t2_scr = GEM_BFINS(QUEUE, macb_hw_queue(bp, fs->ring_cookie), t2_scr);
 	t2_scr = GEM_BFINS(ETHT2IDX, SCRT2_ETHT, t2_scr);
 	if (cmp_a)
 		t2_scr = GEM_BFINS(CMPA, GEM_IP4SRC_CMP(index), t2_scr);
@@ -3316,6 +4955,206 @@ static void gem_prog_cmp_regs(struct macb *bp, struct ethtool_rx_flow_spec *fs)
 	gem_writel_n(bp, SCRT2, index, t2_scr);
 }
 
+/* GEM has no receive hash, so flows are spread by the low bits of their
+ * source port, which a single masked compare can select on. Each table
+ * entry gets a screener steering the port values it stands for to its
+ * queue. Entries for queue 0 need none, it gets whatever matches nothing.
+ * The screeners sit after the ntuple ones, so explicit rules win.
+ */
+static void gem_prog_rss(struct macb *bp)
+{
+	unsigned int i, index;
+	u32 w0, w1, t2_scr;
+
+	for (i = 0; i < bp->rss_size; i++) {
+		index = bp->rss_base + i;
+
+		if (!bp->rss_indir[i]) {
+			gem_writel_n(bp, SCRT2, index, 0);
+			continue;
+		}
+
+		w0 = 0;
+		w1 = 0;
+		w0 = GEM_BFINS(T2MASK, htons(bp->rss_size - 1), w0);
+		w0 = GEM_BFINS(T2CMP, htons(i), w0);
+		w1 = GEM_BFINS(T2DISMSK, 0, w1); /* 16-bit compare */
+		w1 = GEM_BFINS(T2CMPOFST, GEM_T2COMPOFST_IPHDR, w1);
+		w1 = GEM_BFINS(T2OFST, IPHDR_SRCPORT_OFFSET, w1);
+		gem_writel_n(bp, T2CMPW0, T2CMP_OFST(GEM_PORT_CMP(index)), w0);
+		gem_writel_n(bp, T2CMPW1, T2CMP_OFST(GEM_PORT_CMP(index)), w1);
+
+		t2_scr = 0;
+		t2_scr = GEM_BFINS(QUEUE, macb_hw_queue(bp, bp->rss_indir[i]),
+				   t2_scr);
+		t2_scr = GEM_BFINS(ETHT2IDX, SCRT2_ETHT, t2_scr);
+		t2_scr = GEM_BFINS(ETHTEN, 1, t2_scr);
+		t2_scr = GEM_BFINS(CMPA, GEM_PORT_CMP(index), t2_scr);
+		t2_scr = GEM_BFINS(CMPAEN, 1, t2_scr);
+		gem_writel_n(bp, SCRT2, index, t2_scr);
+	}
+}
+
+static u32 gem_get_rxfh_indir_size(struct net_device *netdev)
+{
+	struct macb *bp = netdev_priv(netdev);
+
+	return bp->rss_size;
+}
+
+static int gem_get_rxfh(struct net_device *netdev, u32 *indir, u8 *key,
+			u8 *hfunc)
+{
+	struct macb *bp = netdev_priv(netdev);
+	unsigned int i;
+
+	if (indir)
+		for (i = 0; i < bp->rss_size; i++)
+			indir[i] = bp->rss_indir[i];
+
+	return 0;
+}
+
+static int gem_set_rxfh(struct net_device *netdev, const u32 *indir,
+			const u8 *key, const u8 hfunc)
+{
+	struct macb *bp = netdev_priv(netdev);
+	unsigned long flags;
+	unsigned int i;
+
+	if (!bp->rss_size)
+		return -EOPNOTSUPP;
+
+	/* the "hash" is fixed by what the screeners can compare */
+	if (key || (hfunc != ETH_RSS_HASH_NO_CHANGE))
+		return -EOPNOTSUPP;
+
+	if (!indir)
+		return 0;
+
+	for (i = 0; i < bp->rss_size; i++)
+		if (indir[i] >= bp->num_queues)
+			return -EINVAL;
+
+	spin_lock_irqsave(&bp->rx_fs_lock, flags);
+	for (i = 0; i < bp->rss_size; i++)
+		bp->rss_indir[i] = indir[i];
+	gem_prog_rss(bp);
+	spin_unlock_irqrestore(&bp->rx_fs_lock, flags);
+
+	return 0;
+}
+
+#ifdef CONFIG_RFS_ACCEL
+/* Program or clear the screener of aRFS slot @slot. Caller holds rx_fs_lock */
+static void gem_arfs_prog(struct macb *bp, unsigned int slot)
+{
+	struct macb_arfs_filter *f = &bp->arfs[slot];
+	unsigned int index = bp->arfs_base + slot;
+	struct ethtool_rx_flow_spec fs = {};
+	u32 t2_scr;
+
+	if (!f->used) {
+		gem_writel_n(bp, SCRT2, index, 0);
+		return;
+	}
+
+	fs.location = index;
+	fs.ring_cookie = f->rxq;
+	fs.h_u.tcp_ip4_spec.ip4src = f->saddr;
+	fs.h_u.tcp_ip4_spec.ip4dst = f->daddr;
+	fs.h_u.tcp_ip4_spec.psrc = f->sport;
+	fs.h_u.tcp_ip4_spec.pdst = f->dport;
+	memset(&fs.m_u.tcp_ip4_spec, 0xff, sizeof(fs.m_u.tcp_ip4_spec));
+	gem_prog_cmp_regs(bp, &fs);
+
+	t2_scr = gem_readl_n(bp, SCRT2, index);
+	t2_scr = GEM_BFINS(ETHTEN, 1, t2_scr);
+	t2_scr = GEM_BFINS(CMPAEN, 1, t2_scr);
+	t2_scr = GEM_BFINS(CMPBEN, 1, t2_scr);
+	t2_scr = GEM_BFINS(CMPCEN, 1, t2_scr);
+	gem_writel_n(bp, SCRT2, index, t2_scr);
+}
+
+/* Reprogram the steered flows after a reset, or drop them all */
+static void gem_arfs_sync(struct macb *bp, bool enable)
+{
+	unsigned long flags;
+	unsigned int i;
+
+	spin_lock_irqsave(&bp->rx_fs_lock, flags);
+	for (i = 0; i < bp->arfs_size; i++) {
+		if (!enable)
+			bp->arfs[i].used = false;
+		gem_arfs_prog(bp, i);
+	}
+	spin_unlock_irqrestore(&bp->rx_fs_lock, flags);
+}
+
+/*
+ * Steer a flow to the queue whose interrupt is affine to the CPU its
+ * socket is read on. The screener follows the flow when the reader moves,
+ * and is given to another flow once RPS lets it expire.
+ */
+static int macb_rx_flow_steer(struct net_device *dev, const struct sk_buff *skb,
+			      u16 rxq_index, u32 flow_id)
+{
+	struct macb *bp = netdev_priv(dev);
+	struct macb_arfs_filter *f;
+	struct flow_keys fk;
+	unsigned long flags;
+	int slot = -1;
+	unsigned int i;
+
+	if (!skb_flow_dissect_flow_keys(skb, &fk, 0))
+		return -EPROTONOSUPPORT;
+
+	if (fk.basic.n_proto != htons(ETH_P_IP) ||
+	    (fk.basic.ip_proto != IPPROTO_TCP &&
+	     fk.basic.ip_proto != IPPROTO_UDP) ||
+	    (fk.control.flags & FLOW_DIS_IS_FRAGMENT))
+		return -EPROTONOSUPPORT;
+
+	spin_lock_irqsave(&bp->rx_fs_lock, flags);
+
+	for (i = 0; i < bp->arfs_size; i++) {
+		f = &bp->arfs[i];
+		if (f->used && f->flow_id == flow_id) {
+			slot = i;
+			break;
+		}
+	}
+	for (i = 0; slot < 0 && i < bp->arfs_size; i++) {
+		f = &bp->arfs[i];
+		if (!f->used ||
+		    rps_may_expire_flow(dev, f->rxq, f->flow_id, i))
+			slot = i;
+	}
+	if (slot < 0) {
+		spin_unlock_irqrestore(&bp->rx_fs_lock, flags);
+		return -EBUSY;
+	}
+
+	f = &bp->arfs[slot];
+	f->saddr = fk.addrs.v4addrs.src;
+	f->daddr = fk.addrs.v4addrs.dst;
+	f->sport = fk.ports.src;
+	f->dport = fk.ports.dst;
+	f->flow_id = flow_id;
+	f->rxq = rxq_index;
+	f->used = true;
+	gem_arfs_prog(bp, slot);
+
+	spin_unlock_irqrestore(&bp->rx_fs_lock, flags);
+
+	return slot;
+}
+#else
+static void gem_arfs_sync(struct macb *bp, bool enable)
+{
+}
+#endif
+
 static int gem_add_flow_filter(struct net_device *netdev,
 		struct ethtool_rxnfc *cmd)
 {
@@ -3508,6 +5347,8 @@ static const struct ethtool_ops macb_ethtool_ops = {
 };
 
 static const struct ethtool_ops gem_ethtool_ops = {
+	.supported_coalesce_params = ETHTOOL_COALESCE_USECS |
+				     ETHTOOL_COALESCE_USE_ADAPTIVE_RX,
 	.get_regs_len		= macb_get_regs_len,
 	.get_regs		= macb_get_regs,
 	.get_wol		= macb_get_wol,
@@ -3517,12 +5358,18 @@ static const struct ethtool_ops gem_ethtool_ops = {
 	.get_ethtool_stats	= gem_get_ethtool_stats,
 	.get_strings		= gem_get_ethtool_strings,
 	.get_sset_count		= gem_get_sset_count,
+	.self_test		= gem_self_test,
 	.get_link_ksettings     = macb_get_link_ksettings,
 	.set_link_ksettings     = macb_set_link_ksettings,
 	.get_ringparam		= macb_get_ringparam,
 	.set_ringparam		= macb_set_ringparam,
+	.get_coalesce		= gem_get_coalesce,
+	.set_coalesce		= gem_set_coalesce,
 	.get_rxnfc			= gem_get_rxnfc,
 	.set_rxnfc			= gem_set_rxnfc,
+	.get_rxfh_indir_size	= gem_get_rxfh_indir_size,
+	.get_rxfh		= gem_get_rxfh,
+	.set_rxfh		= gem_set_rxfh,
 };
 
 static int macb_ioctl(struct net_device *dev, struct ifreq *rq, int cmd)
@@ -3586,6 +5433,7 @@ static inline void macb_set_rxflow_feature(struct macb *bp,
 		return;
 
 	gem_enable_flow_filters(bp, !!(features & NETIF_F_NTUPLE));
+	gem_arfs_sync(bp, !!(features & NETIF_F_NTUPLE));
 }
 
 static int macb_set_features(struct net_device *netdev,
@@ -3626,6 +5474,119 @@ static void macb_restore_features(struct macb *bp)
 		gem_prog_cmp_regs(bp, &item->fs);
 
 	macb_set_rxflow_feature(bp, features);
+
+	if (bp->rss_size)
+		gem_prog_rss(bp);
+}
+
+static void gem_enst_disable(struct macb *bp)
+{
+	gem_writel(bp, ENST_CONTROL,
+		   GENMASK(bp->num_queues - 1, 0) << GEM_ENST_DISABLE_OFFSET);
+}
+
+/* Leave the hardware enough time to latch a start time in the future */
+#define GEM_ENST_START_MARGIN_NS	(10 * NSEC_PER_MSEC)
+
+/*
+ * Offload a taprio schedule to the GEM enhanced scheduled traffic (ENST)
+ * block. ENST opens one window per queue and cycle: queue q transmits for
+ * ON_TIME from its start time, then stays closed for OFF_TIME. Schedules
+ * are therefore limited to one entry per queue, each opening exactly one
+ * queue, with traffic class n mapped onto queue n.
+ */
+static int gem_taprio_setup(struct macb *bp,
+			    struct tc_taprio_qopt_offload *conf)
+{
+	u32 start[MACB_MAX_QUEUES], on[MACB_MAX_QUEUES], off[MACB_MAX_QUEUES];
+	u64 base, now, cycle = conf->cycle_time, offset = 0;
+	unsigned long enable = 0;
+	struct timespec64 ts;
+	unsigned long flags;
+	unsigned int q, i;
+	u32 units;
+
+	if (!conf->enable) {
+		spin_lock_irqsave(&bp->lock, flags);
+		gem_enst_disable(bp);
+		spin_unlock_irqrestore(&bp->lock, flags);
+		return 0;
+	}
+
+	if (!bp->ptp_clock || conf->cycle_time_extension ||
+	    conf->num_entries > bp->num_queues)
+		return -EOPNOTSUPP;
+
+	bp->ptp_clock_info.gettime64(&bp->ptp_clock_info, &ts);
+	now = timespec64_to_ns(&ts) + GEM_ENST_START_MARGIN_NS;
+
+	/* Start on the first cycle boundary the hardware can still catch */
+	base = conf->base_time;
+	if (base < now)
+		base += div64_u64(now - base + cycle - 1, cycle) * cycle;
+
+	/* The start time register only holds two bits of seconds */
+	if (base - now >= 3 * NSEC_PER_SEC)
+		return -ERANGE;
+
+	for (i = 0; i < conf->num_entries; i++) {
+		struct tc_taprio_sched_entry *entry = &conf->entries[i];
+
+		if (entry->command != TC_TAPRIO_CMD_SET_GATES ||
+		    hweight32(entry->gate_mask) != 1)
+			return -EOPNOTSUPP;
+
+		q = __ffs(entry->gate_mask);
+		if (q >= bp->num_queues || enable & BIT(q))
+			return -EOPNOTSUPP;
+
+		if (offset + entry->interval > cycle)
+			return -EINVAL;
+
+		units = DIV_ROUND_UP(entry->interval, GEM_ENST_TIME_UNIT_NS);
+		if (units > GENMASK(GEM_ENST_TIME_SIZE - 1, 0))
+			return -ERANGE;
+		on[q] = units;
+
+		units = div_u64(cycle - entry->interval, GEM_ENST_TIME_UNIT_NS);
+		if (units > GENMASK(GEM_ENST_TIME_SIZE - 1, 0))
+			return -ERANGE;
+		off[q] = units;
+
+		ts = ns_to_timespec64(base + offset);
+		start[q] = GEM_BF(ENST_START_SEC, ts.tv_sec) |
+			   GEM_BF(ENST_START_NSEC, ts.tv_nsec);
+
+		enable |= BIT(q);
+		offset += entry->interval;
+	}
+
+	spin_lock_irqsave(&bp->lock, flags);
+	gem_enst_disable(bp);
+	for_each_set_bit(q, &enable, bp->num_queues) {
+		gem_writel(bp, ENST_START_TIME(q), start[q]);
+		gem_writel(bp, ENST_ON_TIME(q), on[q]);
+		gem_writel(bp, ENST_OFF_TIME(q), off[q]);
+	}
+	gem_writel(bp, ENST_CONTROL, enable << GEM_ENST_ENABLE_OFFSET);
+	spin_unlock_irqrestore(&bp->lock, flags);
+
+	return 0;
+}
+
+static int macb_setup_tc(struct net_device *dev, enum tc_setup_type type,
+			 void *type_data)
+{
+	struct macb *bp = netdev_priv(dev);
+
+	switch (type) {
+	case TC_SETUP_QDISC_TAPRIO:
+		if (!(bp->caps & MACB_CAPS_QBV))
+			return -EOPNOTSUPP;
+		return gem_taprio_setup(bp, type_data);
+	default:
+		return -EOPNOTSUPP;
+	}
 }
 
 static const struct net_device_ops macb_netdev_ops = {
@@ -3643,6 +5604,13 @@ static const struct net_device_ops macb_netdev_ops = {
 #endif
 	.ndo_set_features	= macb_set_features,
 	.ndo_features_check	= macb_features_check,
+	.ndo_bpf		= macb_xdp,
+	.ndo_xdp_xmit		= macb_xdp_xmit,
+	.ndo_xsk_wakeup		= macb_xsk_wakeup,
+	.ndo_setup_tc		= macb_setup_tc,
+#ifdef CONFIG_RFS_ACCEL
+	.ndo_rx_flow_steer	= macb_rx_flow_steer,
+#endif
 };
 
 /* Configure peripheral capabilities according to device tree
@@ -3832,6 +5800,7 @@ static int macb_init(struct platform_device *pdev)
 		queue = &bp->queues[q];
 		queue->bp = bp;
 		netif_napi_add(dev, &queue->napi, macb_poll, NAPI_POLL_WEIGHT);
+		netif_rx_queue_set_napi(dev, q, &queue->napi);
 		if (hw_q) {
 			queue->ISR  = GEM_ISR(hw_q - 1);
 			queue->IER  = GEM_IER(hw_q - 1);
@@ -3862,12 +5831,13 @@ static int macb_init(struct platform_device *pdev)
 #endif
 		}
 
-		/* get irq: here we use the linux queue index, not the hardware
-		 * queue index. the queue irq definitions in the device tree
+		/* get irq: the queue irq definitions in the device tree
 		 * must remove the optional gaps that could exist in the
-		 * hardware queue mask.
+		 * hardware queue mask, but list the queues exported to
+		 * user space.
 		 */
-		queue->irq = platform_get_irq(pdev, q);
+		queue->irq = platform_get_irq(pdev,
+					      macb_queue_irq_index(bp, hw_q));
 		err = devm_request_irq(&pdev->dev, queue->irq, macb_interrupt,
 				       IRQF_SHARED, dev->name, queue);
 		if (err) {
@@ -3877,10 +5847,14 @@ static int macb_init(struct platform_device *pdev)
 			return err;
 		}
 
+		spin_lock_init(&queue->tx_ptr_lock);
 		INIT_WORK(&queue->tx_error_task, macb_tx_error_task);
 		q++;
 	}
 
+	INIT_WORK(&bp->rx_dim.work, gem_rx_dim_work);
+	bp->rx_dim.mode = DIM_CQ_PERIOD_MODE_START_FROM_EQE;
+
 	dev->netdev_ops = &macb_netdev_ops;
 
 	/* setup appropriated routines according to adapter type */
@@ -3938,6 +5912,31 @@ static int macb_init(struct platform_device *pdev)
 			bp->max_tuples = 0;
 	}
 
+	/* Spread flows over all queues, given screeners to spare for it */
+	if (macb_is_gem(bp) && bp->max_tuples > 0 && bp->num_queues > 1) {
+		unsigned int rss_size = roundup_pow_of_two(bp->num_queues);
+
+		if (rss_size <= MACB_RSS_MAX && bp->max_tuples > rss_size) {
+			bp->max_tuples -= rss_size;
+			bp->rss_base = bp->max_tuples;
+			bp->rss_size = rss_size;
+			for (q = 0; q < rss_size; q++)
+				bp->rss_indir[q] =
+					ethtool_rxfh_indir_default(q, bp->num_queues);
+			gem_prog_rss(bp);
+		}
+	}
+
+#ifdef CONFIG_RFS_ACCEL
+	/* Steered flows take the last ntuple screeners, ahead of spreading */
+	if (macb_is_gem(bp) && bp->max_tuples > 1 && bp->num_queues > 1) {
+		bp->arfs_size = min_t(unsigned int, MACB_ARFS_MAX,
+				      bp->max_tuples / 2);
+		bp->max_tuples -= bp->arfs_size;
+		bp->arfs_base = bp->max_tuples;
+	}
+#endif
+
 	if (!(bp->caps & MACB_CAPS_USRIO_DISABLED)) {
 		val = 0;
 		if (phy_interface_mode_is_rgmii(bp->phy_interface))
@@ -4474,6 +6473,16 @@ static const struct macb_config fu540_c000_config = {
 	.usrio = &macb_default_usrio,
 };
 
+static const struct macb_config mpfs_config = {
+	.caps = MACB_CAPS_GIGABIT_MODE_AVAILABLE | MACB_CAPS_JUMBO |
+		MACB_CAPS_GEM_HAS_PTP | MACB_CAPS_QBV,
+	.dma_burst_length = 16,
+	.clk_init = macb_clk_init,
+	.init = macb_init,
+	.jumbo_max_len = 10240,
+	.usrio = &macb_default_usrio,
+};
+
 static const struct macb_config at91sam9260_config = {
 	.caps = MACB_CAPS_USRIO_HAS_CLKEN | MACB_CAPS_USRIO_DEFAULT_IS_MII_GMII,
 	.clk_init = macb_clk_init,
@@ -4590,6 +6599,7 @@ static const struct of_device_id macb_dt_ids[] = {
 	{ .compatible = "cdns,zynqmp-gem", .data = &zynqmp_config},
 	{ .compatible = "cdns,zynq-gem", .data = &zynq_config },
 	{ .compatible = "sifive,fu540-c000-gem", .data = &fu540_c000_config },
+	{ .compatible = "microchip,mpfs-macb", .data = &mpfs_config },
 	{ .compatible = "microchip,sama7g5-gem", .data = &sama7g5_gem_config },
 	{ .compatible = "microchip,sama7g5-emac", .data = &sama7g5_emac_config },
 	{ /* sentinel */ }
@@ -4608,6 +6618,55 @@ static const struct macb_config default_gem_config = {
 	.jumbo_max_len = 10240,
 };
 
+#ifdef CONFIG_RFS_ACCEL
+/*
+ * Tell RFS which queue to steer a flow to for the CPU reading it: the one
+ * pinned there by macb_set_queue_affinity(), or queue 0 for the rest.
+ */
+static void macb_set_rx_cpu_rmap(struct macb *bp, bool spread)
+{
+	struct net_device *dev = bp->dev;
+	unsigned int q;
+
+	if (!spread || !bp->arfs_size) {
+		if (dev->rx_cpu_rmap) {
+			cpu_rmap_put(dev->rx_cpu_rmap);
+			dev->rx_cpu_rmap = NULL;
+		}
+		return;
+	}
+
+	if (!dev->rx_cpu_rmap) {
+		dev->rx_cpu_rmap = alloc_cpu_rmap(bp->num_queues, GFP_KERNEL);
+		if (!dev->rx_cpu_rmap)
+			return;
+	}
+
+	cpu_rmap_update(dev->rx_cpu_rmap, 0, cpu_online_mask);
+	for (q = 1; q < bp->num_queues; q++)
+		cpu_rmap_update(dev->rx_cpu_rmap, q,
+				cpumask_of(cpumask_local_spread(q, NUMA_NO_NODE)));
+}
+#endif
+
+/* Give each queue but the first, which also takes all unsteered traffic,
+ * a CPU of its own, so that their NAPI contexts run on distinct harts.
+ */
+static void macb_set_queue_affinity(struct macb *bp, bool spread)
+{
+	struct macb_queue *queue;
+	unsigned int q;
+
+	for (q = 1, queue = bp->queues + 1; q < bp->num_queues; ++q, ++queue)
+		irq_set_affinity_hint(queue->irq, spread ?
+				      cpumask_of(cpumask_local_spread(q, NUMA_NO_NODE)) :
+				      NULL);
+
+#ifdef CONFIG_RFS_ACCEL
+	macb_set_rx_cpu_rmap(bp, spread);
+#endif
+}
+
 static int macb_probe(struct platform_device *pdev)
 {
 	const struct macb_config *macb_config = &default_gem_config;
@@ -4618,7 +6677,7 @@ static int macb_probe(struct platform_device *pdev)
 	struct device_node *np = pdev->dev.of_node;
 	struct clk *pclk, *hclk = NULL, *tx_clk = NULL, *rx_clk = NULL;
 	struct clk *tsu_clk = NULL;
-	unsigned int queue_mask, num_queues;
+	unsigned int queue_mask, num_queues, uio_queue_mask;
 	bool native_io;
 	phy_interface_t interface;
 	struct net_device *dev;
@@ -4653,9 +6712,13 @@ static int macb_probe(struct platform_device *pdev)
 	pm_runtime_get_noresume(&pdev->dev);
 	pm_runtime_set_active(&pdev->dev);
 	pm_runtime_enable(&pdev->dev);
+	device_enable_async_suspend(&pdev->dev);
 	native_io = hw_is_native_io(mem);
 
 	macb_probe_queues(mem, native_io, &queue_mask, &num_queues);
+	uio_queue_mask = macb_uio_queue_mask(pdev, queue_mask);
+	queue_mask &= ~uio_queue_mask;
+	num_queues -= hweight32(uio_queue_mask);
 	dev = alloc_etherdev_mq(sizeof(*bp), num_queues);
 	if (!dev) {
 		err = -ENOMEM;
@@ -4680,6 +6743,7 @@ static int macb_probe(struct platform_device *pdev)
 	}
 	bp->num_queues = num_queues;
 	bp->queue_mask = queue_mask;
+	bp->uio_queue_mask = uio_queue_mask;
 	if (macb_config)
 		bp->dma_burst_length = macb_config->dma_burst_length;
 	bp->pclk = pclk;
@@ -4775,6 +6839,12 @@ static int macb_probe(struct platform_device *pdev)
 
 	tasklet_setup(&bp->hresp_err_tasklet, macb_hresp_error_task);
 
+	macb_set_queue_affinity(bp, true);
+
+	if (macb_uio_probe(bp))
+		dev_warn(&pdev->dev, "Queues %#x not exported to user space\n",
+			 bp->uio_queue_mask);
+
 	netdev_info(dev, "Cadence %s rev 0x%08x at 0x%08lx irq %d (%pM)\n",
 		    macb_is_gem(bp) ? "GEM" : "MACB", macb_readl(bp, MID),
 		    dev->base_addr, dev->irq, dev->dev_addr);
@@ -4813,6 +6883,8 @@ static int macb_remove(struct platform_device *pdev)
 		mdiobus_free(bp->mii_bus);
 
 		unregister_netdev(dev);
+		macb_uio_remove(bp);
+		macb_set_queue_affinity(bp, false);
 		tasklet_kill(&bp->hresp_err_tasklet);
 		pm_runtime_disable(&pdev->dev);
 		pm_runtime_dont_use_autosuspend(&pdev->dev);
@@ -4828,6 +6900,78 @@ static int macb_remove(struct platform_device *pdev)
 	return 0;
 }
 
+/* When the platform does not remove power, the PHY can keep the link up
+ * across suspend. Resume then only has to restart the MAC, instead of
+ * waiting for a full autonegotiation. This has to be decided in prepare,
+ * because the PHY is suspended by its MDIO bus before the MAC is.
+ */
+static int __maybe_unused macb_prepare(struct device *dev)
+{
+	struct net_device *netdev = dev_get_drvdata(dev);
+	struct macb *bp = netdev_priv(netdev);
+
+	bp->pm_data.fast = netif_running(netdev) &&
+			   !(bp->wol & MACB_WOL_ENABLED) &&
+			   !pm_suspend_via_firmware();
+
+	if (bp->pm_data.fast && netdev->phydev)
+		netdev->phydev->mac_managed_pm = true;
+
+	return 0;
+}
+
+static void __maybe_unused macb_complete(struct device *dev)
+{
+	struct net_device *netdev = dev_get_drvdata(dev);
+	struct macb *bp = netdev_priv(netdev);
+
+	if (bp->pm_data.fast && netdev->phydev)
+		netdev->phydev->mac_managed_pm = false;
+
+	bp->pm_data.fast = false;
+}
+
+/* Quiesce the MAC the way a link down would, leaving its configuration,
+ * the rings, the clocks and the PTP clock in place.
+ */
+static void macb_fast_suspend(struct macb *bp)
+{
+	struct macb_queue *queue;
+	unsigned long flags;
+	unsigned int q;
+
+	spin_lock_irqsave(&bp->lock, flags);
+	macb_writel(bp, NCR, macb_readl(bp, NCR) & ~(MACB_BIT(RE) | MACB_BIT(TE)));
+	for (q = 0, queue = bp->queues; q < bp->num_queues; ++q, ++queue) {
+		queue_writel(queue, IDR, -1);
+		queue_readl(queue, ISR);
+		if (bp->caps & MACB_CAPS_ISR_CLEAR_ON_WRITE)
+			queue_writel(queue, ISR, -1);
+	}
+	spin_unlock_irqrestore(&bp->lock, flags);
+}
+
+/* Undo macb_fast_suspend(), as macb_mac_link_up() would if the link is
+ * still up. Otherwise phylink brings the MAC up when it returns.
+ */
+static void macb_fast_resume(struct macb *bp)
+{
+	struct macb_queue *queue;
+	unsigned long flags;
+	unsigned int q;
+
+	spin_lock_irqsave(&bp->lock, flags);
+	bp->macbgem_ops.mog_init_rings(bp);
+	macb_init_buffers(bp);
+	for (q = 0, queue = bp->queues; q < bp->num_queues; ++q, ++queue)
+		queue_writel(queue, IER,
+			     bp->rx_intr_mask | MACB_TX_INT_FLAGS | MACB_BIT(HRESP));
+	spin_unlock_irqrestore(&bp->lock, flags);
+
+	if (netif_carrier_ok(bp->dev))
+		macb_writel(bp, NCR, macb_readl(bp, NCR) | MACB_BIT(RE) | MACB_BIT(TE));
+}
+
 static int __maybe_unused macb_suspend(struct device *dev)
 {
 	struct net_device *netdev = dev_get_drvdata(dev);
@@ -4892,6 +7036,11 @@ static int __maybe_unused macb_suspend(struct device *dev)
 	     ++q, ++queue)
 		napi_disable(&queue->napi);
 
+	if (bp->pm_data.fast) {
+		macb_fast_suspend(bp);
+		return 0;
+	}
+
 	if (!(bp->wol & MACB_WOL_ENABLED)) {
 		rtnl_lock();
 		phylink_stop(bp->phylink);
@@ -4927,6 +7076,15 @@ static int __maybe_unused macb_resume(struct device *dev)
 	if (!netif_running(netdev))
 		return 0;
 
+	if (bp->pm_data.fast) {
+		macb_fast_resume(bp);
+		for (q = 0, queue = bp->queues; q < bp->num_queues;
+		     ++q, ++queue)
+			napi_enable(&queue->napi);
+		netif_device_attach(netdev);
+		return 0;
+	}
+
 	if (!device_may_wakeup(dev))
 		pm_runtime_force_resume(dev);
 
@@ -5022,6 +7180,10 @@ static int __maybe_unused macb_runtime_resume(struct device *dev)
 }
 
 static const struct dev_pm_ops macb_pm_ops = {
+#ifdef CONFIG_PM_SLEEP
+	.prepare = macb_prepare,
+	.complete = macb_complete,
+#endif
 	SET_SYSTEM_SLEEP_PM_OPS(macb_suspend, macb_resume)
 	SET_RUNTIME_PM_OPS(macb_runtime_suspend, macb_runtime_resume, NULL)
 };
@@ -5033,6 +7195,7 @@ static struct platform_driver macb_driver = {
 		.name		= "macb",
 		.of_match_table	= of_match_ptr(macb_dt_ids),
 		.pm	= &macb_pm_ops,
+		.probe_type = PROBE_PREFER_ASYNCHRONOUS,
 	},
 };
 
@@ -238,10 +238,27 @@ static void gem_ptp_clear_timer(struct macb *bp)
 	gem_writel(bp, TA, 0);
 }
 
+/* Only the TSU seconds are needed to extend a descriptor timestamp */
+static u64 gem_tsu_get_sec(struct macb *bp)
+{
+	unsigned long flags;
+	u32 secl, sech;
+
+	spin_lock_irqsave(&bp->tsu_clk_lock, flags);
+	/* TSH only moves when TSL wraps, re-read it to catch that */
+	do {
+		sech = gem_readl(bp, TSH);
+		secl = gem_readl(bp, TSL);
+	} while (unlikely(sech != gem_readl(bp, TSH)));
+	spin_unlock_irqrestore(&bp->tsu_clk_lock, flags);
+
+	return (((u64)sech << GEM_TSL_SIZE) | secl) & TSU_SEC_MAX_VAL;
+}
+
 static int gem_hw_timestamp(struct macb *bp, u32 dma_desc_ts_1,
 			    u32 dma_desc_ts_2, struct timespec64 *ts)
 {
-	struct timespec64 tsu;
+	u64 tsu_sec;
 
 	ts->tv_sec = (GEM_BFEXT(DMA_SECH, dma_desc_ts_2) << GEM_DMA_SECL_SIZE) |
 			GEM_BFEXT(DMA_SECL, dma_desc_ts_1);
@@ -251,17 +268,17 @@ static int gem_hw_timestamp(struct macb *bp, u32 dma_desc_ts_1,
 	 * The timestamp only contains lower few bits of seconds,
 	 * so add value from 1588 timer
 	 */
-	gem_tsu_get_time(&bp->ptp_clock_info, &tsu);
+	tsu_sec = gem_tsu_get_sec(bp);
 
 	/* If the top bit is set in the timestamp,
 	 * but not in 1588 timer, it has rolled over,
 	 * so subtract max size
 	 */
 	if ((ts->tv_sec & (GEM_DMA_SEC_TOP >> 1)) &&
-	    !(tsu.tv_sec & (GEM_DMA_SEC_TOP >> 1)))
+	    !(tsu_sec & (GEM_DMA_SEC_TOP >> 1)))
 		ts->tv_sec -= GEM_DMA_SEC_TOP;
 
-	ts->tv_sec += ((~GEM_DMA_SEC_MASK) & tsu.tv_sec);
+	ts->tv_sec += ((~GEM_DMA_SEC_MASK) & tsu_sec);
 
 	return 0;
 }
@@ -0,0 +1,100 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+/*
+ * Cadence MACB/GEM tracepoints
+ *
+ * Interrupt to end of NAPI poll latency per queue:
+ *
+ *   echo 'macb_poll_lat u16 queue; u64 lat; int work' >> synthetic_events
+ *   echo 'hist:keys=queue:ts0=common_timestamp.usecs' >> \
+ *	events/macb/macb_napi_schedule/trigger
+ *   echo 'hist:keys=queue:lat=common_timestamp.usecs-$ts0:onmatch(macb.macb_napi_schedule).trace(macb_poll_lat,queue,$lat,work_done)' >> \
+ *	events/macb/macb_rx_poll/trigger
+ *   echo 'hist:keys=queue,lat.log2' >> events/synthetic/macb_poll_lat/trigger
+ */
+#undef TRACE_SYSTEM
+#define TRACE_SYSTEM macb
+
+#if !defined(_MACB_TRACE_H_) || defined(TRACE_HEADER_MULTI_READ)
+#define _MACB_TRACE_H_
+
+#include <linux/tracepoint.h>
+
+TRACE_EVENT(macb_napi_schedule,
+
+	TP_PROTO(const struct net_device *dev, u16 queue, u32 status),
+
+	TP_ARGS(dev, queue, status),
+
+	TP_STRUCT__entry(
+		__string(name, dev->name)
+		__field(u16, queue)
+		__field(u32, status)
+	),
+
+	TP_fast_assign(
+		__assign_str(name, dev->name);
+		__entry->queue = queue;
+		__entry->status = status;
+	),
+
+	TP_printk("%s queue=%u isr=0x%08x", __get_str(name), __entry->queue,
+		  __entry->status)
+);
+
+TRACE_EVENT(macb_rx_poll,
+
+	TP_PROTO(const struct net_device *dev, u16 queue, int budget,
+		 int work_done),
+
+	TP_ARGS(dev, queue, budget, work_done),
+
+	TP_STRUCT__entry(
+		__string(name, dev->name)
+		__field(u16, queue)
+		__field(int, budget)
+		__field(int, work_done)
+	),
+
+	TP_fast_assign(
+		__assign_str(name, dev->name);
+		__entry->queue = queue;
+		__entry->budget = budget;
+		__entry->work_done = work_done;
+	),
+
+	TP_printk("%s queue=%u budget=%d work_done=%d", __get_str(name),
+		  __entry->queue, __entry->budget, __entry->work_done)
+);
+
+TRACE_EVENT(macb_tx_complete,
+
+	TP_PROTO(const struct net_device *dev, u16 queue, unsigned int frames,
+		 unsigned int pending),
+
+	TP_ARGS(dev, queue, frames, pending),
+
+	TP_STRUCT__entry(
+		__string(name, dev->name)
+		__field(u16, queue)
+		__field(unsigned int, frames)
+		__field(unsigned int, pending)
+	),
+
+	TP_fast_assign(
+		__assign_str(name, dev->name);
+		__entry->queue = queue;
+		__entry->frames = frames;
+		__entry->pending = pending;
+	),
+
+	TP_printk("%s queue=%u frames=%u pending=%u", __get_str(name),
+		  __entry->queue, __entry->frames, __entry->pending)
+);
+
+#endif /* _MACB_TRACE_H_ */
+
+#undef TRACE_INCLUDE_PATH
+#define TRACE_INCLUDE_PATH .
+#undef TRACE_INCLUDE_FILE
+#define TRACE_INCLUDE_FILE macb_trace
+#include <trace/define_trace.h>
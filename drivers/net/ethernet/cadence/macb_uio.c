@@ -0,0 +1,276 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * Cadence GEM queues handed to user space through UIO
+ *
+ * Hardware queues named by the "microchip,uio-queues" mask are left out of
+ * the net_device. Each gets a UIO device mapping the register block, a
+ * coherent DMA area for its rings and buffers, and the queue interrupt, so
+ * that a poll-mode driver can run it from user space. The kernel keeps
+ * queue 0, the MAC configuration and the link: frames only move on an
+ * exported queue while the interface is up.
+ */
+
+#include <linux/dma-mapping.h>
+#include <linux/interrupt.h>
+#include <linux/module.h>
+#include <linux/moduleparam.h>
+#include <linux/netdevice.h>
+#include <linux/of.h>
+#include <linux/platform_device.h>
+#include <linux/sizes.h>
+#include <linux/slab.h>
+#include <linux/uio_driver.h>
+#include "macb.h"
+
+#define MACB_UIO_VERSION	"0.1"
+
+/* Offsets in the DMA area of the descriptors parked on at probe */
+#define MACB_UIO_RX_PARK	0
+#define MACB_UIO_TX_PARK	64
+
+static unsigned int uio_dma_size = SZ_2M;
+module_param(uio_dma_size, uint, 0444);
+MODULE_PARM_DESC(uio_dma_size,
+		 "Size of the DMA area given to each queue exported through UIO");
+
+struct macb_uio_queue {
+	struct uio_info info;
+	struct macb *bp;
+	unsigned int hw_q;
+	/* Sources masked by the interrupt handler, until irqcontrol */
+	spinlock_t lock;
+	u32 masked;
+	void *area;
+	dma_addr_t area_dma;
+};
+
+static u32 macb_uio_readl(struct macb_uio_queue *uq, int offset)
+{
+	return uq->bp->macb_reg_readl(uq->bp, offset);
+}
+
+static void macb_uio_writel(struct macb_uio_queue *uq, int offset, u32 value)
+{
+	uq->bp->macb_reg_writel(uq->bp, offset, value);
+}
+
+/**
+ * macb_uio_queue_mask() - Hardware queues to export
+ * @pdev:	the GEM platform device
+ * @queue_mask:	hardware queues present
+ *
+ * Queue 0 always stays with the kernel, it receives what no screener
+ * steers elsewhere.
+ *
+ * Return: mask of the hardware queues to leave out of the net_device.
+ */
+unsigned int macb_uio_queue_mask(struct platform_device *pdev,
+				 unsigned int queue_mask)
+{
+	u32 mask = 0;
+
+	of_property_read_u32(pdev->dev.of_node, "microchip,uio-queues", &mask);
+
+	return mask & queue_mask & ~1U;
+}
+
+/*
+ * Mask every source enabled on the queue and wake the reader, which finds
+ * the cause in the queue ISR and writes 1 to unmask them again.
+ */
+static irqreturn_t macb_uio_handler(int irq, struct uio_info *info)
+{
+	struct macb_uio_queue *uq = info->priv;
+	u32 enabled;
+
+	spin_lock(&uq->lock);
+	enabled = ~macb_uio_readl(uq, GEM_IMR(uq->hw_q - 1));
+	if (enabled) {
+		macb_uio_writel(uq, GEM_IDR(uq->hw_q - 1), enabled);
+		uq->masked |= enabled;
+	}
+	spin_unlock(&uq->lock);
+
+	return enabled ? IRQ_HANDLED : IRQ_NONE;
+}
+
+/* write() on the UIO device: 1 unmasks what the handler masked, 0 masks */
+static int macb_uio_irqcontrol(struct uio_info *info, s32 irq_on)
+{
+	struct macb_uio_queue *uq = info->priv;
+	unsigned long flags;
+	u32 enabled;
+
+	spin_lock_irqsave(&uq->lock, flags);
+	if (irq_on) {
+		if (uq->masked)
+			macb_uio_writel(uq, GEM_IER(uq->hw_q - 1), uq->masked);
+		uq->masked = 0;
+	} else {
+		enabled = ~macb_uio_readl(uq, GEM_IMR(uq->hw_q - 1));
+		macb_uio_writel(uq, GEM_IDR(uq->hw_q - 1), enabled);
+		uq->masked |= enabled;
+	}
+	spin_unlock_irqrestore(&uq->lock, flags);
+
+	return 0;
+}
+
+/*
+ * Point the queue at a used RX and a used TX descriptor, both wrapping, so
+ * that it fetches nothing until user space installs rings of its own.
+ */
+static void macb_uio_park(struct macb_uio_queue *uq)
+{
+	struct macb_dma_desc *rx = uq->area + MACB_UIO_RX_PARK;
+	struct macb_dma_desc *tx = uq->area + MACB_UIO_TX_PARK;
+	unsigned int hw_q = uq->hw_q;
+
+	macb_uio_writel(uq, GEM_IDR(hw_q - 1), ~0U);
+	macb_uio_readl(uq, GEM_ISR(hw_q - 1));
+	if (uq->bp->caps & MACB_CAPS_ISR_CLEAR_ON_WRITE)
+		macb_uio_writel(uq, GEM_ISR(hw_q - 1), ~0U);
+
+	rx->addr = MACB_BIT(RX_USED) | MACB_BIT(RX_WRAP);
+	rx->ctrl = 0;
+	tx->addr = 0;
+	tx->ctrl = MACB_BIT(TX_USED) | MACB_BIT(TX_WRAP);
+	wmb();
+
+	macb_uio_writel(uq, GEM_RBQP(hw_q - 1),
+			lower_32_bits(uq->area_dma + MACB_UIO_RX_PARK));
+	macb_uio_writel(uq, GEM_TBQP(hw_q - 1),
+			lower_32_bits(uq->area_dma + MACB_UIO_TX_PARK));
+}
+
+static void macb_uio_free(struct macb_uio_queue *uq)
+{
+	struct device *dev = &uq->bp->pdev->dev;
+
+	if (uq->area)
+		dma_free_coherent(dev, uio_dma_size, uq->area, uq->area_dma);
+	kfree(uq->info.name);
+	kfree(uq);
+}
+
+static int macb_uio_add(struct macb *bp, struct resource *regs,
+			unsigned int hw_q, int irq)
+{
+	struct device *dev = &bp->pdev->dev;
+	struct macb_uio_queue *uq;
+	struct uio_info *info;
+	int err;
+
+	uq = kzalloc(sizeof(*uq), GFP_KERNEL);
+	if (!uq)
+		return -ENOMEM;
+
+	uq->bp = bp;
+	uq->hw_q = hw_q;
+	spin_lock_init(&uq->lock);
+
+	err = -ENOMEM;
+	uq->area = dma_alloc_coherent(dev, uio_dma_size, &uq->area_dma,
+				      GFP_KERNEL);
+	if (!uq->area)
+		goto err_free;
+
+	/* The upper address halves are shared with the kernel's queues */
+	if (upper_32_bits(uq->area_dma) !=
+	    upper_32_bits(uq->area_dma + uio_dma_size - 1)) {
+		err = -ERANGE;
+		goto err_free;
+	}
+
+	info = &uq->info;
+	info->name = kasprintf(GFP_KERNEL, "%s-q%u", bp->dev->name, hw_q);
+	if (!info->name)
+		goto err_free;
+	info->version = MACB_UIO_VERSION;
+
+	info->mem[0].name = "registers";
+	info->mem[0].addr = regs->start;
+	info->mem[0].size = resource_size(regs);
+	info->mem[0].memtype = UIO_MEM_PHYS;
+
+	info->mem[1].name = "dma";
+	info->mem[1].addr = uq->area_dma;
+	info->mem[1].size = uio_dma_size;
+	info->mem[1].memtype = UIO_MEM_PHYS;
+
+	info->irq = irq;
+	info->handler = macb_uio_handler;
+	info->irqcontrol = macb_uio_irqcontrol;
+	info->priv = uq;
+
+	macb_uio_park(uq);
+
+	err = uio_register_device(dev, info);
+	if (err)
+		goto err_free;
+
+	bp->uio[hw_q] = uq;
+	return 0;
+
+err_free:
+	macb_uio_free(uq);
+	return err;
+}
+
+/**
+ * macb_uio_probe() - Register the exported queues with UIO
+ * @bp:		the GEM, with its net_device registered
+ *
+ * A queue that cannot be exported stays unused, it is not given back to
+ * the net_device.
+ *
+ * Return: 0, or the first error met.
+ */
+int macb_uio_probe(struct macb *bp)
+{
+	struct platform_device *pdev = bp->pdev;
+	struct resource *regs;
+	unsigned int hw_q;
+	int irq, err;
+
+	regs = platform_get_resource(pdev, IORESOURCE_MEM, 0);
+
+	for (hw_q = 1; hw_q < MACB_MAX_QUEUES; hw_q++) {
+		if (!(bp->uio_queue_mask & BIT(hw_q)))
+			continue;
+
+		irq = platform_get_irq(pdev, macb_queue_irq_index(bp, hw_q));
+		if (irq < 0)
+			return irq;
+
+		err = macb_uio_add(bp, regs, hw_q, irq);
+		if (err) {
+			dev_err(&pdev->dev, "Cannot export queue %u (error %d)\n",
+				hw_q, err);
+			return err;
+		}
+	}
+
+	return 0;
+}
+
+/**
+ * macb_uio_remove() - Take the exported queues back from user space
+ * @bp:		the GEM, with its MAC stopped
+ */
+void macb_uio_remove(struct macb *bp)
+{
+	struct macb_uio_queue *uq;
+	unsigned int hw_q;
+
+	for (hw_q = 1; hw_q < MACB_MAX_QUEUES; hw_q++) {
+		uq = bp->uio[hw_q];
+		if (!uq)
+			continue;
+
+		uio_unregister_device(&uq->info);
+		macb_uio_writel(uq, GEM_IDR(hw_q - 1), ~0U);
+		macb_uio_free(uq);
+		bp->uio[hw_q] = NULL;
+	}
+}
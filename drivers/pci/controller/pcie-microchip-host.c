@@ -8,6 +8,7 @@
  */
 
 #include <linux/clk.h>
+#include <linux/debugfs.h>
 #include <linux/irqchip/chained_irq.h>
 #include <linux/module.h>
 #include <linux/msi.h>
@@ -16,6 +17,8 @@
 #include <linux/of_pci.h>
 #include <linux/pci-ecam.h>
 #include <linux/platform_device.h>
+#include <linux/seq_file.h>
+#include <linux/smp.h>
 
 #include "../pci.h"
 
@@ -251,6 +254,20 @@ struct event_map {
 	u32 event_bit;
 };
 
+/*
+ * All MSIs arrive through one bridge interrupt, so vectors whose affinity
+ * names another hart are acked by the demux and handed over by IPI.
+ */
+struct mc_msi_cpu {
+	unsigned long pending;
+	call_single_data_t csd;
+};
+
+struct mc_msi_stats {
+	u64 count;
+	u64 redirected;
+};
+
 struct mc_msi {
 	struct mutex lock;		/* Protect used bitmap */
 	struct irq_domain *msi_domain;
@@ -258,6 +275,9 @@ struct mc_msi {
 	u32 num_vectors;
 	u64 vector_phy;
 	DECLARE_BITMAP(used, MC_NUM_MSI_IRQS);
+	unsigned int target[MC_NUM_MSI_IRQS];
+	struct mc_msi_stats stats[MC_NUM_MSI_IRQS];
+	struct mc_msi_cpu __percpu *cpu;
 };
 
 struct mc_port {
@@ -401,44 +421,94 @@ static void mc_pcie_enable_msi(struct mc_port *port, void __iomem *base)
 		       base + cap_offset + PCI_MSI_ADDRESS_HI);
 }
 
+static void mc_msi_ack_vector(struct mc_port *port, u32 bitpos)
+{
+	void __iomem *bridge_base_addr =
+		port->axi_base_addr + MC_PCIE_BRIDGE_ADDR;
+	unsigned long status;
+
+	writel_relaxed(BIT(bitpos), bridge_base_addr + ISTATUS_MSI);
+	status = readl_relaxed(bridge_base_addr + ISTATUS_MSI);
+	if (!status)
+		writel_relaxed(BIT(PM_MSI_INT_MSI_SHIFT),
+			       bridge_base_addr + ISTATUS_LOCAL);
+}
+
+static void mc_msi_dispatch(struct mc_port *port, u32 bit)
+{
+	u32 virq = irq_find_mapping(port->msi.dev_domain, bit);
+
+	if (virq)
+		generic_handle_irq(virq);
+	else
+		dev_err_ratelimited(port->dev, "bad MSI IRQ %d\n", bit);
+}
+
+static void mc_msi_ipi_handler(void *data)
+{
+	struct mc_port *port = data;
+	struct mc_msi_cpu *pc = this_cpu_ptr(port->msi.cpu);
+	unsigned long pending;
+	u32 bit;
+
+	pending = xchg(&pc->pending, 0);
+	for_each_set_bit(bit, &pending, MC_NUM_MSI_IRQS)
+		mc_msi_dispatch(port, bit);
+}
+
 static void mc_handle_msi(struct irq_desc *desc)
 {
 	struct mc_port *port = irq_desc_get_handler_data(desc);
-	struct device *dev = port->dev;
 	struct mc_msi *msi = &port->msi;
 	void __iomem *bridge_base_addr =
 		port->axi_base_addr + MC_PCIE_BRIDGE_ADDR;
+	unsigned int cpu = smp_processor_id();
+	struct cpumask redirect;
+	struct mc_msi_cpu *pc;
 	unsigned long status;
+	unsigned int target;
 	u32 bit;
-	u32 virq;
 
 	status = readl_relaxed(bridge_base_addr + ISTATUS_LOCAL);
-	if (status & PM_MSI_INT_MSI_MASK) {
-		status = readl_relaxed(bridge_base_addr + ISTATUS_MSI);
-		for_each_set_bit(bit, &status, msi->num_vectors) {
-			virq = irq_find_mapping(msi->dev_domain, bit);
-			if (virq)
-				generic_handle_irq(virq);
-			else
-				dev_err_ratelimited(dev, "bad MSI IRQ %d\n",
-						    bit);
+	if (!(status & PM_MSI_INT_MSI_MASK))
+		return;
+
+	cpumask_clear(&redirect);
+	status = readl_relaxed(bridge_base_addr + ISTATUS_MSI);
+	for_each_set_bit(bit, &status, msi->num_vectors) {
+		msi->stats[bit].count++;
+
+		target = READ_ONCE(msi->target[bit]);
+		if (target == cpu || target >= nr_cpu_ids ||
+		    !cpu_online(target)) {
+			mc_msi_dispatch(port, bit);
+			continue;
 		}
+
+		/*
+		 * Ack here so the bridge line drops while the target hart
+		 * catches up. Its flow handler acks again before running
+		 * the handler, so nothing raised meanwhile is missed.
+		 */
+		mc_msi_ack_vector(port, bit);
+		msi->stats[bit].redirected++;
+
+		pc = per_cpu_ptr(msi->cpu, target);
+		set_bit(bit, &pc->pending);
+		cpumask_set_cpu(target, &redirect);
 	}
+
+	/* -EBUSY means the IPI is queued and will see the new bits */
+	for_each_cpu(target, &redirect)
+		smp_call_function_single_async(target,
+					       &per_cpu_ptr(msi->cpu, target)->csd);
 }
 
 static void mc_msi_bottom_irq_ack(struct irq_data *data)
 {
 	struct mc_port *port = irq_data_get_irq_chip_data(data);
-	void __iomem *bridge_base_addr =
-		port->axi_base_addr + MC_PCIE_BRIDGE_ADDR;
-	u32 bitpos = data->hwirq;
-	unsigned long status;
 
-	writel_relaxed(BIT(bitpos), bridge_base_addr + ISTATUS_MSI);
-	status = readl_relaxed(bridge_base_addr + ISTATUS_MSI);
-	if (!status)
-		writel_relaxed(BIT(PM_MSI_INT_MSI_SHIFT),
-			       bridge_base_addr + ISTATUS_LOCAL);
+	mc_msi_ack_vector(port, data->hwirq);
 }
 
 static void mc_compose_msi_msg(struct irq_data *data, struct msi_msg *msg)
@@ -457,7 +527,22 @@ static void mc_compose_msi_msg(struct irq_data *data, struct msi_msg *msg)
 static int mc_msi_set_affinity(struct irq_data *irq_data,
 			       const struct cpumask *mask, bool force)
 {
-	return -EINVAL;
+	struct mc_port *port = irq_data_get_irq_chip_data(irq_data);
+	unsigned int cpu;
+
+	if (force)
+		cpu = cpumask_first(mask);
+	else
+		cpu = cpumask_any_and(mask, cpu_online_mask);
+
+	if (cpu >= nr_cpu_ids)
+		return -EINVAL;
+
+	WRITE_ONCE(port->msi.target[irq_data->hwirq], cpu);
+	irq_data_update_effective_affinity(irq_data, cpumask_of(cpu));
+
+	/* The doorbell is shared, so the MSI message itself is unchanged */
+	return IRQ_SET_MASK_OK_DONE;
 }
 
 static struct irq_chip mc_msi_bottom_irq_chip = {
@@ -485,6 +570,8 @@ static int mc_irq_msi_domain_alloc(struct irq_domain *domain, unsigned int virq,
 	}
 
 	set_bit(bit, msi->used);
+	msi->target[bit] = nr_cpu_ids;
+	memset(&msi->stats[bit], 0, sizeof(msi->stats[bit]));
 
 	irq_domain_set_info(domain, virq, bit, &mc_msi_bottom_irq_chip,
 			    domain->host_data, handle_edge_irq, NULL, NULL);
@@ -539,9 +626,20 @@ static int mc_allocate_msi_domains(struct mc_port *port)
 	struct device *dev = port->dev;
 	struct fwnode_handle *fwnode = of_node_to_fwnode(dev->of_node);
 	struct mc_msi *msi = &port->msi;
+	struct mc_msi_cpu *pc;
+	unsigned int cpu;
 
 	mutex_init(&port->msi.lock);
 
+	msi->cpu = devm_alloc_percpu(dev, struct mc_msi_cpu);
+	if (!msi->cpu)
+		return -ENOMEM;
+
+	for_each_possible_cpu(cpu) {
+		pc = per_cpu_ptr(msi->cpu, cpu);
+		INIT_CSD(&pc->csd, mc_msi_ipi_handler, port);
+	}
+
 	msi->dev_domain = irq_domain_add_linear(NULL, msi->num_vectors,
 						&msi_domain_ops, port);
 	if (!msi->dev_domain) {
@@ -560,6 +658,40 @@ static int mc_allocate_msi_domains(struct mc_port *port)
 	return 0;
 }
 
+static int mc_msi_stats_show(struct seq_file *s, void *data)
+{
+	struct mc_port *port = s->private;
+	struct mc_msi *msi = &port->msi;
+	unsigned int target;
+	u32 bit;
+
+	seq_puts(s, "vector   virq target            count       redirected\n");
+	for_each_set_bit(bit, msi->used, msi->num_vectors) {
+		target = READ_ONCE(msi->target[bit]);
+		seq_printf(s, "%6u %6u ", bit,
+			   irq_find_mapping(msi->dev_domain, bit));
+		if (target < nr_cpu_ids)
+			seq_printf(s, "%6u ", target);
+		else
+			seq_puts(s, "   any ");
+		seq_printf(s, "%16llu %16llu\n",
+			   READ_ONCE(msi->stats[bit].count),
+			   READ_ONCE(msi->stats[bit].redirected));
+	}
+
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(mc_msi_stats);
+
+static void mc_pcie_debugfs_init(struct mc_port *port)
+{
+	struct dentry *dir;
+
+	dir = debugfs_create_dir(dev_name(port->dev), NULL);
+	debugfs_create_file("msi_stats", 0444, dir, port,
+			    &mc_msi_stats_fops);
+}
+
 static void mc_handle_intx(struct irq_desc *desc)
 {
 	struct mc_port *port = irq_desc_get_handler_data(desc);
@@ -1086,6 +1218,8 @@ static int mc_platform_init(struct pci_config_window *cfg)
 	/* Hardware doesn't setup MSI by default */
 	mc_pcie_enable_msi(port, cfg->win);
 
+	mc_pcie_debugfs_init(port);
+
 	writel_relaxed(lower_32_bits(MSI_ADDR),
 		       bridge_base_addr + IMSI_ADDR);
 
@@ -1153,6 +1287,7 @@ static struct platform_driver mc_pcie_driver = {
 		.name = "microchip-pcie",
 		.of_match_table = mc_pcie_of_match,
 		.suppress_bind_attrs = true,
+		.probe_type = PROBE_PREFER_ASYNCHRONOUS,
 	},
 };
 
@@ -0,0 +1,336 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * PolarFire SoC messaging counters PMU
+ *
+ * The IHC, system controller mailbox and rpmsg drivers count their traffic
+ * in per-CPU software counters, and each set is exported as an uncore PMU:
+ *
+ *   perf stat -a -e mpfs_ihc_1/tx_msgs/,mpfs_ihc_1/ack_wait_ns/
+ *
+ * Counting a message is a per-CPU add, so the counters stay on in
+ * production. Events only count, there is nothing to sample.
+ */
+
+#include <linux/cpuhotplug.h>
+#include <linux/cpumask.h>
+#include <linux/device.h>
+#include <linux/module.h>
+#include <linux/percpu.h>
+#include <linux/perf_event.h>
+#include <linux/slab.h>
+#include <soc/microchip/mpfs-msg-pmu.h>
+
+struct mpfs_msg_pmu {
+	struct pmu pmu;
+	u64 __percpu *counters;
+	unsigned int num_events;
+	unsigned int cpu;
+	struct hlist_node node;
+	struct perf_pmu_events_attr *event_attrs;
+	struct attribute **events;
+	struct attribute_group events_group;
+	const struct attribute_group *attr_groups[4];
+};
+
+#define to_mpfs_msg_pmu(p)	container_of(p, struct mpfs_msg_pmu, pmu)
+
+static enum cpuhp_state mpfs_msg_pmu_cpuhp_state;
+
+/**
+ * mpfs_msg_pmu_add() - Count @val occurrences of @event
+ * @pmu:	the PMU, or an error pointer if it could not be registered
+ * @event:	index of the event in the table given at registration
+ * @val:	amount to add
+ *
+ * Callable from any context.
+ */
+void mpfs_msg_pmu_add(struct mpfs_msg_pmu *pmu, unsigned int event, u64 val)
+{
+	if (IS_ERR_OR_NULL(pmu))
+		return;
+
+	this_cpu_add(pmu->counters[event], val);
+}
+EXPORT_SYMBOL_GPL(mpfs_msg_pmu_add);
+
+static u64 mpfs_msg_pmu_sum(struct mpfs_msg_pmu *pmu, unsigned int event)
+{
+	u64 sum = 0;
+	int cpu;
+
+	for_each_possible_cpu(cpu)
+		sum += per_cpu_ptr(pmu->counters, cpu)[event];
+
+	return sum;
+}
+
+static ssize_t mpfs_msg_pmu_cpumask_show(struct device *dev,
+					 struct device_attribute *attr,
+					 char *buf)
+{
+	struct mpfs_msg_pmu *pmu = to_mpfs_msg_pmu(dev_get_drvdata(dev));
+
+	return cpumap_print_to_pagebuf(true, buf, cpumask_of(pmu->cpu));
+}
+
+static struct device_attribute mpfs_msg_pmu_cpumask_attr =
+	__ATTR(cpumask, 0444, mpfs_msg_pmu_cpumask_show, NULL);
+
+static struct attribute *mpfs_msg_pmu_cpumask_attrs[] = {
+	&mpfs_msg_pmu_cpumask_attr.attr,
+	NULL,
+};
+
+static const struct attribute_group mpfs_msg_pmu_cpumask_group = {
+	.attrs = mpfs_msg_pmu_cpumask_attrs,
+};
+
+PMU_FORMAT_ATTR(event, "config:0-7");
+
+static struct attribute *mpfs_msg_pmu_format_attrs[] = {
+	&format_attr_event.attr,
+	NULL,
+};
+
+static const struct attribute_group mpfs_msg_pmu_format_group = {
+	.name = "format",
+	.attrs = mpfs_msg_pmu_format_attrs,
+};
+
+static ssize_t mpfs_msg_pmu_event_show(struct device *dev,
+				       struct device_attribute *attr,
+				       char *page)
+{
+	struct perf_pmu_events_attr *pmu_attr;
+
+	pmu_attr = container_of(attr, struct perf_pmu_events_attr, attr);
+
+	return sprintf(page, "event=0x%02llx\n", pmu_attr->id);
+}
+
+static int mpfs_msg_pmu_event_init(struct perf_event *event)
+{
+	struct mpfs_msg_pmu *pmu = to_mpfs_msg_pmu(event->pmu);
+
+	if (event->attr.type != event->pmu->type)
+		return -ENOENT;
+
+	if (is_sampling_event(event) || event->attach_state & PERF_ATTACH_TASK)
+		return -EOPNOTSUPP;
+
+	if (event->cpu < 0 || event->attr.config >= pmu->num_events)
+		return -EINVAL;
+
+	event->cpu = pmu->cpu;
+
+	return 0;
+}
+
+static void mpfs_msg_pmu_read(struct perf_event *event)
+{
+	struct mpfs_msg_pmu *pmu = to_mpfs_msg_pmu(event->pmu);
+	u64 prev, now;
+
+	now = mpfs_msg_pmu_sum(pmu, event->attr.config);
+	prev = local64_xchg(&event->hw.prev_count, now);
+	local64_add(now - prev, &event->count);
+}
+
+static void mpfs_msg_pmu_start(struct perf_event *event, int flags)
+{
+	struct mpfs_msg_pmu *pmu = to_mpfs_msg_pmu(event->pmu);
+
+	local64_set(&event->hw.prev_count,
+		    mpfs_msg_pmu_sum(pmu, event->attr.config));
+	event->hw.state = 0;
+}
+
+static void mpfs_msg_pmu_stop(struct perf_event *event, int flags)
+{
+	if (event->hw.state & PERF_HES_STOPPED)
+		return;
+
+	mpfs_msg_pmu_read(event);
+	event->hw.state |= PERF_HES_STOPPED | PERF_HES_UPTODATE;
+}
+
+static int mpfs_msg_pmu_add_event(struct perf_event *event, int flags)
+{
+	event->hw.state = PERF_HES_STOPPED | PERF_HES_UPTODATE;
+
+	if (flags & PERF_EF_START)
+		mpfs_msg_pmu_start(event, flags);
+
+	return 0;
+}
+
+static void mpfs_msg_pmu_del_event(struct perf_event *event, int flags)
+{
+	mpfs_msg_pmu_stop(event, PERF_EF_UPDATE);
+}
+
+/* The counters are global, so the events just follow the CPU reading them */
+static int mpfs_msg_pmu_offline_cpu(unsigned int cpu, struct hlist_node *node)
+{
+	struct mpfs_msg_pmu *pmu = hlist_entry_safe(node, struct mpfs_msg_pmu,
+						    node);
+	unsigned int target;
+
+	if (cpu != pmu->cpu)
+		return 0;
+
+	target = cpumask_any_but(cpu_online_mask, cpu);
+	if (target >= nr_cpu_ids)
+		return 0;
+
+	perf_pmu_migrate_context(&pmu->pmu, cpu, target);
+	pmu->cpu = target;
+
+	return 0;
+}
+
+static void mpfs_msg_pmu_unregister(void *data)
+{
+	struct mpfs_msg_pmu *pmu = data;
+
+	perf_pmu_unregister(&pmu->pmu);
+	cpuhp_state_remove_instance_nocalls(mpfs_msg_pmu_cpuhp_state,
+					    &pmu->node);
+	free_percpu(pmu->counters);
+}
+
+static int mpfs_msg_pmu_init_events(struct device *dev,
+				    struct mpfs_msg_pmu *pmu,
+				    const char * const *events)
+{
+	unsigned int i;
+
+	pmu->event_attrs = devm_kcalloc(dev, pmu->num_events,
+					sizeof(*pmu->event_attrs), GFP_KERNEL);
+	pmu->events = devm_kcalloc(dev, pmu->num_events + 1,
+				   sizeof(*pmu->events), GFP_KERNEL);
+	if (!pmu->event_attrs || !pmu->events)
+		return -ENOMEM;
+
+	for (i = 0; i < pmu->num_events; i++) {
+		struct perf_pmu_events_attr *attr = &pmu->event_attrs[i];
+
+		sysfs_attr_init(&attr->attr.attr);
+		attr->attr.attr.name = events[i];
+		attr->attr.attr.mode = 0444;
+		attr->attr.show = mpfs_msg_pmu_event_show;
+		attr->id = i;
+		pmu->events[i] = &attr->attr.attr;
+	}
+
+	pmu->events_group.name = "events";
+	pmu->events_group.attrs = pmu->events;
+
+	pmu->attr_groups[0] = &pmu->events_group;
+	pmu->attr_groups[1] = &mpfs_msg_pmu_format_group;
+	pmu->attr_groups[2] = &mpfs_msg_pmu_cpumask_group;
+
+	return 0;
+}
+
+/**
+ * devm_mpfs_msg_pmu_register() - Export a set of software counters
+ * @dev:	device owning the counters
+ * @name:	PMU name, unique in the system
+ * @events:	event names, the index in this table is the event number
+ * @num_events:	number of events, at most 256
+ *
+ * @name and @events must outlive the device. A driver should go on without
+ * counters if this fails, mpfs_msg_pmu_add() accepts the error pointer.
+ *
+ * Return: the PMU, or an error pointer.
+ */
+struct mpfs_msg_pmu *devm_mpfs_msg_pmu_register(struct device *dev,
+						const char *name,
+						const char * const *events,
+						unsigned int num_events)
+{
+	struct mpfs_msg_pmu *pmu;
+	int ret;
+
+	if (!num_events || num_events > 256)
+		return ERR_PTR(-EINVAL);
+
+	pmu = devm_kzalloc(dev, sizeof(*pmu), GFP_KERNEL);
+	if (!pmu)
+		return ERR_PTR(-ENOMEM);
+
+	pmu->num_events = num_events;
+	ret = mpfs_msg_pmu_init_events(dev, pmu, events);
+	if (ret)
+		return ERR_PTR(ret);
+
+	pmu->counters = __alloc_percpu(num_events * sizeof(u64),
+				       __alignof__(u64));
+	if (!pmu->counters)
+		return ERR_PTR(-ENOMEM);
+
+	pmu->pmu = (struct pmu) {
+		.module		= THIS_MODULE,
+		.capabilities	= PERF_PMU_CAP_NO_EXCLUDE,
+		.task_ctx_nr	= perf_invalid_context,
+		.attr_groups	= pmu->attr_groups,
+		.event_init	= mpfs_msg_pmu_event_init,
+		.add		= mpfs_msg_pmu_add_event,
+		.del		= mpfs_msg_pmu_del_event,
+		.start		= mpfs_msg_pmu_start,
+		.stop		= mpfs_msg_pmu_stop,
+		.read		= mpfs_msg_pmu_read,
+	};
+
+	pmu->cpu = raw_smp_processor_id();
+	ret = cpuhp_state_add_instance_nocalls(mpfs_msg_pmu_cpuhp_state,
+					       &pmu->node);
+	if (ret)
+		goto err_free;
+
+	ret = perf_pmu_register(&pmu->pmu, name, -1);
+	if (ret)
+		goto err_cpuhp;
+
+	ret = devm_add_action_or_reset(dev, mpfs_msg_pmu_unregister, pmu);
+	if (ret)
+		return ERR_PTR(ret);
+
+	return pmu;
+
+err_cpuhp:
+	cpuhp_state_remove_instance_nocalls(mpfs_msg_pmu_cpuhp_state,
+					    &pmu->node);
+err_free:
+	free_percpu(pmu->counters);
+	return ERR_PTR(ret);
+}
+EXPORT_SYMBOL_GPL(devm_mpfs_msg_pmu_register);
+
+static int __init mpfs_msg_pmu_init(void)
+{
+	int ret;
+
+	ret = cpuhp_setup_state_multi(CPUHP_AP_ONLINE_DYN,
+				      "perf/mpfs/msg:online", NULL,
+				      mpfs_msg_pmu_offline_cpu);
+	if (ret < 0)
+		return ret;
+
+	mpfs_msg_pmu_cpuhp_state = ret;
+
+	return 0;
+}
+
+static void __exit mpfs_msg_pmu_exit(void)
+{
+	cpuhp_remove_multi_state(mpfs_msg_pmu_cpuhp_state);
+}
+
+/* before the drivers registering counters, when built in */
+subsys_initcall(mpfs_msg_pmu_init);
+module_exit(mpfs_msg_pmu_exit);
+
+MODULE_LICENSE("GPL v2");
+MODULE_DESCRIPTION("PolarFire SoC messaging counters PMU");
@@ -9,6 +9,7 @@
 #include <linux/err.h>
 #include <linux/io.h>
 #include <linux/module.h>
+#include <linux/mutex.h>
 #include <linux/of.h>
 #include <linux/of_device.h>
 #include <linux/platform_device.h>
@@ -17,7 +18,10 @@
 
 #include <linux/math.h>
 
+#include <soc/microchip/mchp-core-pwm.h>
+
 #define OUTPUT_MAPPED(mapped_outputs, n) (((mapped_outputs) >> (n)) & 0x1)
+#define OUTPUT_SHADOWED(sync_update_mask, n) (((sync_update_mask) >> (n)) & 0x1)
 #define PREG_TO_VAL(PREG_TO_VAL) (PREG_TO_VAL + 1)
 
 #define PRESCALE_REG 	0x00U
@@ -40,7 +44,9 @@ struct mchp_core_pwm_chip {
 	struct clk *clk;
 	void __iomem *base;
 	struct mchp_core_pwm_registers *regs;
+	struct mutex lock; /* protects the registers shared between channels */
 	u16 mapped_outputs;
+	u16 sync_update_mask;
 	u32 tmp_clk_rate;
 };
 
@@ -74,7 +80,7 @@ static void mchp_core_pwm_enable(struct pwm_chip *chip,
 
 static void
 mchp_core_pwm_calculate_duty(struct pwm_chip *chip,
-				 struct pwm_state *desired_state,
+				 const struct pwm_state *desired_state,
 				 struct mchp_core_pwm_registers *regs)
 {
 	struct mchp_core_pwm_chip *mchp_core_pwm = to_mchp_core_pwm_chip(chip);
@@ -143,7 +149,17 @@ mchp_core_pwm_calculate_base(struct pwm_chip *chip,
 	return 0;
 }
 
-static int mchp_core_pwm_apply(struct pwm_chip *chip, struct pwm_device *pwm,
+/*
+ * Channels built with shadow registers only pick up new edges, and the
+ * period, when the sync update register is written. The core then moves
+ * all of them to the live registers together at the end of the period.
+ */
+static void mchp_core_pwm_sync_update(struct mchp_core_pwm_chip *pwm_chip)
+{
+	writel_relaxed(1U, pwm_chip->base + SYNC_UPD_REG);
+}
+
+static int mchp_core_pwm_apply_locked(struct pwm_chip *chip, struct pwm_device *pwm,
 				   const struct pwm_state *desired_state)
 {
 	struct mchp_core_pwm_chip *mchp_core_pwm = to_mchp_core_pwm_chip(chip);
@@ -187,6 +203,9 @@ static int mchp_core_pwm_apply(struct pwm_chip *chip, struct pwm_device *pwm,
 						mchp_core_pwm->regs);
 		}
 
+		if (OUTPUT_SHADOWED(mchp_core_pwm->sync_update_mask, channel))
+			mchp_core_pwm_sync_update(mchp_core_pwm);
+
 		if (mchp_core_pwm->regs->posedge == mchp_core_pwm->regs->negedge) {
 			mchp_core_pwm_enable(chip, pwm, false);
 		} else {
@@ -200,6 +219,151 @@ static int mchp_core_pwm_apply(struct pwm_chip *chip, struct pwm_device *pwm,
 	return 0;
 }
 
+static int mchp_core_pwm_apply(struct pwm_chip *chip, struct pwm_device *pwm,
+				   const struct pwm_state *desired_state)
+{
+	struct mchp_core_pwm_chip *mchp_core_pwm = to_mchp_core_pwm_chip(chip);
+	int ret;
+
+	mutex_lock(&mchp_core_pwm->lock);
+	ret = mchp_core_pwm_apply_locked(chip, pwm, desired_state);
+	mutex_unlock(&mchp_core_pwm->lock);
+
+	return ret;
+}
+
+static const struct pwm_ops mchp_core_pwm_ops;
+
+/**
+ * mchp_core_pwm_apply_multi() - apply new states to several corePWM channels
+ *				 in one period
+ * @pwms: requested PWM devices, all of the same corePWM instance
+ * @states: new state for each entry of @pwms
+ * @num: number of entries in @pwms and @states
+ *
+ * Every channel must have been built with shadow registers, and all enabled
+ * states must share one period, since corePWM has a single period register.
+ * The edges of every channel are written to the shadow bank and committed
+ * with one sync update, so the outputs all switch at the same period
+ * boundary. Channel enables are not shadowed and take effect immediately.
+ *
+ * Can only be called from process context, but does not take the global
+ * PWM lock, so it is cheap enough to be called from a control loop.
+ *
+ * Returns 0 on success or a negative error code on failure.
+ */
+int mchp_core_pwm_apply_multi(struct pwm_device **pwms,
+			      const struct pwm_state *states, unsigned int num)
+{
+	struct mchp_core_pwm_registers regs;
+	struct mchp_core_pwm_chip *mchp_core_pwm;
+	struct pwm_chip *chip;
+	u8 period_steps_r, prescale_r;
+	u64 period = 0;
+	u16 ch_enabled, en;
+	unsigned int i;
+	int ret = 0;
+
+	if (!num || !pwms || !states || !pwms[0])
+		return -EINVAL;
+
+	chip = pwms[0]->chip;
+	if (chip->ops != &mchp_core_pwm_ops)
+		return -EINVAL;
+
+	mchp_core_pwm = to_mchp_core_pwm_chip(chip);
+
+	for (i = 0; i < num; i++) {
+		u8 channel;
+
+		if (!pwms[i] || pwms[i]->chip != chip ||
+		    !test_bit(PWMF_REQUESTED, &pwms[i]->flags))
+			return -EINVAL;
+
+		channel = pwms[i]->hwpwm;
+		if (!OUTPUT_MAPPED(mchp_core_pwm->mapped_outputs, channel) ||
+		    !OUTPUT_SHADOWED(mchp_core_pwm->sync_update_mask, channel)) {
+			dev_dbg(chip->dev, "channel %u can't be synchronised\n",
+				channel);
+			return -EINVAL;
+		}
+
+		if (!states[i].enabled)
+			continue;
+
+		if (!states[i].period ||
+		    states[i].duty_cycle > states[i].period ||
+		    (period && states[i].period != period))
+			return -EINVAL;
+
+		period = states[i].period;
+	}
+
+	mutex_lock(&mchp_core_pwm->lock);
+
+	memset(&regs, 0, sizeof(regs));
+	regs.period_steps = mchp_core_pwm->regs->period_steps;
+	regs.prescale = mchp_core_pwm->regs->prescale;
+
+	if (period) {
+		struct pwm_state period_state = { .period = period };
+
+		ret = mchp_core_pwm_calculate_base(chip, &period_state,
+						   &period_steps_r, &prescale_r);
+		if (ret)
+			goto out;
+
+		regs.period_steps = period_steps_r;
+		regs.prescale = prescale_r;
+	}
+
+	ch_enabled = (u16)(
+		(readl_relaxed(mchp_core_pwm->base + PWM_EN_HIGH) << 8) |
+		readl_relaxed(mchp_core_pwm->base + PWM_EN_LOW));
+	en = ch_enabled;
+
+	for (i = 0; i < num; i++) {
+		u8 channel = pwms[i]->hwpwm;
+
+		if (!states[i].enabled) {
+			en &= ~BIT(channel);
+			continue;
+		}
+
+		mchp_core_pwm_calculate_duty(chip, &states[i], &regs);
+		mchp_core_pwm_apply_duty(channel, mchp_core_pwm, &regs);
+
+		if (regs.posedge == regs.negedge)
+			en &= ~BIT(channel);
+		else
+			en |= BIT(channel);
+	}
+
+	if (regs.period_steps != mchp_core_pwm->regs->period_steps ||
+	    regs.prescale != mchp_core_pwm->regs->prescale) {
+		mchp_core_pwm->regs->period_steps = regs.period_steps;
+		mchp_core_pwm->regs->prescale = regs.prescale;
+		mchp_core_pwm_apply_period(mchp_core_pwm, &regs);
+	}
+
+	/* one commit for every channel touched above */
+	mchp_core_pwm_sync_update(mchp_core_pwm);
+
+	if ((en ^ ch_enabled) & 0xff)
+		writel_relaxed(en & 0xff, mchp_core_pwm->base + PWM_EN_LOW);
+	if ((en ^ ch_enabled) >> 8)
+		writel_relaxed(en >> 8, mchp_core_pwm->base + PWM_EN_HIGH);
+
+	/* keep the core's view in line, as pwm_apply_state() would */
+	for (i = 0; i < num; i++)
+		pwms[i]->state = states[i];
+out:
+	mutex_unlock(&mchp_core_pwm->lock);
+
+	return ret;
+}
+EXPORT_SYMBOL_GPL(mchp_core_pwm_apply_multi);
+
 static void mchp_core_pwm_get_state(struct pwm_chip *chip, struct pwm_device *pwm,
 				struct pwm_state *state)
 {
@@ -285,6 +449,8 @@ static int mchp_core_pwm_probe(struct platform_device *pdev)
 	if (IS_ERR(mchp_pwm->clk))
 		return PTR_ERR(mchp_pwm->clk);
 
+	mutex_init(&mchp_pwm->lock);
+
 	ret = clk_prepare(mchp_pwm->clk);
 	if (ret) {
 		dev_err(&pdev->dev, "failed to prepare PWM clock\n");
@@ -320,6 +486,13 @@ static int mchp_core_pwm_probe(struct platform_device *pdev)
 		return -ENODEV;
 	}
 
+	/* channels without shadow registers update their edges immediately */
+	of_property_read_u16(pdev->dev.of_node, "mchp,sync-update-mask",
+			     &mchp_pwm->sync_update_mask);
+
+	mchp_pwm->regs->prescale = readl_relaxed(mchp_pwm->base + PRESCALE_REG);
+	mchp_pwm->regs->period_steps = readl_relaxed(mchp_pwm->base + PERIOD_REG);
+
 	writel_relaxed(0U, mchp_pwm->base + PWM_EN_LOW);
 	writel_relaxed(0U, mchp_pwm->base + PWM_EN_HIGH);
 
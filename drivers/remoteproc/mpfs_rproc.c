@@ -0,0 +1,397 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * Remote processor driver for the PolarFire SoC AMP context
+ *
+ * The harts of the remote context are owned by the Hart Software Services
+ * (HSS) monitor. Linux loads the firmware ELF into the carveouts described
+ * by the "memory-region" property, then asks the HSS through the Microchip
+ * SBI vendor extension to release those harts at the entry point, or to
+ * hold them in reset again. Virtqueue kicks travel over the IHC mailbox.
+ *
+ * Only the remote context is restarted, so a crashed or updated firmware
+ * can be brought back with the remoteproc recovery path while Linux keeps
+ * running.
+ */
+
+#include <linux/io.h>
+#include <linux/kernel.h>
+#include <linux/mailbox_client.h>
+#include <linux/module.h>
+#include <linux/of_device.h>
+#include <linux/of_reserved_mem.h>
+#include <linux/platform_device.h>
+#include <linux/remoteproc.h>
+#include <linux/workqueue.h>
+#include <linux/mailbox/miv_ihc_message.h>
+#include <asm/sbi.h>
+
+#include "remoteproc_internal.h"
+
+#define SBI_EXT_VENDOR_START			0x09000000
+#define MICROCHIP_TECHNOLOGY_MVENDOR_ID		0x029
+
+#define SBI_EXT_MICROCHIP_TECHNOLOGY	(SBI_EXT_VENDOR_START | \
+					MICROCHIP_TECHNOLOGY_MVENDOR_ID)
+
+/* SBI function IDs, after the IHC (0x0 - 0x4) and TEE (0x10 - 0x11) ones */
+enum {
+	SBI_EXT_RPROC_STATE = 0x20,
+	SBI_EXT_RPROC_START = 0x21,
+	SBI_EXT_RPROC_STOP = 0x22,
+};
+
+/* sbiret.value of SBI_EXT_RPROC_STATE */
+#define MPFS_RPROC_STATE_STOPPED	0
+#define MPFS_RPROC_STATE_RUNNING	1
+
+/* the vq index travels in the upper half of the first IHC word */
+#define MPFS_RPROC_VQID_SHIFT		16
+
+/**
+ * struct mpfs_rproc - PolarFire SoC remote processor state
+ * @dev:	platform device
+ * @rproc:	remoteproc handle
+ * @context_id:	HSS context id of the remote harts
+ * @client:	IHC mailbox client
+ * @chan:	IHC mailbox channel, used both ways
+ * @rx_msg:	last message received over @chan
+ * @vq_work:	delivers received kicks to the virtqueues, in process context
+ */
+struct mpfs_rproc {
+	struct device *dev;
+	struct rproc *rproc;
+	u32 context_id;
+	struct mbox_client client;
+	struct mbox_chan *chan;
+	struct miv_ihc_msg rx_msg;
+	struct work_struct vq_work;
+};
+
+static int mpfs_rproc_sbi_call(unsigned long fid, u32 context_id,
+			       unsigned long arg)
+{
+	struct sbiret ret;
+
+	ret = sbi_ecall(SBI_EXT_MICROCHIP_TECHNOLOGY, fid, context_id, arg,
+			0, 0, 0, 0);
+	if (ret.error)
+		return sbi_err_map_linux_errno(ret.error);
+
+	return ret.value;
+}
+
+static int mpfs_rproc_mem_alloc(struct rproc *rproc,
+				struct rproc_mem_entry *mem)
+{
+	struct device *dev = rproc->dev.parent;
+	void *va;
+
+	dev_dbg(dev, "map memory: %pa+%zx\n", &mem->dma, mem->len);
+	va = ioremap_wc(mem->dma, mem->len);
+	if (!va) {
+		dev_err(dev, "Unable to map memory region: %pa+%zx\n",
+			&mem->dma, mem->len);
+		return -ENOMEM;
+	}
+
+	mem->va = va;
+
+	return 0;
+}
+
+static int mpfs_rproc_mem_release(struct rproc *rproc,
+				  struct rproc_mem_entry *mem)
+{
+	dev_dbg(rproc->dev.parent, "unmap memory: %pa\n", &mem->dma);
+	iounmap(mem->va);
+
+	return 0;
+}
+
+/*
+ * Register the reserved memory regions as carveouts. The remote context
+ * runs from the same physical addresses, so device and physical addresses
+ * are identical. The vring carveouts are found by the core through their
+ * "vdev%dvring%d" names.
+ */
+static int mpfs_rproc_parse_memory_regions(struct rproc *rproc)
+{
+	struct device *dev = rproc->dev.parent;
+	struct device_node *np = dev->of_node;
+	struct of_phandle_iterator it;
+	struct rproc_mem_entry *mem;
+	struct reserved_mem *rmem;
+	int index = 0;
+
+	of_phandle_iterator_init(&it, np, "memory-region", NULL, 0);
+	while (of_phandle_iterator_next(&it) == 0) {
+		rmem = of_reserved_mem_lookup(it.node);
+		if (!rmem) {
+			dev_err(dev, "unable to acquire memory-region\n");
+			return -EINVAL;
+		}
+
+		/* the resource table of a running firmware is mapped at probe */
+		if (!strcmp(it.node->name, "rsc-table")) {
+			index++;
+			continue;
+		}
+
+		if (strcmp(it.node->name, "vdev0buffer")) {
+			mem = rproc_mem_entry_init(dev, NULL,
+						   (dma_addr_t)rmem->base,
+						   rmem->size, rmem->base,
+						   mpfs_rproc_mem_alloc,
+						   mpfs_rproc_mem_release,
+						   it.node->name);
+			if (mem)
+				rproc_coredump_add_segment(rproc, rmem->base,
+							   rmem->size);
+		} else {
+			/* Register reserved memory for vdev buffer alloc */
+			mem = rproc_of_resm_mem_entry_init(dev, index,
+							   rmem->size,
+							   rmem->base,
+							   it.node->name);
+		}
+
+		if (!mem)
+			return -ENOMEM;
+
+		rproc_add_carveout(rproc, mem);
+		index++;
+	}
+
+	return 0;
+}
+
+static int mpfs_rproc_parse_fw(struct rproc *rproc, const struct firmware *fw)
+{
+	int ret = mpfs_rproc_parse_memory_regions(rproc);
+
+	if (ret)
+		return ret;
+
+	/* the vring geometry comes from the firmware's resource table */
+	if (rproc_elf_load_rsc_table(rproc, fw))
+		dev_warn(&rproc->dev, "no resource table found for this firmware\n");
+
+	return 0;
+}
+
+static int mpfs_rproc_start(struct rproc *rproc)
+{
+	struct mpfs_rproc *priv = rproc->priv;
+	int ret;
+
+	ret = mpfs_rproc_sbi_call(SBI_EXT_RPROC_START, priv->context_id,
+				  rproc->bootaddr);
+	if (ret < 0) {
+		dev_err(priv->dev, "failed to start context %u: %d\n",
+			priv->context_id, ret);
+		return ret;
+	}
+
+	return 0;
+}
+
+static int mpfs_rproc_stop(struct rproc *rproc)
+{
+	struct mpfs_rproc *priv = rproc->priv;
+	int ret;
+
+	ret = mpfs_rproc_sbi_call(SBI_EXT_RPROC_STOP, priv->context_id, 0);
+	if (ret < 0) {
+		dev_err(priv->dev, "failed to stop context %u: %d\n",
+			priv->context_id, ret);
+		return ret;
+	}
+
+	return 0;
+}
+
+static int mpfs_rproc_attach(struct rproc *rproc)
+{
+	return 0;
+}
+
+static void mpfs_rproc_kick(struct rproc *rproc, int vqid)
+{
+	struct mpfs_rproc *priv = rproc->priv;
+	struct miv_ihc_msg msg = { 0 };
+	int ret;
+
+	msg.msg[0] = vqid << MPFS_RPROC_VQID_SHIFT;
+
+	ret = mbox_send_message(priv->chan, &msg);
+	if (ret < 0)
+		dev_err(priv->dev, "failed to kick vq%d: %d\n", vqid, ret);
+}
+
+static const struct rproc_ops mpfs_rproc_ops = {
+	.start		= mpfs_rproc_start,
+	.stop		= mpfs_rproc_stop,
+	.attach		= mpfs_rproc_attach,
+	.kick		= mpfs_rproc_kick,
+	.load		= rproc_elf_load_segments,
+	.parse_fw	= mpfs_rproc_parse_fw,
+	.find_loaded_rsc_table = rproc_elf_find_loaded_rsc_table,
+	.sanity_check	= rproc_elf_sanity_check,
+	.get_boot_addr	= rproc_elf_get_boot_addr,
+};
+
+static void mpfs_rproc_vq_work(struct work_struct *work)
+{
+	struct mpfs_rproc *priv = container_of(work, struct mpfs_rproc,
+					       vq_work);
+	u32 vqid = priv->rx_msg.msg[0] >> MPFS_RPROC_VQID_SHIFT;
+
+	if (rproc_vq_interrupt(priv->rproc, vqid) == IRQ_NONE)
+		dev_dbg(priv->dev, "no message found in vq%u\n", vqid);
+}
+
+static void mpfs_rproc_mbox_callback(struct mbox_client *cl, void *data)
+{
+	struct mpfs_rproc *priv = container_of(cl, struct mpfs_rproc, client);
+
+	priv->rx_msg = *(struct miv_ihc_msg *)data;
+	schedule_work(&priv->vq_work);
+}
+
+/*
+ * A firmware started by the HSS at boot is attached to rather than
+ * reloaded. Its resource table must then sit in a "rsc-table" region.
+ */
+static int mpfs_rproc_detect_state(struct rproc *rproc)
+{
+	struct mpfs_rproc *priv = rproc->priv;
+	struct device *dev = priv->dev;
+	struct reserved_mem *rmem = NULL;
+	struct of_phandle_iterator it;
+	int ret;
+
+	ret = mpfs_rproc_sbi_call(SBI_EXT_RPROC_STATE, priv->context_id, 0);
+	if (ret != MPFS_RPROC_STATE_RUNNING)
+		return 0;
+
+	of_phandle_iterator_init(&it, dev->of_node, "memory-region", NULL, 0);
+	while (of_phandle_iterator_next(&it) == 0) {
+		if (!strcmp(it.node->name, "rsc-table")) {
+			rmem = of_reserved_mem_lookup(it.node);
+			of_node_put(it.node);
+			break;
+		}
+	}
+
+	if (!rmem) {
+		dev_warn(dev, "context %u is running without a rsc-table, stopping it\n",
+			 priv->context_id);
+		return mpfs_rproc_stop(rproc);
+	}
+
+	rproc->table_ptr = devm_ioremap_wc(dev, rmem->base, rmem->size);
+	if (!rproc->table_ptr)
+		return -ENOMEM;
+	rproc->table_sz = rmem->size;
+
+	ret = mpfs_rproc_parse_memory_regions(rproc);
+	if (ret)
+		return ret;
+
+	rproc->state = RPROC_DETACHED;
+
+	return 0;
+}
+
+static int mpfs_rproc_probe(struct platform_device *pdev)
+{
+	struct device *dev = &pdev->dev;
+	struct device_node *np = dev->of_node;
+	struct mpfs_rproc *priv;
+	struct rproc *rproc;
+	const char *fw_name = NULL;
+	int ret;
+
+	if (sbi_probe_extension(SBI_EXT_MICROCHIP_TECHNOLOGY) <= 0) {
+		dev_err(dev, "SBI Microchip extension not detected\n");
+		return -ENODEV;
+	}
+
+	of_property_read_string(np, "firmware-name", &fw_name);
+
+	rproc = devm_rproc_alloc(dev, np->name, &mpfs_rproc_ops, fw_name,
+				 sizeof(*priv));
+	if (!rproc)
+		return -ENOMEM;
+
+	priv = rproc->priv;
+	priv->dev = dev;
+	priv->rproc = rproc;
+	INIT_WORK(&priv->vq_work, mpfs_rproc_vq_work);
+
+	ret = of_property_read_u32(np, "microchip,context-id",
+				   &priv->context_id);
+	if (ret) {
+		dev_err(dev, "missing microchip,context-id property\n");
+		return ret;
+	}
+
+	rproc->auto_boot = of_property_read_bool(np, "microchip,auto-boot");
+
+	priv->client.dev = dev;
+	priv->client.rx_callback = mpfs_rproc_mbox_callback;
+	priv->client.tx_block = false;
+	priv->client.knows_txdone = false;
+
+	priv->chan = mbox_request_channel(&priv->client, 0);
+	if (IS_ERR(priv->chan))
+		return dev_err_probe(dev, PTR_ERR(priv->chan),
+				     "failed to request IHC mailbox\n");
+
+	ret = mpfs_rproc_detect_state(rproc);
+	if (ret)
+		goto free_mbox;
+
+	platform_set_drvdata(pdev, rproc);
+
+	ret = rproc_add(rproc);
+	if (ret)
+		goto free_mbox;
+
+	return 0;
+
+free_mbox:
+	mbox_free_channel(priv->chan);
+	return ret;
+}
+
+static int mpfs_rproc_remove(struct platform_device *pdev)
+{
+	struct rproc *rproc = platform_get_drvdata(pdev);
+	struct mpfs_rproc *priv = rproc->priv;
+
+	rproc_del(rproc);
+	cancel_work_sync(&priv->vq_work);
+	mbox_free_channel(priv->chan);
+
+	return 0;
+}
+
+static const struct of_device_id mpfs_rproc_of_match[] = {
+	{ .compatible = "microchip,mpfs-rproc", },
+	{},
+};
+MODULE_DEVICE_TABLE(of, mpfs_rproc_of_match);
+
+static struct platform_driver mpfs_rproc_driver = {
+	.probe = mpfs_rproc_probe,
+	.remove = mpfs_rproc_remove,
+	.driver = {
+		.name = "mpfs-rproc",
+		.of_match_table = mpfs_rproc_of_match,
+	},
+};
+module_platform_driver(mpfs_rproc_driver);
+
+MODULE_DESCRIPTION("PolarFire SoC remote processor driver");
+MODULE_LICENSE("GPL v2");
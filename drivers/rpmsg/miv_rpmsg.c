@@ -15,6 +15,9 @@
 
 #include <linux/err.h>
 #include <linux/kernel.h>
+#include <linux/log2.h>
+#include <linux/miscdevice.h>
+#include <linux/mm.h>
 #include <linux/module.h>
 #include <linux/of_device.h>
 #include <linux/of_address.h>
@@ -28,29 +31,60 @@
 #include <linux/virtio_ids.h>
 #include <linux/virtio_ring.h>
 #include <linux/rpmsg.h>
+#include <linux/rpmsg/virtio_rpmsg.h>
+#include <linux/sizes.h>
 #include <linux/of_reserved_mem.h>
 #include <linux/interrupt.h>
 #include <linux/mailbox/miv_ihc_message.h>
+#include <soc/microchip/mpfs-msg-pmu.h>
+
+#define CREATE_TRACE_POINTS
+#include "miv_rpmsg_trace.h"
 
 #define VIRTIO_RPMSG_F_NS	0 /* RP supports name service notifications */
 
 /*
- * For now, allocate 256 buffers of 512 bytes for each side. each buffer
+ * By default, allocate 256 buffers of 512 bytes for each side. each buffer
  * will then have 16B for the msg header and 496B for the payload.
  * This will require a total space of 256KB for the buffers themselves, and
  * 3 pages for every vring (the size of the vring depends on the number of
  * buffers it supports).
+ *
+ * The geometry can be overridden per instance with the microchip,num-bufs
+ * and microchip,buf-size properties, and is passed on to the rpmsg bus
+ * through the virtio config space.
  */
-#define RPMSG_NUM_BUFS		(512)
-#define RPMSG_BUF_SIZE		(512)
-#define RPMSG_BUFS_SPACE	(RPMSG_NUM_BUFS * RPMSG_BUF_SIZE)
+#define RPMSG_DEFAULT_NUM_BUFS	(512)
+#define RPMSG_DEFAULT_BUF_SIZE	(512)
+#define RPMSG_MAX_NUM_BUFS	(2048)
+#define RPMSG_MAX_BUF_SIZE	(SZ_64K)
 /*
  * The alignment between the consumer and producer parts of the vring.
  */
 #define RPMSG_VRING_ALIGN	(4096)
-/* With 256 buffers, our vring will occupy 3 pages */
-#define RPMSG_RING_SIZE	((DIV_ROUND_UP(vring_size(RPMSG_NUM_BUFS / 2, \
-				RPMSG_VRING_ALIGN), PAGE_SIZE)) * PAGE_SIZE)
+/*
+ * Distance between the two vrings of a vdev expected by the remote side,
+ * grown as needed when the vrings are larger than that.
+ */
+#define RPMSG_VRING_STRIDE	(0x8000)
+
+/* perf events of the miv_rpmsg PMU */
+enum {
+	RPMSG_PMU_KICKS,
+	RPMSG_PMU_KICKS_COALESCED,
+	RPMSG_PMU_KICK_ERRORS,
+	RPMSG_PMU_VRING_FULL,
+	RPMSG_PMU_VQ_INTERRUPTS,
+	RPMSG_PMU_NUM_EVENTS,
+};
+
+static const char * const miv_rpmsg_pmu_events[RPMSG_PMU_NUM_EVENTS] = {
+	[RPMSG_PMU_KICKS]		= "kicks",
+	[RPMSG_PMU_KICKS_COALESCED]	= "kicks_coalesced",
+	[RPMSG_PMU_KICK_ERRORS]		= "kick_errors",
+	[RPMSG_PMU_VRING_FULL]		= "vring_full",
+	[RPMSG_PMU_VQ_INTERRUPTS]	= "vq_interrupts",
+};
 
 struct miv_virdev {
 	struct virtio_device vdev;
@@ -66,14 +100,24 @@ struct miv_rpmsg_vproc {
 	char *rproc_name;
 	struct mutex lock;
 	int vdev_nums;
-#define MAX_VDEV_NUMS	1
+#define MAX_VDEV_NUMS	4
 	struct miv_virdev ivdev[MAX_VDEV_NUMS];
+	unsigned int num_bufs;
+	unsigned int buf_size;
+	unsigned int ring_size;
+	phys_addr_t shm_phys;
+	resource_size_t shm_size;
+	struct miscdevice shm_misc;
 	struct work_struct rpmsg_work;
 	struct blocking_notifier_head notifier;
 	struct miv_ihc_msg miv_ihc_message;
 	struct completion c;
+	spinlock_t kick_lock;
 	struct mbox_client mbox_client;
+	u64 ring_features;
+	struct mpfs_msg_pmu *pmu;
 	bool initialized;
+	bool async_kick;
 };
 
 #define to_miv_virdev(vd) container_of(vd, struct miv_virdev, vdev)
@@ -84,6 +128,10 @@ struct miv_rpmsg_vq_info {
 	void *addr;	/* address where we mapped the virtio ring */
 	struct miv_rpmsg_vproc *rpdev;
 	struct miv_virdev *virdev;
+	/* async kick state, protected by rpdev->kick_lock */
+	struct miv_ihc_msg kick_msg;
+	bool kick_inflight;
+	bool kick_pending;
 };
 
 static struct miv_rpmsg_vproc miv_rpmsg_vproc[] = {
@@ -92,6 +140,41 @@ static struct miv_rpmsg_vproc miv_rpmsg_vproc[] = {
 	},
 };
 
+/*
+ * Queue a kick without waiting for the remote ACK. Only one kick per vq is
+ * handed to the mailbox at a time; any kick requested while it is in flight
+ * is coalesced and re-sent once from tx_done_callback().
+ */
+static bool miv_rpmsg_kick_async(struct miv_rpmsg_vq_info *rpvq,
+				 struct mbox_chan *mbox_chan)
+{
+	struct miv_rpmsg_vproc *rpdev = rpvq->rpdev;
+	unsigned long flags;
+	int ret = 0;
+
+	spin_lock_irqsave(&rpdev->kick_lock, flags);
+
+	trace_vq_kick(rpvq->vq_id, true, rpvq->kick_inflight);
+
+	if (rpvq->kick_inflight) {
+		rpvq->kick_pending = true;
+		mpfs_msg_pmu_add(rpdev->pmu, RPMSG_PMU_KICKS_COALESCED, 1);
+	} else {
+		rpvq->kick_inflight = true;
+		ret = mbox_send_message(mbox_chan, &rpvq->kick_msg);
+		if (ret < 0) {
+			rpvq->kick_inflight = false;
+			mpfs_msg_pmu_add(rpdev->pmu, RPMSG_PMU_KICK_ERRORS, 1);
+		} else {
+			mpfs_msg_pmu_add(rpdev->pmu, RPMSG_PMU_KICKS, 1);
+		}
+	}
+
+	spin_unlock_irqrestore(&rpdev->kick_lock, flags);
+
+	return ret >= 0;
+}
+
 /* kick the remote processor, and let it know which virtqueue to poke at */
 static bool miv_rpmsg_notify(struct virtqueue *vq)
 {
@@ -124,7 +207,15 @@ static bool miv_rpmsg_notify(struct virtqueue *vq)
 		}
 	}
 
+	/* the kick hands over the last free descriptors of the ring */
+	if (!vq->num_free)
+		mpfs_msg_pmu_add(rpvq->rpdev->pmu, RPMSG_PMU_VRING_FULL, 1);
+
+	if (rpvq->rpdev->async_kick)
+		return miv_rpmsg_kick_async(rpvq, mbox_chan);
+
 	mbox_msg.msg[0] = rpvq->vq_id << 16;
+	trace_vq_kick(rpvq->vq_id, false, false);
 
 	/* send the index of the triggered virtqueue as the payload */
 	mutex_lock(&rpvq->rpdev->lock);
@@ -132,8 +223,12 @@ static bool miv_rpmsg_notify(struct virtqueue *vq)
 	ret = mbox_send_message(mbox_chan, &mbox_msg);
 
 	/* mbox_send_message returns non-negative value on success*/
-	if (ret >= 0)
+	if (ret >= 0) {
+		mpfs_msg_pmu_add(rpvq->rpdev->pmu, RPMSG_PMU_KICKS, 1);
 		wait_for_completion(&rpvq->rpdev->c);
+	} else {
+		mpfs_msg_pmu_add(rpvq->rpdev->pmu, RPMSG_PMU_KICK_ERRORS, 1);
+	}
 
 	mutex_unlock(&rpvq->rpdev->lock);
 
@@ -150,6 +245,8 @@ static int miv_rpmsg_callback(struct notifier_block *this,
 	virdev = container_of(this, struct miv_virdev, nb);
 	vdev = &virdev->vdev;
 
+	trace_vq_interrupt(msg, msg >> 16);
+
 	/* ignore vq indices which are clearly not for us */
 	msg = msg >> 16;
 	if (msg < virdev->base_vq_id || msg > virdev->base_vq_id + 1) {
@@ -157,6 +254,8 @@ static int miv_rpmsg_callback(struct notifier_block *this,
 		return NOTIFY_DONE;
 	}
 	msg -= virdev->base_vq_id;
+	mpfs_msg_pmu_add(to_miv_rpdev(virdev, virdev->base_vq_id / 2)->pmu,
+			 RPMSG_PMU_VQ_INTERRUPTS, 1);
 
 	/*
 	 * At this point, 'msg' contains the index of the
@@ -186,31 +285,45 @@ static int set_vring_phy_buf(struct platform_device *pdev,
 			     struct miv_rpmsg_vproc *rpdev, int vdev_nums)
 {
 	struct resource *res;
-	resource_size_t size;
-	unsigned int start, end;
-	int i, ret = 0;
+	resource_size_t size, stride;
+	phys_addr_t start, end;
+	int i;
 
 	res = platform_get_resource(pdev, IORESOURCE_MEM, 0);
-	if (res) {
-		size = resource_size(res);
-		start = res->start;
-		end = res->start + size;
-		for (i = 0; i < vdev_nums; i++) {
-			rpdev->ivdev[i].vring[0] = start;
-			rpdev->ivdev[i].vring[1] = start +
-						   0x8000;
-			start = 0x10000;
-			if (start > end) {
-				dev_err(&pdev->dev, "Too small memory size %x!\n",
-						(u32)size);
-				ret = -EINVAL;
-				break;
-			}
-		}
-	} else {
+	if (!res)
 		return -ENOMEM;
+
+	size = resource_size(res);
+	if (rpdev->shm_size >= size) {
+		dev_err(&pdev->dev, "shm pool larger than memory size %x!\n",
+			(u32)size);
+		return -EINVAL;
 	}
-	return ret;
+
+	start = res->start;
+	/* the shared memory pool, if any, takes the top of the region */
+	end = res->start + size - rpdev->shm_size;
+	if (rpdev->shm_size && !PAGE_ALIGNED(end)) {
+		dev_err(&pdev->dev, "shm pool at %pa is not page aligned\n",
+			&end);
+		return -EINVAL;
+	}
+	rpdev->shm_phys = end;
+	stride = max_t(resource_size_t, RPMSG_VRING_STRIDE, rpdev->ring_size);
+
+	for (i = 0; i < vdev_nums; i++) {
+		if (start + 2 * stride > end) {
+			dev_err(&pdev->dev, "Too small memory size %x for %d vdevs!\n",
+				(u32)size, vdev_nums);
+			return -EINVAL;
+		}
+
+		rpdev->ivdev[i].vring[0] = start;
+		rpdev->ivdev[i].vring[1] = start + stride;
+		start += 2 * stride;
+	}
+
+	return 0;
 }
 
 static struct virtqueue *rp_find_vq(struct virtio_device *vdev,
@@ -230,14 +343,14 @@ static struct virtqueue *rp_find_vq(struct virtio_device *vdev,
 		return ERR_PTR(-ENOMEM);
 
 	rpvq->addr = (__force void *) ioremap(virdev->vring[index],
-							RPMSG_RING_SIZE);
+							rpdev->ring_size);
 	if (!rpvq->addr) {
 		err = -ENOMEM;
 		goto free_rpvq;
 	}
-	memset_io(rpvq->addr, 0, RPMSG_RING_SIZE);
+	memset_io(rpvq->addr, 0, rpdev->ring_size);
 
-	vq = vring_new_virtqueue(index, RPMSG_NUM_BUFS / 2, RPMSG_VRING_ALIGN,
+	vq = vring_new_virtqueue(index, rpdev->num_bufs / 2, RPMSG_VRING_ALIGN,
 				 vdev, false, ctx, rpvq->addr, miv_rpmsg_notify,
 				 callback, name);
 	if (!vq) {
@@ -251,6 +364,10 @@ static struct virtqueue *rp_find_vq(struct virtio_device *vdev,
 	rpvq->index = index;
 	rpvq->vq_id = virdev->base_vq_id + index;
 	rpvq->rpdev = rpdev;
+	memset(&rpvq->kick_msg, 0, sizeof(rpvq->kick_msg));
+	rpvq->kick_msg.msg[0] = rpvq->vq_id << 16;
+	rpvq->kick_inflight = false;
+	rpvq->kick_pending = false;
 	mutex_init(&rpdev->lock);
 	return vq;
 unmap_vring:
@@ -327,7 +444,32 @@ static int miv_rpmsg_find_vqs(struct virtio_device *vdev, unsigned int nvqs,
 
 static u64 miv_rpmsg_get_features(struct virtio_device *vdev)
 {
-	return 1 << VIRTIO_RPMSG_F_NS;
+	struct miv_virdev *virdev = to_miv_virdev(vdev);
+	struct miv_rpmsg_vproc *rpdev = to_miv_rpdev(virdev,
+						     virdev->base_vq_id / 2);
+
+	return 1 << VIRTIO_RPMSG_F_NS | 1 << VIRTIO_RPMSG_F_BUFSZ |
+	       rpdev->ring_features;
+}
+
+static void miv_rpmsg_get(struct virtio_device *vdev, unsigned int offset,
+			  void *buf, unsigned int len)
+{
+	struct miv_virdev *virdev = to_miv_virdev(vdev);
+	struct miv_rpmsg_vproc *rpdev = to_miv_rpdev(virdev,
+						     virdev->base_vq_id / 2);
+	struct virtio_rpmsg_config config;
+
+	if (offset + len > sizeof(config) || offset + len < len) {
+		dev_err(&vdev->dev, "invalid config access %u + %u\n",
+			offset, len);
+		return;
+	}
+
+	config.num_bufs = cpu_to_virtio32(vdev, rpdev->num_bufs);
+	config.buf_size = cpu_to_virtio32(vdev, rpdev->buf_size);
+
+	memcpy(buf, (u8 *)&config + offset, len);
 }
 
 static void miv_rpmsg_vproc_release(struct device *dev)
@@ -359,6 +501,7 @@ static void miv_rpmsg_set_status(struct virtio_device *vdev, u8 status)
 
 static struct virtio_config_ops miv_rpmsg_config_ops = {
 	.get_features	= miv_rpmsg_get_features,
+	.get		= miv_rpmsg_get,
 	.finalize_features = miv_rpmsg_finalize_features,
 	.find_vqs	= miv_rpmsg_find_vqs,
 	.del_vqs	= miv_rpmsg_del_vqs,
@@ -376,6 +519,19 @@ static void miv_mbox_rx_callback(struct mbox_client *cl, void *mssg)
 	if (WARN_ON(!rpmsg_vproc))
 		return;
 
+	/*
+	 * When the mailbox delivers in task context (e.g. the IHC polling
+	 * mode) and there is a single vdev, skip the workqueue and notifier
+	 * chain and kick the vring straight away.
+	 */
+	if (rpmsg_vproc->vdev_nums == 1 && in_task()) {
+		u32 vqid = ((struct miv_ihc_msg *)mssg)->msg[0];
+
+		miv_rpmsg_callback(&rpmsg_vproc->ivdev[0].nb, 0,
+				   (void *)(phys_addr_t)vqid);
+		return;
+	}
+
 	rpmsg_vproc->miv_ihc_message = *(struct miv_ihc_msg *) mssg;
 
 	schedule_work(&(rpmsg_vproc->rpmsg_work));
@@ -385,8 +541,138 @@ static void tx_done_callback(struct mbox_client *cl, void *mssg, int r)
 {
 	struct miv_rpmsg_vproc *rpmsg_vproc = container_of(cl,
 	struct miv_rpmsg_vproc, mbox_client);
+	struct miv_rpmsg_vq_info *rpvq;
+	unsigned long flags;
 
-	complete(&rpmsg_vproc->c);
+	if (!rpmsg_vproc->async_kick) {
+		complete(&rpmsg_vproc->c);
+		return;
+	}
+
+	rpvq = container_of(mssg, struct miv_rpmsg_vq_info, kick_msg);
+
+	spin_lock_irqsave(&rpmsg_vproc->kick_lock, flags);
+
+	if (rpvq->kick_pending) {
+		rpvq->kick_pending = false;
+		if (mbox_send_message(rpvq->virdev->mbox, &rpvq->kick_msg) >= 0)
+			goto out;
+	}
+
+	rpvq->kick_inflight = false;
+out:
+	spin_unlock_irqrestore(&rpmsg_vproc->kick_lock, flags);
+}
+
+static int miv_rpmsg_parse_geometry(struct device *dev,
+				    struct miv_rpmsg_vproc *rpdev)
+{
+	struct device_node *np = dev->of_node;
+	u32 val;
+
+	if (of_property_read_u32(np, "microchip,num-vdevs", &val))
+		val = 1;
+	if (!val || val > MAX_VDEV_NUMS) {
+		dev_err(dev, "unsupported number of vdevs %u\n", val);
+		return -EINVAL;
+	}
+	rpdev->vdev_nums = val;
+
+	if (of_property_read_u32(np, "microchip,num-bufs", &val))
+		val = RPMSG_DEFAULT_NUM_BUFS;
+	if (val < 2 || val > RPMSG_MAX_NUM_BUFS || !is_power_of_2(val)) {
+		dev_err(dev, "unsupported number of buffers %u\n", val);
+		return -EINVAL;
+	}
+	rpdev->num_bufs = val;
+
+	if (of_property_read_u32(np, "microchip,buf-size", &val))
+		val = RPMSG_DEFAULT_BUF_SIZE;
+	if (val < RPMSG_DEFAULT_BUF_SIZE || val > RPMSG_MAX_BUF_SIZE) {
+		dev_err(dev, "unsupported buffer size %u\n", val);
+		return -EINVAL;
+	}
+	rpdev->buf_size = val;
+
+	/* always room for the split layout, which is the larger one */
+	rpdev->ring_size = PAGE_ALIGN(vring_size(rpdev->num_bufs / 2,
+						 RPMSG_VRING_ALIGN));
+
+	if (of_property_read_u32(np, "microchip,shm-size", &val))
+		val = 0;
+	if (!PAGE_ALIGNED(val)) {
+		dev_err(dev, "shm pool size %u is not page aligned\n", val);
+		return -EINVAL;
+	}
+	rpdev->shm_size = val;
+
+	return 0;
+}
+
+/*
+ * Zero-copy bulk pool: the top "microchip,shm-size" bytes of the vring region
+ * are exported as /dev/miv_rpmsg_shm. Userspace maps it and exchanges only
+ * offset/length descriptors with the remote side over a regular rpmsg
+ * endpoint (e.g. through rpmsg_char), so payloads are never copied.
+ */
+static int miv_rpmsg_shm_mmap(struct file *filp, struct vm_area_struct *vma)
+{
+	struct miv_rpmsg_vproc *rpdev = container_of(filp->private_data,
+						     struct miv_rpmsg_vproc,
+						     shm_misc);
+
+	/* same attributes as the ioremap()ed vrings */
+	vma->vm_page_prot = pgprot_noncached(vma->vm_page_prot);
+
+	return vm_iomap_memory(vma, rpdev->shm_phys, rpdev->shm_size);
+}
+
+static const struct file_operations miv_rpmsg_shm_fops = {
+	.owner		= THIS_MODULE,
+	.mmap		= miv_rpmsg_shm_mmap,
+	.llseek		= noop_llseek,
+};
+
+static ssize_t shm_size_show(struct device *dev,
+			     struct device_attribute *attr, char *buf)
+{
+	struct miscdevice *misc = dev_get_drvdata(dev);
+	struct miv_rpmsg_vproc *rpdev = container_of(misc,
+						     struct miv_rpmsg_vproc,
+						     shm_misc);
+
+	return sprintf(buf, "%llu\n", (unsigned long long)rpdev->shm_size);
+}
+static DEVICE_ATTR_RO(shm_size);
+
+static struct attribute *miv_rpmsg_shm_attrs[] = {
+	&dev_attr_shm_size.attr,
+	NULL,
+};
+ATTRIBUTE_GROUPS(miv_rpmsg_shm);
+
+static int miv_rpmsg_shm_register(struct device *dev,
+				  struct miv_rpmsg_vproc *rpdev)
+{
+	if (!rpdev->shm_size)
+		return 0;
+
+	rpdev->shm_misc.minor = MISC_DYNAMIC_MINOR;
+	rpdev->shm_misc.name = "miv_rpmsg_shm";
+	rpdev->shm_misc.fops = &miv_rpmsg_shm_fops;
+	rpdev->shm_misc.parent = dev;
+	rpdev->shm_misc.groups = miv_rpmsg_shm_groups;
+
+	dev_info(dev, "shm pool at %pa, %llu bytes\n", &rpdev->shm_phys,
+		 (unsigned long long)rpdev->shm_size);
+
+	return misc_register(&rpdev->shm_misc);
+}
+
+static void miv_rpmsg_shm_unregister(struct miv_rpmsg_vproc *rpdev)
+{
+	if (rpdev->shm_size)
+		misc_deregister(&rpdev->shm_misc);
 }
 
 static int miv_rpmsg_probe(struct platform_device *pdev)
@@ -401,7 +687,23 @@ static int miv_rpmsg_probe(struct platform_device *pdev)
 
 	rpdev = &miv_rpmsg_vproc[0];
 
-	rpdev->vdev_nums = 1;
+	ret = miv_rpmsg_parse_geometry(dev, rpdev);
+	if (ret)
+		return ret;
+	rpdev->async_kick = of_property_read_bool(np, "microchip,async-kick");
+
+	/*
+	 * Ring features the RPMsg-lite remote is built with. A packed ring
+	 * keeps descriptor and flag updates in the same cache line, event
+	 * indices let either side skip notifications, and with them IHC
+	 * ecalls, while the other one is still working through the ring.
+	 * A packed ring has its device event area on the RPMSG_VRING_ALIGN
+	 * boundary after the descriptors, see vring_packed_size().
+	 */
+	if (of_property_read_bool(np, "microchip,packed-ring"))
+		rpdev->ring_features |= BIT_ULL(VIRTIO_F_RING_PACKED);
+	if (of_property_read_bool(np, "microchip,event-idx"))
+		rpdev->ring_features |= BIT_ULL(VIRTIO_RING_F_EVENT_IDX);
 
 	num_channels = of_count_phandle_with_args(np, "mboxes", "#mbox-cells");
 	if (num_channels < 0) {
@@ -416,35 +718,52 @@ static int miv_rpmsg_probe(struct platform_device *pdev)
 	rpdev->mbox_client.tx_tout = 0;
 	rpdev->mbox_client.knows_txdone = false;
 
+	rpdev->pmu = devm_mpfs_msg_pmu_register(dev, "miv_rpmsg",
+						miv_rpmsg_pmu_events,
+						RPMSG_PMU_NUM_EVENTS);
+	if (IS_ERR(rpdev->pmu))
+		dev_dbg(dev, "no perf counters\n");
+
 	init_completion(&rpdev->c);
+	spin_lock_init(&rpdev->kick_lock);
 	BLOCKING_INIT_NOTIFIER_HEAD(&(rpdev->notifier));
 	INIT_WORK(&(rpdev->rpmsg_work), rpmsg_work_handler);
 
-	for (i = 0; i < num_channels; i++) {
+	for (i = 0; i < num_channels && i < rpdev->vdev_nums; i++) {
 		rpdev->ivdev[i].mbox =
 			mbox_request_channel(&rpdev->mbox_client, i);
 
-		if (IS_ERR(rpdev->ivdev[i].mbox)) {
-			dev_warn(&pdev->dev,
-				 "Failed to request mbox channel\n");
-			return PTR_ERR(rpdev->ivdev[i].mbox);
-		}
+		if (IS_ERR(rpdev->ivdev[i].mbox))
+			return dev_err_probe(&pdev->dev,
+					     PTR_ERR(rpdev->ivdev[i].mbox),
+					     "Failed to request mbox channel\n");
 	}
 
+	/* vdevs without a dedicated channel share the first one */
+	for (; i < rpdev->vdev_nums; i++)
+		rpdev->ivdev[i].mbox = rpdev->ivdev[0].mbox;
+
 	ret = set_vring_phy_buf(pdev, rpdev, rpdev->vdev_nums);
 	if (ret) {
 		dev_err(dev, "No vring buffer.\n");
 		return -ENOMEM;
 	}
 
+	ret = miv_rpmsg_shm_register(dev, rpdev);
+	if (ret) {
+		dev_err(dev, "failed to register shm pool: %d\n", ret);
+		return ret;
+	}
+
 	ret = of_reserved_mem_device_init(dev);
 	if (ret)
 		dev_err(&pdev->dev, "init reserved memory failed\n");
 
 	for (i = 0; i < rpdev->vdev_nums; i++) {
-		dev_info(&pdev->dev, "%s vdev%d: vring0 0x%x, vring1 0x%x\n",
-			 __func__, rpdev->vdev_nums, rpdev->ivdev[i].vring[0],
-			 rpdev->ivdev[i].vring[1]);
+		dev_info(&pdev->dev, "%s vdev%d: vring0 0x%x, vring1 0x%x, %u x %u bytes\n",
+			 __func__, i, rpdev->ivdev[i].vring[0],
+			 rpdev->ivdev[i].vring[1], rpdev->num_bufs,
+			 rpdev->buf_size);
 		rpdev->ivdev[i].vdev.id.device = VIRTIO_ID_RPMSG;
 		rpdev->ivdev[i].vdev.config = &miv_rpmsg_config_ops;
 		rpdev->ivdev[i].vdev.dev.parent = &pdev->dev;
@@ -455,6 +774,7 @@ static int miv_rpmsg_probe(struct platform_device *pdev)
 		if (ret) {
 			dev_err(dev, "%s failed to register rpdev: %d\n",
 				__func__, ret);
+			miv_rpmsg_shm_unregister(rpdev);
 			return ret;
 		}
 	}
@@ -471,7 +791,8 @@ MODULE_DEVICE_TABLE(of, miv_rpmsg_of_match);
 static struct platform_driver miv_rpmsg_driver = {
 	.driver = {
 		.name = "miv_rpmsg",
-		.of_match_table = miv_rpmsg_of_match
+		.of_match_table = miv_rpmsg_of_match,
+		.probe_type = PROBE_PREFER_ASYNCHRONOUS,
 	},
 	.probe = miv_rpmsg_probe,
 };
@@ -0,0 +1,72 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+/*
+ * Mi-V RPMSG tracepoints
+ *
+ * vq_interrupt fires once the IHC message naming a virtqueue reached it
+ * through the notifier work, so the ihc_rx to vq_interrupt distance is the
+ * receive dispatch latency:
+ *
+ *   echo 'vq_dispatch u32 msg; u64 lat' >> synthetic_events
+ *   echo 'hist:keys=msg:ts0=common_timestamp.usecs if irq_type == 0' >> \
+ *	events/miv_ihc/ihc_rx/trigger
+ *   echo 'hist:keys=msg:lat=common_timestamp.usecs-$ts0:onmatch(miv_ihc.ihc_rx).trace(vq_dispatch,msg,$lat)' >> \
+ *	events/miv_rpmsg/vq_interrupt/trigger
+ *   echo 'hist:keys=lat.log2' >> events/synthetic/vq_dispatch/trigger
+ */
+#undef TRACE_SYSTEM
+#define TRACE_SYSTEM miv_rpmsg
+
+#if !defined(_MIV_RPMSG_TRACE_H_) || defined(TRACE_HEADER_MULTI_READ)
+#define _MIV_RPMSG_TRACE_H_
+
+#include <linux/tracepoint.h>
+
+TRACE_EVENT(vq_kick,
+
+	TP_PROTO(u16 vq_id, bool async, bool coalesced),
+
+	TP_ARGS(vq_id, async, coalesced),
+
+	TP_STRUCT__entry(
+		__field(u16, vq_id)
+		__field(bool, async)
+		__field(bool, coalesced)
+	),
+
+	TP_fast_assign(
+		__entry->vq_id = vq_id;
+		__entry->async = async;
+		__entry->coalesced = coalesced;
+	),
+
+	TP_printk("vq=%u%s%s", __entry->vq_id,
+		  __entry->async ? " async" : "",
+		  __entry->coalesced ? " coalesced" : "")
+);
+
+TRACE_EVENT(vq_interrupt,
+
+	TP_PROTO(u32 msg, u16 vq_id),
+
+	TP_ARGS(msg, vq_id),
+
+	TP_STRUCT__entry(
+		__field(u32, msg)
+		__field(u16, vq_id)
+	),
+
+	TP_fast_assign(
+		__entry->msg = msg;
+		__entry->vq_id = vq_id;
+	),
+
+	TP_printk("msg=0x%08x vq=%u", __entry->msg, __entry->vq_id)
+);
+
+#endif /* _MIV_RPMSG_TRACE_H_ */
+
+#undef TRACE_INCLUDE_PATH
+#define TRACE_INCLUDE_PATH .
+#undef TRACE_INCLUDE_FILE
+#define TRACE_INCLUDE_FILE miv_rpmsg_trace
+#include <trace/define_trace.h>
@@ -18,26 +18,53 @@
 #include <linux/slab.h>
 #include <linux/delay.h>
 #include <linux/kernel.h>
+#include <linux/kfifo.h>
 #include <linux/module.h>
 #include <linux/rpmsg.h>
+#include <linux/sizes.h>
 #include <linux/tty.h>
 #include <linux/tty_driver.h>
 #include <linux/tty_flip.h>
 #include <linux/virtio.h>
+#include <linux/workqueue.h>
 
-/* this needs to be less then (RPMSG_BUF_SIZE - sizeof(struct rpmsg_hdr)) */
+/*
+ * Message size used when the transport can't report its MTU. This needs
+ * to be less then (RPMSG_BUF_SIZE - sizeof(struct rpmsg_hdr))
+ */
 #define RPMSG_MAX_SIZE		256
 #define MSG		"hello world!"
 
+/* Writes are buffered here and sent to the remote in full-sized messages */
+#define RPMSGTTY_TX_FIFO_SIZE	SZ_16K
+/* Messages handed to the transport, and kicked, in one go */
+#define RPMSGTTY_TX_BATCH	8
+/* Back-off before retrying a flush the transport refused */
+#define RPMSGTTY_TX_RETRY_MS	10
+
 /*
  * struct rpmsgtty_port - Wrapper struct for rpmsg tty port.
  * @port:		TTY port data
+ * @tx_lock:		protects @tx_fifo
+ * @tx_fifo:		data written to the tty and not yet sent
+ * @tx_work:		flushes @tx_fifo to the remote processor
+ * @tx_buf:		bounce buffer for RPMSGTTY_TX_BATCH messages
+ * @tx_len:		bytes taken out of @tx_fifo into @tx_buf
+ * @tx_off:		bytes of @tx_buf already sent
+ * @mtu:		payload size of one message
  */
 struct rpmsgtty_port {
 	struct tty_port		port;
 	spinlock_t		rx_lock;
 	struct rpmsg_device	*rpdev;
 	struct tty_driver	*rpmsgtty_driver;
+	spinlock_t		tx_lock;
+	DECLARE_KFIFO(tx_fifo, unsigned char, RPMSGTTY_TX_FIFO_SIZE);
+	struct delayed_work	tx_work;
+	unsigned char		*tx_buf;
+	unsigned int		tx_len;
+	unsigned int		tx_off;
+	unsigned int		mtu;
 };
 
 static int rpmsg_tty_cb(struct rpmsg_device *rpdev, void *data, int len,
@@ -90,46 +117,119 @@ static void rpmsgtty_close(struct tty_struct *tty, struct file *filp)
 	return tty_port_close(tty->port, tty, filp);
 }
 
+/*
+ * Drain the TX FIFO in messages of up to one MTU, RPMSGTTY_TX_BATCH of them
+ * per kick. Whatever the transport doesn't take stays in @tx_buf and goes
+ * out first on the next run.
+ */
+static void rpmsgtty_tx_work(struct work_struct *work)
+{
+	struct rpmsgtty_port *cport = container_of(to_delayed_work(work),
+			struct rpmsgtty_port, tx_work);
+	struct rpmsg_batch_entry msgs[RPMSGTTY_TX_BATCH];
+	struct rpmsg_device *rpdev = cport->rpdev;
+	unsigned int i;
+	int n, ret;
+
+	for (;;) {
+		if (cport->tx_off == cport->tx_len) {
+			spin_lock_bh(&cport->tx_lock);
+			cport->tx_len = kfifo_out(&cport->tx_fifo, cport->tx_buf,
+						  RPMSGTTY_TX_BATCH * cport->mtu);
+			spin_unlock_bh(&cport->tx_lock);
+			cport->tx_off = 0;
+			if (!cport->tx_len)
+				break;
+
+			/* room was made, let blocked writers in */
+			tty_port_tty_wakeup(&cport->port);
+		}
+
+		for (n = 0, i = cport->tx_off; i < cport->tx_len;
+		     n++, i += cport->mtu) {
+			msgs[n].data = cport->tx_buf + i;
+			msgs[n].len = min(cport->mtu, cport->tx_len - i);
+		}
+
+		ret = rpmsg_send_batch(rpdev->ept, msgs, n);
+		if (ret < 0) {
+			dev_err(&rpdev->dev, "rpmsg_send failed: %d\n", ret);
+			schedule_delayed_work(&cport->tx_work,
+					      msecs_to_jiffies(RPMSGTTY_TX_RETRY_MS));
+			break;
+		}
+
+		for (i = 0; i < ret; i++)
+			cport->tx_off += msgs[i].len;
+	}
+}
+
 static int rpmsgtty_write(struct tty_struct *tty, const unsigned char *buf,
 			 int total)
 {
-	int count, ret = 0;
-	const unsigned char *tbuf;
 	struct rpmsgtty_port *rptty_port = container_of(tty->port,
 			struct rpmsgtty_port, port);
 	struct rpmsg_device *rpdev = rptty_port->rpdev;
+	int count;
 
 	if (buf == NULL) {
 		dev_err(&rpdev->dev, "buf shouldn't be null.\n");
 		return -ENOMEM;
 	}
 
-	count = total;
-	tbuf = buf;
-	do {
-		/* send a message to our remote processor */
-		ret = rpmsg_send(rpdev->ept, (void *)tbuf,
-			count > RPMSG_MAX_SIZE ? RPMSG_MAX_SIZE : count);
-		if (ret) {
-			dev_err(&rpdev->dev, "rpmsg_send failed: %d\n", ret);
-			return ret;
-		}
+	/* accept what fits, the tty layer retries the rest after a wakeup */
+	spin_lock_bh(&rptty_port->tx_lock);
+	count = kfifo_in(&rptty_port->tx_fifo, buf, total);
+	spin_unlock_bh(&rptty_port->tx_lock);
 
-		if (count > RPMSG_MAX_SIZE) {
-			count -= RPMSG_MAX_SIZE;
-			tbuf += RPMSG_MAX_SIZE;
-		} else {
-			count = 0;
-		}
-	} while (count > 0);
+	if (count)
+		schedule_delayed_work(&rptty_port->tx_work, 0);
 
-	return total;
+	return count;
 }
 
 static int rpmsgtty_write_room(struct tty_struct *tty)
 {
-	/* report the space in the rpmsg buffer */
-	return RPMSG_MAX_SIZE;
+	struct rpmsgtty_port *rptty_port = container_of(tty->port,
+			struct rpmsgtty_port, port);
+	int room;
+
+	/* the FIFO only drains as fast as the remote frees rpmsg buffers */
+	spin_lock_bh(&rptty_port->tx_lock);
+	room = kfifo_avail(&rptty_port->tx_fifo);
+	spin_unlock_bh(&rptty_port->tx_lock);
+
+	return room;
+}
+
+static int rpmsgtty_chars_in_buffer(struct tty_struct *tty)
+{
+	struct rpmsgtty_port *rptty_port = container_of(tty->port,
+			struct rpmsgtty_port, port);
+	int len;
+
+	spin_lock_bh(&rptty_port->tx_lock);
+	len = kfifo_len(&rptty_port->tx_fifo);
+	spin_unlock_bh(&rptty_port->tx_lock);
+
+	return len;
+}
+
+static void rpmsgtty_flush_buffer(struct tty_struct *tty)
+{
+	struct rpmsgtty_port *rptty_port = container_of(tty->port,
+			struct rpmsgtty_port, port);
+
+	/* stop the flusher before dropping what it hasn't sent yet */
+	cancel_delayed_work_sync(&rptty_port->tx_work);
+	rptty_port->tx_len = 0;
+	rptty_port->tx_off = 0;
+
+	spin_lock_bh(&rptty_port->tx_lock);
+	kfifo_reset(&rptty_port->tx_fifo);
+	spin_unlock_bh(&rptty_port->tx_lock);
+
+	tty_wakeup(tty);
 }
 
 static const struct tty_operations rpmsgtty_ops = {
@@ -138,11 +238,14 @@ static const struct tty_operations rpmsgtty_ops = {
 	.close			= rpmsgtty_close,
 	.write			= rpmsgtty_write,
 	.write_room		= rpmsgtty_write_room,
+	.chars_in_buffer	= rpmsgtty_chars_in_buffer,
+	.flush_buffer		= rpmsgtty_flush_buffer,
 };
 
 static int rpmsg_tty_probe(struct rpmsg_device *rpdev)
 {
 	int ret;
+	ssize_t mtu;
 	struct rpmsgtty_port *cport;
 	struct tty_driver *rpmsgtty_driver;
 
@@ -153,6 +256,20 @@ static int rpmsg_tty_probe(struct rpmsg_device *rpdev)
 	if (!cport)
 		return -ENOMEM;
 
+	/* pack writes into the full rpmsg buffer, if the transport says how big */
+	mtu = rpmsg_get_mtu(rpdev->ept);
+	cport->mtu = mtu > 0 ? mtu : RPMSG_MAX_SIZE;
+
+	cport->tx_buf = devm_kmalloc(&rpdev->dev,
+				     RPMSGTTY_TX_BATCH * cport->mtu,
+				     GFP_KERNEL);
+	if (!cport->tx_buf)
+		return -ENOMEM;
+
+	spin_lock_init(&cport->tx_lock);
+	INIT_KFIFO(cport->tx_fifo);
+	INIT_DELAYED_WORK(&cport->tx_work, rpmsgtty_tx_work);
+
 	rpmsgtty_driver = tty_alloc_driver(1, TTY_DRIVER_UNNUMBERED_NODE);
 	if (IS_ERR(rpmsgtty_driver)) {
 		kfree(cport);
@@ -213,6 +330,8 @@ static void rpmsg_tty_remove(struct rpmsg_device *rpdev)
 
 	dev_info(&rpdev->dev, "rpmsg tty driver removed\n");
 
+	cancel_delayed_work_sync(&cport->tx_work);
+
 	tty_unregister_driver(cport->rpmsgtty_driver);
 	kfree(cport->rpmsgtty_driver->name);
 	put_tty_driver(cport->rpmsgtty_driver);
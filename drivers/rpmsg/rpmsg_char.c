@@ -14,18 +14,26 @@
 #include <linux/fs.h>
 #include <linux/idr.h>
 #include <linux/kernel.h>
+#include <linux/log2.h>
+#include <linux/mm.h>
 #include <linux/module.h>
+#include <linux/pipe_fs_i.h>
 #include <linux/poll.h>
 #include <linux/rpmsg.h>
 #include <linux/skbuff.h>
 #include <linux/slab.h>
+#include <linux/splice.h>
 #include <linux/uaccess.h>
+#include <linux/vmalloc.h>
 #include <uapi/linux/rpmsg.h>
 
 #include "rpmsg_internal.h"
 
 #define RPMSG_DEV_MAX	(MINORMASK + 1)
 
+/* rx buffers an endpoint may keep from the transport before copying again */
+#define RPMSG_EPTDEV_HOLD_MAX	16
+
 static dev_t rpmsg_major;
 static struct class *rpmsg_class;
 
@@ -62,6 +70,11 @@ struct rpmsg_ctrldev {
  * @queue_lock:	synchronization of @queue operations
  * @queue:	incoming message queue
  * @readq:	wait object for incoming queue
+ * @ring:	mmap'd receive ring, replacing @queue while set
+ * @ring_slots:	number of slots in @ring
+ * @ring_head:	kernel copy of the @ring producer index
+ * @ring_dropped: kernel copy of the @ring drop counter
+ * @held:	number of transport rx buffers referenced from @queue
  */
 struct rpmsg_eptdev {
 	struct device dev;
@@ -76,8 +89,63 @@ struct rpmsg_eptdev {
 	spinlock_t queue_lock;
 	struct sk_buff_head queue;
 	wait_queue_head_t readq;
+
+	struct rpmsg_ring_hdr *ring;
+	u32 ring_slots;
+	u32 ring_head;
+	u32 ring_dropped;
+
+	atomic_t held;
+};
+
+/**
+ * struct rpmsg_eptdev_skb_cb - queued message left in a transport rx buffer
+ * @rxbuf:	payload, held with rpmsg_hold_rx_buffer(), or NULL if the
+ *		payload was copied into the skb
+ * @len:	payload length
+ */
+struct rpmsg_eptdev_skb_cb {
+	void *rxbuf;
+	unsigned int len;
 };
 
+#define RPMSG_EPTDEV_SKB_CB(skb) ((struct rpmsg_eptdev_skb_cb *)(skb)->cb)
+
+static void *rpmsg_eptdev_skb_data(struct sk_buff *skb, unsigned int *len)
+{
+	struct rpmsg_eptdev_skb_cb *cb = RPMSG_EPTDEV_SKB_CB(skb);
+
+	if (cb->rxbuf) {
+		*len = cb->len;
+		return cb->rxbuf;
+	}
+
+	*len = skb->len;
+	return skb->data;
+}
+
+static void rpmsg_eptdev_free_skb(struct rpmsg_eptdev *eptdev,
+				  struct sk_buff *skb)
+{
+	struct rpmsg_eptdev_skb_cb *cb = RPMSG_EPTDEV_SKB_CB(skb);
+
+	if (cb->rxbuf) {
+		rpmsg_release_rx_buffer(eptdev->rpdev, cb->rxbuf);
+		atomic_dec(&eptdev->held);
+	}
+
+	kfree_skb(skb);
+}
+
+/* Discard all SKBs, giving held buffers back to the transport */
+static void rpmsg_eptdev_purge(struct rpmsg_eptdev *eptdev)
+{
+	struct sk_buff *skb;
+
+	while ((skb = skb_dequeue(&eptdev->queue)))
+		rpmsg_eptdev_free_skb(eptdev, skb);
+}
+
 static int rpmsg_eptdev_destroy(struct device *dev, void *data)
 {
 	struct rpmsg_eptdev *eptdev = dev_to_eptdev(dev);
@@ -89,6 +157,9 @@ static int rpmsg_eptdev_destroy(struct device *dev, void *data)
 	}
 	mutex_unlock(&eptdev->ept_lock);
 
+	/* held buffers must go back before the transport does */
+	rpmsg_eptdev_purge(eptdev);
+
 	/* wake up any blocked readers */
 	wake_up_interruptible(&eptdev->readq);
 
@@ -98,17 +169,73 @@ static int rpmsg_eptdev_destroy(struct device *dev, void *data)
 	return 0;
 }
 
+/*
+ * Copy a message into the next free ring slot. The indices and slot count
+ * in the shared header are writable by userspace, so only the kernel's own
+ * copies are trusted for addressing. Called with queue_lock held.
+ */
+static void rpmsg_eptdev_ring_put(struct rpmsg_eptdev *eptdev, void *buf,
+				  int len, u32 addr)
+{
+	struct rpmsg_ring_hdr *hdr = eptdev->ring;
+	struct rpmsg_ring_slot *slot;
+	u32 head = eptdev->ring_head;
+
+	if (head - READ_ONCE(hdr->tail) >= eptdev->ring_slots ||
+	    len > RPMSG_RING_SLOT_SIZE - sizeof(*slot)) {
+		WRITE_ONCE(hdr->dropped, ++eptdev->ring_dropped);
+		return;
+	}
+
+	slot = (void *)hdr + PAGE_SIZE +
+	       (head & (eptdev->ring_slots - 1)) * RPMSG_RING_SLOT_SIZE;
+	slot->len = len;
+	slot->src = addr;
+	memcpy(slot->data, buf, len);
+
+	eptdev->ring_head = ++head;
+	/* publish the slot contents before the new head */
+	smp_store_release(&hdr->head, head);
+}
+
 static int rpmsg_ept_cb(struct rpmsg_device *rpdev, void *buf, int len,
 			void *priv, u32 addr)
 {
 	struct rpmsg_eptdev *eptdev = priv;
 	struct sk_buff *skb;
+	bool ring;
 
-	skb = alloc_skb(len, GFP_ATOMIC);
-	if (!skb)
-		return -ENOMEM;
+	spin_lock(&eptdev->queue_lock);
+	ring = eptdev->ring;
+	if (ring)
+		rpmsg_eptdev_ring_put(eptdev, buf, len, addr);
+	spin_unlock(&eptdev->queue_lock);
 
-	skb_put_data(skb, buf, len);
+	if (ring) {
+		wake_up_interruptible(&eptdev->readq);
+		return 0;
+	}
+
+	/* leave the payload in the rx buffer, if the transport lets us */
+	if (atomic_read(&eptdev->held) < RPMSG_EPTDEV_HOLD_MAX &&
+	    !rpmsg_hold_rx_buffer(rpdev, buf)) {
+		skb = alloc_skb(0, GFP_ATOMIC);
+		if (!skb) {
+			rpmsg_release_rx_buffer(rpdev, buf);
+			return -ENOMEM;
+		}
+
+		RPMSG_EPTDEV_SKB_CB(skb)->rxbuf = buf;
+		RPMSG_EPTDEV_SKB_CB(skb)->len = len;
+		atomic_inc(&eptdev->held);
+	} else {
+		skb = alloc_skb(len, GFP_ATOMIC);
+		if (!skb)
+			return -ENOMEM;
+
+		RPMSG_EPTDEV_SKB_CB(skb)->rxbuf = NULL;
+		skb_put_data(skb, buf, len);
+	}
 
 	spin_lock(&eptdev->queue_lock);
 	skb_queue_tail(&eptdev->queue, skb);
@@ -155,61 +282,134 @@ static int rpmsg_eptdev_release(struct inode *inode, struct file *filp)
 	}
 	mutex_unlock(&eptdev->ept_lock);
 
-	/* Discard all SKBs */
-	skb_queue_purge(&eptdev->queue);
+	rpmsg_eptdev_purge(eptdev);
+
+	/* No mapping of the ring can outlive the file */
+	vfree(eptdev->ring);
+	eptdev->ring = NULL;
 
 	put_device(dev);
 
 	return 0;
 }
 
+/* Wait for data in the queue */
+static int rpmsg_eptdev_wait_queue(struct rpmsg_eptdev *eptdev,
+				   struct file *filp)
+{
+	if (!skb_queue_empty(&eptdev->queue))
+		return 0;
+
+	if (filp->f_flags & O_NONBLOCK)
+		return -EAGAIN;
+
+	/* Wait until we get data or the endpoint goes away */
+	if (wait_event_interruptible(eptdev->readq,
+				     !skb_queue_empty(&eptdev->queue) ||
+				     !eptdev->ept))
+		return -ERESTARTSYS;
+
+	/* We lost the endpoint while waiting */
+	if (!eptdev->ept)
+		return -EPIPE;
+
+	return 0;
+}
+
 static ssize_t rpmsg_eptdev_read_iter(struct kiocb *iocb, struct iov_iter *to)
 {
 	struct file *filp = iocb->ki_filp;
 	struct rpmsg_eptdev *eptdev = filp->private_data;
 	unsigned long flags;
 	struct sk_buff *skb;
+	unsigned int len;
+	void *data;
 	int use;
 
 	if (!eptdev->ept)
 		return -EPIPE;
 
-	spin_lock_irqsave(&eptdev->queue_lock, flags);
-
-	/* Wait for data in the queue */
-	if (skb_queue_empty(&eptdev->queue)) {
-		spin_unlock_irqrestore(&eptdev->queue_lock, flags);
-
-		if (filp->f_flags & O_NONBLOCK)
-			return -EAGAIN;
-
-		/* Wait until we get data or the endpoint goes away */
-		if (wait_event_interruptible(eptdev->readq,
-					     !skb_queue_empty(&eptdev->queue) ||
-					     !eptdev->ept))
-			return -ERESTARTSYS;
-
-		/* We lost the endpoint while waiting */
-		if (!eptdev->ept)
-			return -EPIPE;
-
-		spin_lock_irqsave(&eptdev->queue_lock, flags);
-	}
+	use = rpmsg_eptdev_wait_queue(eptdev, filp);
+	if (use)
+		return use;
 
+	spin_lock_irqsave(&eptdev->queue_lock, flags);
 	skb = skb_dequeue(&eptdev->queue);
 	spin_unlock_irqrestore(&eptdev->queue_lock, flags);
 	if (!skb)
 		return -EFAULT;
 
-	use = min_t(size_t, iov_iter_count(to), skb->len);
-	if (copy_to_iter(skb->data, use, to) != use)
+	data = rpmsg_eptdev_skb_data(skb, &len);
+	use = min_t(size_t, iov_iter_count(to), len);
+	if (copy_to_iter(data, use, to) != use)
 		use = -EFAULT;
 
-	kfree_skb(skb);
+	rpmsg_eptdev_free_skb(eptdev, skb);
 
 	return use;
 }
 
+/*
+ * Splice as many whole queued messages as fit into the pipe. Each message is
+ * copied once, straight into the pipe's pages, from where it can be spliced
+ * on to a socket without a round trip through userspace. Transport rx
+ * buffers aren't handed to the pipe itself, a pipe buffer can outlive the
+ * endpoint and the transport the rx buffer belongs to.
+ */
+static ssize_t rpmsg_eptdev_splice_read(struct file *filp, loff_t *ppos,
+					struct pipe_inode_info *pipe,
+					size_t len, unsigned int flags)
+{
+	struct rpmsg_eptdev *eptdev = filp->private_data;
+	unsigned long irqflags;
+	struct iov_iter to;
+	struct sk_buff *skb;
+	unsigned int msglen;
+	ssize_t total = 0;
+	void *data;
+	int ret;
+
+	if (!eptdev->ept)
+		return -EPIPE;
+
+	if ((flags & SPLICE_F_NONBLOCK) && skb_queue_empty(&eptdev->queue))
+		return -EAGAIN;
+
+	ret = rpmsg_eptdev_wait_queue(eptdev, filp);
+	if (ret)
+		return ret;
+
+	/* never start a message the pipe has no room left for */
+	len = min_t(size_t, len,
+		    pipe_space_for_user(pipe->head, pipe->tail, pipe) *
+		    PAGE_SIZE);
+	iov_iter_pipe(&to, READ, pipe, len);
+
+	while (iov_iter_count(&to)) {
+		spin_lock_irqsave(&eptdev->queue_lock, irqflags);
+		skb = skb_dequeue(&eptdev->queue);
+		if (skb && total) {
+			rpmsg_eptdev_skb_data(skb, &msglen);
+			if (msglen > iov_iter_count(&to)) {
+				skb_queue_head(&eptdev->queue, skb);
+				skb = NULL;
+			}
+		}
+		spin_unlock_irqrestore(&eptdev->queue_lock, irqflags);
+		if (!skb)
+			break;
+
+		/* like read(), truncate a message that can never fit */
+		data = rpmsg_eptdev_skb_data(skb, &msglen);
+		msglen = min_t(size_t, msglen, iov_iter_count(&to));
+		total += copy_to_iter(data, msglen, &to);
+
+		rpmsg_eptdev_free_skb(eptdev, skb);
+	}
+
+	return total;
+}
+
 static ssize_t rpmsg_eptdev_write_iter(struct kiocb *iocb,
 				       struct iov_iter *from)
 {
@@ -264,20 +464,246 @@ static __poll_t rpmsg_eptdev_poll(struct file *filp, poll_table *wait)
 	if (!skb_queue_empty(&eptdev->queue))
 		mask |= EPOLLIN | EPOLLRDNORM;
 
+	if (READ_ONCE(eptdev->ring) &&
+	    READ_ONCE(eptdev->ring->tail) != READ_ONCE(eptdev->ring_head))
+		mask |= EPOLLIN | EPOLLRDNORM;
+
 	mask |= rpmsg_poll(eptdev->ept, filp, wait);
 
 	return mask;
 }
 
+/*
+ * Drain up to batch.count queued messages in one call. A descriptor is read
+ * before its message is dequeued, so a bad descriptor loses no data.
+ */
+static long rpmsg_eptdev_recv_batch(struct rpmsg_eptdev *eptdev,
+				    struct file *filp, void __user *argp)
+{
+	struct rpmsg_msg_batch batch;
+	struct rpmsg_msg __user *umsgs;
+	struct rpmsg_msg msg;
+	unsigned long flags;
+	struct sk_buff *skb;
+	unsigned int len;
+	void *data;
+	long ret;
+	u32 i;
+
+	if (copy_from_user(&batch, argp, sizeof(batch)))
+		return -EFAULT;
+
+	if (!batch.count || batch.count > RPMSG_BATCH_MAX || batch.reserved)
+		return -EINVAL;
+
+	if (!eptdev->ept)
+		return -EPIPE;
+
+	ret = rpmsg_eptdev_wait_queue(eptdev, filp);
+	if (ret)
+		return ret;
+
+	umsgs = u64_to_user_ptr(batch.msgs);
+	for (i = 0; i < batch.count; i++) {
+		if (copy_from_user(&msg, &umsgs[i], sizeof(msg))) {
+			ret = -EFAULT;
+			break;
+		}
+
+		spin_lock_irqsave(&eptdev->queue_lock, flags);
+		skb = skb_dequeue(&eptdev->queue);
+		spin_unlock_irqrestore(&eptdev->queue_lock, flags);
+		if (!skb)
+			break;
+
+		data = rpmsg_eptdev_skb_data(skb, &len);
+		len = min_t(u32, msg.len, len);
+		if (copy_to_user(u64_to_user_ptr(msg.buf), data, len) ||
+		    put_user(len, &umsgs[i].len))
+			ret = -EFAULT;
+
+		rpmsg_eptdev_free_skb(eptdev, skb);
+		if (ret)
+			break;
+	}
+
+	if (i)
+		return i;
+
+	/* another reader emptied the queue after we were woken */
+	return ret ? ret : -EAGAIN;
+}
+
+/*
+ * Send up to batch.count messages with a single rpmsg_send_batch(), so the
+ * transport can notify the remote once for all of them. The payloads are
+ * gathered into one bounce buffer first.
+ */
+static long rpmsg_eptdev_send_batch(struct rpmsg_eptdev *eptdev,
+				    struct file *filp, void __user *argp)
+{
+	struct rpmsg_batch_entry *entries;
+	struct rpmsg_msg_batch batch;
+	struct rpmsg_msg *msgs;
+	size_t total = 0;
+	void *kbuf;
+	int count;
+	int ret = 0;
+	u32 i;
+
+	if (copy_from_user(&batch, argp, sizeof(batch)))
+		return -EFAULT;
+
+	if (!batch.count || batch.count > RPMSG_BATCH_MAX || batch.reserved)
+		return -EINVAL;
+
+	msgs = memdup_user(u64_to_user_ptr(batch.msgs),
+			   batch.count * sizeof(*msgs));
+	if (IS_ERR(msgs))
+		return PTR_ERR(msgs);
+
+	for (i = 0; i < batch.count; i++) {
+		if (msgs[i].reserved || msgs[i].len > INT_MAX) {
+			ret = -EINVAL;
+			goto free_msgs;
+		}
+		total += msgs[i].len;
+	}
+
+	entries = kcalloc(batch.count, sizeof(*entries), GFP_KERNEL);
+	if (!entries) {
+		ret = -ENOMEM;
+		goto free_msgs;
+	}
+
+	kbuf = kvzalloc(total, GFP_KERNEL);
+	if (!kbuf) {
+		ret = -ENOMEM;
+		goto free_entries;
+	}
+
+	/* a bad buffer truncates the batch before it */
+	total = 0;
+	for (i = 0; i < batch.count; i++) {
+		if (copy_from_user(kbuf + total, u64_to_user_ptr(msgs[i].buf),
+				   msgs[i].len))
+			break;
+
+		entries[i].data = kbuf + total;
+		entries[i].len = msgs[i].len;
+		total += msgs[i].len;
+	}
+
+	count = i;
+	if (!count) {
+		ret = -EFAULT;
+		goto free_kbuf;
+	}
+
+	if (mutex_lock_interruptible(&eptdev->ept_lock)) {
+		ret = -ERESTARTSYS;
+		goto free_kbuf;
+	}
+
+	if (!eptdev->ept) {
+		ret = -EPIPE;
+		goto unlock_eptdev;
+	}
+
+	if (filp->f_flags & O_NONBLOCK)
+		ret = rpmsg_trysend_batch(eptdev->ept, entries, count);
+	else
+		ret = rpmsg_send_batch(eptdev->ept, entries, count);
+
+unlock_eptdev:
+	mutex_unlock(&eptdev->ept_lock);
+
+free_kbuf:
+	kvfree(kbuf);
+free_entries:
+	kfree(entries);
+free_msgs:
+	kfree(msgs);
+	return ret;
+}
+
 static long rpmsg_eptdev_ioctl(struct file *fp, unsigned int cmd,
 			       unsigned long arg)
 {
 	struct rpmsg_eptdev *eptdev = fp->private_data;
+	void __user *argp = (void __user *)arg;
+
+	switch (cmd) {
+	case RPMSG_DESTROY_EPT_IOCTL:
+		return rpmsg_eptdev_destroy(&eptdev->dev, NULL);
+	case RPMSG_RECV_BATCH_IOCTL:
+		return rpmsg_eptdev_recv_batch(eptdev, fp, argp);
+	case RPMSG_SEND_BATCH_IOCTL:
+		return rpmsg_eptdev_send_batch(eptdev, fp, argp);
+	default:
+		return -EINVAL;
+	}
+}
+
+/*
+ * Map a receive ring, see struct rpmsg_ring_hdr. Only one ring can exist per
+ * open endpoint and it stays in place until the file is released.
+ */
+static int rpmsg_eptdev_mmap(struct file *filp, struct vm_area_struct *vma)
+{
+	struct rpmsg_eptdev *eptdev = filp->private_data;
+	size_t size = vma->vm_end - vma->vm_start;
+	struct rpmsg_ring_hdr *ring;
+	size_t nr_slots;
+	int ret;
+
+	if (vma->vm_pgoff || size <= PAGE_SIZE)
+		return -EINVAL;
 
-	if (cmd != RPMSG_DESTROY_EPT_IOCTL)
+	nr_slots = (size - PAGE_SIZE) / RPMSG_RING_SLOT_SIZE;
+	if (!is_power_of_2(nr_slots) || nr_slots > U32_MAX ||
+	    PAGE_SIZE + nr_slots * RPMSG_RING_SLOT_SIZE != size)
 		return -EINVAL;
 
-	return rpmsg_eptdev_destroy(&eptdev->dev, NULL);
+	if (mutex_lock_interruptible(&eptdev->ept_lock))
+		return -ERESTARTSYS;
+
+	if (!eptdev->ept) {
+		ret = -EPIPE;
+		goto unlock_eptdev;
+	}
+
+	if (eptdev->ring) {
+		ret = -EBUSY;
+		goto unlock_eptdev;
+	}
+
+	ring = vmalloc_user(size);
+	if (!ring) {
+		ret = -ENOMEM;
+		goto unlock_eptdev;
+	}
+
+	ring->nr_slots = nr_slots;
+	ring->slot_size = RPMSG_RING_SLOT_SIZE;
+
+	ret = remap_vmalloc_range(vma, ring, 0);
+	if (ret) {
+		vfree(ring);
+		goto unlock_eptdev;
+	}
+
+	spin_lock_irq(&eptdev->queue_lock);
+	eptdev->ring_slots = nr_slots;
+	eptdev->ring_head = 0;
+	eptdev->ring_dropped = 0;
+	eptdev->ring = ring;
+	spin_unlock_irq(&eptdev->queue_lock);
+
+unlock_eptdev:
+	mutex_unlock(&eptdev->ept_lock);
+
+	return ret;
 }
 
 static const struct file_operations rpmsg_eptdev_fops = {
@@ -286,7 +712,9 @@ static const struct file_operations rpmsg_eptdev_fops = {
 	.release = rpmsg_eptdev_release,
 	.read_iter = rpmsg_eptdev_read_iter,
 	.write_iter = rpmsg_eptdev_write_iter,
+	.splice_read = rpmsg_eptdev_splice_read,
 	.poll = rpmsg_eptdev_poll,
+	.mmap = rpmsg_eptdev_mmap,
 	.unlocked_ioctl = rpmsg_eptdev_ioctl,
 	.compat_ioctl = compat_ptr_ioctl,
 };
@@ -356,6 +784,7 @@ static int rpmsg_eptdev_create(struct rpmsg_ctrldev *ctrldev,
 	spin_lock_init(&eptdev->queue_lock);
 	skb_queue_head_init(&eptdev->queue);
 	init_waitqueue_head(&eptdev->readq);
+	atomic_set(&eptdev->held, 0);
 
 	device_initialize(dev);
 	dev->class = rpmsg_class;
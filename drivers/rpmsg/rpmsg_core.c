@@ -296,6 +296,152 @@ __poll_t rpmsg_poll(struct rpmsg_endpoint *ept, struct file *filp,
 }
 EXPORT_SYMBOL(rpmsg_poll);
 
+/**
+ * rpmsg_hold_rx_buffer() - keep a received buffer beyond the rx callback
+ * @rpdev:	the rpmsg device passed to the rx callback
+ * @rxbuf:	the data pointer passed to the rx callback
+ *
+ * Normally the buffer handed to an rx callback is given back to the remote
+ * processor as soon as the callback returns. A callback that wants to
+ * consume the payload later, without copying it, can call this to take a
+ * reference on the buffer instead. Every successful hold must be balanced
+ * by rpmsg_release_rx_buffer(), before the endpoint's device goes away.
+ *
+ * Held buffers are not available to the remote processor, so consumers
+ * should only hold a bounded number of them and fall back to copying.
+ *
+ * Can only be called from within the rx callback.
+ *
+ * Returns 0 on success, -EOPNOTSUPP if the transport can't hold buffers
+ * and an appropriate error value on other failures.
+ */
+int rpmsg_hold_rx_buffer(struct rpmsg_device *rpdev, void *rxbuf)
+{
+	if (WARN_ON(!rpdev))
+		return -EINVAL;
+	if (!rpdev->ops->hold_rx_buffer)
+		return -EOPNOTSUPP;
+
+	return rpdev->ops->hold_rx_buffer(rpdev, rxbuf);
+}
+EXPORT_SYMBOL(rpmsg_hold_rx_buffer);
+
+/**
+ * rpmsg_release_rx_buffer() - drop a reference taken by rpmsg_hold_rx_buffer()
+ * @rpdev:	the rpmsg device passed to the rx callback
+ * @rxbuf:	the data pointer passed to the rx callback
+ *
+ * The buffer is returned to the remote processor once its last reference
+ * is dropped. Can be called from any context.
+ *
+ * Returns 0 on success and an appropriate error value on failure.
+ */
+int rpmsg_release_rx_buffer(struct rpmsg_device *rpdev, void *rxbuf)
+{
+	if (WARN_ON(!rpdev))
+		return -EINVAL;
+	if (!rpdev->ops->release_rx_buffer)
+		return -EOPNOTSUPP;
+
+	return rpdev->ops->release_rx_buffer(rpdev, rxbuf);
+}
+EXPORT_SYMBOL(rpmsg_release_rx_buffer);
+
+static int __rpmsg_send_batch(struct rpmsg_endpoint *ept,
+			      const struct rpmsg_batch_entry *msgs, int count,
+			      bool wait)
+{
+	int ret = 0;
+	int i;
+
+	if (WARN_ON(!ept))
+		return -EINVAL;
+	if (count <= 0)
+		return -EINVAL;
+
+	if (ept->ops->send_batch)
+		return ept->ops->send_batch(ept, msgs, count, wait);
+
+	/* one message, and one notification, at a time */
+	for (i = 0; i < count; i++) {
+		ret = wait ? rpmsg_send(ept, msgs[i].data, msgs[i].len) :
+			     rpmsg_trysend(ept, msgs[i].data, msgs[i].len);
+		if (ret)
+			break;
+	}
+
+	return i ? i : ret;
+}
+
+/**
+ * rpmsg_send_batch() - send several messages across to the remote processor
+ * @ept: the rpmsg endpoint
+ * @msgs: the messages to send
+ * @count: number of entries in @msgs
+ *
+ * This function sends each message of @msgs to @ept's destination address,
+ * like rpmsg_send() would, but lets the backend notify the remote
+ * processor once for the whole batch instead of once per message.
+ *
+ * In case there are no TX buffers available, the function will block until
+ * one becomes available, or a timeout of 15 seconds elapses. When the latter
+ * happens, -ERESTARTSYS is returned.
+ *
+ * Can only be called from process context (for now).
+ *
+ * Returns the number of messages sent, which is only fewer than @count if
+ * an error stopped the batch, or an appropriate error value if none was.
+ */
+int rpmsg_send_batch(struct rpmsg_endpoint *ept,
+		     const struct rpmsg_batch_entry *msgs, int count)
+{
+	return __rpmsg_send_batch(ept, msgs, count, true);
+}
+EXPORT_SYMBOL(rpmsg_send_batch);
+
+/**
+ * rpmsg_trysend_batch() - send several messages across to the remote processor
+ * @ept: the rpmsg endpoint
+ * @msgs: the messages to send
+ * @count: number of entries in @msgs
+ *
+ * Same as rpmsg_send_batch(), but stops at the first message for which no
+ * TX buffer is available, instead of blocking.
+ *
+ * Can only be called from process context (for now).
+ *
+ * Returns the number of messages sent, or -ENOMEM if there was no TX
+ * buffer for the first one and an appropriate error value on other
+ * failures.
+ */
+int rpmsg_trysend_batch(struct rpmsg_endpoint *ept,
+			const struct rpmsg_batch_entry *msgs, int count)
+{
+	return __rpmsg_send_batch(ept, msgs, count, false);
+}
+EXPORT_SYMBOL(rpmsg_trysend_batch);
+
+/**
+ * rpmsg_get_mtu() - get maximum transmission buffer size for sending message.
+ * @ept: the rpmsg endpoint
+ *
+ * This function returns maximum buffer size available for a single outgoing
+ * message.
+ *
+ * Return: the maximum transmission size on success and an appropriate error
+ * value on failure.
+ */
+ssize_t rpmsg_get_mtu(struct rpmsg_endpoint *ept)
+{
+	if (WARN_ON(!ept))
+		return -EINVAL;
+	if (!ept->ops->get_mtu)
+		return -EOPNOTSUPP;
+
+	return ept->ops->get_mtu(ept);
+}
+EXPORT_SYMBOL(rpmsg_get_mtu);
+
 /**
  * rpmsg_trysend_offchannel() - send a message using explicit src/dst addresses
  * @ept: the rpmsg endpoint
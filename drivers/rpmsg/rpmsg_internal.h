@@ -25,6 +25,8 @@
  * @create_ept:		create backend-specific endpoint, required
  * @announce_create:	announce presence of new channel, optional
  * @announce_destroy:	announce destruction of channel, optional
+ * @hold_rx_buffer:	see @rpmsg_hold_rx_buffer(), optional
+ * @release_rx_buffer:	see @rpmsg_release_rx_buffer(), optional
  *
  * Indirection table for the operations that a rpmsg backend should implement.
  * @announce_create and @announce_destroy are optional as the backend might
@@ -41,6 +43,9 @@ struct rpmsg_device_ops {
 
 	int (*announce_create)(struct rpmsg_device *ept);
 	int (*announce_destroy)(struct rpmsg_device *ept);
+
+	int (*hold_rx_buffer)(struct rpmsg_device *rpdev, void *rxbuf);
+	int (*release_rx_buffer)(struct rpmsg_device *rpdev, void *rxbuf);
 };
 
 /**
@@ -53,6 +58,8 @@ struct rpmsg_device_ops {
  * @trysendto:		see @rpmsg_trysendto(), optional
  * @trysend_offchannel:	see @rpmsg_trysend_offchannel(), optional
  * @poll:		see @rpmsg_poll(), optional
+ * @send_batch:		see @rpmsg_send_batch(), optional
+ * @get_mtu:		see @rpmsg_get_mtu(), optional
  *
  * Indirection table for the operations that a rpmsg backend should implement.
  * In addition to @destroy_ept, the backend must at least implement @send and
@@ -72,6 +79,10 @@ struct rpmsg_endpoint_ops {
 			     void *data, int len);
 	__poll_t (*poll)(struct rpmsg_endpoint *ept, struct file *filp,
 			     poll_table *wait);
+	int (*send_batch)(struct rpmsg_endpoint *ept,
+			  const struct rpmsg_batch_entry *msgs, int count,
+			  bool wait);
+	ssize_t (*get_mtu)(struct rpmsg_endpoint *ept);
 };
 
 struct device *rpmsg_find_device(struct device *parent,
@@ -11,6 +11,7 @@
 
 #define pr_fmt(fmt) "%s: " fmt, __func__
 
+#include <linux/bitmap.h>
 #include <linux/dma-mapping.h>
 #include <linux/idr.h>
 #include <linux/jiffies.h>
@@ -18,12 +19,15 @@
 #include <linux/module.h>
 #include <linux/mutex.h>
 #include <linux/of_device.h>
+#include <linux/refcount.h>
 #include <linux/rpmsg.h>
 #include <linux/rpmsg/byteorder.h>
 #include <linux/rpmsg/ns.h>
+#include <linux/rpmsg/virtio_rpmsg.h>
 #include <linux/scatterlist.h>
 #include <linux/slab.h>
 #include <linux/sched.h>
+#include <linux/spinlock.h>
 #include <linux/virtio.h>
 #include <linux/virtio_ids.h>
 #include <linux/virtio_config.h>
@@ -40,15 +44,20 @@
  * @sbufs:	kernel address of tx buffers
  * @num_bufs:	total number of buffers for rx and tx
  * @buf_size:   size of one rx or tx buffer
- * @last_sbuf:	index of last tx buffer used
+ * @sbuf_map:	tx buffers owned by a sender or the remote, claimed without
+ *		any lock so that concurrent senders only meet on @tx_lock
+ *		for the short time it takes to queue a filled buffer
  * @bufs_dma:	dma base addr of the buffers
- * @tx_lock:	protects svq, sbufs and sleepers, to allow concurrent senders.
- *		sending a message might require waking up a dozing remote
- *		processor, which involves sleeping, hence the mutex.
+ * @tx_lock:	protects svq and sleepers, to allow concurrent senders.
+ *		the remote is notified outside of it, since waking up a
+ *		dozing remote processor might involve sleeping.
  * @endpoints:	idr of local endpoints, allows fast retrieval
  * @endpoints_lock: lock of the endpoints set
  * @sendq:	wait queue of sending contexts waiting for a tx buffers
  * @sleepers:	number of senders that are waiting for a tx buffer
+ * @rx_lock:	protects rvq, so that held rx buffers can be given back from
+ *		any context while messages are being received
+ * @rbuf_refs:	per rx buffer references, see rpmsg_hold_rx_buffer()
  *
  * This structure stores the rpmsg state of a given virtio remote processor
  * device (there might be several virtio proc devices for each physical
@@ -60,13 +69,15 @@ struct virtproc_info {
 	void *rbufs, *sbufs;
 	unsigned int num_bufs;
 	unsigned int buf_size;
-	int last_sbuf;
+	unsigned long *sbuf_map;
 	dma_addr_t bufs_dma;
-	struct mutex tx_lock;
+	spinlock_t tx_lock;
 	struct idr endpoints;
 	struct mutex endpoints_lock;
 	wait_queue_head_t sendq;
 	atomic_t sleepers;
+	spinlock_t rx_lock;
+	refcount_t *rbuf_refs;
 };
 
 /* The feature bitmap for virtio rpmsg */
@@ -127,9 +138,13 @@ struct virtio_rpmsg_channel {
  * Note that these numbers are purely a decision of this driver - we
  * can change this without changing anything in the firmware of the remote
  * processor.
+ *
+ * A transport offering VIRTIO_RPMSG_F_BUFSZ may override both through its
+ * config space, bounded by the 16-bit length field of the rpmsg header.
  */
 #define MAX_RPMSG_NUM_BUFS	(512)
 #define MAX_RPMSG_BUF_SIZE	(512)
+#define RPMSG_BUFSZ_LIMIT	(sizeof(struct rpmsg_hdr) + U16_MAX)
 
 /*
  * Local addresses are dynamically allocated on-demand.
@@ -149,6 +164,10 @@ static int virtio_rpmsg_trysendto(struct rpmsg_endpoint *ept, void *data,
 				  int len, u32 dst);
 static int virtio_rpmsg_trysend_offchannel(struct rpmsg_endpoint *ept, u32 src,
 					   u32 dst, void *data, int len);
+static int virtio_rpmsg_send_batch(struct rpmsg_endpoint *ept,
+				   const struct rpmsg_batch_entry *msgs,
+				   int count, bool wait);
+static ssize_t virtio_rpmsg_get_mtu(struct rpmsg_endpoint *ept);
 static struct rpmsg_device *__rpmsg_create_channel(struct virtproc_info *vrp,
 						   struct rpmsg_channel_info *chinfo);
 
@@ -160,6 +179,8 @@ static const struct rpmsg_endpoint_ops virtio_endpoint_ops = {
 	.trysend = virtio_rpmsg_trysend,
 	.trysendto = virtio_rpmsg_trysendto,
 	.trysend_offchannel = virtio_rpmsg_trysend_offchannel,
+	.send_batch = virtio_rpmsg_send_batch,
+	.get_mtu = virtio_rpmsg_get_mtu,
 };
 
 /**
@@ -364,12 +385,91 @@ static int virtio_rpmsg_announce_destroy(struct rpmsg_device *rpdev)
 	return err;
 }
 
+/* map a payload pointer back to the index of its rx buffer */
+static int rpmsg_rbuf_index(struct virtproc_info *vrp, void *rxbuf)
+{
+	ptrdiff_t offs = rxbuf - offsetof(struct rpmsg_hdr, data) - vrp->rbufs;
+
+	if (offs < 0 || offs % vrp->buf_size ||
+	    offs / vrp->buf_size >= vrp->num_bufs / 2)
+		return -EINVAL;
+
+	return offs / vrp->buf_size;
+}
+
+/* give an rx buffer back to the remote processor */
+static int rpmsg_recv_return(struct virtproc_info *vrp, struct rpmsg_hdr *msg,
+			     bool kick)
+{
+	struct scatterlist sg;
+	unsigned long flags;
+	bool notify = false;
+	int err;
+
+	/* publish the real size of the buffer */
+	rpmsg_sg_init(&sg, msg, vrp->buf_size);
+
+	spin_lock_irqsave(&vrp->rx_lock, flags);
+
+	/* add the buffer back to the remote processor's virtqueue */
+	err = virtqueue_add_inbuf(vrp->rvq, &sg, 1, msg, GFP_ATOMIC);
+	if (!err && kick)
+		notify = virtqueue_kick_prepare(vrp->rvq);
+
+	spin_unlock_irqrestore(&vrp->rx_lock, flags);
+
+	if (err < 0) {
+		dev_err(&vrp->vdev->dev, "failed to add a virtqueue buffer: %d\n",
+			err);
+		return err;
+	}
+
+	if (notify)
+		virtqueue_notify(vrp->rvq);
+
+	return 0;
+}
+
+static int virtio_rpmsg_hold_rx_buffer(struct rpmsg_device *rpdev,
+				       void *rxbuf)
+{
+	struct virtproc_info *vrp = to_virtio_rpmsg_channel(rpdev)->vrp;
+	int idx = rpmsg_rbuf_index(vrp, rxbuf);
+
+	if (idx < 0)
+		return idx;
+
+	/* only a buffer that is being delivered still has a reference */
+	if (!refcount_inc_not_zero(&vrp->rbuf_refs[idx]))
+		return -EINVAL;
+
+	return 0;
+}
+
+static int virtio_rpmsg_release_rx_buffer(struct rpmsg_device *rpdev,
+					  void *rxbuf)
+{
+	struct virtproc_info *vrp = to_virtio_rpmsg_channel(rpdev)->vrp;
+	int idx = rpmsg_rbuf_index(vrp, rxbuf);
+
+	if (idx < 0)
+		return idx;
+
+	if (!refcount_dec_and_test(&vrp->rbuf_refs[idx]))
+		return 0;
+
+	return rpmsg_recv_return(vrp, rxbuf - offsetof(struct rpmsg_hdr, data),
+				 true);
+}
+
 static const struct rpmsg_device_ops virtio_rpmsg_ops = {
 	.create_channel = virtio_rpmsg_create_channel,
 	.release_channel = virtio_rpmsg_release_channel,
 	.create_ept = virtio_rpmsg_create_ept,
 	.announce_create = virtio_rpmsg_announce_create,
 	.announce_destroy = virtio_rpmsg_announce_destroy,
+	.hold_rx_buffer = virtio_rpmsg_hold_rx_buffer,
+	.release_rx_buffer = virtio_rpmsg_release_rx_buffer,
 };
 
 static void virtio_rpmsg_release_device(struct device *dev)
@@ -434,28 +534,43 @@ static struct rpmsg_device *__rpmsg_create_channel(struct virtproc_info *vrp,
 	return rpdev;
 }
 
-/* super simple buffer "allocator" that is just enough for now */
-static void *get_a_tx_buf(struct virtproc_info *vrp)
+/* hand the tx buffers the remote processor is done with back to senders */
+static void rpmsg_reclaim_tx_bufs(struct virtproc_info *vrp)
 {
+	unsigned long flags;
 	unsigned int len;
-	void *ret;
+	void *msg;
 
-	/* support multiple concurrent senders */
-	mutex_lock(&vrp->tx_lock);
+	spin_lock_irqsave(&vrp->tx_lock, flags);
 
-	/*
-	 * either pick the next unused tx buffer
-	 * (half of our buffers are used for sending messages)
-	 */
-	if (vrp->last_sbuf < vrp->num_bufs / 2)
-		ret = vrp->sbufs + vrp->buf_size * vrp->last_sbuf++;
-	/* or recycle a used one */
-	else
-		ret = virtqueue_get_buf(vrp->svq, &len);
+	while ((msg = virtqueue_get_buf(vrp->svq, &len)))
+		clear_bit((msg - vrp->sbufs) / vrp->buf_size, vrp->sbuf_map);
 
-	mutex_unlock(&vrp->tx_lock);
+	spin_unlock_irqrestore(&vrp->tx_lock, flags);
+}
 
-	return ret;
+/* lock-free claim of a free tx buffer, reclaiming used ones if needed */
+static void *get_a_tx_buf(struct virtproc_info *vrp)
+{
+	unsigned int nbufs = vrp->num_bufs / 2;
+	bool reclaimed = false;
+	unsigned int i;
+
+	for (;;) {
+		i = find_first_zero_bit(vrp->sbuf_map, nbufs);
+		if (i < nbufs) {
+			if (!test_and_set_bit(i, vrp->sbuf_map))
+				return vrp->sbufs + vrp->buf_size * i;
+			/* lost the race for this one, look again */
+			continue;
+		}
+
+		if (reclaimed)
+			return NULL;
+
+		rpmsg_reclaim_tx_bufs(vrp);
+		reclaimed = true;
+	}
 }
 
 /**
@@ -476,15 +591,17 @@ static void *get_a_tx_buf(struct virtproc_info *vrp)
  */
 static void rpmsg_upref_sleepers(struct virtproc_info *vrp)
 {
+	unsigned long flags;
+
 	/* support multiple concurrent senders */
-	mutex_lock(&vrp->tx_lock);
+	spin_lock_irqsave(&vrp->tx_lock, flags);
 
 	/* are we the first sleeping context waiting for tx buffers ? */
 	if (atomic_inc_return(&vrp->sleepers) == 1)
 		/* enable "tx-complete" interrupts before dozing off */
 		virtqueue_enable_cb(vrp->svq);
 
-	mutex_unlock(&vrp->tx_lock);
+	spin_unlock_irqrestore(&vrp->tx_lock, flags);
 }
 
 /**
@@ -503,98 +620,41 @@ static void rpmsg_upref_sleepers(struct virtproc_info *vrp)
  */
 static void rpmsg_downref_sleepers(struct virtproc_info *vrp)
 {
+	unsigned long flags;
+
 	/* support multiple concurrent senders */
-	mutex_lock(&vrp->tx_lock);
+	spin_lock_irqsave(&vrp->tx_lock, flags);
 
 	/* are we the last sleeping context waiting for tx buffers ? */
 	if (atomic_dec_and_test(&vrp->sleepers))
 		/* disable "tx-complete" interrupts */
 		virtqueue_disable_cb(vrp->svq);
 
-	mutex_unlock(&vrp->tx_lock);
+	spin_unlock_irqrestore(&vrp->tx_lock, flags);
 }
 
-/**
- * rpmsg_send_offchannel_raw() - send a message across to the remote processor
- * @rpdev: the rpmsg channel
- * @src: source address
- * @dst: destination address
- * @data: payload of message
- * @len: length of payload
- * @wait: indicates whether caller should block in case no TX buffers available
- *
- * This function is the base implementation for all of the rpmsg sending API.
- *
- * It will send @data of length @len to @dst, and say it's from @src. The
- * message will be sent to the remote processor which the @rpdev channel
- * belongs to.
- *
- * The message is sent using one of the TX buffers that are available for
- * communication with this remote processor.
- *
- * If @wait is true, the caller will be blocked until either a TX buffer is
- * available, or 15 seconds elapses (we don't want callers to
- * sleep indefinitely due to misbehaving remote processors), and in that
- * case -ERESTARTSYS is returned. The number '15' itself was picked
+/*
+ * Grab a tx buffer. If @wait is true, block until one is available, but
+ * bail after 15 seconds; we don't want callers to sleep indefinitely due
+ * to misbehaving remote processors. The number '15' itself was picked
  * arbitrarily; there's little point in asking drivers to provide a timeout
  * value themselves.
- *
- * Otherwise, if @wait is false, and there are no TX buffers available,
- * the function will immediately fail, and -ENOMEM will be returned.
- *
- * Normally drivers shouldn't use this function directly; instead, drivers
- * should use the appropriate rpmsg_{try}send{to, _offchannel} API
- * (see include/linux/rpmsg.h).
- *
- * Returns 0 on success and an appropriate error value on failure.
  */
-static int rpmsg_send_offchannel_raw(struct rpmsg_device *rpdev,
-				     u32 src, u32 dst,
-				     void *data, int len, bool wait)
+static struct rpmsg_hdr *rpmsg_get_tx_buf_wait(struct virtproc_info *vrp,
+					       struct device *dev, bool wait)
 {
-	struct virtio_rpmsg_channel *vch = to_virtio_rpmsg_channel(rpdev);
-	struct virtproc_info *vrp = vch->vrp;
-	struct device *dev = &rpdev->dev;
-	struct scatterlist sg;
 	struct rpmsg_hdr *msg;
 	int err;
 
-	/* bcasting isn't allowed */
-	if (src == RPMSG_ADDR_ANY || dst == RPMSG_ADDR_ANY) {
-		dev_err(dev, "invalid addr (src 0x%x, dst 0x%x)\n", src, dst);
-		return -EINVAL;
-	}
-
-	/*
-	 * We currently use fixed-sized buffers, and therefore the payload
-	 * length is limited.
-	 *
-	 * One of the possible improvements here is either to support
-	 * user-provided buffers (and then we can also support zero-copy
-	 * messaging), or to improve the buffer allocator, to support
-	 * variable-length buffer sizes.
-	 */
-	if (len > vrp->buf_size - sizeof(struct rpmsg_hdr)) {
-		dev_err(dev, "message is too big (%d)\n", len);
-		return -EMSGSIZE;
-	}
-
-	/* grab a buffer */
 	msg = get_a_tx_buf(vrp);
 	if (!msg && !wait)
-		return -ENOMEM;
+		return ERR_PTR(-ENOMEM);
 
 	/* no free buffer ? wait for one (but bail after 15 seconds) */
 	while (!msg) {
 		/* enable "tx-complete" interrupts, if not already enabled */
 		rpmsg_upref_sleepers(vrp);
 
-		/*
-		 * sleep until a free buffer is available or 15 secs elapse.
-		 * the timeout period is not configurable because there's
-		 * little point in asking drivers to specify that.
-		 * if later this happens to be required, it'd be easy to add.
-		 */
 		err = wait_event_interruptible_timeout(vrp->sendq,
 					(msg = get_a_tx_buf(vrp)),
 					msecs_to_jiffies(15000));
@@ -605,10 +665,27 @@ static int rpmsg_send_offchannel_raw(struct rpmsg_device *rpdev,
 		/* timeout ? */
 		if (!err) {
 			dev_err(dev, "timeout waiting for a tx buffer\n");
-			return -ERESTARTSYS;
+			return ERR_PTR(-ERESTARTSYS);
 		}
 	}
 
+	return msg;
+}
+
+/*
+ * Fill a tx buffer and queue it to the remote processor, without notifying
+ * it. The buffer goes back to the free pool if it can't be queued.
+ */
+static int rpmsg_queue_tx_buf(struct rpmsg_device *rpdev,
+			      struct rpmsg_hdr *msg, u32 src, u32 dst,
+			      void *data, int len)
+{
+	struct virtproc_info *vrp = to_virtio_rpmsg_channel(rpdev)->vrp;
+	struct device *dev = &rpdev->dev;
+	struct scatterlist sg;
+	unsigned long flags;
+	int err;
+
 	msg->len = cpu_to_rpmsg16(rpdev, len);
 	msg->flags = 0;
 	msg->src = cpu_to_rpmsg32(rpdev, src);
@@ -625,27 +702,170 @@ static int rpmsg_send_offchannel_raw(struct rpmsg_device *rpdev,
 
 	rpmsg_sg_init(&sg, msg, sizeof(*msg) + len);
 
-	mutex_lock(&vrp->tx_lock);
+	spin_lock_irqsave(&vrp->tx_lock, flags);
 
 	/* add message to the remote processor's virtqueue */
-	err = virtqueue_add_outbuf(vrp->svq, &sg, 1, msg, GFP_KERNEL);
+	err = virtqueue_add_outbuf(vrp->svq, &sg, 1, msg, GFP_ATOMIC);
+
+	spin_unlock_irqrestore(&vrp->tx_lock, flags);
+
 	if (err) {
-		/*
-		 * need to reclaim the buffer here, otherwise it's lost
-		 * (memory won't leak, but rpmsg won't use it again for TX).
-		 * this will wait for a buffer management overhaul.
-		 */
 		dev_err(dev, "virtqueue_add_outbuf failed: %d\n", err);
-		goto out;
+		clear_bit(((void *)msg - vrp->sbufs) / vrp->buf_size,
+			  vrp->sbuf_map);
+	}
+
+	return err;
+}
+
+/* tell the remote processor it has pending messages to read */
+static void rpmsg_kick_tx(struct virtproc_info *vrp)
+{
+	unsigned long flags;
+	bool notify;
+
+	spin_lock_irqsave(&vrp->tx_lock, flags);
+	notify = virtqueue_kick_prepare(vrp->svq);
+	spin_unlock_irqrestore(&vrp->tx_lock, flags);
+
+	if (notify)
+		virtqueue_notify(vrp->svq);
+}
+
+static int rpmsg_check_tx(struct rpmsg_device *rpdev, u32 src, u32 dst,
+			  int len)
+{
+	struct virtproc_info *vrp = to_virtio_rpmsg_channel(rpdev)->vrp;
+	struct device *dev = &rpdev->dev;
+
+	/* bcasting isn't allowed */
+	if (src == RPMSG_ADDR_ANY || dst == RPMSG_ADDR_ANY) {
+		dev_err(dev, "invalid addr (src 0x%x, dst 0x%x)\n", src, dst);
+		return -EINVAL;
+	}
+
+	/*
+	 * We currently use fixed-sized buffers, and therefore the payload
+	 * length is limited.
+	 *
+	 * One of the possible improvements here is either to support
+	 * user-provided buffers (and then we can also support zero-copy
+	 * messaging), or to improve the buffer allocator, to support
+	 * variable-length buffer sizes.
+	 */
+	if (len < 0 || len > vrp->buf_size - sizeof(struct rpmsg_hdr)) {
+		dev_err(dev, "message is too big (%d)\n", len);
+		return -EMSGSIZE;
 	}
 
-	/* tell the remote processor it has a pending message to read */
-	virtqueue_kick(vrp->svq);
-out:
-	mutex_unlock(&vrp->tx_lock);
+	return 0;
+}
+
+/**
+ * rpmsg_send_offchannel_raw() - send a message across to the remote processor
+ * @rpdev: the rpmsg channel
+ * @src: source address
+ * @dst: destination address
+ * @data: payload of message
+ * @len: length of payload
+ * @wait: indicates whether caller should block in case no TX buffers available
+ *
+ * This function is the base implementation for all of the rpmsg sending API.
+ *
+ * It will send @data of length @len to @dst, and say it's from @src. The
+ * message will be sent to the remote processor which the @rpdev channel
+ * belongs to.
+ *
+ * The message is sent using one of the TX buffers that are available for
+ * communication with this remote processor.
+ *
+ * If @wait is true, the caller will be blocked until either a TX buffer is
+ * available, or 15 seconds elapses, and in that case -ERESTARTSYS is
+ * returned.
+ *
+ * Otherwise, if @wait is false, and there are no TX buffers available,
+ * the function will immediately fail, and -ENOMEM will be returned.
+ *
+ * Normally drivers shouldn't use this function directly; instead, drivers
+ * should use the appropriate rpmsg_{try}send{to, _offchannel} API
+ * (see include/linux/rpmsg.h).
+ *
+ * Returns 0 on success and an appropriate error value on failure.
+ */
+static int rpmsg_send_offchannel_raw(struct rpmsg_device *rpdev,
+				     u32 src, u32 dst,
+				     void *data, int len, bool wait)
+{
+	struct virtproc_info *vrp = to_virtio_rpmsg_channel(rpdev)->vrp;
+	struct rpmsg_hdr *msg;
+	int err;
+
+	err = rpmsg_check_tx(rpdev, src, dst, len);
+	if (err)
+		return err;
+
+	/* grab a buffer */
+	msg = rpmsg_get_tx_buf_wait(vrp, &rpdev->dev, wait);
+	if (IS_ERR(msg))
+		return PTR_ERR(msg);
+
+	err = rpmsg_queue_tx_buf(rpdev, msg, src, dst, data, len);
+	if (!err)
+		rpmsg_kick_tx(vrp);
+
 	return err;
 }
 
+/*
+ * Queue a whole batch with a single notification of the remote processor.
+ * Queued messages are flushed before sleeping for a buffer, otherwise the
+ * remote would never free one.
+ */
+static int virtio_rpmsg_send_batch(struct rpmsg_endpoint *ept,
+				   const struct rpmsg_batch_entry *msgs,
+				   int count, bool wait)
+{
+	struct rpmsg_device *rpdev = ept->rpdev;
+	struct virtproc_info *vrp = to_virtio_rpmsg_channel(rpdev)->vrp;
+	u32 src = ept->addr, dst = rpdev->dst;
+	struct rpmsg_hdr *msg;
+	int pending = 0;
+	int err = 0;
+	int i;
+
+	for (i = 0; i < count; i++) {
+		err = rpmsg_check_tx(rpdev, src, dst, msgs[i].len);
+		if (err)
+			break;
+
+		msg = get_a_tx_buf(vrp);
+		if (!msg) {
+			if (pending) {
+				rpmsg_kick_tx(vrp);
+				pending = 0;
+			}
+
+			msg = rpmsg_get_tx_buf_wait(vrp, &rpdev->dev, wait);
+			if (IS_ERR(msg)) {
+				err = PTR_ERR(msg);
+				break;
+			}
+		}
+
+		err = rpmsg_queue_tx_buf(rpdev, msg, src, dst, msgs[i].data,
+					 msgs[i].len);
+		if (err)
+			break;
+
+		pending++;
+	}
+
+	if (pending)
+		rpmsg_kick_tx(vrp);
+
+	return i ? i : err;
+}
+
 static int virtio_rpmsg_send(struct rpmsg_endpoint *ept, void *data, int len)
 {
 	struct rpmsg_device *rpdev = ept->rpdev;
@@ -696,14 +916,21 @@ static int virtio_rpmsg_trysend_offchannel(struct rpmsg_endpoint *ept, u32 src,
 	return rpmsg_send_offchannel_raw(rpdev, src, dst, data, len, false);
 }
 
+static ssize_t virtio_rpmsg_get_mtu(struct rpmsg_endpoint *ept)
+{
+	struct rpmsg_device *rpdev = ept->rpdev;
+	struct virtio_rpmsg_channel *vch = to_virtio_rpmsg_channel(rpdev);
+
+	return vch->vrp->buf_size - sizeof(struct rpmsg_hdr);
+}
+
 static int rpmsg_recv_single(struct virtproc_info *vrp, struct device *dev,
 			     struct rpmsg_hdr *msg, unsigned int len)
 {
 	struct rpmsg_endpoint *ept;
-	struct scatterlist sg;
 	bool little_endian = virtio_is_little_endian(vrp->vdev);
 	unsigned int msg_len = __rpmsg16_to_cpu(little_endian, msg->len);
-	int err;
+	int idx = rpmsg_rbuf_index(vrp, msg->data);
 
 	dev_dbg(dev, "From: 0x%x, To: 0x%x, Len: %d, Flags: %d, Reserved: %d\n",
 		__rpmsg32_to_cpu(little_endian, msg->src),
@@ -725,6 +952,9 @@ static int rpmsg_recv_single(struct virtproc_info *vrp, struct device *dev,
 		return -EINVAL;
 	}
 
+	/* the rx callback may take more references with rpmsg_hold_rx_buffer */
+	refcount_set(&vrp->rbuf_refs[idx], 1);
+
 	/* use the dst addr to fetch the callback of the appropriate user */
 	mutex_lock(&vrp->endpoints_lock);
 
@@ -751,17 +981,24 @@ static int rpmsg_recv_single(struct virtproc_info *vrp, struct device *dev,
 	} else
 		dev_warn(dev, "msg received with no recipient\n");
 
-	/* publish the real size of the buffer */
-	rpmsg_sg_init(&sg, msg, vrp->buf_size);
+	/* a held buffer goes back when its last holder releases it */
+	if (!refcount_dec_and_test(&vrp->rbuf_refs[idx]))
+		return 0;
 
-	/* add the buffer back to the remote processor's virtqueue */
-	err = virtqueue_add_inbuf(vrp->rvq, &sg, 1, msg, GFP_KERNEL);
-	if (err < 0) {
-		dev_err(dev, "failed to add a virtqueue buffer: %d\n", err);
-		return err;
-	}
+	return rpmsg_recv_return(vrp, msg, false);
+}
 
-	return 0;
+static struct rpmsg_hdr *rpmsg_recv_get(struct virtproc_info *vrp,
+					unsigned int *len)
+{
+	struct rpmsg_hdr *msg;
+	unsigned long flags;
+
+	spin_lock_irqsave(&vrp->rx_lock, flags);
+	msg = virtqueue_get_buf(vrp->rvq, len);
+	spin_unlock_irqrestore(&vrp->rx_lock, flags);
+
+	return msg;
 }
 
 /* called when an rx buffer is used, and it's time to digest a message */
@@ -771,9 +1008,11 @@ static void rpmsg_recv_done(struct virtqueue *rvq)
 	struct device *dev = &rvq->vdev->dev;
 	struct rpmsg_hdr *msg;
 	unsigned int len, msgs_received = 0;
+	unsigned long flags;
+	bool notify;
 	int err;
 
-	msg = virtqueue_get_buf(rvq, &len);
+	msg = rpmsg_recv_get(vrp, &len);
 	if (!msg) {
 		dev_err(dev, "uhm, incoming signal, but no used buffer ?\n");
 		return;
@@ -786,14 +1025,21 @@ static void rpmsg_recv_done(struct virtqueue *rvq)
 
 		msgs_received++;
 
-		msg = virtqueue_get_buf(rvq, &len);
+		msg = rpmsg_recv_get(vrp, &len);
 	}
 
 	dev_dbg(dev, "Received %u messages\n", msgs_received);
 
+	if (!msgs_received)
+		return;
+
 	/* tell the remote processor we added another available rx buffer */
-	if (msgs_received)
-		virtqueue_kick(vrp->rvq);
+	spin_lock_irqsave(&vrp->rx_lock, flags);
+	notify = virtqueue_kick_prepare(vrp->rvq);
+	spin_unlock_irqrestore(&vrp->rx_lock, flags);
+
+	if (notify)
+		virtqueue_notify(vrp->rvq);
 }
 
 /*
@@ -824,6 +1070,7 @@ static int rpmsg_probe(struct virtio_device *vdev)
 	void *bufs_va;
 	int err = 0, i;
 	size_t total_buf_space;
+	unsigned int max_bufs;
 	bool notify;
 
 	vrp = kzalloc(sizeof(*vrp), GFP_KERNEL);
@@ -834,8 +1081,9 @@ static int rpmsg_probe(struct virtio_device *vdev)
 
 	idr_init(&vrp->endpoints);
 	mutex_init(&vrp->endpoints_lock);
-	mutex_init(&vrp->tx_lock);
+	spin_lock_init(&vrp->tx_lock);
 	init_waitqueue_head(&vrp->sendq);
+	spin_lock_init(&vrp->rx_lock);
 
 	/* We expect two virtqueues, rx and tx (and in this order) */
 	err = virtio_find_vqs(vdev, 2, vqs, vq_cbs, names, NULL);
@@ -849,23 +1097,57 @@ static int rpmsg_probe(struct virtio_device *vdev)
 	WARN_ON(virtqueue_get_vring_size(vrp->rvq) !=
 		virtqueue_get_vring_size(vrp->svq));
 
+	max_bufs = MAX_RPMSG_NUM_BUFS;
+	vrp->buf_size = MAX_RPMSG_BUF_SIZE;
+
+	/* let the transport pick the geometry, if it knows better */
+	if (virtio_has_feature(vdev, VIRTIO_RPMSG_F_BUFSZ)) {
+		u32 num_bufs, buf_size;
+
+		virtio_cread(vdev, struct virtio_rpmsg_config, num_bufs,
+			     &num_bufs);
+		virtio_cread(vdev, struct virtio_rpmsg_config, buf_size,
+			     &buf_size);
+
+		if (num_bufs >= 2 &&
+		    buf_size > sizeof(struct rpmsg_hdr) &&
+		    buf_size <= RPMSG_BUFSZ_LIMIT) {
+			max_bufs = num_bufs;
+			vrp->buf_size = buf_size;
+		} else {
+			dev_warn(&vdev->dev, "invalid buffer geometry %u x %u, using defaults\n",
+				 num_bufs, buf_size);
+		}
+	}
+
 	/* we need less buffers if vrings are small */
-	if (virtqueue_get_vring_size(vrp->rvq) < MAX_RPMSG_NUM_BUFS / 2)
+	if (virtqueue_get_vring_size(vrp->rvq) < max_bufs / 2)
 		vrp->num_bufs = virtqueue_get_vring_size(vrp->rvq) * 2;
 	else
-		vrp->num_bufs = MAX_RPMSG_NUM_BUFS;
-
-	vrp->buf_size = MAX_RPMSG_BUF_SIZE;
+		vrp->num_bufs = max_bufs;
 
 	total_buf_space = vrp->num_bufs * vrp->buf_size;
 
+	vrp->rbuf_refs = kcalloc(vrp->num_bufs / 2, sizeof(*vrp->rbuf_refs),
+				 GFP_KERNEL);
+	if (!vrp->rbuf_refs) {
+		err = -ENOMEM;
+		goto vqs_del;
+	}
+
+	vrp->sbuf_map = bitmap_zalloc(vrp->num_bufs / 2, GFP_KERNEL);
+	if (!vrp->sbuf_map) {
+		err = -ENOMEM;
+		goto free_refs;
+	}
+
 	/* allocate coherent memory for the buffers */
 	bufs_va = dma_alloc_coherent(vdev->dev.parent,
 				     total_buf_space, &vrp->bufs_dma,
 				     GFP_KERNEL);
 	if (!bufs_va) {
 		err = -ENOMEM;
-		goto vqs_del;
+		goto free_map;
 	}
 
 	dev_dbg(&vdev->dev, "buffers: va %pK, dma %pad\n",
@@ -943,6 +1225,10 @@ static int rpmsg_probe(struct virtio_device *vdev)
 	kfree(vch);
 	dma_free_coherent(vdev->dev.parent, total_buf_space,
 			  bufs_va, vrp->bufs_dma);
+free_map:
+	bitmap_free(vrp->sbuf_map);
+free_refs:
+	kfree(vrp->rbuf_refs);
 vqs_del:
 	vdev->config->del_vqs(vrp->vdev);
 free_vrp:
@@ -976,6 +1262,8 @@ static void rpmsg_remove(struct virtio_device *vdev)
 	dma_free_coherent(vdev->dev.parent, total_buf_space,
 			  vrp->rbufs, vrp->bufs_dma);
 
+	bitmap_free(vrp->sbuf_map);
+	kfree(vrp->rbuf_refs);
 	kfree(vrp);
 }
 
@@ -986,6 +1274,7 @@ static struct virtio_device_id id_table[] = {
 
 static unsigned int features[] = {
 	VIRTIO_RPMSG_F_NS,
+	VIRTIO_RPMSG_F_BUFSZ,
 };
 
 static struct virtio_driver virtio_ipc_driver = {
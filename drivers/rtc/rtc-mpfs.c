@@ -8,6 +8,8 @@
  *
  */
 #include <linux/clk.h>
+#include <linux/clocksource.h>
+#include <linux/iopoll.h>
 #include <linux/module.h>
 #include <linux/kernel.h>
 #include <linux/of.h>
@@ -33,6 +35,7 @@
 #define  MPFS_RTC_NUM_IRQS		2
 #define MODE_REG		0x04
 #define  MODE_CLOCK_BIT			BIT(0)
+#define   MODE_CLOCK_BINARY		0
 #define   MODE_CLOCK_CALENDAR		1
 #define  MODE_WAKE_EN_BIT		BIT(1)
 #define  MODE_WAKE_RESET_BIT		BIT(2)
@@ -44,6 +47,7 @@
 #define COMPARE_UPPER_REG	0x18
 #define DATETIME_LOWER_REG	0x20
 #define DATETIME_UPPER_REG	0x24
+#define  DATETIME_UPPER_MASK		GENMASK(10, 0)
 #define SECONDS_REG		0x30
 #define MINUTES_REG		0x34
 #define HOURS_REG		0x38
@@ -62,11 +66,21 @@
 #define MAX_PRESCALER_COUNT	GENMASK(21, 0)
 #define DEFAULT_PRESCALER	999999  /* (1Mhz / prescaler) -1 = 1Hz */
 
+#define UPLOAD_TIMEOUT_US	50
+
+/*
+ * The counter keeps running through suspend, so it is offered as a
+ * clocksource for measuring suspended time only, never as the system one.
+ */
+#define MPFS_RTC_CS_RATING	50
+
 struct mpfs_rtc_dev {
 	struct rtc_device *rtc;
 	void __iomem *base;
 	int wakeup_irq;
 	u32 prescaler;
+	struct clocksource cs;
+	bool cs_registered;
 };
 
 static void mpfs_rtc_stop(struct mpfs_rtc_dev *rtcdev)
@@ -105,13 +119,14 @@ static void mpfs_rtc_clear_irq(struct mpfs_rtc_dev *rtcdev)
 	(void)readl(rtcdev->base + CONTROL_REG);
 }
 
-static void mpfs_rtc_calendar_mode(struct mpfs_rtc_dev *rtcdev)
+static void mpfs_rtc_binary_mode(struct mpfs_rtc_dev *rtcdev)
 {
 	u32 val;
 	u32 rtc_running;
 
 	val = readl(rtcdev->base + MODE_REG);
-	val |= MODE_CLOCK_CALENDAR;
+	val &= ~MODE_CLOCK_BIT;
+	val |= MODE_CLOCK_BINARY;
 
 	rtc_running = readl(rtcdev->base + CONTROL_REG);
 	if (rtc_running & CONTROL_RUNNING_BIT) {
@@ -124,17 +139,33 @@ static void mpfs_rtc_calendar_mode(struct mpfs_rtc_dev *rtcdev)
 	}
 }
 
+/*
+ * In binary mode the time is a single seconds counter. Reading the lower
+ * word latches the upper one, so two bus reads give a coherent value even
+ * if the counter ticks in between, where calendar mode needed seven.
+ */
+static u64 mpfs_rtc_read_counter(struct mpfs_rtc_dev *rtcdev)
+{
+	u64 time;
+
+	time = readl(rtcdev->base + DATETIME_LOWER_REG);
+	time |= ((u64)readl(rtcdev->base + DATETIME_UPPER_REG) & DATETIME_UPPER_MASK) << 32;
+
+	return time;
+}
+
+static u64 mpfs_rtc_cs_read(struct clocksource *cs)
+{
+	struct mpfs_rtc_dev *rtcdev = container_of(cs, struct mpfs_rtc_dev, cs);
+
+	return mpfs_rtc_read_counter(rtcdev);
+}
+
 static int mpfs_rtc_readtime(struct device *dev, struct rtc_time *tm)
 {
 	struct mpfs_rtc_dev *rtcdev = dev_get_drvdata(dev);
 
-	tm->tm_sec = readl(rtcdev->base + SECONDS_REG);
-	tm->tm_min = readl(rtcdev->base + MINUTES_REG);
-	tm->tm_hour = readl(rtcdev->base + HOURS_REG);
-	tm->tm_mday = readl(rtcdev->base + DAY_REG);
-	tm->tm_mon   = readl(rtcdev->base + MONTH_REG) - 1;
-	tm->tm_wday  = readl(rtcdev->base + WEEKDAY_REG) - 1;
-	tm->tm_year  = readl(rtcdev->base + YEAR_REG) + YEAR_OFFSET;
+	rtc_time64_to_tm(mpfs_rtc_read_counter(rtcdev), tm);
 
 	return 0;
 }
@@ -142,26 +173,25 @@ static int mpfs_rtc_readtime(struct device *dev, struct rtc_time *tm)
 static int mpfs_rtc_settime(struct device *dev, struct rtc_time *tm)
 {
 	struct mpfs_rtc_dev *rtcdev = dev_get_drvdata(dev);
+	u64 time = rtc_tm_to_time64(tm);
 	u32 val;
 	u32 prog;
+	int ret;
 
-	writel(tm->tm_year - YEAR_OFFSET, rtcdev->base + YEAR_REG);
-	writel(tm->tm_wday + 1, rtcdev->base + WEEKDAY_REG);
-	writel(tm->tm_mon + 1, rtcdev->base + MONTH_REG);
-	writel(tm->tm_mday, rtcdev->base + DAY_REG);
-	writel(tm->tm_hour, rtcdev->base + HOURS_REG);
-	writel(tm->tm_min, rtcdev->base + MINUTES_REG);
-	writel(tm->tm_sec, rtcdev->base + SECONDS_REG);
+	writel((u32)time, rtcdev->base + DATETIME_LOWER_REG);
+	writel((u32)(time >> 32) & DATETIME_UPPER_MASK, rtcdev->base + DATETIME_UPPER_REG);
 
 	val = readl(rtcdev->base + CONTROL_REG);
 	val &= ~CONTROL_STOP_BIT;
 	val |= CONTROL_UPLOAD_BIT;
 	writel(val, rtcdev->base + CONTROL_REG);
 
-	do {
-		prog = readl(rtcdev->base + CONTROL_REG);
-		prog &= CONTROL_UPLOAD_BIT;
-	} while (prog);
+	ret = readl_poll_timeout(rtcdev->base + CONTROL_REG, prog,
+				 !(prog & CONTROL_UPLOAD_BIT), 0, UPLOAD_TIMEOUT_US);
+	if (ret) {
+		dev_err(dev, "timed out uploading time to rtc\n");
+		return ret;
+	}
 
 	mpfs_rtc_start(rtcdev);
 	return 0;
@@ -171,28 +201,16 @@ static int mpfs_rtc_readalarm(struct device *dev, struct rtc_wkalrm *alrm)
 {
 	struct mpfs_rtc_dev *rtcdev = dev_get_drvdata(dev);
 	u32 mode = readl(rtcdev->base + MODE_REG);
-	u32 val;
+	u64 time;
 
 	if (mode & MODE_WAKE_EN_BIT)
 		alrm->enabled = true;
 	else
 		alrm->enabled = false;
 
-	val = readl(rtcdev->base + ALARM_LOWER_REG);
-	alrm->time.tm_sec = (val & 0xff);
-	val >>= 8;
-	alrm->time.tm_min = (val & 0xff);
-	val >>= 8;
-	alrm->time.tm_hour = (val & 0xff);
-	val >>= 8;
-	alrm->time.tm_mday = (val & 0xff);
-
-	val = readl(rtcdev->base + ALARM_UPPER_REG);
-	alrm->time.tm_mon = (val & 0xff) - 1;
-	val >>= 8;
-	alrm->time.tm_year = (val & 0xff) + YEAR_OFFSET;
-	val >>= 8;
-	alrm->time.tm_wday = (val & 0xff) - 1;
+	time = readl(rtcdev->base + ALARM_LOWER_REG);
+	time |= ((u64)readl(rtcdev->base + ALARM_UPPER_REG) & DATETIME_UPPER_MASK) << 32;
+	rtc_time64_to_tm(time, &alrm->time);
 
 	return 0;
 }
@@ -200,44 +218,33 @@ static int mpfs_rtc_readalarm(struct device *dev, struct rtc_wkalrm *alrm)
 static int mpfs_rtc_setalarm(struct device *dev, struct rtc_wkalrm *alrm)
 {
 	struct mpfs_rtc_dev *rtcdev = dev_get_drvdata(dev);
-	u32 val;
+	u64 time = rtc_tm_to_time64(&alrm->time);
 	u32 mode;
-	u32 mask;
 	u32 ctrl;
 
 	/* Disable the alarm before updating */
 	ctrl = readl(rtcdev->base + CONTROL_REG);
+	ctrl &= ~(CONTROL_ALARM_ON_BIT | CONTROL_START_BIT | CONTROL_STOP_BIT);
 	ctrl |= CONTROL_ALARM_OFF_BIT;
 	writel(ctrl, rtcdev->base + CONTROL_REG);
 
-	/* Set alarm and compare lower registers. */
-	val = alrm->time.tm_sec |
-	      alrm->time.tm_min << 8 |
-	      alrm->time.tm_hour << 16 |
-	      alrm->time.tm_mday << 24;
-	mask = 0xffffffff;
-
-	writel(val, rtcdev->base + ALARM_LOWER_REG);
-	writel(mask, rtcdev->base + COMPARE_LOWER_REG);
-
-	val = (alrm->time.tm_mon + 1) |
-	      (alrm->time.tm_year - YEAR_OFFSET) << 8;
-	mask = 0x000ffff;
+	/* Match on every bit of the counter */
+	writel((u32)time, rtcdev->base + ALARM_LOWER_REG);
+	writel((u32)(time >> 32) & DATETIME_UPPER_MASK, rtcdev->base + ALARM_UPPER_REG);
+	writel(GENMASK(31, 0), rtcdev->base + COMPARE_LOWER_REG);
+	writel(DATETIME_UPPER_MASK, rtcdev->base + COMPARE_UPPER_REG);
 
-	writel(val, rtcdev->base + ALARM_UPPER_REG);
-	writel(mask, rtcdev->base + COMPARE_UPPER_REG);
-
-	/* Configure the RTC to enable the alarm. */
+	/* Configure the RTC to enable the alarm, keeping it in binary mode. */
+	mode = readl(rtcdev->base + MODE_REG);
+	mode &= ~(MODE_WAKE_EN_BIT | MODE_WAKE_RESET_BIT | MODE_WAKE_CONTINUE_BIT);
 	if (alrm->enabled) {
-		mode = MODE_CLOCK_CALENDAR | MODE_WAKE_EN_BIT | MODE_WAKE_CONTINUE_BIT;
+		mode |= MODE_WAKE_EN_BIT | MODE_WAKE_CONTINUE_BIT;
 		/* Enable the alarm */
 		ctrl &= ~CONTROL_ALARM_OFF_BIT;
 		ctrl |= CONTROL_ALARM_ON_BIT;
 	}
-	ctrl &= ~CONTROL_STOP_BIT;
-	ctrl |= CONTROL_START_BIT;
-	writel(ctrl, rtcdev->base + CONTROL_REG);
 	writel(mode, rtcdev->base + MODE_REG);
+	writel(ctrl, rtcdev->base + CONTROL_REG);
 
 	return 0;
 }
@@ -246,10 +253,8 @@ static int mpfs_rtc_alarm_irq_enable(struct device *dev, unsigned int enabled)
 {
 	struct mpfs_rtc_dev *rtcdev = dev_get_drvdata(dev);
 	u32 ctrl;
-	u32 mode;
 
 	ctrl = readl(rtcdev->base + CONTROL_REG);
-	mode = readl(rtcdev->base + MODE_REG);
 	ctrl &= ~(CONTROL_ALARM_ON_BIT | CONTROL_ALARM_OFF_BIT | CONTROL_STOP_BIT);
 
 	if (enabled)
@@ -288,10 +293,7 @@ static inline struct clk *mpfs_rtc_init_clk(struct device *dev)
 static irqreturn_t mpfs_rtc_wakeup_irq_handler(int irq, void *d)
 {
 	struct mpfs_rtc_dev *rtcdev = d;
-	unsigned long pending;
 
-	pending = readl(rtcdev->base + CONTROL_REG);
-	pending &= CONTROL_ALARM_ON_BIT;
 	mpfs_rtc_clear_irq(rtcdev);
 
 	/* its an alarm */
@@ -315,7 +317,7 @@ static void mpfs_rtc_init(struct mpfs_rtc_dev *rtcdev)
 	mpfs_rtc_set_prescaler(rtcdev, rtcdev->prescaler);
 
 	mpfs_rtc_stop(rtcdev);
-	mpfs_rtc_calendar_mode(rtcdev);
+	mpfs_rtc_binary_mode(rtcdev);
 
 	writel(0, rtcdev->base + ALARM_LOWER_REG);
 	writel(0, rtcdev->base + ALARM_UPPER_REG);
@@ -328,6 +330,26 @@ static void mpfs_rtc_init(struct mpfs_rtc_dev *rtcdev)
 	writel(ctrl, rtcdev->base + CONTROL_REG);
 }
 
+static void mpfs_rtc_register_clocksource(struct device *dev, struct mpfs_rtc_dev *rtcdev,
+					  struct clk *clk)
+{
+	unsigned long rate = clk_get_rate(clk) / (rtcdev->prescaler + 1);
+
+	if (!rate)
+		return;
+
+	rtcdev->cs.name = dev_name(dev);
+	rtcdev->cs.rating = MPFS_RTC_CS_RATING;
+	rtcdev->cs.read = mpfs_rtc_cs_read;
+	rtcdev->cs.mask = CLOCKSOURCE_MASK(43);
+	rtcdev->cs.flags = CLOCK_SOURCE_IS_CONTINUOUS | CLOCK_SOURCE_SUSPEND_NONSTOP;
+
+	if (clocksource_register_hz(&rtcdev->cs, rate))
+		dev_warn(dev, "failed to register clocksource\n");
+	else
+		rtcdev->cs_registered = true;
+}
+
 static int __init mpfs_rtc_probe(struct platform_device *pdev)
 {
 	struct mpfs_rtc_dev *rtcdev;
@@ -379,16 +401,23 @@ static int __init mpfs_rtc_probe(struct platform_device *pdev)
 	}
 
 	mpfs_rtc_init(rtcdev);
+	mpfs_rtc_register_clocksource(&pdev->dev, rtcdev, clk);
 
 	dev_info(&pdev->dev, "Microchip Polarfire SoC RTC\n");
 
 	device_init_wakeup(&pdev->dev, 1);
+	device_enable_async_suspend(&pdev->dev);
 
 	return devm_rtc_register_device(rtcdev->rtc);
 }
 
 static int mpfs_rtc_remove(struct platform_device *pdev)
 {
+	struct mpfs_rtc_dev *rtcdev = platform_get_drvdata(pdev);
+
+	if (rtcdev->cs_registered)
+		clocksource_unregister(&rtcdev->cs);
+
 	mpfs_rtc_alarm_irq_enable(&pdev->dev, 0);
 	device_init_wakeup(&pdev->dev, 0);
 
@@ -6,11 +6,23 @@
  *
  */
 #include <linux/debugfs.h>
+#include <linux/genalloc.h>
 #include <linux/interrupt.h>
+#include <linux/io.h>
+#include <linux/log2.h>
+#include <linux/miscdevice.h>
+#include <linux/mm.h>
+#include <linux/moduleparam.h>
+#include <linux/mutex.h>
 #include <linux/of_irq.h>
 #include <linux/of_address.h>
 #include <linux/device.h>
+#include <linux/sizes.h>
+#include <linux/slab.h>
+#include <linux/spinlock.h>
+#include <linux/workqueue.h>
 #include <asm/cacheinfo.h>
+#include <asm/smp.h>
 #include <soc/sifive/sifive_l2_cache.h>
 
 #define SIFIVE_L2_DIRECCFIX_LOW 0x100
@@ -32,6 +44,7 @@
 #define SIFIVE_L2_CONFIG 0x00
 #define SIFIVE_L2_WAYENABLE 0x08
 #define SIFIVE_L2_ECCINJECTERR 0x40
+#define SIFIVE_L2_WAYMASK(m) (0x800 + (m) * 8)
 
 #define SIFIVE_L2_MAX_ECCINTR 4
 
@@ -39,6 +52,37 @@ static void __iomem *l2_base;
 static int g_irq[SIFIVE_L2_MAX_ECCINTR];
 static struct riscv_cacheinfo_ops l2_cache_ops;
 
+/*
+ * Every hart has a WayMask register for its D-cache master followed by one
+ * for its I-cache master, starting after the SoC specific bus masters.
+ */
+struct sifive_l2_data {
+	unsigned int first_hart_master;
+	unsigned int nr_masters;
+};
+
+static const struct sifive_l2_data fu540_l2_data = {
+	.first_hart_master = 0,
+	.nr_masters = 10,
+};
+
+/* DMA and the four AXI4 fabric ports come first on PolarFire */
+static const struct sifive_l2_data mpfs_l2_data = {
+	.first_hart_master = 5,
+	.nr_masters = 15,
+};
+
+static const struct sifive_l2_data *l2_data;
+static unsigned int l2_nr_ways;
+
+/*
+ * Ways that are not enabled for caching are loosely-integrated memory. The
+ * second reg entry of the node, if any, is the part of that LIM left to
+ * Linux, handed out by the pool below to drivers and through /dev/l2_lim.
+ */
+static struct gen_pool *l2_lim_pool;
+static DEFINE_MUTEX(l2_lim_lock);
+
 enum {
 	DIR_CORR = 0,
 	DATA_CORR,
@@ -47,6 +91,25 @@ enum {
 };
 
 #ifdef CONFIG_DEBUG_FS
+/*
+ * Above ce_storm_threshold correctable errors within a second the CE
+ * interrupts are masked and the counters polled every ce_poll_interval_ms
+ * instead, until the rate drops back under the threshold.
+ */
+static unsigned int ce_storm_threshold = 16;
+module_param(ce_storm_threshold, uint, 0644);
+MODULE_PARM_DESC(ce_storm_threshold, "CEs per second before polling, 0 never polls");
+
+static unsigned int ce_poll_interval_ms = 1000;
+module_param(ce_poll_interval_ms, uint, 0644);
+MODULE_PARM_DESC(ce_poll_interval_ms, "CE polling interval in milliseconds");
+
+static DEFINE_SPINLOCK(l2_ce_lock);
+static unsigned long l2_ce_window;
+static unsigned int l2_ce_in_window;
+static bool l2_ce_polling;
+static struct delayed_work l2_ce_poll_work;
+
 static struct dentry *sifive_test;
 
 static ssize_t l2_write(struct file *file, const char __user *data,
@@ -97,8 +160,9 @@ static void l2_config_read(void)
 }
 
 static const struct of_device_id sifive_l2_ids[] = {
-	{ .compatible = "sifive,fu540-c000-ccache" },
-	{ .compatible = "sifive,fu740-c000-ccache" },
+	{ .compatible = "sifive,fu540-c000-ccache", .data = &fu540_l2_data },
+	{ .compatible = "sifive,fu740-c000-ccache", .data = &fu540_l2_data },
+	{ .compatible = "microchip,mpfs-ccache", .data = &mpfs_l2_data },
 	{ /* end of table */ },
 };
 
@@ -130,8 +194,98 @@ static ssize_t number_of_ways_enabled_show(struct device *dev,
 
 static DEVICE_ATTR_RO(number_of_ways_enabled);
 
+/**
+ * sifive_l2_get_way_mask - read the ways an L2 master may allocate into
+ * @master: WayMask index, SoC bus masters first, then D- and I-cache of
+ *          every hart
+ * @mask: the allocation mask
+ *
+ * Return: 0, -ENODEV without an L2 controller or -EINVAL for a bad master.
+ */
+int sifive_l2_get_way_mask(unsigned int master, u32 *mask)
+{
+	if (!l2_base)
+		return -ENODEV;
+	if (master >= l2_data->nr_masters)
+		return -EINVAL;
+
+	*mask = readl(l2_base + SIFIVE_L2_WAYMASK(master)) &
+		GENMASK(l2_nr_ways - 1, 0);
+	return 0;
+}
+EXPORT_SYMBOL_GPL(sifive_l2_get_way_mask);
+
+/**
+ * sifive_l2_set_way_mask - restrict the ways an L2 master may allocate into
+ * @master: WayMask index, as for sifive_l2_get_way_mask()
+ * @mask: the new allocation mask
+ *
+ * Keeping DMA masters and harts on disjoint ways stops streaming I/O from
+ * evicting the working set of latency critical code.
+ *
+ * Return: 0, -ENODEV without an L2 controller or -EINVAL for a bad master
+ * or mask.
+ */
+int sifive_l2_set_way_mask(unsigned int master, u32 mask)
+{
+	if (!l2_base)
+		return -ENODEV;
+	if (master >= l2_data->nr_masters)
+		return -EINVAL;
+
+	/* A master that may not allocate anywhere would stall on a miss */
+	if (!mask || mask & ~GENMASK(l2_nr_ways - 1, 0))
+		return -EINVAL;
+
+	writel(mask, l2_base + SIFIVE_L2_WAYMASK(master));
+	return 0;
+}
+EXPORT_SYMBOL_GPL(sifive_l2_set_way_mask);
+
+/* The leaf device is cpuN/cache/indexM, its grandparent is the CPU device */
+static unsigned int l2_hart_master(struct device *dev)
+{
+	unsigned long hartid = cpuid_to_hartid_map(dev->parent->parent->id);
+
+	return l2_data->first_hart_master + hartid * 2;
+}
+
+static ssize_t way_mask_show(struct device *dev,
+			     struct device_attribute *attr, char *buf)
+{
+	u32 mask = readl(l2_base + SIFIVE_L2_WAYMASK(l2_hart_master(dev)));
+
+	return sprintf(buf, "0x%x\n", mask & GENMASK(l2_nr_ways - 1, 0));
+}
+
+/*
+ * Restrict the ways the hart's D-cache and I-cache may allocate into. Lines
+ * already resident in other ways still hit, so partitioning is exact only
+ * once the previous owners of those ways have been evicted.
+ */
+static ssize_t way_mask_store(struct device *dev,
+			      struct device_attribute *attr,
+			      const char *buf, size_t count)
+{
+	unsigned int master = l2_hart_master(dev);
+	u32 mask;
+	int ret;
+
+	if (kstrtou32(buf, 0, &mask))
+		return -EINVAL;
+
+	ret = sifive_l2_set_way_mask(master, mask);
+	if (!ret)
+		ret = sifive_l2_set_way_mask(master + 1, mask);
+
+	return ret ? ret : count;
+}
+
+static DEVICE_ATTR_RW(way_mask);
+
 static struct attribute *priv_attrs[] = {
 	&dev_attr_number_of_ways_enabled.attr,
+	&dev_attr_way_mask.attr,
 	NULL,
 };
 
@@ -148,45 +302,300 @@ static const struct attribute_group *l2_get_priv_group(struct cacheinfo *this_le
 		return NULL;
 }
 
-static irqreturn_t l2_int_handler(int irq, void *device)
+/**
+ * sifive_l2_lim_alloc - allocate L2 scratchpad memory
+ * @size: number of bytes
+ * @phys: physical address of the allocation, may be NULL
+ *
+ * LIM is as fast as an L2 hit and is never evicted, for buffers whose
+ * access latency must not depend on what else runs.
+ *
+ * Return: the kernel address of the memory, or NULL.
+ */
+void *sifive_l2_lim_alloc(size_t size, phys_addr_t *phys)
+{
+	unsigned long addr;
+
+	if (!l2_lim_pool)
+		return NULL;
+
+	addr = gen_pool_alloc(l2_lim_pool, size);
+	if (addr && phys)
+		*phys = gen_pool_virt_to_phys(l2_lim_pool, addr);
+
+	return (void *)addr;
+}
+EXPORT_SYMBOL_GPL(sifive_l2_lim_alloc);
+
+void sifive_l2_lim_free(void *addr, size_t size)
+{
+	gen_pool_free(l2_lim_pool, (unsigned long)addr, size);
+}
+EXPORT_SYMBOL_GPL(sifive_l2_lim_free);
+
+/*
+ * Every open file of /dev/l2_lim may map one page aligned LIM buffer. It
+ * is zeroed first and returned to the pool when the file goes away, which
+ * is only after the last mapping is gone.
+ */
+struct l2_lim_buf {
+	unsigned long addr;
+	size_t size;
+};
+
+static int l2_lim_open(struct inode *inode, struct file *file)
 {
+	struct l2_lim_buf *buf;
+
+	buf = kzalloc(sizeof(*buf), GFP_KERNEL);
+	if (!buf)
+		return -ENOMEM;
+
+	file->private_data = buf;
+	return 0;
+}
+
+static int l2_lim_release(struct inode *inode, struct file *file)
+{
+	struct l2_lim_buf *buf = file->private_data;
+
+	if (buf->addr)
+		gen_pool_free(l2_lim_pool, buf->addr, buf->size);
+	kfree(buf);
+	return 0;
+}
+
+static int l2_lim_mmap(struct file *file, struct vm_area_struct *vma)
+{
+	struct genpool_data_align align = { .align = PAGE_SIZE };
+	struct l2_lim_buf *buf = file->private_data;
+	size_t size = vma->vm_end - vma->vm_start;
+	unsigned long addr;
+	int ret;
+
+	if (vma->vm_pgoff)
+		return -EINVAL;
+
+	mutex_lock(&l2_lim_lock);
+
+	ret = -EBUSY;
+	if (buf->addr)
+		goto out;
+
+	ret = -ENOMEM;
+	addr = gen_pool_alloc_algo(l2_lim_pool, size, gen_pool_first_fit_align,
+				   &align);
+	if (!addr)
+		goto out;
+
+	memset((void *)addr, 0, size);
+	ret = vm_iomap_memory(vma, gen_pool_virt_to_phys(l2_lim_pool, addr),
+			      size);
+	if (ret) {
+		gen_pool_free(l2_lim_pool, addr, size);
+		goto out;
+	}
+
+	buf->addr = addr;
+	buf->size = size;
+out:
+	mutex_unlock(&l2_lim_lock);
+	return ret;
+}
+
+static const struct file_operations l2_lim_fops = {
+	.owner = THIS_MODULE,
+	.open = l2_lim_open,
+	.release = l2_lim_release,
+	.mmap = l2_lim_mmap,
+	.llseek = noop_llseek,
+};
+
+static struct miscdevice l2_lim_misc = {
+	.minor = MISC_DYNAMIC_MINOR,
+	.name = "l2_lim",
+	.fops = &l2_lim_fops,
+};
+
+static int __init l2_lim_init(struct device_node *np)
+{
+	u32 config = readl(l2_base + SIFIVE_L2_CONFIG);
+	unsigned int block_shift = (config & 0xFF000000) >> 24;
+	unsigned int set_shift = (config & 0xFF0000) >> 16;
+	size_t way_size, size;
+	struct resource res;
+	void *virt;
+	int ret;
+
+	if (of_address_to_resource(np, 1, &res))
+		return 0;
+
+	/* one way of every bank */
+	way_size = (size_t)(config & 0xFF) << (set_shift + block_shift);
+	size = resource_size(&res);
+	if (size > (l2_nr_ways - 1 - l2_largest_wayenabled()) * way_size) {
+		pr_err("L2CACHE: LIM %pR is larger than the ways not enabled\n",
+		       &res);
+		return -EINVAL;
+	}
+
+	virt = memremap(res.start, size, MEMREMAP_WB);
+	if (!virt)
+		return -ENOMEM;
+
+	ret = -ENOMEM;
+	l2_lim_pool = gen_pool_create(block_shift, -1);
+	if (!l2_lim_pool)
+		goto err_unmap;
+
+	ret = gen_pool_add_virt(l2_lim_pool, (unsigned long)virt, res.start,
+				size, -1);
+	if (ret)
+		goto err_destroy;
+
+	ret = misc_register(&l2_lim_misc);
+	if (ret)
+		goto err_destroy;
+
+	pr_info("L2CACHE: %zu KiB of LIM scratchpad at %pR\n", size / SZ_1K,
+		&res);
+	return 0;
+
+err_destroy:
+	gen_pool_destroy(l2_lim_pool);
+	l2_lim_pool = NULL;
+err_unmap:
+	memunmap(virt);
+	return ret;
+}
+
+static void l2_notify(unsigned long type, unsigned int block, u32 count,
+		      const char *msg)
+{
+	struct sifive_l2_err_info info = {
+		.msg = msg,
+		.block = block,
+		.count = count,
+	};
+
+	atomic_notifier_call_chain(&l2_err_chain, type, &info);
+}
+
+/*
+ * Read out and report a correctable error bank. Reading the count clears
+ * the interrupt as well as the count itself.
+ */
+static u32 l2_handle_ce(unsigned int block)
+{
+	unsigned int base = block == SIFIVE_L2_ERR_BLOCK_DIR ?
+			    SIFIVE_L2_DIRECCFIX_LOW : SIFIVE_L2_DATECCFIX_LOW;
 	unsigned int add_h, add_l;
+	u32 count;
 
-	if (irq == g_irq[DIR_CORR]) {
-		add_h = readl(l2_base + SIFIVE_L2_DIRECCFIX_HIGH);
-		add_l = readl(l2_base + SIFIVE_L2_DIRECCFIX_LOW);
-		pr_err("L2CACHE: DirError @ 0x%08X.%08X\n", add_h, add_l);
-		/* Reading this register clears the DirError interrupt sig */
-		readl(l2_base + SIFIVE_L2_DIRECCFIX_COUNT);
-		atomic_notifier_call_chain(&l2_err_chain, SIFIVE_L2_ERR_TYPE_CE,
-					   "DirECCFix");
+	add_h = readl(l2_base + base + 4);
+	add_l = readl(l2_base + base);
+	count = readl(l2_base + base + 8);
+	if (!count)
+		return 0;
+
+	pr_err_ratelimited("L2CACHE: %s @ 0x%08X.%08X count %u\n",
+			   block == SIFIVE_L2_ERR_BLOCK_DIR ?
+			   "DirError" : "DataError", add_h, add_l, count);
+	l2_notify(SIFIVE_L2_ERR_TYPE_CE, block, count,
+		  block == SIFIVE_L2_ERR_BLOCK_DIR ? "DirECCFix" : "DatECCFix");
+
+	return count;
+}
+
+static void l2_ce_irqs(bool enable)
+{
+	int i;
+
+	for (i = DIR_CORR; i <= DATA_CORR; i++) {
+		if (g_irq[i] <= 0)
+			continue;
+		if (enable)
+			enable_irq(g_irq[i]);
+		else
+			disable_irq_nosync(g_irq[i]);
 	}
+}
+
+/* Called from the CE interrupts, switches to polling on a storm */
+static void l2_ce_account(u32 count)
+{
+	unsigned long flags;
+
+	spin_lock_irqsave(&l2_ce_lock, flags);
+	if (time_after(jiffies, l2_ce_window + HZ)) {
+		l2_ce_window = jiffies;
+		l2_ce_in_window = 0;
+	}
+	l2_ce_in_window += count;
+
+	if (ce_storm_threshold && !l2_ce_polling &&
+	    l2_ce_in_window > ce_storm_threshold) {
+		l2_ce_polling = true;
+		l2_ce_irqs(false);
+		schedule_delayed_work(&l2_ce_poll_work,
+				      msecs_to_jiffies(ce_poll_interval_ms));
+		pr_warn("L2CACHE: %u CEs within a second, polling\n",
+			l2_ce_in_window);
+	}
+	spin_unlock_irqrestore(&l2_ce_lock, flags);
+}
+
+static void l2_ce_poll(struct work_struct *work)
+{
+	unsigned int interval = max(ce_poll_interval_ms, 1U);
+	unsigned long flags;
+	u64 rate;
+
+	rate = l2_handle_ce(SIFIVE_L2_ERR_BLOCK_DIR);
+	rate += l2_handle_ce(SIFIVE_L2_ERR_BLOCK_DATA);
+	rate = div_u64(rate * MSEC_PER_SEC, interval);
+
+	if (ce_storm_threshold && rate > ce_storm_threshold) {
+		schedule_delayed_work(&l2_ce_poll_work,
+				      msecs_to_jiffies(interval));
+		return;
+	}
+
+	spin_lock_irqsave(&l2_ce_lock, flags);
+	l2_ce_polling = false;
+	l2_ce_window = jiffies;
+	l2_ce_in_window = 0;
+	l2_ce_irqs(true);
+	spin_unlock_irqrestore(&l2_ce_lock, flags);
+	pr_info("L2CACHE: CE rate back to %llu/s, interrupts re-enabled\n",
+		rate);
+}
+
+static irqreturn_t l2_int_handler(int irq, void *device)
+{
+	unsigned int add_h, add_l;
+
+	if (irq == g_irq[DIR_CORR])
+		l2_ce_account(l2_handle_ce(SIFIVE_L2_ERR_BLOCK_DIR) ? : 1);
 	if (irq == g_irq[DIR_UNCORR]) {
 		add_h = readl(l2_base + SIFIVE_L2_DIRECCFAIL_HIGH);
 		add_l = readl(l2_base + SIFIVE_L2_DIRECCFAIL_LOW);
 		/* Reading this register clears the DirFail interrupt sig */
 		readl(l2_base + SIFIVE_L2_DIRECCFAIL_COUNT);
-		atomic_notifier_call_chain(&l2_err_chain, SIFIVE_L2_ERR_TYPE_UE,
-					   "DirECCFail");
+		l2_notify(SIFIVE_L2_ERR_TYPE_UE, SIFIVE_L2_ERR_BLOCK_DIR, 1,
+			  "DirECCFail");
 		panic("L2CACHE: DirFail @ 0x%08X.%08X\n", add_h, add_l);
 	}
-	if (irq == g_irq[DATA_CORR]) {
-		add_h = readl(l2_base + SIFIVE_L2_DATECCFIX_HIGH);
-		add_l = readl(l2_base + SIFIVE_L2_DATECCFIX_LOW);
-		pr_err("L2CACHE: DataError @ 0x%08X.%08X\n", add_h, add_l);
-		/* Reading this register clears the DataError interrupt sig */
-		readl(l2_base + SIFIVE_L2_DATECCFIX_COUNT);
-		atomic_notifier_call_chain(&l2_err_chain, SIFIVE_L2_ERR_TYPE_CE,
-					   "DatECCFix");
-	}
+	if (irq == g_irq[DATA_CORR])
+		l2_ce_account(l2_handle_ce(SIFIVE_L2_ERR_BLOCK_DATA) ? : 1);
 	if (irq == g_irq[DATA_UNCORR]) {
 		add_h = readl(l2_base + SIFIVE_L2_DATECCFAIL_HIGH);
 		add_l = readl(l2_base + SIFIVE_L2_DATECCFAIL_LOW);
 		pr_err("L2CACHE: DataFail @ 0x%08X.%08X\n", add_h, add_l);
 		/* Reading this register clears the DataFail interrupt sig */
 		readl(l2_base + SIFIVE_L2_DATECCFAIL_COUNT);
-		atomic_notifier_call_chain(&l2_err_chain, SIFIVE_L2_ERR_TYPE_UE,
-					   "DatECCFail");
+		l2_notify(SIFIVE_L2_ERR_TYPE_UE, SIFIVE_L2_ERR_BLOCK_DATA, 1,
+			  "DatECCFail");
 	}
 
 	return IRQ_HANDLED;
@@ -194,11 +603,12 @@ static irqreturn_t l2_int_handler(int irq, void *device)
 
 static int __init sifive_l2_init(void)
 {
+	const struct of_device_id *match;
 	struct device_node *np;
 	struct resource res;
 	int i, rc, intr_num;
 
-	np = of_find_matching_node(NULL, sifive_l2_ids);
+	np = of_find_matching_node_and_match(NULL, sifive_l2_ids, &match);
 	if (!np)
 		return -ENODEV;
 
@@ -215,6 +625,9 @@ static int __init sifive_l2_init(void)
 		return -ENODEV;
 	}
 
+	INIT_DELAYED_WORK(&l2_ce_poll_work, l2_ce_poll);
+	l2_ce_window = jiffies;
+
 	for (i = 0; i < intr_num; i++) {
 		g_irq[i] = irq_of_parse_and_map(np, i);
 		rc = request_irq(g_irq[i], l2_int_handler, 0, "l2_ecc", NULL);
@@ -226,6 +639,13 @@ static int __init sifive_l2_init(void)
 
 	l2_config_read();
 
+	l2_data = match->data;
+	l2_nr_ways = (readl(l2_base + SIFIVE_L2_CONFIG) & 0xFF00) >> 8;
+
+	rc = l2_lim_init(np);
+	if (rc)
+		pr_warn("L2CACHE: no LIM scratchpad: %d\n", rc);
+
 	l2_cache_ops.get_priv_group = l2_get_priv_group;
 	riscv_set_cacheinfo_ops(&l2_cache_ops);
 
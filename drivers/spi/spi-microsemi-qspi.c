@@ -14,17 +14,25 @@
 #include <linux/interrupt.h>
 #include <linux/platform_device.h>
 #include <linux/spi/spi.h>
+#include <linux/spi/spi-mem.h>
 #include <linux/err.h>
 #include <linux/clk.h>
 #include <linux/io.h>
+#include <linux/iopoll.h>
 #include <linux/delay.h>
 #include <linux/of.h>
+#include <asm/unaligned.h>
 
 /*
  * Maximum size we allow per xfer (limited with txrxdf_count register)
  */
 #define MSS_QSPI_MAX_LEN		(0xffff)
 
+/*
+ * Maximum data we send per spi-mem write, all of it counts as command bytes
+ */
+#define MSS_QSPI_MAX_CMD_DATA_LEN	(256)
+
 #define MSS_QSPI_MAX_CS			(1)
 
 #define MSS_QSPI_FIFO_DEPTH		(16)
@@ -40,12 +48,17 @@
 #define MSS_QSPI_CONTROL_SAMPLE_MSK     (3 << 11)
 #define MSS_QSPI_CONTROL_MODE0		(1 << 13)
 #define MSS_QSPI_CONTROL_MODE12_MSK	(3 << 14)
+#define MSS_QSPI_CONTROL_MODE12_EX_RO	(1 << 14)
+#define MSS_QSPI_CONTROL_MODE12_EX_RW	(2 << 14)
+#define MSS_QSPI_CONTROL_MODE12_FULL	(3 << 14)
 #define MSS_QSPI_CONTROL_FLAGSX4	(1 << 16)
 #define MSS_QSPI_CONTROL_CLKRATE_MSK	(0xf << 24)
 
-#define MSS_QSPI_FRAMES_TOTALBYTES_MSK	(0xffff < 0)
-#define MSS_QSPI_FRAMES_CMDBYTES_MSK	(0xff < 16)
+#define MSS_QSPI_FRAMES_TOTALBYTES_MSK	(0xffff << 0)
+#define MSS_QSPI_FRAMES_CMDBYTES_SHIFT	(16)
+#define MSS_QSPI_FRAMES_CMDBYTES_MSK	(0x1ff << 16)
 #define MSS_QSPI_FRAMES_QSPI		(1 << 25)
+#define MSS_QSPI_FRAMES_IDLE_SHIFT	(26)
 #define MSS_QSPI_FRAMES_IDLE_MSK	(0xf << 26)
 #define MSS_QSPI_FRAMES_FLAGBYTE	(1 << 30)
 #define MSS_QSPI_FRAMES_FLAGWORD	(1 << 31)
@@ -82,6 +95,9 @@
 
 #define MSS_QSPI_TXDATA_MSK		(0xff << 0)
 
+/* spi-mem operations are polled, bound the wait for the end of a sequence */
+#define MSS_QSPI_OP_TIMEOUT_US		(100000)
+
 
 
 /*
@@ -130,12 +146,47 @@ static inline void mss_spi_wr(struct mss_spi_dsc *s, unsigned int reg, u32 val)
 	writel(val, s->regs + reg);
 }
 
+static inline void mss_spi_set_x4(struct mss_spi_dsc *s, bool enable)
+{
+	u32 control = mss_spi_rd(s, MSS_QSPI_REG_CONTROL);
+
+	if (enable)
+		control |= MSS_QSPI_CONTROL_FLAGSX4;
+	else
+		control &= ~MSS_QSPI_CONTROL_FLAGSX4;
+
+	mss_spi_wr(s, MSS_QSPI_REG_CONTROL, control);
+}
+
 static inline void mss_spi_rd_fifo(struct mss_spi_dsc *s)
 {
-	u8 data = 0;
+	u32 data = 0;
 	int i = 0;
 	int count = min(s->rx_len, MSS_QSPI_FIFO_DEPTH);
 
+	/*
+	 * Drain whole words through the x4 data register first. With FLAGSX4
+	 * set, RXFIFOEMPTY means "less than a word", the rest is read bytewise.
+	 */
+	if (count >= 4) {
+		mss_spi_set_x4(s, true);
+
+		while ((count - i >= 4) &&
+			!(mss_spi_rd(s, MSS_QSPI_REG_STATUS) &
+			  MSS_QSPI_STATUS_RXFIFOEMPTY)) {
+			data = mss_spi_rd(s, MSS_QSPI_REG_X4_RX_DATA);
+
+			if (s->rx_buf) {
+				put_unaligned_le32(data, s->rx_buf);
+				s->rx_buf += 4;
+			}
+
+			i += 4;
+		}
+
+		mss_spi_set_x4(s, false);
+	}
+
 	/* read whatever is in the FIFO out, up to a maximum of
 	 * rx_len and fifo depth
 	 */
@@ -156,6 +207,7 @@ static inline void mss_spi_rd_fifo(struct mss_spi_dsc *s)
 static inline void mss_spi_wr_fifo(struct mss_spi_dsc *s)
 {
 	u8 byte;
+	u32 word;
 	int count;
 	int i = 0;
 
@@ -163,6 +215,26 @@ static inline void mss_spi_wr_fifo(struct mss_spi_dsc *s)
 	count = min(s->tx_len, MSS_QSPI_FIFO_DEPTH);
 	mss_spi_hw_tfsz_set(s, count);
 
+	/* whole words first, the full flag is word-wide while FLAGSX4 is set */
+	if (count >= 4) {
+		mss_spi_set_x4(s, true);
+
+		while ((count - i >= 4) &&
+			(!(mss_spi_rd(s, MSS_QSPI_REG_STATUS) &
+				MSS_QSPI_STATUS_TXFIFOFULL))) {
+			if (s->tx_buf) {
+				word = get_unaligned_le32(s->tx_buf);
+				s->tx_buf += 4;
+			} else {
+				word = 0xaaaaaaaa;
+			}
+			mss_spi_wr(s, MSS_QSPI_REG_X4_TX_DATA, word);
+			i += 4;
+		}
+
+		mss_spi_set_x4(s, false);
+	}
+
 	/* monitor the full next write bit */
 	while ((i < count) &&
 		(!(mss_spi_rd(s, MSS_QSPI_REG_STATUS) &
@@ -176,7 +248,6 @@ static inline void mss_spi_wr_fifo(struct mss_spi_dsc *s)
 	s->pending += i;
 }
 
-
 static int mss_spi_hw_init(struct mss_spi_dsc *s, struct platform_device *pdev)
 {
 	unsigned int ret = 0;
@@ -229,6 +300,7 @@ static inline int mss_spi_clk_gen_set(struct mss_spi_dsc *s)
 	control &= ~MSS_QSPI_CONTROL_ENABLE;
 	mss_spi_wr(s, MSS_QSPI_REG_CONTROL, control);
 
+	control &= ~MSS_QSPI_CONTROL_CLKRATE_MSK;
 	control |= s->clk_gen << 24;
 	mss_spi_wr(s, MSS_QSPI_REG_CONTROL, control);
 	control |= MSS_QSPI_CONTROL_ENABLE;
@@ -413,9 +485,15 @@ static int mss_spi_transfer_one_irq(struct spi_master *master,
 }
 
 
-static int mss_spi_transfer_one(struct spi_master *master,
-				struct spi_device *spi,
-				struct spi_transfer *tfr)
+/*
+ * Program the clock divider for a device
+ * @s		slave
+ * @spi		device
+ * @speed_hz	requested rate
+ * @returns	0->good,!=0->bad
+ */
+static int mss_spi_setup_clk(struct spi_master *master, struct spi_device *spi,
+			     u32 speed_hz)
 {
 	struct mss_spi_dsc *s = spi_master_get_devdata(master);
 	unsigned long spi_hz, clk_hz, clk_gen;
@@ -424,7 +502,7 @@ static int mss_spi_transfer_one(struct spi_master *master,
 	clk_hz = clk_get_rate(s->clk);
 
 	/* find suitable clock */
-	spi_hz = min(tfr->speed_hz, master->max_speed_hz);
+	spi_hz = min(speed_hz, master->max_speed_hz);
 
 	if ((spi_hz == 0) || (spi_hz < master->min_speed_hz)) {
 		dev_err(&spi->dev, "%s: %ld hz too slow for spi\n",
@@ -455,6 +533,20 @@ static int mss_spi_transfer_one(struct spi_master *master,
 		return -EINVAL;
 	}
 
+	return 0;
+}
+
+static int mss_spi_transfer_one(struct spi_master *master,
+				struct spi_device *spi,
+				struct spi_transfer *tfr)
+{
+	struct mss_spi_dsc *s = spi_master_get_devdata(master);
+	int ret;
+
+	ret = mss_spi_setup_clk(master, spi, tfr->speed_hz);
+	if (ret)
+		return ret;
+
 	/* set transmit buffers and length */
 	s->tx_buf = tfr->tx_buf;
 	s->rx_buf = tfr->rx_buf;
@@ -467,6 +559,257 @@ static int mss_spi_transfer_one(struct spi_master *master,
 	return mss_spi_transfer_one_irq(master, spi, tfr);
 }
 
+/*
+ * spi-mem support
+ *
+ * The command, address and dummy phases are described to the controller
+ * through the frames register, so a whole flash operation runs as a single
+ * sequence rather than as one SPI transfer per phase. Operations are polled
+ * and move data a word at a time through the x4 FIFO registers.
+ */
+static void mss_spi_mem_set_mode(struct mss_spi_dsc *s,
+				 const struct spi_mem_op *op)
+{
+	u32 control = mss_spi_rd(s, MSS_QSPI_REG_CONTROL);
+
+	control &= ~(MSS_QSPI_CONTROL_MODE12_MSK | MSS_QSPI_CONTROL_MODE0);
+
+	/*
+	 * bits[15:14] select whether only the data (extended RO/RW) or every
+	 * phase (full) uses the multi-bit lines, bit[13] selects 4 over 2 lines
+	 */
+	if (op->data.buswidth > 1) {
+		if (op->cmd.buswidth == 1 && op->addr.buswidth <= 1)
+			control |= MSS_QSPI_CONTROL_MODE12_EX_RO;
+		else if (op->cmd.buswidth == 1)
+			control |= MSS_QSPI_CONTROL_MODE12_EX_RW;
+		else
+			control |= MSS_QSPI_CONTROL_MODE12_FULL;
+
+		if (op->data.buswidth == 4)
+			control |= MSS_QSPI_CONTROL_MODE0;
+	}
+
+	mss_spi_wr(s, MSS_QSPI_REG_CONTROL, control);
+}
+
+static void mss_spi_mem_set_frames(struct mss_spi_dsc *s,
+				   const struct spi_mem_op *op)
+{
+	u32 total_bytes, cmd_bytes, idle_cycles = 0;
+	u32 frames;
+
+	cmd_bytes = op->cmd.nbytes + op->addr.nbytes;
+	total_bytes = cmd_bytes + op->data.nbytes;
+
+	/*
+	 * Received data is discarded for the command bytes, so anything that
+	 * is not a read is sent entirely as command bytes.
+	 */
+	if (op->data.dir != SPI_MEM_DATA_IN)
+		cmd_bytes = total_bytes;
+
+	if (op->dummy.buswidth)
+		idle_cycles = op->dummy.nbytes * 8 / op->dummy.buswidth;
+
+	frames = total_bytes & MSS_QSPI_FRAMES_TOTALBYTES_MSK;
+	frames |= (cmd_bytes << MSS_QSPI_FRAMES_CMDBYTES_SHIFT) &
+		  MSS_QSPI_FRAMES_CMDBYTES_MSK;
+	frames |= (idle_cycles << MSS_QSPI_FRAMES_IDLE_SHIFT) &
+		  MSS_QSPI_FRAMES_IDLE_MSK;
+	if (op->data.buswidth > 1)
+		frames |= MSS_QSPI_FRAMES_QSPI;
+	frames |= MSS_QSPI_FRAMES_FLAGWORD;
+
+	mss_spi_wr(s, MSS_QSPI_REG_FRAMES, frames);
+}
+
+static int mss_spi_mem_write(struct mss_spi_dsc *s, const u8 *buf, int len)
+{
+	u32 status;
+	int ret;
+
+	mss_spi_set_x4(s, true);
+
+	while (len >= 4) {
+		ret = readl_poll_timeout(s->regs + MSS_QSPI_REG_STATUS, status,
+					 !(status & MSS_QSPI_STATUS_TXFIFOFULL),
+					 0, MSS_QSPI_OP_TIMEOUT_US);
+		if (ret)
+			goto out;
+
+		mss_spi_wr(s, MSS_QSPI_REG_X4_TX_DATA, get_unaligned_le32(buf));
+		buf += 4;
+		len -= 4;
+	}
+
+	mss_spi_set_x4(s, false);
+
+	while (len--) {
+		ret = readl_poll_timeout(s->regs + MSS_QSPI_REG_STATUS, status,
+					 !(status & MSS_QSPI_STATUS_TXFIFOFULL),
+					 0, MSS_QSPI_OP_TIMEOUT_US);
+		if (ret)
+			return ret;
+
+		mss_spi_wr(s, MSS_QSPI_REG_TX_DATA, *buf++);
+	}
+
+	return 0;
+out:
+	mss_spi_set_x4(s, false);
+	return ret;
+}
+
+static int mss_spi_mem_read(struct mss_spi_dsc *s, u8 *buf, int len)
+{
+	u32 status;
+	int ret;
+
+	mss_spi_set_x4(s, true);
+
+	while (len >= 4) {
+		ret = readl_poll_timeout(s->regs + MSS_QSPI_REG_STATUS, status,
+					 !(status & MSS_QSPI_STATUS_RXFIFOEMPTY),
+					 0, MSS_QSPI_OP_TIMEOUT_US);
+		if (ret)
+			goto out;
+
+		put_unaligned_le32(mss_spi_rd(s, MSS_QSPI_REG_X4_RX_DATA), buf);
+		buf += 4;
+		len -= 4;
+	}
+
+	mss_spi_set_x4(s, false);
+
+	while (len--) {
+		ret = readl_poll_timeout(s->regs + MSS_QSPI_REG_STATUS, status,
+					 !(status & MSS_QSPI_STATUS_RXFIFOEMPTY),
+					 0, MSS_QSPI_OP_TIMEOUT_US);
+		if (ret)
+			return ret;
+
+		*buf++ = mss_spi_rd(s, MSS_QSPI_REG_RX_DATA);
+	}
+
+	return 0;
+out:
+	mss_spi_set_x4(s, false);
+	return ret;
+}
+
+static int mss_spi_exec_mem_op(struct spi_mem *mem, const struct spi_mem_op *op)
+{
+	struct spi_master *master = mem->spi->master;
+	struct mss_spi_dsc *s = spi_master_get_devdata(master);
+	u8 cmd_buf[1 + 4];
+	u32 control, status;
+	int i, len = 0;
+	int ret;
+
+	ret = readl_poll_timeout(s->regs + MSS_QSPI_REG_STATUS, status,
+				 status & MSS_QSPI_STATUS_READY,
+				 0, MSS_QSPI_OP_TIMEOUT_US);
+	if (ret)
+		return ret;
+
+	ret = mss_spi_setup_clk(master, mem->spi, mem->spi->max_speed_hz);
+	if (ret)
+		return ret;
+
+	/* the transfer_one() path expects its own mode, restore it after */
+	control = mss_spi_rd(s, MSS_QSPI_REG_CONTROL);
+	mss_spi_disable_ints(s);
+
+	mss_spi_mem_set_mode(s, op);
+	mss_spi_mem_set_frames(s, op);
+
+	/* clear stale status before starting the sequence */
+	mss_spi_wr(s, MSS_QSPI_REG_STATUS, 0xff);
+
+	mss_spi_activate_cs(s);
+
+	cmd_buf[len++] = op->cmd.opcode;
+	for (i = op->addr.nbytes - 1; i >= 0; i--)
+		cmd_buf[len++] = op->addr.val >> (8 * i);
+
+	ret = mss_spi_mem_write(s, cmd_buf, len);
+	if (ret)
+		goto out;
+
+	if (op->data.nbytes && op->data.dir == SPI_MEM_DATA_OUT)
+		ret = mss_spi_mem_write(s, op->data.buf.out, op->data.nbytes);
+	else if (op->data.nbytes && op->data.dir == SPI_MEM_DATA_IN)
+		ret = mss_spi_mem_read(s, op->data.buf.in, op->data.nbytes);
+	if (ret)
+		goto out;
+
+	/* RXDONE marks the end of the whole sequence, reads or not */
+	ret = readl_poll_timeout(s->regs + MSS_QSPI_REG_STATUS, status,
+				 status & MSS_QSPI_STATUS_RXDONE,
+				 0, MSS_QSPI_OP_TIMEOUT_US);
+out:
+	if (ret)
+		dev_err(&mem->spi->dev, "mem op 0x%02x failed: %d\n",
+			op->cmd.opcode, ret);
+
+	mss_spi_deactivate_cs(s);
+	mss_spi_wr(s, MSS_QSPI_REG_STATUS, 0xff);
+	mss_spi_wr(s, MSS_QSPI_REG_CONTROL, control);
+	mss_spi_enable_ints(s, NULL);
+
+	return ret;
+}
+
+static bool mss_spi_supports_mem_op(struct spi_mem *mem,
+				    const struct spi_mem_op *op)
+{
+	u32 idle_cycles = 0;
+
+	if (!spi_mem_default_supports_op(mem, op))
+		return false;
+
+	if (op->cmd.nbytes != 1 || op->addr.nbytes > 4)
+		return false;
+
+	if (op->dummy.buswidth)
+		idle_cycles = op->dummy.nbytes * 8 / op->dummy.buswidth;
+	if (idle_cycles > (MSS_QSPI_FRAMES_IDLE_MSK >> MSS_QSPI_FRAMES_IDLE_SHIFT))
+		return false;
+
+	/*
+	 * With command and address on DQ0 only (extended RO), data can only be
+	 * received on multiple lines, not sent.
+	 */
+	if (op->data.buswidth > 1 && op->cmd.buswidth == 1 &&
+	    op->addr.buswidth <= 1 && op->data.dir == SPI_MEM_DATA_OUT)
+		return false;
+
+	return true;
+}
+
+static int mss_spi_adjust_mem_op_size(struct spi_mem *mem,
+				      struct spi_mem_op *op)
+{
+	unsigned int max_data;
+
+	/* writes go out as command bytes, which the frames register caps */
+	if (op->data.dir == SPI_MEM_DATA_OUT)
+		max_data = MSS_QSPI_MAX_CMD_DATA_LEN;
+	else
+		max_data = MSS_QSPI_MAX_LEN - op->cmd.nbytes - op->addr.nbytes;
+
+	if (op->data.nbytes > max_data)
+		op->data.nbytes = max_data;
+
+	return 0;
+}
+
+static const struct spi_controller_mem_ops mss_spi_mem_ops = {
+	.adjust_op_size = mss_spi_adjust_mem_op_size,
+	.supports_op = mss_spi_supports_mem_op,
+	.exec_op = mss_spi_exec_mem_op,
+};
 
 static int mss_spi_prepare_message(struct spi_master *master,
 				   struct spi_message *msg)
@@ -526,10 +869,12 @@ static int mss_spi_probe(struct platform_device *pdev)
 	}
 
 	platform_set_drvdata(pdev, master);
-	master->mode_bits = SPI_CPOL | SPI_CPHA;
+	master->mode_bits = SPI_CPOL | SPI_CPHA | SPI_RX_DUAL | SPI_RX_QUAD |
+			    SPI_TX_DUAL | SPI_TX_QUAD;
 	master->bits_per_word_mask = SPI_BPW_MASK(8);
 	master->num_chipselect = -1;
 	master->transfer_one = mss_spi_transfer_one;
+	master->mem_ops = &mss_spi_mem_ops;
 	master->handle_err = mss_spi_handle_err;
 	master->prepare_message = mss_spi_prepare_message;
 	master->unprepare_message = mss_spi_unprepare_message;
@@ -19,8 +19,10 @@
 #include <linux/err.h>
 #include <linux/clk.h>
 #include <linux/io.h>
+#include <linux/iopoll.h>
 #include <linux/delay.h>
 #include <linux/of.h>
+#include <linux/slab.h>
 
 /*
  * Maximum size we allow per xfer (limited with txrxdf_count register)
@@ -31,6 +33,13 @@
 
 #define MSS_SPI_FIFO_DEPTH		(32)
 
+/*
+ * Transfers that fit in the FIFO are polled, the interrupt round trip
+ * costs more than clocking out a FIFO worth of data at usual rates
+ */
+#define MSS_SPI_POLL_MAX_LEN		(MSS_SPI_FIFO_DEPTH)
+#define MSS_SPI_POLL_TIMEOUT_US		(1000)
+
 #define MSS_SPI_CLK_GEN_MAX		(255)
 #define MSS_SPI_CLK_GEN_P2_MAX		(15)
 #define MSS_SPI_CLK_GEN_MIN		(0)
@@ -84,8 +93,11 @@ struct mss_spi_dsc {
 	void __iomem *regs;
 	int irq;
 	struct clk *clk;
+	unsigned long clk_hz;
 	u8 clk_gen;
 	u8 clk_mode;
+	bool clk_valid;
+	bool polling;
 	const u8 *tx_buf;
 	u8 *rx_buf;
 	int tx_len;
@@ -93,6 +105,16 @@ struct mss_spi_dsc {
 	int pending;
 };
 
+/*
+ * Per-device clock divider, computed once in setup() for the device's
+ * max_speed_hz instead of for every transfer
+ */
+struct mss_spi_dev_cfg {
+	u32 speed_hz;
+	u8 clk_gen;
+	u8 clk_mode;
+};
+
 /*
  * Description of the the SmartFusion SPI hardware interfaces.
  * This is a 1-to-1 mapping of Actel's documentation onto a C structure.
@@ -453,6 +475,12 @@ static irqreturn_t mss_spi_interrupt(int irq, void *dev_id)
 	if (intfield == 0)
 		return IRQ_NONE;
 
+	/* a polled transfer drains the FIFOs itself */
+	if (s->polling) {
+		mss_spi_wr(s, MSS_SPI_REG_INT_CLEAR, intfield);
+		return IRQ_HANDLED;
+	}
+
 	/* clear the interrupt conditions */
 	if (intfield & MSS_SPI_INT_TXDONE) {
 		mss_spi_wr(s, MSS_SPI_REG_INT_CLEAR,
@@ -508,18 +536,55 @@ static int mss_spi_transfer_one_irq(struct spi_master *master,
 	return 1;
 }
 
-static int mss_spi_transfer_one(struct spi_master *master,
-				struct spi_device *spi,
-				struct spi_transfer *tfr)
+static int mss_spi_transfer_one_poll(struct spi_master *master,
+				     struct spi_device *spi,
+				     struct spi_transfer *tfr)
+{
+	struct mss_spi_dsc *s = spi_master_get_devdata(master);
+	u32 status;
+	int ret = 0;
+
+	s->polling = true;
+
+	/* the whole transfer fits in the FIFO, so a single burst */
+	mss_spi_wr_fifo(s);
+
+	while (s->rx_len) {
+		ret = readl_poll_timeout_atomic(s->regs + MSS_SPI_REG_STATUS,
+						status,
+						!(status & MSS_SPI_STATUS_RXFIFO_EMPTY),
+						0, MSS_SPI_POLL_TIMEOUT_US);
+		if (ret) {
+			dev_err(&spi->dev, "%s: timeout, rxlen: %d\n",
+				__func__, s->rx_len);
+			break;
+		}
+
+		mss_spi_rd_fifo(s);
+	}
+
+	s->polling = false;
+
+	return ret;
+}
+
+/*
+ * Compute the clock divider for a rate
+ * @s		slave
+ * @spi_hz	requested rate
+ * @cfg		divider and mode found
+ * @returns	0->good,!=0->bad
+ */
+static int mss_spi_calc_clk(struct spi_master *master, struct spi_device *spi,
+			    u32 speed_hz, struct mss_spi_dev_cfg *cfg)
 {
 	struct mss_spi_dsc *s = spi_master_get_devdata(master);
 	unsigned long spi_hz, clk_hz, clk_gen;
 
-	/* set clock */
-	clk_hz = clk_get_rate(s->clk);
+	clk_hz = s->clk_hz;
 
 	/* find suitable clock */
-	spi_hz = min(tfr->speed_hz, master->max_speed_hz);
+	spi_hz = min(speed_hz, master->max_speed_hz);
 
 	if ((spi_hz == 0) || (spi_hz < master->min_speed_hz)) {
 		dev_err(&spi->dev, "%s: %ld hz too slow\n",
@@ -544,20 +609,59 @@ static int mss_spi_transfer_one(struct spi_master *master,
 		if ((clk_gen > MSS_SPI_CLK_GEN_P2_MAX) ||
 		    (clk_gen < MSS_SPI_CLK_GEN_MIN))
 			return -EINVAL; /* give up */
-		s->clk_gen = clk_gen;
-		s->clk_mode = 0;
+		cfg->clk_gen = clk_gen;
+		cfg->clk_mode = 0;
 	} else {
-		s->clk_gen = clk_gen;
-		s->clk_mode = 1;
+		cfg->clk_gen = clk_gen;
+		cfg->clk_mode = 1;
 	}
 
-	/* calculate spi_hz obtained */
-	if (s->clk_mode)
-		spi_hz = clk_hz / (2 * (s->clk_gen + 1));
-	else
-		spi_hz = clk_hz / (2 ^ (s->clk_gen + 1));
+	cfg->speed_hz = speed_hz;
+
+	return 0;
+}
+
+/*
+ * Program a divider, skipping the register writes if it is already set
+ */
+static int mss_spi_apply_clk(struct mss_spi_dsc *s,
+			     const struct mss_spi_dev_cfg *cfg)
+{
+	if (s->clk_valid && s->clk_gen == cfg->clk_gen &&
+	    s->clk_mode == cfg->clk_mode)
+		return 0;
+
+	s->clk_gen = cfg->clk_gen;
+	s->clk_mode = cfg->clk_mode;
 
 	if (mss_spi_clk_gen_set(s)) {
+		s->clk_valid = false;
+		return -EINVAL;
+	}
+
+	s->clk_valid = true;
+
+	return 0;
+}
+
+static int mss_spi_transfer_one(struct spi_master *master,
+				struct spi_device *spi,
+				struct spi_transfer *tfr)
+{
+	struct mss_spi_dsc *s = spi_master_get_devdata(master);
+	struct mss_spi_dev_cfg *cfg = spi_get_ctldata(spi);
+	struct mss_spi_dev_cfg tfr_cfg;
+	int ret;
+
+	/* only transfers overriding the device rate need a new divider */
+	if (tfr->speed_hz != cfg->speed_hz) {
+		ret = mss_spi_calc_clk(master, spi, tfr->speed_hz, &tfr_cfg);
+		if (ret)
+			return ret;
+		cfg = &tfr_cfg;
+	}
+
+	if (mss_spi_apply_clk(s, cfg)) {
 		dev_err(&spi->dev, "can't set clk divider\n");
 		return -EINVAL;
 	}
@@ -569,6 +673,9 @@ static int mss_spi_transfer_one(struct spi_master *master,
 	s->rx_len = tfr->len;
 	s->pending = 0;
 
+	if (tfr->len <= MSS_SPI_POLL_MAX_LEN)
+		return mss_spi_transfer_one_poll(master, spi, tfr);
+
 	mss_spi_hw_tfsz_set(s, (s->tx_len > MSS_SPI_FIFO_DEPTH)
 			? MSS_SPI_FIFO_DEPTH : s->tx_len);
 
@@ -576,6 +683,33 @@ static int mss_spi_transfer_one(struct spi_master *master,
 	return mss_spi_transfer_one_irq(master, spi, tfr);
 }
 
+static int mss_spi_setup(struct spi_device *spi)
+{
+	struct mss_spi_dev_cfg *cfg = spi_get_ctldata(spi);
+	int ret;
+
+	if (!cfg) {
+		cfg = kzalloc(sizeof(*cfg), GFP_KERNEL);
+		if (!cfg)
+			return -ENOMEM;
+		spi_set_ctldata(spi, cfg);
+	}
+
+	ret = mss_spi_calc_clk(spi->master, spi, spi->max_speed_hz, cfg);
+	if (ret) {
+		spi_set_ctldata(spi, NULL);
+		kfree(cfg);
+	}
+
+	return ret;
+}
+
+static void mss_spi_cleanup(struct spi_device *spi)
+{
+	kfree(spi_get_ctldata(spi));
+	spi_set_ctldata(spi, NULL);
+}
+
 
 static int mss_spi_prepare_message(struct spi_master *master,
 				   struct spi_message *msg)
@@ -610,6 +744,12 @@ static int mss_spi_prepare_message(struct spi_master *master,
 		goto done;
 	}
 
+	/* program the device's cached divider once per message */
+	if (mss_spi_apply_clk(s, spi_get_ctldata(spi))) {
+		dev_err(&spi->dev, "can't set clk divider\n");
+		ret = -EINVAL;
+	}
+
 done:
 	return ret;
 }
@@ -661,6 +801,8 @@ static int mss_spi_probe(struct platform_device *pdev)
 	master->bits_per_word_mask = SPI_BPW_MASK(8);
 	master->num_chipselect = -1;
 	master->transfer_one = mss_spi_transfer_one;
+	master->setup = mss_spi_setup;
+	master->cleanup = mss_spi_cleanup;
 	master->handle_err = mss_spi_handle_err;
 	master->prepare_message = mss_spi_prepare_message;
 	master->unprepare_message = mss_spi_unprepare_message;
@@ -725,6 +867,8 @@ static int mss_spi_probe(struct platform_device *pdev)
 		return err;
 	}
 
+	s->clk_hz = clk_get_rate(s->clk);
+
 	/* get master's max spi clock rate  from DT */
 	err = of_property_read_u32(pdev->dev.of_node,
 		"spi-max-frequency",
@@ -825,6 +969,7 @@ static struct platform_driver mss_spi_driver = {
 		.pm = MICROSEMI_SPI_PM_OPS,
 		.of_match_table = of_match_ptr(mss_spi_dt_ids),
 		.owner = THIS_MODULE,
+		.probe_type = PROBE_PREFER_ASYNCHRONOUS,
 	},
 	.remove = mss_spi_remove,
 };
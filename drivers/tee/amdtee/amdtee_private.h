@@ -29,6 +29,13 @@
 /* Maximum number of sessions which can be opened with a Trusted Application */
 #define TEE_NUM_SESSIONS			32
 
+/*
+ * Freed shared buffers of up to 64 KiB are kept mapped in the TEE, at most
+ * SHM_CACHE_DEPTH of each size.
+ */
+#define SHM_CACHE_MAX_ORDER			4
+#define SHM_CACHE_DEPTH				8
+
 #define TA_LOAD_PATH				"/amdtee"
 #define TA_PATH_MAX				60
 
@@ -65,13 +72,9 @@ struct amdtee_session {
 /**
  * struct amdtee_context_data - AMD-TEE driver context data
  * @sess_list:    Keeps track of sessions opened in current TEE context
- * @shm_list:     Keeps track of buffers allocated and mapped in current TEE
- *                context
  */
 struct amdtee_context_data {
 	struct list_head sess_list;
-	struct list_head shm_list;
-	struct mutex shm_mutex;   /* synchronizes access to @shm_list */
 };
 
 struct amdtee_driver_data {
@@ -99,11 +102,16 @@ struct amdtee_shm_data {
  *			   Processor
  * @ta_handle:	Handle to TA loaded in TEE
  * @refcount:	Reference count for the loaded TA
+ * @uuid:	UUID the TA was loaded for
+ * @lru_node:	Entry in the list of unreferenced TAs kept loaded, only
+ *		valid while @refcount is zero
  */
 struct amdtee_ta_data {
 	struct list_head list_node;
 	u32 ta_handle;
 	u32 refcount;
+	u8 uuid[TEE_IOCTL_UUID_LEN];
+	struct list_head lru_node;
 };
 
 #define LOWER_TWO_BYTE_MASK	0x0000FFFF
@@ -154,6 +162,10 @@ int handle_load_ta(void *data, u32 size,
 
 int handle_unload_ta(u32 ta_handle);
 
+int amdtee_ta_cache_get(const u8 *uuid, u32 *ta_handle);
+
+void amdtee_ta_cache_flush(void);
+
 int handle_open_session(struct tee_ioctl_open_session_arg *arg, u32 *info,
 			struct tee_param *p);
 
@@ -4,6 +4,8 @@
  */
 
 #include <linux/device.h>
+#include <linux/moduleparam.h>
+#include <linux/string.h>
 #include <linux/tee.h>
 #include <linux/tee_drv.h>
 #include <linux/psp-tee.h>
@@ -121,23 +123,41 @@ static int amd_params_to_tee_params(struct tee_param *tee, u32 count,
 	return ret;
 }
 
+/*
+ * TAs whose last session has been closed stay loaded, up to ta_cache_size of
+ * them, so that the next session does not have to copy and authenticate
+ * the binary again. The least recently used one is unloaded first.
+ */
+static unsigned int ta_cache_size = 4;
+module_param(ta_cache_size, uint, 0644);
+MODULE_PARM_DESC(ta_cache_size,
+		 "Number of unused TAs kept loaded (0 = unload immediately)");
+
 static DEFINE_MUTEX(ta_refcount_mutex);
 static struct list_head ta_list = LIST_HEAD_INIT(ta_list);
+static LIST_HEAD(ta_lru);
+static unsigned int ta_lru_len;
 
-static u32 get_ta_refcount(u32 ta_handle)
+static u32 get_ta_refcount(u32 ta_handle, const u8 *uuid)
 {
 	struct amdtee_ta_data *ta_data;
 	u32 count = 0;
 
 	/* Caller must hold a mutex */
 	list_for_each_entry(ta_data, &ta_list, list_node)
-		if (ta_data->ta_handle == ta_handle)
-			return ++ta_data->refcount;
+		if (ta_data->ta_handle == ta_handle) {
+			if (!ta_data->refcount++) {
+				list_del(&ta_data->lru_node);
+				ta_lru_len--;
+			}
+			return ta_data->refcount;
+		}
 
 	ta_data = kzalloc(sizeof(*ta_data), GFP_KERNEL);
 	if (ta_data) {
 		ta_data->ta_handle = ta_handle;
 		ta_data->refcount = 1;
+		memcpy(ta_data->uuid, uuid, sizeof(ta_data->uuid));
 		count = ta_data->refcount;
 		list_add(&ta_data->list_node, &ta_list);
 	}
@@ -145,44 +165,48 @@ static u32 get_ta_refcount(u32 ta_handle)
 	return count;
 }
 
+/*
+ * Drops a reference and returns the handle of the TA to unload, 0 if none:
+ * @ta_handle itself when the cache is disabled, the least recently used
+ * unreferenced TA when the cache overflows. Caller must hold a mutex.
+ */
 static u32 put_ta_refcount(u32 ta_handle)
 {
 	struct amdtee_ta_data *ta_data;
-	u32 count = 0;
 
-	/* Caller must hold a mutex */
 	list_for_each_entry(ta_data, &ta_list, list_node)
-		if (ta_data->ta_handle == ta_handle) {
-			count = --ta_data->refcount;
-			if (count == 0) {
-				list_del(&ta_data->list_node);
-				kfree(ta_data);
-				break;
-			}
-		}
+		if (ta_data->ta_handle == ta_handle)
+			goto found;
 
-	return count;
-}
+	/* Not tracked, e.g. the load failed half way: unload it */
+	return ta_handle;
 
-int handle_unload_ta(u32 ta_handle)
-{
-	struct tee_cmd_unload_ta cmd = {0};
-	u32 status, count;
-	int ret;
+found:
+	if (--ta_data->refcount) {
+		pr_debug("unload ta: not unloading %u count %u\n",
+			 ta_handle, ta_data->refcount);
+		return 0;
+	}
 
-	if (!ta_handle)
-		return -EINVAL;
+	list_add(&ta_data->lru_node, &ta_lru);
+	if (++ta_lru_len <= ta_cache_size)
+		return 0;
 
-	mutex_lock(&ta_refcount_mutex);
+	ta_data = list_last_entry(&ta_lru, struct amdtee_ta_data, lru_node);
+	list_del(&ta_data->lru_node);
+	list_del(&ta_data->list_node);
+	ta_lru_len--;
+	ta_handle = ta_data->ta_handle;
+	kfree(ta_data);
 
-	count = put_ta_refcount(ta_handle);
+	return ta_handle;
+}
 
-	if (count) {
-		pr_debug("unload ta: not unloading %u count %u\n",
-			 ta_handle, count);
-		ret = -EBUSY;
-		goto unlock;
-	}
+static int unload_ta(u32 ta_handle)
+{
+	struct tee_cmd_unload_ta cmd = {0};
+	u32 status;
+	int ret;
 
 	cmd.ta_handle = ta_handle;
 
@@ -195,11 +219,66 @@ int handle_unload_ta(u32 ta_handle)
 		pr_debug("unloaded ta handle %u\n", ta_handle);
 	}
 
-unlock:
+	return ret;
+}
+
+int handle_unload_ta(u32 ta_handle)
+{
+	int ret = 0;
+
+	if (!ta_handle)
+		return -EINVAL;
+
+	mutex_lock(&ta_refcount_mutex);
+	ta_handle = put_ta_refcount(ta_handle);
+	if (ta_handle)
+		ret = unload_ta(ta_handle);
 	mutex_unlock(&ta_refcount_mutex);
+
 	return ret;
 }
 
+/**
+ * amdtee_ta_cache_get() - Take a reference on an already loaded TA
+ * @uuid:	UUID of the TA
+ * @ta_handle:	[out] handle of the TA
+ *
+ * Returns 0 if a TA loaded for @uuid was found, -ENOENT otherwise.
+ */
+int amdtee_ta_cache_get(const u8 *uuid, u32 *ta_handle)
+{
+	struct amdtee_ta_data *ta_data;
+	int ret = -ENOENT;
+
+	mutex_lock(&ta_refcount_mutex);
+	list_for_each_entry(ta_data, &ta_list, list_node)
+		if (!memcmp(ta_data->uuid, uuid, sizeof(ta_data->uuid))) {
+			get_ta_refcount(ta_data->ta_handle, uuid);
+			*ta_handle = ta_data->ta_handle;
+			ret = 0;
+			break;
+		}
+	mutex_unlock(&ta_refcount_mutex);
+
+	return ret;
+}
+
+/* Unload every TA that is only kept loaded by the cache */
+void amdtee_ta_cache_flush(void)
+{
+	struct amdtee_ta_data *ta_data, *tmp;
+
+	mutex_lock(&ta_refcount_mutex);
+	list_for_each_entry_safe(ta_data, tmp, &ta_lru, lru_node) {
+		list_del(&ta_data->lru_node);
+		list_del(&ta_data->list_node);
+		unload_ta(ta_data->ta_handle);
+		kfree(ta_data);
+	}
+	ta_lru_len = 0;
+	mutex_unlock(&ta_refcount_mutex);
+}
+
 int handle_close_session(u32 ta_handle, u32 info)
 {
 	struct tee_cmd_close_session cmd = {0};
@@ -424,7 +503,7 @@ int handle_load_ta(void *data, u32 size, struct tee_ioctl_open_session_arg *arg)
 		arg->ret_origin = TEEC_ORIGIN_COMMS;
 		arg->ret = TEEC_ERROR_COMMUNICATION;
 	} else if (arg->ret == TEEC_SUCCESS) {
-		ret = get_ta_refcount(load_cmd.ta_handle);
+		ret = get_ta_refcount(load_cmd.ta_handle, arg->uuid);
 		if (!ret) {
 			arg->ret_origin = TEEC_ORIGIN_COMMS;
 			arg->ret = TEEC_ERROR_OUT_OF_MEMORY;
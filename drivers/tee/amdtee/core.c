@@ -14,6 +14,8 @@
 #include <linux/mm.h>
 #include <linux/uaccess.h>
 #include <linux/firmware.h>
+#include <linux/uuid.h>
+#include <linux/workqueue.h>
 #include "amdtee_private.h"
 #include "../tee_private.h"
 #include <linux/psp-tee.h>
@@ -21,6 +23,13 @@
 static struct amdtee_driver_data *drv_data;
 static DEFINE_MUTEX(session_list_mutex);
 
+/*
+ * Buffers allocated and mapped in TEE. The list is global rather than per
+ * context, as the pool keeps buffers mapped after their context is gone.
+ */
+static LIST_HEAD(shm_list);
+static DEFINE_MUTEX(shm_mutex);	/* synchronizes access to @shm_list */
+
 static void amdtee_get_version(struct tee_device *teedev,
 			       struct tee_ioctl_version_data *vers)
 {
@@ -41,8 +50,6 @@ static int amdtee_open(struct tee_context *ctx)
 		return -ENOMEM;
 
 	INIT_LIST_HEAD(&ctxdata->sess_list);
-	INIT_LIST_HEAD(&ctxdata->shm_list);
-	mutex_init(&ctxdata->shm_mutex);
 
 	ctx->data = ctxdata;
 	return 0;
@@ -85,7 +92,6 @@ static void amdtee_release(struct tee_context *ctx)
 		list_del(&sess->list_node);
 		release_session(sess);
 	}
-	mutex_destroy(&ctxdata->shm_mutex);
 	kfree(ctxdata);
 
 	ctx->data = NULL;
@@ -152,23 +158,22 @@ static struct amdtee_session *find_session(struct amdtee_context_data *ctxdata,
 
 u32 get_buffer_id(struct tee_shm *shm)
 {
-	struct amdtee_context_data *ctxdata = shm->ctx->data;
 	struct amdtee_shm_data *shmdata;
 	u32 buf_id = 0;
 
-	mutex_lock(&ctxdata->shm_mutex);
-	list_for_each_entry(shmdata, &ctxdata->shm_list, shm_node)
+	mutex_lock(&shm_mutex);
+	list_for_each_entry(shmdata, &shm_list, shm_node)
 		if (shmdata->kaddr == shm->kaddr) {
 			buf_id = shmdata->buf_id;
 			break;
 		}
-	mutex_unlock(&ctxdata->shm_mutex);
+	mutex_unlock(&shm_mutex);
 
 	return buf_id;
 }
 
 static DEFINE_MUTEX(drv_mutex);
-static int copy_ta_binary(struct tee_context *ctx, void *ptr, void **ta,
+static int copy_ta_binary(struct device *dev, void *ptr, void **ta,
 			  size_t *ta_size)
 {
 	const struct firmware *fw;
@@ -194,7 +199,7 @@ static int copy_ta_binary(struct tee_context *ctx, void *ptr, void **ta,
 	}
 
 	mutex_lock(&drv_mutex);
-	n = request_firmware(&fw, fw_name, &ctx->teedev->dev);
+	n = request_firmware(&fw, fw_name, dev);
 	if (n) {
 		pr_err("failed to load firmware %s\n", fw_name);
 		rc = -ENOMEM;
@@ -245,16 +250,25 @@ int amdtee_open_session(struct tee_context *ctx,
 		return -EINVAL;
 	}
 
-	rc = copy_ta_binary(ctx, &arg->uuid[0], &ta, &ta_size);
-	if (rc) {
-		pr_err("failed to copy TA binary\n");
-		return rc;
-	}
+	if (!amdtee_ta_cache_get(arg->uuid, &ta_handle)) {
+		/* Still loaded for an earlier or concurrent session */
+		ta = NULL;
+		ta_size = 0;
+		arg->ret = TEEC_SUCCESS;
+		set_session_id(ta_handle, 0, &arg->session);
+	} else {
+		rc = copy_ta_binary(&ctx->teedev->dev, &arg->uuid[0], &ta,
+				    &ta_size);
+		if (rc) {
+			pr_err("failed to copy TA binary\n");
+			return rc;
+		}
 
-	/* Load the TA binary into TEE environment */
-	handle_load_ta(ta, ta_size, arg);
-	if (arg->ret != TEEC_SUCCESS)
-		goto out;
+		/* Load the TA binary into TEE environment */
+		handle_load_ta(ta, ta_size, arg);
+		if (arg->ret != TEEC_SUCCESS)
+			goto out;
+	}
 
 	ta_handle = get_ta_handle(arg->session);
 
@@ -298,7 +312,8 @@ int amdtee_open_session(struct tee_context *ctx,
 	sess->session_info[i] = session_info;
 	set_session_id(ta_handle, i, &arg->session);
 out:
-	free_pages((u64)ta, get_order(ta_size));
+	if (ta)
+		free_pages((u64)ta, get_order(ta_size));
 	return rc;
 }
 
@@ -340,7 +355,6 @@ int amdtee_close_session(struct tee_context *ctx, u32 session)
 
 int amdtee_map_shmem(struct tee_shm *shm)
 {
-	struct amdtee_context_data *ctxdata;
 	struct amdtee_shm_data *shmnode;
 	struct shmem_desc shmem;
 	int rc, count;
@@ -370,10 +384,9 @@ int amdtee_map_shmem(struct tee_shm *shm)
 
 	shmnode->kaddr = shm->kaddr;
 	shmnode->buf_id = buf_id;
-	ctxdata = shm->ctx->data;
-	mutex_lock(&ctxdata->shm_mutex);
-	list_add(&shmnode->shm_node, &ctxdata->shm_list);
-	mutex_unlock(&ctxdata->shm_mutex);
+	mutex_lock(&shm_mutex);
+	list_add(&shmnode->shm_node, &shm_list);
+	mutex_unlock(&shm_mutex);
 
 	pr_debug("buf_id :[%x] kaddr[%p]\n", shmnode->buf_id, shmnode->kaddr);
 
@@ -382,7 +395,6 @@ int amdtee_map_shmem(struct tee_shm *shm)
 
 void amdtee_unmap_shmem(struct tee_shm *shm)
 {
-	struct amdtee_context_data *ctxdata;
 	struct amdtee_shm_data *shmnode;
 	u32 buf_id;
 
@@ -393,15 +405,14 @@ void amdtee_unmap_shmem(struct tee_shm *shm)
 	/* Unmap the shared memory from TEE */
 	handle_unmap_shmem(buf_id);
 
-	ctxdata = shm->ctx->data;
-	mutex_lock(&ctxdata->shm_mutex);
-	list_for_each_entry(shmnode, &ctxdata->shm_list, shm_node)
+	mutex_lock(&shm_mutex);
+	list_for_each_entry(shmnode, &shm_list, shm_node)
 		if (buf_id == shmnode->buf_id) {
 			list_del(&shmnode->shm_node);
 			kfree(shmnode);
 			break;
 		}
-	mutex_unlock(&ctxdata->shm_mutex);
+	mutex_unlock(&shm_mutex);
 }
 
 int amdtee_invoke_func(struct tee_context *ctx,
@@ -434,6 +445,58 @@ int amdtee_cancel_req(struct tee_context *ctx, u32 cancel_id, u32 session)
 	return -EINVAL;
 }
 
+/*
+ * TAs listed in "prefetch" are loaded in the background at init and parked
+ * in the TA cache, so that the first session does not pay for the load.
+ */
+static char *prefetch;
+module_param(prefetch, charp, 0444);
+MODULE_PARM_DESC(prefetch, "Comma separated list of TA UUIDs to load at init");
+
+static void amdtee_prefetch_work(struct work_struct *work)
+{
+	struct tee_ioctl_open_session_arg arg;
+	char *list, *cur, *str;
+	size_t ta_size;
+	uuid_t uuid;
+	void *ta;
+
+	list = kstrdup(prefetch, GFP_KERNEL);
+	if (!list)
+		return;
+
+	cur = list;
+	while ((str = strsep(&cur, ",")) != NULL) {
+		if (!*str)
+			continue;
+
+		if (uuid_parse(strim(str), &uuid)) {
+			pr_err("prefetch: invalid TA UUID %s\n", str);
+			continue;
+		}
+
+		memset(&arg, 0, sizeof(arg));
+		export_uuid(arg.uuid, &uuid);
+
+		if (copy_ta_binary(&drv_data->amdtee->teedev->dev, arg.uuid,
+				   &ta, &ta_size))
+			continue;
+
+		handle_load_ta(ta, ta_size, &arg);
+		free_pages((u64)ta, get_order(ta_size));
+
+		/* Drop the load reference, leaving the TA in the cache */
+		if (arg.ret == TEEC_SUCCESS)
+			handle_unload_ta(get_ta_handle(arg.session));
+		else
+			pr_err("prefetch: failed to load TA %pUb\n", arg.uuid);
+	}
+
+	kfree(list);
+}
+
+static DECLARE_WORK(prefetch_work, amdtee_prefetch_work);
+
 static const struct tee_driver_ops amdtee_ops = {
 	.get_version = amdtee_get_version,
 	.open = amdtee_open,
@@ -495,6 +558,9 @@ static int __init amdtee_driver_init(void)
 
 	drv_data->amdtee = amdtee;
 
+	if (prefetch)
+		schedule_work(&prefetch_work);
+
 	pr_info("amd-tee driver initialization successful\n");
 	return 0;
 
@@ -525,7 +591,9 @@ static void __exit amdtee_driver_exit(void)
 
 	amdtee = drv_data->amdtee;
 
+	cancel_work_sync(&prefetch_work);
 	tee_device_unregister(amdtee->teedev);
+	amdtee_ta_cache_flush();
 	tee_shm_pool_free(amdtee->pool);
 }
 module_exit(amdtee_driver_exit);
@@ -56,13 +56,19 @@ static const struct tee_shm_pool_mgr_ops pool_ops = {
 static struct tee_shm_pool_mgr *pool_mem_mgr_alloc(void)
 {
 	struct tee_shm_pool_mgr *mgr = kzalloc(sizeof(*mgr), GFP_KERNEL);
+	struct tee_shm_pool_mgr *cached;
 
 	if (!mgr)
 		return ERR_PTR(-ENOMEM);
 
 	mgr->ops = &pool_ops;
 
-	return mgr;
+	cached = tee_shm_pool_mgr_alloc_cached(mgr, SHM_CACHE_MAX_ORDER,
+					       SHM_CACHE_DEPTH);
+	if (IS_ERR(cached))
+		kfree(mgr);
+
+	return cached;
 }
 
 struct tee_shm_pool *amdtee_config_shm(void)
@@ -0,0 +1,479 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * PolarFire SoC TEE driver - calls into the secure monitor
+ */
+
+#include <linux/err.h>
+#include <linux/errno.h>
+#include <linux/mm.h>
+#include <linux/slab.h>
+#include <linux/string.h>
+#include <linux/tee_drv.h>
+#include <linux/types.h>
+#include <linux/uuid.h>
+#include <asm/sbi.h>
+#include "mpfstee_private.h"
+
+/**
+ * mpfstee_do_call_with_arg() - hand a message argument to the secure monitor
+ * @ctx:	calling context
+ * @parg:	physical address of the struct mpfstee_msg_arg
+ *
+ * Calls are not serialised: every hart may have one in flight. When the
+ * monitor has no free thread the caller sleeps until another call returns,
+ * or at most one tick, and tries again.
+ *
+ * Returns 0 on success or a negative errno if the call could not be made,
+ * the result of the call itself is in the message argument.
+ */
+int mpfstee_do_call_with_arg(struct tee_context *ctx, phys_addr_t parg)
+{
+	struct mpfstee *mpfstee = tee_get_drvdata(ctx->teedev);
+	struct sbiret ret;
+	int seq, rc = 0;
+
+	for (;;) {
+		seq = atomic_read(&mpfstee->call_seq);
+		ret = sbi_ecall(SBI_EXT_MICROCHIP_TECHNOLOGY,
+				MPFSTEE_SBI_CALL_WITH_ARG, parg, 0, 0, 0, 0, 0);
+		if (ret.error) {
+			rc = sbi_err_map_linux_errno(ret.error);
+			break;
+		}
+
+		if (ret.value != MPFSTEE_SBI_RET_BUSY)
+			break;
+
+		wait_event_timeout(mpfstee->call_wq,
+				   atomic_read(&mpfstee->call_seq) != seq, 1);
+	}
+
+	atomic_inc(&mpfstee->call_seq);
+	if (wq_has_sleeper(&mpfstee->call_wq))
+		wake_up_all(&mpfstee->call_wq);
+
+	return rc;
+}
+
+static struct tee_shm *get_msg_arg(struct tee_context *ctx, size_t num_params,
+				   struct mpfstee_msg_arg **msg_arg,
+				   phys_addr_t *msg_parg)
+{
+	struct tee_shm *shm;
+	int rc;
+
+	shm = tee_shm_alloc(ctx, MPFSTEE_MSG_GET_ARG_SIZE(num_params),
+			    TEE_SHM_MAPPED);
+	if (IS_ERR(shm))
+		return shm;
+
+	*msg_arg = tee_shm_get_va(shm, 0);
+	if (IS_ERR(*msg_arg)) {
+		rc = PTR_ERR(*msg_arg);
+		goto err;
+	}
+
+	rc = tee_shm_get_pa(shm, 0, msg_parg);
+	if (rc)
+		goto err;
+
+	memset(*msg_arg, 0, MPFSTEE_MSG_GET_ARG_SIZE(num_params));
+	(*msg_arg)->num_params = num_params;
+
+	return shm;
+err:
+	tee_shm_free(shm);
+	return ERR_PTR(rc);
+}
+
+/*
+ * Registered memory is passed by reference so that the monitor can use its
+ * own mapping, anything else comes from the driver pool and is contiguous.
+ */
+static int to_msg_param_mem(struct mpfstee_msg_param *mp,
+			    const struct tee_param *p)
+{
+	u32 dir = p->attr - TEE_IOCTL_PARAM_ATTR_TYPE_MEMREF_INPUT;
+	struct tee_shm *shm = p->u.memref.shm;
+	phys_addr_t pa;
+	int rc;
+
+	if (shm && tee_shm_is_registered(shm)) {
+		mp->attr = MPFSTEE_MSG_ATTR_TYPE_RMEM_INPUT + dir;
+		mp->u.rmem.offs = p->u.memref.shm_offs;
+		mp->u.rmem.size = p->u.memref.size;
+		mp->u.rmem.shm_ref = (unsigned long)shm;
+		return 0;
+	}
+
+	mp->attr = MPFSTEE_MSG_ATTR_TYPE_TMEM_INPUT + dir;
+	mp->u.tmem.size = p->u.memref.size;
+
+	/* NULL memref */
+	if (!shm)
+		return 0;
+
+	rc = tee_shm_get_pa(shm, p->u.memref.shm_offs, &pa);
+	if (rc)
+		return rc;
+
+	mp->u.tmem.buf_ptr = pa;
+	mp->u.tmem.shm_ref = (unsigned long)shm;
+
+	return 0;
+}
+
+static int to_msg_param(struct mpfstee_msg_param *msg_params,
+			size_t num_params, const struct tee_param *params)
+{
+	size_t n;
+	int rc;
+
+	for (n = 0; n < num_params; n++) {
+		const struct tee_param *p = params + n;
+		struct mpfstee_msg_param *mp = msg_params + n;
+
+		switch (p->attr) {
+		case TEE_IOCTL_PARAM_ATTR_TYPE_NONE:
+			mp->attr = MPFSTEE_MSG_ATTR_TYPE_NONE;
+			memset(&mp->u, 0, sizeof(mp->u));
+			break;
+		case TEE_IOCTL_PARAM_ATTR_TYPE_VALUE_INPUT:
+		case TEE_IOCTL_PARAM_ATTR_TYPE_VALUE_OUTPUT:
+		case TEE_IOCTL_PARAM_ATTR_TYPE_VALUE_INOUT:
+			mp->attr = MPFSTEE_MSG_ATTR_TYPE_VALUE_INPUT + p->attr -
+				   TEE_IOCTL_PARAM_ATTR_TYPE_VALUE_INPUT;
+			mp->u.value.a = p->u.value.a;
+			mp->u.value.b = p->u.value.b;
+			mp->u.value.c = p->u.value.c;
+			break;
+		case TEE_IOCTL_PARAM_ATTR_TYPE_MEMREF_INPUT:
+		case TEE_IOCTL_PARAM_ATTR_TYPE_MEMREF_OUTPUT:
+		case TEE_IOCTL_PARAM_ATTR_TYPE_MEMREF_INOUT:
+			rc = to_msg_param_mem(mp, p);
+			if (rc)
+				return rc;
+			break;
+		default:
+			return -EINVAL;
+		}
+	}
+
+	return 0;
+}
+
+/*
+ * Only the outputs are copied back: the parameter types and shared memory
+ * references stay as the TEE core set them up, since it drops the shm
+ * references itself once the call returns.
+ */
+static void from_msg_param(struct tee_param *params, size_t num_params,
+			   const struct mpfstee_msg_param *msg_params)
+{
+	size_t n;
+
+	for (n = 0; n < num_params; n++) {
+		struct tee_param *p = params + n;
+		const struct mpfstee_msg_param *mp = msg_params + n;
+
+		switch (mp->attr & MPFSTEE_MSG_ATTR_TYPE_MASK) {
+		case MPFSTEE_MSG_ATTR_TYPE_VALUE_OUTPUT:
+		case MPFSTEE_MSG_ATTR_TYPE_VALUE_INOUT:
+			p->u.value.a = mp->u.value.a;
+			p->u.value.b = mp->u.value.b;
+			p->u.value.c = mp->u.value.c;
+			break;
+		case MPFSTEE_MSG_ATTR_TYPE_RMEM_OUTPUT:
+		case MPFSTEE_MSG_ATTR_TYPE_RMEM_INOUT:
+			p->u.memref.size = mp->u.rmem.size;
+			break;
+		case MPFSTEE_MSG_ATTR_TYPE_TMEM_OUTPUT:
+		case MPFSTEE_MSG_ATTR_TYPE_TMEM_INOUT:
+			p->u.memref.size = mp->u.tmem.size;
+			break;
+		default:
+			break;
+		}
+	}
+}
+
+static struct mpfstee_session *find_session(struct mpfstee_context_data *ctxdata,
+					    u32 session_id)
+{
+	struct mpfstee_session *sess;
+
+	list_for_each_entry(sess, &ctxdata->sess_list, list_node)
+		if (sess->session_id == session_id)
+			return sess;
+
+	return NULL;
+}
+
+static int do_close_session(struct tee_context *ctx, u32 session)
+{
+	struct mpfstee_msg_arg *msg_arg;
+	phys_addr_t msg_parg;
+	struct tee_shm *shm;
+
+	shm = get_msg_arg(ctx, 0, &msg_arg, &msg_parg);
+	if (IS_ERR(shm))
+		return PTR_ERR(shm);
+
+	msg_arg->cmd = MPFSTEE_MSG_CMD_CLOSE_SESSION;
+	msg_arg->session = session;
+	mpfstee_do_call_with_arg(ctx, msg_parg);
+
+	tee_shm_free(shm);
+
+	return 0;
+}
+
+int mpfstee_open_session(struct tee_context *ctx,
+			 struct tee_ioctl_open_session_arg *arg,
+			 struct tee_param *param)
+{
+	struct mpfstee_context_data *ctxdata = ctx->data;
+	struct mpfstee_msg_arg *msg_arg;
+	struct mpfstee_session *sess;
+	phys_addr_t msg_parg;
+	struct tee_shm *shm;
+	uuid_t client_uuid;
+	int rc;
+
+	/* +2 for the meta parameters added below */
+	shm = get_msg_arg(ctx, arg->num_params + 2, &msg_arg, &msg_parg);
+	if (IS_ERR(shm))
+		return PTR_ERR(shm);
+
+	msg_arg->cmd = MPFSTEE_MSG_CMD_OPEN_SESSION;
+	msg_arg->cancel_id = arg->cancel_id;
+
+	/* The TA UUID and the client identity travel as meta values */
+	msg_arg->params[0].attr = MPFSTEE_MSG_ATTR_TYPE_VALUE_INPUT |
+				  MPFSTEE_MSG_ATTR_META;
+	msg_arg->params[1].attr = MPFSTEE_MSG_ATTR_TYPE_VALUE_INPUT |
+				  MPFSTEE_MSG_ATTR_META;
+	memcpy(&msg_arg->params[0].u.value, arg->uuid, sizeof(arg->uuid));
+	msg_arg->params[1].u.value.c = arg->clnt_login;
+
+	rc = tee_session_calc_client_uuid(&client_uuid, arg->clnt_login,
+					  arg->clnt_uuid);
+	if (rc)
+		goto out;
+	export_uuid((u8 *)&msg_arg->params[1].u.value, &client_uuid);
+
+	rc = to_msg_param(msg_arg->params + 2, arg->num_params, param);
+	if (rc)
+		goto out;
+
+	sess = kzalloc(sizeof(*sess), GFP_KERNEL);
+	if (!sess) {
+		rc = -ENOMEM;
+		goto out;
+	}
+
+	if (mpfstee_do_call_with_arg(ctx, msg_parg)) {
+		msg_arg->ret = TEEC_ERROR_COMMUNICATION;
+		msg_arg->ret_origin = TEEC_ORIGIN_COMMS;
+	}
+
+	if (msg_arg->ret == TEEC_SUCCESS) {
+		sess->session_id = msg_arg->session;
+		mutex_lock(&ctxdata->mutex);
+		list_add(&sess->list_node, &ctxdata->sess_list);
+		mutex_unlock(&ctxdata->mutex);
+	} else {
+		kfree(sess);
+	}
+
+	from_msg_param(param, arg->num_params, msg_arg->params + 2);
+
+	arg->session = msg_arg->session;
+	arg->ret = msg_arg->ret;
+	arg->ret_origin = msg_arg->ret_origin;
+out:
+	tee_shm_free(shm);
+
+	return rc;
+}
+
+int mpfstee_close_session(struct tee_context *ctx, u32 session)
+{
+	struct mpfstee_context_data *ctxdata = ctx->data;
+	struct mpfstee_session *sess;
+
+	/* Check that the session is valid and remove it from the list */
+	mutex_lock(&ctxdata->mutex);
+	sess = find_session(ctxdata, session);
+	if (sess)
+		list_del(&sess->list_node);
+	mutex_unlock(&ctxdata->mutex);
+	if (!sess)
+		return -EINVAL;
+	kfree(sess);
+
+	return do_close_session(ctx, session);
+}
+
+void mpfstee_release_sessions(struct tee_context *ctx)
+{
+	struct mpfstee_context_data *ctxdata = ctx->data;
+	struct mpfstee_session *sess, *tmp;
+
+	list_for_each_entry_safe(sess, tmp, &ctxdata->sess_list, list_node) {
+		list_del(&sess->list_node);
+		do_close_session(ctx, sess->session_id);
+		kfree(sess);
+	}
+}
+
+int mpfstee_invoke_func(struct tee_context *ctx,
+			struct tee_ioctl_invoke_arg *arg,
+			struct tee_param *param)
+{
+	struct mpfstee_context_data *ctxdata = ctx->data;
+	struct mpfstee_msg_arg *msg_arg;
+	struct mpfstee_session *sess;
+	phys_addr_t msg_parg;
+	struct tee_shm *shm;
+	int rc;
+
+	/* Check that the session is valid */
+	mutex_lock(&ctxdata->mutex);
+	sess = find_session(ctxdata, arg->session);
+	mutex_unlock(&ctxdata->mutex);
+	if (!sess)
+		return -EINVAL;
+
+	shm = get_msg_arg(ctx, arg->num_params, &msg_arg, &msg_parg);
+	if (IS_ERR(shm))
+		return PTR_ERR(shm);
+
+	msg_arg->cmd = MPFSTEE_MSG_CMD_INVOKE_COMMAND;
+	msg_arg->func = arg->func;
+	msg_arg->session = arg->session;
+	msg_arg->cancel_id = arg->cancel_id;
+
+	rc = to_msg_param(msg_arg->params, arg->num_params, param);
+	if (rc)
+		goto out;
+
+	if (mpfstee_do_call_with_arg(ctx, msg_parg)) {
+		msg_arg->ret = TEEC_ERROR_COMMUNICATION;
+		msg_arg->ret_origin = TEEC_ORIGIN_COMMS;
+	}
+
+	from_msg_param(param, arg->num_params, msg_arg->params);
+
+	arg->ret = msg_arg->ret;
+	arg->ret_origin = msg_arg->ret_origin;
+out:
+	tee_shm_free(shm);
+
+	return rc;
+}
+
+int mpfstee_cancel_req(struct tee_context *ctx, u32 cancel_id, u32 session)
+{
+	struct mpfstee_context_data *ctxdata = ctx->data;
+	struct mpfstee_msg_arg *msg_arg;
+	struct mpfstee_session *sess;
+	phys_addr_t msg_parg;
+	struct tee_shm *shm;
+
+	/* Check that the session is valid */
+	mutex_lock(&ctxdata->mutex);
+	sess = find_session(ctxdata, session);
+	mutex_unlock(&ctxdata->mutex);
+	if (!sess)
+		return -EINVAL;
+
+	shm = get_msg_arg(ctx, 0, &msg_arg, &msg_parg);
+	if (IS_ERR(shm))
+		return PTR_ERR(shm);
+
+	msg_arg->cmd = MPFSTEE_MSG_CMD_CANCEL;
+	msg_arg->session = session;
+	msg_arg->cancel_id = cancel_id;
+	mpfstee_do_call_with_arg(ctx, msg_parg);
+
+	tee_shm_free(shm);
+
+	return 0;
+}
+
+/*
+ * The pages are described to the monitor by a physically contiguous list of
+ * 64-bit page addresses. The offset of the buffer into its first page is
+ * carried in the low bits of buf_ptr, which the page aligned list leaves
+ * free.
+ */
+int mpfstee_shm_register(struct tee_context *ctx, struct tee_shm *shm,
+			 struct page **pages, size_t num_pages,
+			 unsigned long start)
+{
+	struct mpfstee_msg_arg *msg_arg;
+	size_t list_size, n;
+	phys_addr_t msg_parg;
+	struct tee_shm *shm_arg;
+	u64 *pages_list;
+	int rc = 0;
+
+	if (!num_pages)
+		return -EINVAL;
+
+	list_size = num_pages * sizeof(*pages_list);
+	pages_list = alloc_pages_exact(list_size, GFP_KERNEL);
+	if (!pages_list)
+		return -ENOMEM;
+
+	for (n = 0; n < num_pages; n++)
+		pages_list[n] = page_to_phys(pages[n]);
+
+	shm_arg = get_msg_arg(ctx, 1, &msg_arg, &msg_parg);
+	if (IS_ERR(shm_arg)) {
+		rc = PTR_ERR(shm_arg);
+		goto out;
+	}
+
+	msg_arg->cmd = MPFSTEE_MSG_CMD_REGISTER_SHM;
+	msg_arg->params[0].attr = MPFSTEE_MSG_ATTR_TYPE_TMEM_OUTPUT;
+	msg_arg->params[0].u.tmem.buf_ptr = virt_to_phys(pages_list) |
+					    tee_shm_get_page_offset(shm);
+	msg_arg->params[0].u.tmem.size = tee_shm_get_size(shm);
+	msg_arg->params[0].u.tmem.shm_ref = (unsigned long)shm;
+
+	if (mpfstee_do_call_with_arg(ctx, msg_parg) ||
+	    msg_arg->ret != TEEC_SUCCESS)
+		rc = -EINVAL;
+
+	tee_shm_free(shm_arg);
+out:
+	free_pages_exact(pages_list, list_size);
+
+	return rc;
+}
+
+int mpfstee_shm_unregister(struct tee_context *ctx, struct tee_shm *shm)
+{
+	struct mpfstee_msg_arg *msg_arg;
+	phys_addr_t msg_parg;
+	struct tee_shm *shm_arg;
+	int rc = 0;
+
+	shm_arg = get_msg_arg(ctx, 1, &msg_arg, &msg_parg);
+	if (IS_ERR(shm_arg))
+		return PTR_ERR(shm_arg);
+
+	msg_arg->cmd = MPFSTEE_MSG_CMD_UNREGISTER_SHM;
+	msg_arg->params[0].attr = MPFSTEE_MSG_ATTR_TYPE_RMEM_INPUT;
+	msg_arg->params[0].u.rmem.shm_ref = (unsigned long)shm;
+
+	if (mpfstee_do_call_with_arg(ctx, msg_parg) ||
+	    msg_arg->ret != TEEC_SUCCESS)
+		rc = -EINVAL;
+
+	tee_shm_free(shm_arg);
+
+	return rc;
+}
@@ -0,0 +1,166 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * PolarFire SoC TEE driver
+ *
+ * Trusted applications run under a secure monitor on the PolarFire SoC.
+ * Each request is described by a message argument in shared memory whose
+ * physical address is passed to the monitor through the Microchip SBI
+ * vendor extension, the same one the IHC mailbox driver uses.
+ */
+
+#define pr_fmt(fmt) "mpfstee: " fmt
+#include <linux/errno.h>
+#include <linux/module.h>
+#include <linux/slab.h>
+#include <linux/tee_drv.h>
+#include <linux/types.h>
+#include <asm/sbi.h>
+#include "mpfstee_private.h"
+
+static struct mpfstee *mpfstee;
+
+static void mpfstee_get_version(struct tee_device *teedev,
+				struct tee_ioctl_version_data *vers)
+{
+	struct tee_ioctl_version_data v = {
+		.impl_id = TEE_IMPL_ID_MPFSTEE,
+		.impl_caps = 0,
+		.gen_caps = TEE_GEN_CAP_GP | TEE_GEN_CAP_REG_MEM |
+			    TEE_GEN_CAP_MEMREF_NULL,
+	};
+	*vers = v;
+}
+
+static int mpfstee_open(struct tee_context *ctx)
+{
+	struct mpfstee_context_data *ctxdata;
+
+	ctxdata = kzalloc(sizeof(*ctxdata), GFP_KERNEL);
+	if (!ctxdata)
+		return -ENOMEM;
+
+	mutex_init(&ctxdata->mutex);
+	INIT_LIST_HEAD(&ctxdata->sess_list);
+
+	ctx->cap_memref_null = true;
+	ctx->data = ctxdata;
+	return 0;
+}
+
+static void mpfstee_release(struct tee_context *ctx)
+{
+	struct mpfstee_context_data *ctxdata = ctx->data;
+
+	if (!ctxdata)
+		return;
+
+	mpfstee_release_sessions(ctx);
+	mutex_destroy(&ctxdata->mutex);
+	kfree(ctxdata);
+
+	ctx->data = NULL;
+}
+
+static const struct tee_driver_ops mpfstee_ops = {
+	.get_version = mpfstee_get_version,
+	.open = mpfstee_open,
+	.release = mpfstee_release,
+	.open_session = mpfstee_open_session,
+	.close_session = mpfstee_close_session,
+	.invoke_func = mpfstee_invoke_func,
+	.cancel_req = mpfstee_cancel_req,
+	.shm_register = mpfstee_shm_register,
+	.shm_unregister = mpfstee_shm_unregister,
+};
+
+static const struct tee_desc mpfstee_desc = {
+	.name = DRIVER_NAME "-clnt",
+	.ops = &mpfstee_ops,
+	.owner = THIS_MODULE,
+};
+
+static int mpfstee_check_version(void)
+{
+	struct sbiret ret;
+
+	if (sbi_probe_extension(SBI_EXT_MICROCHIP_TECHNOLOGY) <= 0)
+		return -ENODEV;
+
+	ret = sbi_ecall(SBI_EXT_MICROCHIP_TECHNOLOGY, MPFSTEE_SBI_GET_VERSION,
+			0, 0, 0, 0, 0, 0);
+	if (ret.error)
+		return -ENODEV;
+
+	if (ret.value != MPFSTEE_ABI_VERSION) {
+		pr_err("unsupported secure monitor ABI version %ld\n",
+		       ret.value);
+		return -EINVAL;
+	}
+
+	return 0;
+}
+
+static int __init mpfstee_driver_init(void)
+{
+	struct tee_device *teedev;
+	struct tee_shm_pool *pool;
+	int rc;
+
+	rc = mpfstee_check_version();
+	if (rc)
+		return rc;
+
+	mpfstee = kzalloc(sizeof(*mpfstee), GFP_KERNEL);
+	if (!mpfstee)
+		return -ENOMEM;
+
+	init_waitqueue_head(&mpfstee->call_wq);
+	atomic_set(&mpfstee->call_seq, 0);
+
+	pool = mpfstee_config_shm();
+	if (IS_ERR(pool)) {
+		pr_err("shared pool configuration error\n");
+		rc = PTR_ERR(pool);
+		goto err_kfree_mpfstee;
+	}
+	mpfstee->pool = pool;
+
+	teedev = tee_device_alloc(&mpfstee_desc, NULL, pool, mpfstee);
+	if (IS_ERR(teedev)) {
+		rc = PTR_ERR(teedev);
+		goto err_free_pool;
+	}
+	mpfstee->teedev = teedev;
+
+	rc = tee_device_register(teedev);
+	if (rc)
+		goto err_device_unregister;
+
+	pr_info("initialized driver\n");
+	return 0;
+
+err_device_unregister:
+	tee_device_unregister(teedev);
+err_free_pool:
+	tee_shm_pool_free(pool);
+err_kfree_mpfstee:
+	kfree(mpfstee);
+	mpfstee = NULL;
+
+	return rc;
+}
+module_init(mpfstee_driver_init);
+
+static void __exit mpfstee_driver_exit(void)
+{
+	if (!mpfstee)
+		return;
+
+	tee_device_unregister(mpfstee->teedev);
+	tee_shm_pool_free(mpfstee->pool);
+	kfree(mpfstee);
+}
+module_exit(mpfstee_driver_exit);
+
+MODULE_DESCRIPTION("PolarFire SoC TEE driver");
+MODULE_LICENSE("GPL");
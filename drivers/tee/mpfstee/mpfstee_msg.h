@@ -0,0 +1,123 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+/*
+ * Message ABI between the PolarFire SoC TEE driver and the secure monitor.
+ *
+ * A call passes the physical address of a struct mpfstee_msg_arg to the
+ * monitor through the Microchip SBI vendor extension. The argument lives in
+ * driver-allocated, physically contiguous shared memory and is updated in
+ * place with the results.
+ */
+
+#ifndef MPFSTEE_MSG_H
+#define MPFSTEE_MSG_H
+
+#include <linux/bits.h>
+#include <linux/types.h>
+
+#define SBI_EXT_VENDOR_START			0x09000000
+#define MICROCHIP_TECHNOLOGY_MVENDOR_ID		0x029
+
+#define SBI_EXT_MICROCHIP_TECHNOLOGY	(SBI_EXT_VENDOR_START | \
+					MICROCHIP_TECHNOLOGY_MVENDOR_ID)
+
+/* SBI function IDs, after the IHC ones (0x0 - 0x4) */
+#define MPFSTEE_SBI_GET_VERSION		0x10
+#define MPFSTEE_SBI_CALL_WITH_ARG	0x11
+
+#define MPFSTEE_ABI_VERSION		1
+
+/* sbiret.value of MPFSTEE_SBI_CALL_WITH_ARG */
+#define MPFSTEE_SBI_RET_OK		0
+#define MPFSTEE_SBI_RET_BUSY		1	/* no free secure thread */
+
+/* mpfstee_msg_arg.cmd */
+#define MPFSTEE_MSG_CMD_OPEN_SESSION	0
+#define MPFSTEE_MSG_CMD_INVOKE_COMMAND	1
+#define MPFSTEE_MSG_CMD_CLOSE_SESSION	2
+#define MPFSTEE_MSG_CMD_CANCEL		3
+#define MPFSTEE_MSG_CMD_REGISTER_SHM	4
+#define MPFSTEE_MSG_CMD_UNREGISTER_SHM	5
+
+/*
+ * Parameter types. TMEM refers to physically contiguous memory by address,
+ * RMEM to memory registered earlier with MPFSTEE_MSG_CMD_REGISTER_SHM, by
+ * its shm_ref cookie and an offset.
+ */
+#define MPFSTEE_MSG_ATTR_TYPE_NONE		0x0
+#define MPFSTEE_MSG_ATTR_TYPE_VALUE_INPUT	0x1
+#define MPFSTEE_MSG_ATTR_TYPE_VALUE_OUTPUT	0x2
+#define MPFSTEE_MSG_ATTR_TYPE_VALUE_INOUT	0x3
+#define MPFSTEE_MSG_ATTR_TYPE_RMEM_INPUT	0x5
+#define MPFSTEE_MSG_ATTR_TYPE_RMEM_OUTPUT	0x6
+#define MPFSTEE_MSG_ATTR_TYPE_RMEM_INOUT	0x7
+#define MPFSTEE_MSG_ATTR_TYPE_TMEM_INPUT	0x9
+#define MPFSTEE_MSG_ATTR_TYPE_TMEM_OUTPUT	0xa
+#define MPFSTEE_MSG_ATTR_TYPE_TMEM_INOUT	0xb
+
+#define MPFSTEE_MSG_ATTR_TYPE_MASK		GENMASK(7, 0)
+
+/* Parameter is consumed by the monitor itself, e.g. the TA UUID */
+#define MPFSTEE_MSG_ATTR_META			BIT(8)
+
+/* Origin of mpfstee_msg_arg.ret, as in the GlobalPlatform client API */
+#define TEEC_ORIGIN_COMMS		0x00000002
+
+#define TEEC_SUCCESS			0x00000000
+#define TEEC_ERROR_COMMUNICATION	0xFFFF000E
+
+struct mpfstee_msg_param_tmem {
+	u64 buf_ptr;
+	u64 size;
+	u64 shm_ref;
+};
+
+struct mpfstee_msg_param_rmem {
+	u64 offs;
+	u64 size;
+	u64 shm_ref;
+};
+
+struct mpfstee_msg_param_value {
+	u64 a;
+	u64 b;
+	u64 c;
+};
+
+struct mpfstee_msg_param {
+	u64 attr;
+	union {
+		struct mpfstee_msg_param_tmem tmem;
+		struct mpfstee_msg_param_rmem rmem;
+		struct mpfstee_msg_param_value value;
+	} u;
+};
+
+/**
+ * struct mpfstee_msg_arg - call argument
+ * @cmd:	MPFSTEE_MSG_CMD_*
+ * @func:	trusted application function, for INVOKE_COMMAND
+ * @session:	session id, returned by OPEN_SESSION
+ * @cancel_id:	cancellation id, matched by CANCEL
+ * @pad:	must be zero
+ * @ret:	return value, TEEC_* codes
+ * @ret_origin:	origin of @ret
+ * @num_params:	number of entries in @params
+ * @params:	parameters
+ */
+struct mpfstee_msg_arg {
+	u32 cmd;
+	u32 func;
+	u32 session;
+	u32 cancel_id;
+	u32 pad;
+	u32 ret;
+	u32 ret_origin;
+	u32 num_params;
+	struct mpfstee_msg_param params[];
+};
+
+#define MPFSTEE_MSG_GET_ARG_SIZE(num_params) \
+	(sizeof(struct mpfstee_msg_arg) + \
+	 sizeof(struct mpfstee_msg_param) * (num_params))
+
+#endif /* MPFSTEE_MSG_H */
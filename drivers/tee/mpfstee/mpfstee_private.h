@@ -0,0 +1,71 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+/*
+ * PolarFire SoC TEE driver private definitions
+ */
+
+#ifndef MPFSTEE_PRIVATE_H
+#define MPFSTEE_PRIVATE_H
+
+#include <linux/atomic.h>
+#include <linux/list.h>
+#include <linux/mutex.h>
+#include <linux/tee_drv.h>
+#include <linux/types.h>
+#include <linux/wait.h>
+#include "mpfstee_msg.h"
+
+#define DRIVER_NAME	"mpfstee"
+
+/* Freed pool buffers of up to 64 KiB are kept for reuse, 8 of each size */
+#define MPFSTEE_SHM_CACHE_MAX_ORDER	4
+#define MPFSTEE_SHM_CACHE_DEPTH		8
+
+/**
+ * struct mpfstee - main service struct
+ * @teedev:	client device
+ * @pool:	shared memory pool
+ * @call_wq:	callers waiting for a secure thread to become free
+ * @call_seq:	bumped whenever a call returns, so waiters can retry
+ */
+struct mpfstee {
+	struct tee_device *teedev;
+	struct tee_shm_pool *pool;
+	wait_queue_head_t call_wq;
+	atomic_t call_seq;
+};
+
+struct mpfstee_session {
+	struct list_head list_node;
+	u32 session_id;
+};
+
+/**
+ * struct mpfstee_context_data - per open file data
+ * @mutex:	protects @sess_list
+ * @sess_list:	sessions opened through this context, closed on release
+ */
+struct mpfstee_context_data {
+	struct mutex mutex;
+	struct list_head sess_list;
+};
+
+/* call.c */
+int mpfstee_do_call_with_arg(struct tee_context *ctx, phys_addr_t parg);
+int mpfstee_open_session(struct tee_context *ctx,
+			 struct tee_ioctl_open_session_arg *arg,
+			 struct tee_param *param);
+int mpfstee_close_session(struct tee_context *ctx, u32 session);
+void mpfstee_release_sessions(struct tee_context *ctx);
+int mpfstee_invoke_func(struct tee_context *ctx,
+			struct tee_ioctl_invoke_arg *arg,
+			struct tee_param *param);
+int mpfstee_cancel_req(struct tee_context *ctx, u32 cancel_id, u32 session);
+int mpfstee_shm_register(struct tee_context *ctx, struct tee_shm *shm,
+			 struct page **pages, size_t num_pages,
+			 unsigned long start);
+int mpfstee_shm_unregister(struct tee_context *ctx, struct tee_shm *shm);
+
+/* shm_pool.c */
+struct tee_shm_pool *mpfstee_config_shm(void);
+
+#endif /* MPFSTEE_PRIVATE_H */
@@ -0,0 +1,100 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * Asynchronous invoke-command requests for in-kernel TEE clients
+ *
+ * Each request occupies a worker thread, which sleeps in the driver for
+ * the duration of the secure world call just like a synchronous caller
+ * would. The number of requests handed to workers is bounded so that the
+ * secure world threads are not exhausted by a single client; requests
+ * beyond that are queued and started as earlier ones complete.
+ */
+
+#include <linux/list.h>
+#include <linux/moduleparam.h>
+#include <linux/spinlock.h>
+#include <linux/tee_drv.h>
+#include <linux/workqueue.h>
+
+static unsigned int max_async_calls = 4;
+module_param(max_async_calls, uint, 0644);
+MODULE_PARM_DESC(max_async_calls,
+		 "Maximum number of asynchronous requests in the TEE at once");
+
+static DEFINE_SPINLOCK(async_lock);	/* protects async_queue, async_active */
+static LIST_HEAD(async_queue);
+static unsigned int async_active;
+
+static void tee_client_async_work(struct work_struct *work)
+{
+	struct tee_client_async_req *req, *next;
+	unsigned long flags;
+	int rc;
+
+	req = container_of(work, struct tee_client_async_req, work);
+	rc = tee_client_invoke_func(req->ctx, req->arg, req->param);
+
+	/* @req may be gone once done() returns */
+	req->done(req, rc);
+
+	spin_lock_irqsave(&async_lock, flags);
+	next = list_first_entry_or_null(&async_queue,
+					struct tee_client_async_req, node);
+	if (next)
+		list_del_init(&next->node);
+	else
+		async_active--;
+	spin_unlock_irqrestore(&async_lock, flags);
+
+	if (next)
+		queue_work(system_unbound_wq, &next->work);
+}
+
+int tee_client_invoke_func_async(struct tee_client_async_req *req)
+{
+	unsigned long flags;
+	bool run = false;
+
+	if (!req || !req->ctx || !req->arg || !req->done)
+		return -EINVAL;
+
+	INIT_LIST_HEAD(&req->node);
+	INIT_WORK(&req->work, tee_client_async_work);
+
+	spin_lock_irqsave(&async_lock, flags);
+	if (async_active < max(max_async_calls, 1U)) {
+		async_active++;
+		run = true;
+	} else {
+		list_add_tail(&req->node, &async_queue);
+	}
+	spin_unlock_irqrestore(&async_lock, flags);
+
+	if (run)
+		queue_work(system_unbound_wq, &req->work);
+
+	return 0;
+}
+EXPORT_SYMBOL_GPL(tee_client_invoke_func_async);
+
+bool tee_client_async_cancel(struct tee_client_async_req *req)
+{
+	struct tee_ioctl_cancel_arg arg = {
+		.cancel_id = req->arg->cancel_id,
+		.session = req->arg->session,
+	};
+	unsigned long flags;
+	bool dropped = false;
+
+	spin_lock_irqsave(&async_lock, flags);
+	if (!list_empty(&req->node)) {
+		list_del_init(&req->node);
+		dropped = true;
+	}
+	spin_unlock_irqrestore(&async_lock, flags);
+
+	if (!dropped)
+		tee_client_cancel_req(req->ctx, &arg);
+
+	return dropped;
+}
+EXPORT_SYMBOL_GPL(tee_client_async_cancel);
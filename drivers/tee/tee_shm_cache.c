@@ -0,0 +1,176 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * Shared memory manager keeping freed buffers for reuse
+ *
+ * Allocating a shared buffer typically costs a page allocation, zeroing
+ * and a round trip to the TEE to map it, and freeing it another round trip
+ * to unmap it. This manager sits on top of such a backing manager and
+ * keeps a few buffers of each order around, still mapped.
+ */
+
+#include <linux/list.h>
+#include <linux/mm.h>
+#include <linux/mutex.h>
+#include <linux/slab.h>
+#include <linux/string.h>
+#include <linux/tee_drv.h>
+
+struct tee_shm_cache_entry {
+	struct list_head node;
+	void *kaddr;
+	phys_addr_t paddr;
+	size_t size;
+};
+
+struct tee_shm_cache {
+	struct tee_shm_pool_mgr mgr;
+	struct tee_shm_pool_mgr *backing;
+	struct mutex mutex;	/* protects @free and @nr_free */
+	unsigned int max_order;
+	unsigned int depth;
+	unsigned int *nr_free;
+	struct list_head free[];
+};
+
+static struct tee_shm_cache *to_cache(struct tee_shm_pool_mgr *poolm)
+{
+	return container_of(poolm, struct tee_shm_cache, mgr);
+}
+
+static void cache_free_backing(struct tee_shm_cache *cache,
+			       struct tee_shm_cache_entry *entry)
+{
+	struct tee_shm shm = {
+		.kaddr = entry->kaddr,
+		.paddr = entry->paddr,
+		.size = entry->size,
+	};
+
+	cache->backing->ops->free(cache->backing, &shm);
+	kfree(entry);
+}
+
+static int cache_op_alloc(struct tee_shm_pool_mgr *poolm, struct tee_shm *shm,
+			  size_t size)
+{
+	struct tee_shm_cache *cache = to_cache(poolm);
+	unsigned int order = get_order(size);
+	struct tee_shm_cache_entry *entry = NULL;
+
+	if (order <= cache->max_order) {
+		mutex_lock(&cache->mutex);
+		entry = list_first_entry_or_null(&cache->free[order],
+						 struct tee_shm_cache_entry,
+						 node);
+		if (entry) {
+			list_del(&entry->node);
+			cache->nr_free[order]--;
+		}
+		mutex_unlock(&cache->mutex);
+	}
+
+	if (!entry)
+		return cache->backing->ops->alloc(cache->backing, shm, size);
+
+	shm->kaddr = entry->kaddr;
+	shm->paddr = entry->paddr;
+	shm->size = entry->size;
+	kfree(entry);
+
+	/* The buffer may have belonged to another context before */
+	if (shm->flags & TEE_SHM_DMA_BUF)
+		memset(shm->kaddr, 0, shm->size);
+
+	return 0;
+}
+
+static void cache_op_free(struct tee_shm_pool_mgr *poolm, struct tee_shm *shm)
+{
+	struct tee_shm_cache *cache = to_cache(poolm);
+	unsigned int order = get_order(shm->size);
+	struct tee_shm_cache_entry *entry;
+
+	if (order > cache->max_order)
+		goto free_backing;
+
+	entry = kmalloc(sizeof(*entry), GFP_KERNEL);
+	if (!entry)
+		goto free_backing;
+
+	entry->kaddr = shm->kaddr;
+	entry->paddr = shm->paddr;
+	entry->size = shm->size;
+
+	mutex_lock(&cache->mutex);
+	if (cache->nr_free[order] < cache->depth) {
+		list_add(&entry->node, &cache->free[order]);
+		cache->nr_free[order]++;
+		entry = NULL;
+	}
+	mutex_unlock(&cache->mutex);
+
+	if (!entry) {
+		shm->kaddr = NULL;
+		return;
+	}
+	kfree(entry);
+
+free_backing:
+	cache->backing->ops->free(cache->backing, shm);
+}
+
+static void cache_op_destroy_poolmgr(struct tee_shm_pool_mgr *poolm)
+{
+	struct tee_shm_cache *cache = to_cache(poolm);
+	struct tee_shm_cache_entry *entry, *tmp;
+	unsigned int order;
+
+	for (order = 0; order <= cache->max_order; order++)
+		list_for_each_entry_safe(entry, tmp, &cache->free[order], node)
+			cache_free_backing(cache, entry);
+
+	tee_shm_pool_mgr_destroy(cache->backing);
+	mutex_destroy(&cache->mutex);
+	kfree(cache->nr_free);
+	kfree(cache);
+}
+
+static const struct tee_shm_pool_mgr_ops cache_ops = {
+	.alloc = cache_op_alloc,
+	.free = cache_op_free,
+	.destroy_poolmgr = cache_op_destroy_poolmgr,
+};
+
+struct tee_shm_pool_mgr *
+tee_shm_pool_mgr_alloc_cached(struct tee_shm_pool_mgr *backing,
+			      unsigned int max_order, unsigned int depth)
+{
+	struct tee_shm_cache *cache;
+	unsigned int order;
+
+	if (max_order >= MAX_ORDER)
+		return ERR_PTR(-EINVAL);
+
+	cache = kzalloc(struct_size(cache, free, max_order + 1), GFP_KERNEL);
+	if (!cache)
+		return ERR_PTR(-ENOMEM);
+
+	cache->nr_free = kcalloc(max_order + 1, sizeof(*cache->nr_free),
+				 GFP_KERNEL);
+	if (!cache->nr_free) {
+		kfree(cache);
+		return ERR_PTR(-ENOMEM);
+	}
+
+	for (order = 0; order <= max_order; order++)
+		INIT_LIST_HEAD(&cache->free[order]);
+
+	mutex_init(&cache->mutex);
+	cache->backing = backing;
+	cache->max_order = max_order;
+	cache->depth = depth;
+	cache->mgr.ops = &cache_ops;
+
+	return &cache->mgr;
+}
+EXPORT_SYMBOL_GPL(tee_shm_pool_mgr_alloc_cached);
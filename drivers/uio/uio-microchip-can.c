@@ -29,8 +29,21 @@
 
 #define MAX_CAN_EVT	1
 
+/*
+ * Layout of the event page, mapped as the second UIO memory region. The
+ * handler acks INT_STATUS before userspace gets to look at it, so the acked
+ * bits are accumulated here instead. Userspace atomically fetches and
+ * clears status after each read() of the event count; count keeps the
+ * number of interrupts that were coalesced into it.
+ */
+struct can_uio_events {
+	atomic_t status;
+	atomic_t count;
+};
+
 struct uio_can_dev {
 	struct uio_info *uio_info;
+	struct can_uio_events *events;
 	struct clk *clk;
 	void __iomem *base;
 	int irq;
@@ -51,6 +64,9 @@ static irqreturn_t can_handler(int irq, struct uio_info *uio_info)
 	if (!(val & 0xffff) && (ioread32(base + CAN_INT_ENABLE) & 0xffff))
 		return IRQ_NONE;
 
+	atomic_or(val, &dev_info->events->status);
+	atomic_inc(&dev_info->events->count);
+
 	return IRQ_HANDLED;
 }
 
@@ -64,6 +80,7 @@ static void can_cleanup(struct device *dev, struct uio_can_dev *dev_info)
 		kfree(uio_info->name);
 	}
 	iounmap(dev_info->base);
+	free_page((unsigned long)dev_info->events);
 	kfree(dev_info->uio_info);
 	clk_disable(dev_info->clk);
 	clk_put(dev_info->clk);
@@ -128,13 +145,24 @@ static int can_probe(struct platform_device *pdev)
 		goto out_free;
 	}
 
+	dev_info->events = (void *)get_zeroed_page(GFP_KERNEL);
+	if (!dev_info->events) {
+		ret = -ENOMEM;
+		goto out_free;
+	}
+
 	uio_info = dev_info->uio_info;
 
 	uio_info->mem[0].addr = res->start;
 	uio_info->mem[0].size = resource_size(res);
 	uio_info->mem[0].memtype = UIO_MEM_PHYS;
 
-	uio_info->mem[1].size = 0;
+	uio_info->mem[1].name = "events";
+	uio_info->mem[1].addr = (phys_addr_t)(uintptr_t)dev_info->events;
+	uio_info->mem[1].size = PAGE_SIZE;
+	uio_info->mem[1].memtype = UIO_MEM_LOGICAL;
+
+	uio_info->mem[2].size = 0;
 
 	uio_info->name = kasprintf(GFP_KERNEL, "uiocan%d", cnt);
 	uio_info->version = DRV_VERSION;
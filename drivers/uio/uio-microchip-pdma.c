@@ -19,6 +19,7 @@
 #include <linux/platform_device.h>
 #include <linux/of.h>
 #include <linux/genalloc.h>
+#include <linux/interrupt.h>
 
 #define DRV_NAME "pdma-uio"
 #define DRV_VERSION "0.1"
@@ -35,7 +36,10 @@
 #define PDMA_CUR_SRC_ADDR				0x118 /* Read-only*/
 
 /* CTRL */
-
+#define PDMA_CLAIM_MASK		GENMASK(0, 0)
+#define PDMA_RUN_MASK		GENMASK(1, 1)
+#define PDMA_ENABLE_DONE_INT_MASK	GENMASK(14, 14)
+#define PDMA_ENABLE_ERR_INT_MASK	GENMASK(15, 15)
 #define PDMA_DONE_STATUS_MASK	GENMASK(30, 30)
 #define PDMA_ERR_STATUS_MASK	GENMASK(31, 31)
 
@@ -45,6 +49,54 @@
 
 #define PDMA_REG_BASE(ch)	(dev_info->base + (PDMA_CHAN_OFFSET * (ch)))
 
+static bool coalesce_events;
+module_param(coalesce_events, bool, 0444);
+MODULE_PARM_DESC(coalesce_events,
+		 "Export all channels through one UIO device with an event page");
+
+/*
+ * Layout of the event page, mapped as the second UIO memory region when
+ * coalesce_events is set. Source 2 * ch is the done interrupt of channel
+ * ch, source 2 * ch + 1 its error interrupt. Userspace atomically fetches
+ * and clears pending after each read() of the event count.
+ */
+struct pdma_uio_events {
+	atomic_t pending;			/* bitmap of sources */
+	u32 reserved;
+	atomic_t count[PDMA_NR_CH * 2];		/* interrupts per source */
+};
+
+static unsigned int dma_buf_size;
+module_param(dma_buf_size, uint, 0444);
+MODULE_PARM_DESC(dma_buf_size,
+		 "Size of the coherent buffer mapped per channel (0 = none)");
+
+/*
+ * Descriptor chain, mapped as the second UIO memory region of each pdmaN
+ * device. Userspace fills desc[] and writes the number of descriptors to
+ * the device node; the driver runs the segments back to back from the
+ * done interrupt and signals a single event once the chain completes or
+ * fails. done then holds the number of segments that completed and status
+ * is zero on success or the CTRL value of the failing segment.
+ */
+struct pdma_uio_desc {
+	u64 src;
+	u64 dst;
+	u64 size;
+	u32 xfer_type;
+	u32 reserved;
+};
+
+struct pdma_uio_chain {
+	u32 done;
+	u32 status;
+	u64 reserved;
+	struct pdma_uio_desc desc[];
+};
+
+#define PDMA_UIO_CHAIN_MAX \
+	((PAGE_SIZE - sizeof(struct pdma_uio_chain)) / sizeof(struct pdma_uio_desc))
+
 struct pdma_regs {
 	/* read-write regs */
 	void __iomem *ctrl;		/* 4 bytes */
@@ -61,27 +113,88 @@ struct pdma_regs {
 	void __iomem *cur_src_addr;	/* 8 bytes */
 };
 
+struct uio_pdma;
+
 struct uio_pdma_chan {
 	int txirq;
 	int errirq;
 	struct pdma_regs regs;
+	struct uio_pdma *pdma;
+	unsigned int id;
+
+	/* chained mode, protected by lock */
+	spinlock_t lock;
+	struct uio_info *done_info;
+	struct pdma_uio_chain *chain;
+	unsigned int chain_nr;
+	unsigned int chain_pos;
+
+	void *buf;
+	dma_addr_t buf_dma;
 };
 
 struct uio_pdma {
 	struct uio_info *uio_info[PDMA_NR_CH * 2];
+	struct uio_info *events_info;
+	struct pdma_uio_events *events;
 	void __iomem *base;
 	struct uio_pdma_chan chans[PDMA_NR_CH];
 	unsigned int pintc_base;
+	u32 chan_mask;
 };
 
-static irqreturn_t uio_pdma_done_isr(int irq, struct uio_info *uio_info)
+static void uio_pdma_clear_status(struct uio_pdma_chan *chan, u32 mask)
 {
-	struct uio_pdma_chan *chan = uio_info->priv;
 	struct pdma_regs *regs = &chan->regs;
 	u32 val;
 
-	val = readl(regs->ctrl) & PDMA_DONE_STATUS_MASK;
-	writel(val & ~PDMA_DONE_STATUS_MASK, regs->ctrl);
+	val = readl(regs->ctrl) & mask;
+	writel(val & ~mask, regs->ctrl);
+}
+
+/* The xfer_type/size/dst/src registers are the "next" set, RUN latches them */
+static void uio_pdma_chain_run(struct uio_pdma_chan *chan)
+{
+	struct pdma_uio_desc *desc = &chan->chain->desc[chan->chain_pos];
+	struct pdma_regs *regs = &chan->regs;
+
+	writel(READ_ONCE(desc->xfer_type), regs->xfer_type);
+	writeq(READ_ONCE(desc->size), regs->xfer_size);
+	writeq(READ_ONCE(desc->dst), regs->dst_addr);
+	writeq(READ_ONCE(desc->src), regs->src_addr);
+
+	writel(PDMA_CLAIM_MASK | PDMA_ENABLE_DONE_INT_MASK |
+	       PDMA_ENABLE_ERR_INT_MASK | PDMA_RUN_MASK, regs->ctrl);
+}
+
+static void uio_pdma_chain_end(struct uio_pdma_chan *chan, u32 status)
+{
+	WRITE_ONCE(chan->chain->done, chan->chain_pos);
+	WRITE_ONCE(chan->chain->status, status);
+	chan->chain_nr = 0;
+	chan->chain_pos = 0;
+}
+
+static irqreturn_t uio_pdma_done_isr(int irq, void *data)
+{
+	struct uio_pdma_chan *chan = data;
+	bool notify = true;
+
+	spin_lock(&chan->lock);
+	uio_pdma_clear_status(chan, PDMA_DONE_STATUS_MASK);
+
+	if (chan->chain_nr) {
+		if (++chan->chain_pos < chan->chain_nr) {
+			uio_pdma_chain_run(chan);
+			notify = false;
+		} else {
+			uio_pdma_chain_end(chan, 0);
+		}
+	}
+	spin_unlock(&chan->lock);
+
+	if (notify)
+		uio_event_notify(chan->done_info);
 
 	return IRQ_HANDLED;
 }
@@ -89,11 +202,77 @@ static irqreturn_t uio_pdma_done_isr(int irq, struct uio_info *uio_info)
 static irqreturn_t uio_pdma_err_isr(int irq, struct uio_info *uio_info)
 {
 	struct uio_pdma_chan *chan = uio_info->priv;
-	struct pdma_regs *regs = &chan->regs;
-	u32 val;
+	bool chained;
+
+	spin_lock(&chan->lock);
+	chained = chan->chain_nr;
+	if (chained)
+		uio_pdma_chain_end(chan, readl(chan->regs.ctrl));
+	uio_pdma_clear_status(chan, PDMA_ERR_STATUS_MASK);
+	spin_unlock(&chan->lock);
+
+	/* A chain only ever signals completion on the pdmaN device */
+	if (chained)
+		uio_event_notify(chan->done_info);
+
+	return IRQ_HANDLED;
+}
+
+/* write() on pdmaN: start a chain of irq_on descriptors, 0 aborts it */
+static int uio_pdma_irqcontrol(struct uio_info *uio_info, s32 irq_on)
+{
+	struct uio_pdma_chan *chan = uio_info->priv;
+	unsigned long flags;
+	int ret = 0;
+
+	if (irq_on < 0 || irq_on > PDMA_UIO_CHAIN_MAX)
+		return -EINVAL;
+
+	spin_lock_irqsave(&chan->lock, flags);
+	if (!irq_on) {
+		if (chan->chain_nr) {
+			writel(0, chan->regs.ctrl);
+			uio_pdma_chain_end(chan, PDMA_ERR_STATUS_MASK);
+		}
+	} else if (chan->chain_nr) {
+		ret = -EBUSY;
+	} else {
+		chan->chain->done = 0;
+		chan->chain->status = 0;
+		chan->chain_nr = irq_on;
+		chan->chain_pos = 0;
+		uio_pdma_chain_run(chan);
+	}
+	spin_unlock_irqrestore(&chan->lock, flags);
+
+	return ret;
+}
+
+static void uio_pdma_event(struct uio_pdma_chan *chan, unsigned int src)
+{
+	struct uio_pdma *dev_info = chan->pdma;
+
+	atomic_inc(&dev_info->events->count[src]);
+	atomic_or(BIT(src), &dev_info->events->pending);
+	uio_event_notify(dev_info->events_info);
+}
+
+static irqreturn_t uio_pdma_coalesced_done_isr(int irq, void *data)
+{
+	struct uio_pdma_chan *chan = data;
+
+	uio_pdma_clear_status(chan, PDMA_DONE_STATUS_MASK);
+	uio_pdma_event(chan, chan->id * 2);
+
+	return IRQ_HANDLED;
+}
+
+static irqreturn_t uio_pdma_coalesced_err_isr(int irq, void *data)
+{
+	struct uio_pdma_chan *chan = data;
 
-	val = readl(regs->ctrl) & PDMA_ERR_STATUS_MASK;
-	writel(val & ~PDMA_ERR_STATUS_MASK, regs->ctrl);
+	uio_pdma_clear_status(chan, PDMA_ERR_STATUS_MASK);
+	uio_pdma_event(chan, chan->id * 2 + 1);
 
 	return IRQ_HANDLED;
 }
@@ -105,7 +284,13 @@ static int uio_pdma_irq_init(struct platform_device *pdev,
 	struct uio_pdma_chan *chan;
 
 	for (i = 0; i < PDMA_NR_CH; i++) {
+		if (!(dev_info->chan_mask & BIT(i)))
+			continue;
+
 		chan = &dev_info->chans[i];
+		chan->pdma = dev_info;
+		chan->id = i;
+		spin_lock_init(&chan->lock);
 
 		irq = platform_get_irq(pdev, i * 2);
 		if (irq < 0) {
@@ -146,11 +331,117 @@ static int uio_pdma_irq_init(struct platform_device *pdev,
 	return 0;
 }
 
+/*
+ * One UIO device for all exported channels: every done and error interrupt
+ * bumps the same event count, so a single read() wakes the poll loop and
+ * the event page tells which sources fired in between.
+ */
+static int uio_pdma_register_coalesced(struct device *dev,
+				       struct uio_pdma *dev_info,
+				       struct resource *res)
+{
+	struct uio_info *uio_info;
+	struct uio_pdma_chan *chan;
+	int ret, i;
+
+	dev_info->events = (void *)get_zeroed_page(GFP_KERNEL);
+	if (!dev_info->events)
+		return -ENOMEM;
+
+	uio_info = kzalloc(sizeof(*uio_info), GFP_KERNEL);
+	if (!uio_info) {
+		free_page((unsigned long)dev_info->events);
+		return -ENOMEM;
+	}
+
+	uio_info->mem[0].addr = res->start;
+	uio_info->mem[0].size = resource_size(res);
+	uio_info->mem[0].memtype = UIO_MEM_PHYS;
+
+	uio_info->mem[1].name = "events";
+	uio_info->mem[1].addr = (phys_addr_t)(uintptr_t)dev_info->events;
+	uio_info->mem[1].size = PAGE_SIZE;
+	uio_info->mem[1].memtype = UIO_MEM_LOGICAL;
+
+	uio_info->name = "pdma";
+	uio_info->version = DRV_VERSION;
+	uio_info->irq = UIO_IRQ_CUSTOM;
+	uio_info->priv = dev_info;
+
+	ret = uio_register_device(dev, uio_info);
+	if (ret < 0) {
+		kfree(uio_info);
+		free_page((unsigned long)dev_info->events);
+		return ret;
+	}
+	dev_info->events_info = uio_info;
+
+	for (i = 0; i < PDMA_NR_CH; i++) {
+		if (!(dev_info->chan_mask & BIT(i)))
+			continue;
+
+		chan = &dev_info->chans[i];
+		ret = request_irq(chan->txirq, uio_pdma_coalesced_done_isr,
+				  IRQF_SHARED, "pdma", chan);
+		if (ret)
+			goto out_free_irqs;
+
+		ret = request_irq(chan->errirq, uio_pdma_coalesced_err_isr,
+				  IRQF_SHARED, "pdmaerr", chan);
+		if (ret) {
+			free_irq(chan->txirq, chan);
+			goto out_free_irqs;
+		}
+	}
+
+	dev_info(dev, "Registered coalesced device for %d channels\n",
+		 hweight32(dev_info->chan_mask));
+
+	return 0;
+
+out_free_irqs:
+	while (i--) {
+		if (!(dev_info->chan_mask & BIT(i)))
+			continue;
+		free_irq(dev_info->chans[i].txirq, &dev_info->chans[i]);
+		free_irq(dev_info->chans[i].errirq, &dev_info->chans[i]);
+	}
+	uio_unregister_device(uio_info);
+	kfree(uio_info);
+	free_page((unsigned long)dev_info->events);
+	dev_info->events_info = NULL;
+
+	return ret;
+}
+
 static void pdma_cleanup(struct device *dev, struct uio_pdma *dev_info)
 {
 	int cnt;
 	struct uio_info *uio_info;
 
+	if (dev_info->events_info) {
+		for (cnt = 0; cnt < PDMA_NR_CH; cnt++) {
+			if (!(dev_info->chan_mask & BIT(cnt)))
+				continue;
+			free_irq(dev_info->chans[cnt].txirq, &dev_info->chans[cnt]);
+			free_irq(dev_info->chans[cnt].errirq, &dev_info->chans[cnt]);
+		}
+		uio_unregister_device(dev_info->events_info);
+		kfree(dev_info->events_info);
+		free_page((unsigned long)dev_info->events);
+	}
+
+	for (cnt = 0; cnt < PDMA_NR_CH; cnt++) {
+		struct uio_pdma_chan *chan = &dev_info->chans[cnt];
+
+		if (chan->done_info)
+			free_irq(chan->txirq, chan);
+		free_page((unsigned long)chan->chain);
+		if (chan->buf)
+			dma_free_coherent(dev, dma_buf_size, chan->buf,
+					  chan->buf_dma);
+	}
+
 	for (cnt = 0; cnt < PDMA_NR_CH * 2; cnt++) {
 		uio_info = dev_info->uio_info[cnt];
 		uio_unregister_device(uio_info);
@@ -163,6 +454,7 @@ static void pdma_cleanup(struct device *dev, struct uio_pdma *dev_info)
 
 static int pdma_probe(struct platform_device *pdev)
 {
+	struct uio_pdma_chan *chan;
 	struct uio_info *uio_info;
 	struct uio_pdma *dev_info;
 	struct resource *res;
@@ -201,34 +493,89 @@ static int pdma_probe(struct platform_device *pdev)
 		goto out_free;
 	}
 
+	/*
+	 * Channels outside "dma-channel-mask" belong to the sf-pdma
+	 * dmaengine driver and are not exported.
+	 */
+	dev_info->chan_mask = GENMASK(PDMA_NR_CH - 1, 0);
+	of_property_read_u32(dev->of_node, "dma-channel-mask",
+			     &dev_info->chan_mask);
+	dev_info->chan_mask &= GENMASK(PDMA_NR_CH - 1, 0);
+
 	ret = uio_pdma_irq_init(pdev, dev_info);
 	if (ret) {
 		dev_err(dev, "Can't parse IRQs for PDMA\n");
 		goto out_free;
 	}
 
+	if (coalesce_events) {
+		ret = uio_pdma_register_coalesced(dev, dev_info, res);
+		if (ret)
+			goto out_free;
+		goto out_registered;
+	}
+
 	for (cnt = 0; cnt < PDMA_NR_CH; cnt++) {
+		if (!(dev_info->chan_mask & BIT(cnt)))
+			continue;
+
+		chan = &dev_info->chans[cnt];
 		uio_info = dev_info->uio_info[cnt * 2];
 
+		chan->chain = (void *)get_zeroed_page(GFP_KERNEL);
+		if (!chan->chain) {
+			ret = -ENOMEM;
+			goto out_free;
+		}
+
+		if (dma_buf_size) {
+			chan->buf = dma_alloc_coherent(dev, dma_buf_size,
+						       &chan->buf_dma,
+						       GFP_KERNEL);
+			if (!chan->buf) {
+				ret = -ENOMEM;
+				goto out_free;
+			}
+		}
+
 		uio_info->mem[0].addr = res->start;
 		uio_info->mem[0].size = len;
 		uio_info->mem[0].memtype = UIO_MEM_PHYS;
 
-		uio_info->mem[1].size = 0;
+		uio_info->mem[1].name = "chain";
+		uio_info->mem[1].addr = (phys_addr_t)(uintptr_t)chan->chain;
+		uio_info->mem[1].size = PAGE_SIZE;
+		uio_info->mem[1].memtype = UIO_MEM_LOGICAL;
+
+		if (chan->buf) {
+			uio_info->mem[2].name = "buffer";
+			uio_info->mem[2].addr = chan->buf_dma;
+			uio_info->mem[2].size = dma_buf_size;
+			uio_info->mem[2].memtype = UIO_MEM_PHYS;
+		}
 
 		uio_info->name = kasprintf(GFP_KERNEL, "pdma%d", cnt);
 		uio_info->version = DRV_VERSION;
 
-		/* Register PDMA txdone IRQ line */
-		uio_info->irq = dev_info->chans[cnt].txirq;
-		uio_info->irq_flags = IRQF_SHARED;
-		uio_info->handler = uio_pdma_done_isr;
-		uio_info->priv = &dev_info->chans[cnt];
+		/*
+		 * The txdone line is requested here rather than by the UIO
+		 * core, so intermediate segments of a chain can be consumed
+		 * without waking userspace.
+		 */
+		uio_info->irq = UIO_IRQ_CUSTOM;
+		uio_info->irqcontrol = uio_pdma_irqcontrol;
+		uio_info->priv = chan;
 
 		ret = uio_register_device(dev, uio_info);
 		if (ret < 0)
 			goto out_free;
 
+		ret = request_irq(chan->txirq, uio_pdma_done_isr, IRQF_SHARED,
+				  uio_info->name, chan);
+		if (ret)
+			goto out_free;
+		chan->done_info = uio_info;
+
 		uio_info = dev_info->uio_info[(cnt * 2) + 1];
 
 		uio_info->mem[0].addr = res->start;
@@ -251,9 +598,11 @@ static int pdma_probe(struct platform_device *pdev)
 			goto out_free;
 	}
 
-	platform_set_drvdata(pdev, dev_info);
+	dev_info(dev, "Registered %d devices\n",
+		 hweight32(dev_info->chan_mask) * 2);
 
-	dev_info(dev, "Registered 8 devices\n");
+out_registered:
+	platform_set_drvdata(pdev, dev_info);
 
 	return 0;
 
@@ -15,6 +15,7 @@
 #include <linux/clk.h>
 #include <linux/platform_device.h>
 #include <linux/dma-mapping.h>
+#include <linux/of.h>
 #include <linux/usb/usb_phy_generic.h>
 #include "musb_core.h"
 #include "musb_dma.h"
@@ -41,6 +42,57 @@ static struct musb_fifo_cfg pf_musb_mode_cfg[] = {
 	{ .hw_ep_num = 4, .style = FIFO_RX, .maxpacket = 4096, },
 };
 
+/* Double-buffered bulk pairs for BOT/UAS, small FIFOs for interrupt eps */
+static struct musb_fifo_cfg pf_musb_storage_cfg[] = {
+	{ .hw_ep_num = 1, .style = FIFO_TX, .maxpacket = 512, .mode = BUF_DOUBLE, },
+	{ .hw_ep_num = 1, .style = FIFO_RX, .maxpacket = 512, .mode = BUF_DOUBLE, },
+	{ .hw_ep_num = 2, .style = FIFO_TX, .maxpacket = 512, .mode = BUF_DOUBLE, },
+	{ .hw_ep_num = 2, .style = FIFO_RX, .maxpacket = 512, .mode = BUF_DOUBLE, },
+	{ .hw_ep_num = 3, .style = FIFO_TX, .maxpacket = 512, },
+	{ .hw_ep_num = 3, .style = FIFO_RX, .maxpacket = 512, },
+	{ .hw_ep_num = 4, .style = FIFO_TX, .maxpacket = 64, },
+	{ .hw_ep_num = 4, .style = FIFO_RX, .maxpacket = 64, },
+	{ .hw_ep_num = 5, .style = FIFO_TX, .maxpacket = 512, },
+	{ .hw_ep_num = 5, .style = FIFO_RX, .maxpacket = 512, },
+	{ .hw_ep_num = 6, .style = FIFO_TX, .maxpacket = 64, },
+	{ .hw_ep_num = 6, .style = FIFO_RX, .maxpacket = 64, },
+	{ .hw_ep_num = 7, .style = FIFO_TX, .maxpacket = 64, },
+	{ .hw_ep_num = 7, .style = FIFO_RX, .maxpacket = 64, },
+};
+
+/* Double-buffered data pipe with its notification endpoint next to it */
+static struct musb_fifo_cfg pf_musb_ncm_cfg[] = {
+	{ .hw_ep_num = 1, .style = FIFO_TX, .maxpacket = 512, .mode = BUF_DOUBLE, },
+	{ .hw_ep_num = 1, .style = FIFO_RX, .maxpacket = 512, .mode = BUF_DOUBLE, },
+	{ .hw_ep_num = 2, .style = FIFO_TX, .maxpacket = 64, },
+	{ .hw_ep_num = 2, .style = FIFO_RX, .maxpacket = 64, },
+	{ .hw_ep_num = 3, .style = FIFO_TX, .maxpacket = 512, .mode = BUF_DOUBLE, },
+	{ .hw_ep_num = 3, .style = FIFO_RX, .maxpacket = 512, .mode = BUF_DOUBLE, },
+	{ .hw_ep_num = 4, .style = FIFO_TX, .maxpacket = 512, },
+	{ .hw_ep_num = 4, .style = FIFO_RX, .maxpacket = 512, },
+	{ .hw_ep_num = 5, .style = FIFO_TX, .maxpacket = 64, },
+	{ .hw_ep_num = 5, .style = FIFO_RX, .maxpacket = 64, },
+	{ .hw_ep_num = 6, .style = FIFO_TX, .maxpacket = 64, },
+	{ .hw_ep_num = 6, .style = FIFO_RX, .maxpacket = 64, },
+	{ .hw_ep_num = 7, .style = FIFO_TX, .maxpacket = 64, },
+	{ .hw_ep_num = 7, .style = FIFO_RX, .maxpacket = 64, },
+};
+
+struct pf_musb_fifo_profile {
+	const char		*name;
+	struct musb_fifo_cfg	*cfg;
+	unsigned int		size;
+};
+
+#define PF_MUSB_FIFO_PROFILE(_name, _cfg) \
+	{ .name = _name, .cfg = _cfg, .size = ARRAY_SIZE(_cfg) }
+
+static const struct pf_musb_fifo_profile pf_musb_fifo_profiles[] = {
+	PF_MUSB_FIFO_PROFILE("default", pf_musb_mode_cfg),
+	PF_MUSB_FIFO_PROFILE("mass-storage", pf_musb_storage_cfg),
+	PF_MUSB_FIFO_PROFILE("cdc-ncm", pf_musb_ncm_cfg),
+};
+
 static const struct musb_hdrc_config pf_musb_hdrc_config = {
 	.fifo_cfg = pf_musb_mode_cfg,
 	.fifo_cfg_size = ARRAY_SIZE(pf_musb_mode_cfg),
@@ -50,6 +102,38 @@ static const struct musb_hdrc_config pf_musb_hdrc_config = {
 	.ram_bits = PF_MUSB_RAM_BITS,
 };
 
+static const struct musb_hdrc_config *pf_musb_get_config(struct device *dev)
+{
+	const struct pf_musb_fifo_profile *profile;
+	struct musb_hdrc_config *config;
+	const char *name;
+	int i;
+
+	if (of_property_read_string(dev->of_node, "microchip,fifo-profile",
+				    &name))
+		return &pf_musb_hdrc_config;
+
+	for (i = 0; i < ARRAY_SIZE(pf_musb_fifo_profiles); i++) {
+		profile = &pf_musb_fifo_profiles[i];
+		if (strcmp(name, profile->name))
+			continue;
+
+		config = devm_kmemdup(dev, &pf_musb_hdrc_config,
+				      sizeof(*config), GFP_KERNEL);
+		if (!config)
+			return NULL;
+
+		config->fifo_cfg = profile->cfg;
+		config->fifo_cfg_size = profile->size;
+
+		return config;
+	}
+
+	dev_warn(dev, "unknown FIFO profile '%s', using default\n", name);
+
+	return &pf_musb_hdrc_config;
+}
+
 static irqreturn_t polarfire_interrupt(int irq, void *__hci)
 {
 	unsigned long	flags;
@@ -148,12 +232,13 @@ static const struct musb_platform_ops pf_ops = {
 	.set_vbus	= pf_musb_set_vbus
 };
 
+/* The Inventra DMA address registers are 32 bits wide */
 static u64 pf_dmamask = DMA_BIT_MASK(32);
 
 static int pf_probe(struct platform_device *pdev)
 {
 	struct device			*dev = &pdev->dev;
-	struct resource                 musb_resources[3];
+	struct resource			*musb_resources;
 	struct musb_hdrc_platform_data	*pdata = dev_get_platdata(&pdev->dev);
 	struct platform_device		*musb;
 	struct pf_glue		        *glue;
@@ -161,6 +246,7 @@ static int pf_probe(struct platform_device *pdev)
 	const char			*mode;
 	int				strlen;
 	int				ret = -ENOMEM;
+	int				i;
 	struct clk			*clk;
 	dev_info(&pdev->dev, "Registered MPFS MUSB driver\n");
 
@@ -204,7 +290,9 @@ static int pf_probe(struct platform_device *pdev)
 			goto err1;
 	}
 
-        pdata->config = &pf_musb_hdrc_config;
+	pdata->config = pf_musb_get_config(dev);
+	if (!pdata->config)
+		goto err1;
 	pdata->platform_ops		= &pf_ops;
 
 	mode = of_get_property(np, "dr_mode", &strlen);
@@ -227,26 +315,23 @@ static int pf_probe(struct platform_device *pdev)
 
 	platform_set_drvdata(pdev, glue);
 
-	memset(musb_resources, 0x00,
-		sizeof(*musb_resources) * ARRAY_SIZE(musb_resources));
-
-	musb_resources[0].name  = pdev->resource[0].name;
-	musb_resources[0].start = pdev->resource[0].start;
-	musb_resources[0].end   = pdev->resource[0].end;
-	musb_resources[0].flags = pdev->resource[0].flags;
-
-	musb_resources[1].name  = pdev->resource[1].name;
-	musb_resources[1].start = pdev->resource[1].start;
-	musb_resources[1].end   = pdev->resource[1].end;
-	musb_resources[1].flags = pdev->resource[1].flags;
+	/* Pass every resource on so the "dma" interrupt reaches musbhsdma */
+	musb_resources = devm_kcalloc(dev, pdev->num_resources,
+				      sizeof(*musb_resources), GFP_KERNEL);
+	if (!musb_resources) {
+		ret = -ENOMEM;
+		goto err2;
+	}
 
-	musb_resources[2].name  = pdev->resource[2].name;
-	musb_resources[2].start = pdev->resource[2].start;
-	musb_resources[2].end   = pdev->resource[2].end;
-	musb_resources[2].flags = pdev->resource[2].flags;
+	for (i = 0; i < pdev->num_resources; i++) {
+		musb_resources[i].name  = pdev->resource[i].name;
+		musb_resources[i].start = pdev->resource[i].start;
+		musb_resources[i].end   = pdev->resource[i].end;
+		musb_resources[i].flags = pdev->resource[i].flags;
+	}
 
 	ret = platform_device_add_resources(musb, musb_resources,
-		ARRAY_SIZE(musb_resources));
+					    pdev->num_resources);
 	if (ret) {
 		dev_err(dev, "failed to add resources\n");
 		goto err2;
@@ -265,6 +350,10 @@ static int pf_probe(struct platform_device *pdev)
 		goto err2;
 	}
 
+	/* the controller and its glue do not depend on other devices' resume */
+	device_enable_async_suspend(dev);
+	device_enable_async_suspend(&musb->dev);
+
 	return 0;
 err2:
 	clk_disable_unprepare(clk);
@@ -57,6 +57,7 @@
 #include <linux/acpi.h>
 #include <linux/dma-mapping.h>
 #include <linux/highmem.h>
+#include <linux/hrtimer.h>
 #include <linux/interrupt.h>
 #include <linux/io.h>
 #include <linux/list.h>
@@ -75,6 +76,16 @@
  * Currently hardcoded to the page size. */
 #define VIRTIO_MMIO_VRING_ALIGN		PAGE_SIZE
 
+/*
+ * Every register access crosses to the device, which is slow when it is
+ * implemented in FPGA fabric. In polled mode the used rings, which live in
+ * shared memory, are checked from a timer and the interrupt status register
+ * is only read once a second, for configuration changes.
+ */
+static unsigned int poll_us;
+module_param(poll_us, uint, 0444);
+MODULE_PARM_DESC(poll_us, "Poll the virtqueues every poll_us microseconds instead of using the interrupt (0 = off)");
+
 
 
 #define to_virtio_mmio_device(_plat_dev) \
@@ -90,6 +101,11 @@ struct virtio_mmio_device {
 	/* a list of queues so we can dispatch IRQs */
 	spinlock_t lock;
 	struct list_head virtqueues;
+
+	/* polled mode: scan the used rings instead of taking the IRQ */
+	struct hrtimer poll_timer;
+	unsigned int poll_us;
+	unsigned int poll_ticks;
 };
 
 struct virtio_mmio_vq_info {
@@ -279,19 +295,23 @@ static bool vm_notify(struct virtqueue *vq)
 	return true;
 }
 
-/* Notify all virtqueues on an interrupt. */
-static irqreturn_t vm_interrupt(int irq, void *opaque)
+/* The same, also telling the device how far the available ring goes */
+static bool vm_notify_with_data(struct virtqueue *vq)
+{
+	struct virtio_mmio_device *vm_dev = to_virtio_mmio_device(vq->vdev);
+	u32 data = vring_notification_data(vq);
+
+	writel(data, vm_dev->base + VIRTIO_MMIO_QUEUE_NOTIFY);
+	return true;
+}
+
+static irqreturn_t vm_dispatch(struct virtio_mmio_device *vm_dev,
+			       unsigned long status)
 {
-	struct virtio_mmio_device *vm_dev = opaque;
 	struct virtio_mmio_vq_info *info;
-	unsigned long status;
 	unsigned long flags;
 	irqreturn_t ret = IRQ_NONE;
 
-	/* Read and acknowledge interrupts */
-	status = readl(vm_dev->base + VIRTIO_MMIO_INTERRUPT_STATUS);
-	writel(status, vm_dev->base + VIRTIO_MMIO_INTERRUPT_ACK);
-
 	if (unlikely(status & VIRTIO_MMIO_INT_CONFIG)) {
 		virtio_config_changed(&vm_dev->vdev);
 		ret = IRQ_HANDLED;
@@ -300,13 +320,51 @@ static irqreturn_t vm_interrupt(int irq, void *opaque)
 	if (likely(status & VIRTIO_MMIO_INT_VRING)) {
 		spin_lock_irqsave(&vm_dev->lock, flags);
 		list_for_each_entry(info, &vm_dev->virtqueues, node)
-			ret |= vring_interrupt(irq, info->vq);
+			ret |= vring_interrupt(0, info->vq);
 		spin_unlock_irqrestore(&vm_dev->lock, flags);
 	}
 
 	return ret;
 }
 
+/*
+ * Notify all virtqueues on an interrupt. One status read and one
+ * acknowledge cover every queue with used buffers; nothing is written
+ * back when the interrupt belongs to another device on a shared line.
+ */
+static irqreturn_t vm_interrupt(int irq, void *opaque)
+{
+	struct virtio_mmio_device *vm_dev = opaque;
+	unsigned long status;
+
+	/* Read and acknowledge interrupts */
+	status = readl(vm_dev->base + VIRTIO_MMIO_INTERRUPT_STATUS);
+	if (!status)
+		return IRQ_NONE;
+	writel(status, vm_dev->base + VIRTIO_MMIO_INTERRUPT_ACK);
+
+	return vm_dispatch(vm_dev, status);
+}
+
+static enum hrtimer_restart vm_poll(struct hrtimer *timer)
+{
+	struct virtio_mmio_device *vm_dev =
+		container_of(timer, struct virtio_mmio_device, poll_timer);
+	unsigned long status = 0;
+
+	if (++vm_dev->poll_ticks >= USEC_PER_SEC / vm_dev->poll_us) {
+		vm_dev->poll_ticks = 0;
+		status = readl(vm_dev->base + VIRTIO_MMIO_INTERRUPT_STATUS);
+		if (status)
+			writel(status, vm_dev->base + VIRTIO_MMIO_INTERRUPT_ACK);
+	}
+
+	vm_dispatch(vm_dev, status | VIRTIO_MMIO_INT_VRING);
+
+	hrtimer_forward_now(timer, us_to_ktime(vm_dev->poll_us));
+	return HRTIMER_RESTART;
+}
+
 
 
 static void vm_del_vq(struct virtqueue *vq)
@@ -339,10 +397,14 @@ static void vm_del_vqs(struct virtio_device *vdev)
 	struct virtio_mmio_device *vm_dev = to_virtio_mmio_device(vdev);
 	struct virtqueue *vq, *n;
 
+	if (vm_dev->poll_us)
+		hrtimer_cancel(&vm_dev->poll_timer);
+
 	list_for_each_entry_safe(vq, n, &vdev->vqs, list)
 		vm_del_vq(vq);
 
-	free_irq(platform_get_irq(vm_dev->pdev, 0), vm_dev);
+	if (!vm_dev->poll_us)
+		free_irq(platform_get_irq(vm_dev->pdev, 0), vm_dev);
 }
 
 static struct virtqueue *vm_setup_vq(struct virtio_device *vdev, unsigned index,
@@ -351,11 +413,17 @@ static struct virtqueue *vm_setup_vq(struct virtio_device *vdev, unsigned index,
 {
 	struct virtio_mmio_device *vm_dev = to_virtio_mmio_device(vdev);
 	struct virtio_mmio_vq_info *info;
+	bool (*notify)(struct virtqueue *vq);
 	struct virtqueue *vq;
 	unsigned long flags;
 	unsigned int num;
 	int err;
 
+	if (__virtio_test_bit(vdev, VIRTIO_F_NOTIFICATION_DATA))
+		notify = vm_notify_with_data;
+	else
+		notify = vm_notify;
+
 	if (!name)
 		return NULL;
 
@@ -384,7 +452,7 @@ static struct virtqueue *vm_setup_vq(struct virtio_device *vdev, unsigned index,
 
 	/* Create the vring */
 	vq = vring_create_virtqueue(index, num, VIRTIO_MMIO_VRING_ALIGN, vdev,
-				 true, true, ctx, vm_notify, callback, name);
+				 true, true, ctx, notify, callback, name);
 	if (!vq) {
 		err = -ENOMEM;
 		goto error_new_virtqueue;
@@ -466,13 +534,21 @@ static int vm_find_vqs(struct virtio_device *vdev, unsigned nvqs,
 	int irq = platform_get_irq(vm_dev->pdev, 0);
 	int i, err, queue_idx = 0;
 
-	if (irq < 0)
-		return irq;
+	vm_dev->poll_us = poll_us;
+	if (vm_dev->poll_us) {
+		hrtimer_init(&vm_dev->poll_timer, CLOCK_MONOTONIC,
+			     HRTIMER_MODE_REL);
+		vm_dev->poll_timer.function = vm_poll;
+		vm_dev->poll_ticks = 0;
+	} else {
+		if (irq < 0)
+			return irq;
 
-	err = request_irq(irq, vm_interrupt, IRQF_SHARED,
-			dev_name(&vdev->dev), vm_dev);
-	if (err)
-		return err;
+		err = request_irq(irq, vm_interrupt, IRQF_SHARED,
+				dev_name(&vdev->dev), vm_dev);
+		if (err)
+			return err;
+	}
 
 	for (i = 0; i < nvqs; ++i) {
 		if (!names[i]) {
@@ -488,6 +564,10 @@ static int vm_find_vqs(struct virtio_device *vdev, unsigned nvqs,
 		}
 	}
 
+	if (vm_dev->poll_us)
+		hrtimer_start(&vm_dev->poll_timer, us_to_ktime(vm_dev->poll_us),
+			      HRTIMER_MODE_REL);
+
 	return 0;
 }
 
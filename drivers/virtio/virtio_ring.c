@@ -1550,57 +1550,36 @@ static void *virtqueue_detach_unused_buf_packed(struct virtqueue *_vq)
 	return NULL;
 }
 
-static struct virtqueue *vring_create_virtqueue_packed(
+/*
+ * Set up a packed virtqueue around rings that are already in place. The
+ * caller owns the rings and records them for freeing if it allocated them.
+ */
+static struct vring_virtqueue *__vring_new_virtqueue_packed(
 	unsigned int index,
 	unsigned int num,
-	unsigned int vring_align,
 	struct virtio_device *vdev,
 	bool weak_barriers,
-	bool may_reduce_num,
 	bool context,
+	struct vring_packed_desc *ring,
+	struct vring_packed_desc_event *driver,
+	struct vring_packed_desc_event *device,
 	bool (*notify)(struct virtqueue *),
 	void (*callback)(struct virtqueue *),
 	const char *name)
 {
 	struct vring_virtqueue *vq;
-	struct vring_packed_desc *ring;
-	struct vring_packed_desc_event *driver, *device;
-	dma_addr_t ring_dma_addr, driver_event_dma_addr, device_event_dma_addr;
-	size_t ring_size_in_bytes, event_size_in_bytes;
 	unsigned int i;
 
-	ring_size_in_bytes = num * sizeof(struct vring_packed_desc);
-
-	ring = vring_alloc_queue(vdev, ring_size_in_bytes,
-				 &ring_dma_addr,
-				 GFP_KERNEL|__GFP_NOWARN|__GFP_ZERO);
-	if (!ring)
-		goto err_ring;
-
-	event_size_in_bytes = sizeof(struct vring_packed_desc_event);
-
-	driver = vring_alloc_queue(vdev, event_size_in_bytes,
-				   &driver_event_dma_addr,
-				   GFP_KERNEL|__GFP_NOWARN|__GFP_ZERO);
-	if (!driver)
-		goto err_driver;
-
-	device = vring_alloc_queue(vdev, event_size_in_bytes,
-				   &device_event_dma_addr,
-				   GFP_KERNEL|__GFP_NOWARN|__GFP_ZERO);
-	if (!device)
-		goto err_device;
-
 	vq = kmalloc(sizeof(*vq), GFP_KERNEL);
 	if (!vq)
-		goto err_vq;
+		return NULL;
 
 	vq->vq.callback = callback;
 	vq->vq.vdev = vdev;
 	vq->vq.name = name;
 	vq->vq.num_free = num;
 	vq->vq.index = index;
-	vq->we_own_ring = true;
+	vq->we_own_ring = false;
 	vq->notify = notify;
 	vq->weak_barriers = weak_barriers;
 	vq->broken = false;
@@ -1620,12 +1599,12 @@ static struct virtqueue *vring_create_virtqueue_packed(
 	if (virtio_has_feature(vdev, VIRTIO_F_ORDER_PLATFORM))
 		vq->weak_barriers = false;
 
-	vq->packed.ring_dma_addr = ring_dma_addr;
-	vq->packed.driver_event_dma_addr = driver_event_dma_addr;
-	vq->packed.device_event_dma_addr = device_event_dma_addr;
+	vq->packed.ring_dma_addr = 0;
+	vq->packed.driver_event_dma_addr = 0;
+	vq->packed.device_event_dma_addr = 0;
 
-	vq->packed.ring_size_in_bytes = ring_size_in_bytes;
-	vq->packed.event_size_in_bytes = event_size_in_bytes;
+	vq->packed.ring_size_in_bytes = num * sizeof(struct vring_packed_desc);
+	vq->packed.event_size_in_bytes = sizeof(struct vring_packed_desc_event);
 
 	vq->packed.vring.num = num;
 	vq->packed.vring.desc = ring;
@@ -1669,12 +1648,68 @@ static struct virtqueue *vring_create_virtqueue_packed(
 	}
 
 	list_add_tail(&vq->vq.list, &vdev->vqs);
-	return &vq->vq;
+	return vq;
 
 err_desc_extra:
 	kfree(vq->packed.desc_state);
 err_desc_state:
 	kfree(vq);
+	return NULL;
+}
+
+static struct virtqueue *vring_create_virtqueue_packed(
+	unsigned int index,
+	unsigned int num,
+	unsigned int vring_align,
+	struct virtio_device *vdev,
+	bool weak_barriers,
+	bool may_reduce_num,
+	bool context,
+	bool (*notify)(struct virtqueue *),
+	void (*callback)(struct virtqueue *),
+	const char *name)
+{
+	struct vring_virtqueue *vq;
+	struct vring_packed_desc *ring;
+	struct vring_packed_desc_event *driver, *device;
+	dma_addr_t ring_dma_addr, driver_event_dma_addr, device_event_dma_addr;
+	size_t ring_size_in_bytes, event_size_in_bytes;
+
+	ring_size_in_bytes = num * sizeof(struct vring_packed_desc);
+
+	ring = vring_alloc_queue(vdev, ring_size_in_bytes,
+				 &ring_dma_addr,
+				 GFP_KERNEL|__GFP_NOWARN|__GFP_ZERO);
+	if (!ring)
+		goto err_ring;
+
+	event_size_in_bytes = sizeof(struct vring_packed_desc_event);
+
+	driver = vring_alloc_queue(vdev, event_size_in_bytes,
+				   &driver_event_dma_addr,
+				   GFP_KERNEL|__GFP_NOWARN|__GFP_ZERO);
+	if (!driver)
+		goto err_driver;
+
+	device = vring_alloc_queue(vdev, event_size_in_bytes,
+				   &device_event_dma_addr,
+				   GFP_KERNEL|__GFP_NOWARN|__GFP_ZERO);
+	if (!device)
+		goto err_device;
+
+	vq = __vring_new_virtqueue_packed(index, num, vdev, weak_barriers,
+					  context, ring, driver, device,
+					  notify, callback, name);
+	if (!vq)
+		goto err_vq;
+
+	vq->we_own_ring = true;
+	vq->packed.ring_dma_addr = ring_dma_addr;
+	vq->packed.driver_event_dma_addr = driver_event_dma_addr;
+	vq->packed.device_event_dma_addr = device_event_dma_addr;
+
+	return &vq->vq;
+
 err_vq:
 	vring_free_queue(vdev, event_size_in_bytes, device, device_event_dma_addr);
 err_device:
@@ -2155,7 +2190,35 @@ struct virtqueue *vring_create_virtqueue(
 }
 EXPORT_SYMBOL_GPL(vring_create_virtqueue);
 
-/* Only available for split ring */
+/*
+ * Packed ring in caller memory, see vring_packed_size() for the layout.
+ */
+static struct virtqueue *vring_new_virtqueue_packed(unsigned int index,
+						    unsigned int num,
+						    unsigned int vring_align,
+						    struct virtio_device *vdev,
+						    bool weak_barriers,
+						    bool context,
+						    void *pages,
+						    bool (*notify)(struct virtqueue *vq),
+						    void (*callback)(struct virtqueue *vq),
+						    const char *name)
+{
+	size_t ring_size_in_bytes = num * sizeof(struct vring_packed_desc);
+	struct vring_packed_desc_event *driver, *device;
+	struct vring_virtqueue *vq;
+
+	driver = pages + ring_size_in_bytes;
+	device = pages + ALIGN(ring_size_in_bytes + sizeof(*driver),
+			       vring_align);
+
+	vq = __vring_new_virtqueue_packed(index, num, vdev, weak_barriers,
+					  context, pages, driver, device,
+					  notify, callback, name);
+
+	return vq ? &vq->vq : NULL;
+}
+
 struct virtqueue *vring_new_virtqueue(unsigned int index,
 				      unsigned int num,
 				      unsigned int vring_align,
@@ -2170,7 +2233,9 @@ struct virtqueue *vring_new_virtqueue(unsigned int index,
 	struct vring vring;
 
 	if (virtio_has_feature(vdev, VIRTIO_F_RING_PACKED))
-		return NULL;
+		return vring_new_virtqueue_packed(index, num, vring_align, vdev,
+						  weak_barriers, context, pages,
+						  notify, callback, name);
 
 	vring_init(&vring, num, pages, vring_align);
 	return __vring_new_virtqueue(index, vring, vdev, weak_barriers, context,
@@ -2234,6 +2299,8 @@ void vring_transport_features(struct virtio_device *vdev)
 			break;
 		case VIRTIO_F_ORDER_PLATFORM:
 			break;
+		case VIRTIO_F_NOTIFICATION_DATA:
+			break;
 		default:
 			/* We don't understand this bit. */
 			__virtio_clear_bit(vdev, i);
@@ -2242,6 +2309,31 @@ void vring_transport_features(struct virtio_device *vdev)
 }
 EXPORT_SYMBOL_GPL(vring_transport_features);
 
+/**
+ * vring_notification_data - the value to notify a virtqueue with
+ * @_vq: the struct virtqueue to notify.
+ *
+ * Returns the queue index in the low 16 bits and the next available index,
+ * with the wrap counter in bit 15 for packed rings, in the high 16 bits, so
+ * the device need not read the available ring to learn how far it goes.
+ */
+u32 vring_notification_data(struct virtqueue *_vq)
+{
+	struct vring_virtqueue *vq = to_vvq(_vq);
+	u16 next;
+
+	if (vq->packed_ring)
+		next = (vq->packed.next_avail_idx &
+				~(-(1 << VRING_PACKED_EVENT_F_WRAP_CTR))) |
+			vq->packed.avail_wrap_counter <<
+				VRING_PACKED_EVENT_F_WRAP_CTR;
+	else
+		next = vq->split.avail_idx_shadow;
+
+	return next << 16 | _vq->index;
+}
+EXPORT_SYMBOL_GPL(vring_notification_data);
+
 /**
  * virtqueue_get_vring_size - return the size of the virtqueue's vring
  * @_vq: the struct virtqueue containing the vring of interest.
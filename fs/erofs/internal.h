@@ -395,6 +395,8 @@ void *erofs_get_pcpubuf(unsigned int pagenr);
 	(void)&(buf);	\
 	preempt_enable();	\
 } while (0)
+int __init erofs_pcpubuf_init(void);
+void erofs_pcpubuf_exit(void);
 #else
 static inline void *erofs_get_pcpubuf(unsigned int pagenr)
 {
@@ -22,14 +22,43 @@ struct page *erofs_allocpage(struct list_head *pool, gfp_t gfp)
 }
 
 #if (EROFS_PCPUBUF_NR_PAGES > 0)
-static struct {
-	u8 data[PAGE_SIZE * EROFS_PCPUBUF_NR_PAGES];
-} ____cacheline_aligned_in_smp erofs_pcpubuf[NR_CPUS];
+/*
+ * Per-CPU decompression buffers, allocated on the node of each possible CPU
+ * instead of as a static NR_CPUS array sized for the largest cluster.
+ */
+static DEFINE_PER_CPU(u8 *, erofs_pcpubuf);
 
 void *erofs_get_pcpubuf(unsigned int pagenr)
 {
 	preempt_disable();
-	return &erofs_pcpubuf[smp_processor_id()].data[pagenr * PAGE_SIZE];
+	return this_cpu_read(erofs_pcpubuf) + pagenr * PAGE_SIZE;
+}
+
+void erofs_pcpubuf_exit(void)
+{
+	unsigned int cpu;
+
+	for_each_possible_cpu(cpu) {
+		kvfree(per_cpu(erofs_pcpubuf, cpu));
+		per_cpu(erofs_pcpubuf, cpu) = NULL;
+	}
+}
+
+int __init erofs_pcpubuf_init(void)
+{
+	unsigned int cpu;
+
+	for_each_possible_cpu(cpu) {
+		u8 *buf = kvmalloc_node(PAGE_SIZE * EROFS_PCPUBUF_NR_PAGES,
+					GFP_KERNEL, cpu_to_node(cpu));
+
+		if (!buf) {
+			erofs_pcpubuf_exit();
+			return -ENOMEM;
+		}
+		per_cpu(erofs_pcpubuf, cpu) = buf;
+	}
+	return 0;
 }
 #endif
 
@@ -39,9 +39,63 @@ typedef tagptr1_t compressed_page_t;
 static struct workqueue_struct *z_erofs_workqueue __read_mostly;
 static struct kmem_cache *pcluster_cachep __read_mostly;
 
+#ifdef CONFIG_EROFS_FS_PCPU_KTHREAD
+/*
+ * Async decompression runs on a worker bound to the CPU that completed the
+ * I/O, optionally at SCHED_FIFO, so that a read does not also have to wait
+ * for an unbound workqueue thread to be scheduled.  CPUs brought online
+ * later fall back to the workqueue.
+ */
+static DEFINE_PER_CPU(struct kthread_worker *, z_erofs_pcpu_worker);
+
+static void z_erofs_decompressqueue_kthread_work(struct kthread_work *work);
+
+static void z_erofs_destroy_pcpu_workers(void)
+{
+	unsigned int cpu;
+
+	for_each_possible_cpu(cpu) {
+		struct kthread_worker *worker =
+			per_cpu(z_erofs_pcpu_worker, cpu);
+
+		if (!worker)
+			continue;
+		per_cpu(z_erofs_pcpu_worker, cpu) = NULL;
+		kthread_destroy_worker(worker);
+	}
+}
+
+static int __init z_erofs_init_pcpu_workers(void)
+{
+	struct kthread_worker *worker;
+	unsigned int cpu;
+
+	cpus_read_lock();
+	for_each_online_cpu(cpu) {
+		worker = kthread_create_worker_on_cpu(cpu, 0,
+						      "erofs_worker/%u", cpu);
+		if (IS_ERR(worker)) {
+			cpus_read_unlock();
+			z_erofs_destroy_pcpu_workers();
+			return PTR_ERR(worker);
+		}
+		if (IS_ENABLED(CONFIG_EROFS_FS_PCPU_KTHREAD_HIPRI))
+			sched_set_fifo_low(worker->task);
+		per_cpu(z_erofs_pcpu_worker, cpu) = worker;
+	}
+	cpus_read_unlock();
+	return 0;
+}
+#else
+static inline void z_erofs_destroy_pcpu_workers(void) {}
+static inline int z_erofs_init_pcpu_workers(void) { return 0; }
+#endif
+
 void z_erofs_exit_zip_subsystem(void)
 {
+	z_erofs_destroy_pcpu_workers();
 	destroy_workqueue(z_erofs_workqueue);
+	erofs_pcpubuf_exit();
 	kmem_cache_destroy(pcluster_cachep);
 }
 
@@ -74,17 +128,35 @@ static void z_erofs_pcluster_init_once(void *ptr)
 
 int __init z_erofs_init_zip_subsystem(void)
 {
+	int err;
+
 	pcluster_cachep = kmem_cache_create("erofs_compress",
 					    Z_EROFS_WORKGROUP_SIZE, 0,
 					    SLAB_RECLAIM_ACCOUNT,
 					    z_erofs_pcluster_init_once);
-	if (pcluster_cachep) {
-		if (!z_erofs_init_workqueue())
-			return 0;
+	if (!pcluster_cachep)
+		return -ENOMEM;
 
-		kmem_cache_destroy(pcluster_cachep);
-	}
-	return -ENOMEM;
+	err = erofs_pcpubuf_init();
+	if (err)
+		goto out_cache;
+
+	err = z_erofs_init_workqueue();
+	if (err)
+		goto out_pcpubuf;
+
+	err = z_erofs_init_pcpu_workers();
+	if (err)
+		goto out_workqueue;
+	return 0;
+
+out_workqueue:
+	destroy_workqueue(z_erofs_workqueue);
+out_pcpubuf:
+	erofs_pcpubuf_exit();
+out_cache:
+	kmem_cache_destroy(pcluster_cachep);
+	return err;
 }
 
 enum z_erofs_collectmode {
@@ -720,8 +792,23 @@ static void z_erofs_decompress_kickoff(struct z_erofs_decompressqueue *io,
 		return;
 	}
 
-	if (!atomic_add_return(bios, &io->pending_bios))
-		queue_work(z_erofs_workqueue, &io->u.work);
+	if (atomic_add_return(bios, &io->pending_bios))
+		return;
+
+#ifdef CONFIG_EROFS_FS_PCPU_KTHREAD
+	{
+		struct kthread_worker *worker =
+			per_cpu(z_erofs_pcpu_worker, raw_smp_processor_id());
+
+		if (worker) {
+			kthread_init_work(&io->u.kthread_work,
+					  z_erofs_decompressqueue_kthread_work);
+			kthread_queue_work(worker, &io->u.kthread_work);
+			return;
+		}
+	}
+#endif
+	queue_work(z_erofs_workqueue, &io->u.work);
 }
 
 static bool z_erofs_page_is_invalidated(struct page *page)
@@ -978,10 +1065,8 @@ static void z_erofs_decompress_queue(const struct z_erofs_decompressqueue *io,
 	}
 }
 
-static void z_erofs_decompressqueue_work(struct work_struct *work)
+static void z_erofs_decompressqueue_run(struct z_erofs_decompressqueue *bgq)
 {
-	struct z_erofs_decompressqueue *bgq =
-		container_of(work, struct z_erofs_decompressqueue, u.work);
 	LIST_HEAD(pagepool);
 
 	DBG_BUGON(bgq->head == Z_EROFS_PCLUSTER_TAIL_CLOSED);
@@ -991,6 +1076,20 @@ static void z_erofs_decompressqueue_work(struct work_struct *work)
 	kvfree(bgq);
 }
 
+static void z_erofs_decompressqueue_work(struct work_struct *work)
+{
+	z_erofs_decompressqueue_run(container_of(work,
+			struct z_erofs_decompressqueue, u.work));
+}
+
+#ifdef CONFIG_EROFS_FS_PCPU_KTHREAD
+static void z_erofs_decompressqueue_kthread_work(struct kthread_work *work)
+{
+	z_erofs_decompressqueue_run(container_of(work,
+			struct z_erofs_decompressqueue, u.kthread_work));
+}
+#endif
+
 static struct page *pickup_page_for_submission(struct z_erofs_pcluster *pcl,
 					       unsigned int nr,
 					       struct list_head *pagepool,
@@ -222,6 +222,10 @@ struct eventpoll {
 	unsigned int napi_id;
 #endif
 
+	/* wakeup batching, set through EPIOCSBATCH */
+	unsigned int batch_min;
+	unsigned int batch_usecs;
+
 #ifdef CONFIG_DEBUG_LOCK_ALLOC
 	/* tracks wakeup nests for lockdep validation */
 	u8 nests;
@@ -878,6 +882,36 @@ static void ep_show_fdinfo(struct seq_file *m, struct file *f)
 }
 #endif
 
+/* Upper bound for epoll_batch_params.max_wait_usecs */
+#define EP_MAX_BATCH_USECS	USEC_PER_SEC
+
+static long ep_eventpoll_ioctl(struct file *file, unsigned int cmd,
+			       unsigned long arg)
+{
+	struct eventpoll *ep = file->private_data;
+	void __user *uarg = (void __user *)arg;
+	struct epoll_batch_params params;
+
+	switch (cmd) {
+	case EPIOCSBATCH:
+		if (copy_from_user(&params, uarg, sizeof(params)))
+			return -EFAULT;
+		if (params.max_wait_usecs > EP_MAX_BATCH_USECS)
+			return -EINVAL;
+		WRITE_ONCE(ep->batch_min, params.min_events);
+		WRITE_ONCE(ep->batch_usecs, params.max_wait_usecs);
+		return 0;
+	case EPIOCGBATCH:
+		params.min_events = READ_ONCE(ep->batch_min);
+		params.max_wait_usecs = READ_ONCE(ep->batch_usecs);
+		if (copy_to_user(uarg, &params, sizeof(params)))
+			return -EFAULT;
+		return 0;
+	default:
+		return -ENOIOCTLCMD;
+	}
+}
+
 /* File callbacks that implement the eventpoll file behaviour */
 static const struct file_operations eventpoll_fops = {
 #ifdef CONFIG_PROC_FS
@@ -886,6 +920,8 @@ static const struct file_operations eventpoll_fops = {
 	.release	= ep_eventpoll_release,
 	.poll		= ep_eventpoll_poll,
 	.llseek		= noop_llseek,
+	.unlocked_ioctl	= ep_eventpoll_ioctl,
+	.compat_ioctl	= compat_ptr_ioctl,
 };
 
 /*
@@ -1739,6 +1775,48 @@ static struct timespec64 *ep_timeout_to_timespec(struct timespec64 *to, long ms)
 	return to;
 }
 
+/*
+ * Count the items on the ready list, stopping at @max. Taking the lock for
+ * write keeps ep_poll_callback() from appending while we walk the list.
+ */
+static unsigned int ep_ready_count(struct eventpoll *ep, unsigned int max)
+{
+	struct list_head *pos;
+	unsigned int n = 0;
+
+	write_lock_irq(&ep->lock);
+	list_for_each(pos, &ep->rdllist) {
+		if (++n >= max)
+			break;
+	}
+	write_unlock_irq(&ep->lock);
+
+	return n;
+}
+
+/*
+ * With wakeup batching enabled, give more events the chance to become ready
+ * before harvesting them. We sleep on a timer only, not on ep->wq, so the
+ * events arriving meanwhile don't wake us up one by one.
+ */
+static void ep_batch_wait(struct eventpoll *ep, int maxevents, ktime_t *to)
+{
+	unsigned int usecs = READ_ONCE(ep->batch_usecs);
+	unsigned int want = min_t(unsigned int, READ_ONCE(ep->batch_min),
+				  maxevents);
+	ktime_t expires;
+
+	if (!usecs || want <= 1 || ep_ready_count(ep, want) >= want)
+		return;
+
+	expires = ktime_add_us(ktime_get(), usecs);
+	if (to && ktime_before(*to, expires))
+		expires = *to;
+
+	set_current_state(TASK_INTERRUPTIBLE);
+	schedule_hrtimeout_range(&expires, 0, HRTIMER_MODE_ABS);
+}
+
 /**
  * ep_poll - Retrieves ready events, and delivers them to the caller supplied
  *           event buffer.
@@ -1760,6 +1838,7 @@ static int ep_poll(struct eventpoll *ep, struct epoll_event __user *events,
 		   int maxevents, struct timespec64 *timeout)
 {
 	int res, eavail, timed_out = 0;
+	bool batched = false;
 	u64 slack = 0;
 	wait_queue_entry_t wait;
 	ktime_t expires, *to = NULL;
@@ -1790,6 +1869,12 @@ static int ep_poll(struct eventpoll *ep, struct epoll_event __user *events,
 
 	while (1) {
 		if (eavail) {
+			/* at most one batching window per call */
+			if (!timed_out && !batched) {
+				batched = true;
+				ep_batch_wait(ep, maxevents, to);
+			}
+
 			/*
 			 * Try to transfer events to user space. In case we get
 			 * 0 events and there's still timeout left over, we go
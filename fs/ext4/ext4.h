@@ -1614,6 +1614,8 @@ struct ext4_sb_info {
 	struct ratelimit_state s_msg_ratelimit_state;
 	atomic_t s_warning_count;
 	atomic_t s_msg_count;
+	/* inodes that outgrew their inline data since mount */
+	atomic_t s_inline_conversions;
 
 	/* Encryption policy for '-o test_dummy_encryption' */
 	struct fscrypt_dummy_policy s_dummy_enc_policy;
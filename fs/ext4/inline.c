@@ -454,6 +454,7 @@ static int ext4_destroy_inline_data_nolock(handle_t *handle,
 	EXT4_I(inode)->i_inline_off = 0;
 	EXT4_I(inode)->i_inline_size = 0;
 	ext4_clear_inode_state(inode, EXT4_STATE_MAY_INLINE_DATA);
+	atomic_inc(&EXT4_SB(inode->i_sb)->s_inline_conversions);
 out:
 	brelse(is.iloc.bh);
 	if (error == -ENODATA)
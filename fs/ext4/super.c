@@ -5120,6 +5120,7 @@ static int ext4_fill_super(struct super_block *sb, void *data, int silent)
 	ratelimit_state_init(&sbi->s_msg_ratelimit_state, 5 * HZ, 10);
 	atomic_set(&sbi->s_warning_count, 0);
 	atomic_set(&sbi->s_msg_count, 0);
+	atomic_set(&sbi->s_inline_conversions, 0);
 
 	kfree(orig_data);
 	return 0;
@@ -228,6 +228,7 @@ EXT4_RW_ATTR_SBI_UL(simulate_fail, s_simulate_fail);
 #endif
 EXT4_RO_ATTR_SBI_ATOMIC(warning_count, s_warning_count);
 EXT4_RO_ATTR_SBI_ATOMIC(msg_count, s_msg_count);
+EXT4_RO_ATTR_SBI_ATOMIC(inline_data_conversions, s_inline_conversions);
 EXT4_RO_ATTR_ES_UI(errors_count, s_error_count);
 EXT4_RO_ATTR_ES_U8(first_error_errcode, s_first_error_errcode);
 EXT4_RO_ATTR_ES_U8(last_error_errcode, s_last_error_errcode);
@@ -275,6 +276,7 @@ static struct attribute *ext4_attrs[] = {
 	ATTR_LIST(errors_count),
 	ATTR_LIST(warning_count),
 	ATTR_LIST(msg_count),
+	ATTR_LIST(inline_data_conversions),
 	ATTR_LIST(first_error_ino),
 	ATTR_LIST(last_error_ino),
 	ATTR_LIST(first_error_block),
@@ -618,6 +618,20 @@ static void *f2fs_vmap(struct page **pages, unsigned int count)
 	return buf;
 }
 
+static void f2fs_account_compress(struct compress_ctx *cc, u64 start,
+				  int ret)
+{
+	struct f2fs_sb_info *sbi = F2FS_I_SB(cc->inode);
+
+	atomic64_add(ktime_get_ns() - start, &sbi->compr_nsecs);
+	if (ret && ret != -EAGAIN)
+		return;
+	atomic64_add(cc->rlen, &sbi->compr_in_bytes);
+	/* data that doesn't compress is written as is */
+	atomic64_add(ret ? cc->rlen : (size_t)cc->nr_cpages << PAGE_SHIFT,
+		     &sbi->compr_out_bytes);
+}
+
 static int f2fs_compress_pages(struct compress_ctx *cc)
 {
 	struct f2fs_inode_info *fi = F2FS_I(cc->inode);
@@ -625,6 +639,7 @@ static int f2fs_compress_pages(struct compress_ctx *cc)
 				f2fs_cops[fi->i_compress_algorithm];
 	unsigned int max_len, new_nr_cpages;
 	struct page **new_cpages;
+	u64 start = ktime_get_ns();
 	u32 chksum = 0;
 	int i, ret;
 
@@ -720,6 +735,7 @@ static int f2fs_compress_pages(struct compress_ctx *cc)
 	cc->cpages = new_cpages;
 	cc->nr_cpages = new_nr_cpages;
 
+	f2fs_account_compress(cc, start, 0);
 	trace_f2fs_compress_pages_end(cc->inode, cc->cluster_idx,
 							cc->clen, ret);
 	return 0;
@@ -739,6 +755,7 @@ static int f2fs_compress_pages(struct compress_ctx *cc)
 	if (cops->destroy_compress_ctx)
 		cops->destroy_compress_ctx(cc);
 out:
+	f2fs_account_compress(cc, start, ret);
 	trace_f2fs_compress_pages_end(cc->inode, cc->cluster_idx,
 							cc->clen, ret);
 	return ret;
@@ -1495,29 +1512,64 @@ static int f2fs_write_raw_pages(struct compress_ctx *cc,
 	return err;
 }
 
-int f2fs_write_multi_pages(struct compress_ctx *cc,
-					int *submitted,
-					struct writeback_control *wbc,
-					enum iostat_type io_type)
-{
+/* a full cluster being compressed by a worker, see f2fs_queue_cluster() */
+struct compress_work {
+	struct list_head list;
+	struct work_struct work;
+	struct compress_ctx cc;
 	int err;
+};
 
-	*submitted = 0;
-	if (cluster_may_compress(cc)) {
-		err = f2fs_compress_pages(cc);
-		if (err == -EAGAIN) {
-			goto write;
-		} else if (err) {
-			f2fs_put_rpages_wbc(cc, wbc, true, 1);
-			goto destroy_out;
-		}
+static void f2fs_compress_work(struct work_struct *work)
+{
+	struct compress_work *cw = container_of(work, struct compress_work,
+						work);
 
-		err = f2fs_write_compressed_pages(cc, submitted,
-							wbc, io_type);
-		if (!err)
-			return 0;
-		f2fs_bug_on(F2FS_I_SB(cc->inode), err != -EAGAIN);
+	cw->err = f2fs_compress_pages(&cw->cc);
+}
+
+/*
+ * Hand the cluster over to a compression worker. The worker context takes
+ * over the locked raw pages, and @cc is left empty for the next cluster.
+ */
+static int f2fs_queue_cluster(struct compress_ctx *cc,
+			      struct compress_batch *batch)
+{
+	struct f2fs_sb_info *sbi = F2FS_I_SB(cc->inode);
+	struct compress_work *cw;
+
+	cw = kmalloc(sizeof(*cw), GFP_NOFS);
+	if (!cw)
+		return -ENOMEM;
+
+	cw->cc = *cc;
+	INIT_WORK(&cw->work, f2fs_compress_work);
+	list_add_tail(&cw->list, &batch->works);
+	batch->nr++;
+	queue_work(sbi->compress_wq, &cw->work);
+
+	cc->rpages = NULL;
+	cc->nr_rpages = 0;
+	cc->nr_cpages = 0;
+	cc->cluster_idx = NULL_CLUSTER;
+	return 0;
+}
+
+static int f2fs_write_cluster(struct compress_ctx *cc, int err,
+			      int *submitted, struct writeback_control *wbc,
+			      enum iostat_type io_type)
+{
+	if (err == -EAGAIN) {
+		goto write;
+	} else if (err) {
+		f2fs_put_rpages_wbc(cc, wbc, true, 1);
+		goto destroy_out;
 	}
+
+	err = f2fs_write_compressed_pages(cc, submitted, wbc, io_type);
+	if (!err)
+		return 0;
+	f2fs_bug_on(F2FS_I_SB(cc->inode), err != -EAGAIN);
 write:
 	f2fs_bug_on(F2FS_I_SB(cc->inode), *submitted);
 
@@ -1528,6 +1580,73 @@ int f2fs_write_multi_pages(struct compress_ctx *cc,
 	return err;
 }
 
+/*
+ * Write out the clusters queued to compression workers, in the order they
+ * were queued. Returns the first error, the remaining clusters are still
+ * written or released.
+ */
+int f2fs_flush_compress_batch(struct compress_batch *batch,
+					int *submitted,
+					struct writeback_control *wbc,
+					enum iostat_type io_type)
+{
+	struct compress_work *cw, *tmp;
+	int ret = 0;
+
+	*submitted = 0;
+	list_for_each_entry_safe(cw, tmp, &batch->works, list) {
+		int _submitted = 0;
+		int err;
+
+		flush_work(&cw->work);
+		err = f2fs_write_cluster(&cw->cc, cw->err, &_submitted,
+					 wbc, io_type);
+		*submitted += _submitted;
+		if (err && !ret)
+			ret = err;
+
+		list_del(&cw->list);
+		kfree(cw);
+	}
+	batch->nr = 0;
+	return ret;
+}
+
+/*
+ * With compress_workers set, full clusters are compressed by workers in
+ * parallel and written once @batch holds that many of them. Otherwise, the
+ * cluster is compressed and written right away.
+ */
+int f2fs_write_multi_pages(struct compress_ctx *cc,
+					struct compress_batch *batch,
+					int *submitted,
+					struct writeback_control *wbc,
+					enum iostat_type io_type)
+{
+	struct f2fs_sb_info *sbi = F2FS_I_SB(cc->inode);
+	unsigned int workers = READ_ONCE(sbi->compress_workers);
+	int _submitted = 0;
+	int err, ret = 0;
+
+	*submitted = 0;
+	if (batch && workers > 1 && sbi->compress_wq &&
+	    cluster_may_compress(cc) && !f2fs_queue_cluster(cc, batch)) {
+		if (batch->nr < workers)
+			return 0;
+		return f2fs_flush_compress_batch(batch, submitted, wbc,
+						 io_type);
+	}
+
+	/* keep clusters going out in file order */
+	if (batch && batch->nr)
+		ret = f2fs_flush_compress_batch(batch, submitted, wbc, io_type);
+
+	err = cluster_may_compress(cc) ? f2fs_compress_pages(cc) : -EAGAIN;
+	err = f2fs_write_cluster(cc, err, &_submitted, wbc, io_type);
+	*submitted += _submitted;
+	return ret ? ret : err;
+}
+
 static void f2fs_free_dic(struct decompress_io_ctx *dic);
 
 struct decompress_io_ctx *f2fs_alloc_dic(struct compress_ctx *cc)
@@ -2830,6 +2830,10 @@ static int f2fs_write_cache_pages(struct address_space *mapping,
 		.rlen = PAGE_SIZE * F2FS_I(inode)->i_cluster_size,
 		.private = NULL,
 	};
+	struct compress_batch batch = {
+		.works = LIST_HEAD_INIT(batch.works),
+		.nr = 0,
+	};
 #endif
 	int nr_pages;
 	pgoff_t index;
@@ -2889,7 +2893,8 @@ static int f2fs_write_cache_pages(struct address_space *mapping,
 				if (!f2fs_cluster_can_merge_page(&cc,
 								page->index)) {
 					ret = f2fs_write_multi_pages(&cc,
-						&submitted, wbc, io_type);
+						&batch, &submitted, wbc,
+						io_type);
 					if (!ret)
 						need_readd = true;
 					goto result;
@@ -3013,7 +3018,8 @@ static int f2fs_write_cache_pages(struct address_space *mapping,
 #ifdef CONFIG_F2FS_FS_COMPRESSION
 	/* flush remained pages in compress cluster */
 	if (f2fs_compressed_file(inode) && !f2fs_cluster_is_empty(&cc)) {
-		ret = f2fs_write_multi_pages(&cc, &submitted, wbc, io_type);
+		ret = f2fs_write_multi_pages(&cc, &batch, &submitted, wbc,
+					     io_type);
 		nwritten += submitted;
 		wbc->nr_to_write -= submitted;
 		if (ret) {
@@ -3021,6 +3027,19 @@ static int f2fs_write_cache_pages(struct address_space *mapping,
 			retry = 0;
 		}
 	}
+	/* and the clusters still with the compression workers */
+	if (batch.nr) {
+		int err = f2fs_flush_compress_batch(&batch, &submitted, wbc,
+						    io_type);
+
+		nwritten += submitted;
+		wbc->nr_to_write -= submitted;
+		if (err && !ret) {
+			ret = err;
+			done = 1;
+			retry = 0;
+		}
+	}
 	if (f2fs_compressed_file(inode))
 		f2fs_destroy_compress_ctx(&cc, false);
 #endif
@@ -4081,6 +4100,18 @@ int f2fs_init_post_read_wq(struct f2fs_sb_info *sbi)
 						 num_online_cpus());
 	if (!sbi->post_read_wq)
 		return -ENOMEM;
+
+#ifdef CONFIG_F2FS_FS_COMPRESSION
+	if (f2fs_sb_has_compression(sbi)) {
+		sbi->compress_wq = alloc_workqueue("f2fs_compress_wq",
+						   WQ_UNBOUND, 0);
+		if (!sbi->compress_wq) {
+			destroy_workqueue(sbi->post_read_wq);
+			sbi->post_read_wq = NULL;
+			return -ENOMEM;
+		}
+	}
+#endif
 	return 0;
 }
 
@@ -4088,6 +4119,10 @@ void f2fs_destroy_post_read_wq(struct f2fs_sb_info *sbi)
 {
 	if (sbi->post_read_wq)
 		destroy_workqueue(sbi->post_read_wq);
+#ifdef CONFIG_F2FS_FS_COMPRESSION
+	if (sbi->compress_wq)
+		destroy_workqueue(sbi->compress_wq);
+#endif
 }
 
 int __init f2fs_init_bio_entry_cache(void)
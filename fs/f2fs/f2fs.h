@@ -1351,6 +1351,15 @@ struct compress_ctx {
 	void *private2;			/* extra payload buffer */
 };
 
+/* upper bound for the compress_workers sysfs knob */
+#define F2FS_MAX_COMPRESS_WORKERS	64
+
+/* clusters of one writeback pass handed to compression workers */
+struct compress_batch {
+	struct list_head works;		/* queued clusters, in file order */
+	unsigned int nr;		/* length of works */
+};
+
 /* compress context for write IO path */
 struct compress_io_ctx {
 	u32 magic;			/* magic number to indicate page is compressed */
@@ -1623,6 +1632,12 @@ struct f2fs_sb_info {
 #ifdef CONFIG_F2FS_FS_COMPRESSION
 	struct kmem_cache *page_array_slab;	/* page array entry */
 	unsigned int page_array_slab_size;	/* default page array slab size */
+
+	struct workqueue_struct *compress_wq;	/* parallel cluster compression */
+	unsigned int compress_workers;		/* clusters compressed at once */
+	atomic64_t compr_in_bytes;		/* data fed to compression */
+	atomic64_t compr_out_bytes;		/* size written for that data */
+	atomic64_t compr_nsecs;			/* time spent compressing */
 #endif
 };
 
@@ -3941,6 +3956,11 @@ bool f2fs_cluster_is_empty(struct compress_ctx *cc);
 bool f2fs_cluster_can_merge_page(struct compress_ctx *cc, pgoff_t index);
 void f2fs_compress_ctx_add_page(struct compress_ctx *cc, struct page *page);
 int f2fs_write_multi_pages(struct compress_ctx *cc,
+						struct compress_batch *batch,
+						int *submitted,
+						struct writeback_control *wbc,
+						enum iostat_type io_type);
+int f2fs_flush_compress_batch(struct compress_batch *batch,
 						int *submitted,
 						struct writeback_control *wbc,
 						enum iostat_type io_type);
@@ -227,6 +227,29 @@ static ssize_t avg_vblocks_show(struct f2fs_attr *a,
 }
 #endif
 
+#ifdef CONFIG_F2FS_FS_COMPRESSION
+static ssize_t compr_input_kbytes_show(struct f2fs_attr *a,
+		struct f2fs_sb_info *sbi, char *buf)
+{
+	return sprintf(buf, "%llu\n",
+		(unsigned long long)atomic64_read(&sbi->compr_in_bytes) >> 10);
+}
+
+static ssize_t compr_output_kbytes_show(struct f2fs_attr *a,
+		struct f2fs_sb_info *sbi, char *buf)
+{
+	return sprintf(buf, "%llu\n",
+		(unsigned long long)atomic64_read(&sbi->compr_out_bytes) >> 10);
+}
+
+static ssize_t compr_time_ms_show(struct f2fs_attr *a,
+		struct f2fs_sb_info *sbi, char *buf)
+{
+	return sprintf(buf, "%llu\n", (unsigned long long)
+		div_u64(atomic64_read(&sbi->compr_nsecs), NSEC_PER_MSEC));
+}
+#endif
+
 static ssize_t main_blkaddr_show(struct f2fs_attr *a,
 				struct f2fs_sb_info *sbi, char *buf)
 {
@@ -442,6 +465,15 @@ static ssize_t __sbi_store(struct f2fs_attr *a,
 		return count;
 	}
 
+#ifdef CONFIG_F2FS_FS_COMPRESSION
+	if (!strcmp(a->attr.name, "compress_workers")) {
+		if (t > F2FS_MAX_COMPRESS_WORKERS)
+			return -EINVAL;
+		WRITE_ONCE(sbi->compress_workers, t);
+		return count;
+	}
+#endif
+
 	if (!strcmp(a->attr.name, "iostat_enable")) {
 		sbi->iostat_enable = !!t;
 		if (!sbi->iostat_enable)
@@ -638,6 +670,12 @@ F2FS_GENERAL_RO_ATTR(unusable);
 F2FS_GENERAL_RO_ATTR(encoding);
 F2FS_GENERAL_RO_ATTR(mounted_time_sec);
 F2FS_GENERAL_RO_ATTR(main_blkaddr);
+#ifdef CONFIG_F2FS_FS_COMPRESSION
+F2FS_RW_ATTR(F2FS_SBI, f2fs_sb_info, compress_workers, compress_workers);
+F2FS_GENERAL_RO_ATTR(compr_input_kbytes);
+F2FS_GENERAL_RO_ATTR(compr_output_kbytes);
+F2FS_GENERAL_RO_ATTR(compr_time_ms);
+#endif
 #ifdef CONFIG_F2FS_STAT_FS
 F2FS_STAT_ATTR(STAT_INFO, f2fs_stat_info, cp_foreground_calls, cp_count);
 F2FS_STAT_ATTR(STAT_INFO, f2fs_stat_info, cp_background_calls, bg_cp_count);
@@ -727,6 +765,12 @@ static struct attribute *f2fs_attrs[] = {
 	ATTR_LIST(current_reserved_blocks),
 	ATTR_LIST(encoding),
 	ATTR_LIST(mounted_time_sec),
+#ifdef CONFIG_F2FS_FS_COMPRESSION
+	ATTR_LIST(compress_workers),
+	ATTR_LIST(compr_input_kbytes),
+	ATTR_LIST(compr_output_kbytes),
+	ATTR_LIST(compr_time_ms),
+#endif
 #ifdef CONFIG_F2FS_STAT_FS
 	ATTR_LIST(cp_foreground_calls),
 	ATTR_LIST(cp_background_calls),
@@ -422,6 +422,8 @@ static long do_fcntl(int fd, unsigned int cmd, unsigned long arg,
 		break;
 	case F_SETPIPE_SZ:
 	case F_GETPIPE_SZ:
+	case F_SETPIPE_LOWAT:
+	case F_GETPIPE_LOWAT:
 		err = pipe_fcntl(filp, cmd, arg);
 		break;
 	case F_ADD_SEALS:
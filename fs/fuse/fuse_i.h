@@ -31,13 +31,17 @@
 #include <linux/pid_namespace.h>
 #include <linux/refcount.h>
 #include <linux/user_namespace.h>
+#include <linux/idr.h>
 
 /** Default max number of pages that can be used in a single read request */
 #define FUSE_DEFAULT_MAX_PAGES_PER_REQ 32
 
-/** Maximum of max_pages received in init_out */
+/** Default maximum of max_pages received in init_out */
 #define FUSE_MAX_MAX_PAGES 256
 
+/** Upper bound for the max_pages_limit module parameter */
+#define FUSE_MAX_PAGES_LIMIT 1024
+
 /** Bias for fi->writectr, meaning new writepages must not be sent */
 #define FUSE_NOWRITE INT_MIN
 
@@ -56,6 +60,7 @@ extern struct mutex fuse_mutex;
 /** Module parameters */
 extern unsigned max_user_bgreq;
 extern unsigned max_user_congthresh;
+extern unsigned max_pages_limit;
 
 /* One forget request */
 struct fuse_forget_link {
@@ -180,6 +185,12 @@ struct fuse_conn;
 struct fuse_mount;
 struct fuse_release_args;
 
+/** Backing file that passthrough I/O is forwarded to */
+struct fuse_passthrough {
+	struct file *filp;
+	const struct cred *cred;
+};
+
 /** FUSE specific file data */
 struct fuse_file {
 	/** Fuse connection for this file */
@@ -231,6 +242,9 @@ struct fuse_file {
 	/** Wait queue head for poll */
 	wait_queue_head_t poll_wait;
 
+	/** Backing file for passthrough I/O, if the daemon set one up */
+	struct fuse_passthrough passthrough;
+
 	/** Has flock been performed on this file? */
 	bool flock:1;
 };
@@ -564,6 +578,12 @@ struct fuse_conn {
 	/** rbtree of fuse_files waiting for poll events indexed by ph */
 	struct rb_root polled_files;
 
+	/** Backing files registered for passthrough, indexed by id */
+	struct idr passthrough_req;
+
+	/** Protects passthrough_req */
+	spinlock_t passthrough_req_lock;
+
 	/** Maximum number of outstanding background requests */
 	unsigned max_background;
 
@@ -645,6 +665,9 @@ struct fuse_conn {
 	 */
 	unsigned handle_killpriv_v2:1;
 
+	/** Read/write/mmap may be forwarded to a backing file */
+	unsigned passthrough:1;
+
 	/*
 	 * The following bitfields are only for optimization purposes
 	 * and hence races in setting them will not cause malfunction
@@ -1215,4 +1238,14 @@ void fuse_dax_inode_cleanup(struct inode *inode);
 bool fuse_dax_check_alignment(struct fuse_conn *fc, unsigned int map_alignment);
 void fuse_dax_cancel_work(struct fuse_conn *fc);
 
+/* passthrough.c */
+int fuse_passthrough_open(struct fuse_dev *fud, u32 fd);
+void fuse_passthrough_setup(struct fuse_conn *fc, struct fuse_file *ff,
+			    struct fuse_open_out *openarg);
+void fuse_passthrough_release(struct fuse_passthrough *passthrough);
+void fuse_passthrough_conn_free(struct fuse_conn *fc);
+ssize_t fuse_passthrough_read_iter(struct kiocb *iocb, struct iov_iter *to);
+ssize_t fuse_passthrough_write_iter(struct kiocb *iocb, struct iov_iter *from);
+int fuse_passthrough_mmap(struct file *file, struct vm_area_struct *vma);
+
 #endif /* _FS_FUSE_I_H */
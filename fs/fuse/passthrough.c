@@ -0,0 +1,234 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * passthrough: serve reads, writes and mmap of a FUSE file straight from a
+ * backing file opened by the daemon, without a round trip through it.
+ */
+
+#include "fuse_i.h"
+
+#include <linux/file.h>
+#include <linux/fs_stack.h>
+#include <linux/idr.h>
+#include <linux/uio.h>
+
+/*
+ * A backing file registered with FUSE_DEV_IOC_PASSTHROUGH_OPEN, waiting for
+ * the open reply that names it.
+ */
+struct fuse_passthrough_entry {
+	struct file *filp;
+	const struct cred *cred;
+};
+
+/*
+ * The backing file is accessed through a synchronous kiocb of its own, so
+ * an async request completes inline and IOCB_HIPRI has nothing to poll.
+ */
+static rwf_t fuse_iocb_to_rwf(int ifl)
+{
+	rwf_t flags = 0;
+
+	if (ifl & IOCB_NOWAIT)
+		flags |= RWF_NOWAIT;
+	if (ifl & IOCB_DSYNC)
+		flags |= RWF_DSYNC;
+	if (ifl & IOCB_SYNC)
+		flags |= RWF_SYNC;
+
+	return flags;
+}
+
+static void fuse_passthrough_copy_size(struct inode *dst, struct file *src)
+{
+	i_size_write(dst, i_size_read(file_inode(src)));
+}
+
+ssize_t fuse_passthrough_read_iter(struct kiocb *iocb, struct iov_iter *to)
+{
+	struct fuse_file *ff = iocb->ki_filp->private_data;
+	struct file *backing = ff->passthrough.filp;
+	const struct cred *old_cred;
+	ssize_t ret;
+
+	if (!iov_iter_count(to))
+		return 0;
+
+	old_cred = override_creds(ff->passthrough.cred);
+	ret = vfs_iter_read(backing, to, &iocb->ki_pos,
+			    fuse_iocb_to_rwf(iocb->ki_flags));
+	revert_creds(old_cred);
+
+	if (ret >= 0)
+		fsstack_copy_attr_atime(file_inode(iocb->ki_filp),
+					file_inode(backing));
+	return ret;
+}
+
+ssize_t fuse_passthrough_write_iter(struct kiocb *iocb, struct iov_iter *from)
+{
+	struct file *file = iocb->ki_filp;
+	struct inode *inode = file_inode(file);
+	struct fuse_file *ff = file->private_data;
+	struct file *backing = ff->passthrough.filp;
+	const struct cred *old_cred;
+	ssize_t ret;
+
+	if (!iov_iter_count(from))
+		return 0;
+
+	inode_lock(inode);
+	if (iocb->ki_flags & IOCB_APPEND)
+		fuse_passthrough_copy_size(inode, backing);
+
+	old_cred = override_creds(ff->passthrough.cred);
+	file_start_write(backing);
+	ret = vfs_iter_write(backing, from, &iocb->ki_pos,
+			     fuse_iocb_to_rwf(iocb->ki_flags));
+	file_end_write(backing);
+	revert_creds(old_cred);
+
+	if (ret > 0) {
+		fuse_passthrough_copy_size(inode, backing);
+		fsstack_copy_attr_times(inode, file_inode(backing));
+	}
+	inode_unlock(inode);
+
+	return ret;
+}
+
+/*
+ * Map the backing file instead, so that page cache and I/O stay coherent
+ * with reads and writes going to it.
+ */
+int fuse_passthrough_mmap(struct file *file, struct vm_area_struct *vma)
+{
+	struct fuse_file *ff = file->private_data;
+	struct file *backing = ff->passthrough.filp;
+	const struct cred *old_cred;
+	int ret;
+
+	if (!backing->f_op->mmap)
+		return -ENODEV;
+
+	if (WARN_ON(file != vma->vm_file))
+		return -EIO;
+
+	vma->vm_file = get_file(backing);
+
+	old_cred = override_creds(ff->passthrough.cred);
+	ret = call_mmap(vma->vm_file, vma);
+	revert_creds(old_cred);
+
+	if (ret)
+		fput(backing);
+	else
+		fput(file);
+
+	return ret;
+}
+
+/*
+ * Register @fd as a backing file, for the daemon to name in an open reply.
+ * Returns the id to put in fuse_open_out.passthrough_fh.
+ */
+int fuse_passthrough_open(struct fuse_dev *fud, u32 fd)
+{
+	struct fuse_conn *fc = fud->fc;
+	struct fuse_passthrough_entry *entry;
+	struct file *backing;
+	int res;
+
+	if (!fc->passthrough)
+		return -EPERM;
+
+	backing = fget(fd);
+	if (!backing)
+		return -EBADF;
+
+	res = -EINVAL;
+	if (!backing->f_op->read_iter || !backing->f_op->write_iter)
+		goto out_fput;
+
+	/* no stacking on top of another stacked filesystem, FUSE included */
+	if (file_inode(backing)->i_sb->s_stack_depth >=
+	    FILESYSTEM_MAX_STACK_DEPTH)
+		goto out_fput;
+
+	res = -ENOMEM;
+	entry = kmalloc(sizeof(*entry), GFP_KERNEL);
+	if (!entry)
+		goto out_fput;
+
+	entry->filp = backing;
+	entry->cred = prepare_creds();
+	if (!entry->cred)
+		goto out_free;
+
+	idr_preload(GFP_KERNEL);
+	spin_lock(&fc->passthrough_req_lock);
+	res = idr_alloc(&fc->passthrough_req, entry, 1, 0, GFP_ATOMIC);
+	spin_unlock(&fc->passthrough_req_lock);
+	idr_preload_end();
+	if (res > 0)
+		return res;
+
+	put_cred(entry->cred);
+out_free:
+	kfree(entry);
+out_fput:
+	fput(backing);
+	return res;
+}
+
+/*
+ * Attach the backing file named by an open reply to @ff. The id is used up,
+ * a later open needs a new FUSE_DEV_IOC_PASSTHROUGH_OPEN. An unknown id is
+ * not an error: the file is then served by the daemon as usual.
+ */
+void fuse_passthrough_setup(struct fuse_conn *fc, struct fuse_file *ff,
+			    struct fuse_open_out *openarg)
+{
+	struct fuse_passthrough_entry *entry;
+
+	if (!fc->passthrough || !openarg->passthrough_fh)
+		return;
+
+	spin_lock(&fc->passthrough_req_lock);
+	entry = idr_remove(&fc->passthrough_req, openarg->passthrough_fh);
+	spin_unlock(&fc->passthrough_req_lock);
+	if (!entry)
+		return;
+
+	ff->passthrough.filp = entry->filp;
+	ff->passthrough.cred = entry->cred;
+	kfree(entry);
+}
+
+void fuse_passthrough_release(struct fuse_passthrough *passthrough)
+{
+	if (passthrough->filp) {
+		fput(passthrough->filp);
+		passthrough->filp = NULL;
+	}
+	if (passthrough->cred) {
+		put_cred(passthrough->cred);
+		passthrough->cred = NULL;
+	}
+}
+
+static int fuse_passthrough_free_entry(int id, void *p, void *data)
+{
+	struct fuse_passthrough_entry *entry = p;
+
+	fput(entry->filp);
+	put_cred(entry->cred);
+	kfree(entry);
+	return 0;
+}
+
+/* Drop backing files registered but never named in an open reply */
+void fuse_passthrough_conn_free(struct fuse_conn *fc)
+{
+	idr_for_each(&fc->passthrough_req, fuse_passthrough_free_entry, NULL);
+	idr_destroy(&fc->passthrough_req);
+}
@@ -1103,6 +1103,33 @@ void io_wq_put_and_exit(struct io_wq *wq)
 	io_wq_put(wq);
 }
 
+/*
+ * Set the per-node limits on bounded and unbounded workers, a count of 0
+ * leaves that limit alone. The previous limits are returned in @new_count.
+ * Lowering a limit doesn't kill workers, the excess ones exit once idle.
+ */
+int io_wq_max_workers(struct io_wq *wq, int *new_count)
+{
+	int prev[2] = { 0, 0 };
+	int i, node;
+
+	for_each_node(node) {
+		struct io_wqe *wqe = wq->wqes[node];
+
+		raw_spin_lock_irq(&wqe->lock);
+		for (i = 0; i < 2; i++) {
+			prev[i] = max_t(int, prev[i], wqe->acct[i].max_workers);
+			if (new_count[i])
+				wqe->acct[i].max_workers = new_count[i];
+		}
+		raw_spin_unlock_irq(&wqe->lock);
+	}
+
+	for (i = 0; i < 2; i++)
+		new_count[i] = prev[i];
+	return 0;
+}
+
 static bool io_wq_worker_affinity(struct io_worker *worker, void *data)
 {
 	struct task_struct *task = worker->task;
@@ -242,6 +242,14 @@ struct io_buffer {
 	__u16 bid;
 };
 
+/* A buffer group provided through a ring shared with userspace */
+struct io_buf_ring {
+	struct page **pages;
+	int nr_pages;
+	__u16 head;
+	__u16 mask;
+};
+
 struct io_restriction {
 	DECLARE_BITMAP(register_op, IORING_REGISTER_LAST);
 	DECLARE_BITMAP(sqe_op, IORING_OP_LAST);
@@ -267,6 +275,11 @@ struct io_sq_data {
 	struct wait_queue_head	wait;
 
 	unsigned		sq_thread_idle;
+	/* all rings asked for IORING_SETUP_SQ_ADAPTIVE_IDLE */
+	bool			adaptive_idle;
+	/* moving average of the gap between bursts of submissions, jiffies */
+	unsigned		idle_gap;
+	unsigned long		last_busy;
 	int			sq_cpu;
 	pid_t			task_pid;
 	pid_t			task_tgid;
@@ -380,6 +393,15 @@ struct io_ring_ctx {
 	const struct cred	*sq_creds;	/* cred used for __io_sq_thread() */
 	struct io_sq_data	*sq_data;	/* if using sq thread polling */
 
+	/* SQPOLL statistics, reported through fdinfo */
+	struct {
+		u64			submitted;
+		u64			wakeups;
+		u64			wake_lat_total;	/* ns */
+		u64			wake_lat_max;	/* ns */
+		u64			wake_start;	/* ns, 0 if none pending */
+	} sq_stats;
+
 	struct wait_queue_head	sqo_sq_wait;
 	struct list_head	sqd_list;
 
@@ -404,6 +426,7 @@ struct io_ring_ctx {
 #endif
 
 	struct xarray		io_buffers;
+	struct xarray		io_buf_rings;
 
 	struct xarray		personalities;
 	u32			pers_next;
@@ -563,6 +586,8 @@ struct io_sr_msg {
 	int				bgid;
 	size_t				len;
 	struct io_buffer		*kbuf;
+	/* buffer length to select again for each multishot recv */
+	unsigned int			mshot_len;
 };
 
 struct io_open {
@@ -634,6 +659,14 @@ struct io_shutdown {
 	int				how;
 };
 
+struct io_sendzc {
+	struct file			*file;
+	u64				addr;
+	u32				len;
+	unsigned			msg_flags;
+	u16				buf_index;
+};
+
 struct io_rename {
 	struct file			*file;
 	int				old_dfd;
@@ -669,6 +702,17 @@ struct io_async_msghdr {
 	struct sockaddr_storage		addr;
 };
 
+/*
+ * Zero-copy send state. The request stays alive until the network stack drops
+ * its last reference on uarg, i.e. until the registered buffer may be reused.
+ */
+struct io_async_sendzc {
+	struct ubuf_info		uarg;
+	struct io_kiocb			*req;
+	int				res;
+	bool				res_posted;
+};
+
 struct io_async_rw {
 	struct iovec			fast_iov[UIO_FASTIOV];
 	const struct iovec		*free_iovec;
@@ -698,6 +742,7 @@ enum {
 	REQ_F_LTIMEOUT_ACTIVE_BIT,
 	REQ_F_COMPLETE_INLINE_BIT,
 	REQ_F_REISSUE_BIT,
+	REQ_F_APOLL_MULTISHOT_BIT,
 
 	/* not a real bit, just to check we're not overflowing the space */
 	__REQ_F_LAST_BIT,
@@ -743,6 +788,8 @@ enum {
 	REQ_F_COMPLETE_INLINE	= BIT(REQ_F_COMPLETE_INLINE_BIT),
 	/* caller should reissue async */
 	REQ_F_REISSUE		= BIT(REQ_F_REISSUE_BIT),
+	/* keeps posting CQEs and re-arming poll until it fails */
+	REQ_F_APOLL_MULTISHOT	= BIT(REQ_F_APOLL_MULTISHOT_BIT),
 };
 
 struct async_poll {
@@ -784,6 +831,7 @@ struct io_kiocb {
 		struct io_provide_buf	pbuf;
 		struct io_statx		statx;
 		struct io_shutdown	shutdown;
+		struct io_sendzc	sendzc;
 		struct io_rename	rename;
 		struct io_unlink	unlink;
 		/* use only after cleaning per-op data, see io_clean_op() */
@@ -1001,6 +1049,12 @@ static const struct io_op_def io_op_defs[] = {
 	},
 	[IORING_OP_RENAMEAT] = {},
 	[IORING_OP_UNLINKAT] = {},
+	[IORING_OP_SEND_ZC] = {
+		.needs_file		= 1,
+		.unbound_nonreg_file	= 1,
+		.pollout		= 1,
+		.async_size		= sizeof(struct io_async_sendzc),
+	},
 };
 
 static bool io_disarm_next(struct io_kiocb *req);
@@ -1154,6 +1208,7 @@ static struct io_ring_ctx *io_ring_ctx_alloc(struct io_uring_params *p)
 	INIT_LIST_HEAD(&ctx->cq_overflow_list);
 	init_completion(&ctx->ref_comp);
 	xa_init_flags(&ctx->io_buffers, XA_FLAGS_ALLOC1);
+	xa_init(&ctx->io_buf_rings);
 	xa_init_flags(&ctx->personalities, XA_FLAGS_ALLOC1);
 	mutex_init(&ctx->uring_lock);
 	init_waitqueue_head(&ctx->wait);
@@ -1547,6 +1602,44 @@ static void io_cqring_fill_event(struct io_kiocb *req, long res)
 	__io_cqring_fill_event(req, res, 0);
 }
 
+/*
+ * Results a multishot request posts from one issue before it completes, so
+ * that a socket which never runs dry cannot keep the submitter looping.
+ */
+#define IO_MULTISHOT_MAX_MORE	32
+
+/*
+ * Post an intermediate CQE for a multishot request, flagged with
+ * IORING_CQE_F_MORE. The overflow list holds requests rather than CQEs, so
+ * this fails if the CQ ring is full, and the caller then has to post the
+ * result as the final completion of the request instead.
+ */
+static bool io_cqring_fill_more(struct io_kiocb *req, long res,
+				unsigned int cflags)
+{
+	struct io_ring_ctx *ctx = req->ctx;
+	struct io_uring_cqe *cqe = NULL;
+	unsigned long flags;
+
+	spin_lock_irqsave(&ctx->completion_lock, flags);
+	/* don't overtake CQEs already waiting on the overflow list */
+	if (!test_bit(0, &ctx->cq_check_overflow))
+		cqe = io_get_cqring(ctx);
+	if (cqe) {
+		trace_io_uring_complete(ctx, req->user_data, res);
+		WRITE_ONCE(cqe->user_data, req->user_data);
+		WRITE_ONCE(cqe->res, res);
+		WRITE_ONCE(cqe->flags, cflags | IORING_CQE_F_MORE);
+		io_commit_cqring(ctx);
+	}
+	spin_unlock_irqrestore(&ctx->completion_lock, flags);
+
+	if (!cqe)
+		return false;
+	io_cqring_ev_posted(ctx);
+	return true;
+}
+
 static void io_req_complete_post(struct io_kiocb *req, long res,
 				 unsigned int cflags)
 {
@@ -2818,20 +2911,19 @@ static void kiocb_done(struct kiocb *kiocb, ssize_t ret,
 	}
 }
 
-static int io_import_fixed(struct io_kiocb *req, int rw, struct iov_iter *iter)
+static int __io_import_fixed(struct io_kiocb *req, int rw,
+			     struct iov_iter *iter, u64 buf_addr, size_t len,
+			     u16 buf_index)
 {
 	struct io_ring_ctx *ctx = req->ctx;
-	size_t len = req->rw.len;
 	struct io_mapped_ubuf *imu;
-	u16 index, buf_index = req->buf_index;
+	u16 index;
 	size_t offset;
-	u64 buf_addr;
 
 	if (unlikely(buf_index >= ctx->nr_user_bufs))
 		return -EFAULT;
 	index = array_index_nospec(buf_index, ctx->nr_user_bufs);
 	imu = &ctx->user_bufs[index];
-	buf_addr = req->rw.addr;
 
 	/* overflow */
 	if (buf_addr + len < buf_addr)
@@ -2885,6 +2977,12 @@ static int io_import_fixed(struct io_kiocb *req, int rw, struct iov_iter *iter)
 	return 0;
 }
 
+static int io_import_fixed(struct io_kiocb *req, int rw, struct iov_iter *iter)
+{
+	return __io_import_fixed(req, rw, iter, req->rw.addr, req->rw.len,
+				 req->buf_index);
+}
+
 static void io_ring_submit_unlock(struct io_ring_ctx *ctx, bool needs_lock)
 {
 	if (needs_lock)
@@ -2903,11 +3001,46 @@ static void io_ring_submit_lock(struct io_ring_ctx *ctx, bool needs_lock)
 		mutex_lock(&ctx->uring_lock);
 }
 
+static struct io_uring_buf *io_buf_ring_entry(struct io_buf_ring *br,
+					      unsigned int idx)
+{
+	size_t off = idx * sizeof(struct io_uring_buf);
+
+	return page_address(br->pages[off >> PAGE_SHIFT]) + (off & ~PAGE_MASK);
+}
+
+static struct io_buffer *io_ring_buffer_select(struct io_buf_ring *br,
+					       size_t *len)
+{
+	struct io_uring_buf_ring *ring = page_address(br->pages[0]);
+	struct io_uring_buf *buf;
+	struct io_buffer *kbuf;
+
+	/* pairs with the tail release in userspace, orders the bufs[] reads */
+	if (smp_load_acquire(&ring->tail) == br->head)
+		return ERR_PTR(-ENOBUFS);
+
+	kbuf = kmalloc(sizeof(*kbuf), GFP_KERNEL);
+	if (!kbuf)
+		return ERR_PTR(-ENOMEM);
+
+	buf = io_buf_ring_entry(br, br->head & br->mask);
+	kbuf->addr = READ_ONCE(buf->addr);
+	kbuf->len = min_t(__u32, READ_ONCE(buf->len), MAX_RW_COUNT);
+	kbuf->bid = READ_ONCE(buf->bid);
+	br->head++;
+
+	if (*len > kbuf->len)
+		*len = kbuf->len;
+	return kbuf;
+}
+
 static struct io_buffer *io_buffer_select(struct io_kiocb *req, size_t *len,
 					  int bgid, struct io_buffer *kbuf,
 					  bool needs_lock)
 {
 	struct io_buffer *head;
+	struct io_buf_ring *br;
 
 	if (req->flags & REQ_F_BUFFER_SELECTED)
 		return kbuf;
@@ -2929,7 +3062,11 @@ static struct io_buffer *io_buffer_select(struct io_kiocb *req, size_t *len,
 		if (*len > kbuf->len)
 			*len = kbuf->len;
 	} else {
-		kbuf = ERR_PTR(-ENOBUFS);
+		br = xa_load(&req->ctx->io_buf_rings, bgid);
+		if (br)
+			kbuf = io_ring_buffer_select(br, len);
+		else
+			kbuf = ERR_PTR(-ENOBUFS);
 	}
 
 	io_ring_submit_unlock(req->ctx, needs_lock);
@@ -4086,7 +4223,11 @@ static int io_provide_buffers(struct io_kiocb *req, unsigned int issue_flags)
 
 	list = head = xa_load(&ctx->io_buffers, p->bgid);
 
-	ret = io_add_buffers(p, &head);
+	/* ring-provided groups are replenished through the ring only */
+	if (!list && xa_load(&ctx->io_buf_rings, p->bgid))
+		ret = -EINVAL;
+	else
+		ret = io_add_buffers(p, &head);
 	if (ret >= 0 && !list) {
 		ret = xa_insert(&ctx->io_buffers, p->bgid, head, GFP_KERNEL);
 		if (ret < 0)
@@ -4491,6 +4632,7 @@ static int io_send(struct io_kiocb *req, unsigned int issue_flags)
 	msg.msg_control = NULL;
 	msg.msg_controllen = 0;
 	msg.msg_namelen = 0;
+	msg.msg_ubuf = NULL;
 
 	flags = req->sr_msg.msg_flags | MSG_NOSIGNAL;
 	if (flags & MSG_DONTWAIT)
@@ -4514,6 +4656,106 @@ static int io_send(struct io_kiocb *req, unsigned int issue_flags)
 	return 0;
 }
 
+/*
+ * Called by the network stack whenever it drops a reference on the pages
+ * of a zero-copy send, possibly from softirq context. The last one posts
+ * the notification CQE.
+ */
+static void io_sendzc_callback(struct sk_buff *skb, struct ubuf_info *uarg,
+			       bool zerocopy_success)
+{
+	struct io_async_sendzc *async =
+		container_of(uarg, struct io_async_sendzc, uarg);
+
+	if (!refcount_dec_and_test(&uarg->refcnt))
+		return;
+
+	/* frees async with the request, don't touch it afterwards */
+	io_req_complete_post(async->req, async->res_posted ? 0 : async->res,
+			     IORING_CQE_F_NOTIF);
+}
+
+static int io_sendzc_prep(struct io_kiocb *req, const struct io_uring_sqe *sqe)
+{
+	struct io_sendzc *zc = &req->sendzc;
+	struct io_async_sendzc *async;
+
+	if (unlikely(req->ctx->flags & IORING_SETUP_IOPOLL))
+		return -EINVAL;
+	if (sqe->ioprio || sqe->off)
+		return -EINVAL;
+
+	zc->addr = READ_ONCE(sqe->addr);
+	zc->len = READ_ONCE(sqe->len);
+	zc->msg_flags = READ_ONCE(sqe->msg_flags);
+	zc->buf_index = READ_ONCE(sqe->buf_index);
+
+	if (__io_alloc_async_data(req))
+		return -ENOMEM;
+	async = req->async_data;
+	async->req = req;
+	async->res = 0;
+	async->res_posted = false;
+	async->uarg.callback = io_sendzc_callback;
+	async->uarg.flags = SKBFL_ZEROCOPY_FRAG;
+	async->uarg.mmp.user = NULL;
+	async->uarg.mmp.num_pg = 0;
+	/* the request's own reference, dropped once the send has been issued */
+	refcount_set(&async->uarg.refcnt, 1);
+	return 0;
+}
+
+static int io_sendzc(struct io_kiocb *req, unsigned int issue_flags)
+{
+	struct io_sendzc *zc = &req->sendzc;
+	struct io_async_sendzc *async = req->async_data;
+	struct msghdr msg;
+	struct socket *sock;
+	unsigned flags;
+	int min_ret = 0;
+	int ret;
+
+	sock = sock_from_file(req->file);
+	if (unlikely(!sock))
+		return -ENOTSOCK;
+
+	ret = __io_import_fixed(req, WRITE, &msg.msg_iter, zc->addr, zc->len,
+				zc->buf_index);
+	if (unlikely(ret))
+		return ret;
+
+	msg.msg_name = NULL;
+	msg.msg_control = NULL;
+	msg.msg_controllen = 0;
+	msg.msg_namelen = 0;
+	msg.msg_ubuf = &async->uarg;
+
+	flags = zc->msg_flags | MSG_NOSIGNAL | MSG_ZEROCOPY;
+	if (flags & MSG_DONTWAIT)
+		req->flags |= REQ_F_NOWAIT;
+	else if (issue_flags & IO_URING_F_NONBLOCK)
+		flags |= MSG_DONTWAIT;
+
+	if (flags & MSG_WAITALL)
+		min_ret = iov_iter_count(&msg.msg_iter);
+
+	msg.msg_flags = flags;
+	ret = sock_sendmsg(sock, &msg);
+	if ((issue_flags & IO_URING_F_NONBLOCK) && ret == -EAGAIN)
+		return -EAGAIN;
+	if (ret == -ERESTARTSYS)
+		ret = -EINTR;
+
+	if (ret < min_ret)
+		req_set_fail_links(req);
+
+	/* report the result now, the notification follows on buffer release */
+	async->res = ret;
+	async->res_posted = io_cqring_fill_more(req, ret, 0);
+	io_sendzc_callback(NULL, &async->uarg, true);
+	return 0;
+}
+
 static int __io_recvmsg_copy_hdr(struct io_kiocb *req,
 				 struct io_async_msghdr *iomsg)
 {
@@ -4647,6 +4889,21 @@ static int io_recvmsg_prep(struct io_kiocb *req, const struct io_uring_sqe *sqe)
 	sr->len = READ_ONCE(sqe->len);
 	sr->bgid = READ_ONCE(sqe->buf_group);
 
+	if (req->opcode == IORING_OP_RECV) {
+		unsigned int flags = READ_ONCE(sqe->ioprio);
+
+		if (flags & ~IORING_RECV_MULTISHOT)
+			return -EINVAL;
+		if (flags & IORING_RECV_MULTISHOT) {
+			if (!(req->flags & REQ_F_BUFFER_SELECT))
+				return -EINVAL;
+			if (sr->msg_flags & (MSG_DONTWAIT | MSG_WAITALL))
+				return -EINVAL;
+			sr->mshot_len = sr->len;
+			req->flags |= REQ_F_APOLL_MULTISHOT;
+		}
+	}
+
 #ifdef CONFIG_COMPAT
 	if (req->ctx->compat)
 		sr->msg_flags |= MSG_CMSG_COMPAT;
@@ -4726,11 +4983,16 @@ static int io_recv(struct io_kiocb *req, unsigned int issue_flags)
 	int min_ret = 0;
 	int ret, cflags = 0;
 	bool force_nonblock = issue_flags & IO_URING_F_NONBLOCK;
+	/* multishot only runs non-blocking, an io-wq punt finishes it */
+	bool multishot = force_nonblock &&
+			 (req->flags & REQ_F_APOLL_MULTISHOT);
+	unsigned int nr_more = 0;
 
 	sock = sock_from_file(req->file);
 	if (unlikely(!sock))
 		return -ENOTSOCK;
 
+retry:
 	if (req->flags & REQ_F_BUFFER_SELECT) {
 		kbuf = io_recv_buffer_select(req, !force_nonblock);
 		if (IS_ERR(kbuf))
@@ -4766,6 +5028,12 @@ static int io_recv(struct io_kiocb *req, unsigned int issue_flags)
 out_free:
 	if (req->flags & REQ_F_BUFFER_SELECTED)
 		cflags = io_put_recv_kbuf(req);
+	if (multishot && ret > 0 && ++nr_more < IO_MULTISHOT_MAX_MORE &&
+	    io_cqring_fill_more(req, ret, cflags)) {
+		sr->len = sr->mshot_len;
+		cflags = 0;
+		goto retry;
+	}
 	if (ret < min_ret || ((flags & MSG_WAITALL) && (msg.msg_flags & (MSG_TRUNC | MSG_CTRUNC))))
 		req_set_fail_links(req);
 	__io_req_complete(req, issue_flags, ret, cflags);
@@ -4776,10 +5044,18 @@ static int io_accept_prep(struct io_kiocb *req, const struct io_uring_sqe *sqe)
 {
 	struct io_accept *accept = &req->accept;
 
+	unsigned int flags;
+
 	if (unlikely(req->ctx->flags & IORING_SETUP_IOPOLL))
 		return -EINVAL;
-	if (sqe->ioprio || sqe->len || sqe->buf_index)
+	if (sqe->len || sqe->buf_index)
+		return -EINVAL;
+
+	flags = READ_ONCE(sqe->ioprio);
+	if (flags & ~IORING_ACCEPT_MULTISHOT)
 		return -EINVAL;
+	if (flags & IORING_ACCEPT_MULTISHOT)
+		req->flags |= REQ_F_APOLL_MULTISHOT;
 
 	accept->addr = u64_to_user_ptr(READ_ONCE(sqe->addr));
 	accept->addr_len = u64_to_user_ptr(READ_ONCE(sqe->addr2));
@@ -4793,11 +5069,18 @@ static int io_accept(struct io_kiocb *req, unsigned int issue_flags)
 	struct io_accept *accept = &req->accept;
 	bool force_nonblock = issue_flags & IO_URING_F_NONBLOCK;
 	unsigned int file_flags = force_nonblock ? O_NONBLOCK : 0;
+	/* multishot only runs non-blocking, an io-wq punt finishes it */
+	bool multishot = force_nonblock &&
+			 (req->flags & REQ_F_APOLL_MULTISHOT);
+	unsigned int nr_more = 0;
 	int ret;
 
-	if (req->file->f_flags & O_NONBLOCK)
+	/* a multishot accept waits for connections even on O_NONBLOCK */
+	if ((req->file->f_flags & O_NONBLOCK) &&
+	    !(req->flags & REQ_F_APOLL_MULTISHOT))
 		req->flags |= REQ_F_NOWAIT;
 
+retry:
 	ret = __sys_accept4_file(req->file, file_flags, accept->addr,
 					accept->addr_len, accept->flags,
 					accept->nofile);
@@ -4807,6 +5090,9 @@ static int io_accept(struct io_kiocb *req, unsigned int issue_flags)
 		if (ret == -ERESTARTSYS)
 			ret = -EINTR;
 		req_set_fail_links(req);
+	} else if (multishot && ++nr_more < IO_MULTISHOT_MAX_MORE &&
+		   io_cqring_fill_more(req, ret, 0)) {
+		goto retry;
 	}
 	__io_req_complete(req, issue_flags, ret, 0);
 	return 0;
@@ -5140,6 +5426,10 @@ static void io_async_task_func(struct callback_head *cb)
 	io_poll_remove_double(req);
 	spin_unlock_irq(&ctx->completion_lock);
 
+	/* apoll is off all wait queues now, let a multishot request re-arm */
+	if (req->flags & REQ_F_APOLL_MULTISHOT)
+		req->flags &= ~REQ_F_POLLED;
+
 	if (!READ_ONCE(apoll->poll.canceled))
 		__io_req_task_submit(req);
 	else
@@ -5918,6 +6208,8 @@ static int io_req_prep(struct io_kiocb *req, const struct io_uring_sqe *sqe)
 		return io_renameat_prep(req, sqe);
 	case IORING_OP_UNLINKAT:
 		return io_unlinkat_prep(req, sqe);
+	case IORING_OP_SEND_ZC:
+		return io_sendzc_prep(req, sqe);
 	}
 
 	printk_once(KERN_WARNING "io_uring: unhandled opcode %d\n",
@@ -6183,6 +6475,9 @@ static int io_issue_sqe(struct io_kiocb *req, unsigned int issue_flags)
 	case IORING_OP_UNLINKAT:
 		ret = io_unlinkat(req, issue_flags);
 		break;
+	case IORING_OP_SEND_ZC:
+		ret = io_sendzc(req, issue_flags);
+		break;
 	default:
 		ret = -EINVAL;
 		break;
@@ -6494,7 +6789,7 @@ static int io_init_req(struct io_ring_ctx *ctx, struct io_kiocb *req,
 	 */
 	if (!state->plug_started && state->ios_left > 1 &&
 	    io_op_defs[req->opcode].plug) {
-		blk_start_plug(&state->plug);
+		blk_start_plug_nr_ios(&state->plug, state->ios_left);
 		state->plug_started = true;
 	}
 
@@ -6757,6 +7052,20 @@ static int __io_sq_thread(struct io_ring_ctx *ctx, bool cap_entries)
 		mutex_unlock(&ctx->uring_lock);
 	}
 
+	if (ret > 0) {
+		u64 start = READ_ONCE(ctx->sq_stats.wake_start);
+
+		ctx->sq_stats.submitted += ret;
+		if (start) {
+			u64 lat = ktime_get_ns() - start;
+
+			WRITE_ONCE(ctx->sq_stats.wake_start, 0);
+			ctx->sq_stats.wake_lat_total += lat;
+			if (lat > ctx->sq_stats.wake_lat_max)
+				ctx->sq_stats.wake_lat_max = lat;
+		}
+	}
+
 	if (!io_sqring_full(ctx) && wq_has_sleeper(&ctx->sqo_sq_wait))
 		wake_up(&ctx->sqo_sq_wait);
 
@@ -6767,13 +7076,54 @@ static void io_sqd_update_thread_idle(struct io_sq_data *sqd)
 {
 	struct io_ring_ctx *ctx;
 	unsigned sq_thread_idle = 0;
+	bool adaptive = true;
 
 	list_for_each_entry(ctx, &sqd->ctx_list, sqd_list) {
 		if (sq_thread_idle < ctx->sq_thread_idle)
 			sq_thread_idle = ctx->sq_thread_idle;
+		if (!(ctx->flags & IORING_SETUP_SQ_ADAPTIVE_IDLE))
+			adaptive = false;
 	}
 
 	sqd->sq_thread_idle = sq_thread_idle;
+	sqd->adaptive_idle = adaptive;
+	sqd->idle_gap = 0;
+}
+
+/*
+ * Called when a pass found work after at least one pass that didn't, to
+ * track how far apart bursts of submissions are.
+ */
+static void io_sqd_note_busy(struct io_sq_data *sqd)
+{
+	unsigned long gap = jiffies - sqd->last_busy;
+
+	sqd->last_busy = jiffies;
+	if (!sqd->adaptive_idle)
+		return;
+	gap = min_t(unsigned long, gap, 2 * sqd->sq_thread_idle);
+	if (!sqd->idle_gap)
+		sqd->idle_gap = gap;
+	else
+		sqd->idle_gap = (3 * sqd->idle_gap + gap) / 4;
+}
+
+/*
+ * How long to keep spinning after the last submission. With adaptive idle,
+ * spin for about two gaps if bursts come in quicker than sq_thread_idle, and
+ * go to sleep right away if they come in slower, spinning would be wasted.
+ */
+static unsigned long io_sqd_idle_timeout(struct io_sq_data *sqd)
+{
+	unsigned idle = sqd->sq_thread_idle;
+
+	if (sqd->adaptive_idle && sqd->idle_gap) {
+		if (sqd->idle_gap > idle)
+			idle = 1;
+		else if (2 * sqd->idle_gap < idle)
+			idle = max(2 * sqd->idle_gap, 1U);
+	}
+	return jiffies + idle;
 }
 
 static int io_sq_thread(void *data)
@@ -6781,6 +7131,7 @@ static int io_sq_thread(void *data)
 	struct io_sq_data *sqd = data;
 	struct io_ring_ctx *ctx;
 	unsigned long timeout = 0;
+	bool was_busy = false;
 	char buf[TASK_COMM_LEN];
 	DEFINE_WAIT(wait);
 
@@ -6818,7 +7169,7 @@ static int io_sq_thread(void *data)
 			io_run_task_work_head(&sqd->park_task_work);
 			if (did_sig)
 				break;
-			timeout = jiffies + sqd->sq_thread_idle;
+			timeout = io_sqd_idle_timeout(sqd);
 			continue;
 		}
 		sqt_spin = false;
@@ -6834,12 +7185,19 @@ static int io_sq_thread(void *data)
 			if (!sqt_spin && (ret > 0 || !list_empty(&ctx->iopoll_list)))
 				sqt_spin = true;
 		}
+		/* start the next pass with another ring, for fairness */
+		if (cap_entries)
+			list_rotate_left(&sqd->ctx_list);
+
+		if (sqt_spin && !was_busy)
+			io_sqd_note_busy(sqd);
+		was_busy = sqt_spin;
 
 		if (sqt_spin || !time_after(jiffies, timeout)) {
 			io_run_task_work();
 			cond_resched();
 			if (sqt_spin)
-				timeout = jiffies + sqd->sq_thread_idle;
+				timeout = io_sqd_idle_timeout(sqd);
 			continue;
 		}
 
@@ -6870,7 +7228,7 @@ static int io_sq_thread(void *data)
 
 		finish_wait(&sqd->wait, &wait);
 		io_run_task_work_head(&sqd->park_task_work);
-		timeout = jiffies + sqd->sq_thread_idle;
+		timeout = io_sqd_idle_timeout(sqd);
 	}
 
 	io_uring_cancel_sqpoll(sqd);
@@ -8016,8 +8374,8 @@ static int io_sq_offload_create(struct io_ring_ctx *ctx,
 		wake_up_new_task(tsk);
 		if (ret)
 			goto err;
-	} else if (p->flags & IORING_SETUP_SQ_AFF) {
-		/* Can't have SQ_AFF without SQPOLL */
+	} else if (p->flags & (IORING_SETUP_SQ_AFF | IORING_SETUP_SQ_ADAPTIVE_IDLE)) {
+		/* Can't have SQ_AFF or adaptive idle without SQPOLL */
 		ret = -EINVAL;
 		goto err;
 	}
@@ -8438,13 +8796,26 @@ static int io_eventfd_unregister(struct io_ring_ctx *ctx)
 	return -ENXIO;
 }
 
+static void io_free_buf_ring(struct io_buf_ring *br)
+{
+	unpin_user_pages(br->pages, br->nr_pages);
+	kvfree(br->pages);
+	kfree(br);
+}
+
 static void io_destroy_buffers(struct io_ring_ctx *ctx)
 {
 	struct io_buffer *buf;
+	struct io_buf_ring *br;
 	unsigned long index;
 
 	xa_for_each(&ctx->io_buffers, index, buf)
 		__io_remove_buffers(ctx, buf, index, -1U);
+
+	xa_for_each(&ctx->io_buf_rings, index, br) {
+		xa_erase(&ctx->io_buf_rings, index);
+		io_free_buf_ring(br);
+	}
 }
 
 static void io_req_cache_free(struct list_head *list, struct task_struct *tsk)
@@ -9271,8 +9642,13 @@ SYSCALL_DEFINE6(io_uring_enter, unsigned int, fd, u32, to_submit,
 		if (unlikely(ctx->sq_data->thread == NULL)) {
 			goto out;
 		}
-		if (flags & IORING_ENTER_SQ_WAKEUP)
+		if (flags & IORING_ENTER_SQ_WAKEUP) {
+			ctx->sq_stats.wakeups++;
+			if (!READ_ONCE(ctx->sq_stats.wake_start))
+				WRITE_ONCE(ctx->sq_stats.wake_start,
+					   ktime_get_ns());
 			wake_up(&ctx->sq_data->wait);
+		}
 		if (flags & IORING_ENTER_SQ_WAIT) {
 			ret = io_sqpoll_wait_sq(ctx);
 			if (ret)
@@ -9376,6 +9752,20 @@ static void __io_uring_show_fdinfo(struct io_ring_ctx *ctx, struct seq_file *m)
 
 	seq_printf(m, "SqThread:\t%d\n", sq ? task_pid_nr(sq->thread) : -1);
 	seq_printf(m, "SqThreadCpu:\t%d\n", sq ? task_cpu(sq->thread) : -1);
+	if (ctx->flags & IORING_SETUP_SQPOLL) {
+		u64 wakeups = ctx->sq_stats.wakeups;
+
+		seq_printf(m, "SqThreadIdle:\t%u\n",
+			   sq ? jiffies_to_msecs(sq->sq_thread_idle) : 0);
+		seq_printf(m, "SqAdaptiveIdle:\t%u\n",
+			   sq ? jiffies_to_msecs(sq->idle_gap) : 0);
+		seq_printf(m, "SqSubmitted:\t%llu\n", ctx->sq_stats.submitted);
+		seq_printf(m, "SqWakeups:\t%llu\n", wakeups);
+		seq_printf(m, "SqWakeLatAvgNs:\t%llu\n", wakeups ?
+			   div64_u64(ctx->sq_stats.wake_lat_total, wakeups) : 0);
+		seq_printf(m, "SqWakeLatMaxNs:\t%llu\n",
+			   ctx->sq_stats.wake_lat_max);
+	}
 	seq_printf(m, "UserFiles:\t%u\n", ctx->nr_user_files);
 	for (i = 0; has_lock && i < ctx->nr_user_files; i++) {
 		struct file *f = *io_fixed_file_slot(ctx->file_data, i);
@@ -9673,7 +10063,7 @@ static long io_uring_setup(u32 entries, struct io_uring_params __user *params)
 	if (p.flags & ~(IORING_SETUP_IOPOLL | IORING_SETUP_SQPOLL |
 			IORING_SETUP_SQ_AFF | IORING_SETUP_CQSIZE |
 			IORING_SETUP_CLAMP | IORING_SETUP_ATTACH_WQ |
-			IORING_SETUP_R_DISABLED))
+			IORING_SETUP_R_DISABLED | IORING_SETUP_SQ_ADAPTIVE_IDLE))
 		return -EINVAL;
 
 	return  io_uring_create(entries, &p, params);
@@ -9824,6 +10214,131 @@ static int io_register_enable_rings(struct io_ring_ctx *ctx)
 	return 0;
 }
 
+static int io_register_pbuf_ring(struct io_ring_ctx *ctx, void __user *arg)
+{
+	struct io_uring_buf_reg reg;
+	struct io_buf_ring *br;
+	int nr_pages, ret;
+
+	if (copy_from_user(&reg, arg, sizeof(reg)))
+		return -EFAULT;
+	if (reg.pad || reg.resv[0] || reg.resv[1] || reg.resv[2])
+		return -EINVAL;
+	if (!reg.ring_addr || (reg.ring_addr & ~PAGE_MASK))
+		return -EINVAL;
+	if (!is_power_of_2(reg.ring_entries) || reg.ring_entries > 32768)
+		return -EINVAL;
+	if (xa_load(&ctx->io_buffers, reg.bgid) ||
+	    xa_load(&ctx->io_buf_rings, reg.bgid))
+		return -EEXIST;
+
+	br = kzalloc(sizeof(*br), GFP_KERNEL);
+	if (!br)
+		return -ENOMEM;
+
+	ret = -ENOMEM;
+	nr_pages = DIV_ROUND_UP(reg.ring_entries * sizeof(struct io_uring_buf),
+				PAGE_SIZE);
+	br->pages = kvmalloc_array(nr_pages, sizeof(struct page *), GFP_KERNEL);
+	if (!br->pages)
+		goto err;
+
+	ret = pin_user_pages_fast(reg.ring_addr, nr_pages,
+				  FOLL_WRITE | FOLL_LONGTERM, br->pages);
+	if (ret != nr_pages) {
+		if (ret > 0)
+			unpin_user_pages(br->pages, ret);
+		ret = ret < 0 ? ret : -EFAULT;
+		goto err;
+	}
+	br->nr_pages = nr_pages;
+	br->mask = reg.ring_entries - 1;
+
+	ret = xa_insert(&ctx->io_buf_rings, reg.bgid, br, GFP_KERNEL);
+	if (ret) {
+		io_free_buf_ring(br);
+		return ret;
+	}
+	return 0;
+err:
+	kvfree(br->pages);
+	kfree(br);
+	return ret;
+}
+
+static int io_unregister_pbuf_ring(struct io_ring_ctx *ctx, void __user *arg)
+{
+	struct io_uring_buf_reg reg;
+	struct io_buf_ring *br;
+
+	if (copy_from_user(&reg, arg, sizeof(reg)))
+		return -EFAULT;
+	if (reg.pad || reg.resv[0] || reg.resv[1] || reg.resv[2])
+		return -EINVAL;
+
+	br = xa_erase(&ctx->io_buf_rings, reg.bgid);
+	if (!br)
+		return -ENOENT;
+	io_free_buf_ring(br);
+	return 0;
+}
+
+/*
+ * Cap the io-wq workers serving this ring, per NUMA node. @arg holds the
+ * bounded and unbounded limits, 0 keeping the current one, and gets the
+ * previous limits back. For SQPOLL rings the limits apply to the io-wq of
+ * the SQPOLL thread, and so to all rings sharing it.
+ */
+static int io_register_iowq_max_workers(struct io_ring_ctx *ctx,
+					void __user *arg)
+{
+	struct io_uring_task *tctx = NULL;
+	struct io_sq_data *sqd = NULL;
+	__u32 new_count[2];
+	int count[2];
+	int i, ret;
+
+	if (copy_from_user(new_count, arg, sizeof(new_count)))
+		return -EFAULT;
+	for (i = 0; i < ARRAY_SIZE(new_count); i++) {
+		if (new_count[i] > INT_MAX)
+			return -EINVAL;
+		count[i] = new_count[i];
+	}
+
+	if (ctx->flags & IORING_SETUP_SQPOLL) {
+		sqd = ctx->sq_data;
+		if (sqd) {
+			/* sqd->lock nests outside of uring_lock */
+			refcount_inc(&sqd->refs);
+			mutex_unlock(&ctx->uring_lock);
+			io_sq_thread_park(sqd);
+			mutex_lock(&ctx->uring_lock);
+			if (sqd->thread)
+				tctx = sqd->thread->io_uring;
+		}
+	} else {
+		tctx = current->io_uring;
+	}
+
+	ret = -EINVAL;
+	if (tctx && tctx->io_wq)
+		ret = io_wq_max_workers(tctx->io_wq, count);
+
+	if (sqd) {
+		io_sq_thread_unpark(sqd);
+		io_put_sq_data(sqd);
+	}
+	if (ret)
+		return ret;
+
+	for (i = 0; i < ARRAY_SIZE(new_count); i++)
+		new_count[i] = count[i];
+	if (copy_to_user(arg, new_count, sizeof(new_count)))
+		return -EFAULT;
+	return 0;
+}
+
 static bool io_register_op_must_quiesce(int op)
 {
 	switch (op) {
@@ -9832,6 +10347,9 @@ static bool io_register_op_must_quiesce(int op)
 	case IORING_REGISTER_PROBE:
 	case IORING_REGISTER_PERSONALITY:
 	case IORING_UNREGISTER_PERSONALITY:
+	case IORING_REGISTER_PBUF_RING:
+	case IORING_UNREGISTER_PBUF_RING:
+	case IORING_REGISTER_IOWQ_MAX_WORKERS:
 		return false;
 	default:
 		return true;
@@ -9962,6 +10480,24 @@ static int __io_uring_register(struct io_ring_ctx *ctx, unsigned opcode,
 	case IORING_REGISTER_RESTRICTIONS:
 		ret = io_register_restrictions(ctx, arg, nr_args);
 		break;
+	case IORING_REGISTER_PBUF_RING:
+		ret = -EINVAL;
+		if (!arg || nr_args != 1)
+			break;
+		ret = io_register_pbuf_ring(ctx, arg);
+		break;
+	case IORING_UNREGISTER_PBUF_RING:
+		ret = -EINVAL;
+		if (!arg || nr_args != 1)
+			break;
+		ret = io_unregister_pbuf_ring(ctx, arg);
+		break;
+	case IORING_REGISTER_IOWQ_MAX_WORKERS:
+		ret = -EINVAL;
+		if (!arg || nr_args != 2)
+			break;
+		ret = io_register_iowq_max_workers(ctx, arg);
+		break;
 	default:
 		ret = -EINVAL;
 		break;
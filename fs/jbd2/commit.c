@@ -24,6 +24,8 @@
 #include <linux/bio.h>
 #include <linux/blkdev.h>
 #include <linux/bitops.h>
+#include <linux/log2.h>
+#include <linux/math64.h>
 #include <trace/events/jbd2.h>
 
 /*
@@ -372,6 +374,17 @@ static void jbd2_block_tag_csum_set(journal_t *j, journal_block_tag_t *tag,
 	else
 		tag->t_checksum = cpu_to_be16(csum32);
 }
+
+static unsigned int jbd2_commit_hist_slot(u64 commit_time)
+{
+	u64 us = div_u64(commit_time, NSEC_PER_USEC);
+
+	if (us < 128)
+		return 0;
+
+	return min_t(unsigned int, ilog2(us) - 6, JBD2_COMMIT_HIST_SLOTS - 1);
+}
+
 /*
  * jbd2_journal_commit_transaction
  *
@@ -1207,5 +1220,6 @@ void jbd2_journal_commit_transaction(journal_t *journal)
 	journal->j_stats.run.rs_handle_count += stats.run.rs_handle_count;
 	journal->j_stats.run.rs_blocks += stats.run.rs_blocks;
 	journal->j_stats.run.rs_blocks_logged += stats.run.rs_blocks_logged;
+	journal->j_stats.ts_commit_hist[jbd2_commit_hist_slot(commit_time)]++;
 	spin_unlock(&journal->j_history_lock);
 }
@@ -41,6 +41,7 @@
 #include <linux/bitops.h>
 #include <linux/ratelimit.h>
 #include <linux/sched/mm.h>
+#include <linux/hrtimer.h>
 
 #define CREATE_TRACE_POINTS
 #include <trace/events/jbd2.h>
@@ -144,6 +145,34 @@ static __be32 jbd2_superblock_csum(journal_t *j, journal_superblock_t *sb)
  * Helper function used to manage commit timeouts
  */
 
+/*
+ * Hold a commit requested for the running transaction back until that
+ * transaction is j_commit_window old, so that the fsyncs coming in meanwhile
+ * are served by this commit instead of each waiting for the next one. A
+ * flush costs milliseconds on eMMC, this trades latency for their count.
+ * Called and returns with j_state_lock held for writing.
+ */
+static void jbd2_commit_window_wait(journal_t *journal)
+{
+	transaction_t *transaction = journal->j_running_transaction;
+	ktime_t left;
+
+	if (!journal->j_commit_window || !transaction ||
+	    transaction->t_tid != journal->j_commit_request)
+		return;
+
+	left = ktime_sub(ktime_add_us(transaction->t_start_time,
+				      journal->j_commit_window),
+			 ktime_get());
+	if (ktime_to_ns(left) <= 0)
+		return;
+
+	write_unlock(&journal->j_state_lock);
+	set_current_state(TASK_UNINTERRUPTIBLE);
+	schedule_hrtimeout(&left, HRTIMER_MODE_REL);
+	write_lock(&journal->j_state_lock);
+}
+
 static void commit_timeout(struct timer_list *t)
 {
 	journal_t *journal = from_timer(journal, t, j_commit_timer);
@@ -208,6 +237,7 @@ static int kjournald2(void *arg)
 
 	if (journal->j_commit_sequence != journal->j_commit_request) {
 		jbd_debug(1, "OK, requests differ\n");
+		jbd2_commit_window_wait(journal);
 		write_unlock(&journal->j_state_lock);
 		del_timer_sync(&journal->j_commit_timer);
 		jbd2_journal_commit_transaction(journal);
@@ -1171,6 +1201,7 @@ static void *jbd2_seq_info_next(struct seq_file *seq, void *v, loff_t *pos)
 static int jbd2_seq_info_show(struct seq_file *seq, void *v)
 {
 	struct jbd2_stats_proc_session *s = seq->private;
+	int i;
 
 	if (v != SEQ_START_TOKEN)
 		return 0;
@@ -1202,6 +1233,18 @@ static int jbd2_seq_info_show(struct seq_file *seq, void *v)
 	    s->stats->run.rs_blocks / s->stats->ts_tid);
 	seq_printf(seq, "  %lu logged blocks per transaction\n",
 	    s->stats->run.rs_blocks_logged / s->stats->ts_tid);
+	seq_puts(seq, "commit time histogram:\n");
+	for (i = 0; i < JBD2_COMMIT_HIST_SLOTS; i++) {
+		if (!s->stats->ts_commit_hist[i])
+			continue;
+		if (!i)
+			seq_puts(seq, "  <128us");
+		else if (i == JBD2_COMMIT_HIST_SLOTS - 1)
+			seq_printf(seq, "  >=%luus", 64UL << i);
+		else
+			seq_printf(seq, "  %lu-%luus", 64UL << i, 128UL << i);
+		seq_printf(seq, ": %lu\n", s->stats->ts_commit_hist[i]);
+	}
 	return 0;
 }
 
@@ -1264,6 +1307,45 @@ static const struct proc_ops jbd2_info_proc_ops = {
 	.proc_release	= jbd2_seq_info_release,
 };
 
+static ssize_t jbd2_commit_window_read(struct file *file, char __user *buf,
+				       size_t count, loff_t *ppos)
+{
+	journal_t *journal = PDE_DATA(file_inode(file));
+	char str[16];
+	int len;
+
+	len = scnprintf(str, sizeof(str), "%u\n",
+			READ_ONCE(journal->j_commit_window));
+	return simple_read_from_buffer(buf, count, ppos, str, len);
+}
+
+static ssize_t jbd2_commit_window_write(struct file *file,
+					const char __user *buf,
+					size_t count, loff_t *ppos)
+{
+	journal_t *journal = PDE_DATA(file_inode(file));
+	unsigned int window;
+	int rc;
+
+	rc = kstrtouint_from_user(buf, count, 0, &window);
+	if (rc)
+		return rc;
+	if (window > USEC_PER_SEC)
+		return -EINVAL;
+
+	write_lock(&journal->j_state_lock);
+	journal->j_commit_window = window;
+	write_unlock(&journal->j_state_lock);
+
+	return count;
+}
+
+static const struct proc_ops jbd2_commit_window_proc_ops = {
+	.proc_read	= jbd2_commit_window_read,
+	.proc_write	= jbd2_commit_window_write,
+	.proc_lseek	= default_llseek,
+};
+
 static struct proc_dir_entry *proc_jbd2_stats;
 
 static void jbd2_stats_proc_init(journal_t *journal)
@@ -1272,11 +1354,15 @@ static void jbd2_stats_proc_init(journal_t *journal)
 	if (journal->j_proc_entry) {
 		proc_create_data("info", S_IRUGO, journal->j_proc_entry,
 				 &jbd2_info_proc_ops, journal);
+		proc_create_data("commit_window_us", S_IRUGO | S_IWUSR,
+				 journal->j_proc_entry,
+				 &jbd2_commit_window_proc_ops, journal);
 	}
 }
 
 static void jbd2_stats_proc_exit(journal_t *journal)
 {
+	remove_proc_entry("commit_window_us", journal->j_proc_entry);
 	remove_proc_entry("info", journal->j_proc_entry);
 	remove_proc_entry(journal->j_devname, proc_jbd2_stats);
 }
@@ -305,6 +305,17 @@ static void jffs2_build_remove_unlinked_inode(struct jffs2_sb_info *c,
 	*/
 }
 
+/* When do we let the GC thread run in the background */
+void jffs2_calc_gc_trigger(struct jffs2_sb_info *c)
+{
+	/* Never let the background headroom eat more than a quarter of
+	   the medium, or the GC thread would just be churning. */
+	uint32_t headroom = min_t(uint32_t, c->mount_opts.gc_headroom,
+				  c->nr_blocks / 4);
+
+	c->resv_blocks_gctrigger = c->resv_blocks_write + 1 + headroom;
+}
+
 static void jffs2_calc_trigger_levels(struct jffs2_sb_info *c)
 {
 	uint32_t size;
@@ -325,9 +336,7 @@ static void jffs2_calc_trigger_levels(struct jffs2_sb_info *c)
 
 	c->resv_blocks_write = c->resv_blocks_deletion + (size / c->sector_size);
 
-	/* When do we let the GC thread run in the background */
-
-	c->resv_blocks_gctrigger = c->resv_blocks_write + 1;
+	jffs2_calc_gc_trigger(c);
 
 	/* When do we allow garbage collection to merge nodes to make
 	   long-term progress at the expense of short-term space exhaustion? */
@@ -341,7 +350,7 @@ static void jffs2_calc_trigger_levels(struct jffs2_sb_info *c)
 	   trigger the GC thread even if we don't _need_ the space. When we
 	   can't mark nodes obsolete on the medium, the old dirty nodes cause
 	   performance problems because we have to inspect and discard them. */
-	c->vdirty_blocks_gctrigger = c->resv_blocks_gctrigger;
+	c->vdirty_blocks_gctrigger = c->resv_blocks_write + 1;
 	if (jffs2_can_mark_obsolete(c))
 		c->vdirty_blocks_gctrigger *= 10;
 
@@ -40,6 +40,13 @@ struct jffs2_mount_opts {
 	 * available space is less then 'rp_size'. */
 	bool set_rp_size;
 	unsigned int rp_size;
+
+	/* Extra free eraseblocks the GC thread keeps ready in the background
+	 * on top of the write reserve, so that bursts of writes find free
+	 * space instead of garbage collecting synchronously in
+	 * jffs2_reserve_space(). */
+	bool set_gc_headroom;
+	unsigned int gc_headroom;
 };
 
 /* A struct for the overall file system control.  Pointers to
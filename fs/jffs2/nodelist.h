@@ -466,6 +466,7 @@ int jffs2_scan_dirty_space(struct jffs2_sb_info *c, struct jffs2_eraseblock *jeb
 
 /* build.c */
 int jffs2_do_mount_fs(struct jffs2_sb_info *c);
+void jffs2_calc_gc_trigger(struct jffs2_sb_info *c);
 
 /* erase.c */
 int jffs2_erase_pending_blocks(struct jffs2_sb_info *c, int count);
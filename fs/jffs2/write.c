@@ -359,18 +359,31 @@ int jffs2_write_inode_range(struct jffs2_sb_info *c, struct jffs2_inode_info *f,
 		jffs2_dbg(2, "jffs2_commit_write() loop: 0x%x to write to 0x%x\n",
 			  writelen, offset);
 
+		/* Compress before reserving space, so that the compressor
+		   doesn't run under c->alloc_sem and stall every other writer
+		   and the garbage collector. Only when the reservation turns
+		   out too small for the result, near the end of an eraseblock,
+		   do we have to compress again to fit. */
+		datalen = min_t(uint32_t, writelen,
+				PAGE_SIZE - (offset & (PAGE_SIZE-1)));
+		cdatalen = datalen;
+		comprtype = jffs2_compress(c, f, buf, &comprbuf, &datalen, &cdatalen);
+
 		ret = jffs2_reserve_space(c, sizeof(*ri) + JFFS2_MIN_DATA_LEN,
 					&alloclen, ALLOC_NORMAL, JFFS2_SUMMARY_INODE_SIZE);
 		if (ret) {
 			jffs2_dbg(1, "jffs2_reserve_space returned %d\n", ret);
+			jffs2_free_comprbuf(comprbuf, buf);
 			break;
 		}
 		mutex_lock(&f->sem);
-		datalen = min_t(uint32_t, writelen,
-				PAGE_SIZE - (offset & (PAGE_SIZE-1)));
-		cdatalen = min_t(uint32_t, alloclen - sizeof(*ri), datalen);
-
-		comprtype = jffs2_compress(c, f, buf, &comprbuf, &datalen, &cdatalen);
+		if (cdatalen > alloclen - sizeof(*ri)) {
+			jffs2_free_comprbuf(comprbuf, buf);
+			datalen = min_t(uint32_t, writelen,
+					PAGE_SIZE - (offset & (PAGE_SIZE-1)));
+			cdatalen = min_t(uint32_t, alloclen - sizeof(*ri), datalen);
+			comprtype = jffs2_compress(c, f, buf, &comprbuf, &datalen, &cdatalen);
+		}
 
 		ri->magic = cpu_to_je16(JFFS2_MAGIC_BITMASK);
 		ri->nodetype = cpu_to_je16(JFFS2_NODETYPE_INODE);
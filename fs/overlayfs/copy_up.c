@@ -18,8 +18,12 @@
 #include <linux/fdtable.h>
 #include <linux/ratelimit.h>
 #include <linux/exportfs.h>
+#include <linux/ktime.h>
 #include "overlayfs.h"
 
+#define CREATE_TRACE_POINTS
+#include <trace/events/overlayfs.h>
+
 #define OVL_COPY_UP_CHUNK_SIZE (1 << 20)
 
 static int ovl_ccup_set(const char *buf, const struct kernel_param *param)
@@ -140,12 +144,17 @@ static int ovl_copy_up_data(struct ovl_fs *ofs, struct path *old,
 	loff_t cloned;
 	loff_t data_pos = -1;
 	loff_t hole_len;
+	loff_t total = len;
 	bool skip_hole = false;
+	bool clone_done = false;
+	ktime_t start;
 	int error = 0;
 
 	if (len == 0)
 		return 0;
 
+	start = ktime_get();
+
 	old_file = ovl_path_open(old, O_LARGEFILE | O_RDONLY);
 	if (IS_ERR(old_file))
 		return PTR_ERR(old_file);
@@ -158,8 +167,10 @@ static int ovl_copy_up_data(struct ovl_fs *ofs, struct path *old,
 
 	/* Try to use clone_file_range to clone up within the same fs */
 	cloned = do_clone_file_range(old_file, 0, new_file, 0, len, 0);
-	if (cloned == len)
+	if (cloned == len) {
+		clone_done = true;
 		goto out;
+	}
 	/* Couldn't clone, so now we try to copy the data */
 
 	/* Check if lower fs supports seek operation */
@@ -226,6 +237,8 @@ static int ovl_copy_up_data(struct ovl_fs *ofs, struct path *old,
 	fput(new_file);
 out_fput:
 	fput(old_file);
+	trace_ovl_copy_up_data(d_inode(old->dentry)->i_ino, total, clone_done,
+			       error, ktime_to_ns(ktime_sub(ktime_get(), start)));
 	return error;
 }
 
@@ -876,10 +889,13 @@ static int ovl_copy_up_one(struct dentry *parent, struct dentry *dentry,
 		.dentry = dentry,
 		.workdir = ovl_workdir(dentry),
 	};
+	ktime_t start;
 
 	if (WARN_ON(!ctx.workdir))
 		return -EROFS;
 
+	start = ktime_get();
+
 	ovl_path_lower(dentry, &ctx.lowerpath);
 	err = vfs_getattr(&ctx.lowerpath, &ctx.stat,
 			  STATX_BASIC_STATS, AT_STATX_SYNC_AS_STAT);
@@ -926,6 +942,9 @@ static int ovl_copy_up_one(struct dentry *parent, struct dentry *dentry,
 	}
 	do_delayed_call(&done);
 
+	trace_ovl_copy_up(d_inode(dentry)->i_ino, ctx.stat.mode, ctx.stat.size,
+			  ctx.metacopy, flags, err,
+			  ktime_to_ns(ktime_sub(ktime_get(), start)));
 	return err;
 }
 
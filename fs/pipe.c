@@ -43,6 +43,12 @@ unsigned int pipe_max_size = 1048576;
 unsigned long pipe_user_pages_hard;
 unsigned long pipe_user_pages_soft = PIPE_DEF_BUFFERS * INR_OPEN_CUR;
 
+/*
+ * Order of the buffers given to writes large enough to fill them, set by
+ * root in /proc/sys/fs/pipe-buf-order. 0 keeps to one page per buffer.
+ */
+unsigned int pipe_buf_order;
+
 /*
  * We use head and tail indices that aren't masked off, except at the point of
  * dereference, but rather they're allowed to wrap naturally.  This means there
@@ -127,7 +133,7 @@ static bool anon_pipe_buf_try_steal(struct pipe_inode_info *pipe,
 {
 	struct page *page = buf->page;
 
-	if (page_count(page) != 1)
+	if (page_count(page) != 1 || PageCompound(page))
 		return false;
 	memcg_kmem_uncharge_page(page, 0);
 	__SetPageLocked(page);
@@ -201,6 +207,20 @@ static const struct pipe_buf_operations anon_pipe_buf_ops = {
 	.get		= generic_pipe_buf_get,
 };
 
+/*
+ * Whether the pipe holds enough for its readers to be woken: any data, or
+ * with F_SETPIPE_LOWAT that many slots of it, or a full pipe.
+ */
+static inline bool pipe_lowat_reached(const struct pipe_inode_info *pipe,
+				      unsigned int head, unsigned int tail)
+{
+	unsigned int lowat = READ_ONCE(pipe->rd_lowat);
+	unsigned int max_usage = READ_ONCE(pipe->max_usage);
+
+	return !pipe_empty(head, tail) &&
+		pipe_occupancy(head, tail) >= min(lowat, max_usage);
+}
+
 /* Done while waiting without holding the pipe lock - thus the READ_ONCE() */
 static inline bool pipe_readable(const struct pipe_inode_info *pipe)
 {
@@ -208,7 +228,7 @@ static inline bool pipe_readable(const struct pipe_inode_info *pipe)
 	unsigned int tail = READ_ONCE(pipe->tail);
 	unsigned int writers = READ_ONCE(pipe->writers);
 
-	return !pipe_empty(head, tail) || !writers;
+	return pipe_lowat_reached(pipe, head, tail) || !writers;
 }
 
 static ssize_t
@@ -366,7 +386,7 @@ pipe_read(struct kiocb *iocb, struct iov_iter *to)
 		was_full = pipe_full(pipe->head, pipe->tail, pipe->max_usage);
 		wake_next_reader = true;
 	}
-	if (pipe_empty(pipe->head, pipe->tail))
+	if (!pipe_lowat_reached(pipe, pipe->head, pipe->tail))
 		wake_next_reader = false;
 	__pipe_unlock(pipe);
 
@@ -386,6 +406,27 @@ static inline int is_packetized(struct file *file)
 	return (file->f_flags & O_DIRECT) != 0;
 }
 
+/*
+ * With fs.pipe-buf-order set, a write that fills a higher-order buffer gets
+ * one, so that streaming through the pipe takes fewer allocations, slots and
+ * wakeups. It comes from lowmem so that the kmap() users of pipe buffers
+ * still see it as contiguous.
+ */
+static struct page *anon_pipe_alloc_page(size_t len)
+{
+	unsigned int order = READ_ONCE(pipe_buf_order);
+	struct page *page;
+
+	if (order && len >= PAGE_SIZE << order) {
+		page = alloc_pages(GFP_USER | __GFP_ACCOUNT | __GFP_COMP |
+				   __GFP_NOWARN | __GFP_NORETRY, order);
+		if (page)
+			return page;
+	}
+
+	return alloc_page(GFP_HIGHUSER | __GFP_ACCOUNT);
+}
+
 /* Done while waiting without holding the pipe lock - thus the READ_ONCE() */
 static inline bool pipe_writable(const struct pipe_inode_info *pipe)
 {
@@ -429,8 +470,9 @@ pipe_write(struct kiocb *iocb, struct iov_iter *from)
 #endif
 
 	/*
-	 * Only wake up if the pipe started out empty, since
-	 * otherwise there should be no readers waiting.
+	 * Only wake up if the pipe started out empty (or short of
+	 * its low-water mark), since otherwise there should be no
+	 * readers waiting.
 	 *
 	 * If it wasn't empty we try to merge new data into
 	 * the last buffer.
@@ -440,15 +482,15 @@ pipe_write(struct kiocb *iocb, struct iov_iter *from)
 	 * spanning multiple pages.
 	 */
 	head = pipe->head;
-	was_empty = pipe_empty(head, pipe->tail);
+	was_empty = !pipe_lowat_reached(pipe, head, pipe->tail);
 	chars = total_len & (PAGE_SIZE-1);
-	if (chars && !was_empty) {
+	if (chars && !pipe_empty(head, pipe->tail)) {
 		unsigned int mask = pipe->ring_size - 1;
 		struct pipe_buffer *buf = &pipe->bufs[(head - 1) & mask];
 		int offset = buf->offset + buf->len;
 
 		if ((buf->flags & PIPE_BUF_FLAG_CAN_MERGE) &&
-		    offset + chars <= PAGE_SIZE) {
+		    offset + chars <= page_size(buf->page)) {
 			ret = pipe_buf_confirm(pipe, buf);
 			if (ret)
 				goto out;
@@ -478,10 +520,11 @@ pipe_write(struct kiocb *iocb, struct iov_iter *from)
 			unsigned int mask = pipe->ring_size - 1;
 			struct pipe_buffer *buf = &pipe->bufs[head & mask];
 			struct page *page = pipe->tmp_page;
+			size_t size;
 			int copied;
 
 			if (!page) {
-				page = alloc_page(GFP_HIGHUSER | __GFP_ACCOUNT);
+				page = anon_pipe_alloc_page(iov_iter_count(from));
 				if (unlikely(!page)) {
 					ret = ret ? : -ENOMEM;
 					break;
@@ -517,8 +560,9 @@ pipe_write(struct kiocb *iocb, struct iov_iter *from)
 				buf->flags = PIPE_BUF_FLAG_CAN_MERGE;
 			pipe->tmp_page = NULL;
 
-			copied = copy_page_from_iter(page, 0, PAGE_SIZE, from);
-			if (unlikely(copied < PAGE_SIZE && iov_iter_count(from))) {
+			size = page_size(page);
+			copied = copy_page_from_iter(page, 0, size, from);
+			if (unlikely(copied < size && iov_iter_count(from))) {
 				if (!ret)
 					ret = -EFAULT;
 				break;
@@ -559,12 +603,15 @@ pipe_write(struct kiocb *iocb, struct iov_iter *from)
 		}
 		wait_event_interruptible_exclusive(pipe->wr_wait, pipe_writable(pipe));
 		__pipe_lock(pipe);
-		was_empty = pipe_empty(pipe->head, pipe->tail);
+		was_empty = !pipe_lowat_reached(pipe, pipe->head, pipe->tail);
 		wake_next_writer = true;
 	}
 out:
 	if (pipe_full(pipe->head, pipe->tail, pipe->max_usage))
 		wake_next_writer = false;
+	/* Short of the low-water mark, readers keep waiting for more */
+	if (!pipe_lowat_reached(pipe, pipe->head, pipe->tail))
+		was_empty = false;
 	__pipe_unlock(pipe);
 
 	/*
@@ -660,7 +707,8 @@ pipe_poll(struct file *filp, poll_table *wait)
 
 	mask = 0;
 	if (filp->f_mode & FMODE_READ) {
-		if (!pipe_empty(head, tail))
+		if (pipe_lowat_reached(pipe, head, tail) ||
+		    (!pipe_empty(head, tail) && !pipe->writers))
 			mask |= EPOLLIN | EPOLLRDNORM;
 		if (!pipe->writers && filp->f_version != pipe->w_counter)
 			mask |= EPOLLHUP;
@@ -830,7 +878,7 @@ void free_pipe_info(struct pipe_inode_info *pipe)
 			pipe_buf_release(pipe, buf);
 	}
 	if (pipe->tmp_page)
-		__free_page(pipe->tmp_page);
+		put_page(pipe->tmp_page);
 	kfree(pipe->bufs);
 	kfree(pipe);
 }
@@ -1342,6 +1390,28 @@ static long pipe_set_size(struct pipe_inode_info *pipe, unsigned long arg)
 	return ret;
 }
 
+/*
+ * Set the amount of data, rounded up to whole slots, that a pipe has to hold
+ * before its readers are woken up or polled readable. A full pipe, or one
+ * without writers, wakes them regardless. Returns the low-water mark set.
+ */
+static long pipe_set_lowat(struct pipe_inode_info *pipe, unsigned long arg)
+{
+#ifdef CONFIG_WATCH_QUEUE
+	if (pipe->watch_queue)
+		return -EBUSY;
+#endif
+
+	if (arg > pipe_max_size && !capable(CAP_SYS_RESOURCE))
+		return -EINVAL;
+
+	WRITE_ONCE(pipe->rd_lowat, DIV_ROUND_UP(arg, PAGE_SIZE));
+
+	/* Readers may have enough to go on with a lower mark */
+	wake_up_interruptible(&pipe->rd_wait);
+	return pipe->rd_lowat * PAGE_SIZE;
+}
+
 /*
  * Note that i_pipe and i_cdev share the same location, so checking ->i_pipe is
  * not enough to verify that this is a pipe.
@@ -1377,6 +1447,12 @@ long pipe_fcntl(struct file *file, unsigned int cmd, unsigned long arg)
 	case F_GETPIPE_SZ:
 		ret = pipe->max_usage * PAGE_SIZE;
 		break;
+	case F_SETPIPE_LOWAT:
+		ret = pipe_set_lowat(pipe, arg);
+		break;
+	case F_GETPIPE_LOWAT:
+		ret = pipe->rd_lowat * PAGE_SIZE;
+		break;
 	default:
 		ret = -EINVAL;
 		break;
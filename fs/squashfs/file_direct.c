@@ -11,6 +11,7 @@
 #include <linux/string.h>
 #include <linux/pagemap.h>
 #include <linux/mutex.h>
+#include <linux/workqueue.h>
 
 #include "squashfs_fs.h"
 #include "squashfs_fs_sb.h"
@@ -18,9 +19,6 @@
 #include "squashfs.h"
 #include "page_actor.h"
 
-static int squashfs_read_cache(struct page *target_page, u64 block, int bsize,
-	int pages, struct page **page, int bytes);
-
 /* Read separately compressed datablock directly into page cache */
 int squashfs_readpage_block(struct page *target_page, u64 block, int bsize,
 	int expected)
@@ -33,7 +31,7 @@ int squashfs_readpage_block(struct page *target_page, u64 block, int bsize,
 	int mask = (1 << (msblk->block_log - PAGE_SHIFT)) - 1;
 	int start_index = target_page->index & ~mask;
 	int end_index = start_index | mask;
-	int i, n, pages, missing_pages, bytes, res = -ENOMEM;
+	int i, n, pages, bytes, res = -ENOMEM;
 	struct page **page;
 	struct squashfs_page_actor *actor;
 	void *pageaddr;
@@ -47,50 +45,36 @@ int squashfs_readpage_block(struct page *target_page, u64 block, int bsize,
 	if (page == NULL)
 		return res;
 
-	/*
-	 * Create a "page actor" which will kmap and kunmap the
-	 * page cache pages appropriately within the decompressor
-	 */
-	actor = squashfs_page_actor_init_special(page, pages, 0);
-	if (actor == NULL)
-		goto out;
-
 	/* Try to grab all the pages covered by the Squashfs block */
-	for (missing_pages = 0, i = 0, n = start_index; i < pages; i++, n++) {
+	for (i = 0, n = start_index; i < pages; i++, n++) {
 		page[i] = (n == target_page->index) ? target_page :
 			grab_cache_page_nowait(target_page->mapping, n);
 
-		if (page[i] == NULL) {
-			missing_pages++;
+		if (page[i] == NULL)
 			continue;
-		}
 
 		if (PageUptodate(page[i])) {
 			unlock_page(page[i]);
 			put_page(page[i]);
 			page[i] = NULL;
-			missing_pages++;
 		}
 	}
 
-	if (missing_pages) {
-		/*
-		 * Couldn't get one or more pages, this page has either
-		 * been VM reclaimed, but others are still in the page cache
-		 * and uptodate, or we're racing with another thread in
-		 * squashfs_readpage also trying to grab them.  Fall back to
-		 * using an intermediate buffer.
-		 */
-		res = squashfs_read_cache(target_page, block, bsize, pages,
-							page, expected);
-		if (res < 0)
-			goto mark_errored;
-
-		goto out;
-	}
+	/*
+	 * Create a "page actor" which will kmap and kunmap the
+	 * page cache pages appropriately within the decompressor.
+	 * Pages we couldn't get, because they have either already been
+	 * read or we're racing with another thread in squashfs_readpage
+	 * also trying to grab them, are decompressed into a scratch
+	 * buffer rather than through the intermediate "data" cache.
+	 */
+	actor = squashfs_page_actor_init_special(page, pages, 0);
+	if (actor == NULL)
+		goto mark_errored;
 
 	/* Decompress directly into the page cache buffers */
 	res = squashfs_read_data(inode->i_sb, block, bsize, NULL, actor);
+	squashfs_page_actor_free(actor);
 	if (res < 0)
 		goto mark_errored;
 
@@ -101,7 +85,7 @@ int squashfs_readpage_block(struct page *target_page, u64 block, int bsize,
 
 	/* Last page may have trailing bytes not filled */
 	bytes = res % PAGE_SIZE;
-	if (bytes) {
+	if (bytes && page[pages - 1]) {
 		pageaddr = kmap_atomic(page[pages - 1]);
 		memset(pageaddr + bytes, 0, PAGE_SIZE - bytes);
 		kunmap_atomic(pageaddr);
@@ -109,6 +93,8 @@ int squashfs_readpage_block(struct page *target_page, u64 block, int bsize,
 
 	/* Mark pages as uptodate, unlock and release */
 	for (i = 0; i < pages; i++) {
+		if (page[i] == NULL)
+			continue;
 		flush_dcache_page(page[i]);
 		SetPageUptodate(page[i]);
 		unlock_page(page[i]);
@@ -116,7 +102,6 @@ int squashfs_readpage_block(struct page *target_page, u64 block, int bsize,
 			put_page(page[i]);
 	}
 
-	kfree(actor);
 	kfree(page);
 
 	return 0;
@@ -134,41 +119,221 @@ int squashfs_readpage_block(struct page *target_page, u64 block, int bsize,
 		put_page(page[i]);
 	}
 
-out:
-	kfree(actor);
 	kfree(page);
 	return res;
 }
 
+/*
+ * Readahead.  Every whole datablock in the readahead window, plus the next
+ * few blocks past it, is handed to an unbound workqueue that reads and
+ * decompresses it straight into its page cache pages.  The pages stay locked
+ * until their block is done, so a task faulting on one of them waits only for
+ * that block while the others are decompressed in parallel on the other CPUs.
+ */
+static struct workqueue_struct *squashfs_ra_wq;
+
+struct squashfs_ra_work {
+	struct work_struct	work;
+	struct super_block	*sb;
+	u64			block;
+	int			bsize;
+	int			expected;
+	int			pages;
+	struct page		*page[];
+};
 
-static int squashfs_read_cache(struct page *target_page, u64 block, int bsize,
-	int pages, struct page **page, int bytes)
+static void squashfs_ra_release(struct page **page, int pages, bool uptodate)
 {
-	struct inode *i = target_page->mapping->host;
-	struct squashfs_cache_entry *buffer = squashfs_get_datablock(i->i_sb,
-						 block, bsize);
-	int res = buffer->error, n, offset = 0;
-
-	if (res) {
-		ERROR("Unable to read page, block %llx, size %x\n", block,
-			bsize);
-		goto out;
+	int i;
+
+	for (i = 0; i < pages; i++) {
+		if (uptodate) {
+			flush_dcache_page(page[i]);
+			SetPageUptodate(page[i]);
+		}
+		unlock_page(page[i]);
+		put_page(page[i]);
+	}
+}
+
+static void squashfs_ra_work_fn(struct work_struct *work)
+{
+	struct squashfs_ra_work *ra = container_of(work,
+					struct squashfs_ra_work, work);
+	struct squashfs_page_actor *actor;
+	int res = -ENOMEM, bytes;
+	void *pageaddr;
+
+	actor = squashfs_page_actor_init_special(ra->page, ra->pages, 0);
+	if (actor) {
+		res = squashfs_read_data(ra->sb, ra->block, ra->bsize, NULL,
+					 actor);
+		squashfs_page_actor_free(actor);
 	}
 
-	for (n = 0; n < pages && bytes > 0; n++,
-			bytes -= PAGE_SIZE, offset += PAGE_SIZE) {
-		int avail = min_t(int, bytes, PAGE_SIZE);
+	/*
+	 * On failure just unlock the pages, ->readpage will retry and report
+	 * the error when the data is actually wanted.
+	 */
+	if (res == ra->expected) {
+		bytes = res % PAGE_SIZE;
+		if (bytes) {
+			pageaddr = kmap_atomic(ra->page[ra->pages - 1]);
+			memset(pageaddr + bytes, 0, PAGE_SIZE - bytes);
+			kunmap_atomic(pageaddr);
+		}
+	}
+	squashfs_ra_release(ra->page, ra->pages, res == ra->expected);
+	kfree(ra);
+}
 
-		if (page[n] == NULL)
+static struct squashfs_ra_work *squashfs_ra_alloc(int pages, gfp_t gfp)
+{
+	struct squashfs_ra_work *ra;
+
+	return kmalloc(struct_size(ra, page, pages),
+		       gfp | __GFP_NORETRY | __GFP_NOWARN);
+}
+
+/* Look up and queue datablock @index, whose @ra->pages are locked in cache */
+static void squashfs_ra_submit(struct inode *inode, int index,
+			       struct squashfs_ra_work *ra)
+{
+	struct squashfs_sb_info *msblk = inode->i_sb->s_fs_info;
+	int file_end = i_size_read(inode) >> msblk->block_log;
+	int i;
+
+	ra->sb = inode->i_sb;
+	ra->expected = index == file_end ?
+		(i_size_read(inode) & (msblk->block_size - 1)) :
+		msblk->block_size;
+	ra->bsize = squashfs_read_blocklist(inode, index, &ra->block);
+	if (ra->bsize < 0) {
+		squashfs_ra_release(ra->page, ra->pages, false);
+		kfree(ra);
+		return;
+	}
+
+	if (ra->bsize == 0) {
+		/* Sparse block, nothing to decompress */
+		for (i = 0; i < ra->pages; i++)
+			zero_user(ra->page[i], 0, PAGE_SIZE);
+		squashfs_ra_release(ra->page, ra->pages, true);
+		kfree(ra);
+		return;
+	}
+
+	INIT_WORK(&ra->work, squashfs_ra_work_fn);
+	queue_work(squashfs_ra_wq, &ra->work);
+}
+
+/*
+ * Number of page cache pages in datablock @index, or 0 if the block is past
+ * EOF or is the tail end packed into a fragment, which stays with ->readpage.
+ */
+static int squashfs_ra_block_pages(struct inode *inode, int index)
+{
+	struct squashfs_sb_info *msblk = inode->i_sb->s_fs_info;
+	int shift = msblk->block_log - PAGE_SHIFT;
+	loff_t size = i_size_read(inode);
+	pgoff_t start = (pgoff_t)index << shift;
+	pgoff_t end = min_t(pgoff_t, start + (1 << shift),
+			    DIV_ROUND_UP(size, PAGE_SIZE));
+
+	if (start >= end)
+		return 0;
+	if (index >= (size >> msblk->block_log) &&
+	    squashfs_i(inode)->fragment_block != SQUASHFS_INVALID_BLK)
+		return 0;
+	return end - start;
+}
+
+/* Populate and queue a block past the readahead window, if not cached yet */
+static bool squashfs_ra_ahead(struct address_space *mapping, int index)
+{
+	struct inode *inode = mapping->host;
+	struct squashfs_sb_info *msblk = inode->i_sb->s_fs_info;
+	pgoff_t start = (pgoff_t)index << (msblk->block_log - PAGE_SHIFT);
+	gfp_t gfp = readahead_gfp_mask(mapping);
+	int i, pages = squashfs_ra_block_pages(inode, index);
+	struct squashfs_ra_work *ra;
+
+	if (!pages || filemap_range_has_page(mapping,
+			(loff_t)start << PAGE_SHIFT,
+			((loff_t)(start + pages) << PAGE_SHIFT) - 1))
+		return false;
+
+	ra = squashfs_ra_alloc(pages, gfp);
+	if (!ra)
+		return false;
+
+	for (i = 0; i < pages; i++) {
+		struct page *page = __page_cache_alloc(gfp);
+
+		if (page && !add_to_page_cache_lru(page, mapping, start + i,
+						   gfp)) {
+			ra->page[i] = page;
 			continue;
+		}
+		if (page)
+			put_page(page);
+		squashfs_ra_release(ra->page, i, false);
+		kfree(ra);
+		return false;
+	}
+
+	ra->pages = pages;
+	squashfs_ra_submit(inode, index, ra);
+	return true;
+}
+
+void squashfs_readahead(struct readahead_control *ractl)
+{
+	struct inode *inode = ractl->mapping->host;
+	struct squashfs_sb_info *msblk = inode->i_sb->s_fs_info;
+	int shift = msblk->block_log - PAGE_SHIFT;
+	int index, last = -1, i, pages, ahead;
+	struct squashfs_ra_work *ra;
+
+	/*
+	 * Only whole blocks can be decompressed in place; a partial block
+	 * at either end of the window is left for ->readpage.
+	 */
+	while (readahead_count(ractl)) {
+		pgoff_t start = readahead_index(ractl);
+
+		if (start & ((1 << shift) - 1))
+			break;
+		index = start >> shift;
+		pages = squashfs_ra_block_pages(inode, index);
+		if (!pages || readahead_count(ractl) < pages)
+			break;
 
-		squashfs_fill_page(page[n], buffer, offset, avail);
-		unlock_page(page[n]);
-		if (page[n] != target_page)
-			put_page(page[n]);
+		ra = squashfs_ra_alloc(pages, readahead_gfp_mask(ractl->mapping));
+		if (!ra)
+			break;
+		for (i = 0; i < pages; i++)
+			ra->page[i] = readahead_page(ractl);
+		ra->pages = pages;
+		squashfs_ra_submit(inode, index, ra);
+		last = index;
 	}
 
-out:
-	squashfs_cache_put(buffer);
-	return res;
+	/* Keep every CPU busy with the blocks that are read next */
+	if (last < 0)
+		return;
+	for (ahead = num_online_cpus() - 1; ahead > 0; ahead--)
+		if (!squashfs_ra_ahead(ractl->mapping, ++last))
+			break;
+}
+
+int __init squashfs_readahead_init(void)
+{
+	squashfs_ra_wq = alloc_workqueue("squashfs_ra", WQ_UNBOUND, 0);
+	return squashfs_ra_wq ? 0 : -ENOMEM;
+}
+
+void squashfs_readahead_exit(void)
+{
+	destroy_workqueue(squashfs_ra_wq);
 }
@@ -48,6 +48,7 @@ struct squashfs_page_actor *squashfs_page_actor_init(void **buffer,
 
 	actor->length = length ? : pages * PAGE_SIZE;
 	actor->buffer = buffer;
+	actor->tmp_buffer = NULL;
 	actor->pages = pages;
 	actor->next_page = 0;
 	actor->squashfs_first_page = cache_first_page;
@@ -56,20 +57,34 @@ struct squashfs_page_actor *squashfs_page_actor_init(void **buffer,
 	return actor;
 }
 
-/* Implementation of page_actor for decompressing directly into page cache. */
-static void *direct_first_page(struct squashfs_page_actor *actor)
-{
-	actor->next_page = 1;
-	return actor->pageaddr = kmap_atomic(actor->page[0]);
-}
-
+/*
+ * Implementation of page_actor for decompressing directly into page cache.
+ * Pages missing from the array (NULL) are decompressed into a scratch buffer
+ * and discarded, so the rest of the block can still go straight to the page
+ * cache when some of its pages are already present or could not be grabbed.
+ */
 static void *direct_next_page(struct squashfs_page_actor *actor)
 {
-	if (actor->pageaddr)
+	if (actor->pageaddr) {
 		kunmap_atomic(actor->pageaddr);
+		actor->pageaddr = NULL;
+	}
+
+	if (actor->next_page == actor->pages)
+		return NULL;
+
+	if (actor->page[actor->next_page] == NULL) {
+		actor->next_page++;
+		return actor->tmp_buffer;
+	}
 
-	return actor->pageaddr = actor->next_page == actor->pages ? NULL :
-		kmap_atomic(actor->page[actor->next_page++]);
+	return actor->pageaddr = kmap_atomic(actor->page[actor->next_page++]);
+}
+
+static void *direct_first_page(struct squashfs_page_actor *actor)
+{
+	actor->next_page = 0;
+	return direct_next_page(actor);
 }
 
 static void direct_finish_page(struct squashfs_page_actor *actor)
@@ -82,10 +97,23 @@ struct squashfs_page_actor *squashfs_page_actor_init_special(struct page **page,
 	int pages, int length)
 {
 	struct squashfs_page_actor *actor = kmalloc(sizeof(*actor), GFP_KERNEL);
+	int i;
 
 	if (actor == NULL)
 		return NULL;
 
+	actor->tmp_buffer = NULL;
+	for (i = 0; i < pages; i++) {
+		if (page[i])
+			continue;
+		actor->tmp_buffer = kmalloc(PAGE_SIZE, GFP_KERNEL);
+		if (actor->tmp_buffer == NULL) {
+			kfree(actor);
+			return NULL;
+		}
+		break;
+	}
+
 	actor->length = length ? : pages * PAGE_SIZE;
 	actor->page = page;
 	actor->pages = pages;
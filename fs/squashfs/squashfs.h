@@ -57,9 +57,24 @@ extern __le64 *squashfs_read_fragment_index_table(struct super_block *,
 void squashfs_fill_page(struct page *, struct squashfs_cache_entry *, int, int);
 void squashfs_copy_cache(struct page *, struct squashfs_cache_entry *, int,
 				int);
+int squashfs_read_blocklist(struct inode *, int, u64 *);
 
 /* file_xxx.c */
 extern int squashfs_readpage_block(struct page *, u64, int, int);
+#ifdef CONFIG_SQUASHFS_FILE_DIRECT
+extern void squashfs_readahead(struct readahead_control *);
+extern int squashfs_readahead_init(void);
+extern void squashfs_readahead_exit(void);
+#else
+static inline int squashfs_readahead_init(void)
+{
+	return 0;
+}
+
+static inline void squashfs_readahead_exit(void)
+{
+}
+#endif
 
 /* id.c */
 extern int squashfs_get_id(struct super_block *, unsigned int, unsigned int *);
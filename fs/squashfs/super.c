@@ -26,6 +26,7 @@
 #include <linux/module.h>
 #include <linux/magic.h>
 #include <linux/xattr.h>
+#include <linux/mm.h>
 
 #include "squashfs_fs.h"
 #include "squashfs_fs_sb.h"
@@ -65,6 +66,23 @@ static const struct squashfs_decompressor *supported_squashfs_filesystem(
 }
 
 
+/*
+ * Fragment blocks hold the tail ends of many files and cannot be decompressed
+ * straight into one file's page cache, so they go through the fragment cache.
+ * With several CPUs reading at once the configured number of entries is a
+ * floor: allow one more per online CPU, as long as the whole cache stays
+ * under 1/1024th of RAM.
+ */
+static int squashfs_fragment_cache_entries(struct squashfs_sb_info *msblk)
+{
+	unsigned long limit = (totalram_pages() >> 10) * PAGE_SIZE /
+			      msblk->block_size;
+	unsigned long entries = SQUASHFS_CACHED_FRAGMENTS + num_online_cpus();
+
+	return max_t(unsigned long, SQUASHFS_CACHED_FRAGMENTS,
+		     min(entries, limit));
+}
+
 static int squashfs_fill_super(struct super_block *sb, struct fs_context *fc)
 {
 	struct squashfs_sb_info *msblk;
@@ -270,7 +288,7 @@ static int squashfs_fill_super(struct super_block *sb, struct fs_context *fc)
 		goto check_directory_table;
 
 	msblk->fragment_cache = squashfs_cache_init("fragment",
-		SQUASHFS_CACHED_FRAGMENTS, msblk->block_size);
+		squashfs_fragment_cache_entries(msblk), msblk->block_size);
 	if (msblk->fragment_cache == NULL) {
 		err = -ENOMEM;
 		goto failed_mount;
@@ -444,8 +462,15 @@ static int __init init_squashfs_fs(void)
 	if (err)
 		return err;
 
+	err = squashfs_readahead_init();
+	if (err) {
+		destroy_inodecache();
+		return err;
+	}
+
 	err = register_filesystem(&squashfs_fs_type);
 	if (err) {
+		squashfs_readahead_exit();
 		destroy_inodecache();
 		return err;
 	}
@@ -459,6 +484,7 @@ static int __init init_squashfs_fs(void)
 static void __exit exit_squashfs_fs(void)
 {
 	unregister_filesystem(&squashfs_fs_type);
+	squashfs_readahead_exit();
 	destroy_inodecache();
 }
 
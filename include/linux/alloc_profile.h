@@ -0,0 +1,40 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+#ifndef __LINUX_ALLOC_PROFILE_H
+#define __LINUX_ALLOC_PROFILE_H
+
+#include <linux/jump_label.h>
+#include <linux/percpu.h>
+#include <linux/types.h>
+
+#ifdef CONFIG_ALLOC_PROFILE
+extern struct static_key_false alloc_profile_key;
+DECLARE_PER_CPU(int, alloc_profile_countdown);
+
+extern void __alloc_profile_sample(const void *ptr, size_t size, gfp_t gfp);
+extern void __alloc_profile_free(const void *ptr);
+
+/* Every sample_interval-th allocation on a CPU is sampled */
+static inline void alloc_profile_alloc(const void *ptr, size_t size,
+				       gfp_t gfp)
+{
+	if (static_branch_unlikely(&alloc_profile_key) &&
+	    this_cpu_dec_return(alloc_profile_countdown) <= 0)
+		__alloc_profile_sample(ptr, size, gfp);
+}
+
+static inline void alloc_profile_free(const void *ptr)
+{
+	if (static_branch_unlikely(&alloc_profile_key))
+		__alloc_profile_free(ptr);
+}
+#else
+static inline void alloc_profile_alloc(const void *ptr, size_t size,
+				       gfp_t gfp)
+{
+}
+static inline void alloc_profile_free(const void *ptr)
+{
+}
+#endif /* CONFIG_ALLOC_PROFILE */
+
+#endif /* __LINUX_ALLOC_PROFILE_H */
@@ -154,6 +154,19 @@ struct blk_mq_hw_ctx {
 	unsigned long		poll_invoked;
 	/** @poll_success: Count how many polled requests were completed. */
 	unsigned long		poll_success;
+	/** @poll_slept: Count how many hybrid polls slept before polling. */
+	unsigned long		poll_slept;
+	/**
+	 * @poll_overslept: Count how many hybrid polls found the request
+	 * already completed when they woke up.
+	 */
+	unsigned long		poll_overslept;
+	/**
+	 * @poll_hist: Decaying histogram of polled completion latencies,
+	 * indexed by poll stats bucket and log2 latency in microseconds.
+	 */
+	unsigned int		poll_hist[BLK_MQ_POLL_STATS_BKTS]
+					 [BLK_MQ_POLL_HIST_SLOTS];
 
 #ifdef CONFIG_BLK_DEBUG_FS
 	/**
@@ -433,6 +446,7 @@ int blk_mq_alloc_tag_set(struct blk_mq_tag_set *set);
 void blk_mq_free_tag_set(struct blk_mq_tag_set *set);
 
 void blk_mq_flush_plug_list(struct blk_plug *plug, bool from_schedule);
+void blk_mq_free_plug_rqs(struct blk_plug *plug);
 
 void blk_mq_free_request(struct request *rq);
 
@@ -506,6 +520,42 @@ void blk_mq_start_request(struct request *rq);
 void blk_mq_end_request(struct request *rq, blk_status_t error);
 void __blk_mq_end_request(struct request *rq, blk_status_t error);
 
+/*
+ * A batch of successfully completed requests, collected by a driver while
+ * reaping its completion queue and ended in one go once the queue has been
+ * drained, see blk_mq_add_to_batch() and blk_mq_end_request_batch().
+ */
+struct io_comp_batch {
+	struct list_head req_list;
+	void (*complete)(struct io_comp_batch *);
+};
+
+#define DEFINE_IO_COMP_BATCH(name)					\
+	struct io_comp_batch name = {					\
+		.req_list = LIST_HEAD_INIT(name.req_list),		\
+	}
+
+/*
+ * Queue @req on @iob instead of completing it right away.  Only plain
+ * successful requests qualify; anything with an I/O scheduler, a private
+ * end_io handler or an error is left to the regular completion path.
+ */
+static inline bool blk_mq_add_to_batch(struct request *req,
+				       struct io_comp_batch *iob, int ioerror,
+				       void (*complete)(struct io_comp_batch *))
+{
+	if (!iob || req->q->elevator || req->end_io || ioerror)
+		return false;
+	if (!iob->complete)
+		iob->complete = complete;
+	else if (iob->complete != complete)
+		return false;
+	list_add_tail(&req->queuelist, &iob->req_list);
+	return true;
+}
+
+void blk_mq_end_request_batch(struct io_comp_batch *iob);
+
 void blk_mq_requeue_request(struct request *rq, bool kick_requeue_list);
 void blk_mq_kick_requeue_list(struct request_queue *q);
 void blk_mq_delay_kick_requeue_list(struct request_queue *q, unsigned long msecs);
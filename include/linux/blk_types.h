@@ -531,12 +531,17 @@ static inline bool blk_qc_t_is_internal(blk_qc_t cookie)
 	return (cookie & BLK_QC_T_INTERNAL) != 0;
 }
 
+/* log2 latency slots of a blk_rq_stat, the last one is open ended */
+#define BLK_RQ_STAT_HIST_SLOTS	20
+
 struct blk_rq_stat {
 	u64 mean;
 	u64 min;
 	u64 max;
 	u32 nr_samples;
 	u64 batch;
+	/* slot 0 counts samples under 1024ns, slot n those under 1024ns << n */
+	u32 hist[BLK_RQ_STAT_HIST_SLOTS];
 };
 
 #endif /* __LINUX_BLK_TYPES_H */
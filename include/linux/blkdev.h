@@ -50,6 +50,13 @@ struct blk_keyslot_manager;
 /* Must be consistent with blk_mq_poll_stats_bkt() */
 #define BLK_MQ_POLL_STATS_BKTS 16
 
+/*
+ * Log2 completion latency slots per poll stats bucket: slot 0 is below ~1us,
+ * slot n covers [2^(n-1), 2^n) us and the last slot, read as ending at ~33ms,
+ * also takes everything slower.
+ */
+#define BLK_MQ_POLL_HIST_SLOTS 16
+
 /* Doing classic polling */
 #define BLK_MQ_POLL_CLASSIC -1
 
@@ -478,6 +485,9 @@ struct request_queue {
 
 	struct blk_stat_callback	*poll_cb;
 	struct blk_rq_stat	poll_stat[BLK_MQ_POLL_STATS_BKTS];
+	/* hybrid poll sleep, a low percentile of the latency histogram */
+	unsigned int		poll_pct_nsec[BLK_MQ_POLL_STATS_BKTS];
+	unsigned long		poll_pct_stale;
 
 	struct timer_list	timeout;
 	struct work_struct	timeout_work;
@@ -1241,6 +1251,8 @@ extern void blk_set_queue_dying(struct request_queue *);
 struct blk_plug {
 	struct list_head mq_list; /* blk-mq requests */
 	struct list_head cb_list; /* md requires an unplug callback */
+	struct list_head cached_rq; /* preallocated blk-mq requests */
+	unsigned short nr_ios; /* expected submissions, sizes cached_rq */
 	unsigned short rq_count;
 	bool multiple_queues;
 	bool nowait;
@@ -1258,6 +1270,7 @@ struct blk_plug_cb {
 extern struct blk_plug_cb *blk_check_plugged(blk_plug_cb_fn unplug,
 					     void *data, int size);
 extern void blk_start_plug(struct blk_plug *);
+extern void blk_start_plug_nr_ios(struct blk_plug *, unsigned short);
 extern void blk_finish_plug(struct blk_plug *);
 extern void blk_flush_plug_list(struct blk_plug *, bool);
 
@@ -1283,7 +1296,8 @@ static inline bool blk_needs_flush_plug(struct task_struct *tsk)
 
 	return plug &&
 		 (!list_empty(&plug->mq_list) ||
-		 !list_empty(&plug->cb_list));
+		 !list_empty(&plug->cb_list) ||
+		 !list_empty(&plug->cached_rq));
 }
 
 int blkdev_issue_flush(struct block_device *bdev);
@@ -1296,6 +1310,11 @@ static inline void blk_start_plug(struct blk_plug *plug)
 {
 }
 
+static inline void blk_start_plug_nr_ios(struct blk_plug *plug,
+					 unsigned short nr_ios)
+{
+}
+
 static inline void blk_finish_plug(struct blk_plug *plug)
 {
 }
@@ -151,6 +151,11 @@ struct console {
 	int	cflag;
 	void	*data;
 	struct	 console *next;
+	/* output statistics, updated under console_lock */
+	unsigned long nr_writes;
+	unsigned long long write_bytes;
+	u64	write_ns;
+	u64	max_write_ns;
 };
 
 /*
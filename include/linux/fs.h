@@ -903,6 +903,10 @@ struct file_ra_state {
 	unsigned int ra_pages;		/* Maximum readahead window */
 	unsigned int mmap_miss;		/* Cache miss stat for mmap accesses */
 	loff_t prev_pos;		/* Cache last read() position */
+	unsigned int stride;		/* Gap between the last small random
+					   reads, or of the strided stream */
+	unsigned int waste_shift;	/* Shrinks initial windows after
+					   mostly unread ones */
 };
 
 /*
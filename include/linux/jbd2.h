@@ -739,10 +739,17 @@ struct transaction_run_stats_s {
 	__u32			rs_blocks_logged;
 };
 
+/*
+ * Commit latency histogram: slot 0 counts commits under 128us, slot n the
+ * ones from 64us << n up, the last slot everything longer.
+ */
+#define JBD2_COMMIT_HIST_SLOTS	16
+
 struct transaction_stats_s {
 	unsigned long		ts_tid;
 	unsigned long		ts_requested;
 	struct transaction_run_stats_s run;
+	unsigned long		ts_commit_hist[JBD2_COMMIT_HIST_SLOTS];
 };
 
 static inline unsigned long
@@ -1163,6 +1170,15 @@ struct journal_s
 	 */
 	u32			j_max_batch_time;
 
+	/**
+	 * @j_commit_window:
+	 *
+	 * Time in microseconds, from the start of the running transaction,
+	 * that a commit requested for it is held back so that more fsyncs
+	 * can join it. 0 commits at once. [j_state_lock]
+	 */
+	u32			j_commit_window;
+
 	/**
 	 * @j_commit_callback:
 	 *
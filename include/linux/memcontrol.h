@@ -115,7 +115,7 @@ struct mem_cgroup_per_node {
 	 * Legacy local VM stats. This should be struct lruvec_stat and
 	 * cannot be optimized to struct batched_lruvec_stat. Because
 	 * the threshold of the lruvec_stat_cpu can be as big as
-	 * MEMCG_CHARGE_BATCH * PAGE_SIZE. It can fit into s32. But this
+	 * MEMCG_CHARGE_BATCH_MAX * PAGE_SIZE. It can fit into s32. But this
 	 * filed has no upper limit.
 	 */
 	struct lruvec_stat __percpu *lruvec_stat_local;
@@ -345,6 +345,9 @@ struct mem_cgroup {
  */
 #define MEMCG_CHARGE_BATCH 32U
 
+/* Upper bound for the memcg_charge_batch= boot parameter */
+#define MEMCG_CHARGE_BATCH_MAX 1024U
+
 extern struct mem_cgroup *root_mem_cgroup;
 
 enum page_memcg_data_flags {
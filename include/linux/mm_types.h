@@ -101,6 +101,12 @@ struct page {
 			 * 32-bit architectures.
 			 */
 			unsigned long dma_addr[2];
+			unsigned long _pp_mapping_pad;
+			/**
+			 * @pp_frag_count: users of a PP_FLAG_PAGE_FRAG page
+			 * still holding one of its fragments.
+			 */
+			atomic_long_t pp_frag_count;
 		};
 		struct {	/* slab, slob and slub */
 			union {
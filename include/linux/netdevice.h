@@ -348,6 +348,15 @@ struct napi_struct {
 	struct hlist_node	napi_hash_node;
 	unsigned int		napi_id;
 	struct task_struct	*thread;
+	struct napi_thread_params *thread_params;
+	u16			busy_poll_budget; /* 0: caller's budget */
+};
+
+/* Placement of a threaded NAPI poll thread, kept across thread restarts */
+struct napi_thread_params {
+	cpumask_t		affinity;	/* empty: any CPU */
+	int			policy;
+	int			priority;
 };
 
 enum {
@@ -500,6 +509,10 @@ static inline bool napi_complete(struct napi_struct *n)
 }
 
 int dev_set_threaded(struct net_device *dev, bool threaded);
+int napi_set_thread_affinity(struct napi_struct *n, const struct cpumask *mask);
+int napi_set_thread_sched(struct napi_struct *n, int policy, int priority);
+void netif_rx_queue_set_napi(struct net_device *dev, unsigned int rxq,
+			     struct napi_struct *napi);
 
 /**
  *	napi_disable - prevent NAPI from scheduling
@@ -740,6 +753,7 @@ struct netdev_rx_queue {
 #endif
 	struct kobject			kobj;
 	struct net_device		*dev;
+	struct napi_struct		*napi;
 	struct xdp_rxq_info		xdp_rxq;
 #ifdef CONFIG_XDP_SOCKETS
 	struct xsk_buff_pool            *pool;
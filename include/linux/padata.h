@@ -158,6 +158,10 @@ struct padata_mt_job {
  * @cpumask: User supplied cpumasks for parallel and serial works.
  * @kobj: padata instance kernel object.
  * @lock: padata instance lock.
+ * @nr_parallel: Objects queued to a parallel worker.
+ * @nr_inline: Objects run by the submitter, the works limit was exceeded.
+ * @nr_rejected: Objects refused by padata_do_parallel.
+ * @nr_serial: Objects passed to their serial callback.
  * @flags: padata flags.
  */
 struct padata_instance {
@@ -169,6 +173,10 @@ struct padata_instance {
 	struct padata_cpumask		cpumask;
 	struct kobject                   kobj;
 	struct mutex			 lock;
+	atomic_long_t			 nr_parallel;
+	atomic_long_t			 nr_inline;
+	atomic_long_t			 nr_rejected;
+	atomic_long_t			 nr_serial;
 	u8				 flags;
 #define	PADATA_INIT	1
 #define	PADATA_RESET	2
@@ -42,6 +42,7 @@ struct pipe_buffer {
  *	@max_usage: The maximum number of slots that may be used in the ring
  *	@ring_size: total number of buffers (should be a power of 2)
  *	@nr_accounted: The amount this pipe accounts for in user->pipe_bufs
+ *	@rd_lowat: slots to fill before waking readers (F_SETPIPE_LOWAT)
  *	@tmp_page: cached released page
  *	@readers: number of current readers of this pipe
  *	@writers: number of current writers of this pipe
@@ -65,6 +66,7 @@ struct pipe_inode_info {
 	bool note_loss;
 #endif
 	unsigned int nr_accounted;
+	unsigned int rd_lowat;
 	unsigned int readers;
 	unsigned int writers;
 	unsigned int files;
@@ -239,6 +241,7 @@ void pipe_double_lock(struct pipe_inode_info *, struct pipe_inode_info *);
 extern unsigned int pipe_max_size;
 extern unsigned long pipe_user_pages_hard;
 extern unsigned long pipe_user_pages_soft;
+extern unsigned int pipe_buf_order;
 
 /* Wait for a pipe to be readable/writable while dropping the pipe lock */
 void pipe_wait_readable(struct pipe_inode_info *);
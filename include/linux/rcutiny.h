@@ -42,6 +42,12 @@ static inline void synchronize_rcu_expedited(void)
  */
 extern void kvfree(const void *addr);
 
+/* Tiny RCU never batches callbacks lazily. */
+static inline void call_rcu_hurry(struct rcu_head *head, rcu_callback_t func)
+{
+	call_rcu(head, func);
+}
+
 static inline void kvfree_call_rcu(struct rcu_head *head, rcu_callback_t func)
 {
 	if (head) {
@@ -76,6 +76,8 @@ struct rhash_lock_head {};
 struct bucket_table {
 	unsigned int		size;
 	unsigned int		nest;
+	unsigned int		grow_at;
+	unsigned int		shrink_at;
 	u32			hash_rnd;
 	struct list_head	walkers;
 	struct rcu_head		rcu;
@@ -175,28 +177,32 @@ static inline unsigned int rht_head_hashfn(
 }
 
 /**
- * rht_grow_above_75 - returns true if nelems > 0.75 * table-size
+ * rht_grow_above_75 - returns true if nelems is above the grow threshold
  * @ht:		hash table
  * @tbl:	current table
+ *
+ * The threshold is p.grow_percent of the table size, 75% by default.
  */
 static inline bool rht_grow_above_75(const struct rhashtable *ht,
 				     const struct bucket_table *tbl)
 {
-	/* Expand table when exceeding 75% load */
-	return atomic_read(&ht->nelems) > (tbl->size / 4 * 3) &&
+	/* Expand table when exceeding the grow threshold */
+	return atomic_read(&ht->nelems) > tbl->grow_at &&
 	       (!ht->p.max_size || tbl->size < ht->p.max_size);
 }
 
 /**
- * rht_shrink_below_30 - returns true if nelems < 0.3 * table-size
+ * rht_shrink_below_30 - returns true if nelems is below the shrink threshold
  * @ht:		hash table
  * @tbl:	current table
+ *
+ * The threshold is p.shrink_percent of the table size, 30% by default.
  */
 static inline bool rht_shrink_below_30(const struct rhashtable *ht,
 				       const struct bucket_table *tbl)
 {
-	/* Shrink table beneath 30% load */
-	return atomic_read(&ht->nelems) < (tbl->size * 3 / 10) &&
+	/* Shrink table beneath the shrink threshold */
+	return atomic_read(&ht->nelems) < tbl->shrink_at &&
 	       tbl->size > ht->p.min_size;
 }
 
@@ -241,6 +247,7 @@ static inline int lockdep_rht_bucket_is_held(const struct bucket_table *tbl,
 
 void *rhashtable_insert_slow(struct rhashtable *ht, const void *key,
 			     struct rhash_head *obj);
+int rhashtable_reserve(struct rhashtable *ht, unsigned int nelems);
 
 void rhashtable_walk_enter(struct rhashtable *ht,
 			   struct rhashtable_iter *iter);
@@ -1112,6 +1119,45 @@ static inline int rhashtable_remove_fast(
 	return __rhashtable_remove_fast(ht, obj, params, false);
 }
 
+/**
+ * rhashtable_insert_bulk - insert several objects with one grow decision
+ * @ht:		hash table
+ * @objs:	pointers to the hash heads inside the objects
+ * @n:		number of objects
+ * @params:	hash table parameters
+ *
+ * Sizes the table for all @n objects with rhashtable_reserve() first, so
+ * that the inserts neither trigger nor run into a resize.  If that fails
+ * to allocate, the table grows as it would for single inserts.
+ *
+ * Either all objects are inserted or none: if one of them fails, the ones
+ * inserted before it are removed again.  Must be called from process
+ * context.
+ *
+ * Returns zero on success, or the error of the first failed insert.
+ */
+static inline int rhashtable_insert_bulk(
+	struct rhashtable *ht, struct rhash_head **objs, unsigned int n,
+	const struct rhashtable_params params)
+{
+	unsigned int i;
+	int err = 0;
+
+	rhashtable_reserve(ht, n);
+
+	for (i = 0; i < n; i++) {
+		err = rhashtable_insert_fast(ht, objs[i], params);
+		if (err)
+			break;
+	}
+
+	if (err)
+		while (i--)
+			rhashtable_remove_fast(ht, objs[i], params);
+
+	return err;
+}
+
 /**
  * rhltable_remove - remove object from hash list table
  * @hlt:	hash list table
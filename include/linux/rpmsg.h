@@ -64,6 +64,16 @@ struct rpmsg_device {
 
 typedef int (*rpmsg_rx_cb_t)(struct rpmsg_device *, void *, int, void *, u32);
 
+/**
+ * struct rpmsg_batch_entry - one message of rpmsg_send_batch()
+ * @data: payload of message
+ * @len: length of payload
+ */
+struct rpmsg_batch_entry {
+	void *data;
+	int len;
+};
+
 /**
  * struct rpmsg_endpoint - binds a local rpmsg address to its user
  * @rpdev: rpmsg channel device
@@ -187,6 +197,16 @@ int rpmsg_trysend_offchannel(struct rpmsg_endpoint *ept, u32 src, u32 dst,
 __poll_t rpmsg_poll(struct rpmsg_endpoint *ept, struct file *filp,
 			poll_table *wait);
 
+int rpmsg_hold_rx_buffer(struct rpmsg_device *rpdev, void *rxbuf);
+int rpmsg_release_rx_buffer(struct rpmsg_device *rpdev, void *rxbuf);
+
+int rpmsg_send_batch(struct rpmsg_endpoint *ept,
+		     const struct rpmsg_batch_entry *msgs, int count);
+int rpmsg_trysend_batch(struct rpmsg_endpoint *ept,
+			const struct rpmsg_batch_entry *msgs, int count);
+
+ssize_t rpmsg_get_mtu(struct rpmsg_endpoint *ept);
+
 #else
 
 static inline int rpmsg_register_device(struct rpmsg_device *rpdev)
@@ -297,6 +317,52 @@ static inline __poll_t rpmsg_poll(struct rpmsg_endpoint *ept,
 	return 0;
 }
 
+static inline int rpmsg_hold_rx_buffer(struct rpmsg_device *rpdev,
+				       void *rxbuf)
+{
+	/* This shouldn't be possible */
+	WARN_ON(1);
+
+	return -ENXIO;
+}
+
+static inline int rpmsg_release_rx_buffer(struct rpmsg_device *rpdev,
+					  void *rxbuf)
+{
+	/* This shouldn't be possible */
+	WARN_ON(1);
+
+	return -ENXIO;
+}
+
+static inline int rpmsg_send_batch(struct rpmsg_endpoint *ept,
+				   const struct rpmsg_batch_entry *msgs,
+				   int count)
+{
+	/* This shouldn't be possible */
+	WARN_ON(1);
+
+	return -ENXIO;
+}
+
+static inline int rpmsg_trysend_batch(struct rpmsg_endpoint *ept,
+				      const struct rpmsg_batch_entry *msgs,
+				      int count)
+{
+	/* This shouldn't be possible */
+	WARN_ON(1);
+
+	return -ENXIO;
+}
+
+static inline ssize_t rpmsg_get_mtu(struct rpmsg_endpoint *ept)
+{
+	/* This shouldn't be possible */
+	WARN_ON(1);
+
+	return -ENXIO;
+}
+
 #endif /* IS_ENABLED(CONFIG_RPMSG) */
 
 /* use a macro to avoid include chaining to get THIS_MODULE */
@@ -0,0 +1,25 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+
+#ifndef _LINUX_RPMSG_VIRTIO_RPMSG_H
+#define _LINUX_RPMSG_VIRTIO_RPMSG_H
+
+#include <linux/types.h>
+#include <linux/virtio_types.h>
+
+/* RP exposes its buffer geometry in struct virtio_rpmsg_config */
+#define VIRTIO_RPMSG_F_BUFSZ	1
+
+/**
+ * struct virtio_rpmsg_config - virtio rpmsg device configuration space
+ * @num_bufs: total number of buffers for rx and tx
+ * @buf_size: size of one rx or tx buffer, including the rpmsg header
+ *
+ * Only valid when VIRTIO_RPMSG_F_BUFSZ has been negotiated. Without it the
+ * rpmsg bus falls back to its built-in 512 buffers of 512 bytes.
+ */
+struct virtio_rpmsg_config {
+	__virtio32 num_bufs;
+	__virtio32 buf_size;
+} __packed;
+
+#endif
@@ -393,6 +393,21 @@ void sbitmap_queue_resize(struct sbitmap_queue *sbq, unsigned int depth);
  */
 int __sbitmap_queue_get(struct sbitmap_queue *sbq);
 
+/**
+ * __sbitmap_queue_get_batch() - Try to allocate a batch of free bits from a
+ * &struct sbitmap_queue with preemption already disabled.
+ * @sbq: Bitmap queue to allocate from.
+ * @nr_tags: Number of bits wanted, at most BITS_PER_LONG.
+ * @offset: Output parameter; bit number of the lowest bit of the mask.
+ *
+ * The bits are taken from a single word with one atomic operation, so fewer
+ * than @nr_tags may be returned.  Round-robin queues never batch.
+ *
+ * Return: Mask of allocated bits relative to @offset, 0 if none were found.
+ */
+unsigned long __sbitmap_queue_get_batch(struct sbitmap_queue *sbq, int nr_tags,
+					unsigned int *offset);
+
 /**
  * __sbitmap_queue_get_shallow() - Try to allocate a free bit from a &struct
  * sbitmap_queue, limiting the depth used from each word, with preemption
@@ -472,6 +487,18 @@ static inline int sbitmap_queue_get_shallow(struct sbitmap_queue *sbq,
 void sbitmap_queue_min_shallow_depth(struct sbitmap_queue *sbq,
 				     unsigned int min_shallow_depth);
 
+/**
+ * sbitmap_queue_clear_batch() - Free a batch of allocated bits and wake up
+ * waiters on a &struct sbitmap_queue.
+ * @sbq: Bitmap to free from.
+ * @offset: Value to subtract from each entry of @tags to get its bit number.
+ * @tags: Array of tags to free, best sorted so that bits sharing a word are
+ *        adjacent.
+ * @nr_tags: Number of entries in @tags.
+ */
+void sbitmap_queue_clear_batch(struct sbitmap_queue *sbq, int offset,
+			       int *tags, int nr_tags);
+
 /**
  * sbitmap_queue_clear() - Free an allocated bit and wake up waiters on a
  * &struct sbitmap_queue.
@@ -500,6 +500,8 @@ struct sched_rt_entity {
 	struct list_head		run_list;
 	unsigned long			timeout;
 	unsigned long			watchdog_stamp;
+	/* rq clock at wakeup, for the sched_rt_wakeup_latency tracepoint */
+	u64				wake_stamp;
 	unsigned int			time_slice;
 	unsigned short			on_rq;
 	unsigned short			on_list;
@@ -81,6 +81,10 @@ extern unsigned int sysctl_sched_autogroup_enabled;
 extern int sysctl_sched_rr_timeslice;
 extern int sched_rr_timeslice;
 
+#ifdef CONFIG_SMP
+extern unsigned int sysctl_sched_rt_pull_direct_cpus;
+#endif
+
 int sched_rr_handler(struct ctl_table *table, int write, void *buffer,
 		size_t *lenp, loff_t *ppos);
 int sched_rt_handler(struct ctl_table *table, int write, void *buffer,
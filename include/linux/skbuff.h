@@ -1089,6 +1089,8 @@ struct sk_buff *build_skb_around(struct sk_buff *skb,
 				 void *data, unsigned int frag_size);
 
 struct sk_buff *napi_build_skb(void *data, unsigned int frag_size);
+u32 napi_skb_cache_get_bulk(void **skbs, u32 n);
+void napi_skb_cache_put_bulk(void **skbs, u32 n);
 
 /**
  * alloc_skb - allocate a network buffer
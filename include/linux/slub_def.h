@@ -38,6 +38,8 @@ enum stat_item {
 	CPU_PARTIAL_FREE,	/* Refill cpu partial on free */
 	CPU_PARTIAL_NODE,	/* Refill cpu partial from node partial */
 	CPU_PARTIAL_DRAIN,	/* Drain cpu partial to node partial */
+	FREE_REMOTE_BATCHED,	/* Free to another slab deferred in a batch */
+	FREE_REMOTE_FLUSH,	/* Batch of deferred frees handed to its slab */
 	NR_SLUB_STAT_ITEMS };
 
 struct kmem_cache_cpu {
@@ -47,6 +49,10 @@ struct kmem_cache_cpu {
 #ifdef CONFIG_SLUB_CPU_PARTIAL
 	struct page *partial;	/* Partially allocated frozen slabs */
 #endif
+	struct page *remote_page; /* Slab of the deferred frees */
+	void *remote_head;	/* Deferred frees, linked via freepointer */
+	void *remote_tail;
+	unsigned int remote_cnt;
 #ifdef CONFIG_SLUB_STATS
 	unsigned stat[NR_SLUB_STAT_ITEMS];
 #endif
@@ -367,6 +367,9 @@ struct tcp_sock {
 
 	u32 rcv_ooopack; /* Received out-of-order packets, for tcpinfo */
 
+	u64 bytes_zc_mapped; /* Receive zerocopy bytes mapped, for tcpinfo */
+	u64 bytes_zc_copied; /* Receive zerocopy bytes copied instead */
+
 /* Receiver side RTT estimation */
 	u32 rcv_rtt_last_tsecr;
 	struct {
@@ -13,6 +13,7 @@
 #include <linux/mod_devicetable.h>
 #include <linux/tee.h>
 #include <linux/types.h>
+#include <linux/workqueue.h>
 #include <linux/uuid.h>
 
 /*
@@ -264,6 +265,27 @@ struct tee_shm_pool_mgr *tee_shm_pool_mgr_alloc_res_mem(unsigned long vaddr,
 							size_t size,
 							int min_alloc_order);
 
+/**
+ * tee_shm_pool_mgr_alloc_cached() - Create a shm manager caching freed buffers
+ * @backing:	manager that allocates, and maps into the TEE, the buffers
+ * @max_order:	largest allocation order that is kept for reuse
+ * @depth:	number of free buffers kept per order
+ *
+ * Buffers of up to @max_order freed to the returned manager stay allocated
+ * and mapped, and are handed out again by the next allocation of the same
+ * order. A recycled buffer is cleared only if it is allocated with
+ * TEE_SHM_DMA_BUF, kernel-internal users initialise their buffers anyway.
+ *
+ * The @free operation of @backing is also called for buffers that are
+ * trimmed from the cache, with only @kaddr, @paddr and @size valid in the
+ * shm passed to it. @backing is destroyed along with the returned manager.
+ *
+ * @returns pointer to a 'struct tee_shm_pool_mgr' or an ERR_PTR on failure.
+ */
+struct tee_shm_pool_mgr *
+tee_shm_pool_mgr_alloc_cached(struct tee_shm_pool_mgr *backing,
+			      unsigned int max_order, unsigned int depth);
+
 /**
  * tee_shm_pool_mgr_destroy() - Free a shared memory manager
  */
@@ -541,6 +563,58 @@ int tee_client_invoke_func(struct tee_context *ctx,
 int tee_client_cancel_req(struct tee_context *ctx,
 			  struct tee_ioctl_cancel_arg *arg);
 
+struct tee_client_async_req;
+
+/**
+ * struct tee_client_async_req - asynchronous invoke-command request
+ * @ctx:	TEE Context
+ * @arg:	Invoke arguments, see description of
+ *		struct tee_ioctl_invoke_arg
+ * @param:	Parameters passed to the Trusted Application
+ * @done:	Called in process context when the request has completed,
+ *		with the value tee_client_invoke_func() would have returned
+ * @priv:	For the submitter
+ *
+ * The request, @arg, @param and @ctx must stay valid until @done is called.
+ */
+struct tee_client_async_req {
+	struct tee_context *ctx;
+	struct tee_ioctl_invoke_arg *arg;
+	struct tee_param *param;
+	void (*done)(struct tee_client_async_req *req, int rc);
+	void *priv;
+
+	/* private: */
+	struct list_head node;
+	struct work_struct work;
+};
+
+/**
+ * tee_client_invoke_func_async() - Queue an invocation of a function in a
+ * Trusted Application
+ * @req:	Request to submit
+ *
+ * Requests are run from worker threads, at most "max_async_calls" of them
+ * at a time across all contexts and sessions, the others wait in submission
+ * order. May be called from any context.
+ *
+ * Returns < 0 if the request could not be queued, else 0 and @req->done
+ * will be called.
+ */
+int tee_client_invoke_func_async(struct tee_client_async_req *req);
+
+/**
+ * tee_client_async_cancel() - Cancel an asynchronous request
+ * @req:	Request to cancel
+ *
+ * A request that has not started yet is dropped and @req->done is not
+ * called. For a request already in the Trusted Application a cancellation
+ * is requested with @req->arg->cancel_id, and @req->done is still called.
+ *
+ * Returns true if the request was dropped before it started.
+ */
+bool tee_client_async_cancel(struct tee_client_async_req *req);
+
 static inline bool tee_param_is_memref(struct tee_param *param)
 {
 	switch (param->attr & TEE_IOCTL_PARAM_ATTR_TYPE_MASK) {
@@ -202,6 +202,7 @@ extern enum hrtimer_restart it_real_fn(struct hrtimer *);
 struct ctl_table;
 
 extern unsigned int sysctl_timer_migration;
+extern int sysctl_timer_pull_cpu;
 int timer_migration_handler(struct ctl_table *table, int write,
 			    void *buffer, size_t *lenp, loff_t *ppos);
 #endif
@@ -59,6 +59,18 @@ do { \
 struct virtio_device;
 struct virtqueue;
 
+/*
+ * Size of a packed ring in caller memory: the descriptors, then the driver
+ * event suppression area, and the device area, which only the device
+ * writes, on the next @align boundary.
+ */
+static inline size_t vring_packed_size(unsigned int num, unsigned long align)
+{
+	return ((num * sizeof(struct vring_packed_desc) +
+		 sizeof(struct vring_packed_desc_event) + align - 1) & ~(align - 1)) +
+	       sizeof(struct vring_packed_desc_event);
+}
+
 /*
  * Creates a virtqueue and allocates the descriptor ring.  If
  * may_reduce_num is set, then this may allocate a smaller ring than
@@ -88,7 +100,8 @@ struct virtqueue *__vring_new_virtqueue(unsigned int index,
 
 /*
  * Creates a virtqueue with a standard layout but a caller-allocated
- * ring.
+ * ring.  With VIRTIO_F_RING_PACKED negotiated the ring is packed, laid out
+ * as described for vring_packed_size().
  */
 struct virtqueue *vring_new_virtqueue(unsigned int index,
 				      unsigned int num,
@@ -110,5 +123,8 @@ void vring_del_virtqueue(struct virtqueue *vq);
 /* Filter out transport-specific feature bits. */
 void vring_transport_features(struct virtio_device *vdev);
 
+/* Queue index and next available index, for VIRTIO_F_NOTIFICATION_DATA. */
+u32 vring_notification_data(struct virtqueue *_vq);
+
 irqreturn_t vring_interrupt(int irq, void *_vq);
 #endif /* _LINUX_VIRTIO_RING_H */
@@ -27,6 +27,16 @@ enum vm_event_item { PGPGIN, PGPGOUT, PSWPIN, PSWPOUT,
 		FOR_ALL_ZONES(ALLOCSTALL),
 		FOR_ALL_ZONES(PGSCAN_SKIP),
 		PGFREE, PGACTIVATE, PGDEACTIVATE, PGLAZYFREE,
+		/* pcp list allocations, per NR_PCP_ORDERS order */
+		PCP_HIT_ORDER0, PCP_HIT_ORDER1, PCP_HIT_ORDER2, PCP_HIT_ORDER3,
+#ifdef CONFIG_TRANSPARENT_HUGEPAGE
+		PCP_HIT_THP,
+#endif
+		PCP_MISS_ORDER0, PCP_MISS_ORDER1, PCP_MISS_ORDER2,
+		PCP_MISS_ORDER3,
+#ifdef CONFIG_TRANSPARENT_HUGEPAGE
+		PCP_MISS_THP,
+#endif
 		PGFAULT, PGMAJFAULT,
 		PGLAZYFREED,
 		PGREFILL,
@@ -120,6 +130,11 @@ enum vm_event_item { PGPGIN, PGPGOUT, PSWPIN, PSWPOUT,
 #ifdef CONFIG_SWAP
 		SWAP_RA,
 		SWAP_RA_HIT,
+#endif
+#ifdef CONFIG_MMU
+		VMAP_PURGE,		/* lazy vmap purges, one kernel TLB flush each */
+		VMAP_PURGE_PAGES,	/* pages covered by those flushes */
+		VMAP_BLOCK_REUSE,	/* vmap blocks recycled without a new area */
 #endif
 		NR_VM_EVENT_ITEMS
 };
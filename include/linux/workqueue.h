@@ -129,6 +129,23 @@ struct rcu_work {
 	struct workqueue_struct *wq;
 };
 
+/**
+ * enum wq_affn_scope - how an unbound workqueue splits its CPUs into pods
+ *
+ * Each pod of an unbound workqueue gets its own pool, whose workers only
+ * run on that pod's CPUs, and work is queued to the pod of the issuing
+ * CPU.  %WQ_AFFN_SYSTEM has a single pod and so a single pool.
+ */
+enum wq_affn_scope {
+	WQ_AFFN_DFL,			/* use workqueue.default_affinity_scope */
+	WQ_AFFN_CPU,			/* one pod per CPU */
+	WQ_AFFN_CACHE,			/* one pod per last level cache */
+	WQ_AFFN_NUMA,			/* one pod per NUMA node */
+	WQ_AFFN_SYSTEM,			/* one pod across the whole system */
+
+	WQ_AFFN_NR_TYPES,
+};
+
 /**
  * struct workqueue_attrs - A struct for workqueue attributes.
  *
@@ -153,6 +170,14 @@ struct workqueue_attrs {
 	 * doesn't participate in pool hash calculations or equality comparisons.
 	 */
 	bool no_numa;
+
+	/**
+	 * @affn_scope: unbound CPU affinity scope
+	 *
+	 * Like ``no_numa``, only used to select pools and not a property of
+	 * a worker_pool.  Ignored while ``no_numa`` is set.
+	 */
+	enum wq_affn_scope affn_scope;
 };
 
 static inline struct delayed_work *to_delayed_work(struct work_struct *work)
@@ -667,5 +692,6 @@ int workqueue_offline_cpu(unsigned int cpu);
 
 void __init workqueue_init_early(void);
 void __init workqueue_init(void);
+void __init workqueue_init_topology(void);
 
 #endif
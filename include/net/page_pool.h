@@ -45,7 +45,10 @@
 					* Please note DMA-sync-for-CPU is still
 					* device driver responsibility
 					*/
-#define PP_FLAG_ALL		(PP_FLAG_DMA_MAP | PP_FLAG_DMA_SYNC_DEV)
+#define PP_FLAG_PAGE_FRAG	BIT(2) /* for page frag feature */
+#define PP_FLAG_ALL		(PP_FLAG_DMA_MAP |\
+				 PP_FLAG_DMA_SYNC_DEV |\
+				 PP_FLAG_PAGE_FRAG)
 
 /*
  * Fast allocation side cache array/stack
@@ -68,6 +71,21 @@ struct pp_alloc_cache {
 	void *cache[PP_ALLOC_CACHE_SIZE];
 };
 
+/*
+ * Per-CPU recycle staging cache
+ *
+ * Pages freed outside the NAPI context owning the pool (e.g. after
+ * XDP_REDIRECT or TX completion on another CPU) cannot use the alloc
+ * cache.  Rather than taking the ptr_ring producer lock for every
+ * single page, they are staged here and pushed into the ring as one
+ * batch under a single lock acquisition once the array fills up.
+ */
+#define PP_PCPU_CACHE_SIZE	16
+struct pp_pcpu_cache {
+	u32 count;
+	struct page *cache[PP_PCPU_CACHE_SIZE];
+};
+
 struct page_pool_params {
 	unsigned int	flags;
 	unsigned int	order;
@@ -79,6 +97,62 @@ struct page_pool_params {
 	unsigned int	offset;  /* DMA addr offset */
 };
 
+#ifdef CONFIG_PAGE_POOL_STATS
+struct page_pool_alloc_stats {
+	u64 fast; /* fast path allocations */
+	u64 slow; /* slow-path order 0 allocations */
+	u64 slow_high_order; /* slow-path high order allocations */
+	u64 empty; /* failed refills due to empty ptr ring, forcing
+		    * slow path allocation
+		    */
+	u64 refill; /* allocations via successful refill */
+	u64 waive;  /* failed refills due to numa zone mismatch */
+};
+
+struct page_pool_recycle_stats {
+	u64 cached;	/* recycling placed page in the cache. */
+	u64 cache_full; /* cache was full */
+	u64 staged;	/* recycling placed page in the per-CPU cache */
+	u64 ring;	/* recycling placed page back into ptr ring */
+	u64 ring_full;	/* page was released from page-pool because
+			 * PTR ring was full.
+			 */
+	u64 released_refcnt; /* page released because of elevated
+			      * refcnt
+			      */
+};
+
+/* This struct wraps the above stats structs so users of the
+ * page_pool_get_stats API can pass a single argument when requesting the
+ * stats for the page pool.
+ */
+struct page_pool_stats {
+	struct page_pool_alloc_stats alloc_stats;
+	struct page_pool_recycle_stats recycle_stats;
+};
+
+bool page_pool_get_stats(struct page_pool *pool,
+			 struct page_pool_stats *stats);
+int page_pool_ethtool_stats_get_count(void);
+u8 *page_pool_ethtool_stats_get_strings(u8 *data);
+u64 *page_pool_ethtool_stats_get(u64 *data, void *stats);
+#else
+static inline int page_pool_ethtool_stats_get_count(void)
+{
+	return 0;
+}
+
+static inline u8 *page_pool_ethtool_stats_get_strings(u8 *data)
+{
+	return data;
+}
+
+static inline u64 *page_pool_ethtool_stats_get(u64 *data, void *stats)
+{
+	return data;
+}
+#endif
+
 struct page_pool {
 	struct page_pool_params p;
 
@@ -89,6 +163,11 @@ struct page_pool {
 
 	u32 pages_state_hold_cnt;
 
+	/* Page currently being carved up by page_pool_alloc_frag() */
+	struct page *frag_page;
+	unsigned int frag_offset;
+	long frag_users;
+
 	/*
 	 * Data structure for allocation side
 	 *
@@ -104,6 +183,13 @@ struct page_pool {
 	 */
 	struct pp_alloc_cache alloc ____cacheline_aligned_in_smp;
 
+#ifdef CONFIG_PAGE_POOL_STATS
+	/* these stats are incremented while in softirq context */
+	struct page_pool_alloc_stats alloc_stats;
+	/* recycle stats are per-cpu to avoid locking */
+	struct page_pool_recycle_stats __percpu *recycle_stats;
+#endif
+
 	/* Data structure for storing recycled pages.
 	 *
 	 * Returning/freeing pages is more complicated synchronization
@@ -113,9 +199,11 @@ struct page_pool {
 	 * Use ptr_ring, as it separates consumer and producer
 	 * effeciently, it a way that doesn't bounce cache-lines.
 	 *
-	 * TODO: Implement bulk return pages into this structure.
+	 * Frees from remote CPUs are first staged in pcpu_cache and
+	 * then produced into the ring in bulk.
 	 */
 	struct ptr_ring ring;
+	struct pp_pcpu_cache __percpu *pcpu_cache;
 
 	atomic_t pages_state_release_cnt;
 
@@ -137,6 +225,18 @@ static inline struct page *page_pool_dev_alloc_pages(struct page_pool *pool)
 	return page_pool_alloc_pages(pool, gfp);
 }
 
+struct page *page_pool_alloc_frag(struct page_pool *pool, unsigned int *offset,
+				  unsigned int size, gfp_t gfp);
+
+static inline struct page *page_pool_dev_alloc_frag(struct page_pool *pool,
+						    unsigned int *offset,
+						    unsigned int size)
+{
+	gfp_t gfp = (GFP_ATOMIC | __GFP_NOWARN);
+
+	return page_pool_alloc_frag(pool, offset, size, gfp);
+}
+
 /* get the stored dma direction. A driver might decide to treat this locally and
  * avoid the extra cache line from page_pool to determine the direction
  */
@@ -211,6 +311,36 @@ static inline void page_pool_set_dma_addr(struct page *page, dma_addr_t addr)
 		page->dma_addr[1] = upper_32_bits(addr);
 }
 
+static inline void page_pool_fragment_page(struct page *page, long nr)
+{
+	atomic_long_set(&page->pp_frag_count, nr);
+}
+
+/* Drop @nr fragment references, returns the number still outstanding */
+static inline long page_pool_defrag_page(struct page *page, long nr)
+{
+	long ret;
+
+	/* If nr == pp_frag_count then we are the last user and there is
+	 * no need for an atomic operation, this covers the common case of
+	 * a page whose fragments were all returned before it is reused.
+	 */
+	if (atomic_long_read(&page->pp_frag_count) == nr)
+		return 0;
+
+	ret = atomic_long_sub_return(nr, &page->pp_frag_count);
+	WARN_ON(ret < 0);
+	return ret;
+}
+
+static inline bool page_pool_is_last_frag(struct page_pool *pool,
+					  struct page *page)
+{
+	/* If fragments aren't enabled or count is 0 we were the last user */
+	return !(pool->p.flags & PP_FLAG_PAGE_FRAG) ||
+	       (page_pool_defrag_page(page, 1) == 0);
+}
+
 static inline bool is_page_pool_compiled_in(void)
 {
 #ifdef CONFIG_PAGE_POOL
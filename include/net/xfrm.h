@@ -1695,6 +1695,7 @@ struct xfrm_algo_desc *xfrm_ealg_get_byname(const char *name, int probe);
 struct xfrm_algo_desc *xfrm_calg_get_byname(const char *name, int probe);
 struct xfrm_algo_desc *xfrm_aead_get_byname(const char *name, int icv_len,
 					    int probe);
+struct crypto_aead *xfrm_aead_alloc(const char *name);
 
 static inline bool xfrm6_addr_equal(const xfrm_address_t *a,
 				    const xfrm_address_t *b)
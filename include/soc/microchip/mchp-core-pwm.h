@@ -0,0 +1,30 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+/*
+ * Microchip FPGA corePWM
+ *
+ * Copyright (c) 2021 Microchip Corporation. All rights reserved.
+ */
+
+#ifndef __SOC_MCHP_CORE_PWM_H__
+#define __SOC_MCHP_CORE_PWM_H__
+
+#include <linux/errno.h>
+#include <linux/pwm.h>
+
+#if IS_ENABLED(CONFIG_PWM_MICROCHIP_CORE)
+
+int mchp_core_pwm_apply_multi(struct pwm_device **pwms,
+			      const struct pwm_state *states, unsigned int num);
+
+#else
+
+static inline int mchp_core_pwm_apply_multi(struct pwm_device **pwms,
+					    const struct pwm_state *states,
+					    unsigned int num)
+{
+	return -ENODEV;
+}
+
+#endif /* if IS_ENABLED(CONFIG_PWM_MICROCHIP_CORE) */
+
+#endif /* __SOC_MCHP_CORE_PWM_H__ */
@@ -0,0 +1,39 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+/*
+ * Software counters of the PolarFire SoC messaging drivers, exported as an
+ * uncore perf PMU
+ */
+#ifndef __SOC_MPFS_MSG_PMU_H__
+#define __SOC_MPFS_MSG_PMU_H__
+
+#include <linux/err.h>
+#include <linux/types.h>
+
+struct device;
+struct mpfs_msg_pmu;
+
+#if IS_REACHABLE(CONFIG_MPFS_MSG_PMU)
+
+struct mpfs_msg_pmu *devm_mpfs_msg_pmu_register(struct device *dev,
+						const char *name,
+						const char * const *events,
+						unsigned int num_events);
+void mpfs_msg_pmu_add(struct mpfs_msg_pmu *pmu, unsigned int event, u64 val);
+
+#else
+
+static inline struct mpfs_msg_pmu *
+devm_mpfs_msg_pmu_register(struct device *dev, const char *name,
+			   const char * const *events, unsigned int num_events)
+{
+	return ERR_PTR(-ENODEV);
+}
+
+static inline void mpfs_msg_pmu_add(struct mpfs_msg_pmu *pmu,
+				    unsigned int event, u64 val)
+{
+}
+
+#endif
+
+#endif /* __SOC_MPFS_MSG_PMU_H__ */
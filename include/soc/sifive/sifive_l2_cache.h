@@ -0,0 +1,38 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+/*
+ * SiFive L2 Cache Controller header file
+ *
+ */
+
+#ifndef __SOC_SIFIVE_L2_CACHE_H
+#define __SOC_SIFIVE_L2_CACHE_H
+
+#include <linux/types.h>
+
+struct notifier_block;
+
+extern int register_sifive_l2_error_notifier(struct notifier_block *nb);
+extern int unregister_sifive_l2_error_notifier(struct notifier_block *nb);
+
+#define SIFIVE_L2_ERR_TYPE_CE 0
+#define SIFIVE_L2_ERR_TYPE_UE 1
+
+#define SIFIVE_L2_ERR_BLOCK_DIR 0
+#define SIFIVE_L2_ERR_BLOCK_DATA 1
+
+/* Passed to the error notifiers, @count events on the @block array */
+struct sifive_l2_err_info {
+	const char *msg;
+	unsigned int block;
+	u32 count;
+};
+
+/* WayMask control of the L2 masters, harts and SoC bus masters alike */
+extern int sifive_l2_get_way_mask(unsigned int master, u32 *mask);
+extern int sifive_l2_set_way_mask(unsigned int master, u32 mask);
+
+/* Scratchpad memory out of the L2 ways not enabled for caching */
+extern void *sifive_l2_lim_alloc(size_t size, phys_addr_t *phys);
+extern void sifive_l2_lim_free(void *addr, size_t size);
+
+#endif /* __SOC_SIFIVE_L2_CACHE_H */
@@ -0,0 +1,50 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+#undef TRACE_SYSTEM
+#define TRACE_SYSTEM dev_probe
+
+#if !defined(_TRACE_DEV_PROBE_H) || defined(TRACE_HEADER_MULTI_READ)
+#define _TRACE_DEV_PROBE_H
+
+#include <linux/device.h>
+#include <linux/tracepoint.h>
+
+/*
+ * One event per driver probe, for a boot-time probe timeline: @start is
+ * the ktime_get() of the call in nanoseconds and @duration its length,
+ * @async whether it ran from the async probe domain.
+ */
+TRACE_EVENT(dev_probe,
+
+	TP_PROTO(struct device *dev, struct device_driver *drv, int ret,
+		 bool async, u64 start, u64 duration),
+
+	TP_ARGS(dev, drv, ret, async, start, duration),
+
+	TP_STRUCT__entry(
+		__string(dev, dev_name(dev))
+		__string(drv, drv->name)
+		__field(int, ret)
+		__field(bool, async)
+		__field(u64, start)
+		__field(u64, duration)
+	),
+
+	TP_fast_assign(
+		__assign_str(dev, dev_name(dev));
+		__assign_str(drv, drv->name);
+		__entry->ret = ret;
+		__entry->async = async;
+		__entry->start = start;
+		__entry->duration = duration;
+	),
+
+	TP_printk("%s driver=%s ret=%d %s start=%llu duration=%llu",
+		__get_str(dev), __get_str(drv), __entry->ret,
+		__entry->async ? "async" : "sync",
+		__entry->start, __entry->duration)
+);
+
+#endif /* _TRACE_DEV_PROBE_H */
+
+/* This part must be outside protection */
+#include <trace/define_trace.h>
@@ -110,6 +110,47 @@ TRACE_EVENT(file_check_and_advance_wb_err,
 			MINOR(__entry->s_dev), __entry->i_ino, __entry->old,
 			__entry->new)
 );
+
+TRACE_EVENT(mm_filemap_readahead,
+		TP_PROTO(struct address_space *mapping, pgoff_t index,
+			 unsigned long req_size, struct file_ra_state *ra,
+			 const char *pattern, unsigned long wasted),
+
+		TP_ARGS(mapping, index, req_size, ra, pattern, wasted),
+
+		TP_STRUCT__entry(
+			__field(unsigned long, i_ino)
+			__field(dev_t, s_dev)
+			__field(unsigned long, index)
+			__field(unsigned long, req_size)
+			__field(unsigned long, start)
+			__field(unsigned int, size)
+			__field(unsigned int, async_size)
+			__field(const char *, pattern)
+			__field(unsigned long, wasted)
+		),
+
+		TP_fast_assign(
+			__entry->i_ino = mapping->host->i_ino;
+			if (mapping->host->i_sb)
+				__entry->s_dev = mapping->host->i_sb->s_dev;
+			else
+				__entry->s_dev = mapping->host->i_rdev;
+			__entry->index = index;
+			__entry->req_size = req_size;
+			__entry->start = ra->start;
+			__entry->size = ra->size;
+			__entry->async_size = ra->async_size;
+			__entry->pattern = pattern;
+			__entry->wasted = wasted;
+		),
+
+		TP_printk("dev=%d:%d ino=0x%lx index=%lu req=%lu %s start=%lu size=%u async=%u wasted=%lu",
+			MAJOR(__entry->s_dev), MINOR(__entry->s_dev),
+			__entry->i_ino, __entry->index, __entry->req_size,
+			__entry->pattern, __entry->start, __entry->size,
+			__entry->async_size, __entry->wasted)
+);
 #endif /* _TRACE_FILEMAP_H */
 
 /* This part must be outside protection */
@@ -0,0 +1,80 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+#undef TRACE_SYSTEM
+#define TRACE_SYSTEM overlayfs
+
+#if !defined(_TRACE_OVERLAYFS_H) || defined(TRACE_HEADER_MULTI_READ)
+#define _TRACE_OVERLAYFS_H
+
+#include <linux/types.h>
+#include <linux/tracepoint.h>
+
+/*
+ * Copy-up events, for measuring how long the first modification of a lower
+ * file stalls its caller.  Durations are in nanoseconds.
+ */
+TRACE_EVENT(ovl_copy_up_data,
+
+	TP_PROTO(unsigned long ino, loff_t len, bool cloned, int err,
+		 u64 duration),
+
+	TP_ARGS(ino, len, cloned, err, duration),
+
+	TP_STRUCT__entry(
+		__field(unsigned long, ino)
+		__field(loff_t, len)
+		__field(bool, cloned)
+		__field(int, err)
+		__field(u64, duration)
+	),
+
+	TP_fast_assign(
+		__entry->ino = ino;
+		__entry->len = len;
+		__entry->cloned = cloned;
+		__entry->err = err;
+		__entry->duration = duration;
+	),
+
+	TP_printk("ino=%lu len=%lld %s err=%d duration=%llu",
+		__entry->ino, __entry->len,
+		__entry->cloned ? "cloned" : "copied",
+		__entry->err, __entry->duration)
+);
+
+TRACE_EVENT(ovl_copy_up,
+
+	TP_PROTO(unsigned long ino, umode_t mode, loff_t size, bool metacopy,
+		 int flags, int err, u64 duration),
+
+	TP_ARGS(ino, mode, size, metacopy, flags, err, duration),
+
+	TP_STRUCT__entry(
+		__field(unsigned long, ino)
+		__field(umode_t, mode)
+		__field(loff_t, size)
+		__field(bool, metacopy)
+		__field(int, flags)
+		__field(int, err)
+		__field(u64, duration)
+	),
+
+	TP_fast_assign(
+		__entry->ino = ino;
+		__entry->mode = mode;
+		__entry->size = size;
+		__entry->metacopy = metacopy;
+		__entry->flags = flags;
+		__entry->err = err;
+		__entry->duration = duration;
+	),
+
+	TP_printk("ino=%lu mode=0%o size=%lld %s flags=0%o err=%d duration=%llu",
+		__entry->ino, __entry->mode, __entry->size,
+		__entry->metacopy ? "metacopy" : "full",
+		__entry->flags, __entry->err, __entry->duration)
+);
+
+#endif /* _TRACE_OVERLAYFS_H */
+
+/* This part must be outside protection */
+#include <trace/define_trace.h>
@@ -486,6 +486,37 @@ DEFINE_EVENT_SCHEDSTAT(sched_stat_template, sched_stat_blocked,
 	     TP_PROTO(struct task_struct *tsk, u64 delay),
 	     TP_ARGS(tsk, delay));
 
+/*
+ * Tracepoint for the time an RT task spends between its wakeup and getting
+ * on a CPU, including any push or pull on the way.
+ */
+TRACE_EVENT(sched_rt_wakeup_latency,
+
+	TP_PROTO(struct task_struct *tsk, u64 delay),
+
+	TP_ARGS(__perf_task(tsk), __perf_count(delay)),
+
+	TP_STRUCT__entry(
+		__array( char,	comm,	TASK_COMM_LEN	)
+		__field( pid_t,	pid			)
+		__field( int,	prio			)
+		__field( int,	cpu			)
+		__field( u64,	delay			)
+	),
+
+	TP_fast_assign(
+		memcpy(__entry->comm, tsk->comm, TASK_COMM_LEN);
+		__entry->pid	= tsk->pid;
+		__entry->prio	= tsk->prio;
+		__entry->cpu	= task_cpu(tsk);
+		__entry->delay	= delay;
+	),
+
+	TP_printk("comm=%s pid=%d prio=%d cpu=%03d delay=%Lu [ns]",
+			__entry->comm, __entry->pid, __entry->prio,
+			__entry->cpu, (unsigned long long)__entry->delay)
+);
+
 /*
  * Tracepoint for accounting runtime (time the task is executing
  * on a CPU).
@@ -0,0 +1,108 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+#undef TRACE_SYSTEM
+#define TRACE_SYSTEM ubi
+
+#if !defined(_TRACE_UBI_H) || defined(TRACE_HEADER_MULTI_READ)
+#define _TRACE_UBI_H
+
+#include <linux/types.h>
+#include <linux/tracepoint.h>
+
+/*
+ * Attach-time events, for budgeting how long attaching a UBI device takes
+ * and where that time goes.  Durations are in nanoseconds.
+ */
+TRACE_EVENT(ubi_attach_scan,
+
+	TP_PROTO(int ubi_num, int start, int end, bool fast, int err,
+		 u64 duration),
+
+	TP_ARGS(ubi_num, start, end, fast, err, duration),
+
+	TP_STRUCT__entry(
+		__field(int, ubi_num)
+		__field(int, start)
+		__field(int, end)
+		__field(bool, fast)
+		__field(int, err)
+		__field(u64, duration)
+	),
+
+	TP_fast_assign(
+		__entry->ubi_num = ubi_num;
+		__entry->start = start;
+		__entry->end = end;
+		__entry->fast = fast;
+		__entry->err = err;
+		__entry->duration = duration;
+	),
+
+	TP_printk("ubi%d PEBs %d-%d %s err=%d duration=%llu",
+		__entry->ubi_num, __entry->start, __entry->end - 1,
+		__entry->fast ? "fastmap-scan" : "full-scan",
+		__entry->err, __entry->duration)
+);
+
+TRACE_EVENT(ubi_attach_step,
+
+	TP_PROTO(int ubi_num, const char *step, int err, u64 duration),
+
+	TP_ARGS(ubi_num, step, err, duration),
+
+	TP_STRUCT__entry(
+		__field(int, ubi_num)
+		__string(step, step)
+		__field(int, err)
+		__field(u64, duration)
+	),
+
+	TP_fast_assign(
+		__entry->ubi_num = ubi_num;
+		__assign_str(step, step);
+		__entry->err = err;
+		__entry->duration = duration;
+	),
+
+	TP_printk("ubi%d %s err=%d duration=%llu",
+		__entry->ubi_num, __get_str(step), __entry->err,
+		__entry->duration)
+);
+
+TRACE_EVENT(ubi_attach_done,
+
+	TP_PROTO(int ubi_num, bool fastmap, int peb_count, int bad_peb_count,
+		 int corr_peb_count, int err, u64 duration),
+
+	TP_ARGS(ubi_num, fastmap, peb_count, bad_peb_count, corr_peb_count,
+		err, duration),
+
+	TP_STRUCT__entry(
+		__field(int, ubi_num)
+		__field(bool, fastmap)
+		__field(int, peb_count)
+		__field(int, bad_peb_count)
+		__field(int, corr_peb_count)
+		__field(int, err)
+		__field(u64, duration)
+	),
+
+	TP_fast_assign(
+		__entry->ubi_num = ubi_num;
+		__entry->fastmap = fastmap;
+		__entry->peb_count = peb_count;
+		__entry->bad_peb_count = bad_peb_count;
+		__entry->corr_peb_count = corr_peb_count;
+		__entry->err = err;
+		__entry->duration = duration;
+	),
+
+	TP_printk("ubi%d via %s pebs=%d bad=%d corrupted=%d err=%d duration=%llu",
+		__entry->ubi_num, __entry->fastmap ? "fastmap" : "scan",
+		__entry->peb_count, __entry->bad_peb_count,
+		__entry->corr_peb_count, __entry->err, __entry->duration)
+);
+
+#endif /* _TRACE_UBI_H */
+
+/* This part must be outside protection */
+#include <trace/define_trace.h>
@@ -77,6 +77,39 @@ TRACE_EVENT(wbt_lat,
 			(unsigned long long) __entry->lat)
 );
 
+/**
+ * wbt_learn - trace the learned latency target of a window
+ * @tail: the read latency percentile held under the target
+ * @baseline: the learned baseline read latency
+ * @target: the resulting latency target
+ */
+TRACE_EVENT(wbt_learn,
+
+	TP_PROTO(struct backing_dev_info *bdi, u64 tail, u64 baseline,
+		 u64 target),
+
+	TP_ARGS(bdi, tail, baseline, target),
+
+	TP_STRUCT__entry(
+		__array(char, name, 32)
+		__field(u64, tail)
+		__field(u64, baseline)
+		__field(u64, target)
+	),
+
+	TP_fast_assign(
+		strlcpy(__entry->name, bdi_dev_name(bdi),
+			ARRAY_SIZE(__entry->name));
+		__entry->tail		= div_u64(tail, 1000);
+		__entry->baseline	= div_u64(baseline, 1000);
+		__entry->target		= div_u64(target, 1000);
+	),
+
+	TP_printk("%s: tail=%lluus, baseline=%lluus, target=%lluus",
+		  __entry->name, __entry->tail, __entry->baseline,
+		  __entry->target)
+);
+
 /**
  * wbt_step - trace wb event step
  * @msg: context message
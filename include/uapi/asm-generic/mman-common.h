@@ -72,6 +72,8 @@
 #define MADV_COLD	20		/* deactivate these pages */
 #define MADV_PAGEOUT	21		/* reclaim these pages */
 
+#define MADV_COLLAPSE	25		/* ask khugepaged to collapse soon */
+
 /* compatibility flags */
 #define MAP_FILE	0
 
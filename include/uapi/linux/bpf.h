@@ -4206,6 +4206,13 @@ enum {
 
 /* BPF_FUNC_bpf_ringbuf_commit, BPF_FUNC_bpf_ringbuf_discard, and
  * BPF_FUNC_bpf_ringbuf_output flags.
+ *
+ * With neither flag, the consumer is notified when the submitted record is
+ * the one it is waiting for.  A BPF_MAP_TYPE_RINGBUF created with a non-zero
+ * value_size uses it as a wakeup watermark instead: the consumer is notified
+ * once at least that many bytes are waiting, and at most once per consumer
+ * position.  Data below the watermark is only seen by a consumer that polls
+ * with a timeout, or after a BPF_RB_FORCE_WAKEUP.
  */
 enum {
 	BPF_RB_NO_WAKEUP		= (1ULL << 0),
@@ -4492,6 +4499,7 @@ struct bpf_cpumap_val {
 		int   fd;	/* prog fd on map write */
 		__u32 id;	/* prog id on map read */
 	} bpf_prog;
+	__u32 bulk_size; /* frames per enqueue to remote CPU, 0 = default */
 };
 
 enum sk_action {
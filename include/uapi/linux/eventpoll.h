@@ -18,6 +18,7 @@
 /* For O_CLOEXEC */
 #include <linux/fcntl.h>
 #include <linux/types.h>
+#include <linux/ioctl.h>
 
 /* Flags for epoll_create1.  */
 #define EPOLL_CLOEXEC O_CLOEXEC
@@ -79,6 +80,20 @@ struct epoll_event {
 	__u64 data;
 } EPOLL_PACKED;
 
+/*
+ * Wakeup batching for an epoll instance: once events are ready, epoll_wait()
+ * waits up to max_wait_usecs (bounded by its own timeout) for min_events of
+ * them before returning. A max_wait_usecs of 0 disables batching.
+ */
+struct epoll_batch_params {
+	__u32 min_events;
+	__u32 max_wait_usecs;
+};
+
+#define EPOLL_IOC_TYPE		0x8A
+#define EPIOCSBATCH		_IOW(EPOLL_IOC_TYPE, 0x01, struct epoll_batch_params)
+#define EPIOCGBATCH		_IOR(EPOLL_IOC_TYPE, 0x02, struct epoll_batch_params)
+
 #ifdef CONFIG_PM_SLEEP
 static inline void ep_take_care_of_epollwakeup(struct epoll_event *epev)
 {
@@ -55,6 +55,13 @@
 #define F_GET_FILE_RW_HINT	(F_LINUX_SPECIFIC_BASE + 13)
 #define F_SET_FILE_RW_HINT	(F_LINUX_SPECIFIC_BASE + 14)
 
+/*
+ * Set/Get the amount of data a pipe has to hold before its readers are
+ * woken up
+ */
+#define F_SETPIPE_LOWAT		(F_LINUX_SPECIFIC_BASE + 15)
+#define F_GETPIPE_LOWAT		(F_LINUX_SPECIFIC_BASE + 16)
+
 /*
  * Valid hint values for F_{GET,SET}_RW_HINT. 0 is "not set", or can be
  * used to clear any hints previously set.
@@ -98,6 +98,7 @@ enum {
 #define IORING_SETUP_CLAMP	(1U << 4)	/* clamp SQ/CQ ring sizes */
 #define IORING_SETUP_ATTACH_WQ	(1U << 5)	/* attach to existing wq */
 #define IORING_SETUP_R_DISABLED	(1U << 6)	/* start with ring disabled */
+#define IORING_SETUP_SQ_ADAPTIVE_IDLE (1U << 7)	/* sq_thread_idle is an upper bound */
 
 enum {
 	IORING_OP_NOP,
@@ -137,6 +138,7 @@ enum {
 	IORING_OP_SHUTDOWN,
 	IORING_OP_RENAMEAT,
 	IORING_OP_UNLINKAT,
+	IORING_OP_SEND_ZC,
 
 	/* this goes last, obviously */
 	IORING_OP_LAST,
@@ -159,6 +161,28 @@ enum {
  */
 #define SPLICE_F_FD_IN_FIXED	(1U << 31) /* the last bit of __u32 */
 
+/*
+ * accept flags stored in sqe->ioprio
+ *
+ * IORING_ACCEPT_MULTISHOT	Post a CQE for every accepted connection
+ *				until the request fails or is canceled.
+ *				The request may also complete after a
+ *				bounded number of connections; a CQE
+ *				without IORING_CQE_F_MORE ends it.
+ */
+#define IORING_ACCEPT_MULTISHOT	(1U << 0)
+
+/*
+ * recv flags stored in sqe->ioprio
+ *
+ * IORING_RECV_MULTISHOT	Post a CQE for every received chunk until
+ *				the request fails, hits EOF or is canceled.
+ *				Like IORING_ACCEPT_MULTISHOT it may also
+ *				complete after a bounded number of chunks.
+ *				Requires IOSQE_BUFFER_SELECT.
+ */
+#define IORING_RECV_MULTISHOT	(1U << 1)
+
 /*
  * IO completion data structure (Completion Queue Entry)
  */
@@ -172,8 +196,15 @@ struct io_uring_cqe {
  * cqe->flags
  *
  * IORING_CQE_F_BUFFER	If set, the upper 16 bits are the buffer ID
+ * IORING_CQE_F_MORE	If set, parent SQE will generate more CQE entries
+ * IORING_CQE_F_NOTIF	Notification for IORING_OP_SEND_ZC: the registered
+ *			buffer may be reused. res is 0 if the send result was
+ *			posted before with IORING_CQE_F_MORE, and carries the
+ *			result otherwise.
  */
 #define IORING_CQE_F_BUFFER		(1U << 0)
+#define IORING_CQE_F_MORE		(1U << 1)
+#define IORING_CQE_F_NOTIF		(1U << 2)
 
 enum {
 	IORING_CQE_BUFFER_SHIFT		= 16,
@@ -281,6 +312,9 @@ enum {
 	IORING_UNREGISTER_PERSONALITY		= 10,
 	IORING_REGISTER_RESTRICTIONS		= 11,
 	IORING_REGISTER_ENABLE_RINGS		= 12,
+	IORING_REGISTER_PBUF_RING		= 13,
+	IORING_UNREGISTER_PBUF_RING		= 14,
+	IORING_REGISTER_IOWQ_MAX_WORKERS	= 15,
 
 	/* this goes last */
 	IORING_REGISTER_LAST
@@ -302,6 +336,39 @@ struct io_uring_rsrc_update {
 /* Skip updating fd indexes set to this value in the fd table */
 #define IORING_REGISTER_FILES_SKIP	(-2)
 
+/*
+ * Provided buffer ring, an alternative to IORING_OP_PROVIDE_BUFFERS: the
+ * application fills bufs[] and publishes them by advancing tail, and the
+ * kernel consumes them from its own head.  tail overlays bufs[0].resv.
+ */
+struct io_uring_buf {
+	__u64	addr;
+	__u32	len;
+	__u16	bid;
+	__u16	resv;
+};
+
+struct io_uring_buf_ring {
+	union {
+		struct {
+			__u64	resv1;
+			__u32	resv2;
+			__u16	resv3;
+			__u16	tail;
+		};
+		struct io_uring_buf	bufs[0];
+	};
+};
+
+/* argument for IORING_(UN)REGISTER_PBUF_RING */
+struct io_uring_buf_reg {
+	__u64	ring_addr;
+	__u32	ring_entries;
+	__u16	bgid;
+	__u16	pad;
+	__u64	resv[3];
+};
+
 #define IO_URING_OP_SUPPORTED	(1U << 0)
 
 struct io_uring_probe_op {
@@ -24,4 +24,80 @@ struct rpmsg_endpoint_info {
 #define RPMSG_CREATE_EPT_IOCTL	_IOW(0xb5, 0x1, struct rpmsg_endpoint_info)
 #define RPMSG_DESTROY_EPT_IOCTL	_IO(0xb5, 0x2)
 
+/**
+ * struct rpmsg_msg - one message of a batch
+ * @buf: user address of the message payload
+ * @len: payload length; updated with the received length on receive
+ * @reserved: must be zero
+ */
+struct rpmsg_msg {
+	__u64 buf;
+	__u32 len;
+	__u32 reserved;
+};
+
+/**
+ * struct rpmsg_msg_batch - batched send or receive request
+ * @msgs: user address of an array of struct rpmsg_msg
+ * @count: number of entries in @msgs, at most RPMSG_BATCH_MAX
+ * @reserved: must be zero
+ *
+ * The ioctls return the number of messages transferred. A receive blocks
+ * until at least one message is available, unless the file is O_NONBLOCK,
+ * and then drains as many queued messages as fit in @msgs.
+ */
+struct rpmsg_msg_batch {
+	__u64 msgs;
+	__u32 count;
+	__u32 reserved;
+};
+
+#define RPMSG_BATCH_MAX		1024
+
+#define RPMSG_RECV_BATCH_IOCTL	_IOW(0xb5, 0x8, struct rpmsg_msg_batch)
+#define RPMSG_SEND_BATCH_IOCTL	_IOW(0xb5, 0x9, struct rpmsg_msg_batch)
+
+/*
+ * Receive ring, set up by mmap() of an endpoint device at offset 0. The
+ * mapping is one page holding struct rpmsg_ring_hdr followed by a power of
+ * two number of RPMSG_RING_SLOT_SIZE slots. While the ring is mapped every
+ * incoming message is copied into the next slot instead of being queued
+ * for read(), and readers are woken through poll().
+ *
+ * The kernel produces at @head, userspace consumes at @tail; both are free
+ * running and index the slots modulo @nr_slots. Userspace must read a slot
+ * only after loading @head with acquire semantics and must publish @tail
+ * with release semantics once it is done with the slot. Messages arriving
+ * while the ring is full, or larger than a slot, are dropped and counted.
+ */
+#define RPMSG_RING_SLOT_SIZE	512
+
+/**
+ * struct rpmsg_ring_hdr - receive ring control page
+ * @head: next slot written by the kernel
+ * @tail: next slot read by userspace
+ * @nr_slots: number of slots, a power of two
+ * @slot_size: size of a slot, RPMSG_RING_SLOT_SIZE
+ * @dropped: messages lost because the ring was full or they did not fit
+ */
+struct rpmsg_ring_hdr {
+	__u32 head;
+	__u32 tail;
+	__u32 nr_slots;
+	__u32 slot_size;
+	__u32 dropped;
+};
+
+/**
+ * struct rpmsg_ring_slot - receive ring entry
+ * @len: payload length
+ * @src: address of the remote endpoint that sent the message
+ * @data: payload
+ */
+struct rpmsg_ring_slot {
+	__u32 len;
+	__u32 src;
+	__u8 data[];
+};
+
 #endif
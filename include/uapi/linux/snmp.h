@@ -160,6 +160,8 @@ enum
 	UDP_MIB_CSUMERRORS,			/* InCsumErrors */
 	UDP_MIB_IGNOREDMULTI,			/* IgnoredMulti */
 	UDP_MIB_MEMERRORS,			/* MemErrors */
+	UDP_MIB_FLOWCACHEHITS,			/* FlowCacheHits */
+	UDP_MIB_FLOWCACHEMISSES,		/* FlowCacheMisses */
 	__UDP_MIB_MAX
 };
 
@@ -284,6 +284,9 @@ struct tcp_info {
 	__u32	tcpi_snd_wnd;	     /* peer's advertised receive window after
 				      * scaling (bytes)
 				      */
+
+	__u64	tcpi_rcv_zc_mapped;  /* TCP_ZEROCOPY_RECEIVE bytes mapped */
+	__u64	tcpi_rcv_zc_copied;  /* TCP_ZEROCOPY_RECEIVE bytes copied */
 };
 
 /* netlink attributes types for SCM_TIMESTAMPING_OPT_STATS */
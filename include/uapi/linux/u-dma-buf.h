@@ -0,0 +1,37 @@
+/* SPDX-License-Identifier: GPL-2.0 WITH Linux-syscall-note */
+#ifndef _UAPI_LINUX_U_DMA_BUF_H
+#define _UAPI_LINUX_U_DMA_BUF_H
+
+#include <linux/types.h>
+#include <linux/ioctl.h>
+
+/**
+ * struct u_dma_buf_sync_args - range of a u-dma-buf to sync
+ * @offset:	start of the range, from the start of the buffer
+ * @size:	length of the range in bytes
+ * @direction:	0 bidirectional, 1 to device, 2 from device, as the
+ *		sync_direction sysfs attribute
+ * @reserved:	must be zero
+ */
+struct u_dma_buf_sync_args {
+	__u64 offset;
+	__u64 size;
+	__u32 direction;
+	__u32 reserved;
+};
+
+/**
+ * struct u_dma_buf_export_args - export a u-dma-buf as a dma-buf
+ * @fd_flags:	O_CLOEXEC and access mode of the new file descriptor
+ * @fd:		returned dma-buf file descriptor
+ */
+struct u_dma_buf_export_args {
+	__u32 fd_flags;
+	__s32 fd;
+};
+
+#define U_DMA_BUF_IOCTL_SYNC_FOR_CPU	_IOW('U', 0x10, struct u_dma_buf_sync_args)
+#define U_DMA_BUF_IOCTL_SYNC_FOR_DEVICE	_IOW('U', 0x11, struct u_dma_buf_sync_args)
+#define U_DMA_BUF_IOCTL_EXPORT		_IOWR('U', 0x12, struct u_dma_buf_export_args)
+
+#endif /* _UAPI_LINUX_U_DMA_BUF_H */
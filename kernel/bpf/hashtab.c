@@ -1196,6 +1196,7 @@ static int __htab_lru_percpu_map_update_elem(struct bpf_map *map, void *key,
 	unsigned long flags;
 	struct bucket *b;
 	u32 key_size, hash;
+	bool prealloc;
 	int ret;
 
 	if (unlikely(map_flags > BPF_EXIST))
@@ -1215,8 +1216,16 @@ static int __htab_lru_percpu_map_update_elem(struct bpf_map *map, void *key,
 	 * spinlock because LRU's elem alloc may need
 	 * to remove older elem from htab and this removal
 	 * operation will need a bucket lock.
+	 *
+	 * A key that is already present is updated in place, so skip
+	 * the LRU list round trip for it.  Should the element vanish
+	 * before the bucket lock is taken, come back for a free one.
 	 */
-	if (map_flags != BPF_EXIST) {
+	prealloc = map_flags != BPF_EXIST &&
+		   !lookup_nulls_elem_raw(head, hash, key, key_size,
+					  htab->n_buckets);
+again:
+	if (prealloc) {
 		l_new = prealloc_lru_pop(htab, key, hash);
 		if (!l_new)
 			return -ENOMEM;
@@ -1228,6 +1237,12 @@ static int __htab_lru_percpu_map_update_elem(struct bpf_map *map, void *key,
 
 	l_old = lookup_elem_raw(head, hash, key, key_size);
 
+	if (!l_old && !l_new && map_flags != BPF_EXIST) {
+		htab_unlock_bucket(htab, b, hash, flags);
+		prealloc = true;
+		goto again;
+	}
+
 	ret = check_flags(htab, l_old, map_flags);
 	if (ret)
 		goto err;
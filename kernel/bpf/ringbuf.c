@@ -36,6 +36,10 @@ struct bpf_ringbuf {
 	u64 mask;
 	struct page **pages;
 	int nr_pages;
+	/* notify once this many bytes are waiting, 0 to notify on catch-up */
+	u32 wakeup_watermark;
+	/* consumer position the last watermark notification was sent for */
+	unsigned long wakeup_cons_pos;
 	spinlock_t spinlock ____cacheline_aligned_in_smp;
 	/* Consumer and producer counters are put into separate pages to allow
 	 * mapping consumer page as r/w, but restrict producer page to r/o.
@@ -152,11 +156,14 @@ static struct bpf_map *ringbuf_map_alloc(union bpf_attr *attr)
 	if (attr->map_flags & ~RINGBUF_CREATE_FLAG_MASK)
 		return ERR_PTR(-EINVAL);
 
-	if (attr->key_size || attr->value_size ||
-	    !is_power_of_2(attr->max_entries) ||
+	if (attr->key_size || !is_power_of_2(attr->max_entries) ||
 	    !PAGE_ALIGNED(attr->max_entries))
 		return ERR_PTR(-EINVAL);
 
+	/* value_size is the wakeup watermark, it must be reachable */
+	if (attr->value_size >= attr->max_entries)
+		return ERR_PTR(-EINVAL);
+
 #ifdef CONFIG_64BIT
 	/* on 32-bit arch, it's impossible to overflow record's hdr->pgoff */
 	if (attr->max_entries > RINGBUF_MAX_DATA_SZ)
@@ -174,6 +181,8 @@ static struct bpf_map *ringbuf_map_alloc(union bpf_attr *attr)
 		kfree(rb_map);
 		return ERR_PTR(-ENOMEM);
 	}
+	rb_map->rb->wakeup_watermark = attr->value_size;
+	rb_map->rb->wakeup_cons_pos = ULONG_MAX;
 
 	return &rb_map->map;
 }
@@ -367,6 +376,25 @@ const struct bpf_func_proto bpf_ringbuf_reserve_proto = {
 	.arg3_type	= ARG_ANYTHING,
 };
 
+/* Watermark wakeup: once enough data is waiting, notify once per consumer
+ * position, so a consumer that is behind is not woken for every record.
+ */
+static bool bpf_ringbuf_watermark_reached(struct bpf_ringbuf *rb)
+{
+	unsigned long cons_pos, prod_pos;
+
+	cons_pos = smp_load_acquire(&rb->consumer_pos);
+	prod_pos = smp_load_acquire(&rb->producer_pos);
+	if (prod_pos - cons_pos < rb->wakeup_watermark)
+		return false;
+
+	if (READ_ONCE(rb->wakeup_cons_pos) == cons_pos)
+		return false;
+
+	WRITE_ONCE(rb->wakeup_cons_pos, cons_pos);
+	return true;
+}
+
 static void bpf_ringbuf_commit(void *sample, u64 flags, bool discard)
 {
 	unsigned long rec_pos, cons_pos;
@@ -391,8 +419,14 @@ static void bpf_ringbuf_commit(void *sample, u64 flags, bool discard)
 
 	if (flags & BPF_RB_FORCE_WAKEUP)
 		irq_work_queue(&rb->work);
-	else if (cons_pos == rec_pos && !(flags & BPF_RB_NO_WAKEUP))
+	else if (flags & BPF_RB_NO_WAKEUP)
+		return;
+	else if (rb->wakeup_watermark) {
+		if (bpf_ringbuf_watermark_reached(rb))
+			irq_work_queue(&rb->work);
+	} else if (cons_pos == rec_pos) {
 		irq_work_queue(&rb->work);
+	}
 }
 
 BPF_CALL_2(bpf_ringbuf_submit, void *, sample, u64, flags)
@@ -223,16 +223,19 @@ int padata_do_parallel(struct padata_shell *ps,
 	rcu_read_unlock_bh();
 
 	if (pw) {
+		atomic_long_inc(&pinst->nr_parallel);
 		padata_work_init(pw, padata_parallel_worker, padata, 0);
 		queue_work(pinst->parallel_wq, &pw->pw_work);
 	} else {
 		/* Maximum works limit exceeded, run in the current task. */
+		atomic_long_inc(&pinst->nr_inline);
 		padata->parallel(padata);
 	}
 
 	return 0;
 out:
 	rcu_read_unlock_bh();
+	atomic_long_inc(&pinst->nr_rejected);
 
 	return err;
 }
@@ -356,6 +359,7 @@ static void invoke_padata_reorder(struct work_struct *work)
 static void padata_serial_worker(struct work_struct *serial_work)
 {
 	struct padata_serial_queue *squeue;
+	struct padata_instance *pinst;
 	struct parallel_data *pd;
 	LIST_HEAD(local_list);
 	int cnt;
@@ -363,6 +367,8 @@ static void padata_serial_worker(struct work_struct *serial_work)
 	local_bh_disable();
 	squeue = container_of(serial_work, struct padata_serial_queue, work);
 	pd = squeue->pd;
+	/* the shell may be gone once the last callback has run */
+	pinst = pd->ps->pinst;
 
 	spin_lock(&squeue->serial.lock);
 	list_replace_init(&squeue->serial.list, &local_list);
@@ -383,6 +389,8 @@ static void padata_serial_worker(struct work_struct *serial_work)
 	}
 	local_bh_enable();
 
+	atomic_long_add(cnt, &pinst->nr_serial);
+
 	if (atomic_sub_and_test(cnt, &pd->refcnt))
 		padata_free_pd(pd);
 }
@@ -910,6 +918,23 @@ static ssize_t store_cpumask(struct padata_instance *pinst,
 	return ret;
 }
 
+static ssize_t show_stat(struct padata_instance *pinst,
+			 struct attribute *attr, char *buf)
+{
+	atomic_long_t *stat;
+
+	if (!strcmp(attr->name, "parallel_queued"))
+		stat = &pinst->nr_parallel;
+	else if (!strcmp(attr->name, "parallel_direct"))
+		stat = &pinst->nr_inline;
+	else if (!strcmp(attr->name, "rejected"))
+		stat = &pinst->nr_rejected;
+	else
+		stat = &pinst->nr_serial;
+
+	return sysfs_emit(buf, "%ld\n", atomic_long_read(stat));
+}
+
 #define PADATA_ATTR_RW(_name, _show_name, _store_name)		\
 	static struct padata_sysfs_entry _name##_attr =		\
 		__ATTR(_name, 0644, _show_name, _store_name)
@@ -919,15 +944,27 @@ static ssize_t store_cpumask(struct padata_instance *pinst,
 
 PADATA_ATTR_RW(serial_cpumask, show_cpumask, store_cpumask);
 PADATA_ATTR_RW(parallel_cpumask, show_cpumask, store_cpumask);
+PADATA_ATTR_RO(parallel_queued, show_stat);
+PADATA_ATTR_RO(parallel_direct, show_stat);
+PADATA_ATTR_RO(rejected, show_stat);
+PADATA_ATTR_RO(serialized, show_stat);
 
 /*
  * Padata sysfs provides the following objects:
  * serial_cpumask   [RW] - cpumask for serial workers
  * parallel_cpumask [RW] - cpumask for parallel workers
+ * parallel_queued  [RO] - objects handed to a parallel worker
+ * parallel_direct  [RO] - objects run by the submitter, out of works
+ * rejected         [RO] - objects refused, e.g. during a cpumask change
+ * serialized       [RO] - objects that went through their serial callback
  */
 static struct attribute *padata_default_attrs[] = {
 	&serial_cpumask_attr.attr,
 	&parallel_cpumask_attr.attr,
+	&parallel_queued_attr.attr,
+	&parallel_direct_attr.attr,
+	&rejected_attr.attr,
+	&serialized_attr.attr,
 	NULL,
 };
 ATTRIBUTE_GROUPS(padata_default);
@@ -1102,12 +1139,16 @@ EXPORT_SYMBOL(padata_alloc_shell);
  */
 void padata_free_shell(struct padata_shell *ps)
 {
+	struct parallel_data *pd;
+
 	if (!ps)
 		return;
 
 	mutex_lock(&ps->pinst->lock);
 	list_del(&ps->list);
-	padata_free_pd(rcu_dereference_protected(ps->pd, 1));
+	pd = rcu_dereference_protected(ps->pd, 1);
+	if (atomic_dec_and_test(&pd->refcnt))
+		padata_free_pd(pd);
 	mutex_unlock(&ps->pinst->lock);
 
 	kfree(ps);
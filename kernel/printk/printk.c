@@ -47,6 +47,9 @@
 #include <linux/sched/clock.h>
 #include <linux/sched/debug.h>
 #include <linux/sched/task_stack.h>
+#include <linux/kthread.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
 
 #include <linux/uaccess.h>
 #include <asm/sections.h>
@@ -1827,6 +1830,22 @@ static int console_trylock_spinning(void)
 	return 1;
 }
 
+static void console_write_timed(struct console *con, const char *text,
+				size_t len)
+{
+	u64 start = local_clock();
+	u64 delta;
+
+	con->write(con, text, len);
+
+	delta = local_clock() - start;
+	con->nr_writes++;
+	con->write_bytes += len;
+	con->write_ns += delta;
+	if (delta > con->max_write_ns)
+		con->max_write_ns = delta;
+}
+
 /*
  * Call the console drivers, asking them to write out
  * log_buf[start] to log_buf[end - 1].
@@ -1862,11 +1881,12 @@ static void call_console_drivers(const char *ext_text, size_t ext_len,
 		    !(con->flags & CON_ANYTIME))
 			continue;
 		if (con->flags & CON_EXTENDED)
-			con->write(con, ext_text, ext_len);
+			console_write_timed(con, ext_text, ext_len);
 		else {
 			if (dropped_len)
-				con->write(con, dropped_text, dropped_len);
-			con->write(con, text, len);
+				console_write_timed(con, dropped_text,
+						    dropped_len);
+			console_write_timed(con, text, len);
 		}
 	}
 }
@@ -2064,6 +2084,25 @@ int vprintk_store(int facility, int level,
 	return (text_len + trunc_msg_len);
 }
 
+/*
+ * With printk.offload=1, console output is left to the printk kthread
+ * instead of the CPU calling printk(), so that a slow console does not
+ * stall it. Oopses, panics and anything before the kthread runs or after
+ * the system starts going down still print directly.
+ */
+static bool printk_offload;
+module_param_named(offload, printk_offload, bool, 0644);
+
+static struct task_struct *printk_thread;
+static DECLARE_WAIT_QUEUE_HEAD(printk_thread_wait);
+
+static bool printk_offload_active(void)
+{
+	return READ_ONCE(printk_offload) && READ_ONCE(printk_thread) &&
+	       system_state == SYSTEM_RUNNING && !oops_in_progress &&
+	       atomic_read(&panic_cpu) == PANIC_CPU_INVALID;
+}
+
 asmlinkage int vprintk_emit(int facility, int level,
 			    const struct dev_printk_info *dev_info,
 			    const char *fmt, va_list args)
@@ -2089,7 +2128,9 @@ asmlinkage int vprintk_emit(int facility, int level,
 	printk_safe_exit_irqrestore(flags);
 
 	/* If called from the scheduler, we can not call up(). */
-	if (!in_sched) {
+	if (!in_sched && printk_offload_active()) {
+		defer_console_output();
+	} else if (!in_sched) {
 		/*
 		 * Disable preemption to avoid being preempted while holding
 		 * console_sem which would prevent anyone from printing to
@@ -3100,8 +3141,10 @@ static void wake_up_klogd_work_func(struct irq_work *irq_work)
 	int pending = __this_cpu_xchg(printk_pending, 0);
 
 	if (pending & PRINTK_PENDING_OUTPUT) {
+		if (printk_offload_active())
+			wake_up_interruptible(&printk_thread_wait);
 		/* If trylock fails, someone else is doing the printing */
-		if (console_trylock())
+		else if (console_trylock())
 			console_unlock();
 	}
 
@@ -3136,6 +3179,76 @@ void defer_console_output(void)
 	preempt_enable();
 }
 
+static bool printk_output_pending(void)
+{
+	unsigned long flags;
+	bool pending;
+
+	logbuf_lock_irqsave(flags);
+	pending = prb_read_valid(prb, console_seq, NULL);
+	logbuf_unlock_irqrestore(flags);
+
+	return pending;
+}
+
+static int printk_thread_func(void *data)
+{
+	while (!kthread_should_stop()) {
+		wait_event_interruptible(printk_thread_wait,
+					 printk_output_pending() ||
+					 kthread_should_stop());
+
+		/* console_lock() allows console_unlock() to reschedule */
+		console_lock();
+		console_unlock();
+	}
+
+	return 0;
+}
+
+static int printk_consoles_show(struct seq_file *m, void *v)
+{
+	struct console *con;
+	unsigned long flags;
+	u64 pending;
+
+	logbuf_lock_irqsave(flags);
+	pending = prb_next_seq(prb) - console_seq;
+	logbuf_unlock_irqrestore(flags);
+
+	seq_printf(m, "offload: %d pending: %llu\n",
+		   printk_offload_active(), pending);
+
+	console_lock();
+	for_each_console(con)
+		seq_printf(m, "%s%d writes: %lu bytes: %llu time_us: %llu max_us: %llu\n",
+			   con->name, con->index, con->nr_writes,
+			   con->write_bytes, div_u64(con->write_ns, 1000),
+			   div_u64(con->max_write_ns, 1000));
+	console_unlock();
+
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(printk_consoles);
+
+static int __init printk_offload_init(void)
+{
+	struct task_struct *thread;
+
+	debugfs_create_file("printk_consoles", 0400, NULL, NULL,
+			    &printk_consoles_fops);
+
+	thread = kthread_run(printk_thread_func, NULL, "printk");
+	if (IS_ERR(thread)) {
+		pr_err("printk: failed to start the console kthread\n");
+		return PTR_ERR(thread);
+	}
+	WRITE_ONCE(printk_thread, thread);
+
+	return 0;
+}
+late_initcall(printk_offload_init);
+
 int vprintk_deferred(const char *fmt, va_list args)
 {
 	int r;
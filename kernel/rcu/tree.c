@@ -156,6 +156,7 @@ static void invoke_rcu_core(void);
 static void rcu_report_exp_rdp(struct rcu_data *rdp);
 static void sync_sched_exp_online_cleanup(int cpu);
 static void check_cb_ovld_locked(struct rcu_data *rdp, struct rcu_node *rnp);
+static bool rcu_lazy_defer(struct rcu_data *rdp);
 
 /* rcuc/rcub kthread realtime priority */
 static int kthread_prio = IS_ENABLED(CONFIG_RCU_BOOST) ? 1 : 0;
@@ -492,6 +493,17 @@ module_param(qhimark, long, 0444);
 module_param(qlowmark, long, 0444);
 module_param(qovld, long, 0444);
 
+/*
+ * Lazy callbacks: with rcutree.lazy set, a CPU whose queued callbacks all
+ * came from call_rcu() neither requests a grace period for them nor keeps
+ * its tick until qhimark of them are queued or the oldest has waited
+ * jiffies_lazy_flush.  call_rcu_hurry() callbacks end the wait at once.
+ */
+static bool rcu_lazy;
+module_param_named(lazy, rcu_lazy, bool, 0644);
+static ulong jiffies_lazy_flush = 10 * HZ;
+module_param(jiffies_lazy_flush, ulong, 0644);
+
 static ulong jiffies_till_first_fqs = IS_ENABLED(CONFIG_RCU_STRICT_GRACE_PERIOD) ? 0 : ULONG_MAX;
 static ulong jiffies_till_next_fqs = ULONG_MAX;
 static bool rcu_kick_kthreads;
@@ -2780,7 +2792,8 @@ static __latent_entropy void rcu_core(void)
 	if (!rcu_gp_in_progress() &&
 	    rcu_segcblist_is_enabled(&rdp->cblist) && do_batch) {
 		rcu_nocb_lock_irqsave(rdp, flags);
-		if (!rcu_segcblist_restempty(&rdp->cblist, RCU_NEXT_READY_TAIL))
+		if (!rcu_segcblist_restempty(&rdp->cblist, RCU_NEXT_READY_TAIL) &&
+		    !rcu_lazy_defer(rdp))
 			rcu_accelerate_cbs_unlocked(rnp, rdp);
 		rcu_nocb_unlock_irqrestore(rdp, flags);
 	}
@@ -3006,9 +3019,41 @@ static void check_cb_ovld(struct rcu_data *rdp)
 	raw_spin_unlock_rcu_node(rnp);
 }
 
+/*
+ * Account a callback about to be queued on a non-offloaded CPU.  Any
+ * non-lazy callback breaks the lazy run until the list next drains.
+ */
+static void rcu_lazy_enqueue(struct rcu_data *rdp, bool lazy)
+{
+	if (rcu_segcblist_empty(&rdp->cblist)) {
+		rdp->lazy_len = 0;
+		rdp->lazy_start = jiffies;
+	}
+	if (lazy && READ_ONCE(rcu_lazy) && rdp->lazy_len >= 0)
+		rdp->lazy_len++;
+	else
+		rdp->lazy_len = -1;
+}
+
+/*
+ * Should this CPU hold off on requesting a grace period because all of
+ * its callbacks are lazy and neither the size nor the time limit is hit?
+ */
+static bool rcu_lazy_defer(struct rcu_data *rdp)
+{
+	long n = rcu_segcblist_n_cbs(&rdp->cblist);
+
+	return READ_ONCE(rcu_lazy) && rdp->lazy_len > 0 &&
+	       rdp->lazy_len == n && n < qhimark &&
+	       !rcu_segcblist_is_offloaded(&rdp->cblist) &&
+	       !rcu_segcblist_ready_cbs(&rdp->cblist) &&
+	       time_before(jiffies, rdp->lazy_start +
+				    READ_ONCE(jiffies_lazy_flush));
+}
+
 /* Helper function for call_rcu() and friends.  */
 static void
-__call_rcu(struct rcu_head *head, rcu_callback_t func)
+__call_rcu(struct rcu_head *head, rcu_callback_t func, bool lazy)
 {
 	static atomic_t doublefrees;
 	unsigned long flags;
@@ -3049,6 +3094,8 @@ __call_rcu(struct rcu_head *head, rcu_callback_t func)
 	}
 
 	check_cb_ovld(rdp);
+	if (!rcu_segcblist_is_offloaded(&rdp->cblist))
+		rcu_lazy_enqueue(rdp, lazy);
 	if (rcu_nocb_try_bypass(rdp, head, &was_alldone, flags))
 		return; // Enqueued onto ->nocb_bypass, so just leave.
 	// If no-CBs CPU gets here, rcu_nocb_try_bypass() acquired ->nocb_lock.
@@ -3109,10 +3156,25 @@ __call_rcu(struct rcu_head *head, rcu_callback_t func)
  */
 void call_rcu(struct rcu_head *head, rcu_callback_t func)
 {
-	__call_rcu(head, func);
+	__call_rcu(head, func, true);
 }
 EXPORT_SYMBOL_GPL(call_rcu);
 
+/**
+ * call_rcu_hurry() - Queue an RCU callback that must not be batched lazily.
+ * @head: structure to be used for queueing the RCU updates.
+ * @func: actual callback function to be invoked after the grace period
+ *
+ * Same as call_rcu(), except that the grace period is requested at once
+ * even when rcutree.lazy is set.  Use this when someone is waiting on the
+ * callback, as synchronize_rcu() does.
+ */
+void call_rcu_hurry(struct rcu_head *head, rcu_callback_t func)
+{
+	__call_rcu(head, func, false);
+}
+EXPORT_SYMBOL_GPL(call_rcu_hurry);
+
 
 /* Maximum number of jiffies to wait before draining a batch. */
 #define KFREE_DRAIN_JIFFIES (HZ / 50)
@@ -3764,7 +3826,7 @@ void synchronize_rcu(void)
 	if (rcu_gp_is_expedited())
 		synchronize_rcu_expedited();
 	else
-		wait_rcu_gp(call_rcu);
+		wait_rcu_gp(call_rcu_hurry);
 }
 EXPORT_SYMBOL_GPL(synchronize_rcu);
 
@@ -3848,7 +3910,8 @@ static int rcu_pending(int user)
 	/* Has RCU gone idle with this CPU needing another grace period? */
 	if (!gp_in_progress && rcu_segcblist_is_enabled(&rdp->cblist) &&
 	    !rcu_segcblist_is_offloaded(&rdp->cblist) &&
-	    !rcu_segcblist_restempty(&rdp->cblist, RCU_NEXT_READY_TAIL))
+	    !rcu_segcblist_restempty(&rdp->cblist, RCU_NEXT_READY_TAIL) &&
+	    !rcu_lazy_defer(rdp))
 		return 1;
 
 	/* Have RCU grace period completed or started?  */
@@ -178,6 +178,9 @@ struct rcu_data {
 	unsigned long	n_force_qs_snap;
 					/* did other CPU force QS recently? */
 	long		blimit;		/* Upper limit on a processed batch */
+	long		lazy_len;	/* # lazy CBs queued, -1 once any */
+					/*  non-lazy one is, reset on empty. */
+	unsigned long	lazy_start;	/* When list last became non-empty. */
 
 	/* 3) dynticks interface. */
 	int dynticks_snap;		/* Per-GP tracking for dynticks. */
@@ -1242,6 +1242,22 @@ static void rcu_prepare_kthreads(int cpu)
 
 #endif /* #else #ifdef CONFIG_RCU_BOOST */
 
+/*
+ * If this CPU holds only lazy callbacks, let it sleep until the lazy
+ * flush time and return true.  The caller must have disabled interrupts.
+ */
+static bool rcu_lazy_needs_cpu(struct rcu_data *rdp, u64 basemono,
+			       u64 *nextevt)
+{
+	unsigned long dj;
+
+	if (!rcu_lazy_defer(rdp))
+		return false;
+	dj = rdp->lazy_start + READ_ONCE(jiffies_lazy_flush) - jiffies;
+	*nextevt = basemono + dj * TICK_NSEC;
+	return true;
+}
+
 #if !defined(CONFIG_RCU_FAST_NO_HZ)
 
 /*
@@ -1255,9 +1271,13 @@ static void rcu_prepare_kthreads(int cpu)
  */
 int rcu_needs_cpu(u64 basemono, u64 *nextevt)
 {
+	struct rcu_data *rdp = this_cpu_ptr(&rcu_data);
+
+	if (rcu_lazy_needs_cpu(rdp, basemono, nextevt))
+		return 0;
 	*nextevt = KTIME_MAX;
-	return !rcu_segcblist_empty(&this_cpu_ptr(&rcu_data)->cblist) &&
-	       !rcu_segcblist_is_offloaded(&this_cpu_ptr(&rcu_data)->cblist);
+	return !rcu_segcblist_empty(&rdp->cblist) &&
+	       !rcu_segcblist_is_offloaded(&rdp->cblist);
 }
 
 /*
@@ -1357,6 +1377,10 @@ int rcu_needs_cpu(u64 basemono, u64 *nextevt)
 		return 0;
 	}
 
+	/* Only lazy callbacks, so sleep until they are due. */
+	if (rcu_lazy_needs_cpu(rdp, basemono, nextevt))
+		return 0;
+
 	/* Attempt to advance callbacks. */
 	if (rcu_try_advance_all_cbs()) {
 		/* Some ready to invoke, so initiate later invocation. */
@@ -1409,7 +1433,7 @@ static void rcu_prepare_for_idle(void)
 	if (rdp->last_accelerate == jiffies)
 		return;
 	rdp->last_accelerate = jiffies;
-	if (rcu_segcblist_pend_cbs(&rdp->cblist)) {
+	if (rcu_segcblist_pend_cbs(&rdp->cblist) && !rcu_lazy_defer(rdp)) {
 		rnp = rdp->mynode;
 		raw_spin_lock_rcu_node(rnp); /* irqs already disabled. */
 		needwake = rcu_accelerate_cbs(rnp, rdp);
@@ -2490,6 +2514,35 @@ int rcu_nocb_cpu_offload(int cpu)
 }
 EXPORT_SYMBOL_GPL(rcu_nocb_cpu_offload);
 
+/*
+ * rcutree.nocb_offload and rcutree.nocb_deoffload: write a CPU number to
+ * switch that CPU's callbacks to or from its rcuo kthreads at runtime.
+ * Only CPUs named in rcu_nocbs= at boot can be offloaded.
+ */
+static int param_set_nocb_toggle(const char *val, const struct kernel_param *kp)
+{
+	int cpu, ret;
+
+	if (!rcu_scheduler_fully_active)
+		return -EBUSY;
+	ret = kstrtoint(val, 0, &cpu);
+	if (ret)
+		return ret;
+	if (cpu < 0 || cpu >= nr_cpu_ids || !cpu_possible(cpu))
+		return -EINVAL;
+	if (kp->arg)
+		return rcu_nocb_cpu_offload(cpu);
+	return rcu_nocb_cpu_deoffload(cpu);
+}
+
+static const struct kernel_param_ops nocb_toggle_ops = {
+	.set = param_set_nocb_toggle,
+};
+
+static bool nocb_offload_arg = true;
+module_param_cb(nocb_offload, &nocb_toggle_ops, &nocb_offload_arg, 0200);
+module_param_cb(nocb_deoffload, &nocb_toggle_ops, NULL, 0200);
+
 void __init rcu_init_nohz(void)
 {
 	int cpu;
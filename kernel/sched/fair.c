@@ -5899,6 +5899,14 @@ static int wake_affine(struct sched_domain *sd, struct task_struct *p,
 {
 	int target = nr_cpumask_bits;
 
+	/*
+	 * With waker and wakee behind one cache there is no cache affinity
+	 * to gain by pulling the wakee over, while staying keeps its private
+	 * caches warm. Let select_idle_sibling() start from prev_cpu.
+	 */
+	if (sched_feat(WA_PREV_LLC) && cpus_share_cache(this_cpu, prev_cpu))
+		return prev_cpu;
+
 	if (sched_feat(WA_IDLE))
 		target = wake_affine_idle(this_cpu, prev_cpu, sync);
 
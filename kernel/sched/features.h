@@ -84,6 +84,11 @@ SCHED_FEAT(ATTACH_AGE_LOAD, true)
 SCHED_FEAT(WA_IDLE, true)
 SCHED_FEAT(WA_WEIGHT, true)
 SCHED_FEAT(WA_BIAS, true)
+/*
+ * Keep wakees on their previous CPU when it shares the LLC with the waker,
+ * for clusters whose only shared cache is the LLC.
+ */
+SCHED_FEAT(WA_PREV_LLC, false)
 
 /*
  * UtilEstimation. Use estimated CPU utilization.
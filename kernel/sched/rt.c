@@ -9,6 +9,10 @@
 
 int sched_rr_timeslice = RR_TIMESLICE;
 int sysctl_sched_rr_timeslice = (MSEC_PER_SEC / HZ) * RR_TIMESLICE;
+#ifdef CONFIG_SMP
+/* Systems up to this many CPUs pull RT tasks without RT_PUSH_IPI */
+unsigned int sysctl_sched_rt_pull_direct_cpus = 4;
+#endif
 /* More than 4 hours if BW_SHIFT equals 20. */
 static const u64 max_rt_runtime = MAX_BW;
 
@@ -1373,8 +1377,11 @@ enqueue_task_rt(struct rq *rq, struct task_struct *p, int flags)
 {
 	struct sched_rt_entity *rt_se = &p->rt;
 
-	if (flags & ENQUEUE_WAKEUP)
+	if (flags & ENQUEUE_WAKEUP) {
 		rt_se->timeout = 0;
+		if (trace_sched_rt_wakeup_latency_enabled())
+			rt_se->wake_stamp = rq_clock(rq);
+	}
 
 	enqueue_rt_entity(rt_se, flags);
 
@@ -1584,6 +1591,12 @@ static inline void set_next_task_rt(struct rq *rq, struct task_struct *p, bool f
 	if (!first)
 		return;
 
+	if (p->rt.wake_stamp) {
+		trace_sched_rt_wakeup_latency(p,
+					      rq_clock(rq) - p->rt.wake_stamp);
+		p->rt.wake_stamp = 0;
+	}
+
 	/*
 	 * If prev task was rt, put_prev_task() has already updated the
 	 * utilization. We only care of the case where we start to schedule a
@@ -2143,6 +2156,16 @@ void rto_push_irq_work_func(struct irq_work *work)
 	/* Try the next RT overloaded CPU */
 	irq_work_queue_on(&rd->rto_push_work, cpu);
 }
+
+/*
+ * The IPI chain spares large systems the contention of every CPU going for
+ * the same rq lock. With a few CPUs there is little contention to spare,
+ * and the IPIs cost more, the more so where they go through firmware.
+ */
+static inline bool rt_pull_by_ipi(void)
+{
+	return num_online_cpus() > READ_ONCE(sysctl_sched_rt_pull_direct_cpus);
+}
 #endif /* HAVE_RT_PUSH_IPI */
 
 static void pull_rt_task(struct rq *this_rq)
@@ -2168,7 +2191,7 @@ static void pull_rt_task(struct rq *this_rq)
 		return;
 
 #ifdef HAVE_RT_PUSH_IPI
-	if (sched_feat(RT_PUSH_IPI)) {
+	if (sched_feat(RT_PUSH_IPI) && rt_pull_by_ipi()) {
 		tell_cpu_to_push(this_rq);
 		return;
 	}
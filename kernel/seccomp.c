@@ -144,6 +144,23 @@ struct notification {
 };
 
 #ifdef SECCOMP_ARCH_NATIVE
+/* seccomp_cache_entry.pc values that are not an instruction */
+#define SECCOMP_CACHE_CONST	U16_MAX
+#define SECCOMP_CACHE_NONE	(U16_MAX - 1)
+
+/**
+ * struct seccomp_cache_entry - what a single filter does with a syscall
+ *
+ * @action: The action the filter returns, if @pc is SECCOMP_CACHE_CONST.
+ * @pc: The instruction from which the filter looks at more than the
+ *	syscall number and arch, SECCOMP_CACHE_CONST if it never does,
+ *	or SECCOMP_CACHE_NONE if the BPF program has to run.
+ */
+struct seccomp_cache_entry {
+	u32 action;
+	u16 pc;
+};
+
 /**
  * struct action_cache - per-filter cache of seccomp actions per
  * arch/syscall pair
@@ -154,13 +171,24 @@ struct notification {
  * @allow_compat: A bitmap where each bit represents whether the
  *		  filter will always allow the syscall, for the
  *		  compat architecture.
+ * @entries_native: What this filter alone does with each native
+ *		    syscall, or NULL if it could not be allocated.
+ * @entries_compat: What this filter alone does with each compat
+ *		    syscall, or NULL if it could not be allocated.
  */
 struct action_cache {
 	DECLARE_BITMAP(allow_native, SECCOMP_ARCH_NATIVE_NR);
 #ifdef SECCOMP_ARCH_COMPAT
 	DECLARE_BITMAP(allow_compat, SECCOMP_ARCH_COMPAT_NR);
+#endif
+	struct seccomp_cache_entry *entries_native;
+#ifdef SECCOMP_ARCH_COMPAT
+	struct seccomp_cache_entry *entries_compat;
 #endif
 };
+
+static void seccomp_cache_prepare_entries(struct seccomp_filter *sfilter);
+static void seccomp_cache_free(struct seccomp_filter *sfilter);
 #else
 struct action_cache { };
 
@@ -170,9 +198,23 @@ static inline bool seccomp_cache_check_allow(const struct seccomp_filter *sfilte
 	return false;
 }
 
+static inline bool seccomp_cache_run(const struct seccomp_filter *sfilter,
+				     const struct seccomp_data *sd, u32 *ret)
+{
+	return false;
+}
+
 static inline void seccomp_cache_prepare(struct seccomp_filter *sfilter)
 {
 }
+
+static inline void seccomp_cache_prepare_entries(struct seccomp_filter *sfilter)
+{
+}
+
+static inline void seccomp_cache_free(struct seccomp_filter *sfilter)
+{
+}
 #endif /* SECCOMP_ARCH_NATIVE */
 
 /**
@@ -376,6 +418,124 @@ static inline bool seccomp_cache_check_allow(const struct seccomp_filter *sfilte
 	WARN_ON_ONCE(true);
 	return false;
 }
+
+static inline const struct seccomp_cache_entry *
+seccomp_cache_lookup_entry(const struct seccomp_cache_entry *entries,
+			   size_t nr_syscalls, int syscall_nr)
+{
+	if (!entries || unlikely(syscall_nr < 0 || syscall_nr >= nr_syscalls))
+		return NULL;
+
+	return &entries[array_index_nospec(syscall_nr, nr_syscalls)];
+}
+
+/**
+ * seccomp_run_tail - run a filter from where it looks at the arguments
+ * @fprog: The classic BPF program, as loaded
+ * @pc: The instruction to start from
+ * @sd: The seccomp data
+ *
+ * seccomp_cache_prepare_entries() made sure that only instructions known
+ * to seccomp_emulate() follow @pc, and classic BPF only jumps forward.
+ *
+ * Returns the action of the filter.
+ */
+static u32 seccomp_run_tail(const struct sock_fprog_kern *fprog,
+			    unsigned int pc, const struct seccomp_data *sd)
+{
+	u32 reg_value = 0;
+	bool op_res;
+
+	for (; pc < fprog->len; pc++) {
+		const struct sock_filter *insn = &fprog->filter[pc];
+		u16 code = insn->code;
+		u32 k = insn->k;
+
+		switch (code) {
+		case BPF_LD | BPF_W | BPF_ABS:
+			/* 32-bit aligned and in bounds, per seccomp_check_filter() */
+			reg_value = *(const u32 *)((const u8 *)sd + k);
+			break;
+		case BPF_RET | BPF_K:
+			return k;
+		case BPF_JMP | BPF_JA:
+			pc += k;
+			break;
+		case BPF_JMP | BPF_JEQ | BPF_K:
+		case BPF_JMP | BPF_JGE | BPF_K:
+		case BPF_JMP | BPF_JGT | BPF_K:
+		case BPF_JMP | BPF_JSET | BPF_K:
+			switch (BPF_OP(code)) {
+			case BPF_JEQ:
+				op_res = reg_value == k;
+				break;
+			case BPF_JGE:
+				op_res = reg_value >= k;
+				break;
+			case BPF_JGT:
+				op_res = reg_value > k;
+				break;
+			default:
+				op_res = !!(reg_value & k);
+				break;
+			}
+
+			pc += op_res ? insn->jt : insn->jf;
+			break;
+		case BPF_ALU | BPF_AND | BPF_K:
+			reg_value &= k;
+			break;
+		default:
+			goto fail;
+		}
+	}
+
+fail:
+	/* Ensure unexpected behavior doesn't result in failing open. */
+	WARN_ON_ONCE(1);
+	return SECCOMP_RET_KILL_PROCESS;
+}
+
+/**
+ * seccomp_cache_run - evaluate one filter from its cache
+ * @sfilter: The seccomp filter
+ * @sd: The seccomp data
+ * @ret: Set to the action of the filter
+ *
+ * Returns true if the cache knew the action of the filter, either as a
+ * constant or by running the part of it that looks at the arguments.
+ */
+static bool seccomp_cache_run(const struct seccomp_filter *sfilter,
+			      const struct seccomp_data *sd, u32 *ret)
+{
+	const struct action_cache *cache = &sfilter->cache;
+	const struct seccomp_cache_entry *entry;
+
+#ifndef SECCOMP_ARCH_COMPAT
+	entry = seccomp_cache_lookup_entry(cache->entries_native,
+					   SECCOMP_ARCH_NATIVE_NR, sd->nr);
+#else
+	if (likely(sd->arch == SECCOMP_ARCH_NATIVE))
+		entry = seccomp_cache_lookup_entry(cache->entries_native,
+						   SECCOMP_ARCH_NATIVE_NR,
+						   sd->nr);
+	else if (likely(sd->arch == SECCOMP_ARCH_COMPAT))
+		entry = seccomp_cache_lookup_entry(cache->entries_compat,
+						   SECCOMP_ARCH_COMPAT_NR,
+						   sd->nr);
+	else
+		entry = NULL;
+#endif /* SECCOMP_ARCH_COMPAT */
+
+	if (!entry || entry->pc == SECCOMP_CACHE_NONE)
+		return false;
+
+	if (entry->pc == SECCOMP_CACHE_CONST)
+		*ret = entry->action;
+	else
+		*ret = seccomp_run_tail(sfilter->prog->orig_prog, entry->pc, sd);
+	return true;
+}
 #endif /* SECCOMP_ARCH_NATIVE */
 
 /**
@@ -408,7 +568,10 @@ static u32 seccomp_run_filters(const struct seccomp_data *sd,
 	 * value always takes priority (ignoring the DATA).
 	 */
 	for (; f; f = f->prev) {
-		u32 cur_ret = bpf_prog_run_pin_on_cpu(f->prog, sd);
+		u32 cur_ret;
+
+		if (!seccomp_cache_run(f, sd, &cur_ret))
+			cur_ret = bpf_prog_run_pin_on_cpu(f->prog, sd);
 
 		if (ACTION_ONLY(cur_ret) < ACTION_ONLY(ret)) {
 			ret = cur_ret;
@@ -508,6 +671,7 @@ static inline pid_t seccomp_can_sync_threads(void)
 static inline void seccomp_filter_free(struct seccomp_filter *filter)
 {
 	if (filter) {
+		seccomp_cache_free(filter);
 		bpf_prog_destroy(filter->prog);
 		kfree(filter);
 	}
@@ -669,6 +833,8 @@ static struct seccomp_filter *seccomp_prepare_filter(struct sock_fprog *fprog)
 	refcount_set(&sfilter->users, 1);
 	init_waitqueue_head(&sfilter->wqh);
 
+	seccomp_cache_prepare_entries(sfilter);
+
 	return sfilter;
 }
 
@@ -701,21 +867,48 @@ seccomp_prepare_user_filter(const char __user *user_filter)
 }
 
 #ifdef SECCOMP_ARCH_NATIVE
+/* How far a filter goes with only the syscall number and arch known */
+enum seccomp_emu {
+	SECCOMP_EMU_CONST,	/* to a constant action */
+	SECCOMP_EMU_ARGS,	/* to a load of another field */
+	SECCOMP_EMU_UNKNOWN,	/* to an instruction it does not know */
+};
+
+/* Instructions seccomp_emulate() and seccomp_run_tail() know */
+static bool seccomp_emulates(u16 code)
+{
+	switch (code) {
+	case BPF_LD | BPF_W | BPF_ABS:
+	case BPF_RET | BPF_K:
+	case BPF_JMP | BPF_JA:
+	case BPF_JMP | BPF_JEQ | BPF_K:
+	case BPF_JMP | BPF_JGE | BPF_K:
+	case BPF_JMP | BPF_JGT | BPF_K:
+	case BPF_JMP | BPF_JSET | BPF_K:
+	case BPF_ALU | BPF_AND | BPF_K:
+		return true;
+	default:
+		return false;
+	}
+}
+
 /**
- * seccomp_is_const_allow - check if filter is constant allow with given data
+ * seccomp_emulate - run a filter as far as constant data takes it
  * @fprog: The BPF programs
  * @sd: The seccomp data to check against, only syscall number and arch
  *      number are considered constant.
+ * @res: Set to the action for SECCOMP_EMU_CONST, or to the instruction
+ *       loading another field for SECCOMP_EMU_ARGS.
  */
-static bool seccomp_is_const_allow(struct sock_fprog_kern *fprog,
-				   struct seccomp_data *sd)
+static enum seccomp_emu seccomp_emulate(struct sock_fprog_kern *fprog,
+					struct seccomp_data *sd, u32 *res)
 {
 	unsigned int reg_value = 0;
 	unsigned int pc;
 	bool op_res;
 
 	if (WARN_ON_ONCE(!fprog))
-		return false;
+		return SECCOMP_EMU_UNKNOWN;
 
 	for (pc = 0; pc < fprog->len; pc++) {
 		struct sock_filter *insn = &fprog->filter[pc];
@@ -732,13 +925,15 @@ static bool seccomp_is_const_allow(struct sock_fprog_kern *fprog,
 				reg_value = sd->arch;
 				break;
 			default:
-				/* can't optimize (non-constant value load) */
-				return false;
+				/* non-constant value load */
+				*res = pc;
+				return SECCOMP_EMU_ARGS;
 			}
 			break;
 		case BPF_RET | BPF_K:
-			/* reached return with constant values only, check allow */
-			return k == SECCOMP_RET_ALLOW;
+			/* reached return with constant values only */
+			*res = k;
+			return SECCOMP_EMU_CONST;
 		case BPF_JMP | BPF_JA:
 			pc += insn->k;
 			break;
@@ -761,7 +956,7 @@ static bool seccomp_is_const_allow(struct sock_fprog_kern *fprog,
 				break;
 			default:
 				/* can't optimize (unknown jump) */
-				return false;
+				return SECCOMP_EMU_UNKNOWN;
 			}
 
 			pc += op_res ? insn->jt : insn->jf;
@@ -771,13 +966,28 @@ static bool seccomp_is_const_allow(struct sock_fprog_kern *fprog,
 			break;
 		default:
 			/* can't optimize (unknown insn) */
-			return false;
+			return SECCOMP_EMU_UNKNOWN;
 		}
 	}
 
 	/* ran off the end of the filter?! */
 	WARN_ON(1);
-	return false;
+	return SECCOMP_EMU_UNKNOWN;
+}
+
+/**
+ * seccomp_is_const_allow - check if filter is constant allow with given data
+ * @fprog: The BPF programs
+ * @sd: The seccomp data to check against, only syscall number and arch
+ *      number are considered constant.
+ */
+static bool seccomp_is_const_allow(struct sock_fprog_kern *fprog,
+				   struct seccomp_data *sd)
+{
+	u32 action;
+
+	return seccomp_emulate(fprog, sd, &action) == SECCOMP_EMU_CONST &&
+		action == SECCOMP_RET_ALLOW;
 }
 
 static void seccomp_cache_prepare_bitmap(struct seccomp_filter *sfilter,
@@ -840,6 +1050,82 @@ static void seccomp_cache_prepare(struct seccomp_filter *sfilter)
 				     SECCOMP_ARCH_COMPAT);
 #endif /* SECCOMP_ARCH_COMPAT */
 }
+
+static struct seccomp_cache_entry *
+seccomp_cache_prepare_arch(struct sock_fprog_kern *fprog, unsigned int tail,
+			   size_t nr_syscalls, int arch)
+{
+	struct seccomp_cache_entry *entries;
+	struct seccomp_data sd;
+	u32 res;
+	int nr;
+
+	entries = kmalloc_array(nr_syscalls, sizeof(*entries),
+				GFP_KERNEL | __GFP_NOWARN);
+	if (!entries)
+		return NULL;
+
+	for (nr = 0; nr < nr_syscalls; nr++) {
+		sd.nr = nr;
+		sd.arch = arch;
+
+		switch (seccomp_emulate(fprog, &sd, &res)) {
+		case SECCOMP_EMU_CONST:
+			entries[nr].action = res;
+			entries[nr].pc = SECCOMP_CACHE_CONST;
+			break;
+		case SECCOMP_EMU_ARGS:
+			entries[nr].pc = res >= tail ? res : SECCOMP_CACHE_NONE;
+			break;
+		default:
+			entries[nr].pc = SECCOMP_CACHE_NONE;
+			break;
+		}
+	}
+
+	return entries;
+}
+
+/**
+ * seccomp_cache_prepare_entries - emulate the filter for each syscall
+ * @sfilter: The seccomp filter, not attached yet
+ *
+ * Each syscall gets the action the filter returns for it if that only
+ * depends on the syscall number and arch. Otherwise, if only instructions
+ * seccomp_run_tail() knows follow the point where the filter starts
+ * looking at the arguments, it will only run from there, skipping the
+ * comparisons against syscall numbers that make up most of the filter.
+ * The cache is an optimization only: without memory for it, the BPF
+ * program runs as usual.
+ */
+static void seccomp_cache_prepare_entries(struct seccomp_filter *sfilter)
+{
+	struct sock_fprog_kern *fprog = sfilter->prog->orig_prog;
+	struct action_cache *cache = &sfilter->cache;
+	unsigned int tail;
+
+	/* Start of the last run of instructions seccomp_run_tail() knows */
+	for (tail = fprog->len; tail; tail--)
+		if (!seccomp_emulates(fprog->filter[tail - 1].code))
+			break;
+
+	cache->entries_native = seccomp_cache_prepare_arch(fprog, tail,
+							   SECCOMP_ARCH_NATIVE_NR,
+							   SECCOMP_ARCH_NATIVE);
+#ifdef SECCOMP_ARCH_COMPAT
+	cache->entries_compat = seccomp_cache_prepare_arch(fprog, tail,
+							   SECCOMP_ARCH_COMPAT_NR,
+							   SECCOMP_ARCH_COMPAT);
+#endif /* SECCOMP_ARCH_COMPAT */
+}
+
+static void seccomp_cache_free(struct seccomp_filter *sfilter)
+{
+	kfree(sfilter->cache.entries_native);
+#ifdef SECCOMP_ARCH_COMPAT
+	kfree(sfilter->cache.entries_compat);
+#endif /* SECCOMP_ARCH_COMPAT */
+}
 #endif /* SECCOMP_ARCH_NATIVE */
 
 /**
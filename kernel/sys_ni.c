@@ -145,6 +145,7 @@ COND_SYSCALL(clone3);
 /* kernel/futex.c */
 COND_SYSCALL(futex);
 COND_SYSCALL(futex_time32);
+COND_SYSCALL(futex_waitv);
 COND_SYSCALL(set_robust_list);
 COND_SYSCALL_COMPAT(set_robust_list);
 COND_SYSCALL(get_robust_list);
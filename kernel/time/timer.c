@@ -44,6 +44,8 @@
 #include <linux/slab.h>
 #include <linux/compat.h>
 #include <linux/random.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
 
 #include <linux/uaccess.h>
 #include <asm/unistd.h>
@@ -207,6 +209,8 @@ struct timer_base {
 	unsigned int		cpu;
 	bool			next_expiry_recalc;
 	bool			is_idle;
+	unsigned long		nr_expired;
+	unsigned long		nr_remote;
 	DECLARE_BITMAP(pending_map, WHEEL_SIZE);
 	struct hlist_head	vectors[WHEEL_SIZE];
 } ____cacheline_aligned;
@@ -224,6 +228,14 @@ static DECLARE_WORK(timer_update_work, timer_update_keys);
 #ifdef CONFIG_SMP
 unsigned int sysctl_timer_migration = 1;
 
+/*
+ * With timer migration enabled, non-pinned deferrable timers are queued on
+ * this CPU instead, so that idle and isolated CPUs are not left holding
+ * them.  Deferrable timers don't wake an idle CPU, so they run once this
+ * one is busy.  -1, or an offline CPU, keeps the usual placement.
+ */
+int sysctl_timer_pull_cpu = -1;
+
 DEFINE_STATIC_KEY_FALSE(timers_migration_enabled);
 
 static void timers_update_migration(void)
@@ -581,6 +593,8 @@ static void enqueue_timer(struct timer_base *base, struct timer_list *timer,
 	hlist_add_head(&timer->entry, base->vectors + idx);
 	__set_bit(idx, base->pending_map);
 	timer_set_idx(timer, idx);
+	if (base->cpu != smp_processor_id())
+		base->nr_remote++;
 
 	trace_timer_start(timer, timer->expires, timer->flags);
 
@@ -881,8 +895,16 @@ get_target_base(struct timer_base *base, unsigned tflags)
 {
 #if defined(CONFIG_SMP) && defined(CONFIG_NO_HZ_COMMON)
 	if (static_branch_likely(&timers_migration_enabled) &&
-	    !(tflags & TIMER_PINNED))
+	    !(tflags & TIMER_PINNED)) {
+		if (tflags & TIMER_DEFERRABLE) {
+			int cpu = READ_ONCE(sysctl_timer_pull_cpu);
+
+			/* irqs are off, so @cpu can't go offline under us */
+			if (cpu >= 0 && cpu < nr_cpu_ids && cpu_online(cpu))
+				return get_timer_cpu_base(tflags, cpu);
+		}
 		return get_timer_cpu_base(tflags, get_nohz_timer_target());
+	}
 #endif
 	return get_timer_this_cpu_base(tflags);
 }
@@ -1463,6 +1485,7 @@ static void expire_timers(struct timer_base *base, struct hlist_head *head)
 
 		base->running_timer = timer;
 		detach_timer(timer, true);
+		base->nr_expired++;
 
 		fn = timer->function;
 
@@ -2034,6 +2057,45 @@ void __init init_timers(void)
 	open_softirq(TIMER_SOFTIRQ, run_timer_softirq);
 }
 
+#ifdef CONFIG_DEBUG_FS
+/*
+ * Timers expired on each CPU's wheels, and how many of them were queued
+ * there from another CPU, e.g. pulled by timer_pull_cpu.
+ */
+static int timer_expiries_show(struct seq_file *s, void *data)
+{
+	int cpu, b;
+
+	seq_puts(s, "cpu");
+	for (b = 0; b < NR_BASES; b++)
+		seq_printf(s, " %12s %12s",
+			   b != BASE_STD ? "def_expired" : "expired",
+			   b != BASE_STD ? "def_remote" : "remote");
+	seq_putc(s, '\n');
+
+	for_each_possible_cpu(cpu) {
+		seq_printf(s, "%3d", cpu);
+		for (b = 0; b < NR_BASES; b++) {
+			struct timer_base *base = per_cpu_ptr(&timer_bases[b], cpu);
+
+			seq_printf(s, " %12lu %12lu", READ_ONCE(base->nr_expired),
+				   READ_ONCE(base->nr_remote));
+		}
+		seq_putc(s, '\n');
+	}
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(timer_expiries);
+
+static int __init timer_debugfs_init(void)
+{
+	debugfs_create_file("timer_expiries", 0444, NULL, NULL,
+			    &timer_expiries_fops);
+	return 0;
+}
+late_initcall(timer_debugfs_init);
+#endif
+
 /**
  * msleep - sleep safely even with waitqueue interruptions
  * @msecs: Time in milliseconds to sleep for
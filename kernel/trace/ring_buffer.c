@@ -487,6 +487,12 @@ struct rb_time_struct {
 #endif
 typedef struct rb_time_struct rb_time_t;
 
+/*
+ * Read pages kept for reuse by ring_buffer_alloc_read_page(), enough to
+ * refill a default sized pipe spliced from trace_pipe_raw.
+ */
+#define RB_FREE_PAGES_MAX	16
+
 /*
  * head_page == tail_page && head == tail then buffer is empty.
  */
@@ -498,7 +504,8 @@ struct ring_buffer_per_cpu {
 	raw_spinlock_t			reader_lock;	/* serialize readers */
 	arch_spinlock_t			lock;
 	struct lock_class_key		lock_key;
-	struct buffer_data_page		*free_page;
+	struct buffer_data_page		*free_pages[RB_FREE_PAGES_MAX];
+	int				nr_free_pages;
 	unsigned long			nr_pages;
 	unsigned int			current_context;
 	struct list_head		*pages;
@@ -1594,6 +1601,10 @@ static void rb_free_cpu_buffer(struct ring_buffer_per_cpu *cpu_buffer)
 	struct list_head *head = cpu_buffer->pages;
 	struct buffer_page *bpage, *tmp;
 
+	while (cpu_buffer->nr_free_pages)
+		free_page((unsigned long)
+			  cpu_buffer->free_pages[--cpu_buffer->nr_free_pages]);
+
 	free_buffer_page(cpu_buffer->reader_page);
 
 	rb_head_page_deactivate(cpu_buffer);
@@ -5303,10 +5314,8 @@ void *ring_buffer_alloc_read_page(struct trace_buffer *buffer, int cpu)
 	local_irq_save(flags);
 	arch_spin_lock(&cpu_buffer->lock);
 
-	if (cpu_buffer->free_page) {
-		bpage = cpu_buffer->free_page;
-		cpu_buffer->free_page = NULL;
-	}
+	if (cpu_buffer->nr_free_pages)
+		bpage = cpu_buffer->free_pages[--cpu_buffer->nr_free_pages];
 
 	arch_spin_unlock(&cpu_buffer->lock);
 	local_irq_restore(flags);
@@ -5350,8 +5359,8 @@ void ring_buffer_free_read_page(struct trace_buffer *buffer, int cpu, void *data
 	local_irq_save(flags);
 	arch_spin_lock(&cpu_buffer->lock);
 
-	if (!cpu_buffer->free_page) {
-		cpu_buffer->free_page = bpage;
+	if (cpu_buffer->nr_free_pages < RB_FREE_PAGES_MAX) {
+		cpu_buffer->free_pages[cpu_buffer->nr_free_pages++] = bpage;
 		bpage = NULL;
 	}
 
@@ -33,11 +33,16 @@ static struct trace_buffer *buffer;
 static struct task_struct *producer;
 static struct task_struct *consumer;
 static unsigned long read;
+static unsigned long read_pages;
 
 static unsigned int disable_reader;
 module_param(disable_reader, uint, 0644);
 MODULE_PARM_DESC(disable_reader, "only run producer");
 
+static unsigned int read_batch = 1;
+module_param(read_batch, uint, 0644);
+MODULE_PARM_DESC(read_batch, "# of pages read from a CPU before moving to the next");
+
 static unsigned int write_iteration = 50;
 module_param(write_iteration, uint, 0644);
 MODULE_PARM_DESC(write_iteration, "# of writes between timestamp readings");
@@ -171,6 +176,7 @@ static enum event_status read_page(int cpu)
 				break;
 			}
 		}
+		read_pages++;
 	}
 	ring_buffer_free_read_page(buffer, cpu, bpage);
 
@@ -185,6 +191,7 @@ static void ring_buffer_consumer(void)
 	read_events ^= 1;
 
 	read = 0;
+	read_pages = 0;
 	/*
 	 * Continue running until the producer specifically asks to stop
 	 * and is ready for the completion.
@@ -198,11 +205,16 @@ static void ring_buffer_consumer(void)
 			found = 0;
 			for_each_online_cpu(cpu) {
 				enum event_status stat;
+				unsigned int batch = 0;
 
 				if (read_events)
 					stat = read_event(cpu);
 				else
-					stat = read_page(cpu);
+					do {
+						stat = read_page(cpu);
+					} while (stat == EVENT_FOUND &&
+						 ++batch < read_batch &&
+						 !test_error);
 
 				if (test_error)
 					break;
@@ -343,6 +355,16 @@ static void ring_buffer_producer(void)
 
 	trace_printk("Entries per millisec: %ld\n", hit);
 
+	/* Reader throughput, what a consumer has to beat to avoid overruns */
+	if (!disable_reader && time) {
+		trace_printk("Read per millisec: %ld\n", read / (long)time);
+		if (!read_events)
+			trace_printk("Pages read: %ld (%ld per sec, batch %u)\n",
+				     read_pages,
+				     read_pages * MSEC_PER_SEC / (long)time,
+				     read_batch);
+	}
+
 	if (hit) {
 		/* Calculate the average time in nanosecs */
 		avg = NSEC_PER_MSEC / hit;
@@ -7587,6 +7587,7 @@ tracing_buffers_read(struct file *filp, char __user *ubuf,
 {
 	struct ftrace_buffer_info *info = filp->private_data;
 	struct trace_iterator *iter = &info->iter;
+	ssize_t copied = 0;
 	ssize_t ret = 0;
 	ssize_t size;
 
@@ -7619,11 +7620,14 @@ tracing_buffers_read(struct file *filp, char __user *ubuf,
 	trace_access_lock(iter->cpu_file);
 	ret = ring_buffer_read_page(iter->array_buffer->buffer,
 				    &info->spare,
-				    count,
+				    count - copied,
 				    iter->cpu_file, 0);
 	trace_access_unlock(iter->cpu_file);
 
 	if (ret < 0) {
+		/* only the first page of a read may wait */
+		if (copied)
+			return copied;
 		if (trace_empty(iter)) {
 			if ((filp->f_flags & O_NONBLOCK))
 				return -EAGAIN;
@@ -7640,19 +7644,27 @@ tracing_buffers_read(struct file *filp, char __user *ubuf,
 	info->read = 0;
  read:
 	size = PAGE_SIZE - info->read;
-	if (size > count)
-		size = count;
+	if (size > count - copied)
+		size = count - copied;
 
-	ret = copy_to_user(ubuf, info->spare + info->read, size);
+	ret = copy_to_user(ubuf + copied, info->spare + info->read, size);
 	if (ret == size)
-		return -EFAULT;
+		return copied ? : -EFAULT;
 
 	size -= ret;
 
 	*ppos += size;
 	info->read += size;
+	copied += size;
 
-	return size;
+	/*
+	 * A read of several pages gets as many whole pages as are ready,
+	 * sparing a reader that can't keep up a syscall per page.
+	 */
+	if (!ret && info->read == PAGE_SIZE && count - copied >= PAGE_SIZE)
+		goto again;
+
+	return copied;
 }
 
 static int tracing_buffers_release(struct inode *inode, struct file *file)
@@ -208,6 +208,8 @@ EXPORT_SYMBOL(__crc32c_le);
 
 u32 __pure crc32_le_base(u32, unsigned char const *, size_t) __alias(crc32_le);
 u32 __pure __crc32c_le_base(u32, unsigned char const *, size_t) __alias(__crc32c_le);
+EXPORT_SYMBOL(crc32_le_base);
+EXPORT_SYMBOL(__crc32c_le_base);
 
 /*
  * This multiplies the polynomials x and y modulo the given modulus.
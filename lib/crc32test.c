@@ -829,10 +829,69 @@ static int __init crc32_combine_test(void)
 	return 0;
 }
 
+/*
+ * Time the crc32_le()/__crc32c_le() the kernel runs with against the generic
+ * table driven code, which differ when an arch provides its own.
+ */
+static u64 __init crc32_time(u32 (*fn)(u32, unsigned char const *, size_t),
+			     u32 *crc)
+{
+	unsigned long flags;
+	u64 nsec;
+	int i;
+
+	local_irq_save(flags);
+	nsec = ktime_get_ns();
+	for (i = 0; i < 100; i++)
+		*crc ^= fn(test[i].crc, test_buf + test[i].start,
+			   test[i].length);
+	nsec = ktime_get_ns() - nsec;
+	local_irq_restore(flags);
+
+	return nsec;
+}
+
+static int __init crc32_base_test(void)
+{
+	int i, errors = 0, bytes = 0;
+	u64 le, le_base, c, c_base;
+	/* keep static to prevent the timed calls from being eliminated */
+	static u32 crc;
+
+	for (i = 0; i < 100; i++) {
+		bytes += test[i].length;
+
+		if (crc32_le(test[i].crc, test_buf + test[i].start,
+			     test[i].length) !=
+		    crc32_le_base(test[i].crc, test_buf + test[i].start,
+				  test[i].length))
+			errors++;
+		if (__crc32c_le(test[i].crc, test_buf + test[i].start,
+				test[i].length) !=
+		    __crc32c_le_base(test[i].crc, test_buf + test[i].start,
+				     test[i].length))
+			errors++;
+	}
+
+	le = crc32_time(crc32_le, &crc);
+	le_base = crc32_time(crc32_le_base, &crc);
+	c = crc32_time(__crc32c_le, &crc);
+	c_base = crc32_time(__crc32c_le_base, &crc);
+
+	if (errors)
+		pr_warn("crc32_base: %d results differ from generic code\n",
+			errors);
+	pr_info("crc32_base: %d bytes, crc32_le %lld nsec (generic %lld), __crc32c_le %lld nsec (generic %lld)\n",
+		bytes, le, le_base, c, c_base);
+
+	return 0;
+}
+
 static int __init crc32test_init(void)
 {
 	crc32_test();
 	crc32c_test();
+	crc32_base_test();
 
 	crc32_combine_test();
 	crc32c_combine_test();
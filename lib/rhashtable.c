@@ -15,6 +15,7 @@
 #include <linux/kernel.h>
 #include <linux/init.h>
 #include <linux/log2.h>
+#include <linux/math64.h>
 #include <linux/sched.h>
 #include <linux/rculist.h>
 #include <linux/slab.h>
@@ -28,6 +29,8 @@
 
 #define HASH_DEFAULT_SIZE	64UL
 #define HASH_MIN_SIZE		4U
+#define HASH_GROW_PERCENT	75
+#define HASH_SHRINK_PERCENT	30
 
 union nested_table {
 	union nested_table __rcu *table;
@@ -172,6 +175,11 @@ static struct bucket_table *nested_bucket_table_alloc(struct rhashtable *ht,
 	return tbl;
 }
 
+static unsigned int rht_threshold(size_t size, unsigned int percent)
+{
+	return div_u64((u64)size * percent, 100);
+}
+
 static struct bucket_table *bucket_table_alloc(struct rhashtable *ht,
 					       size_t nbuckets,
 					       gfp_t gfp)
@@ -196,6 +204,8 @@ static struct bucket_table *bucket_table_alloc(struct rhashtable *ht,
 	lockdep_init_map(&tbl->dep_map, "rhashtable_bucket", &__key, 0);
 
 	tbl->size = size;
+	tbl->grow_at = rht_threshold(size, ht->p.grow_percent);
+	tbl->shrink_at = rht_threshold(size, ht->p.shrink_percent);
 
 	rcu_head_init(&tbl->rcu);
 	INIT_LIST_HEAD(&tbl->walkers);
@@ -384,17 +394,27 @@ static int rhashtable_rehash_alloc(struct rhashtable *ht,
  * It is valid to have concurrent insertions and deletions protected by per
  * bucket locks or concurrent RCU protected lookups and traversals.
  */
-static int rhashtable_shrink(struct rhashtable *ht)
+static unsigned int rhashtable_fit_size(struct rhashtable *ht,
+					unsigned int nelems)
 {
-	struct bucket_table *old_tbl = rht_dereference(ht->tbl, ht);
-	unsigned int nelems = atomic_read(&ht->nelems);
 	unsigned int size = 0;
 
 	if (nelems)
 		size = roundup_pow_of_two(nelems * 3 / 2);
+	/* a low grow threshold needs more room than that */
+	while (size && nelems > rht_threshold(size, ht->p.grow_percent))
+		size *= 2;
 	if (size < ht->p.min_size)
 		size = ht->p.min_size;
 
+	return size;
+}
+
+static int rhashtable_shrink(struct rhashtable *ht)
+{
+	struct bucket_table *old_tbl = rht_dereference(ht->tbl, ht);
+	unsigned int size = rhashtable_fit_size(ht, atomic_read(&ht->nelems));
+
 	if (old_tbl->size <= size)
 		return 0;
 
@@ -641,6 +661,63 @@ void *rhashtable_insert_slow(struct rhashtable *ht, const void *key,
 }
 EXPORT_SYMBOL_GPL(rhashtable_insert_slow);
 
+/**
+ * rhashtable_reserve - grow the table ahead of inserts
+ * @ht:		hash table
+ * @nelems:	number of objects about to be inserted
+ *
+ * Grows the table right away so that @nelems more objects fit below the
+ * grow threshold, capped at p.max_size, and moves the existing objects
+ * over before returning.  The inserts that follow then go straight into
+ * the final table rather than taking bucket locks in two tables while the
+ * deferred worker catches up.
+ *
+ * Must be called from process context.
+ *
+ * Returns zero on success or -ENOMEM if the new table could not be
+ * allocated, in which case the table grows on demand as usual.
+ */
+int rhashtable_reserve(struct rhashtable *ht, unsigned int nelems)
+{
+	struct bucket_table *tbl, *old_tbl;
+	unsigned int size;
+	int err = 0;
+
+	might_sleep();
+
+	size = rhashtable_fit_size(ht, atomic_read(&ht->nelems) + nelems);
+	if (ht->p.max_size && size > ht->p.max_size)
+		size = ht->p.max_size;
+
+	mutex_lock(&ht->mutex);
+
+	tbl = rhashtable_last_table(ht, rht_dereference(ht->tbl, ht));
+	if (size > tbl->size) {
+		err = rhashtable_rehash_alloc(ht, tbl, size);
+		/* an insert attached a future table first, rehash into it */
+		if (err == -EEXIST)
+			err = 0;
+	}
+
+	if (!err) {
+		do {
+			old_tbl = rht_dereference(ht->tbl, ht);
+			err = rhashtable_rehash_table(ht);
+		} while (err == -EAGAIN && rht_dereference(ht->tbl, ht) != old_tbl);
+
+		/* a nested table is stuck, leave it to the worker */
+		if (err) {
+			schedule_work(&ht->run_work);
+			err = 0;
+		}
+	}
+
+	mutex_unlock(&ht->mutex);
+
+	return err;
+}
+EXPORT_SYMBOL_GPL(rhashtable_reserve);
+
 /**
  * rhashtable_walk_enter - Initialise an iterator
  * @ht:		Table to walk over
@@ -1011,6 +1088,10 @@ static u32 rhashtable_jhash2(const void *key, u32 length, u32 seed)
  *	.hashfn = jhash,
  *	.obj_hashfn = my_hash_fn,
  * };
+ *
+ * Tables that take bursts of inserts can lower grow_percent to resize
+ * earlier, and size up front for a burst with rhashtable_reserve() or
+ * rhashtable_insert_bulk().
  */
 int rhashtable_init(struct rhashtable *ht,
 		    const struct rhashtable_params *params)
@@ -1027,6 +1108,17 @@ int rhashtable_init(struct rhashtable *ht,
 	spin_lock_init(&ht->lock);
 	memcpy(&ht->p, params, sizeof(*params));
 
+	if (!ht->p.grow_percent)
+		ht->p.grow_percent = HASH_GROW_PERCENT;
+	if (!ht->p.shrink_percent)
+		ht->p.shrink_percent = min(HASH_SHRINK_PERCENT,
+					   ht->p.grow_percent / 2 - 1);
+
+	/* a doubled or halved table must land between the two thresholds */
+	if (ht->p.grow_percent < 50 || ht->p.grow_percent > 90 ||
+	    ht->p.shrink_percent * 2 >= ht->p.grow_percent)
+		return -EINVAL;
+
 	if (params->min_size)
 		ht->p.min_size = roundup_pow_of_two(params->min_size);
 
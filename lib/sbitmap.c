@@ -441,6 +441,54 @@ int __sbitmap_queue_get(struct sbitmap_queue *sbq)
 }
 EXPORT_SYMBOL_GPL(__sbitmap_queue_get);
 
+unsigned long __sbitmap_queue_get_batch(struct sbitmap_queue *sbq, int nr_tags,
+					unsigned int *offset)
+{
+	struct sbitmap *sb = &sbq->sb;
+	unsigned int hint, depth, index, i;
+
+	if (unlikely(sbq->round_robin))
+		return 0;
+
+	hint = this_cpu_read(*sbq->alloc_hint);
+	depth = READ_ONCE(sb->depth);
+	if (unlikely(hint >= depth))
+		hint = 0;
+	index = SB_NR_TO_INDEX(sb, hint);
+
+	for (i = 0; i < sb->map_nr; i++) {
+		struct sbitmap_word *map = &sb->map[index];
+		unsigned long get_mask, old;
+		unsigned int nr, map_tags;
+
+		sbitmap_deferred_clear(map);
+		nr = find_first_zero_bit(&map->word, map->depth);
+		if (nr < map->depth) {
+			map_tags = min_t(unsigned int, nr_tags,
+					 map->depth - nr);
+			get_mask = GENMASK(nr + map_tags - 1, nr);
+			old = atomic_long_fetch_or_acquire(get_mask,
+					(atomic_long_t *)&map->word);
+			get_mask &= ~old;
+			if (get_mask) {
+				*offset = index << sb->shift;
+				hint = *offset + nr + map_tags;
+				if (hint >= depth - 1)
+					hint = 0;
+				this_cpu_write(*sbq->alloc_hint, hint);
+				return get_mask;
+			}
+		}
+
+		/* Jump to next index. */
+		if (++index >= sb->map_nr)
+			index = 0;
+	}
+
+	return 0;
+}
+EXPORT_SYMBOL_GPL(__sbitmap_queue_get_batch);
+
 int __sbitmap_queue_get_shallow(struct sbitmap_queue *sbq,
 				unsigned int shallow_depth)
 {
@@ -581,6 +629,41 @@ void sbitmap_queue_clear(struct sbitmap_queue *sbq, unsigned int nr,
 }
 EXPORT_SYMBOL_GPL(sbitmap_queue_clear);
 
+void sbitmap_queue_clear_batch(struct sbitmap_queue *sbq, int offset,
+			       int *tags, int nr_tags)
+{
+	struct sbitmap *sb = &sbq->sb;
+	unsigned long *cleared = NULL;
+	unsigned long mask = 0;
+	int i, nr;
+
+	/* Same ordering rules as sbitmap_queue_clear(), one word at a time */
+	smp_mb__before_atomic();
+	for (i = 0; i < nr_tags; i++) {
+		unsigned long *this_cleared;
+
+		nr = tags[i] - offset;
+		this_cleared = &sb->map[SB_NR_TO_INDEX(sb, nr)].cleared;
+		if (cleared && cleared != this_cleared) {
+			atomic_long_or(mask, (atomic_long_t *)cleared);
+			mask = 0;
+		}
+		cleared = this_cleared;
+		mask |= 1UL << SB_NR_TO_BIT(sb, nr);
+	}
+	if (mask)
+		atomic_long_or(mask, (atomic_long_t *)cleared);
+	smp_mb__after_atomic();
+
+	for (i = 0; i < nr_tags; i++)
+		sbitmap_queue_wake_up(sbq);
+
+	nr = tags[nr_tags - 1] - offset;
+	if (likely(!sbq->round_robin && nr < sb->depth))
+		*per_cpu_ptr(sbq->alloc_hint, raw_smp_processor_id()) = nr;
+}
+EXPORT_SYMBOL_GPL(sbitmap_queue_clear_batch);
+
 void sbitmap_queue_wake_all(struct sbitmap_queue *sbq)
 {
 	int i, wake_index;
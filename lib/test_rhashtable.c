@@ -20,6 +20,7 @@
 #include <linux/slab.h>
 #include <linux/sched.h>
 #include <linux/random.h>
+#include <linux/sort.h>
 #include <linux/vmalloc.h>
 #include <linux/wait.h>
 
@@ -50,6 +51,10 @@ static int tcount = 10;
 module_param(tcount, int, 0);
 MODULE_PARM_DESC(tcount, "Number of threads to spawn (default: 10)");
 
+static int grow_percent;
+module_param(grow_percent, int, 0);
+MODULE_PARM_DESC(grow_percent, "Load percentage the table grows at (default: 75)");
+
 static bool enomem_retry = false;
 module_param(enomem_retry, bool, 0);
 MODULE_PARM_DESC(enomem_retry, "Retry insert even if -ENOMEM was returned (default: off)");
@@ -445,6 +450,111 @@ static int __init test_rhltable(unsigned int entries)
 	return ret;
 }
 
+static int __init cmp_u64(const void *a, const void *b)
+{
+	u64 x = *(const u64 *)a, y = *(const u64 *)b;
+
+	return x < y ? -1 : x > y;
+}
+
+/*
+ * Time every single insert into a table that starts out small, once with
+ * the table growing on demand and once sized up front by
+ * rhashtable_reserve(), and report the latency percentiles of both.
+ */
+static int __init test_rht_insert_latency(struct test_obj *array,
+					  unsigned int entries)
+{
+	static const char * const mode[] = { "on demand", "reserved" };
+	unsigned int i, m;
+	s64 reserve = 0;
+	u64 *lat;
+	int err = 0;
+
+	lat = vmalloc(array_size(entries, sizeof(*lat)));
+	if (!lat)
+		return -ENOMEM;
+
+	for (m = 0; m < ARRAY_SIZE(mode) && !err; m++) {
+		memset(array, 0, entries * sizeof(*array));
+
+		err = rhashtable_init(&ht, &test_rht_params);
+		if (err)
+			break;
+
+		if (m) {
+			reserve = ktime_get_ns();
+			err = rhashtable_reserve(&ht, entries);
+			reserve = ktime_get_ns() - reserve;
+		}
+
+		for (i = 0; i < entries && !err; i++) {
+			s64 start;
+
+			array[i].value.id = i * 2;
+			start = ktime_get_ns();
+			err = insert_retry(&ht, &array[i], test_rht_params);
+			lat[i] = ktime_get_ns() - start;
+			if (err > 0)
+				err = 0;
+		}
+
+		rhashtable_destroy(&ht);
+		if (err)
+			break;
+
+		sort(lat, entries, sizeof(*lat), cmp_u64, NULL);
+		pr_info("  insert latency %s: p50 %llu p90 %llu p99 %llu p99.9 %llu max %llu ns\n",
+			mode[m], lat[entries / 2], lat[entries * 9ULL / 10],
+			lat[entries * 99ULL / 100], lat[entries * 999ULL / 1000],
+			lat[entries - 1]);
+	}
+
+	if (!err)
+		pr_info("  reserving %u entries took %lld ns\n", entries, reserve);
+
+	vfree(lat);
+	return err;
+}
+
+/*
+ * rhashtable_insert_bulk() must insert all objects or none: a duplicate
+ * key at the end of the batch has to take the rest of it out again.
+ */
+static int __init test_rht_insert_bulk(struct test_obj *array)
+{
+	struct rhash_head *objs[16];
+	unsigned int i;
+	int err;
+
+	memset(array, 0, ARRAY_SIZE(objs) * sizeof(*array));
+	for (i = 0; i < ARRAY_SIZE(objs); i++) {
+		array[i].value.id = i == ARRAY_SIZE(objs) - 1 ? 0 : i * 2;
+		objs[i] = &array[i].node;
+	}
+
+	err = rhashtable_init(&ht, &test_rht_params);
+	if (err)
+		return err;
+
+	err = rhashtable_insert_bulk(&ht, objs, ARRAY_SIZE(objs),
+				     test_rht_params);
+	if (err != -EEXIST || atomic_read(&ht.nelems)) {
+		pr_warn("bulk insert with duplicate returned %d, %u left\n",
+			err, atomic_read(&ht.nelems));
+		err = -EINVAL;
+		goto out;
+	}
+
+	err = rhashtable_insert_bulk(&ht, objs, ARRAY_SIZE(objs) - 1,
+				     test_rht_params);
+	if (!err && atomic_read(&ht.nelems) != ARRAY_SIZE(objs) - 1)
+		err = -EINVAL;
+out:
+	rhashtable_destroy(&ht);
+	return err;
+}
+
 static int __init test_rhashtable_max(struct test_obj *array,
 				      unsigned int entries)
 {
@@ -709,6 +819,7 @@ static int __init test_rht_init(void)
 	test_rht_params.automatic_shrinking = shrinking;
 	test_rht_params.max_size = max_size ? : roundup_pow_of_two(entries);
 	test_rht_params.nelem_hint = size;
+	test_rht_params.grow_percent = grow_percent;
 
 	objs = vzalloc(array_size(sizeof(struct test_obj),
 				  test_rht_params.max_size + 1));
@@ -742,6 +853,16 @@ static int __init test_rht_init(void)
 		total_time += time;
 	}
 
+	pr_info("Insert latency while growing from %d to %u entries:\n",
+		size, entries);
+	err = test_rht_insert_latency(objs, entries);
+	if (err)
+		pr_warn("Test failed: insert latency returned %d\n", err);
+
+	err = test_rht_insert_bulk(objs);
+	pr_info("bulk insert is all or nothing: %s\n",
+		err ? "no, failed" : "yes, ok");
+
 	pr_info("test if its possible to exceed max_size %d: %s\n",
 			test_rht_params.max_size, test_rhashtable_max(objs, entries) == 0 ?
 			"no, ok" : "YES, failed");
@@ -0,0 +1,335 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * Sampling allocation profiler
+ *
+ * One in sample_interval page and slab allocations records its stack in
+ * the stack depot, and is followed until it is freed. What is still live
+ * is summed per allocation stack in debugfs alloc_profile/sites, which is
+ * what slowly growing memory use shows up in. Allocations that are not
+ * sampled only pay for a per-cpu decrement, and frees for one look at an
+ * almost always empty hash bucket, so this can be left on in the field.
+ *
+ * Boot with alloc_profile=<interval>, or write the interval to
+ * alloc_profile/sample_interval; 0 stops profiling and drops the data.
+ */
+
+#include <linux/debugfs.h>
+#include <linux/hash.h>
+#include <linux/init.h>
+#include <linux/jump_label.h>
+#include <linux/kernel.h>
+#include <linux/mm.h>
+#include <linux/mutex.h>
+#include <linux/seq_file.h>
+#include <linux/spinlock.h>
+#include <linux/stackdepot.h>
+#include <linux/stacktrace.h>
+#include <linux/uaccess.h>
+#include <linux/vmalloc.h>
+#include <linux/alloc_profile.h>
+
+#define ALLOC_PROFILE_STACK_DEPTH	16
+#define ALLOC_PROFILE_RECORDS		4096
+#define ALLOC_PROFILE_SITES		1024
+#define ALLOC_PROFILE_RECORD_BITS	10
+#define ALLOC_PROFILE_SITE_BITS		8
+
+struct alloc_profile_site {
+	struct hlist_node node;
+	depot_stack_handle_t handle;
+	unsigned long live_bytes;
+	unsigned long live;
+	unsigned long total;
+};
+
+struct alloc_profile_record {
+	struct hlist_node node;
+	const void *ptr;
+	size_t size;
+	struct alloc_profile_site *site;
+};
+
+DEFINE_STATIC_KEY_FALSE(alloc_profile_key);
+DEFINE_PER_CPU(int, alloc_profile_countdown);
+
+static unsigned int alloc_profile_interval;
+static bool alloc_profile_on;
+static unsigned long alloc_profile_dropped;
+
+static DEFINE_MUTEX(alloc_profile_mutex);
+static DEFINE_SPINLOCK(alloc_profile_lock);
+
+static struct alloc_profile_record *records;
+static struct alloc_profile_site *sites;
+static unsigned int nr_sites;
+static HLIST_HEAD(free_records);
+static struct hlist_head record_hash[1 << ALLOC_PROFILE_RECORD_BITS];
+static struct hlist_head site_hash[1 << ALLOC_PROFILE_SITE_BITS];
+
+static int __init early_alloc_profile_param(char *buf)
+{
+	return kstrtouint(buf, 0, &alloc_profile_interval);
+}
+early_param("alloc_profile", early_alloc_profile_param);
+
+static inline struct hlist_head *record_bucket(const void *ptr)
+{
+	return &record_hash[hash_ptr(ptr, ALLOC_PROFILE_RECORD_BITS)];
+}
+
+static noinline depot_stack_handle_t save_stack(gfp_t flags)
+{
+	unsigned long entries[ALLOC_PROFILE_STACK_DEPTH];
+	unsigned int nr_entries, i;
+
+	nr_entries = stack_trace_save(entries, ARRAY_SIZE(entries), 2);
+
+	/*
+	 * Saving a new stack can allocate, and that allocation can come
+	 * back here; as in page_owner, give up on the sample rather than
+	 * go round again.
+	 */
+	for (i = 0; i < nr_entries; i++)
+		if (entries[i] == _RET_IP_)
+			return 0;
+
+	return stack_depot_save(entries, nr_entries, flags);
+}
+
+/* Called with alloc_profile_lock held */
+static struct alloc_profile_site *get_site(depot_stack_handle_t handle)
+{
+	struct hlist_head *head;
+	struct alloc_profile_site *site;
+
+	head = &site_hash[hash_32(handle, ALLOC_PROFILE_SITE_BITS)];
+	hlist_for_each_entry(site, head, node)
+		if (site->handle == handle)
+			return site;
+
+	if (nr_sites == ALLOC_PROFILE_SITES)
+		return NULL;
+
+	site = &sites[nr_sites++];
+	site->handle = handle;
+	hlist_add_head(&site->node, head);
+	return site;
+}
+
+void __alloc_profile_sample(const void *ptr, size_t size, gfp_t gfp)
+{
+	struct alloc_profile_record *rec;
+	struct alloc_profile_site *site;
+	depot_stack_handle_t handle;
+	unsigned long flags;
+
+	this_cpu_write(alloc_profile_countdown,
+		       READ_ONCE(alloc_profile_interval));
+	if (!ptr)
+		return;
+
+	handle = save_stack(gfp);
+	if (!handle)
+		return;
+
+	spin_lock_irqsave(&alloc_profile_lock, flags);
+	if (!alloc_profile_on)
+		goto unlock;
+
+	site = get_site(handle);
+	if (!site || hlist_empty(&free_records)) {
+		alloc_profile_dropped++;
+		goto unlock;
+	}
+
+	rec = hlist_entry(free_records.first, struct alloc_profile_record,
+			  node);
+	hlist_del(&rec->node);
+	rec->ptr = ptr;
+	rec->size = size;
+	rec->site = site;
+	hlist_add_head(&rec->node, record_bucket(ptr));
+
+	site->live_bytes += size;
+	site->live++;
+	site->total++;
+unlock:
+	spin_unlock_irqrestore(&alloc_profile_lock, flags);
+}
+
+void __alloc_profile_free(const void *ptr)
+{
+	struct hlist_head *head = record_bucket(ptr);
+	struct alloc_profile_record *rec;
+	unsigned long flags;
+
+	/* Nearly every free is of an unsampled object */
+	if (!READ_ONCE(head->first))
+		return;
+
+	spin_lock_irqsave(&alloc_profile_lock, flags);
+	hlist_for_each_entry(rec, head, node) {
+		if (rec->ptr != ptr)
+			continue;
+
+		rec->site->live_bytes -= rec->size;
+		rec->site->live--;
+		hlist_del(&rec->node);
+		hlist_add_head(&rec->node, &free_records);
+		break;
+	}
+	spin_unlock_irqrestore(&alloc_profile_lock, flags);
+}
+
+/* Called with alloc_profile_mutex held */
+static void alloc_profile_reset(void)
+{
+	unsigned long flags;
+	int i;
+
+	spin_lock_irqsave(&alloc_profile_lock, flags);
+	for (i = 0; i < ARRAY_SIZE(record_hash); i++)
+		INIT_HLIST_HEAD(&record_hash[i]);
+	for (i = 0; i < ARRAY_SIZE(site_hash); i++)
+		INIT_HLIST_HEAD(&site_hash[i]);
+	INIT_HLIST_HEAD(&free_records);
+	for (i = 0; i < ALLOC_PROFILE_RECORDS; i++)
+		hlist_add_head(&records[i].node, &free_records);
+	memset(sites, 0, ALLOC_PROFILE_SITES * sizeof(*sites));
+	nr_sites = 0;
+	alloc_profile_dropped = 0;
+	spin_unlock_irqrestore(&alloc_profile_lock, flags);
+}
+
+static int alloc_profile_set_interval(unsigned int interval)
+{
+	unsigned long flags;
+	int ret = 0;
+
+	mutex_lock(&alloc_profile_mutex);
+	if (interval && !records) {
+		records = vzalloc(ALLOC_PROFILE_RECORDS * sizeof(*records));
+		sites = vzalloc(ALLOC_PROFILE_SITES * sizeof(*sites));
+		if (!records || !sites) {
+			vfree(records);
+			vfree(sites);
+			records = NULL;
+			sites = NULL;
+			ret = -ENOMEM;
+			goto unlock;
+		}
+	}
+
+	if (interval && !alloc_profile_on) {
+		alloc_profile_reset();
+		spin_lock_irqsave(&alloc_profile_lock, flags);
+		alloc_profile_on = true;
+		spin_unlock_irqrestore(&alloc_profile_lock, flags);
+		WRITE_ONCE(alloc_profile_interval, interval);
+		static_branch_enable(&alloc_profile_key);
+	} else if (!interval && alloc_profile_on) {
+		static_branch_disable(&alloc_profile_key);
+		spin_lock_irqsave(&alloc_profile_lock, flags);
+		alloc_profile_on = false;
+		spin_unlock_irqrestore(&alloc_profile_lock, flags);
+		WRITE_ONCE(alloc_profile_interval, 0);
+		/* frees are no longer seen, what is recorded went stale */
+		alloc_profile_reset();
+	} else {
+		WRITE_ONCE(alloc_profile_interval, interval);
+	}
+unlock:
+	mutex_unlock(&alloc_profile_mutex);
+	return ret;
+}
+
+static int sample_interval_get(void *data, u64 *val)
+{
+	*val = READ_ONCE(alloc_profile_interval);
+	return 0;
+}
+
+static int sample_interval_set(void *data, u64 val)
+{
+	if (val > UINT_MAX)
+		return -EINVAL;
+	return alloc_profile_set_interval(val);
+}
+DEFINE_DEBUGFS_ATTRIBUTE(sample_interval_fops, sample_interval_get,
+			 sample_interval_set, "%llu\n");
+
+static void *sites_start(struct seq_file *m, loff_t *pos)
+{
+	mutex_lock(&alloc_profile_mutex);
+	if (!alloc_profile_on || *pos >= READ_ONCE(nr_sites))
+		return NULL;
+	return &sites[*pos];
+}
+
+static void *sites_next(struct seq_file *m, void *v, loff_t *pos)
+{
+	++*pos;
+	if (*pos >= READ_ONCE(nr_sites))
+		return NULL;
+	return &sites[*pos];
+}
+
+static void sites_stop(struct seq_file *m, void *v)
+{
+	mutex_unlock(&alloc_profile_mutex);
+}
+
+static int sites_show(struct seq_file *m, void *v)
+{
+	struct alloc_profile_site *site = v, snap;
+	unsigned long *entries;
+	unsigned long flags;
+	unsigned int nr_entries, i;
+
+	spin_lock_irqsave(&alloc_profile_lock, flags);
+	snap = *site;
+	spin_unlock_irqrestore(&alloc_profile_lock, flags);
+
+	if (!snap.live)
+		return 0;
+
+	seq_printf(m, "%lu bytes in %lu of %lu sampled allocations, about %llu bytes\n",
+		   snap.live_bytes, snap.live, snap.total,
+		   (u64)snap.live_bytes * READ_ONCE(alloc_profile_interval));
+
+	nr_entries = stack_depot_fetch(snap.handle, &entries);
+	for (i = 0; i < nr_entries; i++)
+		seq_printf(m, " %pS\n", (void *)entries[i]);
+	seq_putc(m, '\n');
+
+	return 0;
+}
+
+static const struct seq_operations sites_sops = {
+	.start = sites_start,
+	.next = sites_next,
+	.stop = sites_stop,
+	.show = sites_show,
+};
+DEFINE_SEQ_ATTRIBUTE(sites);
+
+static int __init alloc_profile_init(void)
+{
+	struct dentry *dir;
+
+	dir = debugfs_create_dir("alloc_profile", NULL);
+	debugfs_create_file_unsafe("sample_interval", 0600, dir, NULL,
+				   &sample_interval_fops);
+	debugfs_create_file("sites", 0400, dir, NULL, &sites_fops);
+	debugfs_create_ulong("dropped", 0400, dir, &alloc_profile_dropped);
+
+	if (alloc_profile_interval) {
+		unsigned int interval = alloc_profile_interval;
+
+		alloc_profile_interval = 0;
+		alloc_profile_set_interval(interval);
+	}
+
+	return 0;
+}
+late_initcall(alloc_profile_init);
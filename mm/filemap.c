@@ -135,7 +135,10 @@ static void page_cache_delete(struct address_space *mapping,
 
 	VM_BUG_ON_PAGE(!PageLocked(page), page);
 	VM_BUG_ON_PAGE(PageTail(page), page);
-	VM_BUG_ON_PAGE(nr != 1 && shadow, page);
+
+	/* Large pages leave no shadow: a refault is read back as small pages */
+	if (nr != 1)
+		shadow = NULL;
 
 	xas_store(&xas, shadow);
 	xas_init_marks(&xas);
@@ -831,14 +834,23 @@ noinline int __add_to_page_cache_locked(struct page *page,
 {
 	XA_STATE(xas, &mapping->i_pages, offset);
 	int huge = PageHuge(page);
+	unsigned int nr = 1;
 	int error;
 	bool charged = false;
 
 	VM_BUG_ON_PAGE(!PageLocked(page), page);
 	VM_BUG_ON_PAGE(PageSwapBacked(page), page);
+	VM_BUG_ON_PAGE(PageTail(page), page);
 	mapping_set_update(&xas, mapping);
 
-	get_page(page);
+	/* hugetlb pages are represented by a single entry in the xarray */
+	if (!huge) {
+		xas_set_order(&xas, offset, thp_order(page));
+		nr = thp_nr_pages(page);
+	}
+	VM_BUG_ON_PAGE(offset & (nr - 1), page);
+
+	page_ref_add(page, nr);
 	page->mapping = mapping;
 	page->index = offset;
 
@@ -853,6 +865,7 @@ noinline int __add_to_page_cache_locked(struct page *page,
 
 	do {
 		unsigned int order = xa_get_order(xas.xa, xas.xa_index);
+		unsigned long shadows = 0;
 		void *entry, *old = NULL;
 
 		if (order > thp_order(page))
@@ -865,6 +878,7 @@ noinline int __add_to_page_cache_locked(struct page *page,
 				xas_set_err(&xas, -EEXIST);
 				goto unlock;
 			}
+			shadows++;
 		}
 
 		if (old) {
@@ -882,13 +896,17 @@ noinline int __add_to_page_cache_locked(struct page *page,
 		if (xas_error(&xas))
 			goto unlock;
 
-		if (old)
-			mapping->nrexceptional--;
-		mapping->nrpages++;
+		mapping->nrexceptional -= shadows;
+		mapping->nrpages += nr;
 
 		/* hugetlb pages do not participate in page cache accounting */
-		if (!huge)
-			__inc_lruvec_page_state(page, NR_FILE_PAGES);
+		if (!huge) {
+			__mod_lruvec_page_state(page, NR_FILE_PAGES, nr);
+			if (PageTransHuge(page)) {
+				__mod_lruvec_page_state(page, NR_FILE_THPS, nr);
+				filemap_nr_thps_inc(mapping);
+			}
+		}
 unlock:
 		xas_unlock_irq(&xas);
 	} while (xas_nomem(&xas, gfp));
@@ -905,6 +923,7 @@ noinline int __add_to_page_cache_locked(struct page *page,
 error:
 	page->mapping = NULL;
 	/* Leave page->index set: truncation relies upon it */
+	page_ref_sub(page, nr - 1);
 	put_page(page);
 	return error;
 }
@@ -18,6 +18,7 @@
 #include <linux/page_idle.h>
 #include <linux/swapops.h>
 #include <linux/shmem_fs.h>
+#include <linux/list_sort.h>
 
 #include <asm/tlb.h>
 #include <asm/pgalloc.h>
@@ -67,6 +68,8 @@ static unsigned int khugepaged_scan_sleep_millisecs __read_mostly = 10000;
 /* during fragmentation poll the hugepage allocator once every minute */
 static unsigned int khugepaged_alloc_sleep_millisecs __read_mostly = 60000;
 static unsigned long khugepaged_sleep_expire;
+/* An MADV_COLLAPSE request cuts the current scan sleep short */
+static bool khugepaged_collapse_pending;
 static DEFINE_SPINLOCK(khugepaged_mm_lock);
 static DECLARE_WAIT_QUEUE_HEAD(khugepaged_wait);
 /*
@@ -92,6 +95,8 @@ static struct kmem_cache *mm_slot_cache __read_mostly;
  * @mm: the mm that this information is valid for
  * @nr_pte_mapped_thp: number of pte mapped THP
  * @pte_mapped_thp: address array corresponding pte mapped THP
+ * @nr_referenced: young ptes under small pages seen on the current visit
+ * @hotness: decaying average of @nr_referenced over past visits
  */
 struct mm_slot {
 	struct hlist_node hash;
@@ -101,6 +106,9 @@ struct mm_slot {
 	/* pte-mapped THP in this mm */
 	int nr_pte_mapped_thp;
 	unsigned long pte_mapped_thp[MAX_PTE_MAPPED_THP];
+
+	unsigned int nr_referenced;
+	unsigned int hotness;
 };
 
 /**
@@ -344,11 +352,14 @@ struct attribute_group khugepaged_attr_group = {
 };
 #endif /* CONFIG_SYSFS */
 
+static void khugepaged_request_collapse(struct mm_struct *mm);
+
 int hugepage_madvise(struct vm_area_struct *vma,
 		     unsigned long *vm_flags, int advice)
 {
 	switch (advice) {
 	case MADV_HUGEPAGE:
+	case MADV_COLLAPSE:
 #ifdef CONFIG_S390
 		/*
 		 * qemu blindly sets MADV_HUGEPAGE on all allocations, but s390
@@ -368,6 +379,8 @@ int hugepage_madvise(struct vm_area_struct *vma,
 		if (!(*vm_flags & VM_NO_KHUGEPAGED) &&
 				khugepaged_enter_vma_merge(vma, *vm_flags))
 			return -ENOMEM;
+		if (advice == MADV_COLLAPSE)
+			khugepaged_request_collapse(vma->vm_mm);
 		break;
 	case MADV_NOHUGEPAGE:
 		*vm_flags &= ~VM_HUGEPAGE;
@@ -434,6 +447,29 @@ static void insert_to_mm_slots_hash(struct mm_struct *mm,
 	hash_add(mm_slots_hash, &mm_slot->hash, (long)mm);
 }
 
+/*
+ * Queue @mm right behind the mm being scanned, so its visit starts next,
+ * and wake khugepaged up.  The collapse itself stays asynchronous.
+ */
+static void khugepaged_request_collapse(struct mm_struct *mm)
+{
+	struct mm_slot *mm_slot;
+
+	spin_lock(&khugepaged_mm_lock);
+	mm_slot = get_mm_slot(mm);
+	if (mm_slot && mm_slot != khugepaged_scan.mm_slot) {
+		if (khugepaged_scan.mm_slot)
+			list_move(&mm_slot->mm_node,
+				  &khugepaged_scan.mm_slot->mm_node);
+		else
+			list_move(&mm_slot->mm_node, &khugepaged_scan.mm_head);
+	}
+	spin_unlock(&khugepaged_mm_lock);
+
+	WRITE_ONCE(khugepaged_collapse_pending, true);
+	wake_up_interruptible(&khugepaged_wait);
+}
+
 static inline int khugepaged_test_exit(struct mm_struct *mm)
 {
 	return atomic_read(&mm->mm_users) == 0;
@@ -1221,7 +1257,8 @@ static void collapse_huge_page(struct mm_struct *mm,
 static int khugepaged_scan_pmd(struct mm_struct *mm,
 			       struct vm_area_struct *vma,
 			       unsigned long address,
-			       struct page **hpage)
+			       struct page **hpage,
+			       unsigned int *nr_referenced)
 {
 	pmd_t *pmd;
 	pte_t *pte, *_pte;
@@ -1367,6 +1404,7 @@ static int khugepaged_scan_pmd(struct mm_struct *mm,
 	}
 out_unmap:
 	pte_unmap_unlock(pte, ptl);
+	*nr_referenced += referenced;
 	if (ret) {
 		node = khugepaged_find_target_node();
 		/* collapse_huge_page will return with the mmap_lock released */
@@ -2061,6 +2099,15 @@ static int khugepaged_collapse_pte_mapped_thps(struct mm_slot *mm_slot)
 }
 #endif
 
+static int mm_slot_hotness_cmp(void *priv, struct list_head *a,
+			       struct list_head *b)
+{
+	struct mm_slot *sa = list_entry(a, struct mm_slot, mm_node);
+	struct mm_slot *sb = list_entry(b, struct mm_slot, mm_node);
+
+	return sa->hotness < sb->hotness;
+}
+
 static unsigned int khugepaged_scan_mm_slot(unsigned int pages,
 					    struct page **hpage)
 	__releases(&khugepaged_mm_lock)
@@ -2143,7 +2190,7 @@ static unsigned int khugepaged_scan_mm_slot(unsigned int pages,
 			} else {
 				ret = khugepaged_scan_pmd(mm, vma,
 						khugepaged_scan.address,
-						hpage);
+						hpage, &mm_slot->nr_referenced);
 			}
 			/* move to next address */
 			khugepaged_scan.address += HPAGE_PMD_SIZE;
@@ -2166,6 +2213,12 @@ static unsigned int khugepaged_scan_mm_slot(unsigned int pages,
 	 * if we scanned all vmas of this mm.
 	 */
 	if (khugepaged_test_exit(mm) || !vma) {
+		bool wrapped = false;
+
+		mm_slot->hotness = (mm_slot->hotness +
+				    mm_slot->nr_referenced) / 2;
+		mm_slot->nr_referenced = 0;
+
 		/*
 		 * Make sure that if mm_users is reaching zero while
 		 * khugepaged runs here, khugepaged_exit will find
@@ -2179,9 +2232,18 @@ static unsigned int khugepaged_scan_mm_slot(unsigned int pages,
 		} else {
 			khugepaged_scan.mm_slot = NULL;
 			khugepaged_full_scans++;
+			wrapped = true;
 		}
 
 		collect_mm_slot(mm_slot);
+
+		/*
+		 * Start the next pass with the mms that showed the most
+		 * recently accessed memory still mapped by small pages.
+		 */
+		if (wrapped)
+			list_sort(NULL, &khugepaged_scan.mm_head,
+				  mm_slot_hotness_cmp);
 	}
 
 	return progress;
@@ -2208,6 +2270,8 @@ static void khugepaged_do_scan(void)
 
 	barrier(); /* write khugepaged_pages_to_scan to local stack */
 
+	WRITE_ONCE(khugepaged_collapse_pending, false);
+
 	lru_add_drain_all();
 
 	while (progress < pages) {
@@ -2238,6 +2302,7 @@ static void khugepaged_do_scan(void)
 static bool khugepaged_should_wakeup(void)
 {
 	return kthread_should_stop() ||
+	       READ_ONCE(khugepaged_collapse_pending) ||
 	       time_after_eq(jiffies, khugepaged_sleep_expire);
 }
 
@@ -122,6 +122,7 @@ static long madvise_behavior(struct vm_area_struct *vma,
 		break;
 	case MADV_HUGEPAGE:
 	case MADV_NOHUGEPAGE:
+	case MADV_COLLAPSE:
 		error = hugepage_madvise(vma, &new_flags, behavior);
 		if (error)
 			goto out_convert_errno;
@@ -962,6 +963,7 @@ madvise_behavior_valid(int behavior)
 #ifdef CONFIG_TRANSPARENT_HUGEPAGE
 	case MADV_HUGEPAGE:
 	case MADV_NOHUGEPAGE:
+	case MADV_COLLAPSE:
 #endif
 	case MADV_DONTDUMP:
 	case MADV_DODUMP:
@@ -984,6 +986,9 @@ process_madvise_behavior_valid(int behavior)
 	switch (behavior) {
 	case MADV_COLD:
 	case MADV_PAGEOUT:
+#ifdef CONFIG_TRANSPARENT_HUGEPAGE
+	case MADV_COLLAPSE:
+#endif
 		return true;
 	default:
 		return false;
@@ -1034,6 +1039,9 @@ process_madvise_behavior_valid(int behavior)
  *  MADV_NOHUGEPAGE - mark the given range as not worth being backed by
  *		transparent huge pages so the existing pages will not be
  *		coalesced into THP and new pages will not be allocated as THP.
+ *  MADV_COLLAPSE - like MADV_HUGEPAGE, and also move the process to the
+ *		front of khugepaged's queue so that existing pages in the
+ *		range are coalesced into THP without waiting for a full scan.
  *  MADV_DONTDUMP - the application wants to prevent pages in the given range
  *		from being included in its core dump.
  *  MADV_DODUMP - cancel MADV_DONTDUMP: no longer exclude from core dump.
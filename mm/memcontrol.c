@@ -85,6 +85,15 @@ static bool cgroup_memory_nosocket;
 /* Kernel memory accounting disabled? */
 static bool cgroup_memory_nokmem;
 
+/*
+ * Pages charged ahead into the per-cpu stock, and the per-cpu drift the
+ * batched statistics may accumulate before being folded into the
+ * hierarchy.  A larger batch makes charging and stat updates cheaper,
+ * at the cost of up to memcg_charge_batch pages per CPU of overcharge
+ * and of staleness in each counter.
+ */
+static unsigned int memcg_charge_batch __read_mostly = MEMCG_CHARGE_BATCH;
+
 /* Whether the swap controller is active */
 #ifdef CONFIG_MEMCG_SWAP
 bool cgroup_memory_noswap __read_mostly;
@@ -764,7 +773,7 @@ mem_cgroup_largest_soft_limit_node(struct mem_cgroup_tree_per_node *mctz)
  */
 void __mod_memcg_state(struct mem_cgroup *memcg, int idx, int val)
 {
-	long x, threshold = MEMCG_CHARGE_BATCH;
+	long x, threshold = memcg_charge_batch;
 
 	if (mem_cgroup_disabled())
 		return;
@@ -804,7 +813,7 @@ void __mod_memcg_lruvec_state(struct lruvec *lruvec, enum node_stat_item idx,
 {
 	struct mem_cgroup_per_node *pn;
 	struct mem_cgroup *memcg;
-	long x, threshold = MEMCG_CHARGE_BATCH;
+	long x, threshold = memcg_charge_batch;
 
 	pn = container_of(lruvec, struct mem_cgroup_per_node, lruvec);
 	memcg = pn->memcg;
@@ -909,7 +918,7 @@ void __count_memcg_events(struct mem_cgroup *memcg, enum vm_event_item idx,
 		return;
 
 	x = count + __this_cpu_read(memcg->vmstats_percpu->events[idx]);
-	if (unlikely(x > MEMCG_CHARGE_BATCH)) {
+	if (unlikely(x > memcg_charge_batch)) {
 		struct mem_cgroup *mi;
 
 		/*
@@ -2256,7 +2265,7 @@ static bool consume_stock(struct mem_cgroup *memcg, unsigned int nr_pages)
 	unsigned long flags;
 	bool ret = false;
 
-	if (nr_pages > MEMCG_CHARGE_BATCH)
+	if (nr_pages > memcg_charge_batch)
 		return ret;
 
 	local_irq_save(flags);
@@ -2331,7 +2340,7 @@ static void refill_stock(struct mem_cgroup *memcg, unsigned int nr_pages)
 	}
 	stock->nr_pages += nr_pages;
 
-	if (stock->nr_pages > MEMCG_CHARGE_BATCH)
+	if (stock->nr_pages > memcg_charge_batch)
 		drain_stock(stock);
 
 	local_irq_restore(flags);
@@ -2685,7 +2694,7 @@ void mem_cgroup_handle_over_high(void)
 static int try_charge(struct mem_cgroup *memcg, gfp_t gfp_mask,
 		      unsigned int nr_pages)
 {
-	unsigned int batch = max(MEMCG_CHARGE_BATCH, nr_pages);
+	unsigned int batch = max(memcg_charge_batch, nr_pages);
 	int nr_retries = MAX_RECLAIM_RETRIES;
 	struct mem_cgroup *mem_over_limit;
 	struct page_counter *counter;
@@ -6449,6 +6458,50 @@ static ssize_t memory_oom_group_write(struct kernfs_open_file *of,
 	return nbytes;
 }
 
+/*
+ * Reclaim the requested amount from the cgroup, without changing any of
+ * its limits. The work is done in quarters of what is left, so that a
+ * large request neither overshoots by much nor holds off a signal.
+ */
+static ssize_t memory_reclaim(struct kernfs_open_file *of, char *buf,
+			      size_t nbytes, loff_t off)
+{
+	struct mem_cgroup *memcg = mem_cgroup_from_css(of_css(of));
+	unsigned int nr_retries = MAX_RECLAIM_RETRIES;
+	unsigned long nr_to_reclaim, nr_reclaimed = 0;
+	int err;
+
+	buf = strstrip(buf);
+	err = page_counter_memparse(buf, "", &nr_to_reclaim);
+	if (err)
+		return err;
+
+	while (nr_reclaimed < nr_to_reclaim) {
+		unsigned long batch = (nr_to_reclaim - nr_reclaimed) / 4;
+		unsigned long reclaimed;
+
+		if (signal_pending(current))
+			return -EINTR;
+
+		/*
+		 * On the last attempt, drain the per-CPU LRU caches in the
+		 * hope of making more pages evictable.
+		 */
+		if (!nr_retries)
+			lru_add_drain_all();
+
+		reclaimed = try_to_free_mem_cgroup_pages(memcg, batch,
+							 GFP_KERNEL, true);
+
+		if (!reclaimed && !nr_retries--)
+			return -EAGAIN;
+
+		nr_reclaimed += reclaimed;
+	}
+
+	return nbytes;
+}
+
 static struct cftype memory_files[] = {
 	{
 		.name = "current",
@@ -6507,6 +6560,11 @@ static struct cftype memory_files[] = {
 		.seq_show = memory_oom_group_show,
 		.write = memory_oom_group_write,
 	},
+	{
+		.name = "reclaim",
+		.flags = CFTYPE_NS_DELEGATABLE,
+		.write = memory_reclaim,
+	},
 	{ }	/* terminate */
 };
 
@@ -7056,6 +7114,17 @@ static int __init cgroup_memory(char *s)
 }
 __setup("cgroup.memory=", cgroup_memory);
 
+static int __init setup_memcg_charge_batch(char *s)
+{
+	unsigned int batch;
+
+	if (kstrtouint(s, 0, &batch) || !batch)
+		return 0;
+	memcg_charge_batch = min(batch, MEMCG_CHARGE_BATCH_MAX);
+	return 1;
+}
+__setup("memcg_charge_batch=", setup_memcg_charge_batch);
+
 /*
  * subsys_initcall() for memory controller.
  *
@@ -7074,7 +7143,7 @@ static int __init mem_cgroup_init(void)
 	 * to work fine, we should make sure that the overfill threshold can't
 	 * exceed S32_MAX / PAGE_SIZE.
 	 */
-	BUILD_BUG_ON(MEMCG_CHARGE_BATCH > S32_MAX / PAGE_SIZE);
+	BUILD_BUG_ON(MEMCG_CHARGE_BATCH_MAX > S32_MAX / PAGE_SIZE);
 
 	cpuhp_setup_state_nocalls(CPUHP_MM_MEMCQ_DEAD, "mm/memctrl:dead", NULL,
 				  memcg_hotplug_cpu_dead);
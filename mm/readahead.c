@@ -26,6 +26,8 @@
 
 #include "internal.h"
 
+#include <trace/events/filemap.h>
+
 /*
  * Initialise a struct file's readahead state.  Assumes that the caller has
  * memset *ra to zero.
@@ -267,6 +269,95 @@ void do_page_cache_ra(struct readahead_control *ractl,
 	page_cache_ra_unbounded(ractl, nr_to_read, lookahead_size);
 }
 
+#ifdef CONFIG_TRANSPARENT_HUGEPAGE
+static int ra_alloc_page(struct readahead_control *ractl, pgoff_t index,
+		pgoff_t mark, unsigned int order, gfp_t gfp)
+{
+	struct page *page;
+	int err;
+
+	page = order ? alloc_pages(gfp | __GFP_COMP, order) :
+		       __page_cache_alloc(gfp);
+	if (!page)
+		return -ENOMEM;
+	if (order > 1)
+		prep_transhuge_page(page);
+	if (mark - index < (1UL << order))
+		SetPageReadahead(page);
+	err = add_to_page_cache_lru(page, ractl->mapping, index, gfp);
+	if (err)
+		put_page(page);
+	else
+		ractl->_nr_pages += 1UL << order;
+	return err;
+}
+
+/*
+ * Read the window described by @ra in naturally aligned pages as large as
+ * the window allows, for filesystems that set FS_THP_SUPPORT and provide
+ * ->readahead.  Everything else, and any window that cannot be allocated
+ * this way, is read as small pages by do_page_cache_ra().
+ */
+static void page_cache_ra_order(struct readahead_control *ractl,
+		struct file_ra_state *ra)
+{
+	struct address_space *mapping = ractl->mapping;
+	pgoff_t index = readahead_index(ractl);
+	pgoff_t mark = index + ra->size - ra->async_size;
+	loff_t isize = i_size_read(mapping->host);
+	gfp_t gfp = readahead_gfp_mask(mapping);
+	unsigned int new_order, nofs;
+	LIST_HEAD(page_pool);
+	pgoff_t limit;
+	int err = 0;
+
+	if (!mapping_thp_support(mapping) || !mapping->a_ops->readahead ||
+	    ra->size < 4 || !isize)
+		goto fallback;
+
+	limit = min_t(pgoff_t, (isize - 1) >> PAGE_SHIFT,
+		      index + ra->size - 1);
+	new_order = min_t(unsigned int, MAX_PAGECACHE_ORDER, ilog2(ra->size));
+
+	nofs = memalloc_nofs_save();
+	while (index <= limit) {
+		unsigned int order = new_order;
+
+		/* Align with smaller pages if needed */
+		if (index & ((1UL << order) - 1))
+			order = __ffs(index);
+		/* Don't allocate pages past EOF */
+		while (index + (1UL << order) - 1 > limit)
+			order--;
+		/* Compound pages used as THPs need at least order 2 */
+		if (order == 1)
+			order = 0;
+		err = ra_alloc_page(ractl, index, mark, order, gfp);
+		if (err)
+			break;
+		index += 1UL << order;
+	}
+	read_pages(ractl, &page_pool, false);
+	memalloc_nofs_restore(nofs);
+
+	/*
+	 * If there were already pages in the page cache, or a large page
+	 * could not be allocated, we left a gap.  Let the regular readahead
+	 * code fill it in.
+	 */
+	if (!err)
+		return;
+fallback:
+	do_page_cache_ra(ractl, ra->size, ra->async_size);
+}
+#else
+static inline void page_cache_ra_order(struct readahead_control *ractl,
+		struct file_ra_state *ra)
+{
+	do_page_cache_ra(ractl, ra->size, ra->async_size);
+}
+#endif /* CONFIG_TRANSPARENT_HUGEPAGE */
+
 /*
  * Chunk the readahead into 2 megabyte units, so that we don't pin too much
  * memory at once.
@@ -430,7 +521,35 @@ static int try_context_readahead(struct address_space *mapping,
 }
 
 /*
- * A minimal readahead algorithm for trivial sequential/random reads.
+ * Upper bound on ra->waste_shift: initial windows shrink at most 8x after
+ * repeatedly abandoned readahead.
+ */
+#define RA_WASTE_SHIFT_MAX	3
+
+/*
+ * Account the part of the current window that was never read before the
+ * stream went elsewhere.  Learn to open smaller initial windows on files
+ * whose readahead is mostly wasted, assuming @prev_index is the last page
+ * actually consumed.
+ */
+static unsigned long ra_account_waste(struct file_ra_state *ra,
+				      pgoff_t prev_index)
+{
+	unsigned long wasted;
+
+	if (!ra->size || prev_index < ra->start ||
+	    prev_index >= ra->start + ra->size)
+		return 0;
+
+	wasted = ra->start + ra->size - 1 - prev_index;
+	if (wasted * 2 > ra->size && ra->waste_shift < RA_WASTE_SHIFT_MAX)
+		ra->waste_shift++;
+	return wasted;
+}
+
+/*
+ * A minimal readahead algorithm for trivial sequential/random reads,
+ * extended to follow fixed-stride streams of small reads.
  */
 static void ondemand_readahead(struct readahead_control *ractl,
 		struct file_ra_state *ra, bool hit_readahead_marker,
@@ -440,6 +559,8 @@ static void ondemand_readahead(struct readahead_control *ractl,
 	unsigned long max_pages = ra->ra_pages;
 	unsigned long add_pages;
 	unsigned long index = readahead_index(ractl);
+	unsigned long wasted = 0;
+	const char *pattern;
 	pgoff_t prev_index;
 
 	/*
@@ -455,12 +576,29 @@ static void ondemand_readahead(struct readahead_control *ractl,
 	if (!index)
 		goto initial_readahead;
 
+	/*
+	 * Hit the marker on a chunk predicted by the stride detector below:
+	 * prefetch the next chunk of the stream, one stride further on.
+	 */
+	if (hit_readahead_marker && ra->stride && index == ra->start) {
+		ra->start += ra->size - 1 + ra->stride;
+		ra->async_size = ra->size;
+		ractl->_index = ra->start;
+		trace_mm_filemap_readahead(ractl->mapping, index, req_size,
+					   ra, "stride", 0);
+		do_page_cache_ra(ractl, ra->size, ra->async_size);
+		return;
+	}
+
 	/*
 	 * It's the expected callback index, assume sequential access.
 	 * Ramp up sizes, and push forward the readahead window.
 	 */
 	if ((index == (ra->start + ra->size - ra->async_size) ||
 	     index == (ra->start + ra->size))) {
+		pattern = "sequential";
+		if (ra->waste_shift)
+			ra->waste_shift--;
 		ra->start += ra->size;
 		ra->size = get_next_ra_size(ra, max_pages);
 		ra->async_size = ra->size;
@@ -484,6 +622,7 @@ static void ondemand_readahead(struct readahead_control *ractl,
 		if (!start || start - index > max_pages)
 			return;
 
+		pattern = "marker";
 		ra->start = start;
 		ra->size = start - index;	/* old async_size */
 		ra->size += req_size;
@@ -512,22 +651,48 @@ static void ondemand_readahead(struct readahead_control *ractl,
 	 * that a sequential stream would leave behind.
 	 */
 	if (try_context_readahead(ractl->mapping, ra, index, req_size,
-			max_pages))
+			max_pages)) {
+		pattern = "context";
 		goto readit;
+	}
+
+	if (!ra->stride)
+		wasted = ra_account_waste(ra, prev_index);
 
 	/*
 	 * standalone, small random read
-	 * Read as is, and do not pollute the readahead state.
+	 * Read as is.  If it lands the same distance past the previous read
+	 * as that one did past its predecessor, treat it as a strided stream
+	 * and prefetch the next chunk with a marker on it, so the stream
+	 * keeps itself ahead via page_cache_async_ra().
 	 */
 	do_page_cache_ra(ractl, req_size, 0);
+	if (index > prev_index && ra->stride == index - prev_index) {
+		ra->start = index + req_size - 1 + ra->stride;
+		ra->size = req_size;
+		ra->async_size = req_size;
+		ractl->_index = ra->start;
+		trace_mm_filemap_readahead(ractl->mapping, index, req_size,
+					   ra, "stride", wasted);
+		do_page_cache_ra(ractl, ra->size, ra->async_size);
+		return;
+	}
+	ra->stride = index > prev_index ? index - prev_index : 0;
+	trace_mm_filemap_readahead(ractl->mapping, index, req_size, ra,
+				   "random", wasted);
 	return;
 
 initial_readahead:
+	pattern = "initial";
 	ra->start = index;
-	ra->size = get_init_ra_size(req_size, max_pages);
+	ra->size = get_init_ra_size(req_size,
+			max(max_pages >> ra->waste_shift, 1UL));
+	ra->size = min(max(ra->size, req_size), max_pages);
 	ra->async_size = ra->size > req_size ? ra->size - req_size : ra->size;
 
 readit:
+	ra->stride = 0;
+
 	/*
 	 * Will this read hit the readahead marker made by itself?
 	 * If so, trigger the readahead marker hit now, and merge
@@ -545,8 +710,10 @@ static void ondemand_readahead(struct readahead_control *ractl,
 		}
 	}
 
+	trace_mm_filemap_readahead(ractl->mapping, index, req_size, ra,
+				   pattern, wasted);
 	ractl->_index = ra->start;
-	do_page_cache_ra(ractl, ra->size, ra->async_size);
+	page_cache_ra_order(ractl, ra);
 }
 
 void page_cache_sync_ra(struct readahead_control *ractl,
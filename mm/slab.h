@@ -44,6 +44,7 @@ struct kmem_cache {
 #include <linux/fault-inject.h>
 #include <linux/kasan.h>
 #include <linux/kmemleak.h>
+#include <linux/alloc_profile.h>
 #include <linux/random.h>
 #include <linux/sched/mm.h>
 
@@ -516,6 +517,7 @@ static inline void slab_post_alloc_hook(struct kmem_cache *s,
 		/* As p[i] might get tagged, call kmemleak hook after KASAN. */
 		kmemleak_alloc_recursive(p[i], s->object_size, 1,
 					 s->flags, flags);
+		alloc_profile_alloc(p[i], s->object_size, flags);
 	}
 
 	memcg_slab_post_alloc_hook(s, objcg, flags, size, p);
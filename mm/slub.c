@@ -1536,6 +1536,7 @@ static __always_inline void kfree_hook(void *x)
 static __always_inline bool slab_free_hook(struct kmem_cache *s, void *x)
 {
 	kmemleak_free_recursive(x, s->flags);
+	alloc_profile_free(x);
 
 	/*
 	 * Trouble is that we may no longer disable interrupts in the fast path
@@ -2439,6 +2440,33 @@ static inline void flush_slab(struct kmem_cache *s, struct kmem_cache_cpu *c)
 	c->tid = next_tid(c->tid);
 }
 
+static void __slab_free(struct kmem_cache *s, struct page *page,
+			void *head, void *tail, int cnt,
+			unsigned long addr);
+
+/*
+ * Hand the batch of deferred frees back to its slab in one
+ * cmpxchg_double_slab(). Must be called with interrupts disabled.
+ */
+static void flush_remote_frees(struct kmem_cache *s, struct kmem_cache_cpu *c)
+{
+	struct page *page = c->remote_page;
+	void *head = c->remote_head;
+	void *tail = c->remote_tail;
+	int cnt = c->remote_cnt;
+
+	if (!page)
+		return;
+
+	c->remote_page = NULL;
+	c->remote_head = NULL;
+	c->remote_tail = NULL;
+	c->remote_cnt = 0;
+
+	stat(s, FREE_REMOTE_FLUSH);
+	__slab_free(s, page, head, tail, cnt, _RET_IP_);
+}
+
 /*
  * Flush cpu slab.
  *
@@ -2448,6 +2476,8 @@ static inline void __flush_cpu_slab(struct kmem_cache *s, int cpu)
 {
 	struct kmem_cache_cpu *c = per_cpu_ptr(s->cpu_slab, cpu);
 
+	flush_remote_frees(s, c);
+
 	if (c->page)
 		flush_slab(s, c);
 
@@ -2466,7 +2496,7 @@ static bool has_cpu_slab(int cpu, void *info)
 	struct kmem_cache *s = info;
 	struct kmem_cache_cpu *c = per_cpu_ptr(s->cpu_slab, cpu);
 
-	return c->page || slub_percpu_partial(c);
+	return c->page || slub_percpu_partial(c) || c->remote_page;
 }
 
 static void flush_all(struct kmem_cache *s)
@@ -3092,6 +3122,39 @@ static void __slab_free(struct kmem_cache *s, struct page *page,
 	discard_slab(s, page);
 }
 
+/*
+ * Objects allocated on one CPU and freed on another mostly go back to the
+ * slab they came from in allocation order. Instead of a cmpxchg on that
+ * slab's freelist for every object, collect up to SLUB_REMOTE_BATCH of
+ * them per CPU while they keep targeting the same slab.
+ */
+#define SLUB_REMOTE_BATCH	16
+
+static void slab_free_remote(struct kmem_cache *s, struct page *page,
+			     void *head, void *tail, int cnt)
+{
+	struct kmem_cache_cpu *c;
+	unsigned long flags;
+
+	local_irq_save(flags);
+	c = this_cpu_ptr(s->cpu_slab);
+
+	if (c->remote_page != page) {
+		flush_remote_frees(s, c);
+		c->remote_page = page;
+		c->remote_tail = tail;
+	}
+
+	set_freepointer(s, tail, c->remote_head);
+	c->remote_head = head;
+	c->remote_cnt += cnt;
+	stat(s, FREE_REMOTE_BATCHED);
+
+	if (c->remote_cnt >= SLUB_REMOTE_BATCH)
+		flush_remote_frees(s, c);
+	local_irq_restore(flags);
+}
+
 /*
  * Fastpath with forced inlining to produce a kfree and kmem_cache_free that
  * can perform fastpath freeing without additional function calls.
@@ -3146,8 +3209,11 @@ static __always_inline void do_slab_free(struct kmem_cache *s,
 			goto redo;
 		}
 		stat(s, FREE_FASTPATH);
-	} else
+	} else if (kmem_cache_debug(s) || is_kfence_address(head)) {
 		__slab_free(s, page, head, tail_obj, cnt, addr);
+	} else {
+		slab_free_remote(s, page, head, tail_obj, cnt);
+	}
 
 }
 
@@ -5489,6 +5555,8 @@ STAT_ATTR(CPU_PARTIAL_ALLOC, cpu_partial_alloc);
 STAT_ATTR(CPU_PARTIAL_FREE, cpu_partial_free);
 STAT_ATTR(CPU_PARTIAL_NODE, cpu_partial_node);
 STAT_ATTR(CPU_PARTIAL_DRAIN, cpu_partial_drain);
+STAT_ATTR(FREE_REMOTE_BATCHED, free_remote_batched);
+STAT_ATTR(FREE_REMOTE_FLUSH, free_remote_flush);
 #endif	/* CONFIG_SLUB_STATS */
 
 static struct attribute *slab_attrs[] = {
@@ -5555,6 +5623,8 @@ static struct attribute *slab_attrs[] = {
 	&cpu_partial_free_attr.attr,
 	&cpu_partial_node_attr.attr,
 	&cpu_partial_drain_attr.attr,
+	&free_remote_batched_attr.attr,
+	&free_remote_flush_attr.attr,
 #endif
 #ifdef CONFIG_FAILSLAB
 	&failslab_attr.attr,
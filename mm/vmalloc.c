@@ -1284,6 +1284,17 @@ int unregister_vmap_purge_notifier(struct notifier_block *nb)
 }
 EXPORT_SYMBOL_GPL(unregister_vmap_purge_notifier);
 
+/*
+ * Architectures that turn any kernel range flush longer than
+ * TLB_FLUSH_ALL_THRESHOLD pages into a global one pay the same for every
+ * purge, however little it covers; gather more before paying.
+ */
+#ifdef TLB_FLUSH_ALL_THRESHOLD
+#define VMAP_LAZY_SCALE		4
+#else
+#define VMAP_LAZY_SCALE		1
+#endif
+
 /*
  * lazy_max_pages is the maximum amount of virtual address space we gather up
  * before attempting to purge with a TLB flush.
@@ -1306,7 +1317,7 @@ static unsigned long lazy_max_pages(void)
 
 	log = fls(num_online_cpus());
 
-	return log * (32UL * 1024 * 1024 / PAGE_SIZE);
+	return VMAP_LAZY_SCALE * log * (32UL * 1024 * 1024 / PAGE_SIZE);
 }
 
 static atomic_long_t vmap_lazy_nr = ATOMIC_LONG_INIT(0);
@@ -1320,6 +1331,8 @@ static DEFINE_MUTEX(vmap_purge_lock);
 
 /* for per-CPU blocks */
 static void purge_fragmented_blocks_allcpus(void);
+static bool vmap_block_cache_collect(unsigned long *start, unsigned long *end);
+static void vmap_block_cache_flushed(void);
 
 /*
  * called before a call to iounmap() if the caller wants vm_area_struct's
@@ -1338,26 +1351,36 @@ static bool __purge_vmap_area_lazy(unsigned long start, unsigned long end)
 	unsigned long resched_threshold;
 	struct list_head local_pure_list;
 	struct vmap_area *va, *n_va;
+	bool cached;
 
 	lockdep_assert_held(&vmap_purge_lock);
 
+	/* Spent cached blocks ride along on the same flush */
+	cached = vmap_block_cache_collect(&start, &end);
+
 	spin_lock(&purge_vmap_area_lock);
 	purge_vmap_area_root = RB_ROOT;
 	list_replace_init(&purge_vmap_area_list, &local_pure_list);
 	spin_unlock(&purge_vmap_area_lock);
 
-	if (unlikely(list_empty(&local_pure_list)))
+	if (unlikely(list_empty(&local_pure_list)) && !cached)
 		return false;
 
-	start = min(start,
-		list_first_entry(&local_pure_list,
-			struct vmap_area, list)->va_start);
+	if (!list_empty(&local_pure_list)) {
+		start = min(start,
+			list_first_entry(&local_pure_list,
+				struct vmap_area, list)->va_start);
 
-	end = max(end,
-		list_last_entry(&local_pure_list,
-			struct vmap_area, list)->va_end);
+		end = max(end,
+			list_last_entry(&local_pure_list,
+				struct vmap_area, list)->va_end);
+	}
 
 	flush_tlb_kernel_range(start, end);
+	count_vm_event(VMAP_PURGE);
+	count_vm_events(VMAP_PURGE_PAGES, (end - start) >> PAGE_SHIFT);
+	if (cached)
+		vmap_block_cache_flushed();
 	resched_threshold = lazy_max_pages() << 1;
 
 	spin_lock(&free_vmap_area_lock);
@@ -1496,9 +1519,22 @@ static struct vmap_area *find_vmap_area(unsigned long addr)
 
 #define VMAP_BLOCK_SIZE		(VMAP_BBMAP_BITS * PAGE_SIZE)
 
+/*
+ * Blocks whose every slot has been freed are kept on the queue of the CPU
+ * that allocated them, up to VMAP_BLOCK_CACHE of them, instead of returning their area to the lazy
+ * purge list.  A spent block waits for the next purge to flush its stale
+ * translations and is then reused by new_vmap_block() as is, saving the
+ * area allocation and the purge pressure four megabytes at a time.
+ */
+#define VMAP_BLOCK_CACHE	2
+
 struct vmap_block_queue {
 	spinlock_t lock;
 	struct list_head free;
+	struct list_head spent;		/* fully dirty, not yet flushed */
+	struct list_head flushing;	/* being flushed by a purge */
+	struct list_head clean;		/* flushed, ready for reuse */
+	unsigned int nr_cached;
 };
 
 struct vmap_block {
@@ -1509,6 +1545,7 @@ struct vmap_block {
 	struct list_head free_list;
 	struct rcu_head rcu_head;
 	struct list_head purge;
+	struct vmap_block_queue *vbq;	/* queue the block was allocated on */
 };
 
 /* Queue of free and dirty vmap blocks, for allocation and flushing purposes */
@@ -1544,6 +1581,111 @@ static void *vmap_block_vaddr(unsigned long va_start, unsigned long pages_off)
 	return (void *)addr;
 }
 
+static void vmap_block_reset(struct vmap_block *vb, unsigned int order)
+{
+	/* At least something should be left free */
+	BUG_ON(VMAP_BBMAP_BITS <= (1UL << order));
+	vb->free = VMAP_BBMAP_BITS - (1UL << order);
+	vb->dirty = 0;
+	vb->dirty_min = VMAP_BBMAP_BITS;
+	vb->dirty_max = 0;
+}
+
+/*
+ * Take a flushed block off this CPU's cache and put it back on the free
+ * queue with 2^order pages occupied.  Its free_list entry went through
+ * list_del_rcu() when the block filled up, and a walker may still hold it
+ * with no grace period in between.  Blocks are only ever cached on the
+ * queue they were allocated on, so the entry goes back onto the very list
+ * it left: such a walker merely revisits blocks of that list, which is
+ * tolerated as vb->free and vb->dirty are rechecked under vb->lock.
+ */
+static void *vmap_block_reuse(unsigned int order)
+{
+	struct vmap_block_queue *vbq;
+	struct vmap_block *vb;
+
+	vbq = &get_cpu_var(vmap_block_queue);
+	spin_lock(&vbq->lock);
+	vb = list_first_entry_or_null(&vbq->clean, struct vmap_block, purge);
+	if (vb) {
+		list_del(&vb->purge);
+		vbq->nr_cached--;
+		spin_lock(&vb->lock);
+		vmap_block_reset(vb, order);
+		spin_unlock(&vb->lock);
+		WARN_ON_ONCE(vb->vbq != vbq);
+		list_add_tail_rcu(&vb->free_list, &vbq->free);
+	}
+	spin_unlock(&vbq->lock);
+	put_cpu_var(vmap_block_queue);
+
+	if (!vb)
+		return NULL;
+
+	count_vm_event(VMAP_BLOCK_REUSE);
+	return vmap_block_vaddr(vb->va->va_start, 0);
+}
+
+/*
+ * Park a fully dirty block on the cache of the queue it was allocated on,
+ * if there is room, whichever CPU freed its last slot.
+ */
+static bool vmap_block_cache_spent(struct vmap_block *vb)
+{
+	struct vmap_block_queue *vbq = vb->vbq;
+	bool cached = false;
+
+	spin_lock(&vbq->lock);
+	if (vbq->nr_cached < VMAP_BLOCK_CACHE) {
+		list_add_tail(&vb->purge, &vbq->spent);
+		vbq->nr_cached++;
+		cached = true;
+	}
+	spin_unlock(&vbq->lock);
+
+	return cached;
+}
+
+/*
+ * Widen the purge range over all spent blocks and mark them as being
+ * flushed.  Blocks spent after this point wait for the next purge.
+ */
+static bool vmap_block_cache_collect(unsigned long *start, unsigned long *end)
+{
+	bool found = false;
+	int cpu;
+
+	for_each_possible_cpu(cpu) {
+		struct vmap_block_queue *vbq = &per_cpu(vmap_block_queue, cpu);
+		struct vmap_block *vb;
+
+		spin_lock(&vbq->lock);
+		list_for_each_entry(vb, &vbq->spent, purge) {
+			*start = min(*start, vb->va->va_start);
+			*end = max(*end, vb->va->va_end);
+			found = true;
+		}
+		list_splice_tail_init(&vbq->spent, &vbq->flushing);
+		spin_unlock(&vbq->lock);
+	}
+
+	return found;
+}
+
+static void vmap_block_cache_flushed(void)
+{
+	int cpu;
+
+	for_each_possible_cpu(cpu) {
+		struct vmap_block_queue *vbq = &per_cpu(vmap_block_queue, cpu);
+
+		spin_lock(&vbq->lock);
+		list_splice_tail_init(&vbq->flushing, &vbq->clean);
+		spin_unlock(&vbq->lock);
+	}
+}
+
 /**
  * new_vmap_block - allocates new vmap_block and occupies 2^order pages in this
  *                  block. Of course pages number can't exceed VMAP_BBMAP_BITS
@@ -1561,6 +1703,10 @@ static void *new_vmap_block(unsigned int order, gfp_t gfp_mask)
 	int node, err;
 	void *vaddr;
 
+	vaddr = vmap_block_reuse(order);
+	if (vaddr)
+		return vaddr;
+
 	node = numa_node_id();
 
 	vb = kmalloc_node(sizeof(struct vmap_block),
@@ -1579,12 +1725,7 @@ static void *new_vmap_block(unsigned int order, gfp_t gfp_mask)
 	vaddr = vmap_block_vaddr(va->va_start, 0);
 	spin_lock_init(&vb->lock);
 	vb->va = va;
-	/* At least something should be left free */
-	BUG_ON(VMAP_BBMAP_BITS <= (1UL << order));
-	vb->free = VMAP_BBMAP_BITS - (1UL << order);
-	vb->dirty = 0;
-	vb->dirty_min = VMAP_BBMAP_BITS;
-	vb->dirty_max = 0;
+	vmap_block_reset(vb, order);
 	INIT_LIST_HEAD(&vb->free_list);
 
 	vb_idx = addr_to_vb_idx(va->va_start);
@@ -1596,6 +1737,7 @@ static void *new_vmap_block(unsigned int order, gfp_t gfp_mask)
 	}
 
 	vbq = &get_cpu_var(vmap_block_queue);
+	vb->vbq = vbq;
 	spin_lock(&vbq->lock);
 	list_add_tail_rcu(&vb->free_list, &vbq->free);
 	spin_unlock(&vbq->lock);
@@ -1741,7 +1883,8 @@ static void vb_free(unsigned long addr, unsigned long size)
 	if (vb->dirty == VMAP_BBMAP_BITS) {
 		BUG_ON(vb->free);
 		spin_unlock(&vb->lock);
-		free_vmap_block(vb);
+		if (!vmap_block_cache_spent(vb))
+			free_vmap_block(vb);
 	} else
 		spin_unlock(&vb->lock);
 }
@@ -1999,6 +2142,9 @@ void __init vmalloc_init(void)
 		vbq = &per_cpu(vmap_block_queue, i);
 		spin_lock_init(&vbq->lock);
 		INIT_LIST_HEAD(&vbq->free);
+		INIT_LIST_HEAD(&vbq->spent);
+		INIT_LIST_HEAD(&vbq->flushing);
+		INIT_LIST_HEAD(&vbq->clean);
 		p = &per_cpu(vfree_deferred, i);
 		init_llist_head(&p->list);
 		INIT_WORK(&p->wq, free_work);
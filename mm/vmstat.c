@@ -1250,6 +1250,20 @@ const char * const vmstat_text[] = {
 	"pgactivate",
 	"pgdeactivate",
 	"pglazyfree",
+	"pcp_hit_order0",
+	"pcp_hit_order1",
+	"pcp_hit_order2",
+	"pcp_hit_order3",
+#ifdef CONFIG_TRANSPARENT_HUGEPAGE
+	"pcp_hit_thp",
+#endif
+	"pcp_miss_order0",
+	"pcp_miss_order1",
+	"pcp_miss_order2",
+	"pcp_miss_order3",
+#ifdef CONFIG_TRANSPARENT_HUGEPAGE
+	"pcp_miss_thp",
+#endif
 
 	"pgfault",
 	"pgmajfault",
@@ -1365,6 +1379,11 @@ const char * const vmstat_text[] = {
 	"swap_ra",
 	"swap_ra_hit",
 #endif
+#ifdef CONFIG_MMU
+	"vmap_purge",
+	"vmap_purge_pages",
+	"vmap_block_reuse",
+#endif
 #endif /* CONFIG_VM_EVENT_COUNTERS || CONFIG_MEMCG */
 };
 #endif /* CONFIG_PROC_FS || CONFIG_SYSFS || CONFIG_NUMA || CONFIG_MEMCG */
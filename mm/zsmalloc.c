@@ -57,9 +57,17 @@
 #include <linux/wait.h>
 #include <linux/pagemap.h>
 #include <linux/fs.h>
+#include <linux/ktime.h>
+#include <linux/workqueue.h>
 
 #define ZSPAGE_MAGIC	0x58
 
+/*
+ * Background compaction runs in slices of at most this long, so that it
+ * never keeps a CPU busy for longer than a typical scheduling tick.
+ */
+#define ZS_COMPACT_SLICE_NS	(500 * NSEC_PER_USEC)
+
 /*
  * This must be power of 2 and greater than of equal to sizeof(link_free).
  * These two conditions ensure that any 'struct link_free' itself doesn't
@@ -211,6 +219,8 @@ struct size_class {
 
 	unsigned int index;
 	struct zs_size_stat stats;
+	/* pages freed by compacting this class */
+	unsigned long pages_compacted;
 };
 
 /* huge object: pages_per_zspage == 1 && maxobj_per_zspage == 1 */
@@ -262,6 +272,9 @@ struct zs_pool {
 
 	/* Compact classes */
 	struct shrinker shrinker;
+	struct work_struct compact_work;
+	/* class the background compaction resumes at */
+	int compact_index;
 
 #ifdef CONFIG_ZSMALLOC_STAT
 	struct dentry *stat_dentry;
@@ -642,6 +655,44 @@ static int zs_stats_size_show(struct seq_file *s, void *v)
 }
 DEFINE_SHOW_ATTRIBUTE(zs_stats_size);
 
+static int zs_stats_frag_show(struct seq_file *s, void *v)
+{
+	int i;
+	struct zs_pool *pool = s->private;
+	struct size_class *class;
+	unsigned long obj_allocated, obj_used, freeable, compacted;
+	unsigned int frag;
+
+	seq_printf(s, " %5s %5s %8s %8s %14s\n",
+			"class", "size", "frag_pct", "freeable",
+			"pages_compacted");
+
+	for (i = 0; i < ZS_SIZE_CLASSES; i++) {
+		class = pool->size_class[i];
+
+		if (class->index != i)
+			continue;
+
+		spin_lock(&class->lock);
+		obj_allocated = zs_stat_get(class, OBJ_ALLOCATED);
+		obj_used = zs_stat_get(class, OBJ_USED);
+		freeable = zs_can_compact(class);
+		compacted = class->pages_compacted;
+		spin_unlock(&class->lock);
+
+		if (!obj_allocated)
+			continue;
+
+		/* share of allocated objects that hold no data */
+		frag = (obj_allocated - obj_used) * 100 / obj_allocated;
+		seq_printf(s, " %5u %5u %8u %8lu %14lu\n",
+			i, class->size, frag, freeable, compacted);
+	}
+
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(zs_stats_frag);
+
 static void zs_pool_stat_create(struct zs_pool *pool, const char *name)
 {
 	if (!zs_stat_root) {
@@ -653,6 +704,8 @@ static void zs_pool_stat_create(struct zs_pool *pool, const char *name)
 
 	debugfs_create_file("classes", S_IFREG | 0444, pool->stat_dentry, pool,
 			    &zs_stats_size_fops);
+	debugfs_create_file("fragmentation", S_IFREG | 0444, pool->stat_dentry,
+			    pool, &zs_stats_frag_fops);
 }
 
 static void zs_pool_stat_destroy(struct zs_pool *pool)
@@ -2212,8 +2265,19 @@ static unsigned long zs_can_compact(struct size_class *class)
 	return obj_wasted * class->pages_per_zspage;
 }
 
+static bool zs_compact_expired(u64 deadline)
+{
+	return deadline && ktime_get_ns() >= deadline;
+}
+
+/*
+ * Compact @class until nothing more can be freed or, if @deadline is not
+ * zero, until ktime_get_ns() reaches it. The class lock is dropped after
+ * every source zspage, so giving up early leaves the class consistent
+ * and the next pass simply picks up the remaining zspages.
+ */
 static unsigned long __zs_compact(struct zs_pool *pool,
-				  struct size_class *class)
+				  struct size_class *class, u64 deadline)
 {
 	struct zs_compact_control cc;
 	struct zspage *src_zspage;
@@ -2250,6 +2314,9 @@ static unsigned long __zs_compact(struct zs_pool *pool,
 			free_zspage(pool, class, src_zspage);
 			pages_freed += class->pages_per_zspage;
 		}
+		src_zspage = NULL;
+		if (zs_compact_expired(deadline))
+			break;
 		spin_unlock(&class->lock);
 		cond_resched();
 		spin_lock(&class->lock);
@@ -2258,6 +2325,7 @@ static unsigned long __zs_compact(struct zs_pool *pool,
 	if (src_zspage)
 		putback_zspage(class, src_zspage);
 
+	class->pages_compacted += pages_freed;
 	spin_unlock(&class->lock);
 
 	return pages_freed;
@@ -2275,7 +2343,7 @@ unsigned long zs_compact(struct zs_pool *pool)
 			continue;
 		if (class->index != i)
 			continue;
-		pages_freed += __zs_compact(pool, class);
+		pages_freed += __zs_compact(pool, class, 0);
 	}
 	atomic_long_add(pages_freed, &pool->stats.pages_compacted);
 
@@ -2283,6 +2351,41 @@ unsigned long zs_compact(struct zs_pool *pool)
 }
 EXPORT_SYMBOL_GPL(zs_compact);
 
+/*
+ * One time-bounded slice of background compaction. Classes are walked
+ * from where the previous slice stopped, so every class gets its turn
+ * even if each slice only gets through a few of them.
+ */
+static void zs_compact_work(struct work_struct *work)
+{
+	struct zs_pool *pool = container_of(work, struct zs_pool,
+					    compact_work);
+	u64 deadline = ktime_get_ns() + ZS_COMPACT_SLICE_NS;
+	unsigned long pages_freed = 0;
+	struct size_class *class;
+	int i;
+
+	for (i = pool->compact_index; i >= 0; i--) {
+		class = pool->size_class[i];
+		if (!class)
+			continue;
+		if (class->index != i)
+			continue;
+		pages_freed += __zs_compact(pool, class, deadline);
+		if (zs_compact_expired(deadline))
+			break;
+	}
+	atomic_long_add(pages_freed, &pool->stats.pages_compacted);
+
+	if (i >= 0) {
+		/* out of time, resume at the same class in a new slice */
+		pool->compact_index = i;
+		queue_work(system_unbound_wq, &pool->compact_work);
+	} else {
+		pool->compact_index = ZS_SIZE_CLASSES - 1;
+	}
+}
+
 void zs_pool_stats(struct zs_pool *pool, struct zs_pool_stats *stats)
 {
 	memcpy(stats, &pool->stats, sizeof(struct zs_pool_stats));
@@ -2292,18 +2395,18 @@ EXPORT_SYMBOL_GPL(zs_pool_stats);
 static unsigned long zs_shrinker_scan(struct shrinker *shrinker,
 		struct shrink_control *sc)
 {
-	unsigned long pages_freed;
 	struct zs_pool *pool = container_of(shrinker, struct zs_pool,
 			shrinker);
 
 	/*
-	 * Compact classes and calculate compaction delta.
-	 * Can run concurrently with a manually triggered
-	 * (by user) compaction.
+	 * Compaction can take milliseconds on a fragmented pool, so leave
+	 * it to the background worker instead of stalling reclaim here.
+	 * Can run concurrently with a manually triggered (by user)
+	 * compaction.
 	 */
-	pages_freed = zs_compact(pool);
+	queue_work(system_unbound_wq, &pool->compact_work);
 
-	return pages_freed ? pages_freed : SHRINK_STOP;
+	return SHRINK_STOP;
 }
 
 static unsigned long zs_shrinker_count(struct shrinker *shrinker,
@@ -2331,6 +2434,7 @@ static unsigned long zs_shrinker_count(struct shrinker *shrinker,
 static void zs_unregister_shrinker(struct zs_pool *pool)
 {
 	unregister_shrinker(&pool->shrinker);
+	cancel_work_sync(&pool->compact_work);
 }
 
 static int zs_register_shrinker(struct zs_pool *pool)
@@ -2364,6 +2468,8 @@ struct zs_pool *zs_create_pool(const char *name)
 		return NULL;
 
 	init_deferred_free(pool);
+	INIT_WORK(&pool->compact_work, zs_compact_work);
+	pool->compact_index = ZS_SIZE_CLASSES - 1;
 
 	pool->name = kstrdup(name, GFP_KERNEL);
 	if (!pool->name)
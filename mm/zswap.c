@@ -21,7 +21,7 @@
 #include <linux/types.h>
 #include <linux/atomic.h>
 #include <linux/frontswap.h>
-#include <linux/rbtree.h>
+#include <linux/xarray.h>
 #include <linux/swap.h>
 #include <linux/crypto.h>
 #include <linux/scatterlist.h>
@@ -154,8 +154,7 @@ struct zswap_pool {
  * This structure contains the metadata for tracking a single compressed
  * page within zswap.
  *
- * rbnode - links the entry into red-black tree for the appropriate swap type
- * offset - the swap offset for the entry.  Index into the red-black tree.
+ * offset - the swap offset for the entry.  Index into the tree.
  * refcount - the number of outstanding reference to the entry. This is needed
  *            to protect against premature freeing of the entry by code
  *            concurrent calls to load, invalidate, and writeback.  The lock
@@ -169,7 +168,6 @@ struct zswap_pool {
  * value - value of the same-value filled pages which have same content
  */
 struct zswap_entry {
-	struct rb_node rbnode;
 	pgoff_t offset;
 	int refcount;
 	unsigned int length;
@@ -185,13 +183,12 @@ struct zswap_header {
 };
 
 /*
- * The tree lock in the zswap_tree struct protects a few things:
- * - the rbtree
- * - the refcount field of each entry in the tree
+ * Entries are indexed by swap offset.  The xarray lock, taken with
+ * xa_lock(&tree->xa), also protects the refcount field of each entry in
+ * the tree.
  */
 struct zswap_tree {
-	struct rb_root rbroot;
-	spinlock_t lock;
+	struct xarray xa;
 };
 
 static struct zswap_tree *zswap_trees[MAX_SWAPFILES];
@@ -279,7 +276,6 @@ static struct zswap_entry *zswap_entry_cache_alloc(gfp_t gfp)
 	if (!entry)
 		return NULL;
 	entry->refcount = 1;
-	RB_CLEAR_NODE(&entry->rbnode);
 	return entry;
 }
 
@@ -288,61 +284,6 @@ static void zswap_entry_cache_free(struct zswap_entry *entry)
 	kmem_cache_free(zswap_entry_cache, entry);
 }
 
-/*********************************
-* rbtree functions
-**********************************/
-static struct zswap_entry *zswap_rb_search(struct rb_root *root, pgoff_t offset)
-{
-	struct rb_node *node = root->rb_node;
-	struct zswap_entry *entry;
-
-	while (node) {
-		entry = rb_entry(node, struct zswap_entry, rbnode);
-		if (entry->offset > offset)
-			node = node->rb_left;
-		else if (entry->offset < offset)
-			node = node->rb_right;
-		else
-			return entry;
-	}
-	return NULL;
-}
-
-/*
- * In the case that a entry with the same offset is found, a pointer to
- * the existing entry is stored in dupentry and the function returns -EEXIST
- */
-static int zswap_rb_insert(struct rb_root *root, struct zswap_entry *entry,
-			struct zswap_entry **dupentry)
-{
-	struct rb_node **link = &root->rb_node, *parent = NULL;
-	struct zswap_entry *myentry;
-
-	while (*link) {
-		parent = *link;
-		myentry = rb_entry(parent, struct zswap_entry, rbnode);
-		if (myentry->offset > entry->offset)
-			link = &(*link)->rb_left;
-		else if (myentry->offset < entry->offset)
-			link = &(*link)->rb_right;
-		else {
-			*dupentry = myentry;
-			return -EEXIST;
-		}
-	}
-	rb_link_node(&entry->rbnode, parent, link);
-	rb_insert_color(&entry->rbnode, root);
-	return 0;
-}
-
-static void zswap_rb_erase(struct rb_root *root, struct zswap_entry *entry)
-{
-	if (!RB_EMPTY_NODE(&entry->rbnode)) {
-		rb_erase(&entry->rbnode, root);
-		RB_CLEAR_NODE(&entry->rbnode);
-	}
-}
-
 /*
  * Carries out the common pattern of freeing and entry's zpool allocation,
  * freeing the entry itself, and decrementing the number of stored pages.
@@ -376,18 +317,19 @@ static void zswap_entry_put(struct zswap_tree *tree,
 
 	BUG_ON(refcount < 0);
 	if (refcount == 0) {
-		zswap_rb_erase(&tree->rbroot, entry);
+		/* the slot may already hold a newer entry for the offset */
+		__xa_cmpxchg(&tree->xa, entry->offset, entry, NULL, 0);
 		zswap_free_entry(entry);
 	}
 }
 
 /* caller must hold the tree lock */
-static struct zswap_entry *zswap_entry_find_get(struct rb_root *root,
+static struct zswap_entry *zswap_entry_find_get(struct xarray *xa,
 				pgoff_t offset)
 {
 	struct zswap_entry *entry;
 
-	entry = zswap_rb_search(root, offset);
+	entry = xa_load(xa, offset);
 	if (entry)
 		zswap_entry_get(entry);
 
@@ -955,16 +897,16 @@ static int zswap_writeback_entry(struct zpool *pool, unsigned long handle)
 	offset = swp_offset(swpentry);
 
 	/* find and ref zswap entry */
-	spin_lock(&tree->lock);
-	entry = zswap_entry_find_get(&tree->rbroot, offset);
+	xa_lock(&tree->xa);
+	entry = zswap_entry_find_get(&tree->xa, offset);
 	if (!entry) {
 		/* entry was invalidated */
-		spin_unlock(&tree->lock);
+		xa_unlock(&tree->xa);
 		zpool_unmap_handle(pool, handle);
 		kfree(tmp);
 		return 0;
 	}
-	spin_unlock(&tree->lock);
+	xa_unlock(&tree->xa);
 	BUG_ON(offset != entry->offset);
 
 	src = (u8 *)zhdr + sizeof(struct zswap_header);
@@ -1015,7 +957,7 @@ static int zswap_writeback_entry(struct zpool *pool, unsigned long handle)
 	put_page(page);
 	zswap_written_back_pages++;
 
-	spin_lock(&tree->lock);
+	xa_lock(&tree->xa);
 	/* drop local reference */
 	zswap_entry_put(tree, entry);
 
@@ -1026,9 +968,9 @@ static int zswap_writeback_entry(struct zpool *pool, unsigned long handle)
 	*     because invalidate happened during writeback
 	*  search the tree and free the entry if find entry
 	*/
-	if (entry == zswap_rb_search(&tree->rbroot, offset))
+	if (entry == xa_load(&tree->xa, offset))
 		zswap_entry_put(tree, entry);
-	spin_unlock(&tree->lock);
+	xa_unlock(&tree->xa);
 
 	goto end;
 
@@ -1040,9 +982,9 @@ static int zswap_writeback_entry(struct zpool *pool, unsigned long handle)
 	* it is also okay to return !0
 	*/
 fail:
-	spin_lock(&tree->lock);
+	xa_lock(&tree->xa);
 	zswap_entry_put(tree, entry);
-	spin_unlock(&tree->lock);
+	xa_unlock(&tree->xa);
 
 end:
 	if (zpool_can_sleep_mapped(pool))
@@ -1055,11 +997,14 @@ static int zswap_writeback_entry(struct zpool *pool, unsigned long handle)
 
 static int zswap_is_page_same_filled(void *ptr, unsigned long *value)
 {
-	unsigned int pos;
+	unsigned int pos, last_pos = PAGE_SIZE / sizeof(unsigned long) - 1;
 	unsigned long *page;
 
 	page = (unsigned long *)ptr;
-	for (pos = 1; pos < PAGE_SIZE / sizeof(*page); pos++) {
+	/* most pages differ at the ends, check the last word first */
+	if (page[last_pos] != page[0])
+		return 0;
+	for (pos = 1; pos < last_pos; pos++) {
 		if (page[pos] != page[0])
 			return 0;
 	}
@@ -1212,21 +1157,24 @@ static int zswap_frontswap_store(unsigned type, pgoff_t offset,
 	entry->length = dlen;
 
 insert_entry:
-	/* map */
-	spin_lock(&tree->lock);
-	do {
-		ret = zswap_rb_insert(&tree->rbroot, entry, &dupentry);
-		if (ret == -EEXIST) {
-			zswap_duplicate_entry++;
-			/* remove from rbtree */
-			zswap_rb_erase(&tree->rbroot, dupentry);
-			zswap_entry_put(tree, dupentry);
-		}
-	} while (ret == -EEXIST);
-	spin_unlock(&tree->lock);
-
 	/* update stats */
 	atomic_inc(&zswap_stored_pages);
+
+	/* map, replacing any stale entry for the offset */
+	xa_lock(&tree->xa);
+	dupentry = __xa_store(&tree->xa, offset, entry, GFP_KERNEL);
+	if (xa_is_err(dupentry)) {
+		xa_unlock(&tree->xa);
+		zswap_reject_alloc_fail++;
+		zswap_free_entry(entry);
+		return xa_err(dupentry);
+	}
+	if (dupentry) {
+		zswap_duplicate_entry++;
+		zswap_entry_put(tree, dupentry);
+	}
+	xa_unlock(&tree->xa);
+
 	zswap_update_total_size();
 
 	return 0;
@@ -1256,19 +1204,23 @@ static int zswap_frontswap_load(unsigned type, pgoff_t offset,
 	int ret;
 
 	/* find */
-	spin_lock(&tree->lock);
-	entry = zswap_entry_find_get(&tree->rbroot, offset);
+	xa_lock(&tree->xa);
+	entry = zswap_entry_find_get(&tree->xa, offset);
 	if (!entry) {
 		/* entry was written back */
-		spin_unlock(&tree->lock);
+		xa_unlock(&tree->xa);
 		return -1;
 	}
-	spin_unlock(&tree->lock);
+	xa_unlock(&tree->xa);
 
 	if (!entry->length) {
-		dst = kmap_atomic(page);
-		zswap_fill_page(dst, entry->value);
-		kunmap_atomic(dst);
+		if (!entry->value) {
+			clear_highpage(page);
+		} else {
+			dst = kmap_atomic(page);
+			zswap_fill_page(dst, entry->value);
+			kunmap_atomic(dst);
+		}
 		ret = 0;
 		goto freeentry;
 	}
@@ -1313,9 +1265,9 @@ static int zswap_frontswap_load(unsigned type, pgoff_t offset,
 	BUG_ON(ret);
 
 freeentry:
-	spin_lock(&tree->lock);
+	xa_lock(&tree->xa);
 	zswap_entry_put(tree, entry);
-	spin_unlock(&tree->lock);
+	xa_unlock(&tree->xa);
 
 	return ret;
 }
@@ -1327,38 +1279,34 @@ static void zswap_frontswap_invalidate_page(unsigned type, pgoff_t offset)
 	struct zswap_entry *entry;
 
 	/* find */
-	spin_lock(&tree->lock);
-	entry = zswap_rb_search(&tree->rbroot, offset);
+	xa_lock(&tree->xa);
+	entry = __xa_erase(&tree->xa, offset);
 	if (!entry) {
 		/* entry was written back */
-		spin_unlock(&tree->lock);
+		xa_unlock(&tree->xa);
 		return;
 	}
 
-	/* remove from rbtree */
-	zswap_rb_erase(&tree->rbroot, entry);
-
 	/* drop the initial reference from entry creation */
 	zswap_entry_put(tree, entry);
 
-	spin_unlock(&tree->lock);
+	xa_unlock(&tree->xa);
 }
 
 /* frees all zswap entries for the given swap type */
 static void zswap_frontswap_invalidate_area(unsigned type)
 {
 	struct zswap_tree *tree = zswap_trees[type];
-	struct zswap_entry *entry, *n;
+	struct zswap_entry *entry;
+	unsigned long offset;
 
 	if (!tree)
 		return;
 
 	/* walk the tree and free everything */
-	spin_lock(&tree->lock);
-	rbtree_postorder_for_each_entry_safe(entry, n, &tree->rbroot, rbnode)
+	xa_for_each(&tree->xa, offset, entry)
 		zswap_free_entry(entry);
-	tree->rbroot = RB_ROOT;
-	spin_unlock(&tree->lock);
+	xa_destroy(&tree->xa);
 	kfree(tree);
 	zswap_trees[type] = NULL;
 }
@@ -1373,8 +1321,7 @@ static void zswap_frontswap_init(unsigned type)
 		return;
 	}
 
-	tree->rbroot = RB_ROOT;
-	spin_lock_init(&tree->lock);
+	xa_init(&tree->xa);
 	zswap_trees[type] = tree;
 }
 
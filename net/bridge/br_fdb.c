@@ -594,7 +594,8 @@ void br_fdb_update(struct net_bridge *br, struct net_bridge_port *source,
 			unsigned long now = jiffies;
 			bool fdb_modified = false;
 
-			if (now != fdb->updated) {
+			if (time_after_eq(now, fdb->updated +
+					   BR_FDB_STAMP_INTERVAL)) {
 				fdb->updated = now;
 				fdb_modified = __fdb_mark_active(fdb);
 			}
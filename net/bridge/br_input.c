@@ -154,7 +154,7 @@ int br_handle_frame_finish(struct net *net, struct sock *sk, struct sk_buff *skb
 		if (test_bit(BR_FDB_LOCAL, &dst->flags))
 			return br_pass_frame_up(skb);
 
-		if (now != dst->used)
+		if (time_after_eq(now, dst->used + BR_FDB_STAMP_INTERVAL))
 			dst->used = now;
 		br_forward(dst->dst, skb, local_rcv, false);
 	} else {
@@ -24,6 +24,12 @@
 
 #define BR_HOLD_TIME (1*HZ)
 
+/* Least time between two refreshes of an FDB entry's ageing stamps from
+ * the data path, so that a busy entry's cache line stays shared by the CPUs
+ * forwarding through it.
+ */
+#define BR_FDB_STAMP_INTERVAL (HZ / 10)
+
 #define BR_PORT_BITS	10
 #define BR_MAX_PORTS	(1<<BR_PORT_BITS)
 
@@ -59,6 +59,7 @@ int __get_compat_msghdr(struct msghdr *kmsg,
 	kmsg->msg_control_is_user = true;
 	kmsg->msg_control_user = compat_ptr(msg.msg_control);
 	kmsg->msg_controllen = msg.msg_controllen;
+	kmsg->msg_ubuf = NULL;
 
 	if (save_addr)
 		*save_addr = compat_ptr(msg.msg_name);
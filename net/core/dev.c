@@ -78,6 +78,7 @@
 #include <linux/slab.h>
 #include <linux/sched.h>
 #include <linux/sched/mm.h>
+#include <uapi/linux/sched/types.h>
 #include <linux/mutex.h>
 #include <linux/rwsem.h>
 #include <linux/string.h>
@@ -1509,6 +1510,25 @@ EXPORT_SYMBOL(netdev_notify_peers);
 
 static int napi_threaded_poll(void *data);
 
+static int napi_thread_apply_params(struct napi_struct *n)
+{
+	struct napi_thread_params *p = n->thread_params;
+	struct sched_param param;
+	int err;
+
+	if (!p || !n->thread)
+		return 0;
+
+	if (!cpumask_empty(&p->affinity)) {
+		err = set_cpus_allowed_ptr(n->thread, &p->affinity);
+		if (err)
+			return err;
+	}
+
+	param.sched_priority = p->priority;
+	return sched_setscheduler_nocheck(n->thread, p->policy, &param);
+}
+
 static int napi_kthread_create(struct napi_struct *n)
 {
 	int err = 0;
@@ -1523,6 +1543,9 @@ static int napi_kthread_create(struct napi_struct *n)
 		err = PTR_ERR(n->thread);
 		pr_err("kthread_run failed with err %d\n", err);
 		n->thread = NULL;
+	} else if (napi_thread_apply_params(n)) {
+		netdev_warn(n->dev, "napi %u: cannot apply thread placement\n",
+			    n->napi_id);
 	}
 
 	return err;
@@ -6656,6 +6679,9 @@ void napi_busy_loop(unsigned int napi_id,
 	if (!napi)
 		goto out;
 
+	if (READ_ONCE(napi->busy_poll_budget))
+		budget = READ_ONCE(napi->busy_poll_budget);
+
 	preempt_disable();
 	for (;;) {
 		int work = 0;
@@ -6821,6 +6847,101 @@ int dev_set_threaded(struct net_device *dev, bool threaded)
 	return err;
 }
 
+static struct napi_thread_params *napi_thread_params(struct napi_struct *n)
+{
+	if (!n->thread_params)
+		n->thread_params = kzalloc(sizeof(*n->thread_params),
+					   GFP_KERNEL);
+	return n->thread_params;
+}
+
+/**
+ *	napi_set_thread_affinity - pin the threaded NAPI poll thread
+ *	@n: NAPI context
+ *	@mask: CPUs the poll thread may run on, empty for any CPU
+ *
+ * The setting is applied to the running thread, if any, and reapplied
+ * every time threaded mode is turned back on. Caller must hold RTNL.
+ */
+int napi_set_thread_affinity(struct napi_struct *n, const struct cpumask *mask)
+{
+	struct napi_thread_params *p;
+
+	ASSERT_RTNL();
+
+	if (!cpumask_empty(mask) && !cpumask_intersects(mask, cpu_online_mask))
+		return -EINVAL;
+
+	p = napi_thread_params(n);
+	if (!p)
+		return -ENOMEM;
+
+	cpumask_copy(&p->affinity, mask);
+	if (n->thread && cpumask_empty(mask))
+		return set_cpus_allowed_ptr(n->thread, cpu_possible_mask);
+
+	return napi_thread_apply_params(n);
+}
+EXPORT_SYMBOL(napi_set_thread_affinity);
+
+/**
+ *	napi_set_thread_sched - set the scheduling policy of the poll thread
+ *	@n: NAPI context
+ *	@policy: SCHED_NORMAL, SCHED_FIFO or SCHED_RR
+ *	@priority: real-time priority, 0 for SCHED_NORMAL
+ *
+ * Like napi_set_thread_affinity(), the setting outlives the thread.
+ * Caller must hold RTNL.
+ */
+int napi_set_thread_sched(struct napi_struct *n, int policy, int priority)
+{
+	struct napi_thread_params *p;
+
+	ASSERT_RTNL();
+
+	switch (policy) {
+	case SCHED_NORMAL:
+		if (priority)
+			return -EINVAL;
+		break;
+	case SCHED_FIFO:
+	case SCHED_RR:
+		if (priority < 1 || priority > MAX_RT_PRIO - 1)
+			return -EINVAL;
+		break;
+	default:
+		return -EINVAL;
+	}
+
+	p = napi_thread_params(n);
+	if (!p)
+		return -ENOMEM;
+
+	p->policy = policy;
+	p->priority = priority;
+
+	return napi_thread_apply_params(n);
+}
+EXPORT_SYMBOL(napi_set_thread_sched);
+
+/**
+ *	netif_rx_queue_set_napi - associate an RX queue with its NAPI context
+ *	@dev: network device
+ *	@rxq: RX queue index
+ *	@napi: NAPI context polling that queue, or NULL
+ *
+ * Lets the per-queue sysfs attributes reach the poll thread settings.
+ */
+void netif_rx_queue_set_napi(struct net_device *dev, unsigned int rxq,
+			     struct napi_struct *napi)
+{
+	if (WARN_ON_ONCE(rxq >= dev->num_rx_queues))
+		return;
+
+	WRITE_ONCE(dev->_rx[rxq].napi, napi);
+}
+EXPORT_SYMBOL(netif_rx_queue_set_napi);
+
 void netif_napi_add(struct net_device *dev, struct napi_struct *napi,
 		    int (*poll)(struct napi_struct *, int), int weight)
 {
@@ -6909,9 +7030,16 @@ static void flush_gro_hash(struct napi_struct *napi)
 /* Must be called in process context */
 void __netif_napi_del(struct napi_struct *napi)
 {
+	struct net_device *dev = napi->dev;
+	unsigned int i;
+
 	if (!test_and_clear_bit(NAPI_STATE_LISTED, &napi->state))
 		return;
 
+	for (i = 0; i < dev->num_rx_queues; i++)
+		if (dev->_rx[i].napi == napi)
+			WRITE_ONCE(dev->_rx[i].napi, NULL);
+
 	napi_hash_del(napi);
 	list_del_rcu(&napi->dev_list);
 	napi_free_frags(napi);
@@ -6923,6 +7051,9 @@ void __netif_napi_del(struct napi_struct *napi)
 		kthread_stop(napi->thread);
 		napi->thread = NULL;
 	}
+
+	kfree(napi->thread_params);
+	napi->thread_params = NULL;
 }
 EXPORT_SYMBOL(__netif_napi_del);
 
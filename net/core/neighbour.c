@@ -221,16 +221,29 @@ bool neigh_remove_one(struct neighbour *ndel, struct neigh_table *tbl)
 	return false;
 }
 
+static void neigh_gc_lock_time(struct neigh_table *tbl, u64 start)
+{
+	NEIGH_CACHE_STAT_ADD(tbl, gc_lock_us,
+			     div_u64(ktime_get_ns() - start, NSEC_PER_USEC));
+}
+
+/* Entries inspected between two checks of the forced GC time budget */
+#define NEIGH_GC_BATCH	16
+
 static int neigh_forced_gc(struct neigh_table *tbl)
 {
 	int max_clean = atomic_read(&tbl->gc_entries) - tbl->gc_thresh2;
 	unsigned long tref = jiffies - 5 * HZ;
 	struct neighbour *n, *tmp;
 	int shrunk = 0;
+	int loop = 0;
+	u64 start, tmax;
 
 	NEIGH_CACHE_STAT_INC(tbl, forced_gc_runs);
 
 	write_lock_bh(&tbl->lock);
+	start = ktime_get_ns();
+	tmax = start + NSEC_PER_MSEC;
 
 	list_for_each_entry_safe(n, tmp, &tbl->gc_list, gc_list) {
 		if (refcount_read(&n->refcnt) == 1) {
@@ -250,15 +263,31 @@ static int neigh_forced_gc(struct neigh_table *tbl)
 			if (shrunk >= max_clean)
 				break;
 		}
+
+		/* Do not hold off lookups and updates for too long */
+		if (++loop == NEIGH_GC_BATCH) {
+			if (ktime_get_ns() > tmax)
+				break;
+			loop = 0;
+		}
 	}
 
 	tbl->last_flush = jiffies;
 
+	neigh_gc_lock_time(tbl, start);
 	write_unlock_bh(&tbl->lock);
 
 	return shrunk;
 }
 
+static void neigh_forced_gc_work(struct work_struct *work)
+{
+	struct neigh_table *tbl = container_of(work, struct neigh_table,
+					       forced_gc_work);
+
+	neigh_forced_gc(tbl);
+}
+
 static void neigh_add_timer(struct neighbour *n, unsigned long when)
 {
 	neigh_hold(n);
@@ -389,16 +418,19 @@ static struct neighbour *neigh_alloc(struct neigh_table *tbl,
 		goto do_alloc;
 
 	entries = atomic_inc_return(&tbl->gc_entries) - 1;
-	if (entries >= tbl->gc_thresh3 ||
-	    (entries >= tbl->gc_thresh2 &&
-	     time_after(now, tbl->last_flush + 5 * HZ))) {
-		if (!neigh_forced_gc(tbl) &&
-		    entries >= tbl->gc_thresh3) {
+	if (entries >= tbl->gc_thresh3) {
+		if (!neigh_forced_gc(tbl)) {
 			net_info_ratelimited("%s: neighbor table overflow!\n",
 					     tbl->id);
 			NEIGH_CACHE_STAT_INC(tbl, table_fulls);
 			goto out_entries;
 		}
+	} else if (entries >= tbl->gc_thresh2 &&
+		   time_after(now, tbl->last_flush + 5 * HZ)) {
+		/* Only the hard limit is worth a GC in this path, below it
+		 * the table is trimmed from process context.
+		 */
+		queue_work(system_power_efficient_wq, &tbl->forced_gc_work);
 	}
 
 do_alloc:
@@ -895,10 +927,12 @@ static void neigh_periodic_work(struct work_struct *work)
 	struct neighbour __rcu **np;
 	unsigned int i;
 	struct neigh_hash_table *nht;
+	u64 start;
 
 	NEIGH_CACHE_STAT_INC(tbl, periodic_gc_runs);
 
 	write_lock_bh(&tbl->lock);
+	start = ktime_get_ns();
 	nht = rcu_dereference_protected(tbl->nht,
 					lockdep_is_held(&tbl->lock));
 
@@ -954,9 +988,11 @@ static void neigh_periodic_work(struct work_struct *work)
 		 * It's fine to release lock here, even if hash table
 		 * grows while we are preempted.
 		 */
+		neigh_gc_lock_time(tbl, start);
 		write_unlock_bh(&tbl->lock);
 		cond_resched();
 		write_lock_bh(&tbl->lock);
+		start = ktime_get_ns();
 		nht = rcu_dereference_protected(tbl->nht,
 						lockdep_is_held(&tbl->lock));
 	}
@@ -967,6 +1003,7 @@ static void neigh_periodic_work(struct work_struct *work)
 	 */
 	queue_delayed_work(system_power_efficient_wq, &tbl->gc_work,
 			      NEIGH_VAR(&tbl->parms, BASE_REACHABLE_TIME) >> 1);
+	neigh_gc_lock_time(tbl, start);
 	write_unlock_bh(&tbl->lock);
 }
 
@@ -1716,6 +1753,7 @@ void neigh_table_init(int index, struct neigh_table *tbl)
 
 	rwlock_init(&tbl->lock);
 	INIT_DEFERRABLE_WORK(&tbl->gc_work, neigh_periodic_work);
+	INIT_WORK(&tbl->forced_gc_work, neigh_forced_gc_work);
 	queue_delayed_work(system_power_efficient_wq, &tbl->gc_work,
 			tbl->parms.reachable_time);
 	timer_setup(&tbl->proxy_timer, neigh_proxy_process, 0);
@@ -1734,6 +1772,7 @@ int neigh_table_clear(int index, struct neigh_table *tbl)
 	neigh_tables[index] = NULL;
 	/* It is not clean... Fix it to unload IPv6 module safely */
 	cancel_delayed_work_sync(&tbl->gc_work);
+	cancel_work_sync(&tbl->forced_gc_work);
 	del_timer_sync(&tbl->proxy_timer);
 	pneigh_queue_purge(&tbl->proxy_queue);
 	neigh_ifdown(tbl, NULL);
@@ -3315,12 +3354,12 @@ static int neigh_stat_seq_show(struct seq_file *seq, void *v)
 	struct neigh_statistics *st = v;
 
 	if (v == SEQ_START_TOKEN) {
-		seq_printf(seq, "entries  allocs destroys hash_grows  lookups hits  res_failed  rcv_probes_mcast rcv_probes_ucast  periodic_gc_runs forced_gc_runs unresolved_discards table_fulls\n");
+		seq_printf(seq, "entries  allocs destroys hash_grows  lookups hits  res_failed  rcv_probes_mcast rcv_probes_ucast  periodic_gc_runs forced_gc_runs unresolved_discards table_fulls gc_lock_us\n");
 		return 0;
 	}
 
 	seq_printf(seq, "%08x  %08lx %08lx %08lx  %08lx %08lx  %08lx  "
-			"%08lx %08lx  %08lx %08lx %08lx %08lx\n",
+			"%08lx %08lx  %08lx %08lx %08lx %08lx %08lx\n",
 		   atomic_read(&tbl->entries),
 
 		   st->allocs,
@@ -3338,7 +3377,8 @@ static int neigh_stat_seq_show(struct seq_file *seq, void *v)
 		   st->periodic_gc_runs,
 		   st->forced_gc_runs,
 		   st->unres_discards,
-		   st->table_fulls
+		   st->table_fulls,
+		   st->gc_lock_us
 		   );
 
 	return 0;
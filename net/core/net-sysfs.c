@@ -933,11 +933,173 @@ static struct rx_queue_attribute rps_dev_flow_table_cnt_attribute __ro_after_ini
 		 show_rps_dev_flow_table_cnt, store_rps_dev_flow_table_cnt);
 #endif /* CONFIG_RPS */
 
+/* Threaded NAPI placement of the poll context bound to this queue, see
+ * netif_rx_queue_set_napi()
+ */
+static const char * const napi_sched_policies[] = {
+	[SCHED_NORMAL]	= "other",
+	[SCHED_FIFO]	= "fifo",
+	[SCHED_RR]	= "rr",
+};
+
+static ssize_t show_napi_affinity(struct netdev_rx_queue *queue, char *buf)
+{
+	struct napi_struct *napi;
+	ssize_t len = -ENOENT;
+
+	if (!rtnl_trylock())
+		return restart_syscall();
+
+	napi = queue->napi;
+	if (napi && napi->thread_params)
+		len = sprintf(buf, "%*pb\n",
+			      cpumask_pr_args(&napi->thread_params->affinity));
+	else if (napi)
+		len = sprintf(buf, "%*pb\n", cpumask_pr_args(cpu_none_mask));
+
+	rtnl_unlock();
+	return len;
+}
+
+static ssize_t store_napi_affinity(struct netdev_rx_queue *queue,
+				   const char *buf, size_t len)
+{
+	cpumask_var_t mask;
+	int err;
+
+	if (!capable(CAP_NET_ADMIN))
+		return -EPERM;
+
+	if (!alloc_cpumask_var(&mask, GFP_KERNEL))
+		return -ENOMEM;
+
+	err = bitmap_parse(buf, len, cpumask_bits(mask), nr_cpumask_bits);
+	if (err)
+		goto out;
+
+	if (!rtnl_trylock()) {
+		err = restart_syscall();
+		goto out;
+	}
+
+	err = queue->napi ? napi_set_thread_affinity(queue->napi, mask) :
+			    -ENOENT;
+	rtnl_unlock();
+out:
+	free_cpumask_var(mask);
+	return err ? : len;
+}
+
+static ssize_t show_napi_sched(struct netdev_rx_queue *queue, char *buf)
+{
+	struct napi_thread_params *p;
+	ssize_t len = -ENOENT;
+
+	if (!rtnl_trylock())
+		return restart_syscall();
+
+	if (queue->napi) {
+		p = queue->napi->thread_params;
+		len = sprintf(buf, "%s %d\n",
+			      napi_sched_policies[p ? p->policy : SCHED_NORMAL],
+			      p ? p->priority : 0);
+	}
+
+	rtnl_unlock();
+	return len;
+}
+
+static ssize_t store_napi_sched(struct netdev_rx_queue *queue,
+				const char *buf, size_t len)
+{
+	int policy, priority = 0;
+	char name[8];
+	int err;
+
+	if (!capable(CAP_NET_ADMIN))
+		return -EPERM;
+
+	if (sscanf(buf, "%7s %d", name, &priority) < 1)
+		return -EINVAL;
+
+	for (policy = 0; policy < ARRAY_SIZE(napi_sched_policies); policy++)
+		if (napi_sched_policies[policy] &&
+		    !strcmp(name, napi_sched_policies[policy]))
+			break;
+	if (policy == ARRAY_SIZE(napi_sched_policies))
+		return -EINVAL;
+
+	if (!rtnl_trylock())
+		return restart_syscall();
+
+	err = queue->napi ? napi_set_thread_sched(queue->napi, policy,
+						  priority) : -ENOENT;
+	rtnl_unlock();
+
+	return err ? : len;
+}
+
+static ssize_t show_napi_busy_poll_budget(struct netdev_rx_queue *queue,
+					  char *buf)
+{
+	ssize_t len = -ENOENT;
+
+	if (!rtnl_trylock())
+		return restart_syscall();
+
+	if (queue->napi)
+		len = sprintf(buf, "%u\n", queue->napi->busy_poll_budget);
+
+	rtnl_unlock();
+	return len;
+}
+
+static ssize_t store_napi_busy_poll_budget(struct netdev_rx_queue *queue,
+					   const char *buf, size_t len)
+{
+	u16 budget;
+	int err;
+
+	if (!capable(CAP_NET_ADMIN))
+		return -EPERM;
+
+	err = kstrtou16(buf, 0, &budget);
+	if (err)
+		return err;
+
+	if (budget > NAPI_POLL_WEIGHT)
+		return -EINVAL;
+
+	if (!rtnl_trylock())
+		return restart_syscall();
+
+	if (queue->napi)
+		WRITE_ONCE(queue->napi->busy_poll_budget, budget);
+	else
+		err = -ENOENT;
+	rtnl_unlock();
+
+	return err ? : len;
+}
+
+static struct rx_queue_attribute napi_affinity_attribute __ro_after_init
+	= __ATTR(napi_affinity, 0644, show_napi_affinity, store_napi_affinity);
+
+static struct rx_queue_attribute napi_sched_attribute __ro_after_init
+	= __ATTR(napi_sched, 0644, show_napi_sched, store_napi_sched);
+
+static struct rx_queue_attribute napi_busy_poll_budget_attribute __ro_after_init
+	= __ATTR(napi_busy_poll_budget, 0644,
+		 show_napi_busy_poll_budget, store_napi_busy_poll_budget);
+
 static struct attribute *rx_queue_default_attrs[] __ro_after_init = {
 #ifdef CONFIG_RPS
 	&rps_cpus_attribute.attr,
 	&rps_dev_flow_table_cnt_attribute.attr,
 #endif
+	&napi_affinity_attribute.attr,
+	&napi_sched_attribute.attr,
+	&napi_busy_poll_budget_attribute.attr,
 	NULL
 };
 ATTRIBUTE_GROUPS(rx_queue_default);
@@ -1052,10 +1214,6 @@ net_rx_queue_update_kobjects(struct net_device *dev, int old_num, int new_num)
 	int i;
 	int error = 0;
 
-#ifndef CONFIG_RPS
-	if (!dev->sysfs_rx_queue_group)
-		return 0;
-#endif
 	for (i = old_num; i < new_num; i++) {
 		error = rx_queue_add_kobject(dev, i);
 		if (error) {
@@ -1087,10 +1245,6 @@ static int net_rx_queue_change_owner(struct net_device *dev, int num,
 	int error = 0;
 	int i;
 
-#ifndef CONFIG_RPS
-	if (!dev->sysfs_rx_queue_group)
-		return 0;
-#endif
 	for (i = 0; i < num; i++) {
 		error = rx_queue_change_owner(dev, i, kuid, kgid);
 		if (error)
@@ -9,6 +9,8 @@
 #include <linux/kernel.h>
 #include <linux/slab.h>
 #include <linux/device.h>
+#include <linux/ethtool.h>
+#include <linux/percpu.h>
 
 #include <net/page_pool.h>
 #include <net/xdp.h>
@@ -21,8 +23,117 @@
 #include <trace/events/page_pool.h>
 
 #define DEFER_TIME (msecs_to_jiffies(1000))
+#define BIAS_MAX	LONG_MAX
 #define DEFER_WARN_INTERVAL (60 * HZ)
 
+#ifdef CONFIG_PAGE_POOL_STATS
+/* alloc_stat_inc is intended to be used in softirq context */
+#define alloc_stat_inc(pool, __stat)	(pool->alloc_stats.__stat++)
+/* recycle_stat_inc is safe to use when preemption is possible. */
+#define recycle_stat_inc(pool, __stat)						\
+	do {									\
+		struct page_pool_recycle_stats __percpu *s = pool->recycle_stats;	\
+		this_cpu_inc(s->__stat);					\
+	} while (0)
+
+#define recycle_stat_add(pool, __stat, val)					\
+	do {									\
+		struct page_pool_recycle_stats __percpu *s = pool->recycle_stats;	\
+		this_cpu_add(s->__stat, val);					\
+	} while (0)
+
+static const char pp_stats[][ETH_GSTRING_LEN] = {
+	"rx_pp_alloc_fast",
+	"rx_pp_alloc_slow",
+	"rx_pp_alloc_slow_ho",
+	"rx_pp_alloc_empty",
+	"rx_pp_alloc_refill",
+	"rx_pp_alloc_waive",
+	"rx_pp_recycle_cached",
+	"rx_pp_recycle_cache_full",
+	"rx_pp_recycle_staged",
+	"rx_pp_recycle_ring",
+	"rx_pp_recycle_ring_full",
+	"rx_pp_recycle_released_ref",
+};
+
+bool page_pool_get_stats(struct page_pool *pool,
+			 struct page_pool_stats *stats)
+{
+	int cpu = 0;
+
+	if (!stats)
+		return false;
+
+	/* The caller is responsible to initialize stats. */
+	stats->alloc_stats.fast += pool->alloc_stats.fast;
+	stats->alloc_stats.slow += pool->alloc_stats.slow;
+	stats->alloc_stats.slow_high_order += pool->alloc_stats.slow_high_order;
+	stats->alloc_stats.empty += pool->alloc_stats.empty;
+	stats->alloc_stats.refill += pool->alloc_stats.refill;
+	stats->alloc_stats.waive += pool->alloc_stats.waive;
+
+	for_each_possible_cpu(cpu) {
+		const struct page_pool_recycle_stats *pcpu =
+			per_cpu_ptr(pool->recycle_stats, cpu);
+
+		stats->recycle_stats.cached += pcpu->cached;
+		stats->recycle_stats.cache_full += pcpu->cache_full;
+		stats->recycle_stats.staged += pcpu->staged;
+		stats->recycle_stats.ring += pcpu->ring;
+		stats->recycle_stats.ring_full += pcpu->ring_full;
+		stats->recycle_stats.released_refcnt += pcpu->released_refcnt;
+	}
+
+	return true;
+}
+EXPORT_SYMBOL(page_pool_get_stats);
+
+u8 *page_pool_ethtool_stats_get_strings(u8 *data)
+{
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(pp_stats); i++) {
+		memcpy(data, pp_stats[i], ETH_GSTRING_LEN);
+		data += ETH_GSTRING_LEN;
+	}
+
+	return data;
+}
+EXPORT_SYMBOL(page_pool_ethtool_stats_get_strings);
+
+int page_pool_ethtool_stats_get_count(void)
+{
+	return ARRAY_SIZE(pp_stats);
+}
+EXPORT_SYMBOL(page_pool_ethtool_stats_get_count);
+
+u64 *page_pool_ethtool_stats_get(u64 *data, void *stats)
+{
+	struct page_pool_stats *pool_stats = stats;
+
+	*data++ = pool_stats->alloc_stats.fast;
+	*data++ = pool_stats->alloc_stats.slow;
+	*data++ = pool_stats->alloc_stats.slow_high_order;
+	*data++ = pool_stats->alloc_stats.empty;
+	*data++ = pool_stats->alloc_stats.refill;
+	*data++ = pool_stats->alloc_stats.waive;
+	*data++ = pool_stats->recycle_stats.cached;
+	*data++ = pool_stats->recycle_stats.cache_full;
+	*data++ = pool_stats->recycle_stats.staged;
+	*data++ = pool_stats->recycle_stats.ring;
+	*data++ = pool_stats->recycle_stats.ring_full;
+	*data++ = pool_stats->recycle_stats.released_refcnt;
+
+	return data;
+}
+EXPORT_SYMBOL(page_pool_ethtool_stats_get);
+#else
+#define alloc_stat_inc(pool, __stat)
+#define recycle_stat_inc(pool, __stat)
+#define recycle_stat_add(pool, __stat, val)
+#endif
+
 static int page_pool_init(struct page_pool *pool,
 			  const struct page_pool_params *params)
 {
@@ -37,6 +148,13 @@ static int page_pool_init(struct page_pool *pool,
 	if (pool->p.pool_size)
 		ring_qsize = pool->p.pool_size;
 
+	/* The fragment count shares struct page with the upper DMA
+	 * address bits on 32-bit platforms with 64-bit DMA.
+	 */
+	if ((pool->p.flags & PP_FLAG_PAGE_FRAG) &&
+	    sizeof(dma_addr_t) > sizeof(unsigned long))
+		return -EINVAL;
+
 	/* Sanity limit mem that can be pinned down */
 	if (ring_qsize > 32768)
 		return -E2BIG;
@@ -66,9 +184,26 @@ static int page_pool_init(struct page_pool *pool,
 		 */
 	}
 
-	if (ptr_ring_init(&pool->ring, ring_qsize, GFP_KERNEL) < 0)
+	pool->pcpu_cache = alloc_percpu(struct pp_pcpu_cache);
+	if (!pool->pcpu_cache)
 		return -ENOMEM;
 
+#ifdef CONFIG_PAGE_POOL_STATS
+	pool->recycle_stats = alloc_percpu(struct page_pool_recycle_stats);
+	if (!pool->recycle_stats) {
+		free_percpu(pool->pcpu_cache);
+		return -ENOMEM;
+	}
+#endif
+
+	if (ptr_ring_init(&pool->ring, ring_qsize, GFP_KERNEL) < 0) {
+#ifdef CONFIG_PAGE_POOL_STATS
+		free_percpu(pool->recycle_stats);
+#endif
+		free_percpu(pool->pcpu_cache);
+		return -ENOMEM;
+	}
+
 	atomic_set(&pool->pages_state_release_cnt, 0);
 
 	/* Driver calling page_pool_create() also call page_pool_destroy() */
@@ -110,8 +245,10 @@ static struct page *page_pool_refill_alloc_cache(struct page_pool *pool)
 	int pref_nid; /* preferred NUMA node */
 
 	/* Quicker fallback, avoid locks when ring is empty */
-	if (__ptr_ring_empty(r))
+	if (__ptr_ring_empty(r)) {
+		alloc_stat_inc(pool, empty);
 		return NULL;
+	}
 
 	/* Softirq guarantee CPU and thus NUMA node is stable. This,
 	 * assumes CPU refilling driver RX-ring will also run RX-NAPI.
@@ -141,14 +278,17 @@ static struct page *page_pool_refill_alloc_cache(struct page_pool *pool)
 			 * This limit stress on page buddy alloactor.
 			 */
 			page_pool_return_page(pool, page);
+			alloc_stat_inc(pool, waive);
 			page = NULL;
 			break;
 		}
 	} while (pool->alloc.count < PP_ALLOC_CACHE_REFILL);
 
 	/* Return last page */
-	if (likely(pool->alloc.count > 0))
+	if (likely(pool->alloc.count > 0)) {
 		page = pool->alloc.cache[--pool->alloc.count];
+		alloc_stat_inc(pool, refill);
+	}
 
 	spin_unlock(&r->consumer_lock);
 	return page;
@@ -163,6 +303,7 @@ static struct page *__page_pool_get_cached(struct page_pool *pool)
 	if (likely(pool->alloc.count)) {
 		/* Fast-path */
 		page = pool->alloc.cache[--pool->alloc.count];
+		alloc_stat_inc(pool, fast);
 	} else {
 		page = page_pool_refill_alloc_cache(pool);
 	}
@@ -234,6 +375,11 @@ static struct page *__page_pool_alloc_pages_slow(struct page_pool *pool,
 		page_pool_dma_sync_for_device(pool, page, pool->p.max_len);
 
 skip_dma_map:
+	if (pool->p.order)
+		alloc_stat_inc(pool, slow_high_order);
+	else
+		alloc_stat_inc(pool, slow);
+
 	/* Track how many pages are held 'in-flight' */
 	pool->pages_state_hold_cnt++;
 
@@ -261,6 +407,89 @@ struct page *page_pool_alloc_pages(struct page_pool *pool, gfp_t gfp)
 }
 EXPORT_SYMBOL(page_pool_alloc_pages);
 
+static struct page *page_pool_drain_frag(struct page_pool *pool,
+					 struct page *page)
+{
+	long drain_count = BIAS_MAX - pool->frag_users;
+
+	/* Some user is still using the page frag */
+	if (likely(page_pool_defrag_page(page, drain_count)))
+		return NULL;
+
+	if (page_ref_count(page) == 1 && !page_is_pfmemalloc(page)) {
+		if (pool->p.flags & PP_FLAG_DMA_SYNC_DEV)
+			page_pool_dma_sync_for_device(pool, page, -1);
+
+		return page;
+	}
+
+	page_pool_return_page(pool, page);
+	return NULL;
+}
+
+static void page_pool_free_frag(struct page_pool *pool)
+{
+	long drain_count = BIAS_MAX - pool->frag_users;
+	struct page *page = pool->frag_page;
+
+	pool->frag_page = NULL;
+
+	if (!page || page_pool_defrag_page(page, drain_count))
+		return;
+
+	page_pool_return_page(pool, page);
+}
+
+/* Carve @size bytes out of the current fragment page, starting a new
+ * page once it is used up.  The page is handed out with a large
+ * fragment bias so that only the final page_pool_put_page() of each
+ * fragment user has to touch the atomic count.
+ */
+struct page *page_pool_alloc_frag(struct page_pool *pool,
+				  unsigned int *offset,
+				  unsigned int size, gfp_t gfp)
+{
+	unsigned int max_size = PAGE_SIZE << pool->p.order;
+	struct page *page = pool->frag_page;
+
+	if (WARN_ON(!(pool->p.flags & PP_FLAG_PAGE_FRAG) ||
+		    size > max_size))
+		return NULL;
+
+	*offset = pool->frag_offset;
+
+	if (page && *offset + size > max_size) {
+		page = page_pool_drain_frag(pool, page);
+		if (page) {
+			alloc_stat_inc(pool, fast);
+			goto frag_reset;
+		}
+	}
+
+	if (!page) {
+		page = page_pool_alloc_pages(pool, gfp);
+		if (unlikely(!page)) {
+			pool->frag_page = NULL;
+			return NULL;
+		}
+
+		pool->frag_page = page;
+
+frag_reset:
+		pool->frag_users = 1;
+		*offset = 0;
+		pool->frag_offset = size;
+		page_pool_fragment_page(page, BIAS_MAX);
+		return page;
+	}
+
+	pool->frag_users++;
+	pool->frag_offset = *offset + size;
+	alloc_stat_inc(pool, fast);
+	return page;
+}
+EXPORT_SYMBOL(page_pool_alloc_frag);
+
 /* Calculate distance between two u32 values, valid if distance is below 2^(31)
  *  https://en.wikipedia.org/wiki/Serial_number_arithmetic#General_Solution
  */
@@ -333,7 +562,64 @@ static bool page_pool_recycle_in_ring(struct page_pool *pool, struct page *page)
 	else
 		ret = ptr_ring_produce_bh(&pool->ring, page);
 
-	return (ret == 0) ? true : false;
+	if (!ret) {
+		recycle_stat_inc(pool, ring);
+		return true;
+	}
+
+	return false;
+}
+
+/* Push the staged pages into the ptr_ring under a single producer lock.
+ * Caller must have BH disabled and own the per-CPU cache.
+ */
+static void page_pool_flush_pcpu_cache(struct page_pool *pool,
+				       struct pp_pcpu_cache *c)
+{
+	u32 i, count = c->count;
+
+	spin_lock(&pool->ring.producer_lock);
+	for (i = 0; i < count; i++) {
+		if (__ptr_ring_produce(&pool->ring, c->cache[i]))
+			break; /* ring full */
+	}
+	spin_unlock(&pool->ring.producer_lock);
+
+	recycle_stat_add(pool, ring, i);
+	c->count = 0;
+
+	/* ptr_ring full, free remaining pages outside producer lock */
+	for (; i < count; i++) {
+		recycle_stat_inc(pool, ring_full);
+		page_pool_return_page(pool, c->cache[i]);
+	}
+}
+
+/* Stage a page freed outside the owning NAPI context in the per-CPU
+ * cache.  Returns false once the pool is being destroyed, in which case
+ * the caller falls back to the ptr_ring directly.
+ */
+static bool page_pool_recycle_in_pcpu(struct page_pool *pool,
+				      struct page *page)
+{
+	struct pp_pcpu_cache *c;
+	bool staged = false;
+
+	/* A BH-disabled section also acts as an RCU read-side critical
+	 * section, page_pool_empty_pcpu_caches() relies on this.
+	 */
+	local_bh_disable();
+	if (likely(!READ_ONCE(pool->destroy_cnt))) {
+		c = this_cpu_ptr(pool->pcpu_cache);
+		c->cache[c->count++] = page;
+		recycle_stat_inc(pool, staged);
+		if (c->count == PP_PCPU_CACHE_SIZE)
+			page_pool_flush_pcpu_cache(pool, c);
+		staged = true;
+	}
+	local_bh_enable();
+
+	return staged;
 }
 
 /* Only allow direct recycling in special circumstances, into the
@@ -344,11 +630,14 @@ static bool page_pool_recycle_in_ring(struct page_pool *pool, struct page *page)
 static bool page_pool_recycle_in_cache(struct page *page,
 				       struct page_pool *pool)
 {
-	if (unlikely(pool->alloc.count == PP_ALLOC_CACHE_SIZE))
+	if (unlikely(pool->alloc.count == PP_ALLOC_CACHE_SIZE)) {
+		recycle_stat_inc(pool, cache_full);
 		return false;
+	}
 
 	/* Caller MUST have verified/know (page_ref_count(page) == 1) */
 	pool->alloc.cache[pool->alloc.count++] = page;
+	recycle_stat_inc(pool, cached);
 	return true;
 }
 
@@ -399,6 +688,7 @@ __page_pool_put_page(struct page_pool *pool, struct page *page,
 	 * will be invoking put_page.
 	 */
 	/* Do not replace this with page_pool_return_page() */
+	recycle_stat_inc(pool, released_refcnt);
 	page_pool_release_page(pool, page);
 	put_page(page);
 
@@ -408,9 +698,16 @@ __page_pool_put_page(struct page_pool *pool, struct page *page,
 void page_pool_put_page(struct page_pool *pool, struct page *page,
 			unsigned int dma_sync_size, bool allow_direct)
 {
+	if (!page_pool_is_last_frag(pool, page))
+		return;
+
 	page = __page_pool_put_page(pool, page, dma_sync_size, allow_direct);
-	if (page && !page_pool_recycle_in_ring(pool, page)) {
+	if (!page || page_pool_recycle_in_pcpu(pool, page))
+		return;
+
+	if (!page_pool_recycle_in_ring(pool, page)) {
 		/* Cache full, fallback to free pages */
+		recycle_stat_inc(pool, ring_full);
 		page_pool_return_page(pool, page);
 	}
 }
@@ -425,6 +722,10 @@ void page_pool_put_page_bulk(struct page_pool *pool, void **data,
 	for (i = 0; i < count; i++) {
 		struct page *page = virt_to_head_page(data[i]);
 
+		/* It is not the last user for the page frag case */
+		if (!page_pool_is_last_frag(pool, page))
+			continue;
+
 		page = __page_pool_put_page(pool, page, -1, false);
 		/* Approved for bulk recycling in ptr_ring cache */
 		if (page)
@@ -442,6 +743,8 @@ void page_pool_put_page_bulk(struct page_pool *pool, void **data,
 	}
 	page_pool_ring_unlock(pool);
 
+	recycle_stat_add(pool, ring, i);
+
 	/* Hopefully all pages was return into ptr_ring */
 	if (likely(i == bulk_len))
 		return;
@@ -449,8 +752,10 @@ void page_pool_put_page_bulk(struct page_pool *pool, void **data,
 	/* ptr_ring cache full, free remaining pages outside producer lock
 	 * since put_page() with refcnt == 1 can be an expensive operation
 	 */
-	for (; i < bulk_len; i++)
+	for (; i < bulk_len; i++) {
+		recycle_stat_inc(pool, ring_full);
 		page_pool_return_page(pool, data[i]);
+	}
 }
 EXPORT_SYMBOL(page_pool_put_page_bulk);
 
@@ -475,6 +780,10 @@ static void page_pool_free(struct page_pool *pool)
 		pool->disconnect(pool);
 
 	ptr_ring_cleanup(&pool->ring, NULL);
+	free_percpu(pool->pcpu_cache);
+#ifdef CONFIG_PAGE_POOL_STATS
+	free_percpu(pool->recycle_stats);
+#endif
 
 	if (pool->p.flags & PP_FLAG_DMA_MAP)
 		put_device(pool->p.dev);
@@ -489,6 +798,8 @@ static void page_pool_empty_alloc_cache_once(struct page_pool *pool)
 	if (pool->destroy_cnt)
 		return;
 
+	page_pool_free_frag(pool);
+
 	/* Empty alloc cache, assume caller made sure this is
 	 * no-longer in use, and page_pool_alloc_pages() cannot be
 	 * call concurrently.
@@ -499,10 +810,30 @@ static void page_pool_empty_alloc_cache_once(struct page_pool *pool)
 	}
 }
 
+/* Return the pages staged in the per-CPU caches.  Must be called from
+ * process context after page_pool_scrub() has bumped destroy_cnt.
+ */
+static void page_pool_empty_pcpu_caches(struct page_pool *pool)
+{
+	int cpu;
+
+	/* Stagers test destroy_cnt with BH disabled; after a grace period
+	 * no CPU can still be adding to its cache.
+	 */
+	synchronize_rcu();
+
+	for_each_possible_cpu(cpu) {
+		struct pp_pcpu_cache *c = per_cpu_ptr(pool->pcpu_cache, cpu);
+
+		while (c->count)
+			page_pool_return_page(pool, c->cache[--c->count]);
+	}
+}
+
 static void page_pool_scrub(struct page_pool *pool)
 {
 	page_pool_empty_alloc_cache_once(pool);
-	pool->destroy_cnt++;
+	WRITE_ONCE(pool->destroy_cnt, pool->destroy_cnt + 1);
 
 	/* No more consumers should exist, but producers could still
 	 * be in-flight.
@@ -528,6 +859,10 @@ static void page_pool_release_retry(struct work_struct *wq)
 	struct page_pool *pool = container_of(dwq, typeof(*pool), release_dw);
 	int inflight;
 
+	/* Pages staged in per-CPU caches count as in-flight, so a pool
+	 * holding any is never freed by the release in page_pool_destroy().
+	 */
+	page_pool_empty_pcpu_caches(pool);
 	inflight = page_pool_release(pool);
 	if (!inflight)
 		return;
@@ -185,6 +185,50 @@ static struct sk_buff *napi_skb_cache_get(void)
 	return skb;
 }
 
+/**
+ * napi_skb_cache_get_bulk - obtain a number of cleared skb heads
+ * @skbs: array of at least @n entries to fill with skb pointers
+ * @n: number of heads wanted, at most %NAPI_SKB_CACHE_SIZE is served
+ *
+ * Takes @n heads from the NAPI percpu cache, topping the cache up with a
+ * single kmem_cache_alloc_bulk() call when it cannot serve the request.
+ * The heads are cleared like for __build_skb(), so they are ready for
+ * build_skb_around().  Heads left unused must be handed back with
+ * napi_skb_cache_put_bulk().  Must be called from BH context.
+ *
+ * Returns the number of heads written to @skbs, which may be less than
+ * @n when the slab allocation fails.
+ */
+u32 napi_skb_cache_get_bulk(void **skbs, u32 n)
+{
+	struct napi_alloc_cache *nc = this_cpu_ptr(&napi_alloc_cache);
+	struct sk_buff *skb;
+	u32 bulk, i;
+
+	lockdep_assert_in_softirq();
+
+	n = min_t(u32, n, NAPI_SKB_CACHE_SIZE);
+	if (unlikely(nc->skb_count < n)) {
+		bulk = max_t(u32, n - nc->skb_count, NAPI_SKB_CACHE_BULK);
+		bulk = min_t(u32, bulk, NAPI_SKB_CACHE_SIZE - nc->skb_count);
+		nc->skb_count += kmem_cache_alloc_bulk(skbuff_head_cache,
+						       GFP_ATOMIC, bulk,
+						       nc->skb_cache +
+						       nc->skb_count);
+		n = min(n, nc->skb_count);
+	}
+
+	for (i = 0; i < n; i++) {
+		skb = nc->skb_cache[--nc->skb_count];
+		kasan_unpoison_object_data(skbuff_head_cache, skb);
+		memset(skb, 0, offsetof(struct sk_buff, tail));
+		skbs[i] = skb;
+	}
+
+	return n;
+}
+EXPORT_SYMBOL(napi_skb_cache_get_bulk);
+
 /* Caller must provide SKB that is memset cleared */
 static void __build_skb_around(struct sk_buff *skb, void *data,
 			       unsigned int frag_size)
@@ -930,6 +974,24 @@ static void napi_skb_cache_put(struct sk_buff *skb)
 	}
 }
 
+/**
+ * napi_skb_cache_put_bulk - give back unused heads to the NAPI cache
+ * @skbs: heads from napi_skb_cache_get_bulk() with no data attached
+ * @n: number of entries in @skbs
+ *
+ * Must be called from BH context.
+ */
+void napi_skb_cache_put_bulk(void **skbs, u32 n)
+{
+	u32 i;
+
+	lockdep_assert_in_softirq();
+
+	for (i = 0; i < n; i++)
+		napi_skb_cache_put(skbs[i]);
+}
+EXPORT_SYMBOL(napi_skb_cache_put_bulk);
+
 void __kfree_skb_defer(struct sk_buff *skb)
 {
 	skb_release_all(skb);
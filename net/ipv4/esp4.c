@@ -1023,7 +1023,7 @@ static int esp_init_aead(struct xfrm_state *x)
 		     x->geniv, x->aead->alg_name) >= CRYPTO_MAX_ALG_NAME)
 		goto error;
 
-	aead = crypto_alloc_aead(aead_name, 0, 0);
+	aead = xfrm_aead_alloc(aead_name);
 	err = PTR_ERR(aead);
 	if (IS_ERR(aead))
 		goto error;
@@ -1078,7 +1078,7 @@ static int esp_init_authenc(struct xfrm_state *x)
 			goto error;
 	}
 
-	aead = crypto_alloc_aead(authenc_name, 0, 0);
+	aead = xfrm_aead_alloc(authenc_name);
 	err = PTR_ERR(aead);
 	if (IS_ERR(aead))
 		goto error;
@@ -130,16 +130,22 @@ struct key_vector {
 };
 
 struct tnode {
-	struct rcu_head rcu;
 	t_key empty_children;		/* KEYLENGTH bits needed */
 	t_key full_children;		/* KEYLENGTH bits needed */
+	struct rcu_head rcu;
 	struct key_vector __rcu *parent;
 	struct key_vector kv[1];
 #define tn_bits kv[0].bits
 };
 
 #define TNODE_SIZE(n)	offsetof(struct tnode, kv[0].tnode[n])
-#define LEAF_SIZE	TNODE_SIZE(1)
+
+/* Leaves have no children to count, so their allocation starts at the
+ * rcu head and the child counters in front of it are never backed by
+ * memory.  This keeps a leaf at 40 bytes on 64-bit, rather than 48.
+ */
+#define LEAF_OFFSET	offsetof(struct tnode, rcu)
+#define LEAF_SIZE	(TNODE_SIZE(1) - LEAF_OFFSET)
 
 #ifdef CONFIG_IP_FIB_TRIE_STATS
 struct trie_use_stats {
@@ -309,7 +315,7 @@ static void __node_free_rcu(struct rcu_head *head)
 	struct tnode *n = container_of(head, struct tnode, rcu);
 
 	if (!n->tn_bits)
-		kmem_cache_free(trie_leaf_kmem, n);
+		kmem_cache_free(trie_leaf_kmem, head);
 	else
 		kvfree(n);
 }
@@ -353,12 +359,14 @@ static struct key_vector *leaf_new(t_key key, struct fib_alias *fa)
 {
 	struct key_vector *l;
 	struct tnode *kv;
+	void *mem;
 
-	kv = kmem_cache_alloc(trie_leaf_kmem, GFP_KERNEL);
-	if (!kv)
+	mem = kmem_cache_alloc(trie_leaf_kmem, GFP_KERNEL);
+	if (!mem)
 		return NULL;
 
 	/* initialize key vector */
+	kv = mem - LEAF_OFFSET;
 	l = kv->kv;
 	l->key = key;
 	l->pos = 0;
@@ -168,6 +168,8 @@ static const struct snmp_mib snmp4_udp_list[] = {
 	SNMP_MIB_ITEM("InCsumErrors", UDP_MIB_CSUMERRORS),
 	SNMP_MIB_ITEM("IgnoredMulti", UDP_MIB_IGNOREDMULTI),
 	SNMP_MIB_ITEM("MemErrors", UDP_MIB_MEMERRORS),
+	SNMP_MIB_ITEM("FlowCacheHits", UDP_MIB_FLOWCACHEHITS),
+	SNMP_MIB_ITEM("FlowCacheMisses", UDP_MIB_FLOWCACHEMISSES),
 	SNMP_MIB_SENTINEL
 };
 
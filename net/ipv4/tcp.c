@@ -1199,6 +1199,21 @@ static int tcp_sendmsg_fastopen(struct sock *sk, struct msghdr *msg,
 	return err;
 }
 
+/* Writes up to TCP_SMALL_WRITE bytes get a new skb with about an MSS of
+ * linear room, so that the small writes following them are appended with
+ * a plain copy instead of page frag refill and coalescing.
+ */
+#define TCP_SMALL_WRITE		256
+#define TCP_SMALL_WRITE_HEAD	(SKB_WITH_OVERHEAD(2048) - MAX_TCP_HEADER)
+
+static int tcp_sendmsg_linear_size(struct msghdr *msg, int size_goal, bool zc)
+{
+	if (zc || msg_data_left(msg) > TCP_SMALL_WRITE)
+		return 0;
+
+	return min_t(int, size_goal, TCP_SMALL_WRITE_HEAD);
+}
+
 int tcp_sendmsg_locked(struct sock *sk, struct msghdr *msg, size_t size)
 {
 	struct tcp_sock *tp = tcp_sk(sk);
@@ -1213,7 +1228,12 @@ int tcp_sendmsg_locked(struct sock *sk, struct msghdr *msg, size_t size)
 
 	flags = msg->msg_flags;
 
-	if (flags & MSG_ZEROCOPY && size && sock_flag(sk, SOCK_ZEROCOPY)) {
+	if (flags & MSG_ZEROCOPY && size && msg->msg_ubuf) {
+		/* in-kernel caller (io_uring) tracks the pages itself */
+		uarg = msg->msg_ubuf;
+		net_zcopy_get(uarg);
+		zc = sk->sk_route_caps & NETIF_F_SG;
+	} else if (flags & MSG_ZEROCOPY && size && sock_flag(sk, SOCK_ZEROCOPY)) {
 		skb = tcp_write_queue_tail(sk);
 		uarg = msg_zerocopy_realloc(sk, size, skb_zcopy(skb));
 		if (!uarg) {
@@ -1305,8 +1325,11 @@ int tcp_sendmsg_locked(struct sock *sk, struct msghdr *msg, size_t size)
 					goto restart;
 			}
 			first_skb = tcp_rtx_and_write_queues_empty(sk);
-			skb = sk_stream_alloc_skb(sk, 0, sk->sk_allocation,
-						  first_skb);
+			skb = sk_stream_alloc_skb(sk,
+						  tcp_sendmsg_linear_size(msg,
+									  size_goal,
+									  zc),
+						  sk->sk_allocation, first_skb);
 			if (!skb)
 				goto wait_for_space;
 
@@ -1879,6 +1902,7 @@ static int receive_fallback_to_copy(struct sock *sk,
 		return err;
 
 	zc->copybuf_len = err;
+	tcp_sk(sk)->bytes_zc_copied += err;
 	if (likely(zc->copybuf_len)) {
 		struct sk_buff *skb;
 		u32 offset;
@@ -2176,6 +2200,8 @@ static int tcp_zerocopy_receive(struct sock *sk,
 		copylen = tcp_zc_handle_leftover(zc, sk, skb, &seq, copybuf_len, tss);
 
 	if (length + copylen) {
+		tp->bytes_zc_mapped += length;
+		tp->bytes_zc_copied += copylen;
 		WRITE_ONCE(tp->copied_seq, seq);
 		tcp_rcv_space_adjust(sk);
 
@@ -3010,6 +3036,8 @@ int tcp_disconnect(struct sock *sk, int flags)
 	tp->bytes_acked = 0;
 	tp->bytes_received = 0;
 	tp->bytes_retrans = 0;
+	tp->bytes_zc_mapped = 0;
+	tp->bytes_zc_copied = 0;
 	tp->data_segs_in = 0;
 	tp->data_segs_out = 0;
 	tp->duplicate_sack[0].start_seq = 0;
@@ -3779,6 +3807,8 @@ void tcp_get_info(struct sock *sk, struct tcp_info *info)
 	info->tcpi_reord_seen = tp->reord_seen;
 	info->tcpi_rcv_ooopack = tp->rcv_ooopack;
 	info->tcpi_snd_wnd = tp->snd_wnd;
+	info->tcpi_rcv_zc_mapped = tp->bytes_zc_mapped;
+	info->tcpi_rcv_zc_copied = tp->bytes_zc_copied;
 	info->tcpi_fastopen_client_fail = tp->fastopen_client_fail;
 	unlock_sock_fast(sk, slow);
 }
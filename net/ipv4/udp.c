@@ -478,6 +478,73 @@ static struct sock *udp4_lookup_run_bpf(struct net *net,
 	return sk;
 }
 
+/* Per-CPU front cache of connected sockets, keyed on the 4-tuple.  Every
+ * entry is re-validated with INET_MATCH() when used, a stale one merely
+ * costs a miss.  udp_lib_unhash() purges a socket from all caches before
+ * it can be freed, entries never outlive the socket they point to.
+ */
+#define UDP_FLOW_CACHE_SIZE	64
+
+struct udp_flow_cache {
+	struct sock *sk[UDP_FLOW_CACHE_SIZE];
+};
+
+static DEFINE_PER_CPU(struct udp_flow_cache, udp_flow_cache);
+static DEFINE_STATIC_KEY_FALSE(udp_flow_cache_enabled);
+
+static struct sock *udp4_flow_cache_lookup(struct net *net, __be32 saddr,
+					   __be16 sport, __be32 daddr,
+					   unsigned short hnum, int dif,
+					   int sdif, struct sock ***slotp)
+{
+	INET_ADDR_COOKIE(acookie, saddr, daddr);
+	const __portpair ports = INET_COMBINED_PORTS(sport, hnum);
+	u32 hash = udp_ehashfn(net, daddr, hnum, saddr, sport);
+	struct sock **slot;
+	struct sock *sk;
+
+	slot = &raw_cpu_ptr(&udp_flow_cache)->sk[hash &
+						 (UDP_FLOW_CACHE_SIZE - 1)];
+	*slotp = slot;
+
+	sk = READ_ONCE(*slot);
+	if (sk && sk->sk_state == TCP_ESTABLISHED &&
+	    INET_MATCH(sk, net, acookie, saddr, daddr, ports, dif, sdif))
+		return sk;
+
+	return NULL;
+}
+
+/* Caller holds rcu_read_lock(), @sk is a SOCK_RCU_FREE socket */
+static void udp_flow_cache_insert(struct sock **slot, struct sock *sk)
+{
+	WRITE_ONCE(*slot, sk);
+
+	/* Pairs with smp_mb() in udp_flow_cache_forget(): either the purge
+	 * sees this entry or we see the socket unhashed.
+	 */
+	smp_mb();
+	if (unlikely(!sk_hashed(sk)))
+		cmpxchg(slot, sk, NULL);
+}
+
+static void udp_flow_cache_forget(struct sock *sk)
+{
+	struct udp_flow_cache *fc;
+	int cpu, i;
+
+	if (!static_branch_unlikely(&udp_flow_cache_enabled))
+		return;
+
+	smp_mb();
+	for_each_possible_cpu(cpu) {
+		fc = per_cpu_ptr(&udp_flow_cache, cpu);
+		for (i = 0; i < UDP_FLOW_CACHE_SIZE; i++)
+			if (READ_ONCE(fc->sk[i]) == sk)
+				cmpxchg(&fc->sk[i], sk, NULL);
+	}
+}
+
 /* UDP is nearly always wildcards out the wazoo, it makes no sense to try
  * harder than this. -DaveM
  */
@@ -489,6 +556,18 @@ struct sock *__udp4_lib_lookup(struct net *net, __be32 saddr,
 	unsigned int hash2, slot2;
 	struct udp_hslot *hslot2;
 	struct sock *result, *sk;
+	struct sock **slot = NULL;
+
+	if (static_branch_unlikely(&udp_flow_cache_enabled) &&
+	    udptable == &udp_table) {
+		result = udp4_flow_cache_lookup(net, saddr, sport, daddr, hnum,
+						dif, sdif, &slot);
+		if (result) {
+			__UDP_INC_STATS(net, UDP_MIB_FLOWCACHEHITS, 0);
+			return result;
+		}
+		__UDP_INC_STATS(net, UDP_MIB_FLOWCACHEMISSES, 0);
+	}
 
 	hash2 = ipv4_portaddr_hash(net, daddr, hnum);
 	slot2 = hash2 & udptable->mask;
@@ -498,8 +577,12 @@ struct sock *__udp4_lib_lookup(struct net *net, __be32 saddr,
 	result = udp4_lib_lookup2(net, saddr, sport,
 				  daddr, hnum, dif, sdif,
 				  hslot2, skb);
-	if (!IS_ERR_OR_NULL(result) && result->sk_state == TCP_ESTABLISHED)
+	if (!IS_ERR_OR_NULL(result) && result->sk_state == TCP_ESTABLISHED) {
+		/* A reuseport group may pick a different member next time */
+		if (slot && !result->sk_reuseport)
+			udp_flow_cache_insert(slot, result);
 		goto done;
+	}
 
 	/* Lookup redirect from BPF */
 	if (static_branch_unlikely(&bpf_sk_lookup_enabled)) {
@@ -1904,6 +1987,9 @@ int udp_pre_connect(struct sock *sk, struct sockaddr *uaddr, int addr_len)
 	if (addr_len < sizeof(struct sockaddr_in))
 		return -EINVAL;
 
+	if (!static_key_enabled(&udp_flow_cache_enabled))
+		static_branch_enable(&udp_flow_cache_enabled);
+
 	return BPF_CGROUP_RUN_PROG_INET4_CONNECT_LOCK(sk, uaddr);
 }
 EXPORT_SYMBOL(udp_pre_connect);
@@ -1969,6 +2055,8 @@ void udp_lib_unhash(struct sock *sk)
 			spin_unlock(&hslot2->lock);
 		}
 		spin_unlock_bh(&hslot->lock);
+
+		udp_flow_cache_forget(sk);
 	}
 }
 EXPORT_SYMBOL(udp_lib_unhash);
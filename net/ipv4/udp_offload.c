@@ -566,6 +566,33 @@ struct sk_buff *udp_gro_receive(struct list_head *head, struct sk_buff *skb,
 }
 EXPORT_SYMBOL(udp_gro_receive);
 
+/* A forwarded flow is aggregated with fraglist GRO only because no socket
+ * claimed it.  Segments joining such an aggregate would resolve to the
+ * same (lack of a) socket, so the lookup is skipped for all but the first
+ * packet of every GRO batch.
+ */
+bool udp_gro_joins_flist(struct list_head *head, struct sk_buff *skb,
+			 struct udphdr *uh)
+{
+	struct sk_buff *p;
+	struct udphdr *uh2;
+
+	if (!(skb->dev->features & NETIF_F_GRO_FRAGLIST))
+		return false;
+
+	list_for_each_entry(p, head, list) {
+		if (!NAPI_GRO_CB(p)->same_flow || !NAPI_GRO_CB(p)->is_flist)
+			continue;
+
+		uh2 = udp_hdr(p);
+		if (*(u32 *)&uh->source == *(u32 *)&uh2->source)
+			return true;
+	}
+
+	return false;
+}
+EXPORT_SYMBOL(udp_gro_joins_flist);
+
 static struct sock *udp4_gro_lookup_skb(struct sk_buff *skb, __be16 sport,
 					__be16 dport)
 {
@@ -600,7 +627,8 @@ struct sk_buff *udp4_gro_receive(struct list_head *head, struct sk_buff *skb)
 	NAPI_GRO_CB(skb)->is_ipv6 = 0;
 	rcu_read_lock();
 
-	if (static_branch_unlikely(&udp_encap_needed_key))
+	if (static_branch_unlikely(&udp_encap_needed_key) &&
+	    !udp_gro_joins_flist(head, skb, uh))
 		sk = udp4_gro_lookup_skb(skb, uh->source, uh->dest);
 
 	pp = udp_gro_receive(head, skb, uh, sk);
@@ -146,7 +146,8 @@ struct sk_buff *udp6_gro_receive(struct list_head *head, struct sk_buff *skb)
 	NAPI_GRO_CB(skb)->is_ipv6 = 1;
 	rcu_read_lock();
 
-	if (static_branch_unlikely(&udpv6_encap_needed_key))
+	if (static_branch_unlikely(&udpv6_encap_needed_key) &&
+	    !udp_gro_joins_flist(head, skb, uh))
 		sk = udp6_gro_lookup_skb(skb, uh->source, uh->dest);
 
 	pp = udp_gro_receive(head, skb, uh, sk);
@@ -1951,6 +1951,7 @@ int __sys_sendto(int fd, void __user *buff, size_t len, unsigned int flags,
 	msg.msg_control = NULL;
 	msg.msg_controllen = 0;
 	msg.msg_namelen = 0;
+	msg.msg_ubuf = NULL;
 	if (addr) {
 		err = move_addr_to_kernel(addr, addr_len, &address);
 		if (err < 0)
@@ -2223,6 +2224,7 @@ int __copy_msghdr_from_user(struct msghdr *kmsg,
 	kmsg->msg_control_user = msg.msg_control;
 	kmsg->msg_controllen = msg.msg_controllen;
 	kmsg->msg_flags = msg.msg_flags;
+	kmsg->msg_ubuf = NULL;
 
 	kmsg->msg_namelen = msg.msg_namelen;
 	if (!msg.msg_name)
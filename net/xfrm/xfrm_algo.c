@@ -5,11 +5,13 @@
  * Copyright (c) 2002 James Morris <jmorris@intercode.com.au>
  */
 
+#include <crypto/aead.h>
 #include <crypto/hash.h>
 #include <crypto/skcipher.h>
 #include <linux/module.h>
 #include <linux/kernel.h>
 #include <linux/pfkeyv2.h>
+#include <linux/cpumask.h>
 #include <linux/crypto.h>
 #include <linux/scatterlist.h>
 #include <net/xfrm.h>
@@ -822,4 +824,43 @@ int xfrm_count_pfkey_enc_supported(void)
 }
 EXPORT_SYMBOL_GPL(xfrm_count_pfkey_enc_supported);
 
+static bool parallel_aead = true;
+module_param(parallel_aead, bool, 0644);
+MODULE_PARM_DESC(parallel_aead,
+		 "Spread synchronous AEADs of IPsec states over all CPUs with pcrypt");
+
+/*
+ * Allocate the AEAD of an IPsec state.  A synchronous software
+ * implementation runs on the CPU that receives or sends the packet, so a
+ * single SA never uses more than one CPU.  On SMP such an AEAD is wrapped in
+ * pcrypt, which spreads the requests of the SA over the online CPUs and
+ * completes them in order.  Asynchronous implementations, usually hardware
+ * engines, are used as they are.
+ */
+struct crypto_aead *xfrm_aead_alloc(const char *name)
+{
+	char pname[CRYPTO_MAX_ALG_NAME];
+	struct crypto_aead *aead, *paead;
+
+	aead = crypto_alloc_aead(name, 0, 0);
+	if (IS_ERR(aead) || !IS_ENABLED(CONFIG_CRYPTO_PCRYPT) ||
+	    !parallel_aead || num_online_cpus() < 2 ||
+	    crypto_aead_alg(aead)->base.cra_flags & CRYPTO_ALG_ASYNC)
+		return aead;
+
+	/* wrap the very implementation picked above, not the best one */
+	if (snprintf(pname, CRYPTO_MAX_ALG_NAME, "pcrypt(%s)",
+		     crypto_tfm_alg_driver_name(crypto_aead_tfm(aead))) >=
+	    CRYPTO_MAX_ALG_NAME)
+		return aead;
+
+	paead = crypto_alloc_aead(pname, 0, 0);
+	if (IS_ERR(paead))
+		return aead;
+
+	crypto_free_aead(aead);
+	return paead;
+}
+EXPORT_SYMBOL_GPL(xfrm_aead_alloc);
+
 MODULE_LICENSE("GPL");
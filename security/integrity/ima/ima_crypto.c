@@ -14,6 +14,7 @@
 #include <linux/moduleparam.h>
 #include <linux/ratelimit.h>
 #include <linux/file.h>
+#include <linux/fadvise.h>
 #include <linux/crypto.h>
 #include <linux/scatterlist.h>
 #include <linux/err.h>
@@ -52,7 +53,12 @@ static const struct kernel_param_ops param_ops_bufsize = {
 #define param_check_bufsize(name, p) __param_check(name, p, unsigned int)
 
 module_param_named(ahash_bufsize, ima_bufsize, bufsize, 0644);
-MODULE_PARM_DESC(ahash_bufsize, "Maximum ahash buffer size");
+MODULE_PARM_DESC(ahash_bufsize, "Maximum ahash and shash read buffer size");
+
+/* how far to read ahead of the data being hashed, 0 - per-file readahead */
+static unsigned int ima_readahead_kb = 1024;
+module_param_named(readahead_kb, ima_readahead_kb, uint, 0644);
+MODULE_PARM_DESC(readahead_kb, "Size of the window read ahead of hashing");
 
 static struct crypto_shash *ima_shash_tfm;
 static struct crypto_ahash *ima_ahash_tfm;
@@ -325,11 +331,35 @@ static inline int ahash_wait(int err, struct crypto_wait *wait)
 	return err;
 }
 
+/*
+ * Hashing a file is bound by its reads when it is not cached yet, as it is
+ * on boot. Keep a window of the page cache read past the data being
+ * hashed, refilled once half of it is used, so that the device works
+ * while the CPU hashes instead of in turns.
+ */
+static void ima_readahead(struct file *file, loff_t offset, loff_t i_size,
+			  loff_t *ra_end)
+{
+	loff_t window = (loff_t)READ_ONCE(ima_readahead_kb) << 10;
+	loff_t start, len;
+
+	if (!window || offset + window / 2 < *ra_end)
+		return;
+
+	start = max(offset, *ra_end);
+	len = min(window, i_size - start);
+	if (len <= 0)
+		return;
+
+	vfs_fadvise(file, start, len, POSIX_FADV_WILLNEED);
+	*ra_end = start + len;
+}
+
 static int ima_calc_file_hash_atfm(struct file *file,
 				   struct ima_digest_data *hash,
 				   struct crypto_ahash *tfm)
 {
-	loff_t i_size, offset;
+	loff_t i_size, offset, ra_end = 0;
 	char *rbuf[2] = { NULL, };
 	int rc, rbuf_len, active = 0, ahash_rc = 0;
 	struct ahash_request *req;
@@ -389,6 +419,7 @@ static int ima_calc_file_hash_atfm(struct file *file,
 				goto out3;
 		}
 		/* read buffer */
+		ima_readahead(file, offset, i_size, &ra_end);
 		rbuf_len = min_t(loff_t, i_size - offset, rbuf_size[active]);
 		rc = integrity_kernel_read(file, offset, rbuf[active],
 					   rbuf_len);
@@ -456,7 +487,8 @@ static int ima_calc_file_hash_tfm(struct file *file,
 				  struct ima_digest_data *hash,
 				  struct crypto_shash *tfm)
 {
-	loff_t i_size, offset = 0;
+	loff_t i_size, offset = 0, ra_end = 0;
+	size_t rbuf_size;
 	char *rbuf;
 	int rc;
 	SHASH_DESC_ON_STACK(shash, tfm);
@@ -474,14 +506,15 @@ static int ima_calc_file_hash_tfm(struct file *file,
 	if (i_size == 0)
 		goto out;
 
-	rbuf = kzalloc(PAGE_SIZE, GFP_KERNEL);
+	rbuf = ima_alloc_pages(i_size, &rbuf_size, 1);
 	if (!rbuf)
 		return -ENOMEM;
 
 	while (offset < i_size) {
 		int rbuf_len;
 
-		rbuf_len = integrity_kernel_read(file, offset, rbuf, PAGE_SIZE);
+		ima_readahead(file, offset, i_size, &ra_end);
+		rbuf_len = integrity_kernel_read(file, offset, rbuf, rbuf_size);
 		if (rbuf_len < 0) {
 			rc = rbuf_len;
 			break;
@@ -496,7 +529,7 @@ static int ima_calc_file_hash_tfm(struct file *file,
 		if (rc)
 			break;
 	}
-	kfree(rbuf);
+	ima_free_pages(rbuf, rbuf_size);
 out:
 	if (!rc)
 		rc = crypto_shash_final(shash, hash->digest);
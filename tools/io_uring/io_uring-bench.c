@@ -477,10 +477,24 @@ static void file_depths(char *buf)
 	}
 }
 
+/*
+ * CPU time used by the whole process, submitter included, so that the cost
+ * of polling (classic vs hybrid, see io_poll_delay) shows up next to IOPS.
+ */
+static unsigned long get_cpu_usec(void)
+{
+	struct rusage ru;
+
+	if (getrusage(RUSAGE_SELF, &ru) < 0)
+		return 0;
+	return (ru.ru_utime.tv_sec + ru.ru_stime.tv_sec) * 1000000UL +
+		ru.ru_utime.tv_usec + ru.ru_stime.tv_usec;
+}
+
 int main(int argc, char *argv[])
 {
 	struct submitter *s = &submitters[0];
-	unsigned long done, calls, reap;
+	unsigned long done, calls, reap, cpu_usec;
 	int err, i, flags, fd;
 	char *fdepths;
 	void *ret;
@@ -561,13 +575,16 @@ int main(int argc, char *argv[])
 
 	fdepths = malloc(8 * s->nr_files);
 	reap = calls = done = 0;
+	cpu_usec = 0;
 	do {
 		unsigned long this_done = 0;
 		unsigned long this_reap = 0;
 		unsigned long this_call = 0;
 		unsigned long rpc = 0, ipc = 0;
+		unsigned long this_cpu;
 
 		sleep(1);
+		this_cpu = get_cpu_usec();
 		this_done += s->done;
 		this_call += s->calls;
 		this_reap += s->reaps;
@@ -577,9 +594,10 @@ int main(int argc, char *argv[])
 		} else
 			rpc = ipc = -1;
 		file_depths(fdepths);
-		printf("IOPS=%lu, IOS/call=%ld/%ld, inflight=%u (%s)\n",
+		printf("IOPS=%lu, IOS/call=%ld/%ld, inflight=%u (%s), cpu=%lu%%\n",
 				this_done - done, rpc, ipc, s->inflight,
-				fdepths);
+				fdepths, (this_cpu - cpu_usec) / 10000);
+		cpu_usec = this_cpu;
 		done = this_done;
 		calls = this_call;
 		reap = this_reap;
@@ -4,6 +4,7 @@
  */
 #define _GNU_SOURCE
 #include <assert.h>
+#include <errno.h>
 #include <limits.h>
 #include <stdbool.h>
 #include <stddef.h>
@@ -17,6 +18,7 @@
 #include <sys/prctl.h>
 #include <sys/syscall.h>
 #include <sys/types.h>
+#include <sys/wait.h>
 
 #define ARRAY_SIZE(a)    (sizeof(a) / sizeof(a[0]))
 
@@ -74,6 +76,108 @@ unsigned long long calibrate(void)
 	return samples * seconds;
 }
 
+unsigned long long timing_syscall(unsigned long long samples, long nr,
+				  long arg, long expected)
+{
+	struct timespec start, finish;
+	unsigned long long i;
+	long ret;
+
+	assert(clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &start) == 0);
+	for (i = 0; i < samples; i++) {
+		ret = syscall(nr, arg, 0, 0, 0);
+		assert(ret == expected);
+	}
+	assert(clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &finish) == 0);
+
+	i = finish.tv_sec - start.tv_sec;
+	i *= 1000000000ULL;
+	i += finish.tv_nsec - start.tv_nsec;
+
+	return i / samples;
+}
+
+/*
+ * A filter shaped like a container runtime's default profile: a long chain
+ * of allowed syscall numbers, a rule looking at the arguments of
+ * personality(), and everything else failing with EPERM. getpid() comes
+ * last in the chain, where the whole chain has to be walked to reach it.
+ * What the benchmark itself needs is allowed explicitly, in case the
+ * architecture numbers it past the chain.
+ */
+#define PROFILE_ALLOWED	200
+
+void profile(unsigned long long samples)
+{
+	struct sock_filter filter[PROFILE_ALLOWED + 12];
+	struct sock_fprog prog = {
+		.len = (unsigned short)ARRAY_SIZE(filter),
+		.filter = filter,
+	};
+	unsigned long long getpid_ns, personality_ns, denied_ns;
+	const unsigned int allow = PROFILE_ALLOWED + 11;
+	const unsigned int deny = PROFILE_ALLOWED + 10;
+	unsigned int i = 0, nr = 0;
+	long persona;
+	pid_t child;
+	int status;
+
+	fflush(stdout);
+	child = fork();
+	assert(child >= 0);
+	if (child) {
+		assert(waitpid(child, &status, 0) == child);
+		return;
+	}
+
+#define PROFILE_INSN(insn)	do {				\
+		filter[i] = (struct sock_filter)insn;		\
+		i++;						\
+	} while (0)
+#define PROFILE_JEQ(k, to)	PROFILE_INSN(BPF_JUMP(BPF_JMP|BPF_JEQ|BPF_K,	\
+						      k, (to) - i - 1, 0))
+
+	PROFILE_INSN(BPF_STMT(BPF_LD|BPF_W|BPF_ABS,
+			      offsetof(struct seccomp_data, nr)));
+	while (i < PROFILE_ALLOWED) {
+		if (nr != __NR_getpid && nr != __NR_personality &&
+		    nr != __NR_reboot && nr != __NR_restart_syscall)
+			PROFILE_JEQ(nr, allow);
+		nr++;
+	}
+	PROFILE_JEQ(__NR_clock_gettime, allow);
+	PROFILE_JEQ(__NR_write, allow);
+	PROFILE_JEQ(__NR_exit_group, allow);
+	PROFILE_JEQ(__NR_exit, allow);
+	PROFILE_JEQ(__NR_getpid, allow);
+	PROFILE_INSN(BPF_JUMP(BPF_JMP|BPF_JEQ|BPF_K, __NR_personality,
+			      0, deny - i - 1));
+	PROFILE_INSN(BPF_STMT(BPF_LD|BPF_W|BPF_ABS,
+			      offsetof(struct seccomp_data, args[0])));
+	PROFILE_JEQ(0xffffffff, allow);
+	PROFILE_JEQ(0x0, allow);
+	PROFILE_JEQ(0x8, allow);
+	PROFILE_INSN(BPF_STMT(BPF_RET|BPF_K, SECCOMP_RET_ERRNO | EPERM));
+	PROFILE_INSN(BPF_STMT(BPF_RET|BPF_K, SECCOMP_RET_ALLOW));
+	assert(i == ARRAY_SIZE(filter));
+
+	persona = syscall(__NR_personality, 0xffffffff);
+	assert(prctl(PR_SET_NO_NEW_PRIVS, 1, 0, 0, 0) == 0);
+	assert(prctl(PR_SET_SECCOMP, SECCOMP_MODE_FILTER, &prog) == 0);
+
+	getpid_ns = timing_syscall(samples, __NR_getpid, 0, getpid());
+	printf("getpid container profile (allowed): %llu ns\n", getpid_ns);
+	personality_ns = timing_syscall(samples, __NR_personality,
+					0xffffffff, persona);
+	printf("personality container profile (argument rule): %llu ns\n",
+	       personality_ns);
+	denied_ns = timing_syscall(samples, __NR_reboot, 0, -1);
+	printf("reboot container profile (EPERM): %llu ns\n", denied_ns);
+
+	fflush(stdout);
+	exit(0);
+}
+
 bool approx(int i_one, int i_two)
 {
 	double one = i_one, one_bump = one * 0.01;
@@ -158,6 +262,9 @@ int main(int argc, char *argv[])
 	native = timing(CLOCK_PROCESS_CPUTIME_ID, samples) / samples;
 	printf("getpid native: %llu ns\n", native);
 
+	/* A typical container profile, in a child of its own */
+	profile(samples);
+
 	ret = prctl(PR_SET_NO_NEW_PRIVS, 1, 0, 0, 0);
 	assert(ret == 0);
 